@@ -590,6 +590,39 @@ void spdk_accel_sequence_reverse(struct spdk_accel_sequence *seq);
  */
 void spdk_accel_sequence_abort(struct spdk_accel_sequence *seq);
 
+/**
+ * Counters of digests calculated through `spdk_accel_digest_crc32c()`.
+ */
+struct spdk_accel_digest_stats {
+	/** Number of digests calculated by the accel framework */
+	uint64_t offloaded;
+	/** Number of digests calculated inline, on the submitting thread */
+	uint64_t inlined;
+};
+
+/**
+ * Calculate the CRC-32C digest of a network PDU's payload through the accel framework.  If the
+ * operation cannot be submitted (e.g. `ch` is NULL or there are no free tasks), the digest is
+ * calculated inline and `cb_fn` is executed before this function returns.
+ *
+ * The digest is calculated with an initial value of ~0 and isn't finalized, i.e. the caller
+ * needs to XOR it with ~0 to get the digest that is sent on the wire.
+ *
+ * \param ch I/O channel.  Can be NULL, in which case the digest is always calculated inline.
+ * \param crc_dst Destination to write the calculated value.
+ * \param iovs I/O vector array of the payload.
+ * \param iovcnt Size of the `iovs` array.
+ * \param stats Counters to update.  Can be NULL.
+ * \param cb_fn Callback to be executed once the digest is calculated.
+ * \param cb_arg Argument to be passed to `cb_fn`.
+ *
+ * \return 0 on success, negative errno otherwise.  `cb_fn` is only executed on success.
+ */
+int spdk_accel_digest_crc32c(struct spdk_io_channel *ch, uint32_t *crc_dst,
+			     struct iovec *iovs, uint32_t iovcnt,
+			     struct spdk_accel_digest_stats *stats,
+			     spdk_accel_completion_cb cb_fn, void *cb_arg);
+
 /**
  * Allocate a buffer from accel domain.  These buffers can be only used with operations appended to
  * a sequence.  The actual data buffer won't be allocated immediately, but only when it's necessary
@@ -608,6 +608,64 @@ void spdk_bdev_get_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits);
 void spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 				   void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
 
+/**
+ * Create a quality of service group.
+ *
+ * The rate limits of a QoS group are shared by all bdevs added to the group with
+ * spdk_bdev_set_qos_group(), on top of the bdevs' own rate limits. The group is
+ * bound to the calling thread, which refills the group's quota.
+ *
+ * \param name Unique name of the group.
+ * \param limits Pointer to the QoS rate limits array. The limits are ordered based
+ * on the @ref spdk_bdev_qos_rate_limit_type enum and use the same units as
+ * spdk_bdev_set_qos_rate_limits(). At least one limit must be set.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_bdev_qos_group_create(const char *name, uint64_t *limits);
+
+/**
+ * Delete a quality of service group. The group must not have any bdevs.
+ *
+ * \param name Name of the group.
+ *
+ * \return 0 on success, -ENODEV if the group doesn't exist, -EBUSY if it still has bdevs.
+ */
+int spdk_bdev_qos_group_delete(const char *name);
+
+/**
+ * Add a bdev to a quality of service group, or remove it from its current group.
+ *
+ * The bdev's I/O counts against the group's rate limits, except for the I/O
+ * within the minimum rates guaranteed to the bdev, which is allowed even if
+ * the rest of the group has used up the group's limits. The guaranteed rates
+ * are taken out of the group's limits.
+ *
+ * \param bdev Block device.
+ * \param group_name Name of the group, or NULL to remove the bdev from its group.
+ * \param min_limits Pointer to the guaranteed rates array, ordered based on the
+ * @ref spdk_bdev_qos_rate_limit_type enum. Only the rates of the types that the
+ * group limits are used. May be NULL if no rates are guaranteed.
+ * \param cb_fn Callback function to be called when the group has been updated.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_set_qos_group(struct spdk_bdev *bdev, const char *group_name, uint64_t *min_limits,
+			     void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
+
+/**
+ * Set the average I/O latency that quality of service keeps a bdev under.
+ *
+ * While the average latency of the I/O submitted to the bdev is above the
+ * target, the bdev's rate limits are scaled down, but never below the rates
+ * guaranteed within its QoS group. QoS must already be enabled on the bdev.
+ *
+ * \param bdev Block device.
+ * \param latency_us Latency target in microseconds, 0 to disable it.
+ *
+ * \return 0 on success, -EINVAL if QoS isn't enabled on the bdev.
+ */
+int spdk_bdev_set_qos_latency_target(struct spdk_bdev *bdev, uint64_t latency_us);
+
 /**
  * Get minimum I/O buffer address alignment for a bdev.
  *
@@ -721,6 +721,9 @@ struct spdk_bdev {
 		/** accumulated I/O statistics for previously deleted channels of this bdev */
 		struct spdk_bdev_io_stat *stat;
 
+		/** I/O statistics of the existing channels of this bdev */
+		TAILQ_HEAD(, spdk_bdev_channel_stat) channel_stats;
+
 		/** true if tracking the queue_depth of a device is in progress */
 		bool	qd_poll_in_progress;
 
@@ -780,9 +783,6 @@ struct spdk_bdev_io {
 	/** A single iovec element for use by this bdev_io. */
 	struct iovec iov;
 
-	/** Array of iovecs used for I/O splitting. */
-	struct iovec child_iov[SPDK_BDEV_IO_NUM_CHILD_IOV];
-
 	union {
 		struct {
 			/** For SG buffer cases, array of iovecs to transfer. */
@@ -929,6 +929,9 @@ struct spdk_bdev_io {
 		/** Current tsc at submit time. Used to calculate latency at completion. */
 		uint64_t submit_tsc;
 
+		/** Current tsc when QoS let the I/O through, if the bdev has a latency target. */
+		uint64_t qos_submit_tsc;
+
 		/** Error information from a device */
 		union {
 			struct {
@@ -974,25 +977,18 @@ struct spdk_bdev_io {
 		/** Indicates that the IO is associated with an accel sequence */
 		bool has_accel_sequence;
 
+		/** Indicates that the IO uses a memory domain passed by the user in ext API */
+		bool has_memory_domain;
+
+		/** Indicates that the IO is double buffered using bounce_iov */
+		bool has_bounce_buf;
+
 		/** bdev allocated memory associated with this request */
 		void *buf;
 
 		/** requested size of the buffer associated with this I/O */
 		uint64_t buf_len;
 
-		/** if the request is double buffered, store original request iovs here */
-		struct iovec  bounce_iov;
-		struct iovec  bounce_md_iov;
-		struct iovec  orig_md_iov;
-		struct iovec *orig_iovs;
-		int           orig_iovcnt;
-
-		/** Callback for when the aux buf is allocated */
-		spdk_bdev_io_get_aux_buf_cb get_aux_buf_cb;
-
-		/** Callback for when buf is allocated */
-		spdk_bdev_io_get_buf_cb get_buf_cb;
-
 		/**
 		 * Queue entry used in several cases:
 		 *  1. IOs awaiting retry due to NOMEM status,
@@ -1009,6 +1005,27 @@ struct spdk_bdev_io {
 		/** Entry to the list io_submitted of struct spdk_bdev_channel */
 		TAILQ_ENTRY(spdk_bdev_io) ch_link;
 
+		/*
+		 * The fields above are touched by every I/O.  The ones below are only used
+		 * when the I/O is double buffered, waits for a buffer, or uses a memory
+		 * domain or an accel sequence, so they're kept on separate cache lines and
+		 * aren't reset each time the bdev_io is reused.  They're only valid if the
+		 * matching flag above is set or the feature using them has set them up.
+		 */
+
+		/** if the request is double buffered, store original request iovs here */
+		struct iovec  bounce_iov;
+		struct iovec  bounce_md_iov;
+		struct iovec  orig_md_iov;
+		struct iovec *orig_iovs;
+		int           orig_iovcnt;
+
+		/** Callback for when the aux buf is allocated */
+		spdk_bdev_io_get_aux_buf_cb get_aux_buf_cb;
+
+		/** Callback for when buf is allocated */
+		spdk_bdev_io_get_buf_cb get_buf_cb;
+
 		/** iobuf queue entry */
 		struct spdk_iobuf_entry iobuf;
 
@@ -1026,6 +1043,9 @@ struct spdk_bdev_io {
 		void (*data_transfer_cpl)(void *ctx, int rc);
 	} internal;
 
+	/** Array of iovecs used for I/O splitting. */
+	struct iovec child_iov[SPDK_BDEV_IO_NUM_CHILD_IOV];
+
 	/**
 	 * Per I/O context for use by the bdev module.
 	 */
@@ -1417,12 +1437,48 @@ struct spdk_bdev_part {
 
 		/* number of blocks from the start of the base bdev to the start of this part */
 		uint64_t			offset_blocks;
+
+		/* Share of the base bdev queue slots given to this part when they are all used */
+		uint32_t			weight;
+
+		/* Statistics of the I/Os that waited for a base bdev queue slot */
+		struct {
+			uint64_t		queued_ios;
+			uint64_t		queued_ticks;
+			uint64_t		max_queued_ticks;
+		} stat;
 	} internal;
 };
 
+/** Default weight of a part, see spdk_bdev_part_set_weight(). */
+#define SPDK_BDEV_PART_DEFAULT_WEIGHT	1
+
+/** Maximum weight of a part, see spdk_bdev_part_set_weight(). */
+#define SPDK_BDEV_PART_MAX_WEIGHT	1024
+
 struct spdk_bdev_part_channel {
 	struct spdk_bdev_part		*part;
 	struct spdk_io_channel		*base_ch;
+
+	/**
+	 * Fields that are used internally by part.c to share the queue slots of the
+	 * base bdev between the parts. They should not be accessed by the modules.
+	 */
+	struct bdev_part_channel_internal_fields {
+		/* Channel shared by the parts of the same base on this thread */
+		struct spdk_io_channel				*part_base_ch;
+
+		/* I/Os waiting for a base bdev queue slot, linked by their module_link */
+		TAILQ_HEAD(, spdk_bdev_io)			queued_io;
+
+		/* Entry in the list of the channels with queued I/Os of the part base channel */
+		TAILQ_ENTRY(spdk_bdev_part_channel)		link;
+
+		/* Number of queued I/Os this channel may still submit in the current round */
+		uint32_t					credits;
+
+		bool						active;
+	} internal;
 };
 
 typedef TAILQ_HEAD(bdev_part_tailq, spdk_bdev_part)	SPDK_BDEV_PART_TAILQ;
@@ -1567,6 +1623,47 @@ int spdk_bdev_part_submit_request_ext(struct spdk_bdev_part_channel *ch,
 				      struct spdk_bdev_io *bdev_io,
 				      spdk_bdev_io_completion_cb cb);
 
+/**
+ * Set the number of I/Os each thread may submit to the base bdev of a part base at the
+ * same time, for all its parts. Once they are all submitted, the I/Os of the parts wait in
+ * the part layer and are submitted as the base bdev completes I/Os, in proportion to the
+ * weight of the parts. 0, the default, doesn't limit the I/Os submitted to the base bdev.
+ *
+ * \param part_base A pointer to an spdk_bdev_part_base object.
+ * \param queue_depth Number of I/Os each thread may submit to the base bdev.
+ */
+void spdk_bdev_part_base_set_queue_depth(struct spdk_bdev_part_base *part_base,
+					 uint32_t queue_depth);
+
+/**
+ * Return the number of I/Os each thread may submit to the base bdev of a part base.
+ *
+ * \param part_base A pointer to an spdk_bdev_part_base object.
+ *
+ * \return The queue depth of the part base, 0 if it is not limited.
+ */
+uint32_t spdk_bdev_part_base_get_queue_depth(struct spdk_bdev_part_base *part_base);
+
+/**
+ * Set the weight of a part. When the queue depth of its part base is reached, each part
+ * waiting for a base bdev queue slot gets a share of the slots proportional to its weight.
+ *
+ * \param part An spdk_bdev_part object.
+ * \param weight Weight of the part, from 1 to SPDK_BDEV_PART_MAX_WEIGHT.
+ *
+ * \return 0 on success, -EINVAL if the weight is out of range.
+ */
+int spdk_bdev_part_set_weight(struct spdk_bdev_part *part, uint32_t weight);
+
+/**
+ * Return the weight of a part.
+ *
+ * \param part An spdk_bdev_part object.
+ *
+ * \return The weight of the part.
+ */
+uint32_t spdk_bdev_part_get_weight(struct spdk_bdev_part *part);
+
 /**
  * Return a pointer to this part's spdk_bdev.
  *
@@ -15,6 +15,8 @@
 #include "spdk/queue.h"
 #include "spdk/json.h"
 #include "spdk/assert.h"
+#include "spdk/thread.h"
+#include "spdk/histogram_data.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -188,6 +190,25 @@ struct spdk_sock_impl_opts {
 	 * example: "TLS_AES_256_GCM_SHA384:TLS_AES_128_GCM_SHA256"
 	 */
 	const char *tls_cipher_suites;
+
+	/**
+	 * Time in microseconds for which requests queued to a socket of a sock group may wait
+	 * to be sent together with requests queued later. 0 disables batching, i.e. queued
+	 * requests are sent on each poll of the group. Used by posix socket module.
+	 */
+	uint32_t flush_batch_timeout;
+
+	/**
+	 * Number of iovecs queued to a socket which causes the batch to be sent before
+	 * flush_batch_timeout expires. Used by posix socket module.
+	 */
+	uint32_t flush_batch_iovcnt_threshold;
+
+	/**
+	 * Number of bytes queued to a socket which causes the batch to be sent before
+	 * flush_batch_timeout expires. Used by posix socket module.
+	 */
+	uint32_t flush_batch_bytes_threshold;
 };
 
 /**
@@ -214,8 +235,15 @@ struct spdk_sock_opts {
 	 */
 	bool zcopy;
 
-	/* Hole at bytes 13-15. */
-	uint8_t reserved13[3];
+	/**
+	 * Set SO_REUSEPORT on a listening socket, so that several listening sockets can
+	 * bind the same address and port and the kernel spreads incoming connections
+	 * among them. Default is false.
+	 */
+	bool reuseport;
+
+	/* Hole at bytes 14-15. */
+	uint8_t reserved14[2];
 
 	/**
 	 * Time in msec to wait ack until connection is closed forcefully.
@@ -576,6 +604,50 @@ int spdk_sock_group_poll(struct spdk_sock_group *group);
  */
 int spdk_sock_group_poll_count(struct spdk_sock_group *group, int max_events);
 
+/**
+ * Register an interrupt for the sock group on the current thread, so that the group is
+ * polled on events instead of continuously, e.g. from the callback passed to
+ * spdk_poller_register_interrupt().
+ *
+ * fn is called when any socket of the group has events, and it is expected to call
+ * spdk_sock_group_poll(). After a poll finds events, or a request is queued to a socket
+ * of the group, fn is called back-to-back as if busy polled until no events are found
+ * for busy_poll_us, and then the group waits for events again. If a sock implementation
+ * does not support interrupts, the group is always busy polled.
+ *
+ * \param group Group to register the interrupt for.
+ * \param busy_poll_us Time in microseconds to keep busy polling after the last event.
+ * \param fn Function called to poll the group.
+ * \param arg Argument passed to fn.
+ * \param name Name of the interrupt.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_sock_group_register_interrupt(struct spdk_sock_group *group, uint32_t busy_poll_us,
+				       spdk_interrupt_fn fn, void *arg, const char *name);
+
+/**
+ * Unregister the interrupt of the sock group registered by
+ * spdk_sock_group_register_interrupt().
+ *
+ * \param group Group to unregister the interrupt for.
+ */
+void spdk_sock_group_unregister_interrupt(struct spdk_sock_group *group);
+
+/**
+ * Get the histogram of the number of bytes sent by each flush of the sockets of the group.
+ *
+ * Each send of the requests queued to a socket is counted once. The histogram can be used
+ * to tune the flush_batch_* options of the sock implementation. It must be accessed from
+ * the thread which polls the group.
+ *
+ * \param group Sock group.
+ *
+ * \return the histogram.
+ */
+const struct spdk_histogram_data *spdk_sock_group_get_flush_histogram(
+	struct spdk_sock_group *group);
+
 /**
  * Close all registered sockets of the group and then remove the group.
  *
@@ -982,6 +982,102 @@ void spdk_spin_unlock(struct spdk_spinlock *sspin);
  */
 bool spdk_spin_held(struct spdk_spinlock *sspin);
 
+/**
+ * A stackful coroutine bound to an SPDK thread.
+ *
+ * Coroutines allow slow-path code that is normally written as a chain of callbacks to be written
+ * linearly instead. A coroutine runs on the SPDK thread that created it and can suspend itself
+ * with spdk_coroutine_yield() while an asynchronous operation is in progress. The completion
+ * callback of that operation then resumes the coroutine with spdk_coroutine_wake(). Local
+ * variables stay valid across the yield, so no context has to be allocated for the operation.
+ *
+ * Coroutines are cooperative: they never run concurrently with other code on their thread and
+ * they only give up the CPU at spdk_coroutine_yield(). The same rules as for pollers and messages
+ * apply, i.e. an spdk_spinlock must not be held across spdk_coroutine_yield(). Since an SPDK
+ * thread may be moved to another pthread while one of its coroutines is suspended, code running
+ * in a coroutine must not cache pointers to thread-local variables across a yield.
+ *
+ * An SPDK thread doesn't finish exiting until all coroutines created on it have returned.
+ */
+struct spdk_coroutine;
+
+/**
+ * Function executed by a coroutine.
+ *
+ * \param arg Argument passed to spdk_coroutine_create().
+ */
+typedef void (*spdk_coroutine_fn)(void *arg);
+
+/** Default size of a coroutine stack. */
+#define SPDK_COROUTINE_DEFAULT_STACK_SIZE	(64 * 1024)
+
+/**
+ * Create a coroutine on the current SPDK thread.
+ *
+ * The coroutine doesn't start running until it is entered with spdk_coroutine_enter(). It is
+ * released automatically once its function returns. Coroutines using the default stack size are
+ * recycled through a per-thread cache, so creating them doesn't need to allocate memory in the
+ * common case.
+ *
+ * \param fn Function to execute in the coroutine.
+ * \param arg Argument passed to fn.
+ * \param stack_size Size of the coroutine stack in bytes, or 0 to use
+ * SPDK_COROUTINE_DEFAULT_STACK_SIZE.
+ *
+ * \return a pointer to the coroutine on success or NULL on failure.
+ */
+struct spdk_coroutine *spdk_coroutine_create(spdk_coroutine_fn fn, void *arg, size_t stack_size);
+
+/**
+ * Run a coroutine until it yields or returns.
+ *
+ * This must be called from the SPDK thread the coroutine was created on and the coroutine must
+ * either be new or suspended in spdk_coroutine_yield(). Coroutines may enter other coroutines;
+ * a yield always returns control to whoever entered the coroutine last.
+ *
+ * \param co Coroutine to enter.
+ */
+void spdk_coroutine_enter(struct spdk_coroutine *co);
+
+/**
+ * Suspend the current coroutine and return control to the code that entered it.
+ *
+ * The coroutine continues when it is entered or woken up again. If spdk_coroutine_wake() was
+ * already called for this coroutine while it was running (e.g. because an operation completed
+ * synchronously), this function returns immediately.
+ *
+ * This must only be called from within a coroutine.
+ */
+void spdk_coroutine_yield(void);
+
+/**
+ * Wake up a coroutine waiting in spdk_coroutine_yield().
+ *
+ * This is meant to be called from the completion callback of an asynchronous operation started by
+ * the coroutine. If called on the coroutine's own thread, a suspended coroutine is entered
+ * immediately and a running one returns from its next spdk_coroutine_yield() without suspending.
+ * If called from a different thread, the wake up is sent as a message to the coroutine's thread.
+ *
+ * \param co Coroutine to wake up.
+ */
+void spdk_coroutine_wake(struct spdk_coroutine *co);
+
+/**
+ * Get the coroutine that is currently running.
+ *
+ * \return the current coroutine or NULL if not called from within a coroutine.
+ */
+struct spdk_coroutine *spdk_coroutine_self(void);
+
+/**
+ * Get the SPDK thread a coroutine is bound to.
+ *
+ * \param co Coroutine to query.
+ *
+ * \return the SPDK thread the coroutine was created on.
+ */
+struct spdk_thread *spdk_coroutine_get_thread(struct spdk_coroutine *co);
+
 struct spdk_iobuf_opts {
 	/** Maximum number of small buffers */
 	uint64_t small_pool_count;
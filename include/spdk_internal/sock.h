@@ -15,6 +15,7 @@
 #include "spdk/queue.h"
 #include "spdk/likely.h"
 #include "spdk/log.h"
+#include "spdk/histogram_data.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -59,6 +60,15 @@ struct spdk_sock_group {
 	STAILQ_HEAD(, spdk_sock_group_impl)	group_impls;
 	STAILQ_HEAD(, spdk_sock_group_provided_buf) pool;
 	void					*ctx;
+	struct spdk_histogram_data		*flush_histogram;
+
+	/* Kept readable by busy_efd while the group is busy polled in interrupt mode. */
+	struct spdk_interrupt			*busy_intr;
+	int					busy_efd;
+	bool					busy;
+	bool					always_busy;
+	uint64_t				busy_poll_ticks;
+	uint64_t				last_busy_tsc;
 };
 
 struct spdk_sock_group_impl {
@@ -66,6 +76,7 @@ struct spdk_sock_group_impl {
 	struct spdk_sock_group			*group;
 	TAILQ_HEAD(, spdk_sock)			socks;
 	STAILQ_ENTRY(spdk_sock_group_impl)	link;
+	struct spdk_interrupt			*intr;
 };
 
 struct spdk_sock_map {
@@ -109,6 +120,11 @@ struct spdk_net_impl {
 			       struct spdk_sock **socks);
 	int (*group_impl_close)(struct spdk_sock_group_impl *group);
 
+	/* Return a file descriptor which is readable while the group has events, or
+	 * negative errno if interrupts are not supported. Optional.
+	 */
+	int (*group_impl_get_interrupt_fd)(struct spdk_sock_group_impl *group);
+
 	int (*get_opts)(struct spdk_sock_impl_opts *opts, size_t *len);
 	int (*set_opts)(const struct spdk_sock_impl_opts *opts, size_t len);
 
@@ -125,6 +141,15 @@ static void __attribute__((constructor)) net_impl_register_##name(void) \
 
 size_t spdk_sock_group_get_buf(struct spdk_sock_group *group, void **buf, void **ctx);
 
+/* Record the number of bytes sent by a flush of the socket. */
+static inline void
+spdk_sock_tally_flush(struct spdk_sock *sock, size_t bytes)
+{
+	if (sock->group_impl != NULL) {
+		spdk_histogram_data_tally(sock->group_impl->group->flush_histogram, bytes);
+	}
+}
+
 static inline void
 spdk_sock_request_queue(struct spdk_sock *sock, struct spdk_sock_request *req)
 {
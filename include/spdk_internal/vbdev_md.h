@@ -0,0 +1,175 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * Metadata of a virtual bdev, kept in memory and written to a base bdev one metadata block at
+ * a time. It is owned by a single thread, which is the only one to update it and to call these
+ * functions.
+ */
+
+#ifndef SPDK_INTERNAL_VBDEV_MD_H
+#define SPDK_INTERNAL_VBDEV_MD_H
+
+#include "spdk/stdinc.h"
+#include "spdk/bdev.h"
+#include "spdk/log.h"
+#include "spdk/queue.h"
+
+struct vbdev_md_waiter {
+	void (*cb_fn)(struct vbdev_md_waiter *waiter, int status);
+	void					*ctx;
+	TAILQ_ENTRY(vbdev_md_waiter)		link;
+};
+
+struct vbdev_md_writer;
+
+/* Writes of a metadata block are serialized, the ones requested during a write are batched */
+struct vbdev_md_block {
+	struct vbdev_md_writer			*writer;
+	uint64_t				idx;
+	bool					writing;
+	/* Waiting for the write in progress */
+	TAILQ_HEAD(, vbdev_md_waiter)		waiters;
+	/* Waiting for the next write, their update may not be in the one in progress */
+	TAILQ_HEAD(, vbdev_md_waiter)		next_waiters;
+	struct spdk_bdev_io_wait_entry		bdev_io_wait;
+};
+
+struct vbdev_md_writer {
+	/* Name of the virtual bdev, for the error messages */
+	const char				*name;
+	struct spdk_bdev_desc			*desc;
+	/* Channel of the thread owning the metadata */
+	struct spdk_io_channel			*ch;
+	/* Image of the metadata on the base bdev */
+	void					*buf;
+	/* Size of a metadata block, in bytes and in blocks of the base bdev */
+	uint32_t				block_size;
+	uint32_t				base_blocks;
+	/* Offset of the first metadata block, in blocks of the base bdev */
+	uint64_t				offset_blocks;
+	struct vbdev_md_block			*blocks;
+	uint64_t				num_blocks;
+	/* Number of metadata blocks being written */
+	uint32_t				num_writes;
+};
+
+/* Allocate the metadata blocks, the other fields of the writer are set by its user */
+static inline int
+vbdev_md_writer_init(struct vbdev_md_writer *writer, uint64_t num_blocks)
+{
+	uint64_t i;
+
+	writer->blocks = calloc(num_blocks, sizeof(*writer->blocks));
+	if (writer->blocks == NULL) {
+		return -ENOMEM;
+	}
+
+	writer->num_blocks = num_blocks;
+	for (i = 0; i < num_blocks; i++) {
+		writer->blocks[i].writer = writer;
+		writer->blocks[i].idx = i;
+		TAILQ_INIT(&writer->blocks[i].waiters);
+		TAILQ_INIT(&writer->blocks[i].next_waiters);
+	}
+
+	return 0;
+}
+
+static inline void
+vbdev_md_writer_fini(struct vbdev_md_writer *writer)
+{
+	assert(writer->num_writes == 0);
+	free(writer->blocks);
+	writer->blocks = NULL;
+	writer->num_blocks = 0;
+}
+
+static inline void vbdev_md_block_write(struct vbdev_md_block *block);
+
+static inline void
+vbdev_md_block_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_md_block *block = cb_arg;
+	struct vbdev_md_writer *writer = block->writer;
+	TAILQ_HEAD(, vbdev_md_waiter) waiters = TAILQ_HEAD_INITIALIZER(waiters);
+	struct vbdev_md_waiter *waiter;
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to write metadata block %" PRIu64 " of %s\n", block->idx,
+			    writer->name);
+	}
+
+	TAILQ_CONCAT(&waiters, &block->waiters, link);
+	block->writing = false;
+	writer->num_writes--;
+
+	if (!TAILQ_EMPTY(&block->next_waiters)) {
+		vbdev_md_block_write(block);
+	}
+
+	while ((waiter = TAILQ_FIRST(&waiters))) {
+		TAILQ_REMOVE(&waiters, waiter, link);
+		waiter->cb_fn(waiter, success ? 0 : -EIO);
+	}
+}
+
+static inline void
+_vbdev_md_block_write(void *arg)
+{
+	struct vbdev_md_block *block = arg;
+	struct vbdev_md_writer *writer = block->writer;
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(writer->desc);
+	int rc;
+
+	rc = spdk_bdev_write_blocks(writer->desc, writer->ch,
+				    (char *)writer->buf + block->idx * writer->block_size,
+				    writer->offset_blocks + block->idx * writer->base_blocks,
+				    writer->base_blocks, vbdev_md_block_write_done, block);
+	if (rc == -ENOMEM) {
+		block->bdev_io_wait.bdev = bdev;
+		block->bdev_io_wait.cb_fn = _vbdev_md_block_write;
+		block->bdev_io_wait.cb_arg = block;
+		rc = spdk_bdev_queue_io_wait(bdev, writer->ch, &block->bdev_io_wait);
+	}
+	if (rc != 0) {
+		vbdev_md_block_write_done(NULL, false, block);
+	}
+}
+
+static inline void
+vbdev_md_block_write(struct vbdev_md_block *block)
+{
+	assert(!block->writing);
+	block->writing = true;
+	block->writer->num_writes++;
+	TAILQ_CONCAT(&block->waiters, &block->next_waiters, link);
+	_vbdev_md_block_write(block);
+}
+
+/*
+ * Write a metadata block, after it has been updated. cb_fn is called once a write started
+ * after this call has completed.
+ */
+static inline void
+vbdev_md_persist(struct vbdev_md_writer *writer, uint64_t idx, struct vbdev_md_waiter *waiter,
+		 void (*cb_fn)(struct vbdev_md_waiter *waiter, int status), void *ctx)
+{
+	struct vbdev_md_block *block = &writer->blocks[idx];
+
+	assert(idx < writer->num_blocks);
+	waiter->cb_fn = cb_fn;
+	waiter->ctx = ctx;
+	TAILQ_INSERT_TAIL(&block->next_waiters, waiter, link);
+	if (!block->writing) {
+		vbdev_md_block_write(block);
+	}
+}
+
+#endif /* SPDK_INTERNAL_VBDEV_MD_H */
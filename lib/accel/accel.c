@@ -1949,6 +1949,40 @@ spdk_accel_sequence_abort(struct spdk_accel_sequence *seq)
 	accel_sequence_put(seq);
 }
 
+int
+spdk_accel_digest_crc32c(struct spdk_io_channel *ch, uint32_t *crc_dst,
+			 struct iovec *iovs, uint32_t iovcnt,
+			 struct spdk_accel_digest_stats *stats,
+			 spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct spdk_accel_sequence *seq = NULL;
+	int rc;
+
+	if (spdk_unlikely(iovs == NULL || iovcnt == 0)) {
+		return -EINVAL;
+	}
+
+	if (ch != NULL) {
+		rc = spdk_accel_append_crc32c(&seq, ch, crc_dst, iovs, iovcnt,
+					      NULL, NULL, 0, NULL, NULL);
+		if (spdk_likely(rc == 0)) {
+			if (stats != NULL) {
+				stats->offloaded++;
+			}
+			spdk_accel_sequence_finish(seq, cb_fn, cb_arg);
+			return 0;
+		}
+	}
+
+	*crc_dst = spdk_crc32c_iov_update(iovs, iovcnt, ~0u);
+	if (stats != NULL) {
+		stats->inlined++;
+	}
+	cb_fn(cb_arg, 0);
+
+	return 0;
+}
+
 struct spdk_memory_domain *
 spdk_accel_get_memory_domain(void)
 {
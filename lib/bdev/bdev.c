@@ -37,6 +37,10 @@ int __itt_init_ittlib(const char *, __itt_group_id);
 
 #define SPDK_BDEV_IO_POOL_SIZE			(64 * 1024 - 1)
 #define SPDK_BDEV_IO_CACHE_SIZE			256
+/* Smallest size a per-thread bdev_io cache is shrunk to when its queue depth is low. */
+#define SPDK_BDEV_IO_CACHE_MIN_SIZE		16
+/* Number of bdev_io freed on a thread before its cache size is adjusted. */
+#define SPDK_BDEV_IO_CACHE_WINDOW		1024
 #define SPDK_BDEV_AUTO_EXAMINE			true
 #define BUF_SMALL_POOL_SIZE			8191
 #define BUF_LARGE_POOL_SIZE			1023
@@ -50,6 +54,11 @@ int __itt_init_ittlib(const char *, __itt_group_id);
 #define SPDK_BDEV_QOS_MIN_IOS_PER_SEC		1000
 #define SPDK_BDEV_QOS_MIN_BYTES_PER_SEC		(1024 * 1024)
 #define SPDK_BDEV_QOS_LIMIT_NOT_DEFINED		UINT64_MAX
+/* All channels together cache at most 1/32 of a limit's timeslice quota. */
+#define SPDK_BDEV_QOS_QUOTA_BATCH_SHIFT		5
+/* Scale applied to the rate limits of a bdev with a latency target, in 1/1024 units. */
+#define SPDK_BDEV_QOS_RATE_SCALE_MAX		1024
+#define SPDK_BDEV_QOS_RATE_SCALE_STEP		(SPDK_BDEV_QOS_RATE_SCALE_MAX / 32)
 #define SPDK_BDEV_IO_POLL_INTERVAL_IN_MSEC	1000
 
 /* The maximum number of children requests for a UNMAP or WRITE ZEROES command
@@ -108,6 +117,8 @@ struct spdk_bdev_mgr {
 
 	TAILQ_HEAD(, spdk_bdev_open_async_ctx) async_bdev_opens;
 
+	TAILQ_HEAD(, spdk_bdev_qos_group) qos_groups;
+
 #ifdef SPDK_CONFIG_VTUNE
 	__itt_domain	*domain;
 #endif
@@ -120,6 +131,7 @@ static struct spdk_bdev_mgr g_bdev_mgr = {
 	.init_complete = false,
 	.module_init_complete = false,
 	.async_bdev_opens = TAILQ_HEAD_INITIALIZER(g_bdev_mgr.async_bdev_opens),
+	.qos_groups = TAILQ_HEAD_INITIALIZER(g_bdev_mgr.qos_groups),
 };
 
 static void
@@ -159,6 +171,15 @@ static spdk_bdev_fini_cb	g_fini_cb_fn = NULL;
 static void			*g_fini_cb_arg = NULL;
 static struct spdk_thread	*g_fini_thread = NULL;
 
+/** Part of a rate limit's quota that a channel took and has not used yet. */
+struct bdev_qos_quota {
+	/** IOs or bytes this channel may still issue without touching the shared quota. */
+	int64_t remaining;
+
+	/** Start of the timeslice the quota was taken in. It expires with that timeslice. */
+	uint64_t timeslice;
+};
+
 struct spdk_bdev_qos_limit {
 	/** IOs or bytes allowed per second (i.e., 1s). */
 	uint64_t limit;
@@ -170,27 +191,82 @@ struct spdk_bdev_qos_limit {
 	 */
 	int64_t remaining_this_timeslice;
 
+	/** Start of the current timeslice. */
+	uint64_t timeslice;
+
 	/** Minimum allowed IOs or bytes to be issued in one timeslice (e.g., 1ms). */
 	uint32_t min_per_timeslice;
 
 	/** Maximum allowed IOs or bytes to be issued in one timeslice (e.g., 1ms). */
 	uint32_t max_per_timeslice;
 
+	/** IOs or bytes a channel takes from remaining_this_timeslice beyond what it needs. */
+	uint32_t quota_batch;
+
+	/** Number of channels that took quota from remaining_this_timeslice in this timeslice. */
+	uint32_t active_channels;
+
 	/** Function to check whether to queue the IO.
 	 * If The IO is allowed to pass, the quota will be reduced correspondingly.
 	 */
-	bool (*queue_io)(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io);
+	bool (*queue_io)(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			 struct spdk_bdev_io *io);
 
 	/** Function to rewind the quota once the IO was allowed to be sent by this
 	 * limit but queued due to one of the further limits.
 	 */
-	void (*rewind_quota)(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io);
+	void (*rewind_quota)(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			     struct spdk_bdev_io *io);
+};
+
+struct spdk_bdev_qos_group {
+	/** Unique name of the group. */
+	char *name;
+
+	/** Rate limits shared by all bdevs in the group. */
+	struct spdk_bdev_qos_limit rate_limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+
+	/** Sum of the minimum rates guaranteed to the bdevs in the group, per second. */
+	uint64_t reserved[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+
+	/** Number of bdevs in the group. Protected by g_bdev_mgr.spinlock. */
+	uint32_t num_bdevs;
+
+	/** The thread on which the poller is running. */
+	struct spdk_thread *thread;
+
+	/** Size of a timeslice in tsc ticks. */
+	uint64_t timeslice_size;
+
+	/** Timestamp of start of last timeslice. */
+	uint64_t last_timeslice;
+
+	/** Poller that refills the group quota each time slice. */
+	struct spdk_poller *poller;
+
+	TAILQ_ENTRY(spdk_bdev_qos_group) link;
 };
 
 struct spdk_bdev_qos {
 	/** Types of structure of rate limits. */
 	struct spdk_bdev_qos_limit rate_limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
 
+	/** Rates guaranteed to this bdev within its QoS group, even if the group is out of quota. */
+	struct spdk_bdev_qos_limit min_limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+
+	/** QoS group the bdev belongs to, if any. */
+	struct spdk_bdev_qos_group *group;
+
+	/** Target average latency in microseconds, 0 if not set. */
+	uint64_t latency_target_us;
+
+	/** Scale applied to rate_limits to keep the latency under the target. */
+	uint32_t rate_scale;
+
+	/** Latency of I/O reported by the channels since the last timeslice. */
+	uint64_t latency_ticks;
+	uint64_t latency_ios;
+
 	/** The channel that all I/O are funneled through. */
 	struct spdk_bdev_channel *ch;
 
@@ -219,6 +295,16 @@ struct spdk_bdev_mgmt_channel {
 	uint32_t	per_thread_cache_count;
 	uint32_t	bdev_io_cache_size;
 
+	/*
+	 * The cache is sized by the number of bdev_io this thread actually keeps
+	 *  outstanding, so that threads with a low queue depth give the rest back to
+	 *  the global pool.  bdev_io_cache_size is recalculated from the highest
+	 *  io_outstanding seen every SPDK_BDEV_IO_CACHE_WINDOW frees.
+	 */
+	uint32_t	io_outstanding;
+	uint32_t	io_outstanding_max;
+	uint32_t	cache_window_ios;
+
 	struct spdk_iobuf_channel iobuf;
 
 	TAILQ_HEAD(, spdk_bdev_shared_resource)	shared_resources;
@@ -265,6 +351,19 @@ struct spdk_bdev_shared_resource {
 #define BDEV_CH_RESET_IN_PROGRESS	(1 << 0)
 #define BDEV_CH_QOS_ENABLED		(1 << 1)
 
+/*
+ * I/O statistics of a channel. They are only updated by the thread owning the
+ * channel, but other threads read them directly instead of sending a message
+ * to that thread. A reader retries if the sequence count shows that it raced
+ * with an update.
+ */
+struct spdk_bdev_channel_stat {
+	/* Odd while the statistics are being updated. */
+	uint64_t				seq;
+	struct spdk_bdev_io_stat		stat;
+	TAILQ_ENTRY(spdk_bdev_channel_stat)	link;
+} __attribute__((aligned(SPDK_CACHE_LINE_SIZE)));
+
 struct spdk_bdev_channel {
 	struct spdk_bdev	*bdev;
 
@@ -277,7 +376,7 @@ struct spdk_bdev_channel {
 	/* Per io_device per thread data */
 	struct spdk_bdev_shared_resource *shared_resource;
 
-	struct spdk_bdev_io_stat *stat;
+	struct spdk_bdev_channel_stat *stat;
 
 	/*
 	 * Count of I/O submitted to the underlying dev module through this channel
@@ -319,6 +418,16 @@ struct spdk_bdev_channel {
 
 	/** List of I/Os queued by QoS. */
 	bdev_io_tailq_t		qos_queued_io;
+
+	/** Quota taken from the bdev's rate limits, its guaranteed rates and its QoS group. */
+	struct bdev_qos_quota	qos_quota[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	struct bdev_qos_quota	qos_min_quota[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	struct bdev_qos_quota	qos_group_quota[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+
+	/** Latency of I/O completed in the timeslice qos_latency_timeslice, not reported yet. */
+	uint64_t		qos_latency_ticks;
+	uint64_t		qos_latency_ios;
+	uint64_t		qos_latency_timeslice;
 };
 
 struct media_event_entry {
@@ -354,6 +463,7 @@ struct spdk_bdev_desc {
 };
 
 struct spdk_bdev_iostat_ctx {
+	struct spdk_bdev *bdev;
 	struct spdk_bdev_io_stat *stat;
 	spdk_bdev_get_device_stat_cb cb;
 	void *cb_arg;
@@ -363,6 +473,8 @@ struct set_qos_limit_ctx {
 	void (*cb_fn)(void *cb_arg, int status);
 	void *cb_arg;
 	struct spdk_bdev *bdev;
+	/* QoS group the bdev left, released once no channel can use it anymore. */
+	struct spdk_bdev_qos_group *put_group;
 };
 
 struct spdk_bdev_channel_iter {
@@ -401,6 +513,8 @@ static int bdev_write_zero_buffer(struct spdk_bdev_io *bdev_io);
 static void bdev_enable_qos_msg(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
 				struct spdk_io_channel *ch, void *_ctx);
 static void bdev_enable_qos_done(struct spdk_bdev *bdev, void *_ctx, int status);
+static void bdev_qos_get_limits(const struct spdk_bdev_qos_limit *qos_limits, uint64_t *limits);
+static void bdev_qos_groups_free(void);
 
 static int bdev_readv_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 				     struct iovec *iov, int iovcnt, void *md_buf, uint64_t offset_blocks,
@@ -906,7 +1020,7 @@ spdk_bdev_next_leaf(struct spdk_bdev *prev)
 static inline bool
 bdev_io_use_memory_domain(struct spdk_bdev_io *bdev_io)
 {
-	return bdev_io->internal.memory_domain;
+	return bdev_io->internal.has_memory_domain;
 }
 
 static inline bool
@@ -1003,7 +1117,7 @@ _are_iovs_aligned(struct iovec *iovs, int iovcnt, uint32_t alignment)
 static inline bool
 bdev_io_needs_sequence_exec(struct spdk_bdev_desc *desc, struct spdk_bdev_io *bdev_io)
 {
-	if (!bdev_io->internal.accel_sequence) {
+	if (!bdev_io_use_accel_sequence(bdev_io) || !bdev_io->internal.accel_sequence) {
 		return false;
 	}
 
@@ -1249,6 +1363,8 @@ static void
 bdev_io_pull_data(struct spdk_bdev_io *bdev_io)
 {
 	struct spdk_bdev_channel *ch = bdev_io->internal.ch;
+	struct spdk_memory_domain *domain = NULL;
+	void *domain_ctx = NULL;
 	int rc = 0;
 
 	/* If we need to exec an accel sequence or the IO uses a memory domain buffer and has a
@@ -1256,23 +1372,26 @@ bdev_io_pull_data(struct spdk_bdev_io *bdev_io)
 	 * operation */
 	if (bdev_io_needs_sequence_exec(bdev_io->internal.desc, bdev_io) ||
 	    (bdev_io_use_accel_sequence(bdev_io) && bdev_io_use_memory_domain(bdev_io))) {
+		/* The memory domain fields are cold and may be left over from a previous user of
+		 * this bdev_io, so only trust them if the flag says they're valid */
+		if (bdev_io_use_memory_domain(bdev_io)) {
+			domain = bdev_io->internal.memory_domain;
+			domain_ctx = bdev_io->internal.memory_domain_ctx;
+		}
 		if (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE) {
 			rc = spdk_accel_append_copy(&bdev_io->internal.accel_sequence, ch->accel_channel,
 						    bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
 						    NULL, NULL,
 						    bdev_io->internal.orig_iovs,
 						    bdev_io->internal.orig_iovcnt,
-						    bdev_io->internal.memory_domain,
-						    bdev_io->internal.memory_domain_ctx,
-						    0, NULL, NULL);
+						    domain, domain_ctx, 0, NULL, NULL);
 		} else {
 			/* We need to reverse the src/dst for reads */
 			assert(bdev_io->type == SPDK_BDEV_IO_TYPE_READ);
 			rc = spdk_accel_append_copy(&bdev_io->internal.accel_sequence, ch->accel_channel,
 						    bdev_io->internal.orig_iovs,
 						    bdev_io->internal.orig_iovcnt,
-						    bdev_io->internal.memory_domain,
-						    bdev_io->internal.memory_domain_ctx,
+						    domain, domain_ctx,
 						    bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
 						    NULL, NULL, 0, NULL, NULL);
 		}
@@ -1330,6 +1449,8 @@ _bdev_io_pull_bounce_data_buf(struct spdk_bdev_io *bdev_io, void *buf, size_t le
 	/* save original iovec */
 	bdev_io->internal.orig_iovs = bdev_io->u.bdev.iovs;
 	bdev_io->internal.orig_iovcnt = bdev_io->u.bdev.iovcnt;
+	bdev_io->internal.orig_md_iov.iov_base = NULL;
+	bdev_io->internal.has_bounce_buf = true;
 	/* set bounce iov */
 	bdev_io->u.bdev.iovs = &bdev_io->internal.bounce_iov;
 	bdev_io->u.bdev.iovcnt = 1;
@@ -1659,6 +1780,7 @@ bdev_io_push_bounce_data_done(struct spdk_bdev_io *bdev_io, int rc)
 	/* disable bouncing buffer for this io */
 	bdev_io->internal.orig_iovcnt = 0;
 	bdev_io->internal.orig_iovs = NULL;
+	bdev_io->internal.has_bounce_buf = false;
 
 	bdev_io_push_bounce_md_buf(bdev_io);
 }
@@ -1870,6 +1992,21 @@ bdev_enable_histogram_config_json(struct spdk_bdev *bdev, struct spdk_json_write
 	spdk_json_write_object_end(w);
 }
 
+static void
+bdev_qos_write_limits_json(struct spdk_json_write_ctx *w, const char *prefix,
+			   const uint64_t *limits)
+{
+	char name[32];
+	int i;
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (limits[i] > 0) {
+			snprintf(name, sizeof(name), "%s%s", prefix, qos_rpc_type[i]);
+			spdk_json_write_named_uint64(w, name, limits[i]);
+		}
+	}
+}
+
 static void
 bdev_qos_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 {
@@ -1883,19 +2020,77 @@ bdev_qos_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 
 	spdk_bdev_get_qos_rate_limits(bdev, limits);
 
-	spdk_json_write_object_begin(w);
-	spdk_json_write_named_string(w, "method", "bdev_set_qos_limit");
-
-	spdk_json_write_named_object_begin(w, "params");
-	spdk_json_write_named_string(w, "name", bdev->name);
 	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
 		if (limits[i] > 0) {
-			spdk_json_write_named_uint64(w, qos_rpc_type[i], limits[i]);
+			break;
 		}
 	}
-	spdk_json_write_object_end(w);
 
-	spdk_json_write_object_end(w);
+	if (i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_set_qos_limit");
+
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "name", bdev->name);
+		bdev_qos_write_limits_json(w, "", limits);
+		spdk_json_write_object_end(w);
+
+		spdk_json_write_object_end(w);
+	}
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	if (qos->group != NULL) {
+		memset(limits, 0, sizeof(limits));
+		bdev_qos_get_limits(qos->min_limits, limits);
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_set_qos_group");
+
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "name", bdev->name);
+		spdk_json_write_named_string(w, "group", qos->group->name);
+		bdev_qos_write_limits_json(w, "min_", limits);
+		spdk_json_write_object_end(w);
+
+		spdk_json_write_object_end(w);
+	}
+
+	if (qos->latency_target_us != 0) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_set_qos_latency_target");
+
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "name", bdev->name);
+		spdk_json_write_named_uint64(w, "latency_target_us", qos->latency_target_us);
+		spdk_json_write_object_end(w);
+
+		spdk_json_write_object_end(w);
+	}
+	spdk_spin_unlock(&bdev->internal.spinlock);
+}
+
+static void
+bdev_qos_groups_config_json(struct spdk_json_write_ctx *w)
+{
+	struct spdk_bdev_qos_group *group;
+	uint64_t limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+
+	assert(spdk_spin_held(&g_bdev_mgr.spinlock));
+
+	TAILQ_FOREACH(group, &g_bdev_mgr.qos_groups, link) {
+		memset(limits, 0, sizeof(limits));
+		bdev_qos_get_limits(group->rate_limits, limits);
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_qos_group_create");
+
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "name", group->name);
+		bdev_qos_write_limits_json(w, "", limits);
+		spdk_json_write_object_end(w);
+
+		spdk_json_write_object_end(w);
+	}
 }
 
 void
@@ -1929,12 +2124,15 @@ spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 
 	spdk_spin_lock(&g_bdev_mgr.spinlock);
 
+	bdev_qos_groups_config_json(w);
+
 	TAILQ_FOREACH(bdev, &g_bdev_mgr.bdevs, internal.link) {
 		if (bdev->fn_table->write_config_json) {
 			bdev->fn_table->write_config_json(bdev, w);
 		}
 
 		bdev_qos_config_json(bdev, w);
+		bdev_part_config_json(bdev, w);
 		bdev_enable_histogram_config_json(bdev, w);
 	}
 
@@ -1948,6 +2146,26 @@ spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_array_end(w);
 }
 
+/*
+ * The fields of bdev_io that aren't used by every I/O are only reset when the bdev_io is
+ *  taken from the global pool.  After that, they're either reset by the code using them
+ *  or only read when a flag in the hot part of bdev_io->internal is set, so that
+ *  bdev_io_init() doesn't have to touch their cache lines.
+ */
+static void
+bdev_io_init_cold_fields(struct spdk_bdev_io *bdev_io)
+{
+	bdev_io->internal.orig_iovs = NULL;
+	bdev_io->internal.orig_iovcnt = 0;
+	bdev_io->internal.orig_md_iov.iov_base = NULL;
+	bdev_io->internal.get_buf_cb = NULL;
+	bdev_io->internal.get_aux_buf_cb = NULL;
+	bdev_io->internal.memory_domain = NULL;
+	bdev_io->internal.memory_domain_ctx = NULL;
+	bdev_io->internal.accel_sequence = NULL;
+	bdev_io->internal.data_transfer_cpl = NULL;
+}
+
 static void
 bdev_mgmt_channel_destroy(void *io_device, void *ctx_buf)
 {
@@ -1984,6 +2202,9 @@ bdev_mgmt_channel_create(void *io_device, void *ctx_buf)
 
 	STAILQ_INIT(&ch->per_thread_cache);
 	ch->bdev_io_cache_size = g_bdev_opts.bdev_io_cache_size;
+	ch->io_outstanding = 0;
+	ch->io_outstanding_max = 0;
+	ch->cache_window_ios = 0;
 
 	/* Pre-populate bdev_io cache to ensure this thread cannot be starved. */
 	ch->per_thread_cache_count = 0;
@@ -1995,6 +2216,7 @@ bdev_mgmt_channel_create(void *io_device, void *ctx_buf)
 			bdev_mgmt_channel_destroy(io_device, ctx_buf);
 			return -1;
 		}
+		bdev_io_init_cold_fields(bdev_io);
 		ch->per_thread_cache_count++;
 		STAILQ_INSERT_HEAD(&ch->per_thread_cache, bdev_io, internal.buf_link);
 	}
@@ -2221,6 +2443,7 @@ bdev_mgr_unregister_cb(void *io_device)
 	spdk_free(g_bdev_mgr.zero_buffer);
 
 	bdev_examine_allowlist_free();
+	bdev_qos_groups_free();
 
 	cb_fn(g_fini_cb_arg);
 	g_fini_cb_fn = NULL;
@@ -2444,14 +2667,35 @@ bdev_channel_get_io(struct spdk_bdev_channel *channel)
 		 * Don't try to look for bdev_ios in the global pool if there are
 		 * waiters on bdev_ios - we don't want this caller to jump the line.
 		 */
-		bdev_io = NULL;
+		return NULL;
 	} else {
 		bdev_io = spdk_mempool_get(g_bdev_mgr.bdev_io_pool);
+		if (bdev_io == NULL) {
+			return NULL;
+		}
+		bdev_io_init_cold_fields(bdev_io);
+	}
+
+	ch->io_outstanding++;
+	if (ch->io_outstanding > ch->io_outstanding_max) {
+		ch->io_outstanding_max = ch->io_outstanding;
 	}
 
 	return bdev_io;
 }
 
+static void
+bdev_io_cache_resize(struct spdk_bdev_mgmt_channel *ch)
+{
+	uint32_t size;
+
+	/* Keep twice the highest queue depth seen in the window to absorb bursts. */
+	size = spdk_max(ch->io_outstanding_max * 2, SPDK_BDEV_IO_CACHE_MIN_SIZE);
+	ch->bdev_io_cache_size = spdk_min(size, g_bdev_opts.bdev_io_cache_size);
+	ch->io_outstanding_max = ch->io_outstanding;
+	ch->cache_window_ios = 0;
+}
+
 void
 spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
 {
@@ -2466,6 +2710,12 @@ spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
 		bdev_io_put_buf(bdev_io);
 	}
 
+	assert(ch->io_outstanding > 0);
+	ch->io_outstanding--;
+	if (spdk_unlikely(++ch->cache_window_ios == SPDK_BDEV_IO_CACHE_WINDOW)) {
+		bdev_io_cache_resize(ch);
+	}
+
 	if (ch->per_thread_cache_count < ch->bdev_io_cache_size) {
 		ch->per_thread_cache_count++;
 		STAILQ_INSERT_HEAD(&ch->per_thread_cache, bdev_io, internal.buf_link);
@@ -2572,129 +2822,162 @@ bdev_get_io_size_in_byte(struct spdk_bdev_io *bdev_io)
 }
 
 static inline bool
-bdev_qos_rw_queue_io(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io, uint64_t delta)
+bdev_qos_rw_queue_io(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		     struct spdk_bdev_io *io, uint64_t delta)
 {
-	int64_t remaining_this_timeslice;
+	int64_t remaining_this_timeslice, need, take;
+	uint64_t timeslice;
+	uint32_t batch;
 
 	if (!limit->max_per_timeslice) {
 		/* The QoS is disabled */
 		return false;
 	}
 
-	remaining_this_timeslice = __atomic_sub_fetch(&limit->remaining_this_timeslice, delta,
-				   __ATOMIC_RELAXED);
-	if (remaining_this_timeslice + (int64_t)delta > 0) {
-		/* There was still a quota for this delta -> the IO shouldn't be queued
-		 *
-		 * We allow a slight quota overrun here so an IO bigger than the per-timeslice
-		 * quota can be allowed once a while. Such overrun then taken into account in
-		 * the QoS poller, where the next timeslice quota is calculated.
-		 */
+	timeslice = __atomic_load_n(&limit->timeslice, __ATOMIC_RELAXED);
+	if (spdk_unlikely(quota->timeslice != timeslice)) {
+		/* The quota this channel took in an earlier timeslice has expired. */
+		quota->remaining = 0;
+		quota->timeslice = timeslice;
+		__atomic_add_fetch(&limit->active_channels, 1, __ATOMIC_RELAXED);
+	}
+
+	if (spdk_likely(quota->remaining >= (int64_t)delta)) {
+		quota->remaining -= delta;
 		return false;
 	}
 
-	/* There was no quota for this delta -> the IO should be queued
-	 * The remaining_this_timeslice must be rewinded so it reflects the real
-	 * amount of IOs or bytes allowed.
+	/* Refill the channel's quota from the shared one. Take a batch on top of what
+	 * this IO needs, so that the following IOs don't have to touch the shared
+	 * counter. Whatever is left of the batch at the end of the timeslice is lost,
+	 * so the QoS poller divides the batch among the channels that were active in
+	 * the last timeslice (see bdev_qos_limit_refill()).
 	 */
-	__atomic_add_fetch(
-		&limit->remaining_this_timeslice, delta, __ATOMIC_RELAXED);
-	return true;
+	need = delta - quota->remaining;
+	batch = __atomic_load_n(&limit->quota_batch, __ATOMIC_RELAXED);
+	remaining_this_timeslice = __atomic_load_n(&limit->remaining_this_timeslice, __ATOMIC_RELAXED);
+	do {
+		if (remaining_this_timeslice <= 0) {
+			/* There was no quota for this delta -> the IO should be queued */
+			return true;
+		}
+
+		/* We allow a slight quota overrun here so an IO bigger than the per-timeslice
+		 * quota can be allowed once a while. Such overrun then taken into account in
+		 * the QoS poller, where the next timeslice quota is calculated.
+		 */
+		take = spdk_max(need, spdk_min(remaining_this_timeslice, need + batch));
+	} while (!__atomic_compare_exchange_n(&limit->remaining_this_timeslice,
+					      &remaining_this_timeslice,
+					      remaining_this_timeslice - take, true,
+					      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	quota->remaining += take - delta;
+	return false;
 }
 
 static inline void
-bdev_qos_rw_rewind_io(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io, uint64_t delta)
+bdev_qos_rw_rewind_io(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		      struct spdk_bdev_io *io, uint64_t delta)
 {
-	__atomic_add_fetch(&limit->remaining_this_timeslice, delta, __ATOMIC_RELAXED);
+	quota->remaining += delta;
 }
 
 static bool
-bdev_qos_rw_iops_queue(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_rw_iops_queue(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		       struct spdk_bdev_io *io)
 {
-	return bdev_qos_rw_queue_io(limit, io, 1);
+	return bdev_qos_rw_queue_io(limit, quota, io, 1);
 }
 
 static void
-bdev_qos_rw_iops_rewind_quota(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_rw_iops_rewind_quota(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			      struct spdk_bdev_io *io)
 {
-	bdev_qos_rw_rewind_io(limit, io, 1);
+	bdev_qos_rw_rewind_io(limit, quota, io, 1);
 }
 
 static bool
-bdev_qos_rw_bps_queue(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_rw_bps_queue(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		      struct spdk_bdev_io *io)
 {
-	return bdev_qos_rw_queue_io(limit, io, bdev_get_io_size_in_byte(io));
+	return bdev_qos_rw_queue_io(limit, quota, io, bdev_get_io_size_in_byte(io));
 }
 
 static void
-bdev_qos_rw_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_rw_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			     struct spdk_bdev_io *io)
 {
-	bdev_qos_rw_rewind_io(limit, io, bdev_get_io_size_in_byte(io));
+	bdev_qos_rw_rewind_io(limit, quota, io, bdev_get_io_size_in_byte(io));
 }
 
 static bool
-bdev_qos_r_bps_queue(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_r_bps_queue(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		     struct spdk_bdev_io *io)
 {
 	if (bdev_is_read_io(io) == false) {
 		return false;
 	}
 
-	return bdev_qos_rw_bps_queue(limit, io);
+	return bdev_qos_rw_bps_queue(limit, quota, io);
 }
 
 static void
-bdev_qos_r_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_r_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			    struct spdk_bdev_io *io)
 {
 	if (bdev_is_read_io(io) != false) {
-		bdev_qos_rw_rewind_io(limit, io, bdev_get_io_size_in_byte(io));
+		bdev_qos_rw_rewind_io(limit, quota, io, bdev_get_io_size_in_byte(io));
 	}
 }
 
 static bool
-bdev_qos_w_bps_queue(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_w_bps_queue(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		     struct spdk_bdev_io *io)
 {
 	if (bdev_is_read_io(io) == true) {
 		return false;
 	}
 
-	return bdev_qos_rw_bps_queue(limit, io);
+	return bdev_qos_rw_bps_queue(limit, quota, io);
 }
 
 static void
-bdev_qos_w_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_w_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			    struct spdk_bdev_io *io)
 {
 	if (bdev_is_read_io(io) != true) {
-		bdev_qos_rw_rewind_io(limit, io, bdev_get_io_size_in_byte(io));
+		bdev_qos_rw_rewind_io(limit, quota, io, bdev_get_io_size_in_byte(io));
 	}
 }
 
 static void
-bdev_qos_set_ops(struct spdk_bdev_qos *qos)
+bdev_qos_set_ops(struct spdk_bdev_qos_limit *limits)
 {
 	int i;
 
 	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-		if (qos->rate_limits[i].limit == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
-			qos->rate_limits[i].queue_io = NULL;
+		if (limits[i].limit == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+			limits[i].queue_io = NULL;
 			continue;
 		}
 
 		switch (i) {
 		case SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT:
-			qos->rate_limits[i].queue_io = bdev_qos_rw_iops_queue;
-			qos->rate_limits[i].rewind_quota = bdev_qos_rw_iops_rewind_quota;
+			limits[i].queue_io = bdev_qos_rw_iops_queue;
+			limits[i].rewind_quota = bdev_qos_rw_iops_rewind_quota;
 			break;
 		case SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT:
-			qos->rate_limits[i].queue_io = bdev_qos_rw_bps_queue;
-			qos->rate_limits[i].rewind_quota = bdev_qos_rw_bps_rewind_quota;
+			limits[i].queue_io = bdev_qos_rw_bps_queue;
+			limits[i].rewind_quota = bdev_qos_rw_bps_rewind_quota;
 			break;
 		case SPDK_BDEV_QOS_R_BPS_RATE_LIMIT:
-			qos->rate_limits[i].queue_io = bdev_qos_r_bps_queue;
-			qos->rate_limits[i].rewind_quota = bdev_qos_r_bps_rewind_quota;
+			limits[i].queue_io = bdev_qos_r_bps_queue;
+			limits[i].rewind_quota = bdev_qos_r_bps_rewind_quota;
 			break;
 		case SPDK_BDEV_QOS_W_BPS_RATE_LIMIT:
-			qos->rate_limits[i].queue_io = bdev_qos_w_bps_queue;
-			qos->rate_limits[i].rewind_quota = bdev_qos_w_bps_rewind_quota;
+			limits[i].queue_io = bdev_qos_w_bps_queue;
+			limits[i].rewind_quota = bdev_qos_w_bps_rewind_quota;
 			break;
 		default:
 			break;
@@ -2756,29 +3039,98 @@ bdev_io_do_submit(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_i
 	}
 }
 
+static void
+bdev_qos_limits_rewind(struct spdk_bdev_qos_limit *limits, struct bdev_qos_quota *quotas,
+		       struct spdk_bdev_io *bdev_io, int count)
+{
+	int i;
+
+	for (i = count - 1; i >= 0 ; i--) {
+		if (!limits[i].queue_io) {
+			continue;
+		}
+
+		limits[i].rewind_quota(&limits[i], &quotas[i], bdev_io);
+	}
+}
+
 static bool
-bdev_qos_queue_io(struct spdk_bdev_qos *qos, struct spdk_bdev_io *bdev_io)
+bdev_qos_limits_queue_io(struct spdk_bdev_qos_limit *limits, struct bdev_qos_quota *quotas,
+			 struct spdk_bdev_io *bdev_io)
 {
 	int i;
 
-	if (bdev_qos_io_to_limit(bdev_io) == true) {
-		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-			if (!qos->rate_limits[i].queue_io) {
-				continue;
-			}
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (!limits[i].queue_io) {
+			continue;
+		}
 
-			if (qos->rate_limits[i].queue_io(&qos->rate_limits[i],
-							 bdev_io) == true) {
-				for (i -= 1; i >= 0 ; i--) {
-					if (!qos->rate_limits[i].queue_io) {
-						continue;
-					}
+		if (limits[i].queue_io(&limits[i], &quotas[i], bdev_io) == true) {
+			bdev_qos_limits_rewind(limits, quotas, bdev_io, i);
+			return true;
+		}
+	}
 
-					qos->rate_limits[i].rewind_quota(&qos->rate_limits[i], bdev_io);
+	return false;
+}
+
+static bool
+bdev_qos_group_queue_io(struct spdk_bdev_qos *qos, struct spdk_bdev_qos_group *group,
+			struct spdk_bdev_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_qos_limit *limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES] = {};
+	struct bdev_qos_quota *quotas[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES] = {};
+	int i;
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (!group->rate_limits[i].queue_io) {
+			continue;
+		}
+
+		/* IOs within the rate guaranteed to the bdev don't count against the group */
+		if (qos->min_limits[i].queue_io &&
+		    qos->min_limits[i].queue_io(&qos->min_limits[i], &ch->qos_min_quota[i],
+						bdev_io) == false) {
+			limits[i] = &qos->min_limits[i];
+			quotas[i] = &ch->qos_min_quota[i];
+			continue;
+		}
+
+		if (group->rate_limits[i].queue_io(&group->rate_limits[i], &ch->qos_group_quota[i],
+						   bdev_io) == true) {
+			for (i -= 1; i >= 0; i--) {
+				if (limits[i] != NULL) {
+					limits[i]->rewind_quota(limits[i], quotas[i], bdev_io);
 				}
-				return true;
 			}
+			return true;
 		}
+
+		limits[i] = &group->rate_limits[i];
+		quotas[i] = &ch->qos_group_quota[i];
+	}
+
+	return false;
+}
+
+static bool
+bdev_qos_queue_io(struct spdk_bdev_qos *qos, struct spdk_bdev_channel *ch,
+		  struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_qos_group *group = qos->group;
+
+	if (bdev_qos_io_to_limit(bdev_io) == false) {
+		return false;
+	}
+
+	if (bdev_qos_limits_queue_io(qos->rate_limits, ch->qos_quota, bdev_io)) {
+		return true;
+	}
+
+	if (group != NULL && bdev_qos_group_queue_io(qos, group, ch, bdev_io)) {
+		bdev_qos_limits_rewind(qos->rate_limits, ch->qos_quota, bdev_io,
+				       SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES);
+		return true;
 	}
 
 	return false;
@@ -2791,8 +3143,11 @@ bdev_qos_io_submit(struct spdk_bdev_channel *ch, struct spdk_bdev_qos *qos)
 	int				submitted_ios = 0;
 
 	TAILQ_FOREACH_SAFE(bdev_io, &ch->qos_queued_io, internal.link, tmp) {
-		if (!bdev_qos_queue_io(qos, bdev_io)) {
+		if (!bdev_qos_queue_io(qos, ch, bdev_io)) {
 			TAILQ_REMOVE(&ch->qos_queued_io, bdev_io, internal.link);
+			if (qos->latency_target_us != 0) {
+				bdev_io->internal.qos_submit_tsc = spdk_get_ticks();
+			}
 			bdev_io_do_submit(ch, bdev_io);
 
 			submitted_ios++;
@@ -2979,6 +3334,8 @@ static int
 bdev_io_split_submit(struct spdk_bdev_io *bdev_io, struct iovec *iov, int iovcnt, void *md_buf,
 		     uint64_t num_blocks, uint64_t *offset, uint64_t *remaining)
 {
+	struct spdk_memory_domain *domain = NULL;
+	void *domain_ctx = NULL;
 	int rc;
 	uint64_t current_offset, current_remaining, current_src_offset;
 	spdk_bdev_io_wait_cb io_wait_fn;
@@ -2986,6 +3343,11 @@ bdev_io_split_submit(struct spdk_bdev_io *bdev_io, struct iovec *iov, int iovcnt
 	current_offset = *offset;
 	current_remaining = *remaining;
 
+	if (spdk_unlikely(bdev_io_use_memory_domain(bdev_io))) {
+		domain = bdev_io->internal.memory_domain;
+		domain_ctx = bdev_io->internal.memory_domain_ctx;
+	}
+
 	bdev_io->u.bdev.split_outstanding++;
 
 	io_wait_fn = _bdev_rw_split;
@@ -2995,8 +3357,7 @@ bdev_io_split_submit(struct spdk_bdev_io *bdev_io, struct iovec *iov, int iovcnt
 		rc = bdev_readv_blocks_with_md(bdev_io->internal.desc,
 					       spdk_io_channel_from_ctx(bdev_io->internal.ch),
 					       iov, iovcnt, md_buf, current_offset,
-					       num_blocks, bdev_io->internal.memory_domain,
-					       bdev_io->internal.memory_domain_ctx, NULL,
+					       num_blocks, domain, domain_ctx, NULL,
 					       bdev_io_split_done, bdev_io);
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
@@ -3004,8 +3365,7 @@ bdev_io_split_submit(struct spdk_bdev_io *bdev_io, struct iovec *iov, int iovcnt
 		rc = bdev_writev_blocks_with_md(bdev_io->internal.desc,
 						spdk_io_channel_from_ctx(bdev_io->internal.ch),
 						iov, iovcnt, md_buf, current_offset,
-						num_blocks, bdev_io->internal.memory_domain,
-						bdev_io->internal.memory_domain_ctx, NULL,
+						num_blocks, domain, domain_ctx, NULL,
 						bdev_io_split_done, bdev_io);
 		break;
 	case SPDK_BDEV_IO_TYPE_UNMAP:
@@ -3342,7 +3702,7 @@ bdev_io_split_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 			if (bdev_io_needs_sequence_exec(parent_io->internal.desc, parent_io)) {
 				bdev_io_exec_sequence(parent_io, bdev_io_complete_parent_sequence_cb);
 				return;
-			} else if (parent_io->internal.orig_iovcnt != 0 &&
+			} else if (parent_io->internal.has_bounce_buf &&
 				   !bdev_io_use_accel_sequence(bdev_io)) {
 				/* bdev IO will be completed in the callback */
 				_bdev_io_push_bounce_data_buffer(parent_io, parent_bdev_io_complete);
@@ -3582,8 +3942,9 @@ _bdev_io_submit_ext(struct spdk_bdev_desc *desc, struct spdk_bdev_io *bdev_io)
 	 * support them, but we need to execute an accel sequence and the data buffer is from accel
 	 * memory domain (to avoid doing a push/pull from that domain).
 	 */
-	if ((bdev_io->internal.memory_domain && !desc->memory_domains_supported) ||
-	    (needs_exec && bdev_io->internal.memory_domain == spdk_accel_get_memory_domain())) {
+	if (spdk_unlikely(bdev_io_use_memory_domain(bdev_io)) &&
+	    (!desc->memory_domains_supported ||
+	     (needs_exec && bdev_io->internal.memory_domain == spdk_accel_get_memory_domain()))) {
 		_bdev_io_ext_use_bounce_buffer(bdev_io);
 		return;
 	}
@@ -3627,19 +3988,13 @@ bdev_io_init(struct spdk_bdev_io *bdev_io,
 	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
 	bdev_io->internal.in_submit_request = false;
 	bdev_io->internal.buf = NULL;
-	bdev_io->internal.orig_iovs = NULL;
-	bdev_io->internal.orig_iovcnt = 0;
-	bdev_io->internal.orig_md_iov.iov_base = NULL;
 	bdev_io->internal.error.nvme.cdw0 = 0;
 	bdev_io->num_retries = 0;
-	bdev_io->internal.get_buf_cb = NULL;
-	bdev_io->internal.get_aux_buf_cb = NULL;
-	bdev_io->internal.memory_domain = NULL;
-	bdev_io->internal.memory_domain_ctx = NULL;
-	bdev_io->internal.data_transfer_cpl = NULL;
 	bdev_io->internal.split = bdev_io_should_split(bdev_io);
-	bdev_io->internal.accel_sequence = NULL;
 	bdev_io->internal.has_accel_sequence = false;
+	bdev_io->internal.has_memory_domain = false;
+	bdev_io->internal.has_bounce_buf = false;
+	bdev_io->internal.qos_submit_tsc = 0;
 }
 
 static bool
@@ -3686,28 +4041,158 @@ spdk_bdev_dump_info_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 }
 
 static void
-bdev_qos_update_max_quota_per_timeslice(struct spdk_bdev_qos *qos)
+bdev_qos_limits_init(struct spdk_bdev_qos_limit *limits)
+{
+	int i;
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (bdev_qos_is_iops_rate_limit(i) == true) {
+			limits[i].min_per_timeslice = SPDK_BDEV_QOS_MIN_IO_PER_TIMESLICE;
+		} else {
+			limits[i].min_per_timeslice = SPDK_BDEV_QOS_MIN_BYTE_PER_TIMESLICE;
+		}
+
+		if (limits[i].limit == 0) {
+			limits[i].limit = SPDK_BDEV_QOS_LIMIT_NOT_DEFINED;
+		}
+	}
+}
+
+static void
+bdev_qos_limits_update(struct spdk_bdev_qos_limit *limits)
 {
 	uint32_t max_per_timeslice = 0;
 	int i;
 
 	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-		if (qos->rate_limits[i].limit == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
-			qos->rate_limits[i].max_per_timeslice = 0;
+		if (limits[i].limit == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+			limits[i].max_per_timeslice = 0;
+			__atomic_store_n(&limits[i].quota_batch, 0, __ATOMIC_RELAXED);
 			continue;
 		}
 
-		max_per_timeslice = qos->rate_limits[i].limit *
+		max_per_timeslice = limits[i].limit *
 				    SPDK_BDEV_QOS_TIMESLICE_IN_USEC / SPDK_SEC_TO_USEC;
 
-		qos->rate_limits[i].max_per_timeslice = spdk_max(max_per_timeslice,
-							qos->rate_limits[i].min_per_timeslice);
+		limits[i].max_per_timeslice = spdk_max(max_per_timeslice,
+						       limits[i].min_per_timeslice);
+		__atomic_store_n(&limits[i].quota_batch,
+				 limits[i].max_per_timeslice >> SPDK_BDEV_QOS_QUOTA_BATCH_SHIFT,
+				 __ATOMIC_RELAXED);
 
-		__atomic_store_n(&qos->rate_limits[i].remaining_this_timeslice,
-				 qos->rate_limits[i].max_per_timeslice, __ATOMIC_RELEASE);
+		__atomic_store_n(&limits[i].remaining_this_timeslice,
+				 limits[i].max_per_timeslice, __ATOMIC_RELEASE);
 	}
 
-	bdev_qos_set_ops(qos);
+	bdev_qos_set_ops(limits);
+}
+
+static void
+bdev_qos_update_max_quota_per_timeslice(struct spdk_bdev_qos *qos)
+{
+	bdev_qos_limits_update(qos->rate_limits);
+	bdev_qos_limits_update(qos->min_limits);
+}
+
+/* Returns the number of timeslices that passed and moves last_timeslice past them. */
+static uint64_t
+bdev_qos_advance_timeslice(uint64_t *last_timeslice, uint64_t timeslice_size, uint64_t now)
+{
+	uint64_t count = 0;
+
+	while (now >= (*last_timeslice + timeslice_size)) {
+		*last_timeslice += timeslice_size;
+		count++;
+	}
+
+	return count;
+}
+
+static void
+bdev_qos_limit_refill(struct spdk_bdev_qos_limit *limit, uint64_t quota_per_timeslice,
+		      uint64_t count, uint64_t timeslice)
+{
+	int64_t remaining_last_timeslice;
+	uint32_t active_channels;
+	uint32_t batch;
+
+	/* We may have allowed the IOs or bytes to slightly overrun in the last
+	 * timeslice. remaining_this_timeslice is signed, so if it's negative
+	 * here, we'll account for the overrun so that the next timeslice will
+	 * be appropriately reduced.
+	 */
+	remaining_last_timeslice = __atomic_exchange_n(&limit->remaining_this_timeslice,
+				   0, __ATOMIC_RELAXED);
+	if (remaining_last_timeslice < 0) {
+		/* There could be a race condition here as both bdev_qos_rw_queue_io() and bdev_channel_poll_qos()
+		 * potentially use 2 atomic ops each, so they can intertwine.
+		 * This race can potentialy cause the limits to be a little fuzzy but won't cause any real damage.
+		 */
+		__atomic_store_n(&limit->remaining_this_timeslice,
+				 remaining_last_timeslice, __ATOMIC_RELAXED);
+	}
+
+	__atomic_add_fetch(&limit->remaining_this_timeslice, quota_per_timeslice * count,
+			   __ATOMIC_RELAXED);
+
+	/* Split the batch among the channels that were active, so that the quota
+	 * they cache and may not use stays below 1/32 of the timeslice quota no
+	 * matter how many of them there are.
+	 */
+	active_channels = __atomic_exchange_n(&limit->active_channels, 0, __ATOMIC_RELAXED);
+	batch = (quota_per_timeslice >> SPDK_BDEV_QOS_QUOTA_BATCH_SHIFT) / spdk_max(active_channels, 1);
+	__atomic_store_n(&limit->quota_batch, batch, __ATOMIC_RELAXED);
+
+	/* Expire the quota the channels took in the previous timeslices. */
+	__atomic_store_n(&limit->timeslice, timeslice, __ATOMIC_RELAXED);
+}
+
+static void
+bdev_qos_update_rate_scale(struct spdk_bdev_qos *qos)
+{
+	uint64_t latency_ticks, latency_ios, target_ticks;
+
+	latency_ticks = __atomic_exchange_n(&qos->latency_ticks, 0, __ATOMIC_RELAXED);
+	latency_ios = __atomic_exchange_n(&qos->latency_ios, 0, __ATOMIC_RELAXED);
+
+	if (qos->latency_target_us == 0) {
+		qos->rate_scale = SPDK_BDEV_QOS_RATE_SCALE_MAX;
+		return;
+	}
+
+	if (latency_ios == 0) {
+		return;
+	}
+
+	/* Back off quickly while the bdev misses its latency target and give the
+	 * bandwidth back slowly once it meets the target again.
+	 */
+	target_ticks = qos->latency_target_us * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	if (latency_ticks / latency_ios > target_ticks) {
+		qos->rate_scale = spdk_max(qos->rate_scale - qos->rate_scale / 4,
+					   SPDK_BDEV_QOS_RATE_SCALE_STEP);
+	} else {
+		qos->rate_scale = spdk_min(qos->rate_scale + SPDK_BDEV_QOS_RATE_SCALE_STEP,
+					   SPDK_BDEV_QOS_RATE_SCALE_MAX);
+	}
+}
+
+static uint64_t
+bdev_qos_timeslice_quota(struct spdk_bdev_qos *qos, int i)
+{
+	struct spdk_bdev_qos_limit *limit = &qos->rate_limits[i];
+	uint64_t quota;
+
+	if (limit->max_per_timeslice == 0) {
+		return 0;
+	}
+
+	quota = (uint64_t)limit->max_per_timeslice * qos->rate_scale / SPDK_BDEV_QOS_RATE_SCALE_MAX;
+
+	/* Latency throttling never goes below the rate guaranteed within the QoS group. */
+	quota = spdk_max(quota, qos->min_limits[i].max_per_timeslice);
+
+	return spdk_max(quota, limit->min_per_timeslice);
 }
 
 static void
@@ -3739,8 +4224,8 @@ bdev_channel_poll_qos(void *arg)
 	struct spdk_bdev *bdev = arg;
 	struct spdk_bdev_qos *qos = bdev->internal.qos;
 	uint64_t now = spdk_get_ticks();
+	uint64_t count;
 	int i;
-	int64_t remaining_last_timeslice;
 
 	if (now < (qos->last_timeslice + qos->timeslice_size)) {
 		/* We received our callback earlier than expected - return
@@ -3751,37 +4236,155 @@ bdev_channel_poll_qos(void *arg)
 		return SPDK_POLLER_IDLE;
 	}
 
+
+	bdev_qos_update_rate_scale(qos);
+
 	/* Reset for next round of rate limiting */
+	count = bdev_qos_advance_timeslice(&qos->last_timeslice, qos->timeslice_size, now);
 	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-		/* We may have allowed the IOs or bytes to slightly overrun in the last
-		 * timeslice. remaining_this_timeslice is signed, so if it's negative
-		 * here, we'll account for the overrun so that the next timeslice will
-		 * be appropriately reduced.
+		bdev_qos_limit_refill(&qos->rate_limits[i], bdev_qos_timeslice_quota(qos, i),
+				      count, qos->last_timeslice);
+		bdev_qos_limit_refill(&qos->min_limits[i], qos->min_limits[i].max_per_timeslice,
+				      count, qos->last_timeslice);
+	}
+
+	spdk_bdev_for_each_channel(bdev, bdev_channel_submit_qos_io, qos,
+				   bdev_channel_submit_qos_io_done);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static int
+bdev_qos_group_poll(void *arg)
+{
+	struct spdk_bdev_qos_group *group = arg;
+	uint64_t now = spdk_get_ticks();
+	uint64_t count, quota, reserved;
+	int i;
+
+	if (now < (group->last_timeslice + group->timeslice_size)) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	count = bdev_qos_advance_timeslice(&group->last_timeslice, group->timeslice_size, now);
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		/* The rates guaranteed to the bdevs in the group are handed out by the
+		 * bdevs' own pollers, so only the rest of the group limit is shared.
 		 */
-		remaining_last_timeslice = __atomic_exchange_n(&qos->rate_limits[i].remaining_this_timeslice,
-					   0, __ATOMIC_RELAXED);
-		if (remaining_last_timeslice < 0) {
-			/* There could be a race condition here as both bdev_qos_rw_queue_io() and bdev_channel_poll_qos()
-			 * potentially use 2 atomic ops each, so they can intertwine.
-			 * This race can potentialy cause the limits to be a little fuzzy but won't cause any real damage.
-			 */
-			__atomic_store_n(&qos->rate_limits[i].remaining_this_timeslice,
-					 remaining_last_timeslice, __ATOMIC_RELAXED);
+		reserved = __atomic_load_n(&group->reserved[i], __ATOMIC_RELAXED) *
+			   SPDK_BDEV_QOS_TIMESLICE_IN_USEC / SPDK_SEC_TO_USEC;
+		quota = group->rate_limits[i].max_per_timeslice;
+		quota = quota > reserved ? quota - reserved : 0;
+
+		bdev_qos_limit_refill(&group->rate_limits[i], quota, count, group->last_timeslice);
+	}
+
+	return SPDK_POLLER_BUSY;
+}
+
+static struct spdk_bdev_qos_group *
+bdev_qos_group_find(const char *name)
+{
+	struct spdk_bdev_qos_group *group;
+
+	assert(spdk_spin_held(&g_bdev_mgr.spinlock));
+
+	TAILQ_FOREACH(group, &g_bdev_mgr.qos_groups, link) {
+		if (strcmp(group->name, name) == 0) {
+			return group;
 		}
 	}
 
-	while (now >= (qos->last_timeslice + qos->timeslice_size)) {
-		qos->last_timeslice += qos->timeslice_size;
-		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-			__atomic_add_fetch(&qos->rate_limits[i].remaining_this_timeslice,
-					   qos->rate_limits[i].max_per_timeslice, __ATOMIC_RELAXED);
+	return NULL;
+}
+
+static void
+bdev_qos_group_put(struct spdk_bdev_qos_group *group)
+{
+	if (group == NULL) {
+		return;
+	}
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	assert(group->num_bdevs > 0);
+	group->num_bdevs--;
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+}
+
+static void
+bdev_qos_group_join(struct spdk_bdev_qos *qos, struct spdk_bdev_qos_group *group,
+		    const uint64_t *min_limits)
+{
+	int i;
+
+	assert(qos->group == NULL);
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (min_limits[i] == 0 || min_limits[i] == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+			qos->min_limits[i].limit = SPDK_BDEV_QOS_LIMIT_NOT_DEFINED;
+			continue;
 		}
+
+		qos->min_limits[i].limit = min_limits[i];
+		__atomic_add_fetch(&group->reserved[i], min_limits[i], __ATOMIC_RELAXED);
 	}
 
-	spdk_bdev_for_each_channel(bdev, bdev_channel_submit_qos_io, qos,
-				   bdev_channel_submit_qos_io_done);
+	qos->group = group;
+}
 
-	return SPDK_POLLER_BUSY;
+/* Returns the group the bdev left. It must be put once no channel can use it anymore. */
+static struct spdk_bdev_qos_group *
+bdev_qos_group_leave(struct spdk_bdev_qos *qos)
+{
+	struct spdk_bdev_qos_group *group = qos->group;
+	int i;
+
+	if (group == NULL) {
+		return NULL;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (qos->min_limits[i].limit != 0 &&
+		    qos->min_limits[i].limit != SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+			__atomic_sub_fetch(&group->reserved[i], qos->min_limits[i].limit, __ATOMIC_RELAXED);
+		}
+		qos->min_limits[i].limit = SPDK_BDEV_QOS_LIMIT_NOT_DEFINED;
+	}
+
+	qos->group = NULL;
+
+	return group;
+}
+
+static void
+bdev_qos_group_free(void *ctx)
+{
+	struct spdk_bdev_qos_group *group = ctx;
+
+	spdk_poller_unregister(&group->poller);
+	free(group->name);
+	free(group);
+}
+
+static void
+bdev_qos_group_release(struct spdk_bdev_qos_group *group)
+{
+	if (group->thread == spdk_get_thread()) {
+		bdev_qos_group_free(group);
+	} else {
+		spdk_thread_send_msg(group->thread, bdev_qos_group_free, group);
+	}
+}
+
+static void
+bdev_qos_groups_free(void)
+{
+	struct spdk_bdev_qos_group *group;
+
+	while ((group = TAILQ_FIRST(&g_bdev_mgr.qos_groups)) != NULL) {
+		TAILQ_REMOVE(&g_bdev_mgr.qos_groups, group, link);
+		bdev_qos_group_release(group);
+	}
 }
 
 static void
@@ -3790,7 +4393,7 @@ bdev_channel_destroy_resource(struct spdk_bdev_channel *ch)
 	struct spdk_bdev_shared_resource *shared_resource;
 	struct lba_range *range;
 
-	bdev_free_io_stat(ch->stat);
+	free(ch->stat);
 #ifdef SPDK_CONFIG_VTUNE
 	bdev_free_io_stat(ch->prev_stat);
 #endif
@@ -3826,7 +4429,6 @@ static void
 bdev_enable_qos(struct spdk_bdev *bdev, struct spdk_bdev_channel *ch)
 {
 	struct spdk_bdev_qos	*qos = bdev->internal.qos;
-	int			i;
 
 	assert(spdk_spin_held(&bdev->internal.spinlock));
 
@@ -3847,20 +4449,10 @@ bdev_enable_qos(struct spdk_bdev *bdev, struct spdk_bdev_channel *ch)
 
 			qos->thread = spdk_io_channel_get_thread(io_ch);
 
-			for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-				if (bdev_qos_is_iops_rate_limit(i) == true) {
-					qos->rate_limits[i].min_per_timeslice =
-						SPDK_BDEV_QOS_MIN_IO_PER_TIMESLICE;
-				} else {
-					qos->rate_limits[i].min_per_timeslice =
-						SPDK_BDEV_QOS_MIN_BYTE_PER_TIMESLICE;
-				}
-
-				if (qos->rate_limits[i].limit == 0) {
-					qos->rate_limits[i].limit = SPDK_BDEV_QOS_LIMIT_NOT_DEFINED;
-				}
-			}
+			bdev_qos_limits_init(qos->rate_limits);
+			bdev_qos_limits_init(qos->min_limits);
 			bdev_qos_update_max_quota_per_timeslice(qos);
+			qos->rate_scale = SPDK_BDEV_QOS_RATE_SCALE_MAX;
 			qos->timeslice_size =
 				SPDK_BDEV_QOS_TIMESLICE_IN_USEC * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
 			qos->last_timeslice = spdk_get_ticks();
@@ -4084,13 +4676,16 @@ bdev_channel_create(void *io_device, void *ctx_buf)
 	TAILQ_INIT(&ch->io_accel_exec);
 	TAILQ_INIT(&ch->io_memory_domain);
 
-	ch->stat = bdev_alloc_io_stat(false);
-	if (ch->stat == NULL) {
+	if (posix_memalign((void **)&ch->stat, SPDK_CACHE_LINE_SIZE, sizeof(*ch->stat)) != 0) {
+		ch->stat = NULL;
 		bdev_channel_destroy_resource(ch);
 		return -1;
 	}
 
-	ch->stat->ticks_rate = spdk_get_ticks_hz();
+	ch->stat->seq = 0;
+	ch->stat->stat.io_error = NULL;
+	spdk_bdev_reset_io_stat(&ch->stat->stat, SPDK_BDEV_RESET_STAT_ALL);
+	ch->stat->stat.ticks_rate = spdk_get_ticks_hz();
 
 #ifdef SPDK_CONFIG_VTUNE
 	{
@@ -4131,6 +4726,8 @@ bdev_channel_create(void *io_device, void *ctx_buf)
 		TAILQ_INSERT_TAIL(&ch->locked_ranges, new_range, tailq);
 	}
 
+	TAILQ_INSERT_TAIL(&bdev->internal.channel_stats, ch->stat, link);
+
 	spdk_spin_unlock(&bdev->internal.spinlock);
 
 	return 0;
@@ -4148,6 +4745,8 @@ bdev_abort_all_buf_io_cb(struct spdk_iobuf_channel *ch, struct spdk_iobuf_entry
 	if (bdev_io->internal.ch == bdev_ch) {
 		buf_len = bdev_io_get_max_buf_len(bdev_io, bdev_io->internal.buf_len);
 		spdk_iobuf_entry_abort(ch, entry, buf_len);
+		bdev_io->internal.get_buf_cb = NULL;
+		bdev_io->internal.get_aux_buf_cb = NULL;
 		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_ABORTED);
 	}
 
@@ -4218,6 +4817,8 @@ bdev_abort_buf_io_cb(struct spdk_iobuf_channel *ch, struct spdk_iobuf_entry *ent
 	if (bdev_io == bio_to_abort) {
 		buf_len = bdev_io_get_max_buf_len(bdev_io, bdev_io->internal.buf_len);
 		spdk_iobuf_entry_abort(ch, entry, buf_len);
+		bdev_io->internal.get_buf_cb = NULL;
+		bdev_io->internal.get_aux_buf_cb = NULL;
 		spdk_bdev_io_complete(bio_to_abort, SPDK_BDEV_IO_STATUS_ABORTED);
 		return 1;
 	}
@@ -4294,7 +4895,12 @@ bdev_qos_destroy(struct spdk_bdev *bdev)
 		new_qos->rate_limits[i].remaining_this_timeslice = 0;
 		new_qos->rate_limits[i].min_per_timeslice = 0;
 		new_qos->rate_limits[i].max_per_timeslice = 0;
+		new_qos->min_limits[i].remaining_this_timeslice = 0;
+		new_qos->min_limits[i].min_per_timeslice = 0;
+		new_qos->min_limits[i].max_per_timeslice = 0;
 	}
+	new_qos->latency_ticks = 0;
+	new_qos->latency_ios = 0;
 
 	bdev->internal.qos = new_qos;
 
@@ -4363,6 +4969,84 @@ bdev_get_io_stat(struct spdk_bdev_io_stat *to_stat, struct spdk_bdev_io_stat *fr
 	}
 }
 
+static inline void
+bdev_channel_stat_update_begin(struct spdk_bdev_channel_stat *ch_stat)
+{
+	__atomic_store_n(&ch_stat->seq, ch_stat->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void
+bdev_channel_stat_update_end(struct spdk_bdev_channel_stat *ch_stat)
+{
+	__atomic_store_n(&ch_stat->seq, ch_stat->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Can be called from any thread. The I/O error statistics of the channel are not copied. */
+static void
+bdev_channel_stat_read(struct spdk_bdev_channel_stat *ch_stat, struct spdk_bdev_io_stat *stat)
+{
+	uint64_t seq;
+
+	while (true) {
+		seq = __atomic_load_n(&ch_stat->seq, __ATOMIC_ACQUIRE);
+		if ((seq & 1) == 0) {
+			memcpy(stat, &ch_stat->stat, offsetof(struct spdk_bdev_io_stat, io_error));
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&ch_stat->seq, __ATOMIC_RELAXED) == seq) {
+				return;
+			}
+		}
+	}
+}
+
+void
+bdev_read_device_stat(struct spdk_bdev *bdev, struct spdk_bdev_io_stat *stat)
+{
+	struct spdk_bdev_channel_stat *ch_stat;
+	struct spdk_bdev_io_stat ch_io_stat;
+
+	/* Start with the statistics from previously deleted channels. */
+	spdk_spin_lock(&bdev->internal.spinlock);
+	bdev_get_io_stat(stat, bdev->internal.stat);
+
+	/* Then add the statistics from each existing channel. */
+	TAILQ_FOREACH(ch_stat, &bdev->internal.channel_stats, link) {
+		bdev_channel_stat_read(ch_stat, &ch_io_stat);
+		spdk_bdev_add_io_stat(stat, &ch_io_stat);
+	}
+	spdk_spin_unlock(&bdev->internal.spinlock);
+}
+
+#define BDEV_SUB_IO_STAT(stat, prev, field) \
+	(stat)->field = (stat)->field >= (prev)->field ? (stat)->field - (prev)->field : (stat)->field
+
+void
+bdev_sub_io_stat(struct spdk_bdev_io_stat *stat, struct spdk_bdev_io_stat *prev)
+{
+	int i;
+
+	/* If the statistics were reset in the meantime, the current value is the difference. */
+	BDEV_SUB_IO_STAT(stat, prev, bytes_read);
+	BDEV_SUB_IO_STAT(stat, prev, num_read_ops);
+	BDEV_SUB_IO_STAT(stat, prev, bytes_written);
+	BDEV_SUB_IO_STAT(stat, prev, num_write_ops);
+	BDEV_SUB_IO_STAT(stat, prev, bytes_unmapped);
+	BDEV_SUB_IO_STAT(stat, prev, num_unmap_ops);
+	BDEV_SUB_IO_STAT(stat, prev, bytes_copied);
+	BDEV_SUB_IO_STAT(stat, prev, num_copy_ops);
+	BDEV_SUB_IO_STAT(stat, prev, read_latency_ticks);
+	BDEV_SUB_IO_STAT(stat, prev, write_latency_ticks);
+	BDEV_SUB_IO_STAT(stat, prev, unmap_latency_ticks);
+	BDEV_SUB_IO_STAT(stat, prev, copy_latency_ticks);
+
+	if (stat->io_error != NULL && prev->io_error != NULL) {
+		for (i = 0; i < -SPDK_MIN_BDEV_IO_STATUS; i++) {
+			BDEV_SUB_IO_STAT(stat, prev, io_error->error_status[i]);
+		}
+	}
+}
+
 void
 spdk_bdev_reset_io_stat(struct spdk_bdev_io_stat *stat, enum spdk_bdev_reset_stat_mode mode)
 {
@@ -4500,7 +5184,8 @@ bdev_channel_destroy(void *io_device, void *ctx_buf)
 
 	/* This channel is going away, so add its statistics into the bdev so that they don't get lost. */
 	spdk_spin_lock(&ch->bdev->internal.spinlock);
-	spdk_bdev_add_io_stat(ch->bdev->internal.stat, ch->stat);
+	spdk_bdev_add_io_stat(ch->bdev->internal.stat, &ch->stat->stat);
+	TAILQ_REMOVE(&ch->bdev->internal.channel_stats, ch->stat, link);
 	spdk_spin_unlock(&ch->bdev->internal.spinlock);
 
 	bdev_abort_all_queued_io(&ch->queued_resets, ch);
@@ -4697,25 +5382,30 @@ spdk_bdev_get_qos_rpc_type(enum spdk_bdev_qos_rate_limit_type type)
 	return qos_rpc_type[type];
 }
 
-void
-spdk_bdev_get_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits)
+static void
+bdev_qos_get_limits(const struct spdk_bdev_qos_limit *qos_limits, uint64_t *limits)
 {
 	int i;
 
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (qos_limits[i].limit != SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+			limits[i] = qos_limits[i].limit;
+			if (bdev_qos_is_iops_rate_limit(i) == false) {
+				/* Change from Byte to Megabyte which is user visible. */
+				limits[i] = limits[i] / 1024 / 1024;
+			}
+		}
+	}
+}
+
+void
+spdk_bdev_get_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits)
+{
 	memset(limits, 0, sizeof(*limits) * SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES);
 
 	spdk_spin_lock(&bdev->internal.spinlock);
 	if (bdev->internal.qos) {
-		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-			if (bdev->internal.qos->rate_limits[i].limit !=
-			    SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
-				limits[i] = bdev->internal.qos->rate_limits[i].limit;
-				if (bdev_qos_is_iops_rate_limit(i) == false) {
-					/* Change from Byte to Megabyte which is user visible. */
-					limits[i] = limits[i] / 1024 / 1024;
-				}
-			}
-		}
+		bdev_qos_get_limits(bdev->internal.qos->rate_limits, limits);
 	}
 	spdk_spin_unlock(&bdev->internal.spinlock);
 }
@@ -5352,10 +6042,15 @@ bdev_readv_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *c
 	bdev_io->u.bdev.num_blocks = num_blocks;
 	bdev_io->u.bdev.offset_blocks = offset_blocks;
 	bdev_io_init(bdev_io, bdev, cb_arg, cb);
-	bdev_io->internal.memory_domain = domain;
-	bdev_io->internal.memory_domain_ctx = domain_ctx;
-	bdev_io->internal.accel_sequence = seq;
-	bdev_io->internal.has_accel_sequence = seq != NULL;
+	if (spdk_unlikely(domain != NULL)) {
+		bdev_io->internal.memory_domain = domain;
+		bdev_io->internal.memory_domain_ctx = domain_ctx;
+		bdev_io->internal.has_memory_domain = true;
+	}
+	if (spdk_unlikely(seq != NULL)) {
+		bdev_io->internal.accel_sequence = seq;
+		bdev_io->internal.has_accel_sequence = true;
+	}
 	bdev_io->u.bdev.memory_domain = domain;
 	bdev_io->u.bdev.memory_domain_ctx = domain_ctx;
 	bdev_io->u.bdev.accel_sequence = seq;
@@ -5560,10 +6255,15 @@ bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *
 	bdev_io->u.bdev.num_blocks = num_blocks;
 	bdev_io->u.bdev.offset_blocks = offset_blocks;
 	bdev_io_init(bdev_io, bdev, cb_arg, cb);
-	bdev_io->internal.memory_domain = domain;
-	bdev_io->internal.memory_domain_ctx = domain_ctx;
-	bdev_io->internal.accel_sequence = seq;
-	bdev_io->internal.has_accel_sequence = seq != NULL;
+	if (spdk_unlikely(domain != NULL)) {
+		bdev_io->internal.memory_domain = domain;
+		bdev_io->internal.memory_domain_ctx = domain_ctx;
+		bdev_io->internal.has_memory_domain = true;
+	}
+	if (spdk_unlikely(seq != NULL)) {
+		bdev_io->internal.accel_sequence = seq;
+		bdev_io->internal.has_accel_sequence = true;
+	}
 	bdev_io->u.bdev.memory_domain = domain;
 	bdev_io->u.bdev.memory_domain_ctx = domain_ctx;
 	bdev_io->u.bdev.accel_sequence = seq;
@@ -6456,30 +7156,19 @@ spdk_bdev_get_io_stat(struct spdk_bdev *bdev, struct spdk_io_channel *ch,
 {
 	struct spdk_bdev_channel *channel = __io_ch_to_bdev_ch(ch);
 
-	bdev_get_io_stat(stat, channel->stat);
+	bdev_channel_stat_read(channel->stat, stat);
 }
 
 static void
-bdev_get_device_stat_done(struct spdk_bdev *bdev, void *_ctx, int status)
+bdev_get_device_stat_done(void *_ctx)
 {
 	struct spdk_bdev_iostat_ctx *bdev_iostat_ctx = _ctx;
 
-	bdev_iostat_ctx->cb(bdev, bdev_iostat_ctx->stat,
+	bdev_iostat_ctx->cb(bdev_iostat_ctx->bdev, bdev_iostat_ctx->stat,
 			    bdev_iostat_ctx->cb_arg, 0);
 	free(bdev_iostat_ctx);
 }
 
-static void
-bdev_get_each_channel_stat(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
-			   struct spdk_io_channel *ch, void *_ctx)
-{
-	struct spdk_bdev_iostat_ctx *bdev_iostat_ctx = _ctx;
-	struct spdk_bdev_channel *channel = __io_ch_to_bdev_ch(ch);
-
-	spdk_bdev_add_io_stat(bdev_iostat_ctx->stat, channel->stat);
-	spdk_bdev_for_each_channel_continue(i, 0);
-}
-
 void
 spdk_bdev_get_device_stat(struct spdk_bdev *bdev, struct spdk_bdev_io_stat *stat,
 			  spdk_bdev_get_device_stat_cb cb, void *cb_arg)
@@ -6497,18 +7186,15 @@ spdk_bdev_get_device_stat(struct spdk_bdev *bdev, struct spdk_bdev_io_stat *stat
 		return;
 	}
 
+	bdev_iostat_ctx->bdev = bdev;
 	bdev_iostat_ctx->stat = stat;
 	bdev_iostat_ctx->cb = cb;
 	bdev_iostat_ctx->cb_arg = cb_arg;
 
-	/* Start with the statistics from previously deleted channels. */
-	spdk_spin_lock(&bdev->internal.spinlock);
-	bdev_get_io_stat(bdev_iostat_ctx->stat, bdev->internal.stat);
-	spdk_spin_unlock(&bdev->internal.spinlock);
+	bdev_read_device_stat(bdev, stat);
 
-	/* Then iterate and add the statistics from each existing channel. */
-	spdk_bdev_for_each_channel(bdev, bdev_get_each_channel_stat, bdev_iostat_ctx,
-				   bdev_get_device_stat_done);
+	/* The statistics are read directly, but the callback is still called asynchronously. */
+	spdk_thread_send_msg(spdk_get_thread(), bdev_get_device_stat_done, bdev_iostat_ctx);
 }
 
 struct bdev_iostat_reset_ctx {
@@ -6534,7 +7220,9 @@ bdev_reset_each_channel_stat(struct spdk_bdev_channel_iter *i, struct spdk_bdev
 	struct bdev_iostat_reset_ctx *ctx = _ctx;
 	struct spdk_bdev_channel *channel = __io_ch_to_bdev_ch(ch);
 
-	spdk_bdev_reset_io_stat(channel->stat, ctx->mode);
+	bdev_channel_stat_update_begin(channel->stat);
+	spdk_bdev_reset_io_stat(&channel->stat->stat, ctx->mode);
+	bdev_channel_stat_update_end(channel->stat);
 
 	spdk_bdev_for_each_channel_continue(i, 0);
 }
@@ -7005,11 +7693,13 @@ static inline void
 bdev_io_update_io_stat(struct spdk_bdev_io *bdev_io, uint64_t tsc_diff)
 {
 	enum spdk_bdev_io_status io_status = bdev_io->internal.status;
-	struct spdk_bdev_io_stat *io_stat = bdev_io->internal.ch->stat;
+	struct spdk_bdev_channel_stat *ch_stat = bdev_io->internal.ch->stat;
+	struct spdk_bdev_io_stat *io_stat = &ch_stat->stat;
 	uint64_t num_blocks = bdev_io->u.bdev.num_blocks;
 	uint32_t blocklen = bdev_io->bdev->blocklen;
 
 	if (spdk_likely(io_status == SPDK_BDEV_IO_STATUS_SUCCESS)) {
+		bdev_channel_stat_update_begin(ch_stat);
 		switch (bdev_io->type) {
 		case SPDK_BDEV_IO_TYPE_READ:
 			io_stat->bytes_read += num_blocks * blocklen;
@@ -7073,7 +7763,7 @@ bdev_io_update_io_stat(struct spdk_bdev_io *bdev_io, uint64_t tsc_diff)
 		case SPDK_BDEV_IO_TYPE_COPY:
 			io_stat->bytes_copied += num_blocks * blocklen;
 			io_stat->num_copy_ops++;
-			bdev_io->internal.ch->stat->copy_latency_ticks += tsc_diff;
+			io_stat->copy_latency_ticks += tsc_diff;
 			if (io_stat->max_copy_latency_ticks < tsc_diff) {
 				io_stat->max_copy_latency_ticks = tsc_diff;
 			}
@@ -7084,6 +7774,7 @@ bdev_io_update_io_stat(struct spdk_bdev_io *bdev_io, uint64_t tsc_diff)
 		default:
 			break;
 		}
+		bdev_channel_stat_update_end(ch_stat);
 	} else if (io_status <= SPDK_BDEV_IO_STATUS_FAILED && io_status >= SPDK_MIN_BDEV_IO_STATUS) {
 		io_stat = bdev_io->bdev->internal.stat;
 		assert(io_stat->io_error != NULL);
@@ -7115,12 +7806,39 @@ bdev_io_update_io_stat(struct spdk_bdev_io *bdev_io, uint64_t tsc_diff)
 #endif
 }
 
+static void
+bdev_qos_io_complete(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_io, uint64_t tsc)
+{
+	struct spdk_bdev_qos *qos = bdev_io->bdev->internal.qos;
+	uint64_t timeslice;
+
+	if (bdev_io->internal.qos_submit_tsc == 0 || qos == NULL) {
+		return;
+	}
+
+	/* Report the latency to the QoS poller once per timeslice only. */
+	timeslice = __atomic_load_n(&qos->last_timeslice, __ATOMIC_RELAXED);
+	if (bdev_ch->qos_latency_timeslice != timeslice) {
+		if (bdev_ch->qos_latency_ios != 0) {
+			__atomic_add_fetch(&qos->latency_ticks, bdev_ch->qos_latency_ticks, __ATOMIC_RELAXED);
+			__atomic_add_fetch(&qos->latency_ios, bdev_ch->qos_latency_ios, __ATOMIC_RELAXED);
+			bdev_ch->qos_latency_ticks = 0;
+			bdev_ch->qos_latency_ios = 0;
+		}
+		bdev_ch->qos_latency_timeslice = timeslice;
+	}
+
+	bdev_ch->qos_latency_ticks += tsc - bdev_io->internal.qos_submit_tsc;
+	bdev_ch->qos_latency_ios++;
+}
+
 static inline void
 _bdev_io_complete(void *ctx)
 {
 	struct spdk_bdev_io *bdev_io = ctx;
 
-	if (spdk_unlikely(bdev_io->internal.accel_sequence != NULL)) {
+	if (spdk_unlikely(bdev_io_use_accel_sequence(bdev_io) &&
+			  bdev_io->internal.accel_sequence != NULL)) {
 		assert(bdev_io->internal.status != SPDK_BDEV_IO_STATUS_SUCCESS);
 		spdk_accel_sequence_abort(bdev_io->internal.accel_sequence);
 	}
@@ -7161,6 +7879,11 @@ bdev_io_complete(void *ctx)
 	}
 
 	bdev_io_update_io_stat(bdev_io, tsc_diff);
+
+	if (spdk_unlikely(bdev_ch->flags & BDEV_CH_QOS_ENABLED)) {
+		bdev_qos_io_complete(bdev_ch, bdev_io, tsc);
+	}
+
 	_bdev_io_complete(bdev_io);
 }
 
@@ -7275,7 +7998,7 @@ spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status sta
 			if (bdev_io_needs_sequence_exec(bdev_io->internal.desc, bdev_io)) {
 				bdev_io_exec_sequence(bdev_io, bdev_io_complete_sequence_cb);
 				return;
-			} else if (spdk_unlikely(bdev_io->internal.orig_iovcnt != 0 &&
+			} else if (spdk_unlikely(bdev_io->internal.has_bounce_buf &&
 						 !bdev_io_use_accel_sequence(bdev_io))) {
 				_bdev_io_push_bounce_data_buffer(bdev_io,
 								 _bdev_io_complete_push_bounce_done);
@@ -7551,6 +8274,7 @@ bdev_register(struct spdk_bdev *bdev)
 		free(bdev_name);
 		return -ENOMEM;
 	}
+	TAILQ_INIT(&bdev->internal.channel_stats);
 
 	bdev->internal.status = SPDK_BDEV_STATUS_READY;
 	bdev->internal.measured_queue_depth = UINT64_MAX;
@@ -7657,6 +8381,9 @@ bdev_destroy_cb(void *io_device)
 	cb_arg = bdev->internal.unregister_ctx;
 
 	spdk_spin_destroy(&bdev->internal.spinlock);
+	if (bdev->internal.qos != NULL) {
+		bdev_qos_group_put(bdev_qos_group_leave(bdev->internal.qos));
+	}
 	free(bdev->internal.qos);
 	bdev_free_io_stat(bdev->internal.stat);
 
@@ -9021,6 +9748,8 @@ bdev_set_qos_limit_done(struct set_qos_limit_ctx *ctx, int status)
 	ctx->bdev->internal.qos_mod_in_progress = false;
 	spdk_spin_unlock(&ctx->bdev->internal.spinlock);
 
+	bdev_qos_group_put(ctx->put_group);
+
 	if (ctx->cb_fn) {
 		ctx->cb_fn(ctx->cb_arg, status);
 	}
@@ -9137,15 +9866,17 @@ bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits)
 	}
 }
 
-void
-spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
-			      void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+/*
+ * Changes the byte limits from megabytes to bytes and rounds all limits up to
+ * the granularity of the rate limiting. Returns true if any limit is enabled.
+ */
+static bool
+bdev_qos_convert_limits(uint64_t *limits)
 {
-	struct set_qos_limit_ctx	*ctx;
 	uint32_t			limit_set_complement;
 	uint64_t			min_limit_per_sec;
 	int				i;
-	bool				disable_rate_limit = true;
+	bool				enabled = false;
 
 	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
 		if (limits[i] == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
@@ -9153,7 +9884,7 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 		}
 
 		if (limits[i] > 0) {
-			disable_rate_limit = false;
+			enabled = true;
 		}
 
 		if (bdev_qos_is_iops_rate_limit(i) == true) {
@@ -9173,6 +9904,19 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 		}
 	}
 
+	return enabled;
+}
+
+void
+spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
+			      void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct set_qos_limit_ctx	*ctx;
+	int				i;
+	bool				disable_rate_limit;
+
+	disable_rate_limit = !bdev_qos_convert_limits(limits);
+
 	ctx = calloc(1, sizeof(*ctx));
 	if (ctx == NULL) {
 		cb_fn(cb_arg, -ENOMEM);
@@ -9202,6 +9946,11 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 				break;
 			}
 		}
+
+		/* A bdev in a QoS group keeps QoS enabled without rate limits of its own. */
+		if (bdev->internal.qos->group != NULL) {
+			disable_rate_limit = false;
+		}
 	}
 
 	if (disable_rate_limit == false) {
@@ -9245,6 +9994,239 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 	spdk_spin_unlock(&bdev->internal.spinlock);
 }
 
+static bool
+bdev_qos_is_needed(struct spdk_bdev_qos *qos)
+{
+	int i;
+
+	if (qos->group != NULL) {
+		return true;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (qos->rate_limits[i].limit != 0 &&
+		    qos->rate_limits[i].limit != SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+bdev_set_qos_group_done(struct spdk_bdev *bdev, void *_ctx, int status)
+{
+	struct set_qos_limit_ctx *ctx = _ctx;
+	struct spdk_thread *thread;
+
+	if (status != 0) {
+		bdev_set_qos_limit_done(ctx, status);
+		return;
+	}
+
+	/* All channels now use the new group. Apply the new guaranteed rates. */
+	spdk_spin_lock(&bdev->internal.spinlock);
+	thread = bdev->internal.qos->thread;
+	spdk_spin_unlock(&bdev->internal.spinlock);
+
+	if (thread != NULL) {
+		spdk_thread_send_msg(thread, bdev_update_qos_rate_limit_msg, ctx);
+	} else {
+		bdev_set_qos_limit_done(ctx, 0);
+	}
+}
+
+void
+spdk_bdev_set_qos_group(struct spdk_bdev *bdev, const char *group_name, uint64_t *min_limits,
+			void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct set_qos_limit_ctx	*ctx;
+	struct spdk_bdev_qos_group	*group = NULL;
+	struct spdk_bdev_qos		*qos;
+	uint64_t			no_limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	int				i;
+
+	if (min_limits == NULL) {
+		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+			no_limits[i] = SPDK_BDEV_QOS_LIMIT_NOT_DEFINED;
+		}
+		min_limits = no_limits;
+	}
+	bdev_qos_convert_limits(min_limits);
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->bdev = bdev;
+
+	if (group_name != NULL) {
+		spdk_spin_lock(&g_bdev_mgr.spinlock);
+		group = bdev_qos_group_find(group_name);
+		if (group != NULL) {
+			group->num_bdevs++;
+		}
+		spdk_spin_unlock(&g_bdev_mgr.spinlock);
+
+		if (group == NULL) {
+			SPDK_ERRLOG("QoS group %s does not exist\n", group_name);
+			free(ctx);
+			cb_fn(cb_arg, -ENODEV);
+			return;
+		}
+	}
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	if (bdev->internal.qos_mod_in_progress) {
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		bdev_qos_group_put(group);
+		free(ctx);
+		cb_fn(cb_arg, -EAGAIN);
+		return;
+	}
+
+	qos = bdev->internal.qos;
+	if (group == NULL && (qos == NULL || qos->group == NULL)) {
+		/* Leaving a group while not in any group */
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		free(ctx);
+		cb_fn(cb_arg, 0);
+		return;
+	}
+	bdev->internal.qos_mod_in_progress = true;
+
+	if (qos == NULL) {
+		qos = calloc(1, sizeof(*qos));
+		if (qos == NULL) {
+			spdk_spin_unlock(&bdev->internal.spinlock);
+			SPDK_ERRLOG("Unable to allocate memory for QoS tracking\n");
+			ctx->put_group = group;
+			bdev_set_qos_limit_done(ctx, -ENOMEM);
+			return;
+		}
+		bdev->internal.qos = qos;
+	}
+
+	/* The channels may still use the previous group until they are all iterated. */
+	ctx->put_group = bdev_qos_group_leave(qos);
+	if (group != NULL) {
+		bdev_qos_group_join(qos, group, min_limits);
+	}
+
+	if (bdev_qos_is_needed(qos)) {
+		spdk_bdev_for_each_channel(bdev, bdev_enable_qos_msg, ctx,
+					   bdev_set_qos_group_done);
+	} else {
+		spdk_bdev_for_each_channel(bdev, bdev_disable_qos_msg, ctx,
+					   bdev_disable_qos_msg_done);
+	}
+
+	spdk_spin_unlock(&bdev->internal.spinlock);
+}
+
+int
+spdk_bdev_set_qos_latency_target(struct spdk_bdev *bdev, uint64_t latency_us)
+{
+	int rc = 0;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	if (bdev->internal.qos != NULL) {
+		bdev->internal.qos->latency_target_us = latency_us;
+	} else {
+		rc = -EINVAL;
+	}
+	spdk_spin_unlock(&bdev->internal.spinlock);
+
+	if (rc != 0) {
+		SPDK_ERRLOG("QoS is not enabled on bdev %s\n", bdev->name);
+	}
+
+	return rc;
+}
+
+int
+spdk_bdev_qos_group_create(const char *name, uint64_t *limits)
+{
+	struct spdk_bdev_qos_group	*group;
+	struct spdk_thread		*thread = spdk_get_thread();
+	int				i;
+
+	if (thread == NULL) {
+		SPDK_ERRLOG("QoS groups can only be created on an SPDK thread\n");
+		return -EINVAL;
+	}
+
+	if (!bdev_qos_convert_limits(limits)) {
+		SPDK_ERRLOG("No rate limits specified for QoS group %s\n", name);
+		return -EINVAL;
+	}
+
+	group = calloc(1, sizeof(*group));
+	if (group == NULL) {
+		return -ENOMEM;
+	}
+
+	group->name = strdup(name);
+	if (group->name == NULL) {
+		free(group);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		group->rate_limits[i].limit = limits[i];
+	}
+	bdev_qos_limits_init(group->rate_limits);
+	bdev_qos_limits_update(group->rate_limits);
+
+	group->thread = thread;
+	group->timeslice_size = SPDK_BDEV_QOS_TIMESLICE_IN_USEC * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	group->last_timeslice = spdk_get_ticks();
+	group->poller = SPDK_POLLER_REGISTER(bdev_qos_group_poll, group,
+					     SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	if (bdev_qos_group_find(name) != NULL) {
+		spdk_spin_unlock(&g_bdev_mgr.spinlock);
+		SPDK_ERRLOG("QoS group %s already exists\n", name);
+		bdev_qos_group_free(group);
+		return -EEXIST;
+	}
+	TAILQ_INSERT_TAIL(&g_bdev_mgr.qos_groups, group, link);
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+
+	return 0;
+}
+
+int
+spdk_bdev_qos_group_delete(const char *name)
+{
+	struct spdk_bdev_qos_group *group;
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	group = bdev_qos_group_find(name);
+	if (group == NULL) {
+		spdk_spin_unlock(&g_bdev_mgr.spinlock);
+		return -ENODEV;
+	}
+
+	if (group->num_bdevs > 0) {
+		spdk_spin_unlock(&g_bdev_mgr.spinlock);
+		SPDK_ERRLOG("QoS group %s still has %" PRIu32 " bdevs\n", name, group->num_bdevs);
+		return -EBUSY;
+	}
+
+	TAILQ_REMOVE(&g_bdev_mgr.qos_groups, group, link);
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+
+	bdev_qos_group_release(group);
+
+	return 0;
+}
+
 struct spdk_bdev_histogram_ctx {
 	spdk_bdev_histogram_status_cb cb_fn;
 	void *cb_arg;
@@ -24,6 +24,12 @@ void bdev_io_submit(struct spdk_bdev_io *bdev_io);
 struct spdk_bdev_io_stat *bdev_alloc_io_stat(bool io_error_stat);
 void bdev_free_io_stat(struct spdk_bdev_io_stat *stat);
 
+/* Read the I/O statistics of a bdev without sending messages to the threads of its channels. */
+void bdev_read_device_stat(struct spdk_bdev *bdev, struct spdk_bdev_io_stat *stat);
+
+/* Turn the counters of stat into the difference from prev. */
+void bdev_sub_io_stat(struct spdk_bdev_io_stat *stat, struct spdk_bdev_io_stat *prev);
+
 enum spdk_bdev_reset_stat_mode;
 
 typedef void (*bdev_reset_device_stat_cb)(struct spdk_bdev *bdev, void *cb_arg, int rc);
@@ -31,4 +37,13 @@ typedef void (*bdev_reset_device_stat_cb)(struct spdk_bdev *bdev, void *cb_arg,
 void bdev_reset_device_stat(struct spdk_bdev *bdev, enum spdk_bdev_reset_stat_mode mode,
 			    bdev_reset_device_stat_cb cb, void *cb_arg);
 
+struct spdk_bdev_part;
+struct spdk_json_write_ctx;
+
+/* Return the part of a bdev created by the part layer, NULL for other bdevs. */
+struct spdk_bdev_part *bdev_part_get_by_bdev(struct spdk_bdev *bdev);
+
+/* Write the RPC restoring the sharing of the base bdev queue slots of a part bdev. */
+void bdev_part_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w);
+
 #endif /* SPDK_BDEV_INTERNAL_H */
@@ -130,18 +130,25 @@ cleanup:
 }
 SPDK_RPC_REGISTER("bdev_examine", rpc_bdev_examine_bdev, SPDK_RPC_RUNTIME)
 
+struct bdev_get_iostat_ctx {
+	struct spdk_bdev_io_stat *stat;
+	/* Statistics at the start of the interval, if an interval was requested. */
+	struct spdk_bdev_io_stat *prev_stat;
+	struct rpc_get_iostat_ctx *rpc_ctx;
+	struct spdk_bdev_desc *desc;
+	TAILQ_ENTRY(bdev_get_iostat_ctx) link;
+};
+
 struct rpc_get_iostat_ctx {
 	int bdev_count;
 	int rc;
 	struct spdk_jsonrpc_request *request;
 	struct spdk_json_write_ctx *w;
 	bool per_channel;
-};
-
-struct bdev_get_iostat_ctx {
-	struct spdk_bdev_io_stat *stat;
-	struct rpc_get_iostat_ctx *rpc_ctx;
-	struct spdk_bdev_desc *desc;
+	uint64_t interval_ms;
+	struct spdk_poller *poller;
+	/* Bdevs waiting for the end of the interval. */
+	TAILQ_HEAD(, bdev_get_iostat_ctx) bdevs;
 };
 
 static void
@@ -177,7 +184,7 @@ rpc_get_iostat_done(struct rpc_get_iostat_ctx *rpc_ctx)
 }
 
 static struct bdev_get_iostat_ctx *
-bdev_iostat_ctx_alloc(bool iostat_ext)
+bdev_iostat_ctx_alloc(bool iostat_ext, bool interval)
 {
 	struct bdev_get_iostat_ctx *ctx;
 
@@ -192,6 +199,15 @@ bdev_iostat_ctx_alloc(bool iostat_ext)
 		return NULL;
 	}
 
+	if (interval) {
+		ctx->prev_stat = bdev_alloc_io_stat(iostat_ext);
+		if (ctx->prev_stat == NULL) {
+			bdev_free_io_stat(ctx->stat);
+			free(ctx);
+			return NULL;
+		}
+	}
+
 	return ctx;
 }
 
@@ -199,6 +215,7 @@ static void
 bdev_iostat_ctx_free(struct bdev_get_iostat_ctx *ctx)
 {
 	bdev_free_io_stat(ctx->stat);
+	bdev_free_io_stat(ctx->prev_stat);
 	free(ctx);
 }
 
@@ -219,6 +236,10 @@ bdev_get_iostat_done(struct spdk_bdev *bdev, struct spdk_bdev_io_stat *stat,
 
 	assert(stat == bdev_ctx->stat);
 
+	if (bdev_ctx->prev_stat != NULL) {
+		bdev_sub_io_stat(stat, bdev_ctx->prev_stat);
+	}
+
 	spdk_json_write_object_begin(w);
 
 	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(bdev));
@@ -252,6 +273,22 @@ done:
 	bdev_iostat_ctx_free(bdev_ctx);
 }
 
+static void
+bdev_get_iostat_start(struct bdev_get_iostat_ctx *bdev_ctx)
+{
+	struct rpc_get_iostat_ctx *rpc_ctx = bdev_ctx->rpc_ctx;
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(bdev_ctx->desc);
+
+	if (bdev_ctx->prev_stat != NULL) {
+		/* Take the first sample now and the second one at the end of the interval. */
+		bdev_read_device_stat(bdev, bdev_ctx->prev_stat);
+		TAILQ_INSERT_TAIL(&rpc_ctx->bdevs, bdev_ctx, link);
+		return;
+	}
+
+	spdk_bdev_get_device_stat(bdev, bdev_ctx->stat, bdev_get_iostat_done, bdev_ctx);
+}
+
 static int
 bdev_get_iostat(void *ctx, struct spdk_bdev *bdev)
 {
@@ -259,7 +296,7 @@ bdev_get_iostat(void *ctx, struct spdk_bdev *bdev)
 	struct bdev_get_iostat_ctx *bdev_ctx;
 	int rc;
 
-	bdev_ctx = bdev_iostat_ctx_alloc(true);
+	bdev_ctx = bdev_iostat_ctx_alloc(true, rpc_ctx->interval_ms != 0);
 	if (bdev_ctx == NULL) {
 		SPDK_ERRLOG("Failed to allocate bdev_iostat_ctx struct\n");
 		return -ENOMEM;
@@ -275,7 +312,7 @@ bdev_get_iostat(void *ctx, struct spdk_bdev *bdev)
 
 	rpc_ctx->bdev_count++;
 	bdev_ctx->rpc_ctx = rpc_ctx;
-	spdk_bdev_get_device_stat(bdev, bdev_ctx->stat, bdev_get_iostat_done, bdev_ctx);
+	bdev_get_iostat_start(bdev_ctx);
 
 	return 0;
 }
@@ -312,6 +349,7 @@ bdev_get_per_channel_stat(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bd
 struct rpc_bdev_get_iostat {
 	char *name;
 	bool per_channel;
+	uint64_t interval_ms;
 };
 
 static void
@@ -323,8 +361,49 @@ free_rpc_bdev_get_iostat(struct rpc_bdev_get_iostat *r)
 static const struct spdk_json_object_decoder rpc_bdev_get_iostat_decoders[] = {
 	{"name", offsetof(struct rpc_bdev_get_iostat, name), spdk_json_decode_string, true},
 	{"per_channel", offsetof(struct rpc_bdev_get_iostat, per_channel), spdk_json_decode_bool, true},
+	{"interval_ms", offsetof(struct rpc_bdev_get_iostat, interval_ms), spdk_json_decode_uint64, true},
 };
 
+static void
+rpc_get_iostat_finish(struct rpc_get_iostat_ctx *rpc_ctx)
+{
+	if (rpc_ctx->rc == 0) {
+		/* We want to fail the RPC for all failures. If per_channel is false,
+		 * it is enough to defer starting RPC response until it is ensured that
+		 * all spdk_bdev_get_device_stat() calls will succeed or there is no bdev.
+		 */
+		rpc_get_iostat_started(rpc_ctx);
+		spdk_json_write_named_array_begin(rpc_ctx->w, "bdevs");
+	}
+
+	rpc_get_iostat_done(rpc_ctx);
+}
+
+static int
+rpc_get_iostat_interval_end(void *arg)
+{
+	struct rpc_get_iostat_ctx *rpc_ctx = arg;
+	struct bdev_get_iostat_ctx *bdev_ctx;
+
+	spdk_poller_unregister(&rpc_ctx->poller);
+
+	while ((bdev_ctx = TAILQ_FIRST(&rpc_ctx->bdevs)) != NULL) {
+		TAILQ_REMOVE(&rpc_ctx->bdevs, bdev_ctx, link);
+		if (rpc_ctx->rc == 0) {
+			spdk_bdev_get_device_stat(spdk_bdev_desc_get_bdev(bdev_ctx->desc), bdev_ctx->stat,
+						  bdev_get_iostat_done, bdev_ctx);
+		} else {
+			rpc_get_iostat_done(rpc_ctx);
+			spdk_bdev_close(bdev_ctx->desc);
+			bdev_iostat_ctx_free(bdev_ctx);
+		}
+	}
+
+	rpc_get_iostat_finish(rpc_ctx);
+
+	return SPDK_POLLER_BUSY;
+}
+
 static void
 rpc_bdev_get_iostat(struct spdk_jsonrpc_request *request,
 		    const struct spdk_json_val *params)
@@ -354,6 +433,13 @@ rpc_bdev_get_iostat(struct spdk_jsonrpc_request *request,
 			return;
 		}
 
+		if (req.per_channel == true && req.interval_ms != 0) {
+			SPDK_ERRLOG("Interval is not supported for per channel IO statistics\n");
+			spdk_jsonrpc_send_error_response(request, -EINVAL, spdk_strerror(EINVAL));
+			free_rpc_bdev_get_iostat(&req);
+			return;
+		}
+
 		if (req.name) {
 			rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
 			if (rc != 0) {
@@ -381,11 +467,13 @@ rpc_bdev_get_iostat(struct spdk_jsonrpc_request *request,
 	rpc_ctx->bdev_count++;
 	rpc_ctx->request = request;
 	rpc_ctx->per_channel = req.per_channel;
+	rpc_ctx->interval_ms = req.interval_ms;
+	TAILQ_INIT(&rpc_ctx->bdevs);
 
 	if (desc != NULL) {
 		bdev = spdk_bdev_desc_get_bdev(desc);
 
-		bdev_ctx = bdev_iostat_ctx_alloc(req.per_channel == false);
+		bdev_ctx = bdev_iostat_ctx_alloc(req.per_channel == false, req.interval_ms != 0);
 		if (bdev_ctx == NULL) {
 			SPDK_ERRLOG("Failed to allocate bdev_iostat_ctx struct\n");
 			rpc_ctx->rc = -ENOMEM;
@@ -397,8 +485,7 @@ rpc_bdev_get_iostat(struct spdk_jsonrpc_request *request,
 			rpc_ctx->bdev_count++;
 			bdev_ctx->rpc_ctx = rpc_ctx;
 			if (req.per_channel == false) {
-				spdk_bdev_get_device_stat(bdev, bdev_ctx->stat, bdev_get_iostat_done,
-							  bdev_ctx);
+				bdev_get_iostat_start(bdev_ctx);
 			} else {
 				/* If per_channel is true, there is no failure after here and
 				 * we have to start RPC response before executing
@@ -424,16 +511,20 @@ rpc_bdev_get_iostat(struct spdk_jsonrpc_request *request,
 		}
 	}
 
-	if (rpc_ctx->rc == 0) {
-		/* We want to fail the RPC for all failures. If per_channel is false,
-		 * it is enough to defer starting RPC response until it is ensured that
-		 * all spdk_bdev_for_each_channel() calls will succeed or there is no bdev.
-		 */
-		rpc_get_iostat_started(rpc_ctx);
-		spdk_json_write_named_array_begin(rpc_ctx->w, "bdevs");
+	if (rpc_ctx->interval_ms != 0) {
+		if (rpc_ctx->rc == 0) {
+			rpc_ctx->poller = SPDK_POLLER_REGISTER(rpc_get_iostat_interval_end, rpc_ctx,
+							       rpc_ctx->interval_ms * SPDK_SEC_TO_USEC / 1000);
+			if (rpc_ctx->poller != NULL) {
+				return;
+			}
+			rpc_ctx->rc = -ENOMEM;
+		}
+		rpc_get_iostat_interval_end(rpc_ctx);
+		return;
 	}
 
-	rpc_get_iostat_done(rpc_ctx);
+	rpc_get_iostat_finish(rpc_ctx);
 }
 SPDK_RPC_REGISTER("bdev_get_iostat", rpc_bdev_get_iostat, SPDK_RPC_RUNTIME)
 
@@ -989,6 +1080,302 @@ cleanup:
 
 SPDK_RPC_REGISTER("bdev_set_qos_limit", rpc_bdev_set_qos_limit, SPDK_RPC_RUNTIME)
 
+struct rpc_bdev_qos_group_create {
+	char		*name;
+	uint64_t	limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+};
+
+static const struct spdk_json_object_decoder rpc_bdev_qos_group_create_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_qos_group_create, name), spdk_json_decode_string},
+	{
+		"rw_ios_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+					   limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"rw_mbytes_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+					      limits[SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"r_mbytes_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+					     limits[SPDK_BDEV_QOS_R_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"w_mbytes_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+					     limits[SPDK_BDEV_QOS_W_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+};
+
+static void
+rpc_bdev_qos_group_create(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_group_create req = {NULL, {UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX}};
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_qos_group_create_decoders,
+				    SPDK_COUNTOF(rpc_bdev_qos_group_create_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_qos_group_create(req.name, req.limits);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free(req.name);
+}
+SPDK_RPC_REGISTER("bdev_qos_group_create", rpc_bdev_qos_group_create, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_qos_group_delete {
+	char		*name;
+};
+
+static const struct spdk_json_object_decoder rpc_bdev_qos_group_delete_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_qos_group_delete, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_qos_group_delete(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_group_delete req = {};
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_qos_group_delete_decoders,
+				    SPDK_COUNTOF(rpc_bdev_qos_group_delete_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_qos_group_delete(req.name);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free(req.name);
+}
+SPDK_RPC_REGISTER("bdev_qos_group_delete", rpc_bdev_qos_group_delete, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_set_qos_group {
+	char		*name;
+	char		*group;
+	uint64_t	min_limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+};
+
+static const struct spdk_json_object_decoder rpc_bdev_set_qos_group_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_set_qos_group, name), spdk_json_decode_string},
+	{"group", offsetof(struct rpc_bdev_set_qos_group, group), spdk_json_decode_string, true},
+	{
+		"min_rw_ios_per_sec", offsetof(struct rpc_bdev_set_qos_group,
+					       min_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"min_rw_mbytes_per_sec", offsetof(struct rpc_bdev_set_qos_group,
+						  min_limits[SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"min_r_mbytes_per_sec", offsetof(struct rpc_bdev_set_qos_group,
+						 min_limits[SPDK_BDEV_QOS_R_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"min_w_mbytes_per_sec", offsetof(struct rpc_bdev_set_qos_group,
+						 min_limits[SPDK_BDEV_QOS_W_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+};
+
+static void
+rpc_bdev_set_qos_group_complete(void *cb_arg, int status)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Failed to set QoS group: %s",
+						     spdk_strerror(-status));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+
+static void
+rpc_bdev_set_qos_group(struct spdk_jsonrpc_request *request,
+		       const struct spdk_json_val *params)
+{
+	struct rpc_bdev_set_qos_group req = {NULL, NULL, {UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX}};
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_set_qos_group_decoders,
+				    SPDK_COUNTOF(rpc_bdev_set_qos_group_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.name, rc);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_bdev_set_qos_group(spdk_bdev_desc_get_bdev(desc), req.group, req.min_limits,
+				rpc_bdev_set_qos_group_complete, request);
+
+	spdk_bdev_close(desc);
+
+cleanup:
+	free(req.name);
+	free(req.group);
+}
+SPDK_RPC_REGISTER("bdev_set_qos_group", rpc_bdev_set_qos_group, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_set_qos_latency_target {
+	char		*name;
+	uint64_t	latency_target_us;
+};
+
+static const struct spdk_json_object_decoder rpc_bdev_set_qos_latency_target_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_set_qos_latency_target, name), spdk_json_decode_string},
+	{
+		"latency_target_us", offsetof(struct rpc_bdev_set_qos_latency_target, latency_target_us),
+		spdk_json_decode_uint64
+	},
+};
+
+static void
+rpc_bdev_set_qos_latency_target(struct spdk_jsonrpc_request *request,
+				const struct spdk_json_val *params)
+{
+	struct rpc_bdev_set_qos_latency_target req = {};
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_set_qos_latency_target_decoders,
+				    SPDK_COUNTOF(rpc_bdev_set_qos_latency_target_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.name, rc);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_set_qos_latency_target(spdk_bdev_desc_get_bdev(desc), req.latency_target_us);
+	spdk_bdev_close(desc);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free(req.name);
+}
+SPDK_RPC_REGISTER("bdev_set_qos_latency_target", rpc_bdev_set_qos_latency_target,
+		  SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_part_set_fairness {
+	char		*name;
+	uint32_t	weight;
+	uint32_t	base_queue_depth;
+};
+
+static const struct spdk_json_object_decoder rpc_bdev_part_set_fairness_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_part_set_fairness, name), spdk_json_decode_string},
+	{"weight", offsetof(struct rpc_bdev_part_set_fairness, weight), spdk_json_decode_uint32, true},
+	{
+		"base_queue_depth", offsetof(struct rpc_bdev_part_set_fairness, base_queue_depth),
+		spdk_json_decode_uint32, true
+	},
+};
+
+static void
+rpc_bdev_part_set_fairness(struct spdk_jsonrpc_request *request,
+			   const struct spdk_json_val *params)
+{
+	struct rpc_bdev_part_set_fairness req = {NULL, UINT32_MAX, UINT32_MAX};
+	struct spdk_bdev_desc *desc;
+	struct spdk_bdev_part *part;
+	int rc = 0;
+
+	if (spdk_json_decode_object(params, rpc_bdev_part_set_fairness_decoders,
+				    SPDK_COUNTOF(rpc_bdev_part_set_fairness_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.name, rc);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	part = bdev_part_get_by_bdev(spdk_bdev_desc_get_bdev(desc));
+	if (part == NULL) {
+		spdk_bdev_close(desc);
+		spdk_jsonrpc_send_error_response_fmt(request, -EINVAL,
+						     "Bdev '%s' is not a partition", req.name);
+		goto cleanup;
+	}
+
+	if (req.weight != UINT32_MAX) {
+		rc = spdk_bdev_part_set_weight(part, req.weight);
+	}
+	if (rc == 0 && req.base_queue_depth != UINT32_MAX) {
+		spdk_bdev_part_base_set_queue_depth(spdk_bdev_part_get_base(part),
+						    req.base_queue_depth);
+	}
+	spdk_bdev_close(desc);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free(req.name);
+}
+SPDK_RPC_REGISTER("bdev_part_set_fairness", rpc_bdev_part_set_fairness, SPDK_RPC_RUNTIME)
+
 /* SPDK_RPC_ENABLE_BDEV_HISTOGRAM */
 
 struct rpc_bdev_enable_histogram_request {
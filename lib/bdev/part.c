@@ -16,6 +16,8 @@
 
 #include "spdk/bdev_module.h"
 
+#include "bdev_internal.h"
+
 /* This namespace UUID was generated using uuid_generate() method. */
 #define BDEV_PART_NAMESPACE_UUID "976b899e-3e1e-4d71-ab69-c2b08e9df8b8"
 
@@ -34,6 +36,24 @@ struct spdk_bdev_part_base {
 	spdk_io_channel_destroy_cb	ch_destroy_cb;
 	spdk_bdev_remove_cb_t		remove_cb;
 	struct spdk_thread		*thread;
+	/* Number of I/Os each thread may submit to the base bdev, 0 if not limited */
+	uint32_t			queue_depth;
+};
+
+/*
+ * Per thread context of a part base, shared by the channels of its parts. When the
+ * queue depth of the base is reached, the channels with queued I/Os are served in deficit
+ * round robin order, each one submitting up to its part's weight of I/Os per round.
+ */
+struct bdev_part_base_channel {
+	struct spdk_io_channel				*base_ch;
+	/* I/Os submitted to the base bdev by the parts on this thread */
+	uint32_t					outstanding;
+	/* Channels with queued I/Os */
+	TAILQ_HEAD(, spdk_bdev_part_channel)		active;
+	struct spdk_bdev_io_wait_entry			nomem_wait;
+	bool						nomem;
+	bool						dispatching;
 };
 
 struct spdk_bdev *
@@ -78,6 +98,8 @@ void
 spdk_bdev_part_base_free(struct spdk_bdev_part_base *base)
 {
 	if (base->desc) {
+		spdk_io_device_unregister(base, NULL);
+
 		/* Close the underlying bdev on its same opened thread. */
 		if (base->thread && base->thread != spdk_get_thread()) {
 			spdk_thread_send_msg(base->thread, bdev_part_base_free, base->desc);
@@ -193,6 +215,96 @@ spdk_bdev_part_get_offset_blocks(struct spdk_bdev_part *part)
 	return part->internal.offset_blocks;
 }
 
+void
+spdk_bdev_part_base_set_queue_depth(struct spdk_bdev_part_base *part_base, uint32_t queue_depth)
+{
+	part_base->queue_depth = queue_depth;
+}
+
+uint32_t
+spdk_bdev_part_base_get_queue_depth(struct spdk_bdev_part_base *part_base)
+{
+	return part_base->queue_depth;
+}
+
+int
+spdk_bdev_part_set_weight(struct spdk_bdev_part *part, uint32_t weight)
+{
+	if (weight == 0 || weight > SPDK_BDEV_PART_MAX_WEIGHT) {
+		return -EINVAL;
+	}
+
+	part->internal.weight = weight;
+
+	return 0;
+}
+
+uint32_t
+spdk_bdev_part_get_weight(struct spdk_bdev_part *part)
+{
+	return part->internal.weight;
+}
+
+struct spdk_bdev_part *
+bdev_part_get_by_bdev(struct spdk_bdev *bdev)
+{
+	if (bdev->fn_table->get_io_channel != bdev_part_get_io_channel) {
+		return NULL;
+	}
+
+	return bdev->ctxt;
+}
+
+static void
+bdev_part_reset_device_stat(void *ctx)
+{
+	struct spdk_bdev_part *part = ctx;
+
+	__atomic_store_n(&part->internal.stat.queued_ios, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&part->internal.stat.queued_ticks, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&part->internal.stat.max_queued_ticks, 0, __ATOMIC_RELAXED);
+}
+
+static void
+bdev_part_dump_device_stat_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct spdk_bdev_part *part = ctx;
+
+	spdk_json_write_named_object_begin(w, "part");
+	spdk_json_write_named_uint32(w, "weight", part->internal.weight);
+	spdk_json_write_named_uint32(w, "base_queue_depth", part->internal.base->queue_depth);
+	spdk_json_write_named_uint64(w, "queued_ios",
+				     __atomic_load_n(&part->internal.stat.queued_ios, __ATOMIC_RELAXED));
+	spdk_json_write_named_uint64(w, "queued_ticks",
+				     __atomic_load_n(&part->internal.stat.queued_ticks, __ATOMIC_RELAXED));
+	spdk_json_write_named_uint64(w, "max_queued_ticks",
+				     __atomic_load_n(&part->internal.stat.max_queued_ticks, __ATOMIC_RELAXED));
+	spdk_json_write_object_end(w);
+}
+
+void
+bdev_part_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+	struct spdk_bdev_part *part = bdev_part_get_by_bdev(bdev);
+
+	if (part == NULL ||
+	    (part->internal.weight == SPDK_BDEV_PART_DEFAULT_WEIGHT &&
+	     part->internal.base->queue_depth == 0)) {
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "method", "bdev_part_set_fairness");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_string(w, "name", bdev->name);
+	spdk_json_write_named_uint32(w, "weight", part->internal.weight);
+	spdk_json_write_named_uint32(w, "base_queue_depth", part->internal.base->queue_depth);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+}
+
 static int
 bdev_part_remap_dif(struct spdk_bdev_io *bdev_io, uint32_t offset,
 		    uint32_t remapped_offset)
@@ -240,13 +352,37 @@ bdev_part_remap_dif(struct spdk_bdev_io *bdev_io, uint32_t offset,
 	return rc;
 }
 
+static void bdev_part_dispatch(struct bdev_part_base_channel *part_base_ch);
+
+static inline struct spdk_bdev_part_channel *
+bdev_part_io_get_channel(struct spdk_bdev_io *part_io)
+{
+	return spdk_io_channel_get_ctx(spdk_bdev_io_get_io_channel(part_io));
+}
+
+static void
+bdev_part_io_done(struct spdk_bdev_io *part_io, bool success)
+{
+	spdk_bdev_io_completion_cb cb;
+	int status;
+
+	cb = part_io->u.bdev.stored_user_cb;
+	if (cb != NULL) {
+		cb(part_io, success, NULL);
+	} else {
+		status = success ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED;
+
+		spdk_bdev_io_complete(part_io, status);
+	}
+}
+
 static void
 bdev_part_complete_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
 	struct spdk_bdev_io *part_io = cb_arg;
+	struct bdev_part_base_channel *part_base_ch = NULL;
 	uint32_t offset, remapped_offset;
-	spdk_bdev_io_completion_cb cb;
-	int rc, status;
+	int rc;
 
 	switch (bdev_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
@@ -268,17 +404,20 @@ bdev_part_complete_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 		break;
 	}
 
-
-	cb = part_io->u.bdev.stored_user_cb;
-	if (cb != NULL) {
-		cb(part_io, success, NULL);
-	} else {
-		status = success ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED;
-
-		spdk_bdev_io_complete(part_io, status);
+	if (part_io->type != SPDK_BDEV_IO_TYPE_RESET) {
+		part_base_ch = spdk_io_channel_get_ctx(
+				       bdev_part_io_get_channel(part_io)->internal.part_base_ch);
+		assert(part_base_ch->outstanding > 0);
+		part_base_ch->outstanding--;
 	}
 
+	bdev_part_io_done(part_io, success);
+
 	spdk_bdev_free_io(bdev_io);
+
+	if (part_base_ch != NULL && !TAILQ_EMPTY(&part_base_ch->active)) {
+		bdev_part_dispatch(part_base_ch);
+	}
 }
 
 static inline void
@@ -291,9 +430,8 @@ bdev_part_init_ext_io_opts(struct spdk_bdev_io *bdev_io, struct spdk_bdev_ext_io
 	opts->metadata = bdev_io->u.bdev.md_buf;
 }
 
-int
-spdk_bdev_part_submit_request_ext(struct spdk_bdev_part_channel *ch, struct spdk_bdev_io *bdev_io,
-				  spdk_bdev_io_completion_cb cb)
+static int
+bdev_part_submit_base_io(struct spdk_bdev_part_channel *ch, struct spdk_bdev_io *bdev_io)
 {
 	struct spdk_bdev_part *part = ch->part;
 	struct spdk_io_channel *base_ch = ch->base_ch;
@@ -302,8 +440,6 @@ spdk_bdev_part_submit_request_ext(struct spdk_bdev_part_channel *ch, struct spdk
 	uint64_t offset, remapped_offset, remapped_src_offset;
 	int rc = 0;
 
-	bdev_io->u.bdev.stored_user_cb = cb;
-
 	offset = bdev_io->u.bdev.offset_blocks;
 	remapped_offset = offset + part->internal.offset_blocks;
 
@@ -392,6 +528,171 @@ spdk_bdev_part_submit_request_ext(struct spdk_bdev_part_channel *ch, struct spdk
 	return rc;
 }
 
+static inline bool
+bdev_part_base_channel_has_slot(struct bdev_part_base_channel *part_base_ch,
+				struct spdk_bdev_part_base *base)
+{
+	return base->queue_depth == 0 || part_base_ch->outstanding < base->queue_depth;
+}
+
+static void
+bdev_part_update_queued_stat(struct spdk_bdev_part *part, struct spdk_bdev_io *bdev_io)
+{
+	uint64_t ticks, max_ticks;
+
+	ticks = spdk_get_ticks() - spdk_bdev_io_get_submit_tsc(bdev_io);
+
+	__atomic_fetch_add(&part->internal.stat.queued_ios, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&part->internal.stat.queued_ticks, ticks, __ATOMIC_RELAXED);
+
+	max_ticks = __atomic_load_n(&part->internal.stat.max_queued_ticks, __ATOMIC_RELAXED);
+	while (ticks > max_ticks &&
+	       !__atomic_compare_exchange_n(&part->internal.stat.max_queued_ticks, &max_ticks, ticks,
+					    true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+}
+
+static void
+bdev_part_dispatch_nomem_cb(void *ctx)
+{
+	struct bdev_part_base_channel *part_base_ch = ctx;
+
+	part_base_ch->nomem = false;
+	bdev_part_dispatch(part_base_ch);
+}
+
+/* Submit the queued I/Os of the parts while the base bdev has free queue slots. */
+static void
+bdev_part_dispatch(struct bdev_part_base_channel *part_base_ch)
+{
+	struct spdk_bdev_part_channel *ch;
+	struct spdk_bdev_part_base *base;
+	struct spdk_bdev_io *bdev_io;
+	int rc;
+
+	/* Completing a failed I/O may submit a new one, which is queued and then submitted by
+	 * this loop. */
+	if (part_base_ch->dispatching) {
+		return;
+	}
+
+	part_base_ch->dispatching = true;
+
+	while (!part_base_ch->nomem && !TAILQ_EMPTY(&part_base_ch->active)) {
+		ch = TAILQ_FIRST(&part_base_ch->active);
+		base = ch->part->internal.base;
+		if (!bdev_part_base_channel_has_slot(part_base_ch, base)) {
+			break;
+		}
+
+		if (ch->internal.credits == 0) {
+			ch->internal.credits = ch->part->internal.weight;
+		}
+
+		bdev_io = TAILQ_FIRST(&ch->internal.queued_io);
+		assert(bdev_io != NULL);
+		TAILQ_REMOVE(&ch->internal.queued_io, bdev_io, module_link);
+
+		rc = bdev_part_submit_base_io(ch, bdev_io);
+		if (spdk_unlikely(rc == -ENOMEM)) {
+			TAILQ_INSERT_HEAD(&ch->internal.queued_io, bdev_io, module_link);
+
+			part_base_ch->nomem_wait.bdev = base->bdev;
+			part_base_ch->nomem_wait.cb_fn = bdev_part_dispatch_nomem_cb;
+			part_base_ch->nomem_wait.cb_arg = part_base_ch;
+			rc = spdk_bdev_queue_io_wait(base->bdev, part_base_ch->base_ch,
+						     &part_base_ch->nomem_wait);
+			if (rc == 0) {
+				part_base_ch->nomem = true;
+				break;
+			}
+
+			SPDK_ERRLOG("Failed to queue I/O of part %s, rc=%d\n",
+				    ch->part->internal.bdev.name, rc);
+			TAILQ_REMOVE(&ch->internal.queued_io, bdev_io, module_link);
+			rc = -ENOMEM;
+		}
+
+		ch->internal.credits--;
+		if (TAILQ_EMPTY(&ch->internal.queued_io)) {
+			TAILQ_REMOVE(&part_base_ch->active, ch, internal.link);
+			ch->internal.active = false;
+			ch->internal.credits = 0;
+		} else if (ch->internal.credits == 0) {
+			TAILQ_REMOVE(&part_base_ch->active, ch, internal.link);
+			TAILQ_INSERT_TAIL(&part_base_ch->active, ch, internal.link);
+		}
+
+		if (spdk_likely(rc == 0)) {
+			part_base_ch->outstanding++;
+			bdev_part_update_queued_stat(ch->part, bdev_io);
+		} else {
+			bdev_part_io_done(bdev_io, false);
+		}
+	}
+
+	part_base_ch->dispatching = false;
+}
+
+/* Complete the I/Os a channel queued before a reset with an error. */
+static void
+bdev_part_abort_queued_io(struct spdk_bdev_part_channel *ch,
+			  struct bdev_part_base_channel *part_base_ch)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	if (!ch->internal.active) {
+		return;
+	}
+
+	TAILQ_REMOVE(&part_base_ch->active, ch, internal.link);
+	ch->internal.active = false;
+	ch->internal.credits = 0;
+
+	while ((bdev_io = TAILQ_FIRST(&ch->internal.queued_io)) != NULL) {
+		TAILQ_REMOVE(&ch->internal.queued_io, bdev_io, module_link);
+		bdev_part_io_done(bdev_io, false);
+	}
+}
+
+int
+spdk_bdev_part_submit_request_ext(struct spdk_bdev_part_channel *ch, struct spdk_bdev_io *bdev_io,
+				  spdk_bdev_io_completion_cb cb)
+{
+	struct bdev_part_base_channel *part_base_ch;
+	int rc;
+
+	bdev_io->u.bdev.stored_user_cb = cb;
+
+	part_base_ch = spdk_io_channel_get_ctx(ch->internal.part_base_ch);
+
+	if (spdk_unlikely(bdev_io->type == SPDK_BDEV_IO_TYPE_RESET)) {
+		bdev_part_abort_queued_io(ch, part_base_ch);
+		return bdev_part_submit_base_io(ch, bdev_io);
+	}
+
+	/* Submit the I/O right away unless the base bdev queue slots are all used or other
+	 * I/Os are already waiting for one. */
+	if (spdk_likely(TAILQ_EMPTY(&part_base_ch->active) && !part_base_ch->nomem &&
+			bdev_part_base_channel_has_slot(part_base_ch, ch->part->internal.base))) {
+		rc = bdev_part_submit_base_io(ch, bdev_io);
+		if (rc == 0) {
+			part_base_ch->outstanding++;
+		}
+		return rc;
+	}
+
+	TAILQ_INSERT_TAIL(&ch->internal.queued_io, bdev_io, module_link);
+	if (!ch->internal.active) {
+		TAILQ_INSERT_TAIL(&part_base_ch->active, ch, internal.link);
+		ch->internal.active = true;
+	}
+
+	bdev_part_dispatch(part_base_ch);
+
+	return 0;
+}
+
 int
 spdk_bdev_part_submit_request(struct spdk_bdev_part_channel *ch, struct spdk_bdev_io *bdev_io)
 {
@@ -404,14 +705,30 @@ bdev_part_channel_create_cb(void *io_device, void *ctx_buf)
 	struct spdk_bdev_part *part = (struct spdk_bdev_part *)io_device;
 	struct spdk_bdev_part_channel *ch = ctx_buf;
 
+	int rc;
+
 	ch->part = part;
 	ch->base_ch = spdk_bdev_get_io_channel(part->internal.base->desc);
 	if (ch->base_ch == NULL) {
 		return -1;
 	}
 
+	ch->internal.part_base_ch = spdk_get_io_channel(part->internal.base);
+	if (ch->internal.part_base_ch == NULL) {
+		spdk_put_io_channel(ch->base_ch);
+		return -1;
+	}
+	TAILQ_INIT(&ch->internal.queued_io);
+	ch->internal.credits = 0;
+	ch->internal.active = false;
+
 	if (part->internal.base->ch_create_cb) {
-		return part->internal.base->ch_create_cb(io_device, ctx_buf);
+		rc = part->internal.base->ch_create_cb(io_device, ctx_buf);
+		if (rc != 0) {
+			spdk_put_io_channel(ch->internal.part_base_ch);
+			spdk_put_io_channel(ch->base_ch);
+		}
+		return rc;
 	} else {
 		return 0;
 	}
@@ -426,9 +743,38 @@ bdev_part_channel_destroy_cb(void *io_device, void *ctx_buf)
 	if (part->internal.base->ch_destroy_cb) {
 		part->internal.base->ch_destroy_cb(io_device, ctx_buf);
 	}
+	assert(TAILQ_EMPTY(&ch->internal.queued_io));
+	spdk_put_io_channel(ch->internal.part_base_ch);
 	spdk_put_io_channel(ch->base_ch);
 }
 
+static int
+bdev_part_base_channel_create_cb(void *io_device, void *ctx_buf)
+{
+	struct spdk_bdev_part_base *base = io_device;
+	struct bdev_part_base_channel *part_base_ch = ctx_buf;
+
+	part_base_ch->base_ch = spdk_bdev_get_io_channel(base->desc);
+	if (part_base_ch->base_ch == NULL) {
+		return -1;
+	}
+
+	TAILQ_INIT(&part_base_ch->active);
+
+	return 0;
+}
+
+/* The part base may already be freed when its last channel is destroyed. */
+static void
+bdev_part_base_channel_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct bdev_part_base_channel *part_base_ch = ctx_buf;
+
+	assert(TAILQ_EMPTY(&part_base_ch->active));
+	assert(part_base_ch->outstanding == 0);
+	spdk_put_io_channel(part_base_ch->base_ch);
+}
+
 static void
 bdev_part_base_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
 			void *event_ctx)
@@ -468,6 +814,10 @@ spdk_bdev_part_base_construct_ext(const char *bdev_name,
 	}
 	fn_table->get_io_channel = bdev_part_get_io_channel;
 	fn_table->io_type_supported = bdev_part_io_type_supported;
+	if (fn_table->dump_device_stat_json == NULL) {
+		fn_table->dump_device_stat_json = bdev_part_dump_device_stat_json;
+		fn_table->reset_device_stat = bdev_part_reset_device_stat;
+	}
 
 	base->desc = NULL;
 	base->ref = 0;
@@ -498,6 +848,11 @@ spdk_bdev_part_base_construct_ext(const char *bdev_name,
 	/* Save the thread where the base device is opened */
 	base->thread = spdk_get_thread();
 
+	spdk_io_device_register(base, bdev_part_base_channel_create_cb,
+				bdev_part_base_channel_destroy_cb,
+				sizeof(struct bdev_part_base_channel),
+				spdk_bdev_get_name(base->bdev));
+
 	*_base = base;
 
 	return 0;
@@ -570,6 +925,7 @@ spdk_bdev_part_construct_ext(struct spdk_bdev_part *part, struct spdk_bdev_part_
 	part->internal.bdev.blocklen = base->bdev->blocklen;
 	part->internal.bdev.blockcnt = num_blocks;
 	part->internal.offset_blocks = offset_blocks;
+	part->internal.weight = SPDK_BDEV_PART_DEFAULT_WEIGHT;
 
 	part->internal.bdev.write_cache = base->bdev->write_cache;
 	part->internal.bdev.required_alignment = base->bdev->required_alignment;
@@ -127,12 +127,21 @@ iscsi_poll_group_add_conn(struct spdk_iscsi_poll_group *pg, struct spdk_iscsi_co
 	STAILQ_INSERT_TAIL(&pg->connections, conn, pg_link);
 }
 
+static int iscsi_conn_recv_next(struct spdk_iscsi_conn *conn);
+
 static void
 iscsi_poll_group_remove_conn(struct spdk_iscsi_poll_group *pg, struct spdk_iscsi_conn *conn)
 {
 	int rc;
 
 	assert(conn->sock != NULL);
+
+	/* The socket may hold buffers of this poll group which were filled but not yet
+	 * handed to the connection. Take them before leaving the socket group.
+	 */
+	while (conn->recv_next && iscsi_conn_recv_next(conn) > 0) {
+	}
+
 	rc = spdk_sock_group_remove_sock(pg->sock_group, conn->sock);
 	if (rc < 0) {
 		SPDK_ERRLOG("Failed to remove sock=%p of conn=%p\n", conn->sock, conn);
@@ -167,9 +176,8 @@ iscsi_conn_start(void *ctx)
 
 int
 iscsi_conn_construct(struct spdk_iscsi_portal *portal,
-		     struct spdk_sock *sock)
+		     struct spdk_sock *sock, struct spdk_iscsi_poll_group *pg)
 {
-	struct spdk_iscsi_poll_group *pg;
 	struct spdk_iscsi_conn *conn;
 	int i, rc;
 
@@ -191,6 +199,7 @@ iscsi_conn_construct(struct spdk_iscsi_portal *portal,
 	conn->require_chap = portal->group->require_chap;
 	conn->mutual_chap = portal->group->mutual_chap;
 	conn->chap_group = portal->group->chap_group;
+	conn->recv_next = g_iscsi.recv_buf_count > 0;
 	pthread_mutex_unlock(&g_iscsi.mutex);
 	conn->MaxRecvDataSegmentLength = 8192; /* RFC3720(12.12) */
 
@@ -218,10 +227,12 @@ iscsi_conn_construct(struct spdk_iscsi_portal *portal,
 
 	TAILQ_INIT(&conn->write_pdu_list);
 	TAILQ_INIT(&conn->snack_pdu_list);
+	TAILQ_INIT(&conn->digest_pdu_list);
 	TAILQ_INIT(&conn->queued_r2t_tasks);
 	TAILQ_INIT(&conn->active_r2t_tasks);
 	TAILQ_INIT(&conn->queued_datain_tasks);
 	TAILQ_INIT(&conn->luns);
+	STAILQ_INIT(&conn->recv_bufs);
 
 	rc = spdk_sock_getaddr(sock, conn->target_addr, sizeof conn->target_addr, NULL,
 			       conn->initiator_addr, sizeof conn->initiator_addr, NULL);
@@ -249,12 +260,16 @@ iscsi_conn_construct(struct spdk_iscsi_portal *portal,
 	SPDK_DEBUGLOG(iscsi, "Launching connection on acceptor thread\n");
 	conn->pending_task_cnt = 0;
 
-	/* Get the first poll group. */
-	pg = TAILQ_FIRST(&g_iscsi.poll_group_head);
+	/* Log in on the poll group that accepted the connection, if any. Otherwise
+	 * get the first poll group.
+	 */
 	if (pg == NULL) {
-		SPDK_ERRLOG("There is no poll group.\n");
-		assert(false);
-		goto error_return;
+		pg = TAILQ_FIRST(&g_iscsi.poll_group_head);
+		if (pg == NULL) {
+			SPDK_ERRLOG("There is no poll group.\n");
+			assert(false);
+			goto error_return;
+		}
 	}
 
 	conn->pg = pg;
@@ -293,6 +308,7 @@ iscsi_conn_free_tasks(struct spdk_iscsi_conn *conn)
 {
 	struct spdk_iscsi_pdu *pdu, *tmp_pdu;
 	struct spdk_iscsi_task *iscsi_task, *tmp_iscsi_task;
+	int rc = 0;
 
 	TAILQ_FOREACH_SAFE(pdu, &conn->snack_pdu_list, tailq, tmp_pdu) {
 		TAILQ_REMOVE(&conn->snack_pdu_list, pdu, tailq);
@@ -306,6 +322,16 @@ iscsi_conn_free_tasks(struct spdk_iscsi_conn *conn)
 		}
 	}
 
+	/* PDUs whose data digest is still being calculated are freed once it completes. */
+	TAILQ_FOREACH_SAFE(pdu, &conn->digest_pdu_list, tailq, tmp_pdu) {
+		if (pdu->data_digest_pending) {
+			rc = -1;
+		} else {
+			TAILQ_REMOVE(&conn->digest_pdu_list, pdu, tailq);
+			iscsi_conn_free_pdu(conn, pdu);
+		}
+	}
+
 	/* We have to parse conn->write_pdu_list in the end.  In iscsi_conn_free_pdu(),
 	 *  iscsi_conn_handle_queued_datain_tasks() may be called, and
 	 *  iscsi_conn_handle_queued_datain_tasks() will parse conn->queued_datain_tasks
@@ -321,7 +347,7 @@ iscsi_conn_free_tasks(struct spdk_iscsi_conn *conn)
 		return -1;
 	}
 
-	return 0;
+	return rc;
 }
 
 static void
@@ -456,6 +482,12 @@ iscsi_conn_check_tasks_for_lun(struct spdk_iscsi_conn *conn,
 		}
 	}
 
+	TAILQ_FOREACH(pdu, &conn->digest_pdu_list, tailq) {
+		if (pdu->task && lun == pdu->task->scsi.lun) {
+			return false;
+		}
+	}
+
 	return true;
 }
 
@@ -606,9 +638,14 @@ _iscsi_conn_check_shutdown(void *arg)
 static void
 _iscsi_conn_destruct(struct spdk_iscsi_conn *conn)
 {
+	struct iscsi_recv_buf *recv_buf;
 	int rc;
 
 	iscsi_poll_group_remove_conn(conn->pg, conn);
+	while ((recv_buf = STAILQ_FIRST(&conn->recv_bufs)) != NULL) {
+		STAILQ_REMOVE_HEAD(&conn->recv_bufs, link);
+		iscsi_recv_buf_put(recv_buf);
+	}
 	spdk_sock_close(&conn->sock);
 	iscsi_clear_all_transfer_task(conn, NULL, NULL);
 	spdk_poller_unregister(&conn->logout_request_timer);
@@ -1257,6 +1294,147 @@ iscsi_conn_handle_nop(struct spdk_iscsi_conn *conn)
 	}
 }
 
+static void
+_iscsi_recv_buf_provide(void *ctx)
+{
+	struct iscsi_recv_buf *recv_buf = ctx;
+
+	spdk_sock_group_provide_buf(recv_buf->pg->sock_group, recv_buf->buf, ISCSI_RECV_BUF_SIZE,
+				    recv_buf);
+}
+
+void
+iscsi_recv_buf_put(struct iscsi_recv_buf *recv_buf)
+{
+	assert(recv_buf->ref > 0);
+	if (--recv_buf->ref > 0) {
+		return;
+	}
+
+	/* A connection migrated to another poll group may still hold buffers of
+	 * the poll group it was accepted on.
+	 */
+	if (recv_buf->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(recv_buf->thread, _iscsi_recv_buf_provide, recv_buf);
+	} else {
+		_iscsi_recv_buf_provide(recv_buf);
+	}
+}
+
+/*
+ * Takes the next buffer the socket received data into and appends it to the
+ *  connection. Returns the number of bytes received, 0 if no data is available,
+ *  -ENOBUFS if the data has to be read by spdk_sock_recv() instead, or
+ *  SPDK_ISCSI_CONNECTION_FATAL.
+ */
+static int
+iscsi_conn_recv_next(struct spdk_iscsi_conn *conn)
+{
+	struct iscsi_recv_buf *recv_buf;
+	void *buf, *ctx;
+	int rc;
+
+	rc = spdk_sock_recv_next(conn->sock, &buf, &ctx);
+	if (rc > 0) {
+		recv_buf = ctx;
+		assert(recv_buf->ref == 0);
+
+		recv_buf->data = buf;
+		recv_buf->len = rc;
+		recv_buf->offset = 0;
+		recv_buf->ref = 1;
+		STAILQ_INSERT_TAIL(&conn->recv_bufs, recv_buf, link);
+
+		spdk_trace_record(TRACE_ISCSI_READ_FROM_SOCKET_DONE, conn->id, rc, 0);
+		return rc;
+	}
+
+	if (rc < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return 0;
+		}
+
+		if (errno == ENOTSUP) {
+			/* The socket reads through its receive pipe. */
+			conn->recv_next = false;
+			return -ENOBUFS;
+		}
+
+		if (errno == ENOBUFS) {
+			/* All buffers of the poll group are in use. */
+			return -ENOBUFS;
+		}
+
+		if (errno == ECONNRESET) {
+			SPDK_DEBUGLOG(iscsi, "spdk_sock_recv_next() failed, errno %d: %s\n",
+				      errno, spdk_strerror(errno));
+		} else {
+			SPDK_ERRLOG("spdk_sock_recv_next() failed, errno %d: %s\n",
+				    errno, spdk_strerror(errno));
+		}
+	}
+
+	/* connection closed */
+	return SPDK_ISCSI_CONNECTION_FATAL;
+}
+
+static void
+iscsi_conn_recv_advance(struct spdk_iscsi_conn *conn, struct iscsi_recv_buf *recv_buf,
+			uint32_t len)
+{
+	assert(recv_buf == STAILQ_FIRST(&conn->recv_bufs));
+	assert(recv_buf->offset + len <= recv_buf->len);
+
+	recv_buf->offset += len;
+	if (recv_buf->offset == recv_buf->len) {
+		STAILQ_REMOVE_HEAD(&conn->recv_bufs, link);
+		iscsi_recv_buf_put(recv_buf);
+	}
+}
+
+/* Copy received data out of the receive buffers, taking more of them from the socket
+ * until the request is satisfied. Returns -ENOBUFS if nothing was copied and the
+ * data has to be read by spdk_sock_recv() instead.
+ */
+static int
+iscsi_conn_recv_copy(struct spdk_iscsi_conn *conn, struct iovec *iov, int iovcnt)
+{
+	struct iscsi_recv_buf *recv_buf;
+	struct spdk_iov_xfer ix;
+	uint32_t total, copied, len;
+	int i, rc = 0;
+
+	for (i = 0, total = 0; i < iovcnt; i++) {
+		total += iov[i].iov_len;
+	}
+
+	spdk_iov_xfer_init(&ix, iov, iovcnt);
+	copied = 0;
+
+	while (copied < total) {
+		recv_buf = STAILQ_FIRST(&conn->recv_bufs);
+		if (recv_buf == NULL) {
+			if (!conn->recv_next) {
+				rc = -ENOBUFS;
+				break;
+			}
+
+			rc = iscsi_conn_recv_next(conn);
+			if (rc <= 0) {
+				break;
+			}
+			recv_buf = STAILQ_FIRST(&conn->recv_bufs);
+		}
+
+		len = spdk_min(total - copied, recv_buf->len - recv_buf->offset);
+		spdk_iov_xfer_from_buf(&ix, recv_buf->data + recv_buf->offset, len);
+		copied += len;
+		iscsi_conn_recv_advance(conn, recv_buf, len);
+	}
+
+	return copied > 0 ? (int)copied : rc;
+}
+
 /**
  * \brief Reads data for the specified iSCSI connection from its TCP socket.
  *
@@ -1273,12 +1451,23 @@ int
 iscsi_conn_read_data(struct spdk_iscsi_conn *conn, int bytes,
 		     void *buf)
 {
+	struct iovec iov;
 	int ret;
 
 	if (bytes == 0) {
 		return 0;
 	}
 
+	if (conn->recv_next || !STAILQ_EMPTY(&conn->recv_bufs)) {
+		iov.iov_base = buf;
+		iov.iov_len = bytes;
+
+		ret = iscsi_conn_recv_copy(conn, &iov, 1);
+		if (ret != -ENOBUFS) {
+			return ret;
+		}
+	}
+
 	ret = spdk_sock_recv(conn->sock, buf, bytes);
 
 	if (ret > 0) {
@@ -1320,6 +1509,13 @@ iscsi_conn_readv_data(struct spdk_iscsi_conn *conn,
 					    iov[0].iov_base);
 	}
 
+	if (conn->recv_next || !STAILQ_EMPTY(&conn->recv_bufs)) {
+		ret = iscsi_conn_recv_copy(conn, iov, iovcnt);
+		if (ret != -ENOBUFS) {
+			return ret;
+		}
+	}
+
 	ret = spdk_sock_readv(conn->sock, iov, iovcnt);
 
 	if (ret > 0) {
@@ -1346,6 +1542,39 @@ iscsi_conn_readv_data(struct spdk_iscsi_conn *conn,
 	return SPDK_ISCSI_CONNECTION_FATAL;
 }
 
+/*
+ * Returns the received data of the given length in place if the first receive
+ *  buffer of the connection holds all of it, and takes a reference to the buffer.
+ *  Returns NULL if the data has to be copied out instead.
+ */
+void *
+iscsi_conn_recv_zcopy(struct spdk_iscsi_conn *conn, uint32_t len,
+		      struct iscsi_recv_buf **_recv_buf)
+{
+	struct iscsi_recv_buf *recv_buf;
+	void *data;
+
+	recv_buf = STAILQ_FIRST(&conn->recv_bufs);
+	if (recv_buf == NULL) {
+		if (!conn->recv_next || iscsi_conn_recv_next(conn) <= 0) {
+			return NULL;
+		}
+		recv_buf = STAILQ_FIRST(&conn->recv_bufs);
+	}
+
+	if (recv_buf->len - recv_buf->offset < len) {
+		return NULL;
+	}
+
+	data = recv_buf->data + recv_buf->offset;
+	recv_buf->ref++;
+	*_recv_buf = recv_buf;
+
+	iscsi_conn_recv_advance(conn, recv_buf, len);
+
+	return data;
+}
+
 static bool
 iscsi_is_free_pdu_deferred(struct spdk_iscsi_pdu *pdu)
 {
@@ -1420,6 +1649,78 @@ iscsi_conn_pdu_generic_complete(void *cb_arg)
 {
 }
 
+static void
+iscsi_conn_submit_pdu(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
+{
+	TAILQ_INSERT_TAIL(&conn->write_pdu_list, pdu, tailq);
+
+	if (spdk_unlikely(conn->state >= ISCSI_CONN_STATE_EXITING)) {
+		return;
+	}
+	pdu->sock_req.iovcnt = iscsi_build_iovs(conn, pdu->iov, SPDK_COUNTOF(pdu->iov), pdu,
+						&pdu->mapped_length);
+	pdu->sock_req.cb_fn = _iscsi_conn_pdu_write_done;
+	pdu->sock_req.cb_arg = pdu;
+
+	spdk_trace_record(TRACE_ISCSI_FLUSH_WRITEBUF_START, conn->id, pdu->mapped_length, (uintptr_t)pdu,
+			  pdu->sock_req.iovcnt);
+	spdk_sock_writev_async(conn->sock, &pdu->sock_req);
+}
+
+static void
+iscsi_conn_data_digest_done(void *cb_arg, int status)
+{
+	struct spdk_iscsi_pdu *pdu = cb_arg;
+	struct spdk_iscsi_conn *conn = pdu->conn;
+	uint32_t crc32c;
+
+	assert(pdu->data_digest_pending);
+	pdu->data_digest_pending = false;
+
+	if (spdk_unlikely(status != 0)) {
+		SPDK_ERRLOG("Failed to offload data digest of pdu=%p on conn=%p, rc=%d\n",
+			    pdu, conn, status);
+		crc32c = iscsi_pdu_calc_data_digest(pdu);
+	} else {
+		crc32c = pdu->crc32c ^ SPDK_CRC32C_XOR;
+	}
+	MAKE_DIGEST_WORD(pdu->data_digest, crc32c);
+
+	/* Submit PDUs in order, up to the next one still waiting for its digest. */
+	while ((pdu = TAILQ_FIRST(&conn->digest_pdu_list)) != NULL &&
+	       !pdu->data_digest_pending) {
+		TAILQ_REMOVE(&conn->digest_pdu_list, pdu, tailq);
+		iscsi_conn_submit_pdu(conn, pdu);
+	}
+}
+
+static bool
+iscsi_conn_offload_data_digest(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
+{
+	uint32_t data_len = DGET24(pdu->bhs.data_segment_len);
+	int rc;
+
+	/* Padding and DIF are handled only by the inline calculation. */
+	if (conn->pg == NULL || conn->pg->accel_channel == NULL ||
+	    pdu->dif_insert_or_strip || data_len % ISCSI_ALIGNMENT != 0) {
+		return false;
+	}
+
+	pdu->data_digest_pending = true;
+	pdu->data_digest_iov.iov_base = pdu->data;
+	pdu->data_digest_iov.iov_len = data_len;
+	TAILQ_INSERT_TAIL(&conn->digest_pdu_list, pdu, tailq);
+
+	rc = spdk_accel_digest_crc32c(conn->pg->accel_channel, &pdu->crc32c,
+				      &pdu->data_digest_iov, 1, &conn->digest_stats,
+				      iscsi_conn_data_digest_done, pdu);
+	if (spdk_unlikely(rc != 0)) {
+		iscsi_conn_data_digest_done(pdu, rc);
+	}
+
+	return true;
+}
+
 void
 iscsi_conn_write_pdu(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu,
 		     iscsi_conn_xfer_complete_cb cb_fn,
@@ -1437,6 +1738,9 @@ iscsi_conn_write_pdu(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu,
 		}
 	}
 
+	pdu->cb_fn = cb_fn;
+	pdu->cb_arg = cb_arg;
+
 	if (pdu->bhs.opcode != ISCSI_OP_LOGIN_RSP) {
 		/* Header Digest */
 		if (conn->header_digest) {
@@ -1446,26 +1750,24 @@ iscsi_conn_write_pdu(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu,
 
 		/* Data Digest */
 		if (conn->data_digest && DGET24(pdu->bhs.data_segment_len) != 0) {
+			if (conn->state < ISCSI_CONN_STATE_EXITING &&
+			    iscsi_conn_offload_data_digest(conn, pdu)) {
+				return;
+			}
 			crc32c = iscsi_pdu_calc_data_digest(pdu);
 			MAKE_DIGEST_WORD(pdu->data_digest, crc32c);
+			conn->digest_stats.inlined++;
 		}
 	}
 
-	pdu->cb_fn = cb_fn;
-	pdu->cb_arg = cb_arg;
-	TAILQ_INSERT_TAIL(&conn->write_pdu_list, pdu, tailq);
-
-	if (spdk_unlikely(conn->state >= ISCSI_CONN_STATE_EXITING)) {
+	/* Don't overtake PDUs which are still waiting for their data digest. */
+	if (!TAILQ_EMPTY(&conn->digest_pdu_list) &&
+	    spdk_likely(conn->state < ISCSI_CONN_STATE_EXITING)) {
+		TAILQ_INSERT_TAIL(&conn->digest_pdu_list, pdu, tailq);
 		return;
 	}
-	pdu->sock_req.iovcnt = iscsi_build_iovs(conn, pdu->iov, SPDK_COUNTOF(pdu->iov), pdu,
-						&pdu->mapped_length);
-	pdu->sock_req.cb_fn = _iscsi_conn_pdu_write_done;
-	pdu->sock_req.cb_arg = pdu;
 
-	spdk_trace_record(TRACE_ISCSI_FLUSH_WRITEBUF_START, conn->id, pdu->mapped_length, (uintptr_t)pdu,
-			  pdu->sock_req.iovcnt);
-	spdk_sock_writev_async(conn->sock, &pdu->sock_req);
+	iscsi_conn_submit_pdu(conn, pdu);
 }
 
 static void
@@ -1488,6 +1790,17 @@ iscsi_conn_sock_cb(void *arg, struct spdk_sock_group *group, struct spdk_sock *s
 	}
 }
 
+void
+iscsi_conn_handle_recv_bufs(struct spdk_iscsi_conn *conn)
+{
+	/* Data already taken off the socket does not raise another socket event.
+	 * Keep handling the connection until its receive buffers are consumed.
+	 */
+	if (!STAILQ_EMPTY(&conn->recv_bufs)) {
+		iscsi_conn_sock_cb(conn, NULL, NULL);
+	}
+}
+
 static void
 iscsi_conn_full_feature_migrate(void *arg)
 {
@@ -1518,6 +1831,24 @@ iscsi_conn_full_feature_migrate(void *arg)
 
 static struct spdk_iscsi_poll_group *g_next_pg = NULL;
 
+/* Returns the poll group the sock implementation prefers for the socket of the connection,
+ * e.g. the one already polling sockets of the same NIC receive queue, or hint if there's
+ * no such preference.
+ */
+static struct spdk_iscsi_poll_group *
+iscsi_conn_get_optimal_pg(struct spdk_iscsi_conn *conn, struct spdk_iscsi_poll_group *hint)
+{
+	struct spdk_sock_group *group = NULL;
+	int rc;
+
+	rc = spdk_sock_get_optimal_sock_group(conn->sock, &group, hint->sock_group);
+	if (rc != 0 || group == NULL) {
+		return hint;
+	}
+
+	return spdk_sock_group_get_ctx(group);
+}
+
 void
 iscsi_conn_schedule(struct spdk_iscsi_conn *conn)
 {
@@ -1529,6 +1860,16 @@ iscsi_conn_schedule(struct spdk_iscsi_conn *conn)
 		 * thread. */
 		return;
 	}
+
+	assert(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(conn->pg)) ==
+	       spdk_get_thread());
+
+	/* Remove this connection from the previous poll group. Do it before picking
+	 * the new one, so the placement ID of the socket is no longer bound to the
+	 * poll group that accepted it.
+	 */
+	iscsi_poll_group_remove_conn(conn->pg, conn);
+
 	pthread_mutex_lock(&g_iscsi.mutex);
 
 	target = conn->sess->target;
@@ -1557,13 +1898,13 @@ iscsi_conn_schedule(struct spdk_iscsi_conn *conn)
 	}
 
 	pthread_mutex_unlock(&target->mutex);
-	pthread_mutex_unlock(&g_iscsi.mutex);
 
-	assert(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(conn->pg)) ==
-	       spdk_get_thread());
+	/* If the sock implementation has placement IDs enabled, prefer the poll group
+	 * handling the same NIC receive queue. Otherwise this keeps the pg picked above.
+	 */
+	pg = iscsi_conn_get_optimal_pg(conn, pg);
 
-	/* Remove this connection from the previous poll group */
-	iscsi_poll_group_remove_conn(conn->pg, conn);
+	pthread_mutex_unlock(&g_iscsi.mutex);
 
 	conn->pg = pg;
 
@@ -1684,5 +2025,9 @@ iscsi_conn_info_json(struct spdk_json_write_ctx *w, struct spdk_iscsi_conn *conn
 	spdk_json_write_named_string(w, "thread_name",
 				     spdk_thread_get_name(spdk_get_thread()));
 
+	spdk_json_write_named_uint64(w, "offloaded_data_digests", conn->digest_stats.offloaded);
+
+	spdk_json_write_named_uint64(w, "inline_data_digests", conn->digest_stats.inlined);
+
 	spdk_json_write_object_end(w);
 }
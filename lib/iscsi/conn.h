@@ -13,6 +13,7 @@
 #include "spdk/queue.h"
 #include "spdk/cpuset.h"
 #include "spdk/scsi.h"
+#include "spdk/accel.h"
 
 #include "spdk_internal/trace_defs.h"
 
@@ -100,9 +101,21 @@ struct spdk_iscsi_conn {
 	struct spdk_iscsi_pdu *pdu_in_progress;
 	enum iscsi_pdu_recv_state pdu_recv_state;
 
+	/* Receive data by spdk_sock_recv_next() into the buffers provided to the poll
+	 *  group, and the buffers whose data is not consumed yet.
+	 */
+	bool recv_next;
+	STAILQ_HEAD(, iscsi_recv_buf) recv_bufs;
+
 	TAILQ_HEAD(, spdk_iscsi_pdu) write_pdu_list;
 	TAILQ_HEAD(, spdk_iscsi_pdu) snack_pdu_list;
 
+	/* PDUs whose data digest is being offloaded, and PDUs queued behind them
+	 *  to keep the order on the wire.
+	 */
+	TAILQ_HEAD(, spdk_iscsi_pdu) digest_pdu_list;
+	struct spdk_accel_digest_stats digest_stats;
+
 	uint32_t pending_r2t;
 
 	uint16_t cid;
@@ -179,7 +192,8 @@ void shutdown_iscsi_conns(void);
 void iscsi_conns_request_logout(struct spdk_iscsi_tgt_node *target, int pg_tag);
 int iscsi_get_active_conns(struct spdk_iscsi_tgt_node *target);
 
-int iscsi_conn_construct(struct spdk_iscsi_portal *portal, struct spdk_sock *sock);
+int iscsi_conn_construct(struct spdk_iscsi_portal *portal, struct spdk_sock *sock,
+			 struct spdk_iscsi_poll_group *pg);
 void iscsi_conn_destruct(struct spdk_iscsi_conn *conn);
 void iscsi_conn_handle_nop(struct spdk_iscsi_conn *conn);
 void iscsi_conn_schedule(struct spdk_iscsi_conn *conn);
@@ -196,6 +210,10 @@ int iscsi_conn_abort_queued_datain_tasks(struct spdk_iscsi_conn *conn,
 int iscsi_conn_read_data(struct spdk_iscsi_conn *conn, int len, void *buf);
 int iscsi_conn_readv_data(struct spdk_iscsi_conn *conn,
 			  struct iovec *iov, int iovcnt);
+void *iscsi_conn_recv_zcopy(struct spdk_iscsi_conn *conn, uint32_t len,
+			    struct iscsi_recv_buf **recv_buf);
+void iscsi_conn_handle_recv_bufs(struct spdk_iscsi_conn *conn);
+void iscsi_recv_buf_put(struct iscsi_recv_buf *recv_buf);
 void iscsi_conn_write_pdu(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu,
 			  iscsi_conn_xfer_complete_cb cb_fn,
 			  void *cb_arg);
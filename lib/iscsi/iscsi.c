@@ -3234,7 +3234,7 @@ iscsi_pdu_payload_op_scsi_read(struct spdk_iscsi_conn *conn, struct spdk_iscsi_t
 
 static int
 iscsi_submit_write_subtask(struct spdk_iscsi_conn *conn, struct spdk_iscsi_task *task,
-			   struct spdk_iscsi_pdu *pdu, struct spdk_mobj *mobj)
+			   struct spdk_iscsi_pdu *pdu, void *data, uint32_t data_len)
 {
 	struct spdk_iscsi_task *subtask;
 
@@ -3244,15 +3244,15 @@ iscsi_submit_write_subtask(struct spdk_iscsi_conn *conn, struct spdk_iscsi_task
 		return SPDK_ISCSI_CONNECTION_FATAL;
 	}
 	subtask->scsi.offset = task->current_data_offset;
-	subtask->scsi.length = mobj->data_len;
+	subtask->scsi.length = data_len;
 	iscsi_task_associate_pdu(subtask, pdu);
 
-	task->current_data_offset += mobj->data_len;
+	task->current_data_offset += data_len;
 
 	if (spdk_likely(!pdu->dif_insert_or_strip)) {
-		spdk_scsi_task_set_data(&subtask->scsi, mobj->buf, mobj->data_len);
+		spdk_scsi_task_set_data(&subtask->scsi, data, data_len);
 	} else {
-		spdk_scsi_task_set_data(&subtask->scsi, mobj->buf, pdu->data_buf_len);
+		spdk_scsi_task_set_data(&subtask->scsi, data, pdu->data_buf_len);
 	}
 
 	iscsi_queue_task(conn, subtask);
@@ -3295,7 +3295,7 @@ iscsi_pdu_payload_op_scsi_write(struct spdk_iscsi_conn *conn, struct spdk_iscsi_
 				pdu->mobj[0] = NULL;
 			} else {
 				/* we are doing the first partial write task */
-				rc = iscsi_submit_write_subtask(conn, task, pdu, mobj);
+				rc = iscsi_submit_write_subtask(conn, task, pdu, mobj->buf, mobj->data_len);
 				if (rc < 0) {
 					iscsi_task_put(task);
 					return SPDK_ISCSI_CONNECTION_FATAL;
@@ -4325,6 +4325,13 @@ iscsi_pdu_payload_op_data(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *p
 		return iscsi_reject(conn, pdu, ISCSI_REASON_PROTOCOL_ERROR);
 	}
 
+	if (pdu->recv_buf != NULL) {
+		/* The data segment stays in the receive buffer and cannot be merged with
+		 * the following Data-OUT PDUs. Submit it as a subtask of its own.
+		 */
+		return iscsi_submit_write_subtask(conn, task, pdu, pdu->data, pdu->data_segment_len);
+	}
+
 	/* If current PDU is final in a sequence, submit all received data,
 	 * otherwise, continue aggregation until the first data buffer is full.
 	 * We do not use SGL and instead create a subtask per data buffer. Hence further
@@ -4335,7 +4342,7 @@ iscsi_pdu_payload_op_data(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *p
 
 	if (F_bit || mobj->data_len >= SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH ||
 	    pdu->dif_insert_or_strip) {
-		rc = iscsi_submit_write_subtask(conn, task, pdu, mobj);
+		rc = iscsi_submit_write_subtask(conn, task, pdu, mobj->buf, mobj->data_len);
 		if (rc != 0) {
 			return rc;
 		}
@@ -4355,7 +4362,7 @@ iscsi_pdu_payload_op_data(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *p
 	assert(mobj->data_len < SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH);
 
 	if (F_bit) {
-		return iscsi_submit_write_subtask(conn, task, pdu, mobj);
+		return iscsi_submit_write_subtask(conn, task, pdu, mobj->buf, mobj->data_len);
 	} else {
 		iscsi_task_set_mobj(task, mobj);
 		pdu->mobj[1] = NULL;
@@ -4601,17 +4608,43 @@ iscsi_pdu_payload_handle(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pd
 	return rc;
 }
 
-/* Return zero if completed to read payload, positive number if still in progress,
+/* Take the data segment of a Data-OUT PDU in place from the receive buffer of the
+ * connection if it is received entirely and is not merged with the preceding PDUs.
+ */
+static bool
+iscsi_pdu_payload_zcopy(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
+{
+	void *data;
+
+	if (pdu->bhs.opcode != ISCSI_OP_SCSI_DATAOUT || pdu->is_rejected ||
+	    pdu->dif_insert_or_strip || pdu->mobj[0] != NULL || pdu->data_valid_bytes != 0) {
+		return false;
+	}
+
+	data = iscsi_conn_recv_zcopy(conn, pdu->data_segment_len, &pdu->recv_buf);
+	if (data == NULL) {
+		return false;
+	}
+
+	pdu->data = data;
+	pdu->data_buf_len = pdu->data_segment_len;
+	pdu->data_valid_bytes = pdu->data_segment_len;
+	/* The data buffer is not allocated by malloc() and must not be freed. */
+	pdu->data_from_mempool = true;
+
+	return true;
+}
+
+/* Return zero if completed to read data segment, positive number if still in progress,
  * or negative number if any error.
  */
 static int
-iscsi_pdu_payload_read(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
+iscsi_pdu_payload_read_data(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 {
 	struct spdk_mempool *pool;
 	struct spdk_mobj *mobj;
 	uint32_t data_len;
 	uint32_t read_len;
-	uint32_t crc32c;
 	int rc;
 	uint32_t data_buf_len;
 
@@ -4684,6 +4717,25 @@ iscsi_pdu_payload_read(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 		}
 	}
 
+	return 0;
+}
+
+/* Return zero if completed to read payload, positive number if still in progress,
+ * or negative number if any error.
+ */
+static int
+iscsi_pdu_payload_read(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
+{
+	uint32_t crc32c;
+	int rc;
+
+	if (pdu->recv_buf == NULL && !iscsi_pdu_payload_zcopy(conn, pdu)) {
+		rc = iscsi_pdu_payload_read_data(conn, pdu);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
 	/* copy out the data digest */
 	if (conn->data_digest &&
 	    pdu->ddigest_valid_bytes < ISCSI_DIGEST_LEN) {
@@ -49,6 +49,7 @@
 #define DEFAULT_TIMEOUT 60
 #define MAX_NOPININTERVAL 60
 #define DEFAULT_NOPININTERVAL 30
+#define DEFAULT_INTERRUPT_BUSY_POLL_US 100
 
 /*
  * SPDK iSCSI target currently only supports 64KB as the maximum data segment length
@@ -62,6 +63,12 @@
  */
 #define MAX_DATA_OUT_PER_CONNECTION 16
 
+/*
+ * Defines the size of the receive buffers provided to the socket group of each
+ *  poll group. It holds a maximum sized data segment together with its header.
+ */
+#define ISCSI_RECV_BUF_SIZE	(2 * SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH)
+
 /*
  * Defines default maximum number of data in buffers each connection can have in
  *  use at any given time. So this limit does not affect I/O smaller than
@@ -122,6 +129,25 @@ struct spdk_mobj {
 	uint32_t data_len;
 };
 
+/*
+ * Buffer provided to the socket group of a poll group. The socket fills it and hands
+ * it to a connection by spdk_sock_recv_next(). The data segment of a Data-OUT PDU
+ * may be submitted from it in place, so it is returned to the socket group only
+ * after all references are dropped.
+ */
+struct iscsi_recv_buf {
+	struct spdk_iscsi_poll_group	*pg;
+	struct spdk_thread		*thread;
+	void				*buf;
+
+	/* Received data and the number of bytes already consumed by the connection. */
+	uint8_t				*data;
+	uint32_t			len;
+	uint32_t			offset;
+	uint32_t			ref;
+	STAILQ_ENTRY(iscsi_recv_buf)	link;
+};
+
 /*
  * Maximum number of SGL elements, i.e.,
  * BHS, AHS, Header Digest, Data Segment and Data Digest.
@@ -145,6 +171,9 @@ struct spdk_iscsi_pdu {
 	 */
 	struct spdk_mobj *mobj[2];
 
+	/* Receive buffer holding the data segment if it was received in place. */
+	struct iscsi_recv_buf *recv_buf;
+
 	bool is_rejected;
 	uint8_t *data;
 	uint8_t header_digest[ISCSI_DIGEST_LEN];
@@ -163,6 +192,9 @@ struct spdk_iscsi_pdu {
 	uint32_t data_buf_len;
 	uint32_t data_offset;
 	uint32_t crc32c;
+	/* Data digest of an outgoing PDU is being calculated by the accel framework. */
+	bool data_digest_pending;
+	struct iovec data_digest_iov;
 	bool dif_insert_or_strip;
 	struct spdk_dif_ctx dif_ctx;
 	struct spdk_iscsi_conn *conn;
@@ -219,6 +251,13 @@ enum session_type {
 #define ISCSI_CHAP_MAX_USER_LEN		255
 #define ISCSI_CHAP_MAX_SECRET_LEN	255
 
+/*
+ * TLS 1.3 PSK for the portals. Its length selects the cipher suite,
+ * 32 bytes for TLS_AES_128_GCM_SHA256 and 48 bytes for TLS_AES_256_GCM_SHA384.
+ */
+#define ISCSI_TLS_PSK_MIN_LEN		32
+#define ISCSI_TLS_PSK_MAX_LEN		48
+
 struct iscsi_chap_auth {
 	enum iscsi_chap_phase chap_phase;
 
@@ -282,11 +321,30 @@ struct spdk_iscsi_sess {
 	uint32_t current_text_itt;
 };
 
+struct iscsi_portal_acceptor;
+
 struct spdk_iscsi_poll_group {
 	struct spdk_poller				*poller;
 	struct spdk_poller				*nop_poller;
 	STAILQ_HEAD(connections, spdk_iscsi_conn)	connections;
 	struct spdk_sock_group				*sock_group;
+	struct spdk_io_channel				*accel_channel;
+	bool						in_interrupt;
+	/* Keeps the poll group busy polled if it can't wait for socket events. */
+	struct spdk_interrupt				*busy_intr;
+	int						busy_efd;
+	struct iscsi_recv_buf				*recv_bufs;
+	void						*recv_buf_mem;
+
+	struct spdk_thread				*thread;
+
+	/* Listening sockets of the portals this poll group accepts connections
+	 * from, if reuseport is enabled. Portals are opened and closed by another
+	 * thread, which attaches and detaches the sockets with messages to the
+	 * thread of the poll group.
+	 */
+	TAILQ_HEAD(, iscsi_portal_acceptor)		acceptors;
+	struct spdk_poller				*acceptor_poller;
 	TAILQ_ENTRY(spdk_iscsi_poll_group)		link;
 };
 
@@ -314,6 +372,13 @@ struct spdk_iscsi_opts {
 	uint32_t pdu_pool_size;
 	uint32_t immediate_data_pool_size;
 	uint32_t data_out_pool_size;
+	uint32_t recv_buf_count;
+	bool reuseport;
+	uint32_t interrupt_busy_poll_us;
+	bool tls;
+	bool ktls;
+	char *tls_psk_identity;
+	char *tls_psk_path;
 };
 
 struct spdk_iscsi_globals {
@@ -350,6 +415,15 @@ struct spdk_iscsi_globals {
 	uint32_t pdu_pool_size;
 	uint32_t immediate_data_pool_size;
 	uint32_t data_out_pool_size;
+	uint32_t recv_buf_count;
+	bool reuseport;
+	uint32_t interrupt_busy_poll_us;
+	bool tls;
+	bool ktls;
+	char *tls_psk_identity;
+	char *tls_psk_path;
+	uint8_t tls_psk[ISCSI_TLS_PSK_MAX_LEN];
+	uint32_t tls_psk_size;
 
 	struct spdk_mempool *pdu_pool;
 	struct spdk_mempool *pdu_immediate_data_pool;
@@ -10,6 +10,7 @@
 #include "iscsi/portal_grp.h"
 #include "iscsi/init_grp.h"
 
+#include "spdk/base64.h"
 #include "spdk/rpc.h"
 #include "spdk/util.h"
 #include "spdk/string.h"
@@ -987,6 +988,117 @@ rpc_iscsi_get_connections(struct spdk_jsonrpc_request *request,
 }
 SPDK_RPC_REGISTER("iscsi_get_connections", rpc_iscsi_get_connections, SPDK_RPC_RUNTIME)
 
+struct rpc_iscsi_get_sock_flush_histogram_ctx {
+	struct spdk_jsonrpc_request *request;
+	struct spdk_histogram_data *histogram;
+};
+
+static void
+_rpc_iscsi_get_sock_flush_histogram_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct rpc_iscsi_get_sock_flush_histogram_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_histogram_data *histogram = ctx->histogram;
+	struct spdk_json_write_ctx *w;
+	char *encoded_histogram = NULL;
+	size_t src_len, dst_len;
+	int rc;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 spdk_strerror(-status));
+		goto exit;
+	}
+
+	if (histogram == NULL) {
+		spdk_jsonrpc_send_error_response(ctx->request, -ENODEV, "No poll group found");
+		goto exit;
+	}
+
+	src_len = SPDK_HISTOGRAM_NUM_BUCKETS(histogram) * sizeof(uint64_t);
+	dst_len = spdk_base64_get_encoded_strlen(src_len) + 1;
+
+	encoded_histogram = malloc(dst_len);
+	if (encoded_histogram == NULL) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 spdk_strerror(ENOMEM));
+		goto exit;
+	}
+
+	rc = spdk_base64_encode(encoded_histogram, histogram->bucket, src_len);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 spdk_strerror(-rc));
+		goto exit;
+	}
+
+	w = spdk_jsonrpc_begin_result(ctx->request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "histogram", encoded_histogram);
+	spdk_json_write_named_int64(w, "bucket_shift", histogram->bucket_shift);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(ctx->request, w);
+
+exit:
+	free(encoded_histogram);
+	if (histogram != NULL) {
+		spdk_histogram_data_free(histogram);
+	}
+	free(ctx);
+}
+
+static void
+_rpc_iscsi_get_sock_flush_histogram(struct spdk_io_channel_iter *i)
+{
+	struct rpc_iscsi_get_sock_flush_histogram_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_iscsi_poll_group *pg = spdk_io_channel_get_ctx(ch);
+	const struct spdk_histogram_data *histogram;
+	int rc;
+
+	histogram = spdk_sock_group_get_flush_histogram(pg->sock_group);
+
+	if (ctx->histogram == NULL) {
+		ctx->histogram = spdk_histogram_data_alloc_sized(histogram->bucket_shift);
+		if (ctx->histogram == NULL) {
+			spdk_for_each_channel_continue(i, -ENOMEM);
+			return;
+		}
+	}
+
+	rc = spdk_histogram_data_merge(ctx->histogram, histogram);
+
+	spdk_for_each_channel_continue(i, rc);
+}
+
+static void
+rpc_iscsi_get_sock_flush_histogram(struct spdk_jsonrpc_request *request,
+				   const struct spdk_json_val *params)
+{
+	struct rpc_iscsi_get_sock_flush_histogram_ctx *ctx;
+
+	if (params != NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "iscsi_get_sock_flush_histogram requires no parameters");
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		SPDK_ERRLOG("Failed to allocate rpc_iscsi_get_sock_flush_histogram_ctx struct\n");
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	ctx->request = request;
+
+	spdk_for_each_channel(&g_iscsi,
+			      _rpc_iscsi_get_sock_flush_histogram,
+			      ctx,
+			      _rpc_iscsi_get_sock_flush_histogram_done);
+}
+SPDK_RPC_REGISTER("iscsi_get_sock_flush_histogram", rpc_iscsi_get_sock_flush_histogram,
+		  SPDK_RPC_RUNTIME)
+
 struct rpc_target_lun {
 	char *name;
 	char *bdev_name;
@@ -1653,6 +1765,13 @@ static const struct spdk_json_object_decoder rpc_set_iscsi_opts_decoders[] = {
 	{"pdu_pool_size", offsetof(struct spdk_iscsi_opts, pdu_pool_size), spdk_json_decode_uint32, true},
 	{"immediate_data_pool_size", offsetof(struct spdk_iscsi_opts, immediate_data_pool_size), spdk_json_decode_uint32, true},
 	{"data_out_pool_size", offsetof(struct spdk_iscsi_opts, data_out_pool_size), spdk_json_decode_uint32, true},
+	{"recv_buf_count", offsetof(struct spdk_iscsi_opts, recv_buf_count), spdk_json_decode_uint32, true},
+	{"reuseport", offsetof(struct spdk_iscsi_opts, reuseport), spdk_json_decode_bool, true},
+	{"interrupt_busy_poll_us", offsetof(struct spdk_iscsi_opts, interrupt_busy_poll_us), spdk_json_decode_uint32, true},
+	{"tls", offsetof(struct spdk_iscsi_opts, tls), spdk_json_decode_bool, true},
+	{"ktls", offsetof(struct spdk_iscsi_opts, ktls), spdk_json_decode_bool, true},
+	{"tls_psk_identity", offsetof(struct spdk_iscsi_opts, tls_psk_identity), spdk_json_decode_string, true},
+	{"tls_psk_path", offsetof(struct spdk_iscsi_opts, tls_psk_path), spdk_json_decode_string, true},
 };
 
 static void
@@ -6,6 +6,8 @@
 
 #include "spdk/string.h"
 #include "spdk/likely.h"
+#include "spdk/hexlify.h"
+#include "spdk/accel.h"
 
 #include "iscsi/iscsi.h"
 #include "iscsi/init_grp.h"
@@ -208,6 +210,9 @@ iscsi_put_pdu(struct spdk_iscsi_pdu *pdu)
 		if (pdu->mobj[1]) {
 			iscsi_datapool_put(pdu->mobj[1]);
 		}
+		if (pdu->recv_buf) {
+			iscsi_recv_buf_put(pdu->recv_buf);
+		}
 
 		if (pdu->data && !pdu->data_from_mempool) {
 			free(pdu->data);
@@ -290,6 +295,20 @@ iscsi_log_globals(void)
 
 	SPDK_DEBUGLOG(iscsi, "MaxR2TPerConnection %d\n",
 		      g_iscsi.MaxR2TPerConnection);
+
+	SPDK_DEBUGLOG(iscsi, "RecvBufCount %d\n", g_iscsi.recv_buf_count);
+
+	SPDK_DEBUGLOG(iscsi, "ReusePort %s\n",
+		      g_iscsi.reuseport ? "Enabled" : "Disabled");
+
+	SPDK_DEBUGLOG(iscsi, "InterruptBusyPollUs %d\n", g_iscsi.interrupt_busy_poll_us);
+
+	if (g_iscsi.tls) {
+		SPDK_DEBUGLOG(iscsi, "TLS Enabled (kTLS %s), PSK identity %s\n",
+			      g_iscsi.ktls ? "Enabled" : "Disabled", g_iscsi.tls_psk_identity);
+	} else {
+		SPDK_DEBUGLOG(iscsi, "TLS Disabled\n");
+	}
 }
 
 #define NUM_PDU_PER_CONNECTION(opts)	(2 * (opts->MaxQueueDepth +	\
@@ -324,6 +343,13 @@ iscsi_opts_init(struct spdk_iscsi_opts *opts)
 	opts->pdu_pool_size = PDU_POOL_SIZE(opts);
 	opts->immediate_data_pool_size = IMMEDIATE_DATA_POOL_SIZE(opts);
 	opts->data_out_pool_size = DATA_OUT_POOL_SIZE(opts);
+	opts->recv_buf_count = 0;
+	opts->reuseport = false;
+	opts->interrupt_busy_poll_us = DEFAULT_INTERRUPT_BUSY_POLL_US;
+	opts->tls = false;
+	opts->ktls = true;
+	opts->tls_psk_identity = NULL;
+	opts->tls_psk_path = NULL;
 }
 
 struct spdk_iscsi_opts *
@@ -347,6 +373,8 @@ iscsi_opts_free(struct spdk_iscsi_opts *opts)
 {
 	free(opts->authfile);
 	free(opts->nodebase);
+	free(opts->tls_psk_identity);
+	free(opts->tls_psk_path);
 	free(opts);
 }
 
@@ -381,6 +409,24 @@ iscsi_opts_copy(struct spdk_iscsi_opts *src)
 		}
 	}
 
+	if (src->tls_psk_identity) {
+		dst->tls_psk_identity = strdup(src->tls_psk_identity);
+		if (!dst->tls_psk_identity) {
+			iscsi_opts_free(dst);
+			SPDK_ERRLOG("failed to strdup for TLS PSK identity\n");
+			return NULL;
+		}
+	}
+
+	if (src->tls_psk_path) {
+		dst->tls_psk_path = strdup(src->tls_psk_path);
+		if (!dst->tls_psk_path) {
+			iscsi_opts_free(dst);
+			SPDK_ERRLOG("failed to strdup for TLS PSK file %s\n", src->tls_psk_path);
+			return NULL;
+		}
+	}
+
 	dst->MaxSessions = src->MaxSessions;
 	dst->MaxConnectionsPerSession = src->MaxConnectionsPerSession;
 	dst->MaxQueueDepth = src->MaxQueueDepth;
@@ -401,6 +447,11 @@ iscsi_opts_copy(struct spdk_iscsi_opts *src)
 	dst->pdu_pool_size = src->pdu_pool_size;
 	dst->immediate_data_pool_size = src->immediate_data_pool_size;
 	dst->data_out_pool_size = src->data_out_pool_size;
+	dst->recv_buf_count = src->recv_buf_count;
+	dst->reuseport = src->reuseport;
+	dst->interrupt_busy_poll_us = src->interrupt_busy_poll_us;
+	dst->tls = src->tls;
+	dst->ktls = src->ktls;
 
 	return dst;
 }
@@ -505,6 +556,69 @@ iscsi_opts_verify(struct spdk_iscsi_opts *opts)
 		return -EINVAL;
 	}
 
+	if (opts->tls && (opts->tls_psk_identity == NULL || opts->tls_psk_path == NULL)) {
+		SPDK_ERRLOG("tls_psk_identity and tls_psk_path are required if tls is enabled\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* The PSK file holds the key as a hex string and must not be accessible by group or others. */
+#define ISCSI_PSK_INVALID_PERMISSIONS	0077
+
+static int
+iscsi_load_tls_psk(const char *path)
+{
+	char hex[ISCSI_TLS_PSK_MAX_LEN * 2 + 2] = {};
+	struct stat statbuf;
+	FILE *fp;
+	char *psk;
+	size_t len;
+
+	if (stat(path, &statbuf) != 0) {
+		SPDK_ERRLOG("Could not stat PSK file %s\n", path);
+		return -EACCES;
+	}
+
+	if ((statbuf.st_mode & ISCSI_PSK_INVALID_PERMISSIONS) != 0) {
+		SPDK_ERRLOG("Incorrect permissions for PSK file %s\n", path);
+		return -EPERM;
+	}
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		SPDK_ERRLOG("Could not open PSK file %s\n", path);
+		return -EACCES;
+	}
+
+	len = fread(hex, 1, sizeof(hex) - 1, fp);
+	fclose(fp);
+
+	while (len > 0 && isspace((unsigned char)hex[len - 1])) {
+		len--;
+	}
+	hex[len] = '\0';
+
+	if (len != ISCSI_TLS_PSK_MIN_LEN * 2 && len != ISCSI_TLS_PSK_MAX_LEN * 2) {
+		SPDK_ERRLOG("PSK in %s must be %d or %d bytes in hex\n", path,
+			    ISCSI_TLS_PSK_MIN_LEN, ISCSI_TLS_PSK_MAX_LEN);
+		spdk_memset_s(hex, sizeof(hex), 0, sizeof(hex));
+		return -EINVAL;
+	}
+
+	psk = spdk_unhexlify(hex);
+	spdk_memset_s(hex, sizeof(hex), 0, sizeof(hex));
+	if (psk == NULL) {
+		SPDK_ERRLOG("PSK in %s is not a valid hex string\n", path);
+		return -EINVAL;
+	}
+
+	memcpy(g_iscsi.tls_psk, psk, len / 2);
+	g_iscsi.tls_psk_size = len / 2;
+	spdk_memset_s(psk, len / 2, 0, len / 2);
+	free(psk);
+
 	return 0;
 }
 
@@ -553,6 +667,25 @@ iscsi_set_global_params(struct spdk_iscsi_opts *opts)
 	g_iscsi.pdu_pool_size = opts->pdu_pool_size;
 	g_iscsi.immediate_data_pool_size = opts->immediate_data_pool_size;
 	g_iscsi.data_out_pool_size = opts->data_out_pool_size;
+	g_iscsi.recv_buf_count = opts->recv_buf_count;
+	g_iscsi.reuseport = opts->reuseport;
+	g_iscsi.interrupt_busy_poll_us = opts->interrupt_busy_poll_us;
+	g_iscsi.tls = opts->tls;
+	g_iscsi.ktls = opts->ktls;
+
+	if (opts->tls) {
+		g_iscsi.tls_psk_identity = strdup(opts->tls_psk_identity);
+		g_iscsi.tls_psk_path = strdup(opts->tls_psk_path);
+		if (!g_iscsi.tls_psk_identity || !g_iscsi.tls_psk_path) {
+			SPDK_ERRLOG("failed to strdup for TLS PSK parameters\n");
+			return -ENOMEM;
+		}
+
+		rc = iscsi_load_tls_psk(g_iscsi.tls_psk_path);
+		if (rc != 0) {
+			return rc;
+		}
+	}
 
 	iscsi_log_globals();
 
@@ -968,6 +1101,8 @@ iscsi_poll_group_poll(void *ctx)
 	STAILQ_FOREACH_SAFE(conn, &group->connections, pg_link, tmp) {
 		if (conn->state == ISCSI_CONN_STATE_EXITING) {
 			iscsi_conn_destruct(conn);
+		} else {
+			iscsi_conn_handle_recv_bufs(conn);
 		}
 	}
 
@@ -984,22 +1119,170 @@ iscsi_poll_group_handle_nop(void *ctx)
 		iscsi_conn_handle_nop(conn);
 	}
 
+	/* In interrupt mode, the poll group is polled only when its sockets have events.
+	 * Poll it here as well to bound the delay of the work not driven by them, e.g.
+	 * destructing exiting connections.
+	 */
+	if (group->in_interrupt) {
+		iscsi_poll_group_poll(group);
+	}
+
 	return SPDK_POLLER_BUSY;
 }
 
+#ifdef __linux__
+static void
+iscsi_poll_group_busy_intr_register(struct spdk_iscsi_poll_group *group)
+{
+	uint64_t notify = 1;
+	int efd;
+
+	if (group->busy_intr != NULL) {
+		return;
+	}
+
+	efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (efd < 0) {
+		SPDK_ERRLOG("Failed to create busy eventfd for poll group %p\n", group);
+		return;
+	}
+
+	group->busy_intr = spdk_interrupt_register(efd, iscsi_poll_group_poll, group,
+			   "iscsi_poll_group_busy");
+	if (group->busy_intr == NULL) {
+		SPDK_ERRLOG("Failed to register busy interrupt for poll group %p\n", group);
+		close(efd);
+		return;
+	}
+
+	/* Write without read keeps the eventfd readable, so the poll group is polled
+	 * on every iteration of the thread, the same as in poll mode.
+	 */
+	if (write(efd, &notify, sizeof(notify)) < 0) {
+		SPDK_ERRLOG("Failed to set busy wait for poll group %p\n", group);
+	}
+	group->busy_efd = efd;
+}
+
+static void
+iscsi_poll_group_busy_intr_unregister(struct spdk_iscsi_poll_group *group)
+{
+	if (group->busy_intr == NULL) {
+		return;
+	}
+
+	spdk_interrupt_unregister(&group->busy_intr);
+	close(group->busy_efd);
+	group->busy_efd = -1;
+}
+#else
+static void
+iscsi_poll_group_busy_intr_register(struct spdk_iscsi_poll_group *group)
+{
+}
+
+static void
+iscsi_poll_group_busy_intr_unregister(struct spdk_iscsi_poll_group *group)
+{
+}
+#endif
+
+static void
+iscsi_poll_group_set_interrupt_mode(struct spdk_poller *poller, void *cb_arg,
+				    bool interrupt_mode)
+{
+	struct spdk_iscsi_poll_group *group = cb_arg;
+	int rc;
+
+	if (interrupt_mode) {
+		/* The sock group is busy polled while it has events, and waits for
+		 * events once it has been idle for interrupt_busy_poll_us.
+		 */
+		rc = spdk_sock_group_register_interrupt(group->sock_group,
+							g_iscsi.interrupt_busy_poll_us,
+							iscsi_poll_group_poll, group,
+							"iscsi_poll_group");
+		if (rc != 0) {
+			/* Registering the poller's interrupt callback removed its own busy
+			 * eventfd, so keep the poll group busy polled with one of ours.
+			 */
+			SPDK_ERRLOG("Failed to register interrupt for sock_group=%p: %s\n",
+				    group->sock_group, spdk_strerror(-rc));
+			iscsi_poll_group_busy_intr_register(group);
+			group->in_interrupt = false;
+			return;
+		}
+	} else {
+		spdk_sock_group_unregister_interrupt(group->sock_group);
+		iscsi_poll_group_busy_intr_unregister(group);
+	}
+
+	group->in_interrupt = interrupt_mode;
+}
+
+static void
+iscsi_poll_group_create_recv_bufs(struct spdk_iscsi_poll_group *pg)
+{
+	struct iscsi_recv_buf *recv_buf;
+	uint32_t i;
+
+	if (g_iscsi.recv_buf_count == 0) {
+		return;
+	}
+
+	pg->recv_bufs = calloc(g_iscsi.recv_buf_count, sizeof(*pg->recv_bufs));
+	pg->recv_buf_mem = spdk_zmalloc((size_t)g_iscsi.recv_buf_count * ISCSI_RECV_BUF_SIZE,
+					0x1000, NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	if (pg->recv_bufs == NULL || pg->recv_buf_mem == NULL) {
+		/* Connections fall back to reading data by spdk_sock_recv(). */
+		SPDK_ERRLOG("Failed to allocate receive buffers of poll group %p\n", pg);
+		free(pg->recv_bufs);
+		spdk_free(pg->recv_buf_mem);
+		pg->recv_bufs = NULL;
+		pg->recv_buf_mem = NULL;
+		return;
+	}
+
+	for (i = 0; i < g_iscsi.recv_buf_count; i++) {
+		recv_buf = &pg->recv_bufs[i];
+		recv_buf->pg = pg;
+		recv_buf->thread = spdk_get_thread();
+		recv_buf->buf = (uint8_t *)pg->recv_buf_mem + (size_t)i * ISCSI_RECV_BUF_SIZE;
+		spdk_sock_group_provide_buf(pg->sock_group, recv_buf->buf, ISCSI_RECV_BUF_SIZE,
+					    recv_buf);
+	}
+}
+
 static int
 iscsi_poll_group_create(void *io_device, void *ctx_buf)
 {
 	struct spdk_iscsi_poll_group *pg = ctx_buf;
 
 	STAILQ_INIT(&pg->connections);
-	pg->sock_group = spdk_sock_group_create(NULL);
+	pg->busy_efd = -1;
+	pg->sock_group = spdk_sock_group_create(pg);
 	assert(pg->sock_group != NULL);
 
+	iscsi_poll_group_create_recv_bufs(pg);
+
+	/* Data digests are calculated inline if there's no accel channel. */
+	pg->accel_channel = spdk_accel_get_io_channel();
+	if (pg->accel_channel == NULL) {
+		SPDK_ERRLOG("Failed to get accel channel for poll group %p\n", pg);
+	}
+
 	pg->poller = SPDK_POLLER_REGISTER(iscsi_poll_group_poll, pg, 0);
+	spdk_poller_register_interrupt(pg->poller, iscsi_poll_group_set_interrupt_mode, pg);
 	/* set the period to 1 sec */
 	pg->nop_poller = SPDK_POLLER_REGISTER(iscsi_poll_group_handle_nop, pg, 1000000);
 
+	pg->thread = spdk_get_thread();
+	TAILQ_INIT(&pg->acceptors);
+	if (g_iscsi.reuseport) {
+		pg->acceptor_poller = SPDK_POLLER_REGISTER(iscsi_poll_group_accept, pg,
+				      ACCEPT_TIMEOUT_US);
+	}
+
 	return 0;
 }
 
@@ -1014,8 +1297,16 @@ iscsi_poll_group_destroy(void *io_device, void *ctx_buf)
 	assert(pg->sock_group != NULL);
 
 	spdk_sock_group_close(&pg->sock_group);
+	iscsi_poll_group_busy_intr_unregister(pg);
+	free(pg->recv_bufs);
+	spdk_free(pg->recv_buf_mem);
+	if (pg->accel_channel != NULL) {
+		spdk_put_io_channel(pg->accel_channel);
+	}
 	spdk_poller_unregister(&pg->poller);
 	spdk_poller_unregister(&pg->nop_poller);
+	assert(TAILQ_EMPTY(&pg->acceptors));
+	spdk_poller_unregister(&pg->acceptor_poller);
 
 	ch = spdk_io_channel_from_ctx(pg);
 	thread = spdk_io_channel_get_thread(ch);
@@ -1178,6 +1469,9 @@ _iscsi_fini_dev_unreg(struct spdk_io_channel_iter *i, int status)
 
 	free(g_iscsi.authfile);
 	free(g_iscsi.nodebase);
+	free(g_iscsi.tls_psk_identity);
+	free(g_iscsi.tls_psk_path);
+	spdk_memset_s(g_iscsi.tls_psk, sizeof(g_iscsi.tls_psk), 0, sizeof(g_iscsi.tls_psk));
 
 	pthread_mutex_destroy(&g_iscsi.mutex);
 	if (g_init_thread != NULL) {
@@ -1260,6 +1554,17 @@ iscsi_opts_info_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_uint32(w, "immediate_data_pool_size",
 				     g_iscsi.immediate_data_pool_size);
 	spdk_json_write_named_uint32(w, "data_out_pool_size", g_iscsi.data_out_pool_size);
+	spdk_json_write_named_uint32(w, "recv_buf_count", g_iscsi.recv_buf_count);
+	spdk_json_write_named_bool(w, "reuseport", g_iscsi.reuseport);
+	spdk_json_write_named_uint32(w, "interrupt_busy_poll_us", g_iscsi.interrupt_busy_poll_us);
+	spdk_json_write_named_bool(w, "tls", g_iscsi.tls);
+	spdk_json_write_named_bool(w, "ktls", g_iscsi.ktls);
+	if (g_iscsi.tls_psk_identity != NULL) {
+		spdk_json_write_named_string(w, "tls_psk_identity", g_iscsi.tls_psk_identity);
+	}
+	if (g_iscsi.tls_psk_path != NULL) {
+		spdk_json_write_named_string(w, "tls_psk_path", g_iscsi.tls_psk_path);
+	}
 
 	spdk_json_write_object_end(w);
 }
@@ -17,7 +17,6 @@
 #include "iscsi/tgt_node.h"
 
 #define PORTNUMSTRLEN 32
-#define ACCEPT_TIMEOUT_US 1000 /* 1ms */
 
 static int
 iscsi_portal_accept(void *arg)
@@ -34,7 +33,7 @@ iscsi_portal_accept(void *arg)
 	while (1) {
 		sock = spdk_sock_accept(portal->sock);
 		if (sock != NULL) {
-			rc = iscsi_conn_construct(portal, sock);
+			rc = iscsi_conn_construct(portal, sock, NULL);
 			if (rc < 0) {
 				spdk_sock_close(&sock);
 				SPDK_ERRLOG("spdk_iscsi_connection_construct() failed\n");
@@ -52,6 +51,37 @@ iscsi_portal_accept(void *arg)
 	return count;
 }
 
+int
+iscsi_poll_group_accept(void *arg)
+{
+	struct spdk_iscsi_poll_group	*pg = arg;
+	struct iscsi_portal_acceptor	*acceptor;
+	struct spdk_sock		*sock;
+	int				rc, count = 0;
+
+	TAILQ_FOREACH(acceptor, &pg->acceptors, link) {
+		while (1) {
+			sock = spdk_sock_accept(acceptor->sock);
+			if (sock == NULL) {
+				if (errno != EAGAIN && errno != EWOULDBLOCK) {
+					SPDK_ERRLOG("accept error(%d): %s\n", errno, spdk_strerror(errno));
+				}
+				break;
+			}
+
+			rc = iscsi_conn_construct(acceptor->portal, sock, pg);
+			if (rc < 0) {
+				spdk_sock_close(&sock);
+				SPDK_ERRLOG("spdk_iscsi_connection_construct() failed\n");
+				break;
+			}
+			count++;
+		}
+	}
+
+	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
 static struct spdk_iscsi_portal *
 iscsi_portal_find_by_addr(const char *host, const char *port)
 {
@@ -105,6 +135,9 @@ iscsi_portal_create(const char *host, const char *port)
 	p->sock = NULL;
 	p->group = NULL; /* set at a later time by caller */
 	p->acceptor_poller = NULL;
+	p->acceptors = NULL;
+	p->num_acceptors = 0;
+	p->acceptors_attached = false;
 
 	pthread_mutex_lock(&g_iscsi.mutex);
 	tmp = iscsi_portal_find_by_addr(host, port);
@@ -140,13 +173,245 @@ iscsi_portal_destroy(struct spdk_iscsi_portal *p)
 
 }
 
+/* Runs on the thread of the poll group of the acceptor */
+static void
+iscsi_portal_acceptor_attach(void *ctx)
+{
+	struct iscsi_portal_acceptor *acceptor = ctx;
+
+	assert(!acceptor->attached);
+	TAILQ_INSERT_TAIL(&acceptor->pg->acceptors, acceptor, link);
+	acceptor->attached = true;
+}
+
+/* Runs on the thread of the poll group of the acceptor */
+static void
+iscsi_portal_acceptor_detach(void *ctx)
+{
+	struct iscsi_portal_acceptor *acceptor = ctx;
+
+	if (acceptor->attached) {
+		TAILQ_REMOVE(&acceptor->pg->acceptors, acceptor, link);
+		acceptor->attached = false;
+	}
+}
+
+static void
+iscsi_portal_attach_acceptors(struct spdk_iscsi_portal *p)
+{
+	struct iscsi_portal_acceptor *acceptor;
+	uint32_t i;
+
+	if (p->acceptors_attached) {
+		return;
+	}
+
+	for (i = 0; i < p->num_acceptors; i++) {
+		acceptor = p->acceptors[i];
+		spdk_thread_send_msg(acceptor->pg->thread, iscsi_portal_acceptor_attach, acceptor);
+	}
+	p->acceptors_attached = true;
+}
+
+static void
+iscsi_portal_detach_acceptors(struct spdk_iscsi_portal *p)
+{
+	struct iscsi_portal_acceptor *acceptor;
+	uint32_t i;
+
+	if (!p->acceptors_attached) {
+		return;
+	}
+
+	for (i = 0; i < p->num_acceptors; i++) {
+		acceptor = p->acceptors[i];
+		spdk_thread_send_msg(acceptor->pg->thread, iscsi_portal_acceptor_detach, acceptor);
+	}
+	p->acceptors_attached = false;
+}
+
+/* Close the listening sockets of a portal that were never attached */
+static void
+iscsi_portal_free_acceptors(struct spdk_iscsi_portal *p)
+{
+	uint32_t i;
+
+	for (i = 0; i < p->num_acceptors; i++) {
+		spdk_sock_close(&p->acceptors[i]->sock);
+		free(p->acceptors[i]);
+	}
+
+	free(p->acceptors);
+	p->acceptors = NULL;
+	p->num_acceptors = 0;
+}
+
+static void
+iscsi_portal_acceptor_closed(void *ctx)
+{
+	struct spdk_iscsi_portal_grp *pg = ctx;
+
+	assert(pg->num_closing_acceptors > 0);
+	if (--pg->num_closing_acceptors == 0 && pg->release_pending) {
+		iscsi_portal_grp_destroy(pg);
+	}
+}
+
+/* Runs on the thread of the poll group of the acceptor */
+static void
+iscsi_portal_acceptor_close(void *ctx)
+{
+	struct iscsi_portal_acceptor *acceptor = ctx;
+	struct spdk_iscsi_portal_grp *pg = acceptor->portal->group;
+	struct spdk_thread *thread = acceptor->thread;
+
+	iscsi_portal_acceptor_detach(acceptor);
+	spdk_sock_close(&acceptor->sock);
+	free(acceptor);
+
+	spdk_thread_send_msg(thread, iscsi_portal_acceptor_closed, pg);
+}
+
+/* The poll groups detach and close the listening sockets of the portal. Until they
+ * are done, the portal group is kept, see iscsi_portal_grp_release().
+ */
+static void
+iscsi_portal_close_acceptors(struct spdk_iscsi_portal *p)
+{
+	struct iscsi_portal_acceptor *acceptor;
+	uint32_t i;
+
+	for (i = 0; i < p->num_acceptors; i++) {
+		acceptor = p->acceptors[i];
+		acceptor->thread = spdk_get_thread();
+		p->group->num_closing_acceptors++;
+		spdk_thread_send_msg(acceptor->pg->thread, iscsi_portal_acceptor_close, acceptor);
+	}
+
+	free(p->acceptors);
+	p->acceptors = NULL;
+	p->num_acceptors = 0;
+	p->acceptors_attached = false;
+}
+
+static int
+iscsi_portal_get_tls_psk(uint8_t *out, int out_len, const char **cipher,
+			 const char *psk_identity, void *get_key_ctx)
+{
+	if (strcmp(psk_identity, g_iscsi.tls_psk_identity) != 0) {
+		SPDK_ERRLOG("Unknown PSK identity %s\n", psk_identity);
+		return -1;
+	}
+
+	if ((uint32_t)out_len < g_iscsi.tls_psk_size) {
+		SPDK_ERRLOG("Out buffer (%d) too small for PSK (%u)\n", out_len, g_iscsi.tls_psk_size);
+		return -1;
+	}
+
+	memcpy(out, g_iscsi.tls_psk, g_iscsi.tls_psk_size);
+	if (g_iscsi.tls_psk_size == ISCSI_TLS_PSK_MAX_LEN) {
+		*cipher = "TLS_AES_256_GCM_SHA384";
+	} else {
+		*cipher = "TLS_AES_128_GCM_SHA256";
+	}
+
+	return g_iscsi.tls_psk_size;
+}
+
+/* Open a listening socket of the portal. If TLS is enabled, the socket is created by
+ * the ssl sock implementation with TLS 1.3 and PSK, and the record layer is offloaded
+ * to the kernel (kTLS) unless it is disabled, so that established connections encrypt
+ * and decrypt in sendmsg()/recvmsg() rather than in user space.
+ */
+static struct spdk_sock *
+iscsi_portal_listen(struct spdk_iscsi_portal *p, int port, bool reuseport)
+{
+	struct spdk_sock_opts opts;
+	struct spdk_sock_impl_opts impl_opts;
+	size_t impl_opts_size = sizeof(impl_opts);
+	const char *impl_name = NULL;
+
+	opts.opts_size = sizeof(opts);
+	spdk_sock_get_default_opts(&opts);
+	opts.reuseport = reuseport;
+
+	if (g_iscsi.tls) {
+		impl_name = "ssl";
+		if (spdk_sock_impl_get_opts(impl_name, &impl_opts, &impl_opts_size) != 0) {
+			SPDK_ERRLOG("ssl sock implementation is not available\n");
+			return NULL;
+		}
+		impl_opts.tls_version = SPDK_TLS_VERSION_1_3;
+		impl_opts.enable_ktls = g_iscsi.ktls;
+		impl_opts.get_key = iscsi_portal_get_tls_psk;
+		impl_opts.get_key_ctx = NULL;
+		impl_opts.tls_cipher_suites = "TLS_AES_256_GCM_SHA384:TLS_AES_128_GCM_SHA256";
+		opts.impl_opts = &impl_opts;
+		opts.impl_opts_size = sizeof(impl_opts);
+	}
+
+	return spdk_sock_listen_ext(p->host, port, impl_name, &opts);
+}
+
+/* Open a listening socket with SO_REUSEPORT for each poll group, so that the kernel
+ * spreads incoming connections among them and each poll group accepts and logs in
+ * its share of the connections.
+ */
+static int
+iscsi_portal_open_acceptors(struct spdk_iscsi_portal *p, int port)
+{
+	struct spdk_iscsi_poll_group *pg;
+	struct iscsi_portal_acceptor *acceptor;
+	uint32_t count = 0;
+
+	TAILQ_FOREACH(pg, &g_iscsi.poll_group_head, link) {
+		count++;
+	}
+
+	if (count == 0) {
+		SPDK_ERRLOG("There is no poll group.\n");
+		return -1;
+	}
+
+	p->acceptors = calloc(count, sizeof(*p->acceptors));
+	if (p->acceptors == NULL) {
+		SPDK_ERRLOG("calloc() failed for portal acceptors\n");
+		return -1;
+	}
+
+	TAILQ_FOREACH(pg, &g_iscsi.poll_group_head, link) {
+		acceptor = calloc(1, sizeof(*acceptor));
+		if (acceptor == NULL) {
+			SPDK_ERRLOG("calloc() failed for portal acceptor\n");
+			iscsi_portal_free_acceptors(p);
+			return -1;
+		}
+
+		acceptor->sock = iscsi_portal_listen(p, port, true);
+		if (acceptor->sock == NULL) {
+			SPDK_ERRLOG("listen error %.64s.%d\n", p->host, port);
+			free(acceptor);
+			iscsi_portal_free_acceptors(p);
+			return -1;
+		}
+
+		acceptor->portal = p;
+		acceptor->pg = pg;
+		p->acceptors[p->num_acceptors++] = acceptor;
+	}
+
+	iscsi_portal_attach_acceptors(p);
+
+	return 0;
+}
+
 static int
 iscsi_portal_open(struct spdk_iscsi_portal *p)
 {
 	struct spdk_sock *sock;
 	int port;
 
-	if (p->sock != NULL) {
+	if (p->sock != NULL || p->acceptors != NULL) {
 		SPDK_ERRLOG("portal (%s, %s) is already opened\n",
 			    p->host, p->port);
 		return -1;
@@ -158,7 +423,11 @@ iscsi_portal_open(struct spdk_iscsi_portal *p)
 		return -1;
 	}
 
-	sock = spdk_sock_listen(p->host, port, NULL);
+	if (g_iscsi.reuseport) {
+		return iscsi_portal_open_acceptors(p, port);
+	}
+
+	sock = iscsi_portal_listen(p, port, false);
 	if (sock == NULL) {
 		SPDK_ERRLOG("listen error %.64s.%d\n", p->host, port);
 		return -1;
@@ -181,6 +450,12 @@ iscsi_portal_open(struct spdk_iscsi_portal *p)
 static void
 iscsi_portal_close(struct spdk_iscsi_portal *p)
 {
+	if (p->acceptors) {
+		SPDK_DEBUGLOG(iscsi, "close portal (%s, %s)\n",
+			      p->host, p->port);
+		iscsi_portal_close_acceptors(p);
+	}
+
 	if (p->sock) {
 		SPDK_DEBUGLOG(iscsi, "close portal (%s, %s)\n",
 			      p->host, p->port);
@@ -192,6 +467,11 @@ iscsi_portal_close(struct spdk_iscsi_portal *p)
 static void
 iscsi_portal_pause(struct spdk_iscsi_portal *p)
 {
+	if (p->acceptors != NULL) {
+		iscsi_portal_detach_acceptors(p);
+		return;
+	}
+
 	assert(p->acceptor_poller != NULL);
 
 	spdk_poller_pause(p->acceptor_poller);
@@ -200,6 +480,11 @@ iscsi_portal_pause(struct spdk_iscsi_portal *p)
 static void
 iscsi_portal_resume(struct spdk_iscsi_portal *p)
 {
+	if (p->acceptors != NULL) {
+		iscsi_portal_attach_acceptors(p);
+		return;
+	}
+
 	assert(p->acceptor_poller != NULL);
 
 	spdk_poller_resume(p->acceptor_poller);
@@ -252,6 +537,8 @@ iscsi_portal_grp_create(int tag, bool is_private)
 	pg->ref = 0;
 	pg->tag = tag;
 	pg->is_private = is_private;
+	pg->num_closing_acceptors = 0;
+	pg->release_pending = false;
 
 	pthread_mutex_lock(&g_iscsi.mutex);
 	pg->disable_chap = g_iscsi.disable_chap;
@@ -271,6 +558,7 @@ iscsi_portal_grp_destroy(struct spdk_iscsi_portal_grp *pg)
 	struct spdk_iscsi_portal	*p;
 
 	assert(pg != NULL);
+	assert(pg->num_closing_acceptors == 0);
 
 	SPDK_DEBUGLOG(iscsi, "iscsi_portal_grp_destroy\n");
 	while (!TAILQ_EMPTY(&pg->head)) {
@@ -447,6 +735,11 @@ void
 iscsi_portal_grp_release(struct spdk_iscsi_portal_grp *pg)
 {
 	iscsi_portal_grp_close(pg);
+	if (pg->num_closing_acceptors > 0) {
+		pg->release_pending = true;
+		return;
+	}
+
 	iscsi_portal_grp_destroy(pg);
 }
 
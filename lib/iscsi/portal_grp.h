@@ -11,14 +11,31 @@
 #include "spdk/cpuset.h"
 #include "iscsi/iscsi.h"
 
+#define ACCEPT_TIMEOUT_US 1000 /* 1ms */
+
 struct spdk_json_write_ctx;
 
+/* Listening socket of a portal on one poll group, used if reuseport is enabled */
+struct iscsi_portal_acceptor {
+	struct spdk_iscsi_portal		*portal;
+	struct spdk_iscsi_poll_group		*pg;
+	struct spdk_sock			*sock;
+	/* Thread opening and closing the portal */
+	struct spdk_thread			*thread;
+	/* In the list of the poll group, only accessed by its thread */
+	bool					attached;
+	TAILQ_ENTRY(iscsi_portal_acceptor)	link;
+};
+
 struct spdk_iscsi_portal {
 	struct spdk_iscsi_portal_grp	*group;
 	char				host[MAX_PORTAL_ADDR + 1];
 	char				port[MAX_PORTAL_PORT + 1];
 	struct spdk_sock		*sock;
 	struct spdk_poller		*acceptor_poller;
+	struct iscsi_portal_acceptor	**acceptors;
+	uint32_t			num_acceptors;
+	bool				acceptors_attached;
 	TAILQ_ENTRY(spdk_iscsi_portal)	per_pg_tailq;
 	TAILQ_ENTRY(spdk_iscsi_portal)	g_tailq;
 };
@@ -40,6 +57,13 @@ struct spdk_iscsi_portal_grp {
 	bool					require_chap;
 	bool					mutual_chap;
 	int32_t					chap_group;
+
+	/* Listening sockets of the portals being closed by the poll groups. The
+	 * portal group is only destroyed once they are closed, as connections may
+	 * still be accepted on them meanwhile.
+	 */
+	uint32_t				num_closing_acceptors;
+	bool					release_pending;
 	TAILQ_ENTRY(spdk_iscsi_portal_grp)	tailq;
 	TAILQ_HEAD(, spdk_iscsi_portal)		head;
 };
@@ -75,4 +99,6 @@ void iscsi_portal_grps_config_json(struct spdk_json_write_ctx *w);
 int iscsi_parse_redirect_addr(struct sockaddr_storage *sa,
 			      const char *host, const char *port);
 
+int iscsi_poll_group_accept(void *arg);
+
 #endif /* SPDK_PORTAL_GRP_H */
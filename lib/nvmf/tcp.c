@@ -29,6 +29,7 @@
 #define SPDK_NVMF_TCP_DEFAULT_SOCK_PRIORITY 0
 #define SPDK_NVMF_TCP_DEFAULT_CONTROL_MSG_NUM 32
 #define SPDK_NVMF_TCP_DEFAULT_SUCCESS_OPTIMIZATION true
+#define SPDK_NVMF_TCP_DEFAULT_RECV_BUF_COUNT 0
 
 #define SPDK_NVMF_TCP_MIN_IO_QUEUE_DEPTH 2
 #define SPDK_NVMF_TCP_MAX_IO_QUEUE_DEPTH 65535
@@ -223,6 +224,15 @@ struct spdk_nvmf_tcp_req  {
 	/* In-capsule data buffer */
 	uint8_t					*buf;
 
+	/* Receive buffer holding the in-capsule data if it was placed in place */
+	struct nvmf_tcp_recv_buf		*recv_buf;
+
+	/* Capsule response sent along with the last C2H data PDU */
+	union {
+		struct spdk_nvme_tcp_rsp	capsule_resp;
+		uint8_t				raw[sizeof(struct spdk_nvme_tcp_rsp) + SPDK_NVME_TCP_DIGEST_LEN];
+	} piggyback_rsp;
+
 	struct spdk_nvmf_tcp_req		*fused_pair;
 
 	/*
@@ -234,6 +244,7 @@ struct spdk_nvmf_tcp_req  {
 	bool					pdu_in_use;
 	bool					has_in_capsule_data;
 	bool					fused_failed;
+	bool					rsp_piggybacked;
 
 	/* transfer_tag */
 	uint16_t				ttag;
@@ -290,6 +301,12 @@ struct spdk_nvmf_tcp_qpair {
 	uint32_t				resource_count;
 	uint32_t				recv_buf_size;
 
+	/* Receive through buffers provided to the socket group. Buffers taken from the
+	 * socket are consumed in order from recv_bufs.
+	 */
+	bool					recv_next;
+	STAILQ_HEAD(, nvmf_tcp_recv_buf)	recv_bufs;
+
 	struct spdk_nvmf_tcp_port		*port;
 
 	/* IP address */
@@ -318,6 +335,23 @@ struct spdk_nvmf_tcp_control_msg {
 	STAILQ_ENTRY(spdk_nvmf_tcp_control_msg) link;
 };
 
+/*
+ * Buffer provided to the socket group of a poll group. Once the socket has received
+ *  data into it, it is owned by a qpair until all of the data is consumed and every
+ *  request holding in-capsule data placed in it has completed.
+ */
+struct nvmf_tcp_recv_buf {
+	struct spdk_nvmf_tcp_poll_group		*tgroup;
+	void					*buf;
+
+	/* Received data and the number of bytes already consumed by the qpair. */
+	uint8_t					*data;
+	uint32_t				len;
+	uint32_t				offset;
+	uint32_t				ref;
+	STAILQ_ENTRY(nvmf_tcp_recv_buf)		link;
+};
+
 struct spdk_nvmf_tcp_control_msg_list {
 	void *msg_buf;
 	STAILQ_HEAD(, spdk_nvmf_tcp_control_msg) free_msgs;
@@ -331,8 +365,15 @@ struct spdk_nvmf_tcp_poll_group {
 	TAILQ_HEAD(, spdk_nvmf_tcp_qpair)	await_req;
 
 	struct spdk_io_channel			*accel_channel;
+	struct spdk_accel_digest_stats		digest_stats;
 	struct spdk_nvmf_tcp_control_msg_list	*control_msg_list;
 
+	struct nvmf_tcp_recv_buf		*recv_bufs;
+	void					*recv_buf_mem;
+	uint32_t				recv_buf_size;
+	uint64_t				in_place_capsule_data;
+	uint64_t				piggybacked_capsule_resps;
+
 	TAILQ_ENTRY(spdk_nvmf_tcp_poll_group)	link;
 };
 
@@ -346,6 +387,7 @@ struct tcp_transport_opts {
 	bool		c2h_success;
 	uint16_t	control_msg_num;
 	uint32_t	sock_priority;
+	uint32_t	recv_buf_count;
 };
 
 struct tcp_psk_entry {
@@ -388,6 +430,10 @@ static const struct spdk_json_object_decoder tcp_transport_opts_decoder[] = {
 		"sock_priority", offsetof(struct tcp_transport_opts, sock_priority),
 		spdk_json_decode_uint32, true
 	},
+	{
+		"recv_buf_count", offsetof(struct tcp_transport_opts, recv_buf_count),
+		spdk_json_decode_uint32, true
+	},
 };
 
 static bool nvmf_tcp_req_process(struct spdk_nvmf_tcp_transport *ttransport,
@@ -396,6 +442,7 @@ static void nvmf_tcp_poll_group_destroy(struct spdk_nvmf_transport_poll_group *g
 
 static void _nvmf_tcp_send_c2h_data(struct spdk_nvmf_tcp_qpair *tqpair,
 				    struct spdk_nvmf_tcp_req *tcp_req);
+static void nvmf_tcp_recv_buf_put(struct nvmf_tcp_recv_buf *recv_buf);
 
 static inline void
 nvmf_tcp_req_set_state(struct spdk_nvmf_tcp_req *tcp_req,
@@ -438,6 +485,7 @@ nvmf_tcp_req_get(struct spdk_nvmf_tcp_qpair *tqpair)
 	memset(&tcp_req->rsp, 0, sizeof(tcp_req->rsp));
 	tcp_req->h2c_offset = 0;
 	tcp_req->has_in_capsule_data = false;
+	tcp_req->rsp_piggybacked = false;
 	tcp_req->req.dif_enabled = false;
 	tcp_req->req.zcopy_phase = NVMF_ZCOPY_PHASE_NONE;
 
@@ -452,6 +500,11 @@ nvmf_tcp_req_put(struct spdk_nvmf_tcp_qpair *tqpair, struct spdk_nvmf_tcp_req *t
 {
 	assert(!tcp_req->pdu_in_use);
 
+	if (tcp_req->recv_buf != NULL) {
+		nvmf_tcp_recv_buf_put(tcp_req->recv_buf);
+		tcp_req->recv_buf = NULL;
+	}
+
 	TAILQ_REMOVE(&tqpair->tcp_req_working_queue, tcp_req, state_link);
 	TAILQ_INSERT_TAIL(&tqpair->tcp_req_free_queue, tcp_req, state_link);
 	nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_FREE);
@@ -542,6 +595,7 @@ _nvmf_tcp_qpair_destroy(void *_tqpair)
 	struct spdk_nvmf_tcp_qpair *tqpair = _tqpair;
 	spdk_nvmf_transport_qpair_fini_cb cb_fn = tqpair->fini_cb_fn;
 	void *cb_arg = tqpair->fini_cb_arg;
+	struct nvmf_tcp_recv_buf *recv_buf;
 	int err = 0;
 
 	spdk_trace_record(TRACE_TCP_QP_DESTROY, 0, 0, (uintptr_t)tqpair);
@@ -552,6 +606,11 @@ _nvmf_tcp_qpair_destroy(void *_tqpair)
 	assert(err == 0);
 	nvmf_tcp_cleanup_all_states(tqpair);
 
+	while ((recv_buf = STAILQ_FIRST(&tqpair->recv_bufs)) != NULL) {
+		STAILQ_REMOVE_HEAD(&tqpair->recv_bufs, link);
+		nvmf_tcp_recv_buf_put(recv_buf);
+	}
+
 	if (tqpair->state_cntr[TCP_REQUEST_STATE_FREE] != tqpair->resource_count) {
 		SPDK_ERRLOG("tqpair(%p) free tcp request num is %u but should be %u\n", tqpair,
 			    tqpair->state_cntr[TCP_REQUEST_STATE_FREE],
@@ -598,6 +657,7 @@ nvmf_tcp_dump_opts(struct spdk_nvmf_transport *transport, struct spdk_json_write
 	ttransport = SPDK_CONTAINEROF(transport, struct spdk_nvmf_tcp_transport, transport);
 	spdk_json_write_named_bool(w, "c2h_success", ttransport->tcp_opts.c2h_success);
 	spdk_json_write_named_uint32(w, "sock_priority", ttransport->tcp_opts.sock_priority);
+	spdk_json_write_named_uint32(w, "recv_buf_count", ttransport->tcp_opts.recv_buf_count);
 }
 
 static int
@@ -647,6 +707,7 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 	ttransport->tcp_opts.c2h_success = SPDK_NVMF_TCP_DEFAULT_SUCCESS_OPTIMIZATION;
 	ttransport->tcp_opts.sock_priority = SPDK_NVMF_TCP_DEFAULT_SOCK_PRIORITY;
 	ttransport->tcp_opts.control_msg_num = SPDK_NVMF_TCP_DEFAULT_CONTROL_MSG_NUM;
+	ttransport->tcp_opts.recv_buf_count = SPDK_NVMF_TCP_DEFAULT_RECV_BUF_COUNT;
 	if (opts->transport_specific != NULL &&
 	    spdk_json_decode_object_relaxed(opts->transport_specific, tcp_transport_opts_decoder,
 					    SPDK_COUNTOF(tcp_transport_opts_decoder),
@@ -664,7 +725,8 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 		     "  in_capsule_data_size=%d, max_aq_depth=%d\n"
 		     "  num_shared_buffers=%d, c2h_success=%d,\n"
 		     "  dif_insert_or_strip=%d, sock_priority=%d\n"
-		     "  abort_timeout_sec=%d, control_msg_num=%hu\n",
+		     "  abort_timeout_sec=%d, control_msg_num=%hu\n"
+		     "  recv_buf_count=%u\n",
 		     opts->max_queue_depth,
 		     opts->max_io_size,
 		     opts->max_qpairs_per_ctrlr - 1,
@@ -676,7 +738,8 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 		     opts->dif_insert_or_strip,
 		     ttransport->tcp_opts.sock_priority,
 		     opts->abort_timeout_sec,
-		     ttransport->tcp_opts.control_msg_num);
+		     ttransport->tcp_opts.control_msg_num,
+		     ttransport->tcp_opts.recv_buf_count);
 
 	if (ttransport->tcp_opts.sock_priority > SPDK_NVMF_TCP_DEFAULT_MAX_SOCK_PRIORITY) {
 		SPDK_ERRLOG("Unsupported socket_priority=%d, the current range is: 0 to %d\n"
@@ -1055,9 +1118,29 @@ _tcp_write_pdu(struct nvme_tcp_pdu *pdu)
 	int rc;
 	uint32_t mapped_length;
 	struct spdk_nvmf_tcp_qpair *tqpair = pdu->qpair;
+	struct spdk_nvmf_tcp_req *tcp_req = pdu->req;
+	struct iovec *iov;
 
 	pdu->sock_req.iovcnt = nvme_tcp_build_iovs(pdu->iov, SPDK_COUNTOF(pdu->iov), pdu,
 			       tqpair->host_hdgst_enable, tqpair->host_ddgst_enable, &mapped_length);
+
+	/* Append the piggybacked capsule response to the same socket request. If the PDU
+	 * used up all of the iovs, the response is sent once the data has been written.
+	 */
+	if (pdu->hdr.common.pdu_type == SPDK_NVME_TCP_PDU_TYPE_C2H_DATA && tcp_req->rsp_piggybacked) {
+		if (spdk_likely(pdu->sock_req.iovcnt < (int)SPDK_COUNTOF(pdu->iov))) {
+			iov = &pdu->iov[pdu->sock_req.iovcnt++];
+			iov->iov_base = tcp_req->piggyback_rsp.raw;
+			iov->iov_len = tcp_req->piggyback_rsp.capsule_resp.common.plen;
+			mapped_length += iov->iov_len;
+			if (tqpair->group != NULL) {
+				tqpair->group->piggybacked_capsule_resps++;
+			}
+		} else {
+			tcp_req->rsp_piggybacked = false;
+		}
+	}
+
 	spdk_sock_writev_async(tqpair->sock, &pdu->sock_req);
 
 	if (pdu->hdr.common.pdu_type == SPDK_NVME_TCP_PDU_TYPE_IC_RESP ||
@@ -1103,13 +1186,17 @@ pdu_data_crc32_compute(struct nvme_tcp_pdu *pdu)
 		/* Only support this limitated case for the first step */
 		if (spdk_likely(!pdu->dif_ctx && (pdu->data_len % SPDK_NVME_TCP_DIGEST_ALIGNMENT == 0)
 				&& tqpair->group)) {
-			rc = spdk_accel_submit_crc32cv(tqpair->group->accel_channel, &pdu->data_digest_crc32, pdu->data_iov,
-						       pdu->data_iovcnt, 0, data_crc32_accel_done, pdu);
+			rc = spdk_accel_digest_crc32c(tqpair->group->accel_channel, &pdu->data_digest_crc32,
+						      pdu->data_iov, pdu->data_iovcnt,
+						      &tqpair->group->digest_stats, data_crc32_accel_done, pdu);
 			if (spdk_likely(rc == 0)) {
 				return;
 			}
 		} else {
 			pdu->data_digest_crc32 = nvme_tcp_pdu_calc_data_digest(pdu);
+			if (tqpair->group != NULL) {
+				tqpair->group->digest_stats.inlined++;
+			}
 		}
 		data_crc32_accel_done(pdu, rc);
 	} else {
@@ -1275,6 +1362,7 @@ nvmf_tcp_qpair_init(struct spdk_nvmf_qpair *qpair)
 	TAILQ_INIT(&tqpair->tcp_req_free_queue);
 	TAILQ_INIT(&tqpair->tcp_req_working_queue);
 	SLIST_INIT(&tqpair->tcp_pdu_free_queue);
+	STAILQ_INIT(&tqpair->recv_bufs);
 
 	tqpair->host_hdgst_enable = true;
 	tqpair->host_ddgst_enable = true;
@@ -1442,6 +1530,46 @@ nvmf_tcp_control_msg_list_free(struct spdk_nvmf_tcp_control_msg_list *list)
 	free(list);
 }
 
+static int
+nvmf_tcp_poll_group_create_recv_bufs(struct spdk_nvmf_tcp_poll_group *tgroup,
+				     struct spdk_nvmf_transport *transport, uint32_t count)
+{
+	struct nvmf_tcp_recv_buf *recv_buf;
+	uint32_t i;
+
+	/* Size the buffers like the receive pipe of a qpair so that a capsule and its
+	 * in-capsule data are usually received into a single buffer.
+	 */
+	tgroup->recv_buf_size = (transport->opts.in_capsule_data_size +
+				 sizeof(struct spdk_nvme_tcp_cmd) + 2 * SPDK_NVME_TCP_DIGEST_LEN) *
+				SPDK_NVMF_TCP_RECV_BUF_SIZE_FACTOR;
+	tgroup->recv_buf_size = spdk_max(tgroup->recv_buf_size, MIN_SOCK_PIPE_SIZE);
+
+	tgroup->recv_bufs = calloc(count, sizeof(*tgroup->recv_bufs));
+	if (!tgroup->recv_bufs) {
+		SPDK_ERRLOG("Failed to allocate memory for receive buffers\n");
+		return -ENOMEM;
+	}
+
+	tgroup->recv_buf_mem = spdk_zmalloc((size_t)count * tgroup->recv_buf_size,
+					    NVMF_DATA_BUFFER_ALIGNMENT, NULL, SPDK_ENV_SOCKET_ID_ANY,
+					    SPDK_MALLOC_DMA);
+	if (!tgroup->recv_buf_mem) {
+		SPDK_ERRLOG("Failed to allocate memory for receive buffers\n");
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < count; i++) {
+		recv_buf = &tgroup->recv_bufs[i];
+		recv_buf->tgroup = tgroup;
+		recv_buf->buf = (uint8_t *)tgroup->recv_buf_mem + (size_t)i * tgroup->recv_buf_size;
+		spdk_sock_group_provide_buf(tgroup->sock_group, recv_buf->buf, tgroup->recv_buf_size,
+					    recv_buf);
+	}
+
+	return 0;
+}
+
 static struct spdk_nvmf_transport_poll_group *
 nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport,
 			   struct spdk_nvmf_poll_group *group)
@@ -1480,6 +1608,12 @@ nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport,
 		goto cleanup;
 	}
 
+	if (ttransport->tcp_opts.recv_buf_count > 0 &&
+	    nvmf_tcp_poll_group_create_recv_bufs(tgroup, transport,
+			    ttransport->tcp_opts.recv_buf_count) != 0) {
+		goto cleanup;
+	}
+
 	TAILQ_INSERT_TAIL(&ttransport->poll_groups, tgroup, link);
 	if (ttransport->next_pg == NULL) {
 		ttransport->next_pg = tgroup;
@@ -1545,6 +1679,9 @@ nvmf_tcp_poll_group_destroy(struct spdk_nvmf_transport_poll_group *group)
 		spdk_put_io_channel(tgroup->accel_channel);
 	}
 
+	free(tgroup->recv_bufs);
+	spdk_free(tgroup->recv_buf_mem);
+
 	if (tgroup->group.transport == NULL) {
 		/* Transport can be NULL when nvmf_tcp_poll_group_create()
 		 * calls this function directly in a failure path. */
@@ -1809,28 +1946,57 @@ err:
 	nvmf_tcp_send_c2h_term_req(tqpair, pdu, fes, error_offset);
 }
 
+static void
+nvmf_tcp_capsule_resp_hdr_init(struct spdk_nvmf_tcp_qpair *tqpair,
+			       struct spdk_nvmf_tcp_req *tcp_req,
+			       struct spdk_nvme_tcp_rsp *capsule_resp)
+{
+	capsule_resp->common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_CAPSULE_RESP;
+	capsule_resp->common.plen = capsule_resp->common.hlen = sizeof(*capsule_resp);
+	capsule_resp->rccqe = tcp_req->req.rsp->nvme_cpl;
+	if (tqpair->host_hdgst_enable) {
+		capsule_resp->common.flags |= SPDK_NVME_TCP_CH_FLAGS_HDGSTF;
+		capsule_resp->common.plen += SPDK_NVME_TCP_DIGEST_LEN;
+	}
+}
+
 static void
 nvmf_tcp_send_capsule_resp_pdu(struct spdk_nvmf_tcp_req *tcp_req,
 			       struct spdk_nvmf_tcp_qpair *tqpair)
 {
 	struct nvme_tcp_pdu *rsp_pdu;
-	struct spdk_nvme_tcp_rsp *capsule_resp;
 
 	SPDK_DEBUGLOG(nvmf_tcp, "enter, tqpair=%p\n", tqpair);
 
 	rsp_pdu = nvmf_tcp_req_pdu_init(tcp_req);
 	assert(rsp_pdu != NULL);
 
-	capsule_resp = &rsp_pdu->hdr.capsule_resp;
-	capsule_resp->common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_CAPSULE_RESP;
-	capsule_resp->common.plen = capsule_resp->common.hlen = sizeof(*capsule_resp);
-	capsule_resp->rccqe = tcp_req->req.rsp->nvme_cpl;
+	nvmf_tcp_capsule_resp_hdr_init(tqpair, tcp_req, &rsp_pdu->hdr.capsule_resp);
+
+	nvmf_tcp_qpair_write_req_pdu(tqpair, tcp_req, nvmf_tcp_request_free, tcp_req);
+}
+
+/* Build the capsule response of a request whose last C2H data PDU cannot carry the
+ * SUCCESS flag, so that it is written in the same socket request as that PDU instead
+ * of after the data has been written.
+ */
+static void
+nvmf_tcp_piggyback_capsule_resp(struct spdk_nvmf_tcp_req *tcp_req,
+				struct spdk_nvmf_tcp_qpair *tqpair)
+{
+	struct spdk_nvme_tcp_rsp *capsule_resp = &tcp_req->piggyback_rsp.capsule_resp;
+	uint32_t crc32c;
+
+	memset(&tcp_req->piggyback_rsp, 0, sizeof(tcp_req->piggyback_rsp));
+	nvmf_tcp_capsule_resp_hdr_init(tqpair, tcp_req, capsule_resp);
+
 	if (tqpair->host_hdgst_enable) {
-		capsule_resp->common.flags |= SPDK_NVME_TCP_CH_FLAGS_HDGSTF;
-		capsule_resp->common.plen += SPDK_NVME_TCP_DIGEST_LEN;
+		crc32c = spdk_crc32c_update(capsule_resp, capsule_resp->common.hlen, ~0);
+		crc32c = crc32c ^ SPDK_CRC32C_XOR;
+		MAKE_DIGEST_WORD(tcp_req->piggyback_rsp.raw + capsule_resp->common.hlen, crc32c);
 	}
 
-	nvmf_tcp_qpair_write_req_pdu(tqpair, tcp_req, nvmf_tcp_request_free, tcp_req);
+	tcp_req->rsp_piggybacked = true;
 }
 
 static void
@@ -1849,7 +2015,8 @@ nvmf_tcp_pdu_c2h_data_complete(void *cb_arg)
 		return;
 	}
 
-	if (tcp_req->pdu->hdr.c2h_data.common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_SUCCESS) {
+	if ((tcp_req->pdu->hdr.c2h_data.common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_SUCCESS) ||
+	    tcp_req->rsp_piggybacked) {
 		nvmf_tcp_request_free(tcp_req);
 	} else {
 		nvmf_tcp_send_capsule_resp_pdu(tcp_req, tqpair);
@@ -2051,13 +2218,17 @@ nvmf_tcp_pdu_payload_handle(struct spdk_nvmf_tcp_qpair *tqpair, struct nvme_tcp_
 	if (pdu->ddgst_enable) {
 		if (tqpair->qpair.qid != 0 && !pdu->dif_ctx && tqpair->group &&
 		    (pdu->data_len % SPDK_NVME_TCP_DIGEST_ALIGNMENT == 0)) {
-			rc = spdk_accel_submit_crc32cv(tqpair->group->accel_channel, &pdu->data_digest_crc32, pdu->data_iov,
-						       pdu->data_iovcnt, 0, data_crc32_calc_done, pdu);
+			rc = spdk_accel_digest_crc32c(tqpair->group->accel_channel, &pdu->data_digest_crc32,
+						      pdu->data_iov, pdu->data_iovcnt,
+						      &tqpair->group->digest_stats, data_crc32_calc_done, pdu);
 			if (spdk_likely(rc == 0)) {
 				return;
 			}
 		} else {
 			pdu->data_digest_crc32 = nvme_tcp_pdu_calc_data_digest(pdu);
+			if (tqpair->group != NULL) {
+				tqpair->group->digest_stats.inlined++;
+			}
 		}
 		data_crc32_calc_done(pdu, rc);
 	} else {
@@ -2292,6 +2463,201 @@ err:
 	nvmf_tcp_send_c2h_term_req(tqpair, pdu, fes, error_offset);
 }
 
+static void
+nvmf_tcp_recv_buf_put(struct nvmf_tcp_recv_buf *recv_buf)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup = recv_buf->tgroup;
+
+	assert(recv_buf->ref > 0);
+	if (--recv_buf->ref > 0) {
+		return;
+	}
+
+	spdk_sock_group_provide_buf(tgroup->sock_group, recv_buf->buf, tgroup->recv_buf_size, recv_buf);
+}
+
+/*
+ * Takes the next buffer the socket received data into and appends it to the qpair.
+ *  Returns the number of bytes received, 0 if no data is available, -ENOBUFS if the
+ *  data has to be read by spdk_sock_recv() instead, or NVME_TCP_CONNECTION_FATAL.
+ */
+static int
+nvmf_tcp_recv_next(struct spdk_nvmf_tcp_qpair *tqpair)
+{
+	struct nvmf_tcp_recv_buf *recv_buf;
+	void *buf, *ctx;
+	int rc;
+
+	rc = spdk_sock_recv_next(tqpair->sock, &buf, &ctx);
+	if (rc > 0) {
+		recv_buf = ctx;
+		assert(recv_buf->ref == 0);
+
+		recv_buf->data = buf;
+		recv_buf->len = rc;
+		recv_buf->offset = 0;
+		recv_buf->ref = 1;
+		STAILQ_INSERT_TAIL(&tqpair->recv_bufs, recv_buf, link);
+		return rc;
+	}
+
+	if (rc < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return 0;
+		}
+
+		if (errno == ENOTSUP) {
+			/* The socket reads through its receive pipe. */
+			tqpair->recv_next = false;
+			return -ENOBUFS;
+		}
+
+		if (errno == ENOBUFS) {
+			/* All buffers of the poll group are in use. */
+			return -ENOBUFS;
+		}
+
+		/* For connect reset issue, do not output error log */
+		if (errno != ECONNRESET) {
+			SPDK_ERRLOG("spdk_sock_recv_next() failed, errno %d: %s\n",
+				    errno, spdk_strerror(errno));
+		}
+	}
+
+	/* connection closed */
+	return NVME_TCP_CONNECTION_FATAL;
+}
+
+static void
+nvmf_tcp_recv_advance(struct spdk_nvmf_tcp_qpair *tqpair, struct nvmf_tcp_recv_buf *recv_buf,
+		      uint32_t len)
+{
+	assert(recv_buf == STAILQ_FIRST(&tqpair->recv_bufs));
+	assert(recv_buf->offset + len <= recv_buf->len);
+
+	recv_buf->offset += len;
+	if (recv_buf->offset == recv_buf->len) {
+		STAILQ_REMOVE_HEAD(&tqpair->recv_bufs, link);
+		nvmf_tcp_recv_buf_put(recv_buf);
+	}
+}
+
+/* Copy data already received into the receive buffers of the qpair. */
+static int
+nvmf_tcp_recv_copy(struct spdk_nvmf_tcp_qpair *tqpair, struct iovec *iov, int iovcnt)
+{
+	struct nvmf_tcp_recv_buf *recv_buf;
+	struct spdk_iov_xfer ix;
+	uint32_t total, copied, len;
+	int i;
+
+	for (i = 0, total = 0; i < iovcnt; i++) {
+		total += iov[i].iov_len;
+	}
+
+	spdk_iov_xfer_init(&ix, iov, iovcnt);
+	copied = 0;
+
+	while (copied < total && (recv_buf = STAILQ_FIRST(&tqpair->recv_bufs)) != NULL) {
+		len = spdk_min(total - copied, recv_buf->len - recv_buf->offset);
+		spdk_iov_xfer_from_buf(&ix, recv_buf->data + recv_buf->offset, len);
+		copied += len;
+		nvmf_tcp_recv_advance(tqpair, recv_buf, len);
+	}
+
+	return copied;
+}
+
+static int
+nvmf_tcp_read_data(struct spdk_nvmf_tcp_qpair *tqpair, int bytes, void *buf)
+{
+	struct iovec iov;
+	int rc;
+
+	if (STAILQ_EMPTY(&tqpair->recv_bufs) && tqpair->recv_next) {
+		rc = nvmf_tcp_recv_next(tqpair);
+		if (rc <= 0 && rc != -ENOBUFS) {
+			return rc;
+		}
+	}
+
+	if (!STAILQ_EMPTY(&tqpair->recv_bufs)) {
+		iov.iov_base = buf;
+		iov.iov_len = bytes;
+
+		return nvmf_tcp_recv_copy(tqpair, &iov, 1);
+	}
+
+	return nvme_tcp_read_data(tqpair->sock, bytes, buf);
+}
+
+/* Place the in-capsule data of a command in the receive buffer holding it instead of
+ * copying it into the in-capsule data buffer of the request. The buffer is held until
+ * the request completes.
+ */
+static bool
+nvmf_tcp_pdu_payload_in_place(struct spdk_nvmf_tcp_qpair *tqpair, struct nvme_tcp_pdu *pdu,
+			      uint32_t data_len)
+{
+	struct spdk_nvmf_tcp_req *tcp_req = pdu->req;
+	struct nvmf_tcp_recv_buf *recv_buf;
+	uint8_t *data;
+
+	if (pdu->hdr.common.pdu_type != SPDK_NVME_TCP_PDU_TYPE_CAPSULE_CMD || pdu->rw_offset != 0 ||
+	    pdu->dif_ctx != NULL || pdu->data_iovcnt != 1 || tcp_req == NULL ||
+	    pdu->data_iov[0].iov_base != tcp_req->buf) {
+		return false;
+	}
+
+	recv_buf = STAILQ_FIRST(&tqpair->recv_bufs);
+	if (recv_buf == NULL || recv_buf->len - recv_buf->offset < data_len) {
+		return false;
+	}
+
+	/* Devices using PRPs require dword aligned data. */
+	data = recv_buf->data + recv_buf->offset;
+	if ((uintptr_t)data % SPDK_NVME_TCP_DIGEST_ALIGNMENT != 0) {
+		return false;
+	}
+
+	assert(tcp_req->req.iovcnt == 1 && tcp_req->req.iov[0].iov_len == pdu->data_len);
+	tcp_req->req.iov[0].iov_base = data;
+	pdu->data_iov[0].iov_base = data;
+	if (pdu->ddgst_enable) {
+		memcpy(pdu->data_digest, data + pdu->data_len, SPDK_NVME_TCP_DIGEST_LEN);
+	}
+
+	recv_buf->ref++;
+	tcp_req->recv_buf = recv_buf;
+	nvmf_tcp_recv_advance(tqpair, recv_buf, data_len);
+	tqpair->group->in_place_capsule_data++;
+
+	return true;
+}
+
+static int
+nvmf_tcp_read_payload_data(struct spdk_nvmf_tcp_qpair *tqpair, struct nvme_tcp_pdu *pdu,
+			   uint32_t data_len)
+{
+	struct iovec iov[NVME_TCP_MAX_SGL_DESCRIPTORS + 1];
+	int iovcnt;
+
+	if (STAILQ_EMPTY(&tqpair->recv_bufs)) {
+		/* Nothing is pending, so the payload is read straight into its buffers. */
+		return nvme_tcp_read_payload_data(tqpair->sock, pdu);
+	}
+
+	if (nvmf_tcp_pdu_payload_in_place(tqpair, pdu, data_len)) {
+		return data_len;
+	}
+
+	iovcnt = nvme_tcp_build_payload_iovs(iov, NVME_TCP_MAX_SGL_DESCRIPTORS + 1, pdu,
+					     pdu->ddgst_enable, NULL);
+	assert(iovcnt >= 0);
+
+	return nvmf_tcp_recv_copy(tqpair, iov, iovcnt);
+}
+
 static int
 nvmf_tcp_sock_process(struct spdk_nvmf_tcp_qpair *tqpair)
 {
@@ -2333,7 +2699,7 @@ nvmf_tcp_sock_process(struct spdk_nvmf_tcp_qpair *tqpair)
 				return rc;
 			}
 
-			rc = nvme_tcp_read_data(tqpair->sock,
+			rc = nvmf_tcp_read_data(tqpair,
 						sizeof(struct spdk_nvme_tcp_common_pdu_hdr) - pdu->ch_valid_bytes,
 						(void *)&pdu->hdr.common + pdu->ch_valid_bytes);
 			if (rc < 0) {
@@ -2354,7 +2720,7 @@ nvmf_tcp_sock_process(struct spdk_nvmf_tcp_qpair *tqpair)
 			break;
 		/* Wait for the pdu specific header  */
 		case NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PSH:
-			rc = nvme_tcp_read_data(tqpair->sock,
+			rc = nvmf_tcp_read_data(tqpair,
 						pdu->psh_len - pdu->psh_valid_bytes,
 						(void *)&pdu->hdr.raw + sizeof(struct spdk_nvme_tcp_common_pdu_hdr) + pdu->psh_valid_bytes);
 			if (rc < 0) {
@@ -2390,7 +2756,7 @@ nvmf_tcp_sock_process(struct spdk_nvmf_tcp_qpair *tqpair)
 				pdu->ddgst_enable = true;
 			}
 
-			rc = nvme_tcp_read_payload_data(tqpair->sock, pdu);
+			rc = nvmf_tcp_read_payload_data(tqpair, pdu, data_len);
 			if (rc < 0) {
 				nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_QUIESCING);
 				break;
@@ -2702,6 +3068,10 @@ _nvmf_tcp_send_c2h_data(struct spdk_nvmf_tcp_qpair *tqpair,
 			ddgst_len = SPDK_NVME_TCP_DIGEST_LEN;
 			c2h_data->common.plen -= ddgst_len;
 		}
+		if (!(c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_SUCCESS)) {
+			/* The piggybacked capsule response consumes additional iov entry */
+			available_iovs--;
+		}
 		/* Temp call to estimate if data can be described by limited number of iovs.
 		 * iov vector will be rebuilt in nvmf_tcp_qpair_write_pdu */
 		nvme_tcp_build_iovs(rsp_pdu->iov, available_iovs, rsp_pdu, tqpair->host_hdgst_enable,
@@ -2739,6 +3109,15 @@ _nvmf_tcp_send_c2h_data(struct spdk_nvmf_tcp_qpair *tqpair,
 	}
 
 	rsp_pdu->rw_offset += c2h_data->datal;
+	rsp_pdu->req = tcp_req;
+
+	tcp_req->rsp_piggybacked = false;
+	if ((c2h_data->common.flags & (SPDK_NVME_TCP_C2H_DATA_FLAGS_LAST_PDU |
+				       SPDK_NVME_TCP_C2H_DATA_FLAGS_SUCCESS)) ==
+	    SPDK_NVME_TCP_C2H_DATA_FLAGS_LAST_PDU) {
+		nvmf_tcp_piggyback_capsule_resp(tcp_req, tqpair);
+	}
+
 	nvmf_tcp_qpair_write_req_pdu(tqpair, tcp_req, nvmf_tcp_pdu_c2h_data_complete, tcp_req);
 }
 
@@ -3245,6 +3624,7 @@ nvmf_tcp_poll_group_add(struct spdk_nvmf_transport_poll_group *group,
 	}
 
 	tqpair->group = tgroup;
+	tqpair->recv_next = tgroup->recv_bufs != NULL;
 	nvmf_tcp_qpair_set_state(tqpair, NVME_TCP_QPAIR_STATE_INVALID);
 	TAILQ_INSERT_TAIL(&tgroup->qpairs, tqpair, link);
 
@@ -3271,6 +3651,12 @@ nvmf_tcp_poll_group_remove(struct spdk_nvmf_transport_poll_group *group,
 		TAILQ_REMOVE(&tgroup->qpairs, tqpair, link);
 	}
 
+	/* The socket may hold buffers of this poll group which were filled but not yet
+	 * handed to the qpair. Take them before leaving the socket group.
+	 */
+	while (tqpair->recv_next && nvmf_tcp_recv_next(tqpair) > 0) {
+	}
+
 	rc = spdk_sock_group_remove_sock(tgroup->sock_group, tqpair->sock);
 	if (rc != 0) {
 		SPDK_ERRLOG("Could not remove sock from sock_group: %s (%d)\n",
@@ -3366,6 +3752,20 @@ nvmf_tcp_poll_group_poll(struct spdk_nvmf_transport_poll_group *group)
 		}
 	}
 
+	/* Data already taken off the socket does not raise another socket event.
+	 * Keep processing the qpairs until their receive buffers are consumed.
+	 */
+	TAILQ_FOREACH_SAFE(tqpair, &tgroup->qpairs, link, tqpair_tmp) {
+		if (STAILQ_EMPTY(&tqpair->recv_bufs)) {
+			continue;
+		}
+
+		rc = nvmf_tcp_sock_process(tqpair);
+		if (rc < 0) {
+			nvmf_tcp_qpair_disconnect(tqpair);
+		}
+	}
+
 	return rc;
 }
 
@@ -3781,6 +4181,22 @@ nvmf_tcp_opts_init(struct spdk_nvmf_transport_opts *opts)
 	opts->transport_specific =      NULL;
 }
 
+static void
+nvmf_tcp_poll_group_dump_stat(struct spdk_nvmf_transport_poll_group *group,
+			      struct spdk_json_write_ctx *w)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup;
+
+	assert(w != NULL);
+
+	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
+
+	spdk_json_write_named_uint64(w, "offloaded_data_digests", tgroup->digest_stats.offloaded);
+	spdk_json_write_named_uint64(w, "inline_data_digests", tgroup->digest_stats.inlined);
+	spdk_json_write_named_uint64(w, "in_place_capsule_data", tgroup->in_place_capsule_data);
+	spdk_json_write_named_uint64(w, "piggybacked_capsule_resps", tgroup->piggybacked_capsule_resps);
+}
+
 const struct spdk_nvmf_transport_ops spdk_nvmf_transport_tcp = {
 	.name = "TCP",
 	.type = SPDK_NVME_TRANSPORT_TCP,
@@ -3800,6 +4216,7 @@ const struct spdk_nvmf_transport_ops spdk_nvmf_transport_tcp = {
 	.poll_group_add = nvmf_tcp_poll_group_add,
 	.poll_group_remove = nvmf_tcp_poll_group_remove,
 	.poll_group_poll = nvmf_tcp_poll_group_poll,
+	.poll_group_dump_stat = nvmf_tcp_poll_group_dump_stat,
 
 	.req_free = nvmf_tcp_req_free,
 	.req_complete = nvmf_tcp_req_complete,
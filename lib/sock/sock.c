@@ -15,6 +15,10 @@
 #define SPDK_SOCK_DEFAULT_PRIORITY 0
 #define SPDK_SOCK_DEFAULT_ZCOPY true
 #define SPDK_SOCK_DEFAULT_ACK_TIMEOUT 0
+#define SPDK_SOCK_DEFAULT_REUSEPORT false
+
+/* 16 buckets per power of two of the flushed bytes are enough for tuning */
+#define FLUSH_HISTOGRAM_BUCKET_SHIFT 4
 
 #define SPDK_SOCK_OPTS_FIELD_OK(opts, field) (offsetof(struct spdk_sock_opts, field) + sizeof(opts->field) <= (opts->opts_size))
 
@@ -248,6 +252,10 @@ spdk_sock_get_default_opts(struct spdk_sock_opts *opts)
 		opts->zcopy = SPDK_SOCK_DEFAULT_ZCOPY;
 	}
 
+	if (SPDK_SOCK_OPTS_FIELD_OK(opts, reuseport)) {
+		opts->reuseport = SPDK_SOCK_DEFAULT_REUSEPORT;
+	}
+
 	if (SPDK_SOCK_OPTS_FIELD_OK(opts, ack_timeout)) {
 		opts->ack_timeout = SPDK_SOCK_DEFAULT_ACK_TIMEOUT;
 	}
@@ -284,6 +292,10 @@ sock_init_opts(struct spdk_sock_opts *opts, struct spdk_sock_opts *opts_user)
 		opts->zcopy = opts_user->zcopy;
 	}
 
+	if (SPDK_SOCK_OPTS_FIELD_OK(opts, reuseport)) {
+		opts->reuseport = opts_user->reuseport;
+	}
+
 	if (SPDK_SOCK_OPTS_FIELD_OK(opts, ack_timeout)) {
 		opts->ack_timeout = opts_user->ack_timeout;
 	}
@@ -486,6 +498,83 @@ spdk_sock_writev(struct spdk_sock *sock, struct iovec *iov, int iovcnt)
 	return sock->net_impl->writev(sock, iov, iovcnt);
 }
 
+static void
+sock_group_set_busy(struct spdk_sock_group *group, bool busy)
+{
+#ifdef __linux__
+	uint64_t notify = 1;
+	int rc __attribute__((unused));
+
+	if (group->busy == busy) {
+		return;
+	}
+
+	if (busy) {
+		/* Write without read keeps the eventfd readable, so the interrupt fires repeatedly. */
+		rc = write(group->busy_efd, &notify, sizeof(notify));
+	} else {
+		/* Read clears the eventfd, so only the sockets can fire the interrupt. */
+		rc = read(group->busy_efd, &notify, sizeof(notify));
+	}
+	group->busy = busy;
+#endif
+}
+
+static bool
+sock_group_has_queued_reqs(struct spdk_sock_group *group)
+{
+	struct spdk_sock_group_impl *group_impl;
+	struct spdk_sock *sock;
+
+	STAILQ_FOREACH(group_impl, &group->group_impls, link) {
+		TAILQ_FOREACH(sock, &group_impl->socks, link) {
+			if (!TAILQ_EMPTY(&sock->queued_reqs)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static bool
+sock_group_is_empty(struct spdk_sock_group *group)
+{
+	struct spdk_sock_group_impl *group_impl;
+
+	STAILQ_FOREACH(group_impl, &group->group_impls, link) {
+		if (!TAILQ_EMPTY(&group_impl->socks)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Called if the group may have work which is not signaled by the sockets. */
+static inline void
+sock_group_wakeup(struct spdk_sock_group *group)
+{
+	if (group->busy_intr != NULL && !group->busy) {
+		group->last_busy_tsc = spdk_get_ticks();
+		sock_group_set_busy(group, true);
+	}
+}
+
+static void
+sock_group_update_busy(struct spdk_sock_group *group, int num_events)
+{
+	uint64_t now = spdk_get_ticks();
+
+	if (num_events != 0 || group->always_busy) {
+		group->last_busy_tsc = now;
+		sock_group_set_busy(group, true);
+	} else if (group->busy && now - group->last_busy_tsc >= group->busy_poll_ticks &&
+		   !sock_group_has_queued_reqs(group)) {
+		sock_group_set_busy(group, false);
+	}
+}
+
 void
 spdk_sock_writev_async(struct spdk_sock *sock, struct spdk_sock_request *req)
 {
@@ -497,6 +586,10 @@ spdk_sock_writev_async(struct spdk_sock *sock, struct spdk_sock_request *req)
 	}
 
 	sock->net_impl->writev_async(sock, req);
+
+	if (sock->group_impl != NULL) {
+		sock_group_wakeup(sock->group_impl->group);
+	}
 }
 
 int
@@ -574,8 +667,15 @@ spdk_sock_group_create(void *ctx)
 		return NULL;
 	}
 
+	group->flush_histogram = spdk_histogram_data_alloc_sized(FLUSH_HISTOGRAM_BUCKET_SHIFT);
+	if (group->flush_histogram == NULL) {
+		free(group);
+		return NULL;
+	}
+
 	STAILQ_INIT(&group->group_impls);
 	STAILQ_INIT(&group->pool);
+	group->busy_efd = -1;
 
 	STAILQ_FOREACH_FROM(impl, &g_net_impls, link) {
 		group_impl = impl->group_impl_create();
@@ -638,6 +738,9 @@ spdk_sock_group_add_sock(struct spdk_sock_group *group, struct spdk_sock *sock,
 	sock->cb_fn = cb_fn;
 	sock->cb_arg = cb_arg;
 
+	/* The socket may already have data buffered by the implementation. */
+	sock_group_wakeup(group);
+
 	return 0;
 }
 
@@ -661,6 +764,10 @@ spdk_sock_group_remove_sock(struct spdk_sock_group *group, struct spdk_sock *soc
 		sock->group_impl = NULL;
 		sock->cb_fn = NULL;
 		sock->cb_arg = NULL;
+
+		if (group->busy_intr != NULL && sock_group_is_empty(group)) {
+			sock_group_set_busy(group, false);
+		}
 	}
 
 	return rc;
@@ -677,6 +784,9 @@ spdk_sock_group_provide_buf(struct spdk_sock_group *group, void *buf, size_t len
 	provided->ctx = ctx;
 	STAILQ_INSERT_HEAD(&group->pool, provided, link);
 
+	/* Sockets may be waiting for a buffer to receive into. */
+	sock_group_wakeup(group);
+
 	return 0;
 }
 
@@ -759,9 +869,104 @@ spdk_sock_group_poll_count(struct spdk_sock_group *group, int max_events)
 		}
 	}
 
+	if (group->busy_intr != NULL) {
+		sock_group_update_busy(group, num_events);
+	}
+
 	return num_events;
 }
 
+#ifdef __linux__
+int
+spdk_sock_group_register_interrupt(struct spdk_sock_group *group, uint32_t busy_poll_us,
+				   spdk_interrupt_fn fn, void *arg, const char *name)
+{
+	struct spdk_sock_group_impl *group_impl;
+	int efd, fd;
+
+	if (group->busy_intr != NULL) {
+		return -EEXIST;
+	}
+
+	efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (efd < 0) {
+		return -errno;
+	}
+
+	group->busy_intr = spdk_interrupt_register(efd, fn, arg, name);
+	if (group->busy_intr == NULL) {
+		close(efd);
+		return -ENOMEM;
+	}
+
+	group->busy_efd = efd;
+	group->busy = false;
+	group->always_busy = false;
+	group->busy_poll_ticks = busy_poll_us * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	group->last_busy_tsc = spdk_get_ticks();
+
+	STAILQ_FOREACH(group_impl, &group->group_impls, link) {
+		fd = -ENOTSUP;
+		if (group_impl->net_impl->group_impl_get_interrupt_fd != NULL) {
+			fd = group_impl->net_impl->group_impl_get_interrupt_fd(group_impl);
+		}
+
+		if (fd >= 0) {
+			group_impl->intr = spdk_interrupt_register(fd, fn, arg, name);
+		}
+
+		if (group_impl->intr == NULL) {
+			SPDK_NOTICELOG("Interrupt is not supported by net(%s), sock group is busy polled\n",
+				       group_impl->net_impl->name);
+			group->always_busy = true;
+		}
+	}
+
+	if (group->always_busy || sock_group_has_queued_reqs(group)) {
+		sock_group_set_busy(group, true);
+	}
+
+	return 0;
+}
+
+void
+spdk_sock_group_unregister_interrupt(struct spdk_sock_group *group)
+{
+	struct spdk_sock_group_impl *group_impl;
+
+	if (group->busy_intr == NULL) {
+		return;
+	}
+
+	STAILQ_FOREACH(group_impl, &group->group_impls, link) {
+		spdk_interrupt_unregister(&group_impl->intr);
+	}
+
+	spdk_interrupt_unregister(&group->busy_intr);
+	close(group->busy_efd);
+	group->busy_efd = -1;
+	group->busy = false;
+}
+#else
+int
+spdk_sock_group_register_interrupt(struct spdk_sock_group *group, uint32_t busy_poll_us,
+				   spdk_interrupt_fn fn, void *arg, const char *name)
+{
+	return -ENOTSUP;
+}
+
+void
+spdk_sock_group_unregister_interrupt(struct spdk_sock_group *group)
+{
+}
+#endif
+
+const struct spdk_histogram_data *
+spdk_sock_group_get_flush_histogram(struct spdk_sock_group *group)
+{
+	return group->flush_histogram;
+}
+
 int
 spdk_sock_group_close(struct spdk_sock_group **group)
 {
@@ -780,6 +985,8 @@ spdk_sock_group_close(struct spdk_sock_group **group)
 		}
 	}
 
+	spdk_sock_group_unregister_interrupt(*group);
+
 	STAILQ_FOREACH_SAFE(group_impl, &(*group)->group_impls, link, tmp) {
 		rc = group_impl->net_impl->group_impl_close(group_impl);
 		if (rc != 0) {
@@ -787,6 +994,7 @@ spdk_sock_group_close(struct spdk_sock_group **group)
 		}
 	}
 
+	spdk_histogram_data_free((*group)->flush_histogram);
 	free(*group);
 	*group = NULL;
 
@@ -897,6 +1105,11 @@ spdk_sock_write_config_json(struct spdk_json_write_ctx *w)
 			spdk_json_write_named_uint32(w, "zerocopy_threshold", opts.zerocopy_threshold);
 			spdk_json_write_named_uint32(w, "tls_version", opts.tls_version);
 			spdk_json_write_named_bool(w, "enable_ktls", opts.enable_ktls);
+			spdk_json_write_named_uint32(w, "flush_batch_timeout", opts.flush_batch_timeout);
+			spdk_json_write_named_uint32(w, "flush_batch_iovcnt_threshold",
+						     opts.flush_batch_iovcnt_threshold);
+			spdk_json_write_named_uint32(w, "flush_batch_bytes_threshold",
+						     opts.flush_batch_bytes_threshold);
 			spdk_json_write_object_end(w);
 			spdk_json_write_object_end(w);
 		} else {
@@ -0,0 +1,421 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * Coroutines switch stacks with _setjmp()/_longjmp().  With _FORTIFY_SOURCE,
+ * glibc routes both through __longjmp_chk(), which aborts with "longjmp causes
+ * uninitialized stack frame" whenever the target frame is below the current
+ * stack pointer.  That's the normal case when jumping from one stack to
+ * another, so fortification has to be disabled for this file.  It doesn't
+ * lose anything else: nothing below uses the fortified string or I/O helpers.
+ */
+#undef _FORTIFY_SOURCE
+
+#include "spdk/stdinc.h"
+
+#include "spdk/likely.h"
+#include "spdk/log.h"
+#include "spdk/queue.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+
+#include "thread_internal.h"
+
+#include <setjmp.h>
+#include <ucontext.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define COROUTINE_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define COROUTINE_ASAN 1
+#endif
+#endif
+
+#ifdef COROUTINE_ASAN
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+/* Maximum number of terminated coroutines kept for reuse on each thread. */
+#define COROUTINE_CACHE_SIZE	16
+#define COROUTINE_GUARD_SIZE	4096
+
+enum coroutine_state {
+	/* Created, or suspended in spdk_coroutine_yield(). */
+	COROUTINE_STATE_SUSPENDED,
+	/* Currently executing, or executing another coroutine it entered. */
+	COROUTINE_STATE_RUNNING,
+	/* The coroutine's function has returned. */
+	COROUTINE_STATE_TERMINATED,
+};
+
+struct spdk_coroutine {
+	/* Saved context of the coroutine itself. */
+	jmp_buf				env;
+	/* Saved context of whoever entered the coroutine. */
+	jmp_buf				caller_env;
+	struct spdk_coroutine		*caller;
+	struct spdk_thread		*thread;
+	spdk_coroutine_fn		fn;
+	void				*arg;
+	enum coroutine_state		state;
+	bool				wake_pending;
+
+	/* Stack mapping, starting with a guard page. */
+	void				*stack;
+	/* Usable stack size, not including the guard page. */
+	size_t				stack_size;
+
+	/* Stack switch bookkeeping for AddressSanitizer. */
+	void				*fake_stack;
+	void				*caller_fake_stack;
+	const void			*caller_stack_bottom;
+	size_t				caller_stack_size;
+
+	SLIST_ENTRY(spdk_coroutine)	link;
+};
+
+static __thread struct spdk_coroutine *tls_coroutine;
+
+/*
+ * A coroutine may be resumed on a different pthread than the one it yielded on
+ * if its SPDK thread was moved in the meantime.  Keep the accesses to the
+ * thread-local pointer out of line, so that the compiler can't reuse a TLS
+ * address it computed before the switch.
+ */
+static __attribute__((noinline)) struct spdk_coroutine *
+coroutine_get_current(void)
+{
+	return tls_coroutine;
+}
+
+static __attribute__((noinline)) void
+coroutine_set_current(struct spdk_coroutine *co)
+{
+	tls_coroutine = co;
+}
+
+/*
+ * AddressSanitizer has to be told about every stack switch, or it reports
+ * false positives on the coroutine stacks and loses track of fake stack frames.
+ * Each _longjmp() to another stack is preceded by coroutine_asan_start_switch()
+ * and the code that runs after the matching _setjmp() returns calls
+ * coroutine_asan_finish_switch().
+ */
+static inline void
+coroutine_asan_start_switch(void **fake_stack_save, const void *bottom, size_t size)
+{
+#ifdef COROUTINE_ASAN
+	__sanitizer_start_switch_fiber(fake_stack_save, bottom, size);
+#endif
+}
+
+static inline void
+coroutine_asan_finish_switch(void *fake_stack_save, const void **bottom_old, size_t *size_old)
+{
+#ifdef COROUTINE_ASAN
+	__sanitizer_finish_switch_fiber(fake_stack_save, bottom_old, size_old);
+#endif
+}
+
+static inline void
+coroutine_asan_switch_to(struct spdk_coroutine *co)
+{
+	coroutine_asan_start_switch(&co->caller_fake_stack,
+				    (uint8_t *)co->stack + COROUTINE_GUARD_SIZE, co->stack_size);
+}
+
+static inline void
+coroutine_asan_switch_to_caller(struct spdk_coroutine *co)
+{
+	coroutine_asan_start_switch(&co->fake_stack, co->caller_stack_bottom, co->caller_stack_size);
+}
+
+/* Called on the coroutine's stack each time it's entered. */
+static inline void
+coroutine_asan_entered(struct spdk_coroutine *co)
+{
+	coroutine_asan_finish_switch(co->fake_stack, &co->caller_stack_bottom,
+				     &co->caller_stack_size);
+}
+
+/* Called on the caller's stack each time the coroutine yields or returns. */
+static inline void
+coroutine_asan_returned(struct spdk_coroutine *co)
+{
+	coroutine_asan_finish_switch(co->caller_fake_stack, NULL, NULL);
+}
+
+static void
+coroutine_free(struct spdk_coroutine *co)
+{
+	munmap(co->stack, co->stack_size + COROUTINE_GUARD_SIZE);
+	free(co);
+}
+
+static void
+coroutine_trampoline(int lo, int hi)
+{
+	struct spdk_coroutine *co;
+	jmp_buf *init_env;
+
+	co = (struct spdk_coroutine *)(((uintptr_t)(uint32_t)hi << 16 << 16) | (uint32_t)lo);
+
+	/* The first entry only saves the context and goes back to coroutine_alloc(). */
+	coroutine_asan_entered(co);
+	init_env = co->arg;
+	if (!_setjmp(co->env)) {
+		coroutine_asan_switch_to_caller(co);
+		_longjmp(*init_env, 1);
+	}
+	coroutine_asan_entered(co);
+
+	/*
+	 * Once the function returns, the coroutine hands control back to its caller
+	 * and waits here to be reused for another function.
+	 */
+	while (true) {
+		co->fn(co->arg);
+
+		co->state = COROUTINE_STATE_TERMINATED;
+		if (!_setjmp(co->env)) {
+			coroutine_asan_switch_to_caller(co);
+			_longjmp(co->caller_env, 1);
+		}
+		coroutine_asan_entered(co);
+	}
+}
+
+static struct spdk_coroutine *
+coroutine_alloc(size_t stack_size)
+{
+	/* Still used once swapcontext() returns here through _longjmp(). */
+	struct spdk_coroutine *volatile co;
+	ucontext_t uc, old_uc;
+	jmp_buf init_env;
+	uintptr_t ptr;
+
+	co = calloc(1, sizeof(*co));
+	if (co == NULL) {
+		return NULL;
+	}
+
+	co->stack_size = stack_size;
+	co->stack = mmap(NULL, stack_size + COROUTINE_GUARD_SIZE, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+	if (co->stack == MAP_FAILED) {
+		SPDK_ERRLOG("Failed to allocate coroutine stack: %s\n", spdk_strerror(errno));
+		free(co);
+		return NULL;
+	}
+
+	/* Stacks grow downwards, so an overflow runs into the guard page. */
+	if (mprotect(co->stack, COROUTINE_GUARD_SIZE, PROT_NONE) != 0) {
+		SPDK_ERRLOG("Failed to protect coroutine stack: %s\n", spdk_strerror(errno));
+		coroutine_free(co);
+		return NULL;
+	}
+
+	if (getcontext(&uc) != 0) {
+		coroutine_free(co);
+		return NULL;
+	}
+
+	uc.uc_link = NULL;
+	uc.uc_stack.ss_sp = co->stack;
+	uc.uc_stack.ss_size = co->stack_size + COROUTINE_GUARD_SIZE;
+	uc.uc_stack.ss_flags = 0;
+
+	/*
+	 * makecontext() only passes int arguments.  swapcontext() is slow, because
+	 * it saves and restores the signal mask, so it's only used once here to
+	 * start the trampoline.  All other switches are done with _longjmp().
+	 */
+	ptr = (uintptr_t)co;
+	co->arg = &init_env;
+	makecontext(&uc, (void (*)(void))coroutine_trampoline, 2,
+		    (int)(uint32_t)ptr, (int)(uint32_t)(ptr >> 16 >> 16));
+
+	if (!_setjmp(init_env)) {
+		coroutine_asan_switch_to(co);
+		swapcontext(&old_uc, &uc);
+	}
+	coroutine_asan_returned(co);
+
+	co->arg = NULL;
+
+	return co;
+}
+
+struct spdk_coroutine *
+spdk_coroutine_create(spdk_coroutine_fn fn, void *arg, size_t stack_size)
+{
+	struct spdk_thread *thread = spdk_get_thread();
+	struct thread_coroutines *coroutines;
+	struct spdk_coroutine *co = NULL;
+
+	if (spdk_unlikely(thread == NULL)) {
+		SPDK_ERRLOG("Coroutines can only be created on an SPDK thread\n");
+		assert(false);
+		return NULL;
+	}
+
+	coroutines = thread_get_coroutines(thread);
+
+	if (stack_size == 0) {
+		stack_size = SPDK_COROUTINE_DEFAULT_STACK_SIZE;
+	}
+	stack_size = SPDK_ALIGN_CEIL(stack_size, COROUTINE_GUARD_SIZE);
+
+	if (stack_size == SPDK_COROUTINE_DEFAULT_STACK_SIZE) {
+		co = SLIST_FIRST(&coroutines->cache);
+		if (co != NULL) {
+			SLIST_REMOVE_HEAD(&coroutines->cache, link);
+			assert(coroutines->cache_count > 0);
+			coroutines->cache_count--;
+		}
+	}
+
+	if (co == NULL) {
+		co = coroutine_alloc(stack_size);
+		if (co == NULL) {
+			return NULL;
+		}
+	}
+
+	co->thread = thread;
+	co->fn = fn;
+	co->arg = arg;
+	co->caller = NULL;
+	co->state = COROUTINE_STATE_SUSPENDED;
+	co->wake_pending = false;
+	coroutines->count++;
+
+	return co;
+}
+
+static void
+coroutine_release(struct spdk_coroutine *co)
+{
+	struct thread_coroutines *coroutines = thread_get_coroutines(co->thread);
+
+	assert(coroutines->count > 0);
+	coroutines->count--;
+
+	if (co->stack_size == SPDK_COROUTINE_DEFAULT_STACK_SIZE &&
+	    coroutines->cache_count < COROUTINE_CACHE_SIZE) {
+		SLIST_INSERT_HEAD(&coroutines->cache, co, link);
+		coroutines->cache_count++;
+	} else {
+		coroutine_free(co);
+	}
+}
+
+void
+spdk_coroutine_enter(struct spdk_coroutine *co)
+{
+	assert(co->thread == spdk_get_thread());
+	assert(co->state == COROUTINE_STATE_SUSPENDED);
+
+	co->caller = coroutine_get_current();
+	co->state = COROUTINE_STATE_RUNNING;
+	coroutine_set_current(co);
+
+	if (!_setjmp(co->caller_env)) {
+		coroutine_asan_switch_to(co);
+		_longjmp(co->env, 1);
+	}
+
+	/* The coroutine yielded or returned. */
+	coroutine_asan_returned(co);
+	coroutine_set_current(co->caller);
+	co->caller = NULL;
+
+	if (co->state == COROUTINE_STATE_TERMINATED) {
+		coroutine_release(co);
+	}
+}
+
+void
+spdk_coroutine_yield(void)
+{
+	struct spdk_coroutine *co = coroutine_get_current();
+
+	if (spdk_unlikely(co == NULL)) {
+		SPDK_ERRLOG("spdk_coroutine_yield() called outside of a coroutine\n");
+		assert(false);
+		return;
+	}
+
+	if (co->wake_pending) {
+		co->wake_pending = false;
+		return;
+	}
+
+	co->state = COROUTINE_STATE_SUSPENDED;
+	if (!_setjmp(co->env)) {
+		coroutine_asan_switch_to_caller(co);
+		_longjmp(co->caller_env, 1);
+	}
+	coroutine_asan_entered(co);
+}
+
+static void
+_coroutine_wake(void *ctx)
+{
+	spdk_coroutine_wake(ctx);
+}
+
+void
+spdk_coroutine_wake(struct spdk_coroutine *co)
+{
+	int rc;
+
+	if (co->thread != spdk_get_thread()) {
+		rc = spdk_thread_send_msg(co->thread, _coroutine_wake, co);
+		if (rc != 0) {
+			SPDK_ERRLOG("Failed to send coroutine wake up: %s\n", spdk_strerror(-rc));
+		}
+		return;
+	}
+
+	switch (co->state) {
+	case COROUTINE_STATE_SUSPENDED:
+		spdk_coroutine_enter(co);
+		break;
+	case COROUTINE_STATE_RUNNING:
+		co->wake_pending = true;
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+struct spdk_coroutine *
+spdk_coroutine_self(void)
+{
+	return coroutine_get_current();
+}
+
+struct spdk_thread *
+spdk_coroutine_get_thread(struct spdk_coroutine *co)
+{
+	return co->thread;
+}
+
+void
+thread_coroutines_fini(struct thread_coroutines *coroutines)
+{
+	struct spdk_coroutine *co;
+
+	while ((co = SLIST_FIRST(&coroutines->cache)) != NULL) {
+		SLIST_REMOVE_HEAD(&coroutines->cache, link);
+		coroutines->cache_count--;
+		coroutine_free(co);
+	}
+
+	assert(coroutines->cache_count == 0);
+}
@@ -69,12 +69,15 @@ enum spdk_poller_state {
 };
 
 struct spdk_poller {
+	/* Links the poller on the active or paused list, or on a slot of the timer wheel. */
 	TAILQ_ENTRY(spdk_poller)	tailq;
-	RB_ENTRY(spdk_poller)		node;
 
 	/* Current state of the poller; should only be accessed from the poller's thread. */
 	enum spdk_poller_state		state;
 
+	/* Timer wheel list the poller is on, if it is a timed poller. */
+	uint16_t			timer_slot;
+
 	uint64_t			period_ticks;
 	uint64_t			next_run_tick;
 	uint64_t			run_count;
@@ -90,6 +93,45 @@ struct spdk_poller {
 	char				name[SPDK_MAX_POLLER_NAME_LEN + 1];
 };
 
+/*
+ * Timed pollers are kept in a hierarchical timing wheel, so that arming,
+ * cancelling and expiring a timer are all O(1) even with many thousands of
+ * timed pollers on a single thread.
+ *
+ * The wheel has TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots, each
+ * level covering TIMER_WHEEL_BITS bits of the expiration tick.  A poller is
+ * placed on the level of the most significant bit in which its expiration
+ * differs from the current wheel time, so that slots on level 0 hold pollers
+ * expiring at exactly one tick and pollers on higher levels always expire
+ * later than all pollers on lower levels.  When the wheel time advances, the
+ * slots that were passed are emptied and their pollers are either moved to the
+ * expired list or re-added on a lower level.  A bitmap of non-empty slots per
+ * level allows skipping empty slots without looking at them.
+ */
+#define TIMER_WHEEL_BITS	6
+#define TIMER_WHEEL_SLOTS	(1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK	(TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS	((64 + TIMER_WHEEL_BITS - 1) / TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_NUM_SLOTS	(TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS)
+/* timer_slot value of pollers on the expired list */
+#define TIMER_WHEEL_EXPIRED	TIMER_WHEEL_NUM_SLOTS
+
+TAILQ_HEAD(timer_list, spdk_poller);
+
+struct timer_wheel {
+	/* Tick up to which the wheel has been advanced. */
+	uint64_t			now;
+	uint32_t			count;
+	/* Cache of the closest timed poller, only valid if first_valid is set. */
+	bool				first_valid;
+	struct spdk_poller		*first;
+	/* Pollers whose next_run_tick has been reached. */
+	struct timer_list		expired;
+	/* Bitmap of non-empty slots on each level. */
+	uint64_t			pending[TIMER_WHEEL_LEVELS];
+	struct timer_list		slots[TIMER_WHEEL_NUM_SLOTS];
+};
+
 enum spdk_thread_state {
 	/* The thread is processing poller and message by spdk_thread_poll(). */
 	SPDK_THREAD_STATE_RUNNING,
@@ -116,8 +158,7 @@ struct spdk_thread {
 	/**
 	 * Contains pollers running on this thread with a periodic timer.
 	 */
-	RB_HEAD(timed_pollers_tree, spdk_poller)	timed_pollers;
-	struct spdk_poller				*first_timed_poller;
+	struct timer_wheel				timed_pollers;
 	/*
 	 * Contains paused pollers.  Pollers on this queue are waiting until
 	 * they are resumed (in which case they're put onto the active/timer
@@ -152,6 +193,8 @@ struct spdk_thread {
 	bool				poller_unregistered;
 	struct spdk_fd_group		*fgrp;
 
+	struct thread_coroutines	coroutines;
+
 	/* User context allocated at the end */
 	uint8_t				ctx[0];
 };
@@ -298,28 +341,226 @@ SPDK_TRACE_REGISTER_FN(thread_trace, "thread", TRACE_GROUP_THREAD)
 					SPDK_TRACE_ARG_TYPE_INT, "refcnt");
 }
 
+static void
+timer_wheel_init(struct timer_wheel *wheel, uint64_t now)
+{
+	uint32_t i;
+
+	wheel->now = now;
+	wheel->count = 0;
+	wheel->first_valid = true;
+	wheel->first = NULL;
+	TAILQ_INIT(&wheel->expired);
+	memset(wheel->pending, 0, sizeof(wheel->pending));
+	for (i = 0; i < TIMER_WHEEL_NUM_SLOTS; i++) {
+		TAILQ_INIT(&wheel->slots[i]);
+	}
+}
+
+static inline struct timer_list *
+timer_wheel_list(struct timer_wheel *wheel, uint32_t slot)
+{
+	if (slot == TIMER_WHEEL_EXPIRED) {
+		return &wheel->expired;
+	}
+
+	return &wheel->slots[slot];
+}
+
+static inline void
+timer_wheel_link(struct timer_wheel *wheel, struct spdk_poller *poller)
+{
+	uint64_t expires = poller->next_run_tick;
+	uint32_t level, slot;
+
+	if (expires <= wheel->now) {
+		poller->timer_slot = TIMER_WHEEL_EXPIRED;
+		TAILQ_INSERT_TAIL(&wheel->expired, poller, tailq);
+		return;
+	}
+
+	level = (63 - __builtin_clzll(expires ^ wheel->now)) / TIMER_WHEEL_BITS;
+	slot = (expires >> (level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK;
+
+	poller->timer_slot = level * TIMER_WHEEL_SLOTS + slot;
+	TAILQ_INSERT_TAIL(&wheel->slots[poller->timer_slot], poller, tailq);
+	wheel->pending[level] |= 1ULL << slot;
+}
+
+static void
+timer_wheel_add(struct timer_wheel *wheel, struct spdk_poller *poller)
+{
+	timer_wheel_link(wheel, poller);
+	wheel->count++;
+
+	/* Pollers with the same next_run_tick are added after the cached one. */
+	if (wheel->first_valid &&
+	    (wheel->first == NULL || poller->next_run_tick < wheel->first->next_run_tick)) {
+		wheel->first = poller;
+	}
+}
+
+static void
+timer_wheel_remove(struct timer_wheel *wheel, struct spdk_poller *poller)
+{
+	struct timer_list *list = timer_wheel_list(wheel, poller->timer_slot);
+
+	TAILQ_REMOVE(list, poller, tailq);
+	if (poller->timer_slot != TIMER_WHEEL_EXPIRED && TAILQ_EMPTY(list)) {
+		wheel->pending[poller->timer_slot / TIMER_WHEEL_SLOTS] &=
+			~(1ULL << (poller->timer_slot % TIMER_WHEEL_SLOTS));
+	}
+
+	assert(wheel->count > 0);
+	wheel->count--;
+
+	if (wheel->first == poller) {
+		wheel->first = NULL;
+		wheel->first_valid = wheel->count == 0;
+	}
+}
+
 /*
- * If this compare function returns zero when two next_run_ticks are equal,
- * the macro RB_INSERT() returns a pointer to the element with the same
- * next_run_tick.
- *
- * Fortunately, the macro RB_REMOVE() takes not a key but a pointer to the element
- * to remove as a parameter.
- *
- * Hence we allow RB_INSERT() to insert elements with the same keys on the right
- * side by returning 1 when two next_run_ticks are equal.
+ * The pollers are placed relative to the wheel time, so if the time goes backwards,
+ * e.g. if the thread is moved to a core with a slightly different TSC, all of them
+ * have to be placed again.  Otherwise they'd expire before their next_run_tick.
  */
-static inline int
-timed_poller_compare(struct spdk_poller *poller1, struct spdk_poller *poller2)
+static void
+timer_wheel_rewind(struct timer_wheel *wheel, uint64_t now)
 {
-	if (poller1->next_run_tick < poller2->next_run_tick) {
-		return -1;
-	} else {
-		return 1;
+	struct timer_list pollers = TAILQ_HEAD_INITIALIZER(pollers);
+	struct spdk_poller *poller;
+	uint32_t i;
+
+	TAILQ_CONCAT(&pollers, &wheel->expired, tailq);
+	for (i = 0; i < TIMER_WHEEL_NUM_SLOTS; i++) {
+		TAILQ_CONCAT(&pollers, &wheel->slots[i], tailq);
+	}
+	memset(wheel->pending, 0, sizeof(wheel->pending));
+
+	wheel->now = now;
+
+	while ((poller = TAILQ_FIRST(&pollers)) != NULL) {
+		TAILQ_REMOVE(&pollers, poller, tailq);
+		timer_wheel_link(wheel, poller);
 	}
 }
 
-RB_GENERATE_STATIC(timed_pollers_tree, spdk_poller, node, timed_poller_compare);
+/* Move all pollers whose next_run_tick is not later than now to the expired list. */
+static void
+timer_wheel_advance(struct timer_wheel *wheel, uint64_t now)
+{
+	struct timer_list cascade = TAILQ_HEAD_INITIALIZER(cascade);
+	struct spdk_poller *poller;
+	uint64_t old_pos, new_pos, passed, pending;
+	uint32_t level, shift, slot;
+
+	if (spdk_unlikely(now < wheel->now)) {
+		timer_wheel_rewind(wheel, now);
+		return;
+	}
+
+	if (now == wheel->now) {
+		return;
+	}
+
+	if (wheel->count == 0) {
+		wheel->now = now;
+		return;
+	}
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		shift = level * TIMER_WHEEL_BITS;
+		old_pos = wheel->now >> shift;
+		new_pos = now >> shift;
+		if (old_pos == new_pos) {
+			/* Higher levels haven't moved either. */
+			break;
+		}
+
+		/* Mask of the slots passed on this level, i.e. (old_pos, new_pos]. */
+		if (new_pos - old_pos >= TIMER_WHEEL_SLOTS) {
+			passed = UINT64_MAX;
+		} else {
+			passed = (1ULL << (new_pos - old_pos)) - 1;
+			slot = (old_pos + 1) & TIMER_WHEEL_MASK;
+			passed = (passed << slot) | (passed >> ((TIMER_WHEEL_SLOTS - slot) & TIMER_WHEEL_MASK));
+		}
+
+		pending = wheel->pending[level] & passed;
+		wheel->pending[level] &= ~passed;
+		while (pending != 0) {
+			slot = __builtin_ctzll(pending);
+			pending &= pending - 1;
+			TAILQ_CONCAT(&cascade, &wheel->slots[level * TIMER_WHEEL_SLOTS + slot], tailq);
+		}
+	}
+
+	wheel->now = now;
+
+	while ((poller = TAILQ_FIRST(&cascade)) != NULL) {
+		TAILQ_REMOVE(&cascade, poller, tailq);
+		timer_wheel_link(wheel, poller);
+	}
+}
+
+/* Find the first poller on a non-empty slot starting from the given one. */
+static struct spdk_poller *
+timer_wheel_first_from(struct timer_wheel *wheel, uint32_t slot)
+{
+	uint64_t pending;
+	uint32_t level;
+
+	if (slot == TIMER_WHEEL_EXPIRED) {
+		if (!TAILQ_EMPTY(&wheel->expired)) {
+			return TAILQ_FIRST(&wheel->expired);
+		}
+		slot = 0;
+	}
+
+	for (level = slot / TIMER_WHEEL_SLOTS; level < TIMER_WHEEL_LEVELS; level++) {
+		pending = wheel->pending[level];
+		if (level == slot / TIMER_WHEEL_SLOTS) {
+			pending &= UINT64_MAX << (slot % TIMER_WHEEL_SLOTS);
+		}
+		if (pending != 0) {
+			return TAILQ_FIRST(&wheel->slots[level * TIMER_WHEEL_SLOTS +
+							 __builtin_ctzll(pending)]);
+		}
+	}
+
+	return NULL;
+}
+
+static struct spdk_poller *
+timer_wheel_first(struct timer_wheel *wheel)
+{
+	struct spdk_poller *poller, *first;
+
+	if (wheel->first_valid) {
+		return wheel->first;
+	}
+
+	/*
+	 * Pollers on lower levels expire earlier than the ones on higher levels and
+	 * the slots of a level are ordered, so the closest poller is on the first
+	 * non-empty slot.  Only slots on level 0 hold a single expiration tick.
+	 */
+	first = timer_wheel_first_from(wheel, TIMER_WHEEL_EXPIRED);
+	if (first != NULL) {
+		poller = first;
+		while ((poller = TAILQ_NEXT(poller, tailq)) != NULL) {
+			if (poller->next_run_tick < first->next_run_tick) {
+				first = poller;
+			}
+		}
+	}
+
+	wheel->first = first;
+	wheel->first_valid = true;
+
+	return first;
+}
 
 static inline struct spdk_thread *
 _get_thread(void)
@@ -375,12 +616,12 @@ _free_thread(struct spdk_thread *thread)
 		free(poller);
 	}
 
-	RB_FOREACH_SAFE(poller, timed_pollers_tree, &thread->timed_pollers, ptmp) {
+	while ((poller = timer_wheel_first_from(&thread->timed_pollers, TIMER_WHEEL_EXPIRED)) != NULL) {
 		if (poller->state != SPDK_POLLER_STATE_UNREGISTERED) {
 			SPDK_WARNLOG("timed_poller %s still registered at thread exit\n",
 				     poller->name);
 		}
-		RB_REMOVE(timed_pollers_tree, &thread->timed_pollers, poller);
+		timer_wheel_remove(&thread->timed_pollers, poller);
 		free(poller);
 	}
 
@@ -390,6 +631,12 @@ _free_thread(struct spdk_thread *thread)
 		free(poller);
 	}
 
+	if (thread->coroutines.count > 0) {
+		SPDK_WARNLOG("thread %s still has %u coroutines at thread exit\n",
+			     thread->name, thread->coroutines.count);
+	}
+	thread_coroutines_fini(&thread->coroutines);
+
 	pthread_mutex_lock(&g_devlist_mutex);
 	assert(g_thread_count > 0);
 	g_thread_count--;
@@ -501,10 +748,11 @@ spdk_thread_create(const char *name, const struct spdk_cpuset *cpumask)
 
 	RB_INIT(&thread->io_channels);
 	TAILQ_INIT(&thread->active_pollers);
-	RB_INIT(&thread->timed_pollers);
+	timer_wheel_init(&thread->timed_pollers, spdk_get_ticks());
 	TAILQ_INIT(&thread->paused_pollers);
 	SLIST_INIT(&thread->msg_cache);
 	thread->msg_cache_count = 0;
+	SLIST_INIT(&thread->coroutines.cache);
 
 	thread->tsc_last = spdk_get_ticks();
 
@@ -651,7 +899,8 @@ thread_exit(struct spdk_thread *thread, uint64_t now)
 		}
 	}
 
-	RB_FOREACH(poller, timed_pollers_tree, &thread->timed_pollers) {
+	for (poller = spdk_thread_get_first_timed_poller(thread); poller != NULL;
+	     poller = spdk_thread_get_next_timed_poller(poller)) {
 		if (poller->state != SPDK_POLLER_STATE_UNREGISTERED) {
 			SPDK_INFOLOG(thread,
 				     "thread %s still has active timed poller %s\n",
@@ -681,6 +930,13 @@ thread_exit(struct spdk_thread *thread, uint64_t now)
 		return;
 	}
 
+	if (thread->coroutines.count > 0) {
+		SPDK_INFOLOG(thread,
+			     "thread %s still has %u coroutines\n",
+			     thread->name, thread->coroutines.count);
+		return;
+	}
+
 exited:
 	thread->state = SPDK_THREAD_STATE_EXITED;
 	if (spdk_unlikely(thread->in_interrupt)) {
@@ -865,41 +1121,15 @@ msg_queue_run_batch(struct spdk_thread *thread, uint32_t max_msgs)
 static void
 poller_insert_timer(struct spdk_thread *thread, struct spdk_poller *poller, uint64_t now)
 {
-	struct spdk_poller *tmp __attribute__((unused));
-
 	poller->next_run_tick = now + poller->period_ticks;
 
-	/*
-	 * Insert poller in the thread's timed_pollers tree by next scheduled run time
-	 * as its key.
-	 */
-	tmp = RB_INSERT(timed_pollers_tree, &thread->timed_pollers, poller);
-	assert(tmp == NULL);
-
-	/* Update the cache only if it is empty or the inserted poller is earlier than it.
-	 * RB_MIN() is not necessary here because all pollers, which has exactly the same
-	 * next_run_tick as the existing poller, are inserted on the right side.
-	 */
-	if (thread->first_timed_poller == NULL ||
-	    poller->next_run_tick < thread->first_timed_poller->next_run_tick) {
-		thread->first_timed_poller = poller;
-	}
+	timer_wheel_add(&thread->timed_pollers, poller);
 }
 
 static inline void
 poller_remove_timer(struct spdk_thread *thread, struct spdk_poller *poller)
 {
-	struct spdk_poller *tmp __attribute__((unused));
-
-	tmp = RB_REMOVE(timed_pollers_tree, &thread->timed_pollers, poller);
-	assert(tmp != NULL);
-
-	/* This function is not used in any case that is performance critical.
-	 * Update the cache simply by RB_MIN() if it needs to be changed.
-	 */
-	if (thread->first_timed_poller == poller) {
-		thread->first_timed_poller = RB_MIN(timed_pollers_tree, &thread->timed_pollers);
-	}
+	timer_wheel_remove(&thread->timed_pollers, poller);
 }
 
 static void
@@ -1053,7 +1283,7 @@ thread_execute_timed_poller(struct spdk_thread *thread, struct spdk_poller *poll
 static int
 thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 {
-	uint32_t msg_count;
+	uint32_t msg_count, expired_count;
 	struct spdk_poller *poller, *tmp;
 	spdk_msg_fn critical_msg;
 	int rc = 0;
@@ -1082,31 +1312,30 @@ thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 		}
 	}
 
-	poller = thread->first_timed_poller;
-	while (poller != NULL) {
+	timer_wheel_advance(&thread->timed_pollers, now);
+
+	/* Only run the pollers that have expired so far, in case some poller gets
+	 * re-inserted on the expired list, e.g. if now lags behind the wheel time.
+	 */
+	expired_count = 0;
+	TAILQ_FOREACH(poller, &thread->timed_pollers.expired, tailq) {
+		expired_count++;
+	}
+
+	while (expired_count-- > 0) {
 		int timer_rc = 0;
 
-		if (now < poller->next_run_tick) {
+		poller = TAILQ_FIRST(&thread->timed_pollers.expired);
+		if (poller == NULL) {
 			break;
 		}
 
-		tmp = RB_NEXT(timed_pollers_tree, &thread->timed_pollers, poller);
-		RB_REMOVE(timed_pollers_tree, &thread->timed_pollers, poller);
-
-		/* Update the cache to the next timed poller in the list
-		 * only if the current poller is still the closest, otherwise,
-		 * do nothing because the cache has been already updated.
-		 */
-		if (thread->first_timed_poller == poller) {
-			thread->first_timed_poller = tmp;
-		}
+		poller_remove_timer(thread, poller);
 
 		timer_rc = thread_execute_timed_poller(thread, poller, now);
 		if (timer_rc > rc) {
 			rc = timer_rc;
 		}
-
-		poller = tmp;
 	}
 
 	return rc;
@@ -1118,6 +1347,7 @@ _thread_remove_pollers(void *ctx)
 	struct spdk_thread *thread = ctx;
 	struct spdk_poller *poller, *tmp;
 
+	/* Unregistered timed pollers are moved to the active list. */
 	TAILQ_FOREACH_REVERSE_SAFE(poller, &thread->active_pollers,
 				   active_pollers_head, tailq, tmp) {
 		if (poller->state == SPDK_POLLER_STATE_UNREGISTERED) {
@@ -1126,13 +1356,6 @@ _thread_remove_pollers(void *ctx)
 		}
 	}
 
-	RB_FOREACH_SAFE(poller, timed_pollers_tree, &thread->timed_pollers, tmp) {
-		if (poller->state == SPDK_POLLER_STATE_UNREGISTERED) {
-			poller_remove_timer(thread, poller);
-			free(poller);
-		}
-	}
-
 	thread->poller_unregistered = false;
 }
 
@@ -1172,13 +1395,16 @@ spdk_thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 		if (spdk_unlikely(thread->state == SPDK_THREAD_STATE_EXITING)) {
 			thread_exit(thread, now);
 		}
+
+		thread_update_stats(thread, spdk_get_ticks(), now, rc);
 	} else {
-		/* Non-block wait on thread's fd_group */
+		/* Non-block wait on thread's fd_group. The time spent on the events
+		 * is accounted to the thread stats by _interrupt_wrapper().
+		 */
 		rc = spdk_fd_group_wait(thread->fgrp, 0);
+		thread->tsc_last = spdk_get_ticks();
 	}
 
-	thread_update_stats(thread, spdk_get_ticks(), now, rc);
-
 	tls_thread = orig_thread;
 
 	return rc;
@@ -1189,7 +1415,7 @@ spdk_thread_next_poller_expiration(struct spdk_thread *thread)
 {
 	struct spdk_poller *poller;
 
-	poller = thread->first_timed_poller;
+	poller = timer_wheel_first(&thread->timed_pollers);
 	if (poller) {
 		return poller->next_run_tick;
 	}
@@ -1207,7 +1433,7 @@ static bool
 thread_has_unpaused_pollers(struct spdk_thread *thread)
 {
 	if (TAILQ_EMPTY(&thread->active_pollers) &&
-	    RB_EMPTY(&thread->timed_pollers)) {
+	    thread->timed_pollers.count == 0) {
 		return false;
 	}
 
@@ -1254,6 +1480,12 @@ spdk_get_thread(void)
 	return _get_thread();
 }
 
+struct thread_coroutines *
+thread_get_coroutines(struct spdk_thread *thread)
+{
+	return &thread->coroutines;
+}
+
 const char *
 spdk_thread_get_name(const struct spdk_thread *thread)
 {
@@ -1784,13 +2016,20 @@ spdk_poller_unregister(struct spdk_poller **ppoller)
 		}
 	}
 
-	/* If the poller was paused, put it on the active_pollers list so that
-	 * its unregistration can be processed by spdk_thread_poll().
+	/* If the poller was paused or is waiting on the timer wheel, put it on the
+	 * active_pollers list so that its unregistration can be processed by
+	 * spdk_thread_poll().
 	 */
 	if (poller->state == SPDK_POLLER_STATE_PAUSED) {
 		TAILQ_REMOVE(&thread->paused_pollers, poller, tailq);
 		TAILQ_INSERT_TAIL(&thread->active_pollers, poller, tailq);
 		poller->period_ticks = 0;
+	} else if (poller->period_ticks > 0 &&
+		   (poller->state == SPDK_POLLER_STATE_WAITING ||
+		    poller->state == SPDK_POLLER_STATE_PAUSING)) {
+		poller_remove_timer(thread, poller);
+		TAILQ_INSERT_TAIL(&thread->active_pollers, poller, tailq);
+		poller->period_ticks = 0;
 	}
 
 	/* Simply set the state to unregistered. The poller will get cleaned up
@@ -1933,13 +2172,21 @@ spdk_thread_get_next_active_poller(struct spdk_poller *prev)
 struct spdk_poller *
 spdk_thread_get_first_timed_poller(struct spdk_thread *thread)
 {
-	return RB_MIN(timed_pollers_tree, &thread->timed_pollers);
+	return timer_wheel_first_from(&thread->timed_pollers, TIMER_WHEEL_EXPIRED);
 }
 
 struct spdk_poller *
 spdk_thread_get_next_timed_poller(struct spdk_poller *prev)
 {
-	return RB_NEXT(timed_pollers_tree, &thread->timed_pollers, prev);
+	struct spdk_poller *poller;
+
+	poller = TAILQ_NEXT(prev, tailq);
+	if (poller != NULL || prev->timer_slot == TIMER_WHEEL_NUM_SLOTS - 1) {
+		return poller;
+	}
+
+	return timer_wheel_first_from(&prev->thread->timed_pollers,
+				      prev->timer_slot == TIMER_WHEEL_EXPIRED ? 0 : prev->timer_slot + 1);
 }
 
 struct spdk_poller *
@@ -2078,6 +2325,7 @@ spdk_thread_set_interrupt_mode(bool enable_interrupt)
 {
 	struct spdk_thread *thread = _get_thread();
 	struct spdk_poller *poller, *tmp;
+	struct timer_list timed_pollers = TAILQ_HEAD_INITIALIZER(timed_pollers);
 
 	assert(thread);
 	assert(spdk_interrupt_mode_is_enabled());
@@ -2090,8 +2338,17 @@ spdk_thread_set_interrupt_mode(bool enable_interrupt)
 		return;
 	}
 
-	/* Set pollers to expected mode */
-	RB_FOREACH_SAFE(poller, timed_pollers_tree, &thread->timed_pollers, tmp) {
+	/* Set pollers to expected mode.  Switching a timed poller to poll mode moves
+	 * it on the timer wheel, so take all of them off the wheel first to visit
+	 * each of them exactly once.
+	 */
+	while ((poller = timer_wheel_first_from(&thread->timed_pollers, TIMER_WHEEL_EXPIRED)) != NULL) {
+		poller_remove_timer(thread, poller);
+		TAILQ_INSERT_TAIL(&timed_pollers, poller, tailq);
+	}
+	while ((poller = TAILQ_FIRST(&timed_pollers)) != NULL) {
+		TAILQ_REMOVE(&timed_pollers, poller, tailq);
+		timer_wheel_add(&thread->timed_pollers, poller);
 		poller_set_interrupt_mode(poller, enable_interrupt);
 	}
 	TAILQ_FOREACH_SAFE(poller, &thread->active_pollers, tailq, tmp) {
@@ -2783,6 +3040,7 @@ _interrupt_wrapper(void *ctx)
 {
 	struct spdk_interrupt *intr = ctx;
 	struct spdk_thread *orig_thread, *thread;
+	uint64_t start;
 	int rc;
 
 	orig_thread = spdk_get_thread();
@@ -2793,8 +3051,15 @@ _interrupt_wrapper(void *ctx)
 	SPDK_DTRACE_PROBE4(interrupt_fd_process, intr->name, intr->efd,
 			   intr->fn, intr->arg);
 
+	start = spdk_get_ticks();
 	rc = intr->fn(intr->arg);
 
+	/* A thread in interrupt mode is not polled, so account the time spent on
+	 * the event as busy or idle by its result. Time spent waiting for events
+	 * is not accounted to the thread.
+	 */
+	thread_update_stats(thread, spdk_get_ticks(), start, rc);
+
 	SPIN_ASSERT(thread->lock_count == 0, SPIN_ERR_HOLD_DURING_SWITCH);
 
 	spdk_set_thread(orig_thread);
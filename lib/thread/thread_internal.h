@@ -7,6 +7,7 @@
 #include "spdk/assert.h"
 #include "spdk/thread.h"
 #include "spdk/tree.h"
+#include "spdk/queue.h"
 
 /**
  * \brief Represents a per-thread channel for accessing an I/O device.
@@ -36,4 +37,19 @@ struct spdk_io_channel {
 
 SPDK_STATIC_ASSERT(sizeof(struct spdk_io_channel) == SPDK_IO_CHANNEL_STRUCT_SIZE, "incorrect size");
 
+/**
+ * Coroutine bookkeeping embedded in each spdk_thread.  It is owned by coroutine.c and only
+ * touched by thread.c when the thread exits.
+ */
+struct thread_coroutines {
+	/* Number of coroutines created on the thread that haven't returned yet */
+	uint32_t				count;
+	/* Terminated coroutines with a default-sized stack kept for reuse */
+	uint32_t				cache_count;
+	SLIST_HEAD(, spdk_coroutine)		cache;
+};
+
+struct thread_coroutines *thread_get_coroutines(struct spdk_thread *thread);
+void thread_coroutines_fini(struct thread_coroutines *coroutines);
+
 #endif /* SPDK_THREAD_INTERNAL_H_ */
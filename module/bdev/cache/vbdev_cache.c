@@ -0,0 +1,2725 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * Cache virtual bdev. A fast bdev (the cache bdev) caches the data of a slow one (the core
+ * bdev) in fixed size lines.
+ *
+ * The cache is split into shards, core line N belongs to the shard N % num_shards. Each shard
+ * is owned by its own SPDK thread, which is the only one to touch its lines, its metadata and
+ * its base bdev channels, so no locking is needed. I/Os are forwarded to the thread of the
+ * shard of their line (the bdev layer splits them on line boundaries) and completed back on
+ * the thread they were submitted on.
+ *
+ * Layout of the cache bdev:
+ *   - superblock, in the first 4 KiB,
+ *   - metadata of each shard, an array of struct cache_md_entry, one per line,
+ *   - data of the lines of each shard, aligned to the line size.
+ *
+ * Only dirty lines are persisted in the metadata, the clean ones are dropped when the cache
+ * vbdev is created again. A line is marked dirty in the metadata before the write that made
+ * it dirty is completed, and marked clean only once its data has been written to the core
+ * bdev (destaged) by the destage poller of its shard.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "vbdev_cache.h"
+#include "spdk/crc32.h"
+#include "spdk/env.h"
+#include "spdk/json.h"
+#include "spdk/likely.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+#include "spdk_internal/vbdev_md.h"
+
+/* Namespace of the UUIDs generated from the UUID of the base bdev, fixed once and for all: the
+ * cache vbdevs would get another UUID if it changed.
+ */
+#define BDEV_CACHE_NAMESPACE_UUID "bae935d3-e4a5-48a1-98d5-bea646bd940c"
+
+#define CACHE_SB_SIGNATURE		"SPDKCACH"
+#define CACHE_SB_VERSION		1
+/* Space reserved for the superblock at the beginning of the cache bdev */
+#define CACHE_SB_SIZE			0x1000
+
+#define CACHE_LINE_SIZE_KB_DEFAULT	64
+#define CACHE_LINE_SIZE_KB_MAX		1024
+#define CACHE_NUM_SHARDS_MAX		64
+#define CACHE_SEQ_CUTOFF_KB_DEFAULT	1024
+
+/* Number of sequential streams tracked by each I/O channel */
+#define CACHE_SEQ_STREAMS		4
+/* Number of lines that can be filled on read misses at the same time in a shard */
+#define CACHE_FILLS_PER_SHARD		16
+/* Number of lines that can be destaged at the same time in a shard */
+#define CACHE_DESTAGE_QD		8
+/* Maximum number of lines checked when looking for a line to evict or to destage */
+#define CACHE_EVICT_SCAN_MAX		16
+#define CACHE_DESTAGE_SCAN_MAX		64
+/* Destage even if the shard is busy when this percentage of its lines is dirty */
+#define CACHE_DESTAGE_DIRTY_PCT		50
+#define CACHE_DESTAGE_POLL_PERIOD_US	1000
+#define CACHE_STOP_POLL_PERIOD_US	100
+/* Maximum number of lines an unmap is split into */
+#define CACHE_UNMAP_LINES_MAX		64
+
+#define CACHE_LINES_PER_SHARD_MAX	(1u << 31)
+#define CACHE_LINE_NONE			UINT32_MAX
+#define CACHE_MD_ENTRY_DIRTY		(1u << 0)
+
+struct cache_sb {
+	uint8_t			signature[8];
+	uint32_t		version;
+	/* CRC32C of the superblock, computed with this field set to 0 */
+	uint32_t		crc;
+	struct spdk_uuid	core_uuid;
+	uint64_t		core_blockcnt;
+	uint32_t		block_size;
+	uint32_t		line_size;
+	uint32_t		num_shards;
+	uint32_t		lines_per_shard;
+	uint64_t		md_offset_blocks;
+	uint64_t		md_blocks_per_shard;
+	uint64_t		data_offset_blocks;
+};
+SPDK_STATIC_ASSERT(sizeof(struct cache_sb) <= CACHE_SB_SIZE, "superblock too big");
+
+struct cache_md_entry {
+	uint64_t		core_line;
+	uint32_t		flags;
+	uint32_t		reserved;
+};
+SPDK_STATIC_ASSERT(sizeof(struct cache_md_entry) == 16, "incorrect size");
+
+enum cache_line_state {
+	/* Not holding any data, the line is free or being filled */
+	CACHE_LINE_INVALID,
+	CACHE_LINE_CLEAN,
+	CACHE_LINE_DIRTY,
+};
+
+struct cache_line {
+	/* Core line held by this line */
+	uint64_t			core_line;
+	/* Next line in the same hash bucket */
+	uint32_t			hash_next;
+	/* Number of I/Os waiting for the lock of this line */
+	uint16_t			num_waiters;
+	/* Number of shared lock holders */
+	uint16_t			readers;
+	uint8_t				state;
+	/* The line is locked exclusively */
+	bool				writer;
+	/* The metadata entry on the cache bdev may mark this line dirty */
+	bool				md_dirty;
+	bool				destaging;
+	/* Link in the free, clean (LRU order) or dirty list */
+	TAILQ_ENTRY(cache_line)		link;
+};
+
+struct cache_fill {
+	struct cache_shard			*shard;
+	struct cache_line			*line;
+	/* Buffer holding the data of a whole line */
+	void					*buf;
+	struct spdk_bdev_io_wait_entry		bdev_io_wait;
+	TAILQ_ENTRY(cache_fill)			link;
+};
+
+struct cache_destage {
+	struct cache_shard			*shard;
+	struct cache_line			*line;
+	void					*buf;
+	struct spdk_bdev_io_wait_entry		bdev_io_wait;
+	struct vbdev_md_waiter			md_waiter;
+	TAILQ_ENTRY(cache_destage)		link;
+};
+
+struct cache_shard_flush {
+	struct cache_flush			*flush;
+	TAILQ_ENTRY(cache_shard_flush)		link;
+};
+
+struct cache_flush {
+	struct vbdev_cache			*cache;
+	vbdev_cache_flush_cb			cb_fn;
+	void					*cb_arg;
+	struct spdk_thread			*thread;
+	uint32_t				remaining;
+	int					status;
+	struct cache_shard_flush		shards[0];
+};
+
+struct cache_stats {
+	uint64_t	read_hits;
+	uint64_t	read_misses;
+	uint64_t	read_bypasses;
+	uint64_t	write_hits;
+	uint64_t	write_misses;
+	uint64_t	write_bypasses;
+	uint64_t	evictions;
+	uint64_t	destaged_lines;
+	uint64_t	destage_errors;
+};
+
+struct cache_shard {
+	struct vbdev_cache			*cache;
+	uint32_t				idx;
+	struct spdk_thread			*thread;
+	struct spdk_io_channel			*core_ch;
+	struct spdk_io_channel			*cache_ch;
+	struct spdk_poller			*destage_poller;
+	struct spdk_poller			*stop_poller;
+	int					start_status;
+	bool					stopping;
+
+	struct cache_line			*lines;
+	uint32_t				*hash;
+	uint32_t				hash_mask;
+	TAILQ_HEAD(, cache_line)		free_lines;
+	TAILQ_HEAD(, cache_line)		clean_lines;
+	TAILQ_HEAD(, cache_line)		dirty_lines;
+	uint32_t				num_dirty;
+
+	/* Image of the metadata of this shard on the cache bdev */
+	struct cache_md_entry			*md;
+	struct vbdev_md_writer			md_writer;
+
+	/* I/Os waiting for a line lock */
+	TAILQ_HEAD(, cache_bdev_io)		line_waiters;
+	/* Writes of lines that are not cached, sent directly to the core bdev */
+	TAILQ_HEAD(, cache_bdev_io)		bypass_writes;
+
+	void					*bufs;
+	struct cache_fill			fills[CACHE_FILLS_PER_SHARD];
+	TAILQ_HEAD(, cache_fill)		free_fills;
+	uint32_t				num_fills;
+	struct cache_destage			destages[CACHE_DESTAGE_QD];
+	TAILQ_HEAD(, cache_destage)		free_destages;
+	uint32_t				num_destages;
+
+	/* Number of I/Os processed since the last destage poll */
+	uint64_t				io_count;
+	TAILQ_HEAD(, cache_shard_flush)		flushes;
+	struct cache_stats			stats;
+};
+
+struct vbdev_cache {
+	struct spdk_bdev			bdev;
+	struct spdk_bdev			*core_bdev;
+	struct spdk_bdev_desc			*core_desc;
+	struct spdk_bdev			*cache_bdev;
+	struct spdk_bdev_desc			*cache_desc;
+	/* Thread the base bdevs were opened on */
+	struct spdk_thread			*thread;
+	enum vbdev_cache_mode			mode;
+
+	uint32_t				blocklen;
+	uint32_t				line_blocks;
+	uint32_t				line_shift;
+	uint64_t				num_core_lines;
+	uint32_t				seq_cutoff_kb;
+	uint64_t				seq_cutoff_blocks;
+	size_t					buf_align;
+
+	uint32_t				num_shards;
+	uint32_t				lines_per_shard;
+	uint32_t				md_entries_per_block;
+	uint64_t				md_offset_blocks;
+	uint64_t				md_blocks_per_shard;
+	uint64_t				data_offset_blocks;
+	struct cache_shard			*shards;
+
+	struct cache_create_ctx			*create_ctx;
+	uint32_t				shards_pending;
+	void					(*stop_cb)(struct vbdev_cache *cache);
+	bool					core_claimed;
+	bool					cache_claimed;
+	TAILQ_ENTRY(vbdev_cache)		link;
+};
+
+struct cache_seq_stream {
+	uint64_t	next_offset_blocks;
+	uint64_t	num_blocks;
+};
+
+struct cache_io_channel {
+	struct cache_seq_stream			streams[CACHE_SEQ_STREAMS];
+	uint32_t				next_stream;
+};
+
+enum cache_lock {
+	CACHE_LOCK_NONE,
+	CACHE_LOCK_SHARED,
+	CACHE_LOCK_EXCLUSIVE,
+};
+
+struct cache_bdev_io {
+	struct cache_shard			*shard;
+	/* Line being processed, the I/O holds its lock unless lock is CACHE_LOCK_NONE */
+	struct cache_line			*line;
+	/* Line whose lock the I/O is waiting for */
+	struct cache_line			*wait_line;
+	struct cache_fill			*fill;
+	uint64_t				core_line;
+	enum cache_lock				lock;
+	/* The I/O is part of a sequential stream, misses bypass the cache */
+	bool					seq_bypass;
+	bool					bypass_write;
+	uint8_t					num_outstanding;
+	enum spdk_bdev_io_status		status;
+	void (*retry_fn)(struct cache_bdev_io *io);
+	struct spdk_bdev_io_wait_entry		bdev_io_wait;
+	struct vbdev_md_waiter			md_waiter;
+	/* Link in the line_waiters or the bypass_writes list of the shard */
+	TAILQ_ENTRY(cache_bdev_io)		link;
+};
+
+struct cache_create_ctx {
+	struct vbdev_cache			*cache;
+	vbdev_cache_create_cb			cb_fn;
+	void					*cb_arg;
+	struct spdk_io_channel			*ch;
+	struct cache_sb				*sb;
+	uint32_t				line_size;
+	uint32_t				num_shards;
+	/* The metadata is loaded from the cache bdev instead of initialized */
+	bool					load;
+	uint32_t				shard_idx;
+	int					status;
+};
+
+static int vbdev_cache_init(void);
+static int vbdev_cache_get_ctx_size(void);
+static int vbdev_cache_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module cache_if = {
+	.name = "cache",
+	.module_init = vbdev_cache_init,
+	.get_ctx_size = vbdev_cache_get_ctx_size,
+	.config_json = vbdev_cache_config_json,
+};
+
+SPDK_BDEV_MODULE_REGISTER(cache, &cache_if)
+
+static TAILQ_HEAD(, vbdev_cache) g_cache_nodes = TAILQ_HEAD_INITIALIZER(g_cache_nodes);
+
+static void cache_io_process(struct cache_bdev_io *io);
+static void cache_shard_destage(struct cache_shard *shard);
+static bool cache_shard_destage_urgent(struct cache_shard *shard);
+
+static inline uint32_t
+cache_line_idx(struct cache_shard *shard, struct cache_line *line)
+{
+	return line - shard->lines;
+}
+
+static inline uint64_t
+cache_shard_md_offset(struct cache_shard *shard)
+{
+	return shard->cache->md_offset_blocks + shard->idx * shard->cache->md_blocks_per_shard;
+}
+
+static inline uint64_t
+cache_line_data_offset(struct cache_shard *shard, struct cache_line *line)
+{
+	struct vbdev_cache *cache = shard->cache;
+
+	return cache->data_offset_blocks +
+	       ((uint64_t)shard->idx * cache->lines_per_shard + cache_line_idx(shard, line)) *
+	       cache->line_blocks;
+}
+
+static inline uint32_t
+cache_shard_hash(struct cache_shard *shard, uint64_t core_line)
+{
+	return (core_line / shard->cache->num_shards) & shard->hash_mask;
+}
+
+static struct cache_line *
+cache_shard_lookup(struct cache_shard *shard, uint64_t core_line)
+{
+	struct cache_line *line;
+	uint32_t idx = shard->hash[cache_shard_hash(shard, core_line)];
+
+	while (idx != CACHE_LINE_NONE) {
+		line = &shard->lines[idx];
+		if (line->core_line == core_line) {
+			return line;
+		}
+		idx = line->hash_next;
+	}
+
+	return NULL;
+}
+
+static void
+cache_shard_hash_insert(struct cache_shard *shard, struct cache_line *line)
+{
+	uint32_t *bucket = &shard->hash[cache_shard_hash(shard, line->core_line)];
+
+	line->hash_next = *bucket;
+	*bucket = cache_line_idx(shard, line);
+}
+
+static void
+cache_shard_hash_remove(struct cache_shard *shard, struct cache_line *line)
+{
+	uint32_t *idx = &shard->hash[cache_shard_hash(shard, line->core_line)];
+	uint32_t line_idx = cache_line_idx(shard, line);
+
+	while (*idx != line_idx) {
+		assert(*idx != CACHE_LINE_NONE);
+		idx = &shard->lines[*idx].hash_next;
+	}
+	*idx = line->hash_next;
+	line->hash_next = CACHE_LINE_NONE;
+}
+
+/* Get a line for core_line, evicting a clean one if there are no free lines. The line is
+ * returned locked exclusively, in the invalid state.
+ */
+static struct cache_line *
+cache_shard_alloc_line(struct cache_shard *shard, uint64_t core_line)
+{
+	struct cache_line *line;
+	int scanned = 0;
+
+	line = TAILQ_FIRST(&shard->free_lines);
+	if (line != NULL) {
+		TAILQ_REMOVE(&shard->free_lines, line, link);
+	} else {
+		TAILQ_FOREACH(line, &shard->clean_lines, link) {
+			if (scanned++ == CACHE_EVICT_SCAN_MAX) {
+				return NULL;
+			}
+			if (!line->writer && line->readers == 0 && line->num_waiters == 0 &&
+			    !line->md_dirty) {
+				break;
+			}
+		}
+		if (line == NULL) {
+			return NULL;
+		}
+		TAILQ_REMOVE(&shard->clean_lines, line, link);
+		cache_shard_hash_remove(shard, line);
+		shard->stats.evictions++;
+	}
+
+	line->core_line = core_line;
+	line->state = CACHE_LINE_INVALID;
+	line->writer = true;
+	cache_shard_hash_insert(shard, line);
+
+	return line;
+}
+
+static void
+cache_line_touch(struct cache_shard *shard, struct cache_line *line)
+{
+	if (line->state == CACHE_LINE_CLEAN) {
+		TAILQ_REMOVE(&shard->clean_lines, line, link);
+		TAILQ_INSERT_TAIL(&shard->clean_lines, line, link);
+	}
+}
+
+static void
+cache_line_set_dirty(struct cache_shard *shard, struct cache_line *line)
+{
+	struct cache_md_entry *entry = &shard->md[cache_line_idx(shard, line)];
+
+	assert(line->state != CACHE_LINE_DIRTY);
+	if (line->state == CACHE_LINE_CLEAN) {
+		TAILQ_REMOVE(&shard->clean_lines, line, link);
+	}
+	line->state = CACHE_LINE_DIRTY;
+	line->md_dirty = true;
+	TAILQ_INSERT_TAIL(&shard->dirty_lines, line, link);
+	shard->num_dirty++;
+
+	entry->core_line = line->core_line;
+	entry->flags = CACHE_MD_ENTRY_DIRTY;
+}
+
+static void
+cache_line_set_clean(struct cache_shard *shard, struct cache_line *line)
+{
+	assert(line->state == CACHE_LINE_DIRTY);
+	TAILQ_REMOVE(&shard->dirty_lines, line, link);
+	shard->num_dirty--;
+	line->state = CACHE_LINE_CLEAN;
+	TAILQ_INSERT_TAIL(&shard->clean_lines, line, link);
+
+	shard->md[cache_line_idx(shard, line)].flags = 0;
+}
+
+/* Drop the data of a locked line. It stays in the hash, so that nobody can cache its core line
+ * in another line before its metadata entry is cleared, until cache_line_free() is called.
+ */
+static void
+cache_line_invalidate(struct cache_shard *shard, struct cache_line *line)
+{
+	switch (line->state) {
+	case CACHE_LINE_CLEAN:
+		TAILQ_REMOVE(&shard->clean_lines, line, link);
+		break;
+	case CACHE_LINE_DIRTY:
+		TAILQ_REMOVE(&shard->dirty_lines, line, link);
+		shard->num_dirty--;
+		break;
+	default:
+		break;
+	}
+	line->state = CACHE_LINE_INVALID;
+
+	shard->md[cache_line_idx(shard, line)].flags = 0;
+}
+
+static void
+cache_line_free(struct cache_shard *shard, struct cache_line *line)
+{
+	assert(line->state == CACHE_LINE_INVALID);
+	cache_shard_hash_remove(shard, line);
+	TAILQ_INSERT_TAIL(&shard->free_lines, line, link);
+}
+
+static bool
+cache_line_lock(struct cache_shard *shard, struct cache_line *line, struct cache_bdev_io *io,
+		bool exclusive)
+{
+	/* Queue behind the waiters so that writers are not starved by readers */
+	if (line->num_waiters == 0 && !line->writer && (!exclusive || line->readers == 0)) {
+		if (exclusive) {
+			line->writer = true;
+			io->lock = CACHE_LOCK_EXCLUSIVE;
+		} else {
+			line->readers++;
+			io->lock = CACHE_LOCK_SHARED;
+		}
+		io->line = line;
+		return true;
+	}
+
+	line->num_waiters++;
+	io->wait_line = line;
+	TAILQ_INSERT_TAIL(&shard->line_waiters, io, link);
+	return false;
+}
+
+static void
+cache_line_unlock(struct cache_shard *shard, struct cache_line *line, bool exclusive)
+{
+	TAILQ_HEAD(, cache_bdev_io) waiters = TAILQ_HEAD_INITIALIZER(waiters);
+	struct cache_bdev_io *io, *tmp;
+
+	if (exclusive) {
+		assert(line->writer);
+		line->writer = false;
+	} else {
+		assert(line->readers > 0);
+		line->readers--;
+	}
+
+	if (line->num_waiters == 0 || line->readers > 0) {
+		return;
+	}
+
+	/* Restart the waiters in order, the line may not hold the same data anymore */
+	TAILQ_FOREACH_SAFE(io, &shard->line_waiters, link, tmp) {
+		if (io->wait_line == line) {
+			TAILQ_REMOVE(&shard->line_waiters, io, link);
+			TAILQ_INSERT_TAIL(&waiters, io, link);
+		}
+	}
+	line->num_waiters = 0;
+
+	while ((io = TAILQ_FIRST(&waiters))) {
+		TAILQ_REMOVE(&waiters, io, link);
+		io->wait_line = NULL;
+		cache_io_process(io);
+	}
+}
+
+/* Write the metadata block holding the entry of a line, after the entry has been updated */
+static void
+cache_md_persist(struct cache_shard *shard, struct cache_line *line, struct vbdev_md_waiter *waiter,
+		 void (*cb_fn)(struct vbdev_md_waiter *waiter, int status))
+{
+	vbdev_md_persist(&shard->md_writer,
+			 cache_line_idx(shard, line) / shard->cache->md_entries_per_block,
+			 waiter, cb_fn, NULL);
+}
+
+static void
+_cache_io_complete(void *ctx)
+{
+	struct cache_bdev_io *io = ctx;
+
+	spdk_bdev_io_complete(spdk_bdev_io_from_ctx(io), io->status);
+}
+
+static void
+cache_io_unlock(struct cache_bdev_io *io)
+{
+	struct cache_line *line = io->line;
+	enum cache_lock lock = io->lock;
+
+	io->line = NULL;
+	io->lock = CACHE_LOCK_NONE;
+	if (lock != CACHE_LOCK_NONE) {
+		cache_line_unlock(io->shard, line, lock == CACHE_LOCK_EXCLUSIVE);
+	}
+}
+
+static void cache_fill_done(struct cache_fill *fill, bool success);
+
+/* Release everything held by the I/O and complete it on the thread it was submitted on */
+static void
+cache_io_finish(struct cache_bdev_io *io, enum spdk_bdev_io_status status)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct spdk_thread *thread = spdk_bdev_io_get_thread(bdev_io);
+
+	if (io->bypass_write) {
+		TAILQ_REMOVE(&io->shard->bypass_writes, io, link);
+		io->bypass_write = false;
+	}
+	if (io->fill != NULL) {
+		/* The fill owns the line lock from now on */
+		io->line = NULL;
+		io->lock = CACHE_LOCK_NONE;
+		cache_fill_done(io->fill, false);
+		io->fill = NULL;
+	}
+	cache_io_unlock(io);
+
+	io->status = status;
+	if (thread == spdk_get_thread()) {
+		spdk_bdev_io_complete(bdev_io, status);
+	} else {
+		spdk_thread_send_msg(thread, _cache_io_complete, io);
+	}
+}
+
+static void
+_cache_io_retry(void *arg)
+{
+	struct cache_bdev_io *io = arg;
+
+	io->retry_fn(io);
+}
+
+/* Handle the return code of the submission of a base I/O */
+static void
+cache_io_submitted(struct cache_bdev_io *io, int rc, struct spdk_bdev *bdev,
+		   struct spdk_io_channel *ch, void (*retry_fn)(struct cache_bdev_io *io))
+{
+	if (spdk_likely(rc == 0)) {
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		io->retry_fn = retry_fn;
+		io->bdev_io_wait.bdev = bdev;
+		io->bdev_io_wait.cb_fn = _cache_io_retry;
+		io->bdev_io_wait.cb_arg = io;
+		rc = spdk_bdev_queue_io_wait(bdev, ch, &io->bdev_io_wait);
+		if (rc == 0) {
+			return;
+		}
+	}
+
+	SPDK_ERRLOG("Failed to submit an I/O to %s: %s\n", spdk_bdev_get_name(bdev),
+		    spdk_strerror(-rc));
+	cache_io_finish(io, SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+cache_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_bdev_io *io = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	cache_io_finish(io, success ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static inline uint64_t
+cache_io_offset_in_line(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+
+	return bdev_io->u.bdev.offset_blocks & (io->shard->cache->line_blocks - 1);
+}
+
+static void
+cache_read_core(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct cache_shard *shard = io->shard;
+	struct vbdev_cache *cache = shard->cache;
+	int rc;
+
+	rc = spdk_bdev_readv_blocks(cache->core_desc, shard->core_ch, bdev_io->u.bdev.iovs,
+				    bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+				    bdev_io->u.bdev.num_blocks, cache_io_done, io);
+	cache_io_submitted(io, rc, cache->core_bdev, shard->core_ch, cache_read_core);
+}
+
+static void
+cache_read_cache(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct cache_shard *shard = io->shard;
+	struct vbdev_cache *cache = shard->cache;
+	uint64_t offset_blocks;
+	int rc;
+
+	offset_blocks = cache_line_data_offset(shard, io->line) + cache_io_offset_in_line(io);
+	rc = spdk_bdev_readv_blocks(cache->cache_desc, shard->cache_ch, bdev_io->u.bdev.iovs,
+				    bdev_io->u.bdev.iovcnt, offset_blocks,
+				    bdev_io->u.bdev.num_blocks, cache_io_done, io);
+	cache_io_submitted(io, rc, cache->cache_bdev, shard->cache_ch, cache_read_cache);
+}
+
+static void
+cache_fill_done(struct cache_fill *fill, bool success)
+{
+	struct cache_shard *shard = fill->shard;
+	struct cache_line *line = fill->line;
+
+	if (success) {
+		line->state = CACHE_LINE_CLEAN;
+		TAILQ_INSERT_TAIL(&shard->clean_lines, line, link);
+	} else {
+		cache_line_invalidate(shard, line);
+		cache_line_free(shard, line);
+	}
+
+	fill->line = NULL;
+	TAILQ_INSERT_TAIL(&shard->free_fills, fill, link);
+	shard->num_fills--;
+
+	cache_line_unlock(shard, line, true);
+}
+
+static void
+cache_fill_write_cache_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_fill *fill = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	cache_fill_done(fill, success);
+}
+
+static void
+cache_fill_write_cache(void *arg)
+{
+	struct cache_fill *fill = arg;
+	struct cache_shard *shard = fill->shard;
+	struct vbdev_cache *cache = shard->cache;
+	int rc;
+
+	rc = spdk_bdev_write_blocks(cache->cache_desc, shard->cache_ch, fill->buf,
+				    cache_line_data_offset(shard, fill->line), cache->line_blocks,
+				    cache_fill_write_cache_done, fill);
+	if (rc == -ENOMEM) {
+		fill->bdev_io_wait.bdev = cache->cache_bdev;
+		fill->bdev_io_wait.cb_fn = cache_fill_write_cache;
+		fill->bdev_io_wait.cb_arg = fill;
+		rc = spdk_bdev_queue_io_wait(cache->cache_bdev, shard->cache_ch,
+					     &fill->bdev_io_wait);
+	}
+	if (rc != 0) {
+		cache_fill_done(fill, false);
+	}
+}
+
+static void
+cache_fill_read_core_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_bdev_io *io = cb_arg;
+	struct spdk_bdev_io *orig_io = spdk_bdev_io_from_ctx(io);
+	struct cache_fill *fill = io->fill;
+	struct vbdev_cache *cache = io->shard->cache;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		cache_io_finish(io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	spdk_copy_buf_to_iovs(orig_io->u.bdev.iovs, orig_io->u.bdev.iovcnt,
+			      (char *)fill->buf + cache_io_offset_in_line(io) * cache->blocklen,
+			      orig_io->u.bdev.num_blocks * cache->blocklen);
+
+	/* Complete the read right away and write the line to the cache in the background */
+	io->fill = NULL;
+	io->line = NULL;
+	io->lock = CACHE_LOCK_NONE;
+	cache_io_finish(io, SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	cache_fill_write_cache(fill);
+}
+
+static void
+cache_fill_read_core(struct cache_bdev_io *io)
+{
+	struct cache_shard *shard = io->shard;
+	struct vbdev_cache *cache = shard->cache;
+	int rc;
+
+	rc = spdk_bdev_read_blocks(cache->core_desc, shard->core_ch, io->fill->buf,
+				   io->core_line << cache->line_shift, cache->line_blocks,
+				   cache_fill_read_core_done, io);
+	cache_io_submitted(io, rc, cache->core_bdev, shard->core_ch, cache_fill_read_core);
+}
+
+static bool
+cache_shard_bypass_write_pending(struct cache_shard *shard, uint64_t core_line)
+{
+	struct cache_bdev_io *io;
+
+	TAILQ_FOREACH(io, &shard->bypass_writes, link) {
+		if (io->core_line == core_line) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+cache_process_read(struct cache_bdev_io *io)
+{
+	struct cache_shard *shard = io->shard;
+	struct cache_line *line;
+	struct cache_fill *fill;
+
+	line = cache_shard_lookup(shard, io->core_line);
+	if (line != NULL) {
+		if (!cache_line_lock(shard, line, io, false)) {
+			return;
+		}
+		assert(line->state != CACHE_LINE_INVALID);
+		shard->stats.read_hits++;
+		cache_line_touch(shard, line);
+		cache_read_cache(io);
+		return;
+	}
+
+	/* A fill must not read the core line while a write to it is in progress */
+	fill = TAILQ_FIRST(&shard->free_fills);
+	if (io->seq_bypass || fill == NULL || io->core_line >= shard->cache->num_core_lines ||
+	    cache_shard_bypass_write_pending(shard, io->core_line)) {
+		shard->stats.read_bypasses++;
+		cache_read_core(io);
+		return;
+	}
+
+	line = cache_shard_alloc_line(shard, io->core_line);
+	if (line == NULL) {
+		shard->stats.read_bypasses++;
+		cache_read_core(io);
+		return;
+	}
+
+	TAILQ_REMOVE(&shard->free_fills, fill, link);
+	shard->num_fills++;
+	fill->line = line;
+	io->fill = fill;
+	io->line = line;
+	io->lock = CACHE_LOCK_EXCLUSIVE;
+	shard->stats.read_misses++;
+
+	cache_fill_read_core(io);
+}
+
+static void
+cache_write_md_done(struct vbdev_md_waiter *waiter, int status)
+{
+	struct cache_bdev_io *io = SPDK_CONTAINEROF(waiter, struct cache_bdev_io, md_waiter);
+
+	cache_io_finish(io, status == 0 ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+cache_write_cache_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_bdev_io *io = cb_arg;
+	struct cache_shard *shard = io->shard;
+	struct cache_line *line = io->line;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		/* The data of the line is unknown now. A dirty one can't be dropped, it is the
+		 * only copy of its other blocks.
+		 */
+		if (line->state != CACHE_LINE_DIRTY) {
+			assert(!line->md_dirty);
+			cache_line_invalidate(shard, line);
+			cache_line_free(shard, line);
+		}
+		cache_io_finish(io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (shard->cache->mode == VBDEV_CACHE_MODE_WT || line->state == CACHE_LINE_DIRTY) {
+		cache_io_finish(io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	cache_line_set_dirty(shard, line);
+	cache_md_persist(shard, line, &io->md_waiter, cache_write_md_done);
+}
+
+static void
+cache_write_cache(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct cache_shard *shard = io->shard;
+	struct vbdev_cache *cache = shard->cache;
+	uint64_t offset_blocks;
+	int rc;
+
+	offset_blocks = cache_line_data_offset(shard, io->line) + cache_io_offset_in_line(io);
+	rc = spdk_bdev_writev_blocks(cache->cache_desc, shard->cache_ch, bdev_io->u.bdev.iovs,
+				     bdev_io->u.bdev.iovcnt, offset_blocks,
+				     bdev_io->u.bdev.num_blocks, cache_write_cache_done, io);
+	cache_io_submitted(io, rc, cache->cache_bdev, shard->cache_ch, cache_write_cache);
+}
+
+static void
+cache_write_core_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_bdev_io *io = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		cache_io_finish(io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (io->line == NULL) {
+		cache_io_finish(io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	/* Write-through of a cached line */
+	cache_write_cache(io);
+}
+
+static void
+cache_write_core(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct cache_shard *shard = io->shard;
+	struct vbdev_cache *cache = shard->cache;
+	int rc;
+
+	rc = spdk_bdev_writev_blocks(cache->core_desc, shard->core_ch, bdev_io->u.bdev.iovs,
+				     bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+				     bdev_io->u.bdev.num_blocks, cache_write_core_done, io);
+	cache_io_submitted(io, rc, cache->core_bdev, shard->core_ch, cache_write_core);
+}
+
+static void
+cache_process_write(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct cache_shard *shard = io->shard;
+	struct vbdev_cache *cache = shard->cache;
+	struct cache_line *line;
+
+	line = cache_shard_lookup(shard, io->core_line);
+	if (line != NULL) {
+		if (!cache_line_lock(shard, line, io, true)) {
+			return;
+		}
+		assert(line->state != CACHE_LINE_INVALID);
+		shard->stats.write_hits++;
+		if (cache->mode == VBDEV_CACHE_MODE_WT) {
+			cache_write_core(io);
+		} else {
+			cache_line_touch(shard, line);
+			cache_write_cache(io);
+		}
+		return;
+	}
+
+	/* Lines are either fully valid or invalid, so only full line writes can allocate one */
+	if (cache->mode == VBDEV_CACHE_MODE_WB && !io->seq_bypass &&
+	    bdev_io->u.bdev.num_blocks == cache->line_blocks &&
+	    io->core_line < cache->num_core_lines) {
+		line = cache_shard_alloc_line(shard, io->core_line);
+		if (line != NULL) {
+			io->line = line;
+			io->lock = CACHE_LOCK_EXCLUSIVE;
+			shard->stats.write_misses++;
+			cache_write_cache(io);
+			return;
+		}
+	}
+
+	shard->stats.write_bypasses++;
+	io->bypass_write = true;
+	TAILQ_INSERT_TAIL(&shard->bypass_writes, io, link);
+	cache_write_core(io);
+}
+
+static void
+cache_unmap_core(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct cache_shard *shard = io->shard;
+	struct vbdev_cache *cache = shard->cache;
+	int rc;
+
+	rc = spdk_bdev_unmap_blocks(cache->core_desc, shard->core_ch, bdev_io->u.bdev.offset_blocks,
+				    bdev_io->u.bdev.num_blocks, cache_io_done, io);
+	cache_io_submitted(io, rc, cache->core_bdev, shard->core_ch, cache_unmap_core);
+}
+
+static void cache_io_submit_to_shard(struct vbdev_cache *cache, struct cache_bdev_io *io);
+
+/* Move on to the next line of the unmap, the core bdev is unmapped after all of them */
+static void
+cache_unmap_next(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct vbdev_cache *cache = io->shard->cache;
+	uint64_t end_blocks = bdev_io->u.bdev.offset_blocks + bdev_io->u.bdev.num_blocks;
+	uint64_t last_line = (end_blocks - 1) >> cache->line_shift;
+
+	cache_io_unlock(io);
+
+	if (io->core_line < last_line) {
+		io->core_line++;
+		cache_io_submit_to_shard(cache, io);
+		return;
+	}
+
+	cache_unmap_core(io);
+}
+
+static void
+cache_unmap_md_done(struct vbdev_md_waiter *waiter, int status)
+{
+	struct cache_bdev_io *io = SPDK_CONTAINEROF(waiter, struct cache_bdev_io, md_waiter);
+	struct cache_line *line = io->line;
+
+	if (status != 0) {
+		/* The entry may still mark the line dirty, so the line can't be reused */
+		cache_shard_hash_remove(io->shard, line);
+		cache_io_finish(io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	line->md_dirty = false;
+	cache_line_free(io->shard, line);
+	cache_unmap_next(io);
+}
+
+static void
+cache_unmap_zeroes_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_bdev_io *io = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		cache_io_finish(io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	cache_unmap_next(io);
+}
+
+static void
+cache_unmap_zeroes(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct cache_shard *shard = io->shard;
+	struct vbdev_cache *cache = shard->cache;
+	uint64_t line_start = io->core_line << cache->line_shift;
+	uint64_t start, end;
+	int rc;
+
+	start = spdk_max(bdev_io->u.bdev.offset_blocks, line_start);
+	end = spdk_min(bdev_io->u.bdev.offset_blocks + bdev_io->u.bdev.num_blocks,
+		       line_start + cache->line_blocks);
+
+	start = cache_line_data_offset(shard, io->line) + start - line_start;
+	rc = spdk_bdev_write_zeroes_blocks(cache->cache_desc, shard->cache_ch, start, end - start,
+					   cache_unmap_zeroes_done, io);
+	cache_io_submitted(io, rc, cache->cache_bdev, shard->cache_ch, cache_unmap_zeroes);
+}
+
+static void
+cache_process_unmap(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct cache_shard *shard = io->shard;
+	struct vbdev_cache *cache = shard->cache;
+	uint64_t line_start = io->core_line << cache->line_shift;
+	uint64_t end_blocks = bdev_io->u.bdev.offset_blocks + bdev_io->u.bdev.num_blocks;
+	struct cache_line *line;
+	bool partial;
+
+	line = cache_shard_lookup(shard, io->core_line);
+	if (line == NULL) {
+		cache_unmap_next(io);
+		return;
+	}
+	if (!cache_line_lock(shard, line, io, true)) {
+		return;
+	}
+
+	partial = bdev_io->u.bdev.offset_blocks > line_start ||
+		  end_blocks < line_start + cache->line_blocks;
+	if (partial && line->state == CACHE_LINE_DIRTY) {
+		/* The rest of the line still has to be destaged */
+		cache_unmap_zeroes(io);
+		return;
+	}
+
+	cache_line_invalidate(shard, line);
+	if (line->md_dirty) {
+		cache_md_persist(shard, line, &io->md_waiter, cache_unmap_md_done);
+		return;
+	}
+
+	cache_line_free(shard, line);
+	cache_unmap_next(io);
+}
+
+static void
+cache_flush_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_bdev_io *io = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		io->status = SPDK_BDEV_IO_STATUS_FAILED;
+	}
+
+	assert(io->num_outstanding > 0);
+	if (--io->num_outstanding == 0) {
+		cache_io_finish(io, io->status);
+	}
+}
+
+/* The written data is on the cache bdev, with the metadata of the dirty lines, or on the core
+ * bdev, so flushing both of them is enough to make it durable.
+ */
+static void
+cache_process_flush(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct cache_shard *shard = io->shard;
+	struct vbdev_cache *cache = shard->cache;
+	int rc;
+
+	io->num_outstanding = 1;
+
+	if (spdk_bdev_io_type_supported(cache->core_bdev, SPDK_BDEV_IO_TYPE_FLUSH)) {
+		rc = spdk_bdev_flush_blocks(cache->core_desc, shard->core_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks, cache_flush_done, io);
+		if (rc == 0) {
+			io->num_outstanding++;
+		} else {
+			io->status = rc == -ENOMEM ? SPDK_BDEV_IO_STATUS_NOMEM :
+				     SPDK_BDEV_IO_STATUS_FAILED;
+		}
+	}
+
+	if (spdk_bdev_io_type_supported(cache->cache_bdev, SPDK_BDEV_IO_TYPE_FLUSH) &&
+	    io->status == SPDK_BDEV_IO_STATUS_SUCCESS) {
+		rc = spdk_bdev_flush_blocks(cache->cache_desc, shard->cache_ch, 0,
+					    spdk_bdev_get_num_blocks(cache->cache_bdev),
+					    cache_flush_done, io);
+		if (rc == 0) {
+			io->num_outstanding++;
+		} else {
+			io->status = rc == -ENOMEM ? SPDK_BDEV_IO_STATUS_NOMEM :
+				     SPDK_BDEV_IO_STATUS_FAILED;
+		}
+	}
+
+	if (--io->num_outstanding == 0) {
+		cache_io_finish(io, io->status);
+	}
+}
+
+static void
+cache_process_reset(struct cache_bdev_io *io)
+{
+	struct cache_shard *shard = io->shard;
+	struct vbdev_cache *cache = shard->cache;
+	int rc;
+
+	rc = spdk_bdev_reset(cache->core_desc, shard->core_ch, cache_io_done, io);
+	cache_io_submitted(io, rc, cache->core_bdev, shard->core_ch, cache_process_reset);
+}
+
+static void
+cache_io_process(struct cache_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+
+	io->shard->io_count++;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		cache_process_read(io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		cache_process_write(io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		cache_process_unmap(io);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		cache_process_flush(io);
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		cache_process_reset(io);
+		break;
+	default:
+		assert(false);
+		cache_io_finish(io, SPDK_BDEV_IO_STATUS_FAILED);
+		break;
+	}
+}
+
+static void
+_cache_io_process(void *ctx)
+{
+	cache_io_process(ctx);
+}
+
+static void
+cache_io_submit_to_shard(struct vbdev_cache *cache, struct cache_bdev_io *io)
+{
+	io->shard = &cache->shards[io->core_line % cache->num_shards];
+
+	if (io->shard->thread == spdk_get_thread()) {
+		cache_io_process(io);
+	} else {
+		spdk_thread_send_msg(io->shard->thread, _cache_io_process, io);
+	}
+}
+
+/* Track the sequential streams of the channel, returns true if the I/O is part of one that
+ * reached the cutoff.
+ */
+static bool
+cache_channel_detect_seq(struct vbdev_cache *cache, struct cache_io_channel *cache_ch,
+			 struct spdk_bdev_io *bdev_io)
+{
+	uint64_t offset_blocks = bdev_io->u.bdev.offset_blocks;
+	uint64_t num_blocks = bdev_io->u.bdev.num_blocks;
+	struct cache_seq_stream *stream;
+	int i;
+
+	if (cache->seq_cutoff_blocks == 0) {
+		return false;
+	}
+
+	for (i = 0; i < CACHE_SEQ_STREAMS; i++) {
+		stream = &cache_ch->streams[i];
+		if (stream->next_offset_blocks == offset_blocks) {
+			stream->next_offset_blocks += num_blocks;
+			stream->num_blocks += num_blocks;
+			return stream->num_blocks >= cache->seq_cutoff_blocks;
+		}
+	}
+
+	/* Replace the oldest stream */
+	stream = &cache_ch->streams[cache_ch->next_stream];
+	cache_ch->next_stream = (cache_ch->next_stream + 1) % CACHE_SEQ_STREAMS;
+	stream->next_offset_blocks = offset_blocks + num_blocks;
+	stream->num_blocks = num_blocks;
+
+	return num_blocks >= cache->seq_cutoff_blocks;
+}
+
+static void
+cache_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	struct vbdev_cache *cache = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_cache, bdev);
+
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	cache_io_submit_to_shard(cache, (struct cache_bdev_io *)bdev_io->driver_ctx);
+}
+
+static void
+vbdev_cache_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_cache *cache = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_cache, bdev);
+	struct cache_io_channel *cache_ch = spdk_io_channel_get_ctx(ch);
+	struct cache_bdev_io *io = (struct cache_bdev_io *)bdev_io->driver_ctx;
+
+	memset(io, 0, offsetof(struct cache_bdev_io, bdev_io_wait));
+	io->status = SPDK_BDEV_IO_STATUS_SUCCESS;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		io->core_line = bdev_io->u.bdev.offset_blocks >> cache->line_shift;
+		io->seq_bypass = cache_channel_detect_seq(cache, cache_ch, bdev_io);
+		spdk_bdev_io_get_buf(bdev_io, cache_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		return;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		io->core_line = bdev_io->u.bdev.offset_blocks >> cache->line_shift;
+		io->seq_bypass = cache_channel_detect_seq(cache, cache_ch, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		io->core_line = bdev_io->u.bdev.offset_blocks >> cache->line_shift;
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		io->core_line = 0;
+		break;
+	default:
+		SPDK_ERRLOG("cache: unknown I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	cache_io_submit_to_shard(cache, io);
+}
+
+static bool
+vbdev_cache_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_cache *cache = ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		return true;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_RESET:
+		return spdk_bdev_io_type_supported(cache->core_bdev, io_type);
+	default:
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_cache_get_io_channel(void *ctx)
+{
+	return spdk_get_io_channel(ctx);
+}
+
+static int
+cache_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct cache_io_channel *cache_ch = ctx_buf;
+	int i;
+
+	for (i = 0; i < CACHE_SEQ_STREAMS; i++) {
+		cache_ch->streams[i].next_offset_blocks = UINT64_MAX;
+	}
+
+	return 0;
+}
+
+static void
+cache_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+static void
+cache_flush_shard_done(void *ctx)
+{
+	struct cache_shard_flush *shard_flush = ctx;
+	struct cache_flush *flush = shard_flush->flush;
+
+	assert(flush->remaining > 0);
+	if (--flush->remaining == 0) {
+		flush->cb_fn(flush->cb_arg, flush->status);
+		free(flush);
+	}
+}
+
+static void
+cache_shard_complete_flushes(struct cache_shard *shard, int status)
+{
+	struct cache_shard_flush *shard_flush;
+
+	while ((shard_flush = TAILQ_FIRST(&shard->flushes))) {
+		TAILQ_REMOVE(&shard->flushes, shard_flush, link);
+		if (status != 0) {
+			shard_flush->flush->status = status;
+		}
+		spdk_thread_send_msg(shard_flush->flush->thread, cache_flush_shard_done,
+				     shard_flush);
+	}
+}
+
+static void
+cache_shard_check_flushed(struct cache_shard *shard)
+{
+	if (shard->num_dirty == 0 && shard->num_destages == 0) {
+		cache_shard_complete_flushes(shard, 0);
+	}
+}
+
+static void
+cache_destage_done(struct cache_destage *destage, bool success)
+{
+	struct cache_shard *shard = destage->shard;
+	struct cache_line *line = destage->line;
+
+	line->destaging = false;
+	destage->line = NULL;
+	TAILQ_INSERT_TAIL(&shard->free_destages, destage, link);
+	shard->num_destages--;
+
+	if (success) {
+		shard->stats.destaged_lines++;
+	} else {
+		shard->stats.destage_errors++;
+		/* Let the other lines go first */
+		if (line->state == CACHE_LINE_DIRTY) {
+			TAILQ_REMOVE(&shard->dirty_lines, line, link);
+			TAILQ_INSERT_TAIL(&shard->dirty_lines, line, link);
+		}
+		cache_shard_complete_flushes(shard, -EIO);
+	}
+
+	cache_line_unlock(shard, line, false);
+
+	/* Otherwise the poller starts the next ones when the shard is idle */
+	if (cache_shard_destage_urgent(shard)) {
+		cache_shard_destage(shard);
+	}
+	cache_shard_check_flushed(shard);
+}
+
+static void
+cache_destage_md_done(struct vbdev_md_waiter *waiter, int status)
+{
+	struct cache_destage *destage = SPDK_CONTAINEROF(waiter, struct cache_destage, md_waiter);
+
+	/* The line is still locked, so it can't have been dirtied again */
+	if (status == 0) {
+		assert(destage->line->state == CACHE_LINE_CLEAN);
+		destage->line->md_dirty = false;
+	}
+
+	cache_destage_done(destage, status == 0);
+}
+
+static void
+cache_destage_write_core_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_destage *destage = cb_arg;
+	struct cache_shard *shard = destage->shard;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_DEBUGLOG(vbdev_cache, "Failed to destage core line %" PRIu64 " of %s\n",
+			      destage->line->core_line, shard->cache->bdev.name);
+		cache_destage_done(destage, false);
+		return;
+	}
+
+	cache_line_set_clean(shard, destage->line);
+	cache_md_persist(shard, destage->line, &destage->md_waiter, cache_destage_md_done);
+}
+
+static void
+cache_destage_write_core(void *arg)
+{
+	struct cache_destage *destage = arg;
+	struct cache_shard *shard = destage->shard;
+	struct vbdev_cache *cache = shard->cache;
+	int rc;
+
+	rc = spdk_bdev_write_blocks(cache->core_desc, shard->core_ch, destage->buf,
+				    destage->line->core_line << cache->line_shift,
+				    cache->line_blocks, cache_destage_write_core_done, destage);
+	if (rc == -ENOMEM) {
+		destage->bdev_io_wait.bdev = cache->core_bdev;
+		destage->bdev_io_wait.cb_fn = cache_destage_write_core;
+		destage->bdev_io_wait.cb_arg = destage;
+		rc = spdk_bdev_queue_io_wait(cache->core_bdev, shard->core_ch,
+					     &destage->bdev_io_wait);
+	}
+	if (rc != 0) {
+		cache_destage_done(destage, false);
+	}
+}
+
+static void
+cache_destage_read_cache_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_destage *destage = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		cache_destage_done(destage, false);
+		return;
+	}
+
+	cache_destage_write_core(destage);
+}
+
+static void
+cache_destage_read_cache(void *arg)
+{
+	struct cache_destage *destage = arg;
+	struct cache_shard *shard = destage->shard;
+	struct vbdev_cache *cache = shard->cache;
+	int rc;
+
+	rc = spdk_bdev_read_blocks(cache->cache_desc, shard->cache_ch, destage->buf,
+				   cache_line_data_offset(shard, destage->line), cache->line_blocks,
+				   cache_destage_read_cache_done, destage);
+	if (rc == -ENOMEM) {
+		destage->bdev_io_wait.bdev = cache->cache_bdev;
+		destage->bdev_io_wait.cb_fn = cache_destage_read_cache;
+		destage->bdev_io_wait.cb_arg = destage;
+		rc = spdk_bdev_queue_io_wait(cache->cache_bdev, shard->cache_ch,
+					     &destage->bdev_io_wait);
+	}
+	if (rc != 0) {
+		cache_destage_done(destage, false);
+	}
+}
+
+static bool
+cache_shard_destage_urgent(struct cache_shard *shard)
+{
+	return !TAILQ_EMPTY(&shard->flushes) ||
+	       (uint64_t)shard->num_dirty * 100 >=
+	       (uint64_t)shard->cache->lines_per_shard * CACHE_DESTAGE_DIRTY_PCT;
+}
+
+/* Start destaging the oldest dirty lines that are not in use */
+static void
+cache_shard_destage(struct cache_shard *shard)
+{
+	struct cache_destage *destage;
+	struct cache_line *line, *tmp;
+	int scanned = 0;
+
+	if (shard->stopping) {
+		return;
+	}
+
+	TAILQ_FOREACH_SAFE(line, &shard->dirty_lines, link, tmp) {
+		destage = TAILQ_FIRST(&shard->free_destages);
+		if (destage == NULL || scanned++ == CACHE_DESTAGE_SCAN_MAX) {
+			break;
+		}
+		if (line->destaging || line->writer || line->num_waiters > 0) {
+			continue;
+		}
+
+		TAILQ_REMOVE(&shard->free_destages, destage, link);
+		shard->num_destages++;
+		destage->line = line;
+		line->destaging = true;
+		line->readers++;
+
+		cache_destage_read_cache(destage);
+	}
+}
+
+static int
+cache_shard_destage_poll(void *arg)
+{
+	struct cache_shard *shard = arg;
+	bool idle = shard->io_count == 0;
+	uint32_t num_destages = shard->num_destages;
+
+	shard->io_count = 0;
+
+	if (shard->num_dirty == 0) {
+		cache_shard_check_flushed(shard);
+		return SPDK_POLLER_IDLE;
+	}
+
+	/* Destage in the background only when there is no I/O to compete with */
+	if (!idle && !cache_shard_destage_urgent(shard)) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	cache_shard_destage(shard);
+
+	return shard->num_destages > num_destages ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+static void
+cache_shard_stopped(void *ctx)
+{
+	struct cache_shard *shard = ctx;
+	struct vbdev_cache *cache = shard->cache;
+
+	shard->thread = NULL;
+
+	assert(cache->shards_pending > 0);
+	if (--cache->shards_pending == 0) {
+		cache->stop_cb(cache);
+	}
+}
+
+static void
+_cache_shard_stop(struct cache_shard *shard)
+{
+	if (shard->core_ch != NULL) {
+		spdk_put_io_channel(shard->core_ch);
+		shard->core_ch = NULL;
+	}
+	if (shard->cache_ch != NULL) {
+		spdk_put_io_channel(shard->cache_ch);
+		shard->cache_ch = NULL;
+	}
+
+	spdk_thread_exit(shard->thread);
+	spdk_thread_send_msg(shard->cache->thread, cache_shard_stopped, shard);
+}
+
+static bool
+cache_shard_busy(struct cache_shard *shard)
+{
+	return shard->num_fills > 0 || shard->num_destages > 0 || shard->md_writer.num_writes > 0;
+}
+
+static int
+cache_shard_stop_poll(void *arg)
+{
+	struct cache_shard *shard = arg;
+
+	if (cache_shard_busy(shard)) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	spdk_poller_unregister(&shard->stop_poller);
+	_cache_shard_stop(shard);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+cache_shard_stop(void *ctx)
+{
+	struct cache_shard *shard = ctx;
+
+	shard->stopping = true;
+	spdk_poller_unregister(&shard->destage_poller);
+	cache_shard_complete_flushes(shard, -ENODEV);
+
+	/* Lines filled after their read has been completed may still be in progress */
+	if (cache_shard_busy(shard)) {
+		shard->stop_poller = SPDK_POLLER_REGISTER(cache_shard_stop_poll, shard,
+				     CACHE_STOP_POLL_PERIOD_US);
+		return;
+	}
+
+	_cache_shard_stop(shard);
+}
+
+/* Stop the threads of the shards, must be called on the thread of the cache vbdev */
+static void
+cache_stop_shards(struct vbdev_cache *cache, void (*cb_fn)(struct vbdev_cache *cache))
+{
+	uint32_t i;
+
+	assert(cache->thread == spdk_get_thread());
+
+	cache->stop_cb = cb_fn;
+	cache->shards_pending = 1;
+
+	for (i = 0; i < cache->num_shards && cache->shards != NULL; i++) {
+		if (cache->shards[i].thread != NULL) {
+			cache->shards_pending++;
+			spdk_thread_send_msg(cache->shards[i].thread, cache_shard_stop,
+					     &cache->shards[i]);
+		}
+	}
+
+	if (--cache->shards_pending == 0) {
+		cb_fn(cache);
+	}
+}
+
+static void
+cache_shard_free(struct cache_shard *shard)
+{
+	free(shard->lines);
+	free(shard->hash);
+	vbdev_md_writer_fini(&shard->md_writer);
+	spdk_free(shard->md);
+	spdk_free(shard->bufs);
+}
+
+static void
+cache_close_base_bdevs(struct vbdev_cache *cache)
+{
+	if (cache->core_claimed) {
+		spdk_bdev_module_release_bdev(cache->core_bdev);
+		cache->core_claimed = false;
+	}
+	if (cache->cache_claimed) {
+		spdk_bdev_module_release_bdev(cache->cache_bdev);
+		cache->cache_claimed = false;
+	}
+	if (cache->core_desc != NULL) {
+		spdk_bdev_close(cache->core_desc);
+		cache->core_desc = NULL;
+	}
+	if (cache->cache_desc != NULL) {
+		spdk_bdev_close(cache->cache_desc);
+		cache->cache_desc = NULL;
+	}
+}
+
+static void
+cache_free(struct vbdev_cache *cache)
+{
+	uint32_t i;
+
+	cache_close_base_bdevs(cache);
+
+	if (cache->shards != NULL) {
+		for (i = 0; i < cache->num_shards; i++) {
+			cache_shard_free(&cache->shards[i]);
+		}
+		free(cache->shards);
+	}
+
+	free(cache->bdev.name);
+	free(cache);
+}
+
+static int
+cache_shard_init(struct vbdev_cache *cache, struct cache_shard *shard, uint32_t idx)
+{
+	uint32_t num_buckets, i;
+	size_t line_size = (size_t)cache->line_blocks * cache->blocklen;
+
+	shard->cache = cache;
+	shard->idx = idx;
+	TAILQ_INIT(&shard->free_lines);
+	TAILQ_INIT(&shard->clean_lines);
+	TAILQ_INIT(&shard->dirty_lines);
+	TAILQ_INIT(&shard->line_waiters);
+	TAILQ_INIT(&shard->bypass_writes);
+	TAILQ_INIT(&shard->free_fills);
+	TAILQ_INIT(&shard->free_destages);
+	TAILQ_INIT(&shard->flushes);
+
+	shard->lines = calloc(cache->lines_per_shard, sizeof(*shard->lines));
+	if (shard->lines == NULL) {
+		return -ENOMEM;
+	}
+
+	num_buckets = cache->lines_per_shard > 1 ? spdk_align32pow2(cache->lines_per_shard) : 1;
+	shard->hash = malloc(num_buckets * sizeof(*shard->hash));
+	if (shard->hash == NULL) {
+		return -ENOMEM;
+	}
+	memset(shard->hash, 0xff, num_buckets * sizeof(*shard->hash));
+	shard->hash_mask = num_buckets - 1;
+
+	shard->md = spdk_zmalloc(cache->md_blocks_per_shard * cache->blocklen, cache->buf_align,
+				 NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	shard->bufs = spdk_zmalloc((CACHE_FILLS_PER_SHARD + CACHE_DESTAGE_QD) * line_size,
+				   cache->buf_align, NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (shard->md == NULL || shard->bufs == NULL ||
+	    vbdev_md_writer_init(&shard->md_writer, cache->md_blocks_per_shard) != 0) {
+		return -ENOMEM;
+	}
+	shard->md_writer.name = cache->bdev.name;
+	shard->md_writer.desc = cache->cache_desc;
+	shard->md_writer.buf = shard->md;
+	shard->md_writer.block_size = cache->blocklen;
+	shard->md_writer.base_blocks = 1;
+	shard->md_writer.offset_blocks = cache_shard_md_offset(shard);
+
+	for (i = 0; i < cache->lines_per_shard; i++) {
+		shard->lines[i].hash_next = CACHE_LINE_NONE;
+	}
+
+	for (i = 0; i < CACHE_FILLS_PER_SHARD; i++) {
+		shard->fills[i].shard = shard;
+		shard->fills[i].buf = (char *)shard->bufs + i * line_size;
+		TAILQ_INSERT_TAIL(&shard->free_fills, &shard->fills[i], link);
+	}
+
+	for (i = 0; i < CACHE_DESTAGE_QD; i++) {
+		shard->destages[i].shard = shard;
+		shard->destages[i].buf = (char *)shard->bufs +
+					 (CACHE_FILLS_PER_SHARD + i) * line_size;
+		TAILQ_INSERT_TAIL(&shard->free_destages, &shard->destages[i], link);
+	}
+
+	return 0;
+}
+
+/* Rebuild the lines of a shard from its metadata, only the dirty ones are kept. Returns the
+ * number of entries that were dropped although marked dirty.
+ */
+static uint32_t
+cache_shard_rebuild(struct cache_shard *shard)
+{
+	struct vbdev_cache *cache = shard->cache;
+	struct cache_line *line;
+	struct cache_md_entry *entry;
+	uint32_t i, num_dropped = 0;
+
+	for (i = 0; i < cache->lines_per_shard; i++) {
+		line = &shard->lines[i];
+		entry = &shard->md[i];
+
+		if (entry->flags & CACHE_MD_ENTRY_DIRTY) {
+			if (entry->core_line < cache->num_core_lines &&
+			    entry->core_line % cache->num_shards == shard->idx &&
+			    cache_shard_lookup(shard, entry->core_line) == NULL) {
+				line->core_line = entry->core_line;
+				line->state = CACHE_LINE_DIRTY;
+				line->md_dirty = true;
+				cache_shard_hash_insert(shard, line);
+				TAILQ_INSERT_TAIL(&shard->dirty_lines, line, link);
+				shard->num_dirty++;
+				continue;
+			}
+			SPDK_WARNLOG("%s: dropping invalid dirty core line %" PRIu64
+				     " of shard %u\n", cache->bdev.name, entry->core_line,
+				     shard->idx);
+			num_dropped++;
+		}
+
+		memset(entry, 0, sizeof(*entry));
+		line->state = CACHE_LINE_INVALID;
+		TAILQ_INSERT_TAIL(&shard->free_lines, line, link);
+	}
+
+	return num_dropped;
+}
+
+static void
+cache_set_line_size(struct vbdev_cache *cache, uint32_t line_size, uint32_t num_shards)
+{
+	cache->line_blocks = line_size / cache->blocklen;
+	cache->line_shift = spdk_u32log2(cache->line_blocks);
+	cache->num_core_lines = spdk_bdev_get_num_blocks(cache->core_bdev) >> cache->line_shift;
+	cache->num_shards = num_shards;
+	cache->md_entries_per_block = cache->blocklen / sizeof(struct cache_md_entry);
+	cache->md_offset_blocks = spdk_divide_round_up(CACHE_SB_SIZE, cache->blocklen);
+}
+
+/* Use as much of the cache bdev as possible for lines */
+static int
+cache_calc_layout(struct vbdev_cache *cache)
+{
+	uint64_t cache_blocks = spdk_bdev_get_num_blocks(cache->cache_bdev);
+	uint64_t shard_line_blocks = (uint64_t)cache->num_shards * cache->line_blocks;
+	uint64_t lines = 0, md_blocks = 0, data_offset = 0, end, step;
+
+	if (cache_blocks > cache->md_offset_blocks) {
+		lines = (cache_blocks - cache->md_offset_blocks) / shard_line_blocks;
+		lines = spdk_min(lines, CACHE_LINES_PER_SHARD_MAX);
+	}
+
+	while (lines > 0) {
+		md_blocks = spdk_divide_round_up(lines, cache->md_entries_per_block);
+		data_offset = cache->md_offset_blocks + cache->num_shards * md_blocks;
+		data_offset = SPDK_ALIGN_CEIL(data_offset, cache->line_blocks);
+		end = data_offset + lines * shard_line_blocks;
+		if (end <= cache_blocks) {
+			break;
+		}
+		step = spdk_divide_round_up(end - cache_blocks, shard_line_blocks);
+		lines = lines > step ? lines - step : 0;
+	}
+
+	if (lines == 0) {
+		SPDK_ERRLOG("Cache bdev %s is too small\n", spdk_bdev_get_name(cache->cache_bdev));
+		return -ENOSPC;
+	}
+
+	cache->lines_per_shard = lines;
+	cache->md_blocks_per_shard = md_blocks;
+	cache->data_offset_blocks = data_offset;
+
+	return 0;
+}
+
+static bool
+cache_sb_is_valid(struct cache_sb *sb)
+{
+	uint32_t crc = sb->crc;
+	bool valid;
+
+	if (memcmp(sb->signature, CACHE_SB_SIGNATURE, sizeof(sb->signature)) != 0) {
+		return false;
+	}
+
+	sb->crc = 0;
+	valid = spdk_crc32c_update(sb, sizeof(*sb), 0) == crc;
+	sb->crc = crc;
+
+	return valid && sb->version == CACHE_SB_VERSION;
+}
+
+static int
+cache_sb_load(struct vbdev_cache *cache, const struct cache_sb *sb)
+{
+	uint64_t cache_blocks = spdk_bdev_get_num_blocks(cache->cache_bdev);
+	uint64_t core_blocks = spdk_bdev_get_num_blocks(cache->core_bdev);
+	uint64_t md_end = sb->md_offset_blocks + sb->num_shards * sb->md_blocks_per_shard;
+
+	if (sb->block_size != cache->blocklen || !spdk_u32_is_pow2(sb->line_size) ||
+	    sb->line_size < cache->blocklen || sb->line_size > CACHE_LINE_SIZE_KB_MAX * 1024 ||
+	    sb->num_shards == 0 || sb->num_shards > CACHE_NUM_SHARDS_MAX ||
+	    sb->lines_per_shard == 0 || sb->lines_per_shard > CACHE_LINES_PER_SHARD_MAX) {
+		goto err;
+	}
+
+	cache_set_line_size(cache, sb->line_size, sb->num_shards);
+
+	if (sb->md_offset_blocks < cache->md_offset_blocks ||
+	    sb->md_blocks_per_shard * cache->md_entries_per_block < sb->lines_per_shard ||
+	    sb->md_blocks_per_shard > UINT32_MAX ||
+	    md_end > sb->data_offset_blocks ||
+	    sb->data_offset_blocks > cache_blocks ||
+	    (uint64_t)sb->num_shards * sb->lines_per_shard * cache->line_blocks >
+	    cache_blocks - sb->data_offset_blocks) {
+		goto err;
+	}
+
+	if (sb->core_blockcnt != core_blocks) {
+		SPDK_NOTICELOG("Size of core bdev %s changed from %" PRIu64 " to %" PRIu64
+			       " blocks\n", spdk_bdev_get_name(cache->core_bdev), sb->core_blockcnt,
+			       core_blocks);
+	}
+
+	cache->lines_per_shard = sb->lines_per_shard;
+	cache->md_offset_blocks = sb->md_offset_blocks;
+	cache->md_blocks_per_shard = sb->md_blocks_per_shard;
+	cache->data_offset_blocks = sb->data_offset_blocks;
+
+	return 0;
+err:
+	SPDK_ERRLOG("Invalid superblock on cache bdev %s\n", spdk_bdev_get_name(cache->cache_bdev));
+	return -EINVAL;
+}
+
+static void
+cache_create_stopped(struct vbdev_cache *cache)
+{
+	struct cache_create_ctx *ctx = cache->create_ctx;
+
+	ctx->cb_fn(ctx->cb_arg, NULL, ctx->status);
+
+	cache_free(cache);
+	free(ctx);
+}
+
+static void
+cache_create_fail(struct cache_create_ctx *ctx, int status)
+{
+	ctx->status = status;
+
+	if (ctx->ch != NULL) {
+		spdk_put_io_channel(ctx->ch);
+		ctx->ch = NULL;
+	}
+	spdk_free(ctx->sb);
+	ctx->sb = NULL;
+
+	cache_stop_shards(ctx->cache, cache_create_stopped);
+}
+
+static const struct spdk_bdev_fn_table vbdev_cache_fn_table;
+
+static void
+cache_create_register(struct cache_create_ctx *ctx)
+{
+	struct vbdev_cache *cache = ctx->cache;
+	struct spdk_bdev *core_bdev = cache->core_bdev;
+	struct spdk_bdev *cache_bdev = cache->cache_bdev;
+	int rc;
+
+	cache->bdev.product_name = "cache";
+	cache->bdev.write_cache = core_bdev->write_cache || cache_bdev->write_cache;
+	cache->bdev.required_alignment = spdk_max(core_bdev->required_alignment,
+				       cache_bdev->required_alignment);
+	cache->bdev.optimal_io_boundary = cache->line_blocks;
+	cache->bdev.split_on_optimal_io_boundary = true;
+	cache->bdev.max_unmap = cache->line_blocks * CACHE_UNMAP_LINES_MAX;
+	cache->bdev.max_unmap_segments = 1;
+	cache->bdev.blocklen = cache->blocklen;
+	cache->bdev.blockcnt = spdk_bdev_get_num_blocks(core_bdev);
+	cache->bdev.ctxt = cache;
+	cache->bdev.fn_table = &vbdev_cache_fn_table;
+	cache->bdev.module = &cache_if;
+
+	spdk_io_device_register(cache, cache_bdev_ch_create_cb, cache_bdev_ch_destroy_cb,
+				sizeof(struct cache_io_channel), cache->bdev.name);
+
+	rc = spdk_bdev_register(&cache->bdev);
+	if (rc != 0) {
+		SPDK_ERRLOG("could not register cache bdev %s\n", cache->bdev.name);
+		spdk_io_device_unregister(cache, NULL);
+		cache_create_fail(ctx, rc);
+		return;
+	}
+
+	TAILQ_INSERT_TAIL(&g_cache_nodes, cache, link);
+	cache->create_ctx = NULL;
+
+	ctx->cb_fn(ctx->cb_arg, &cache->bdev, 0);
+	free(ctx);
+}
+
+static void
+cache_create_shards_started(struct cache_create_ctx *ctx)
+{
+	struct vbdev_cache *cache = ctx->cache;
+
+	assert(cache->shards_pending > 0);
+	if (--cache->shards_pending > 0) {
+		return;
+	}
+
+	if (ctx->status != 0) {
+		cache_create_fail(ctx, ctx->status);
+	} else {
+		cache_create_register(ctx);
+	}
+}
+
+static void
+cache_create_shard_started(void *arg)
+{
+	struct cache_shard *shard = arg;
+	struct cache_create_ctx *ctx = shard->cache->create_ctx;
+
+	if (shard->start_status != 0) {
+		ctx->status = shard->start_status;
+	}
+
+	cache_create_shards_started(ctx);
+}
+
+static void
+cache_shard_start(void *arg)
+{
+	struct cache_shard *shard = arg;
+	struct vbdev_cache *cache = shard->cache;
+
+	shard->core_ch = spdk_bdev_get_io_channel(cache->core_desc);
+	shard->cache_ch = spdk_bdev_get_io_channel(cache->cache_desc);
+	shard->md_writer.ch = shard->cache_ch;
+	if (shard->core_ch == NULL || shard->cache_ch == NULL) {
+		shard->start_status = -ENOMEM;
+	} else {
+		shard->destage_poller = SPDK_POLLER_REGISTER(cache_shard_destage_poll, shard,
+					CACHE_DESTAGE_POLL_PERIOD_US);
+	}
+
+	spdk_thread_send_msg(cache->thread, cache_create_shard_started, shard);
+}
+
+static void
+cache_create_start_shards(struct cache_create_ctx *ctx)
+{
+	struct vbdev_cache *cache = ctx->cache;
+	struct cache_shard *shard;
+	char thread_name[64];
+	uint32_t i;
+
+	spdk_put_io_channel(ctx->ch);
+	ctx->ch = NULL;
+	spdk_free(ctx->sb);
+	ctx->sb = NULL;
+
+	cache->shards_pending = 1;
+
+	for (i = 0; i < cache->num_shards; i++) {
+		shard = &cache->shards[i];
+		snprintf(thread_name, sizeof(thread_name), "%s_%u", cache->bdev.name, i);
+		shard->thread = spdk_thread_create(thread_name, NULL);
+		if (shard->thread == NULL) {
+			SPDK_ERRLOG("Failed to create thread %s\n", thread_name);
+			ctx->status = -ENOMEM;
+			break;
+		}
+		cache->shards_pending++;
+		spdk_thread_send_msg(shard->thread, cache_shard_start, shard);
+	}
+
+	cache_create_shards_started(ctx);
+}
+
+static void
+cache_create_write_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_create_ctx *ctx = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to write the superblock of %s\n", ctx->cache->bdev.name);
+		cache_create_fail(ctx, -EIO);
+		return;
+	}
+
+	cache_create_start_shards(ctx);
+}
+
+static void
+cache_create_write_sb(struct cache_create_ctx *ctx)
+{
+	struct vbdev_cache *cache = ctx->cache;
+	struct cache_sb *sb = ctx->sb;
+	int rc;
+
+	memset(sb, 0, sizeof(*sb));
+	memcpy(sb->signature, CACHE_SB_SIGNATURE, sizeof(sb->signature));
+	sb->version = CACHE_SB_VERSION;
+	spdk_uuid_copy(&sb->core_uuid, spdk_bdev_get_uuid(cache->core_bdev));
+	sb->core_blockcnt = spdk_bdev_get_num_blocks(cache->core_bdev);
+	sb->block_size = cache->blocklen;
+	sb->line_size = cache->line_blocks * cache->blocklen;
+	sb->num_shards = cache->num_shards;
+	sb->lines_per_shard = cache->lines_per_shard;
+	sb->md_offset_blocks = cache->md_offset_blocks;
+	sb->md_blocks_per_shard = cache->md_blocks_per_shard;
+	sb->data_offset_blocks = cache->data_offset_blocks;
+	sb->crc = spdk_crc32c_update(sb, sizeof(*sb), 0);
+
+	rc = spdk_bdev_write_blocks(cache->cache_desc, ctx->ch, sb, 0, cache->md_offset_blocks,
+				    cache_create_write_sb_done, ctx);
+	if (rc != 0) {
+		cache_create_fail(ctx, rc);
+	}
+}
+
+static void cache_create_write_md(struct cache_create_ctx *ctx);
+static void cache_create_load_md(struct cache_create_ctx *ctx);
+
+static void
+cache_create_write_md_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_create_ctx *ctx = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to write the metadata of %s\n", ctx->cache->bdev.name);
+		cache_create_fail(ctx, -EIO);
+		return;
+	}
+
+	ctx->shard_idx++;
+	if (ctx->load) {
+		cache_create_load_md(ctx);
+	} else {
+		cache_create_write_md(ctx);
+	}
+}
+
+/* The metadata is written before the superblock, so that a valid superblock never comes with
+ * stale metadata.
+ */
+static void
+cache_create_write_md(struct cache_create_ctx *ctx)
+{
+	struct vbdev_cache *cache = ctx->cache;
+	struct cache_shard *shard;
+	int rc;
+
+	if (ctx->shard_idx == cache->num_shards) {
+		cache_create_write_sb(ctx);
+		return;
+	}
+
+	shard = &cache->shards[ctx->shard_idx];
+	rc = spdk_bdev_write_blocks(cache->cache_desc, ctx->ch, shard->md,
+				    cache_shard_md_offset(shard), cache->md_blocks_per_shard,
+				    cache_create_write_md_done, ctx);
+	if (rc != 0) {
+		cache_create_fail(ctx, rc);
+	}
+}
+
+static void
+cache_create_load_md_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_create_ctx *ctx = cb_arg;
+	struct vbdev_cache *cache = ctx->cache;
+	struct cache_shard *shard = &cache->shards[ctx->shard_idx];
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to read the metadata of %s\n", cache->bdev.name);
+		cache_create_fail(ctx, -EIO);
+		return;
+	}
+
+	/* Clear the dropped entries on disk too, their lines may be reused */
+	if (cache_shard_rebuild(shard) > 0) {
+		cache_create_write_md(ctx);
+		return;
+	}
+
+	ctx->shard_idx++;
+	cache_create_load_md(ctx);
+}
+
+static void
+cache_create_load_md(struct cache_create_ctx *ctx)
+{
+	struct vbdev_cache *cache = ctx->cache;
+	struct cache_shard *shard;
+	int rc;
+
+	if (ctx->shard_idx == cache->num_shards) {
+		cache_create_start_shards(ctx);
+		return;
+	}
+
+	shard = &cache->shards[ctx->shard_idx];
+	rc = spdk_bdev_read_blocks(cache->cache_desc, ctx->ch, shard->md,
+				   cache_shard_md_offset(shard), cache->md_blocks_per_shard,
+				   cache_create_load_md_done, ctx);
+	if (rc != 0) {
+		cache_create_fail(ctx, rc);
+	}
+}
+
+static void
+cache_create_read_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct cache_create_ctx *ctx = cb_arg;
+	struct vbdev_cache *cache = ctx->cache;
+	struct cache_sb *sb = ctx->sb;
+	uint32_t i;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to read the superblock of %s\n", cache->bdev.name);
+		cache_create_fail(ctx, -EIO);
+		return;
+	}
+
+	if (cache_sb_is_valid(sb)) {
+		if (spdk_uuid_compare(&sb->core_uuid, spdk_bdev_get_uuid(cache->core_bdev)) != 0) {
+			SPDK_ERRLOG("Cache bdev %s holds the data of another core bdev\n",
+				    spdk_bdev_get_name(cache->cache_bdev));
+			cache_create_fail(ctx, -EEXIST);
+			return;
+		}
+
+		rc = cache_sb_load(cache, sb);
+		if (rc != 0) {
+			cache_create_fail(ctx, rc);
+			return;
+		}
+		if (sb->line_size != ctx->line_size || sb->num_shards != ctx->num_shards) {
+			SPDK_NOTICELOG("%s: using the line size (%u) and the number of shards (%u) "
+				       "of the existing cache\n", cache->bdev.name, sb->line_size,
+				       sb->num_shards);
+		}
+		ctx->load = true;
+	} else {
+		cache_set_line_size(cache, ctx->line_size, ctx->num_shards);
+		rc = cache_calc_layout(cache);
+		if (rc != 0) {
+			cache_create_fail(ctx, rc);
+			return;
+		}
+	}
+
+	cache->shards = calloc(cache->num_shards, sizeof(*cache->shards));
+	if (cache->shards == NULL) {
+		cache_create_fail(ctx, -ENOMEM);
+		return;
+	}
+
+	for (i = 0; i < cache->num_shards; i++) {
+		rc = cache_shard_init(cache, &cache->shards[i], i);
+		if (rc != 0) {
+			SPDK_ERRLOG("Failed to allocate shard %u of %s\n", i, cache->bdev.name);
+			cache_create_fail(ctx, rc);
+			return;
+		}
+		if (!ctx->load) {
+			cache_shard_rebuild(&cache->shards[i]);
+		}
+	}
+
+	SPDK_DEBUGLOG(vbdev_cache, "%s: %u shards of %u lines of %u blocks, data at block %"
+		      PRIu64 "\n", cache->bdev.name, cache->num_shards, cache->lines_per_shard,
+		      cache->line_blocks, cache->data_offset_blocks);
+
+	ctx->shard_idx = 0;
+	if (ctx->load) {
+		cache_create_load_md(ctx);
+	} else {
+		cache_create_write_md(ctx);
+	}
+}
+
+static void
+cache_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev, void *event_ctx)
+{
+	struct vbdev_cache *cache, *tmp;
+
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		TAILQ_FOREACH_SAFE(cache, &g_cache_nodes, link, tmp) {
+			if (cache->core_bdev == bdev || cache->cache_bdev == bdev) {
+				spdk_bdev_unregister(&cache->bdev, NULL, NULL);
+			}
+		}
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+void
+vbdev_cache_get_default_opts(struct vbdev_cache_opts *opts)
+{
+	memset(opts, 0, sizeof(*opts));
+	opts->mode = VBDEV_CACHE_MODE_WB;
+	opts->line_size_kb = CACHE_LINE_SIZE_KB_DEFAULT;
+	opts->num_shards = 1;
+	opts->seq_cutoff_kb = CACHE_SEQ_CUTOFF_KB_DEFAULT;
+}
+
+static int
+cache_open_base_bdev(struct vbdev_cache *cache, const char *name, struct spdk_bdev_desc **desc,
+		     bool *claimed)
+{
+	int rc;
+
+	rc = spdk_bdev_open_ext(name, true, cache_base_bdev_event_cb, NULL, desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("could not open bdev %s: %s\n", name, spdk_strerror(-rc));
+		return rc;
+	}
+
+	rc = spdk_bdev_module_claim_bdev(spdk_bdev_desc_get_bdev(*desc), *desc, &cache_if);
+	if (rc != 0) {
+		SPDK_ERRLOG("could not claim bdev %s\n", name);
+		return rc;
+	}
+	*claimed = true;
+
+	return 0;
+}
+
+int
+vbdev_cache_create(const struct vbdev_cache_opts *opts, vbdev_cache_create_cb cb_fn, void *cb_arg)
+{
+	struct vbdev_cache *cache;
+	struct cache_create_ctx *ctx;
+	struct spdk_uuid ns_uuid;
+	uint32_t line_size;
+	int rc;
+
+	if (opts->name == NULL || opts->core_bdev_name == NULL || opts->cache_bdev_name == NULL) {
+		return -EINVAL;
+	}
+	if (vbdev_cache_mode_to_str(opts->mode) == NULL) {
+		SPDK_ERRLOG("Invalid cache mode %d\n", opts->mode);
+		return -EINVAL;
+	}
+	if (!spdk_u32_is_pow2(opts->line_size_kb) || opts->line_size_kb > CACHE_LINE_SIZE_KB_MAX) {
+		SPDK_ERRLOG("Line size must be a power of 2 not greater than %u KiB\n",
+			    CACHE_LINE_SIZE_KB_MAX);
+		return -EINVAL;
+	}
+	if (opts->num_shards == 0 || opts->num_shards > CACHE_NUM_SHARDS_MAX) {
+		SPDK_ERRLOG("Number of shards must be between 1 and %u\n", CACHE_NUM_SHARDS_MAX);
+		return -EINVAL;
+	}
+	if (strcmp(opts->core_bdev_name, opts->cache_bdev_name) == 0) {
+		SPDK_ERRLOG("Core and cache bdevs must be different\n");
+		return -EINVAL;
+	}
+	if (spdk_bdev_get_by_name(opts->name) != NULL) {
+		SPDK_ERRLOG("Bdev %s already exists\n", opts->name);
+		return -EEXIST;
+	}
+
+	cache = calloc(1, sizeof(*cache));
+	ctx = calloc(1, sizeof(*ctx));
+	if (cache == NULL || ctx == NULL) {
+		free(cache);
+		free(ctx);
+		return -ENOMEM;
+	}
+
+	cache->bdev.name = strdup(opts->name);
+	if (cache->bdev.name == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	rc = cache_open_base_bdev(cache, opts->core_bdev_name, &cache->core_desc,
+				  &cache->core_claimed);
+	if (rc != 0) {
+		goto err;
+	}
+	cache->core_bdev = spdk_bdev_desc_get_bdev(cache->core_desc);
+
+	rc = cache_open_base_bdev(cache, opts->cache_bdev_name, &cache->cache_desc,
+				  &cache->cache_claimed);
+	if (rc != 0) {
+		goto err;
+	}
+	cache->cache_bdev = spdk_bdev_desc_get_bdev(cache->cache_desc);
+
+	cache->blocklen = spdk_bdev_get_block_size(cache->core_bdev);
+	if (spdk_bdev_get_block_size(cache->cache_bdev) != cache->blocklen) {
+		SPDK_ERRLOG("Core and cache bdevs must have the same block size\n");
+		rc = -EINVAL;
+		goto err;
+	}
+	if (spdk_bdev_get_md_size(cache->core_bdev) != 0 ||
+	    spdk_bdev_get_md_size(cache->cache_bdev) != 0) {
+		SPDK_ERRLOG("Bdevs with metadata are not supported\n");
+		rc = -ENOTSUP;
+		goto err;
+	}
+
+	line_size = opts->line_size_kb * 1024;
+	if (line_size < cache->blocklen) {
+		SPDK_ERRLOG("Line size must not be smaller than the block size\n");
+		rc = -EINVAL;
+		goto err;
+	}
+
+	if (spdk_uuid_is_null(&opts->uuid)) {
+		/* Generate UUID based on namespace UUID + core bdev UUID */
+		spdk_uuid_parse(&ns_uuid, BDEV_CACHE_NAMESPACE_UUID);
+		rc = spdk_uuid_generate_sha1(&cache->bdev.uuid, &ns_uuid,
+					     (const char *)&cache->core_bdev->uuid,
+					     sizeof(struct spdk_uuid));
+		if (rc != 0) {
+			goto err;
+		}
+	} else {
+		spdk_uuid_copy(&cache->bdev.uuid, &opts->uuid);
+	}
+
+	cache->thread = spdk_get_thread();
+	cache->mode = opts->mode;
+	cache->seq_cutoff_kb = opts->seq_cutoff_kb;
+	cache->seq_cutoff_blocks = (uint64_t)opts->seq_cutoff_kb * 1024 / cache->blocklen;
+	cache->buf_align = spdk_max(spdk_bdev_get_buf_align(cache->core_bdev),
+				    spdk_bdev_get_buf_align(cache->cache_bdev));
+	cache->buf_align = spdk_max(cache->buf_align, 0x1000);
+	cache->create_ctx = ctx;
+
+	ctx->cache = cache;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->line_size = line_size;
+	ctx->num_shards = opts->num_shards;
+
+	ctx->ch = spdk_bdev_get_io_channel(cache->cache_desc);
+	if (ctx->ch == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	cache->md_offset_blocks = spdk_divide_round_up(CACHE_SB_SIZE, cache->blocklen);
+	ctx->sb = spdk_zmalloc(cache->md_offset_blocks * cache->blocklen, cache->buf_align, NULL,
+			       SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (ctx->sb == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	rc = spdk_bdev_read_blocks(cache->cache_desc, ctx->ch, ctx->sb, 0, cache->md_offset_blocks,
+				   cache_create_read_sb_done, ctx);
+	if (rc != 0) {
+		goto err;
+	}
+
+	return 0;
+err:
+	if (ctx->ch != NULL) {
+		spdk_put_io_channel(ctx->ch);
+	}
+	spdk_free(ctx->sb);
+	free(ctx);
+	cache_free(cache);
+	return rc;
+}
+
+static void
+cache_destruct_stopped(struct vbdev_cache *cache)
+{
+	cache_close_base_bdevs(cache);
+	spdk_bdev_destruct_done(&cache->bdev, 0);
+	cache_free(cache);
+}
+
+static void
+_cache_destruct(void *ctx)
+{
+	cache_stop_shards(ctx, cache_destruct_stopped);
+}
+
+static void
+cache_io_device_unregister_cb(void *io_device)
+{
+	struct vbdev_cache *cache = io_device;
+
+	/* The base bdevs have to be closed on the thread they were opened on */
+	if (cache->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(cache->thread, _cache_destruct, cache);
+	} else {
+		_cache_destruct(cache);
+	}
+}
+
+/* Dirty lines are not destaged here, they are recovered when the cache vbdev is created again */
+static int
+vbdev_cache_destruct(void *ctx)
+{
+	struct vbdev_cache *cache = ctx;
+
+	TAILQ_REMOVE(&g_cache_nodes, cache, link);
+	spdk_io_device_unregister(cache, cache_io_device_unregister_cb);
+
+	/* Wait for the shards to stop */
+	return 1;
+}
+
+void
+vbdev_cache_delete(const char *name, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	int rc;
+
+	rc = spdk_bdev_unregister_by_name(name, &cache_if, cb_fn, cb_arg);
+	if (rc != 0) {
+		cb_fn(cb_arg, rc);
+	}
+}
+
+static void
+cache_shard_flush_start(void *ctx)
+{
+	struct cache_shard_flush *shard_flush = ctx;
+	struct cache_flush *flush = shard_flush->flush;
+	struct cache_shard *shard = &flush->cache->shards[shard_flush - flush->shards];
+
+	TAILQ_INSERT_TAIL(&shard->flushes, shard_flush, link);
+	if (shard->stopping) {
+		cache_shard_complete_flushes(shard, -ENODEV);
+		return;
+	}
+
+	cache_shard_destage(shard);
+	cache_shard_check_flushed(shard);
+}
+
+int
+vbdev_cache_flush(const char *name, vbdev_cache_flush_cb cb_fn, void *cb_arg)
+{
+	struct vbdev_cache *cache;
+	struct cache_flush *flush;
+	uint32_t i;
+
+	TAILQ_FOREACH(cache, &g_cache_nodes, link) {
+		if (strcmp(cache->bdev.name, name) == 0) {
+			break;
+		}
+	}
+	if (cache == NULL) {
+		return -ENODEV;
+	}
+
+	flush = calloc(1, sizeof(*flush) + cache->num_shards * sizeof(struct cache_shard_flush));
+	if (flush == NULL) {
+		return -ENOMEM;
+	}
+
+	flush->cache = cache;
+	flush->cb_fn = cb_fn;
+	flush->cb_arg = cb_arg;
+	flush->thread = spdk_get_thread();
+	flush->remaining = cache->num_shards;
+
+	for (i = 0; i < cache->num_shards; i++) {
+		flush->shards[i].flush = flush;
+		spdk_thread_send_msg(cache->shards[i].thread, cache_shard_flush_start,
+				     &flush->shards[i]);
+	}
+
+	return 0;
+}
+
+static const char *g_cache_mode_names[] = {
+	[VBDEV_CACHE_MODE_WB] = "wb",
+	[VBDEV_CACHE_MODE_WT] = "wt",
+};
+
+const char *
+vbdev_cache_mode_to_str(enum vbdev_cache_mode mode)
+{
+	if ((unsigned int)mode >= SPDK_COUNTOF(g_cache_mode_names)) {
+		return NULL;
+	}
+
+	return g_cache_mode_names[mode];
+}
+
+int
+vbdev_cache_mode_from_str(const char *str)
+{
+	unsigned int i;
+
+	for (i = 0; i < SPDK_COUNTOF(g_cache_mode_names); i++) {
+		if (strcmp(g_cache_mode_names[i], str) == 0) {
+			return i;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static void
+cache_write_conf_values(struct vbdev_cache *cache, struct spdk_json_write_ctx *w)
+{
+	spdk_json_write_named_string(w, "name", cache->bdev.name);
+	spdk_json_write_named_string(w, "core_bdev_name", spdk_bdev_get_name(cache->core_bdev));
+	spdk_json_write_named_string(w, "cache_bdev_name", spdk_bdev_get_name(cache->cache_bdev));
+	spdk_json_write_named_uuid(w, "uuid", &cache->bdev.uuid);
+	spdk_json_write_named_string(w, "mode", vbdev_cache_mode_to_str(cache->mode));
+	spdk_json_write_named_uint32(w, "line_size_kb",
+				     cache->line_blocks * cache->blocklen / 1024);
+	spdk_json_write_named_uint32(w, "num_shards", cache->num_shards);
+	spdk_json_write_named_uint32(w, "seq_cutoff_kb", cache->seq_cutoff_kb);
+}
+
+static int
+vbdev_cache_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_cache *cache = ctx;
+	struct cache_stats stats = {};
+	struct cache_shard *shard;
+	uint64_t num_dirty = 0;
+	uint32_t i;
+
+	/* The counters belong to the shard threads, they are only approximate here */
+	for (i = 0; i < cache->num_shards; i++) {
+		shard = &cache->shards[i];
+		num_dirty += shard->num_dirty;
+		stats.read_hits += shard->stats.read_hits;
+		stats.read_misses += shard->stats.read_misses;
+		stats.read_bypasses += shard->stats.read_bypasses;
+		stats.write_hits += shard->stats.write_hits;
+		stats.write_misses += shard->stats.write_misses;
+		stats.write_bypasses += shard->stats.write_bypasses;
+		stats.evictions += shard->stats.evictions;
+		stats.destaged_lines += shard->stats.destaged_lines;
+		stats.destage_errors += shard->stats.destage_errors;
+	}
+
+	spdk_json_write_named_object_begin(w, "cache");
+	cache_write_conf_values(cache, w);
+	spdk_json_write_named_uint64(w, "num_lines",
+				     (uint64_t)cache->num_shards * cache->lines_per_shard);
+	spdk_json_write_named_uint64(w, "num_dirty_lines", num_dirty);
+	spdk_json_write_named_object_begin(w, "stats");
+	spdk_json_write_named_uint64(w, "read_hits", stats.read_hits);
+	spdk_json_write_named_uint64(w, "read_misses", stats.read_misses);
+	spdk_json_write_named_uint64(w, "read_bypasses", stats.read_bypasses);
+	spdk_json_write_named_uint64(w, "write_hits", stats.write_hits);
+	spdk_json_write_named_uint64(w, "write_misses", stats.write_misses);
+	spdk_json_write_named_uint64(w, "write_bypasses", stats.write_bypasses);
+	spdk_json_write_named_uint64(w, "evictions", stats.evictions);
+	spdk_json_write_named_uint64(w, "destaged_lines", stats.destaged_lines);
+	spdk_json_write_named_uint64(w, "destage_errors", stats.destage_errors);
+	spdk_json_write_object_end(w);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+/* This is used to generate JSON that can configure this module to its current state. */
+static int
+vbdev_cache_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_cache *cache;
+
+	TAILQ_FOREACH(cache, &g_cache_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_cache_create");
+		spdk_json_write_named_object_begin(w, "params");
+		cache_write_conf_values(cache, w);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+
+	return 0;
+}
+
+static void
+vbdev_cache_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+	/* No config per bdev needed */
+}
+
+static const struct spdk_bdev_fn_table vbdev_cache_fn_table = {
+	.destruct		= vbdev_cache_destruct,
+	.submit_request		= vbdev_cache_submit_request,
+	.io_type_supported	= vbdev_cache_io_type_supported,
+	.get_io_channel		= vbdev_cache_get_io_channel,
+	.dump_info_json		= vbdev_cache_dump_info_json,
+	.write_config_json	= vbdev_cache_write_config_json,
+};
+
+static int
+vbdev_cache_init(void)
+{
+	return 0;
+}
+
+static int
+vbdev_cache_get_ctx_size(void)
+{
+	return sizeof(struct cache_bdev_io);
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_cache)
@@ -0,0 +1,100 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_VBDEV_CACHE_H
+#define SPDK_VBDEV_CACHE_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+enum vbdev_cache_mode {
+	/* Writes are acknowledged once they are on the cache bdev and destaged later */
+	VBDEV_CACHE_MODE_WB,
+	/* Writes go to the core bdev and update the lines already in the cache */
+	VBDEV_CACHE_MODE_WT,
+};
+
+struct vbdev_cache_opts {
+	/* Name of the cache vbdev */
+	const char *name;
+	/* Name of the slow bdev that is cached */
+	const char *core_bdev_name;
+	/* Name of the fast bdev that holds the cached data and the metadata */
+	const char *cache_bdev_name;
+	/* UUID of the cache vbdev, generated from the core bdev's if null */
+	struct spdk_uuid uuid;
+	enum vbdev_cache_mode mode;
+	/* Size of a cache line, a power of 2 */
+	uint32_t line_size_kb;
+	/* Number of shards, each one owned by its own thread */
+	uint32_t num_shards;
+	/* Sequential streams of this size and longer bypass the cache on misses, 0 disables */
+	uint32_t seq_cutoff_kb;
+};
+
+/**
+ * Fill the cache vbdev options with the default values.
+ *
+ * \param opts Options to initialize.
+ */
+void vbdev_cache_get_default_opts(struct vbdev_cache_opts *opts);
+
+typedef void (*vbdev_cache_create_cb)(void *cb_arg, struct spdk_bdev *bdev, int rc);
+
+/**
+ * Create a cache vbdev. If the cache bdev holds the metadata of a previous cache vbdev
+ * created for the same core bdev, its dirty data is recovered and the geometry stored in
+ * the metadata is used instead of the one in opts.
+ *
+ * \param opts Options of the cache vbdev.
+ * \param cb_fn Function to call when the cache vbdev is registered or its creation failed.
+ * \param cb_arg Argument to pass to cb_fn.
+ * \return 0 if the creation was started, negative errno otherwise. cb_fn is not called
+ * if this function fails.
+ */
+int vbdev_cache_create(const struct vbdev_cache_opts *opts, vbdev_cache_create_cb cb_fn,
+		       void *cb_arg);
+
+/**
+ * Delete a cache vbdev. Its dirty data stays on the cache bdev and is recovered when the
+ * cache vbdev is created again.
+ *
+ * \param name Name of the cache vbdev.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void vbdev_cache_delete(const char *name, spdk_bdev_unregister_cb cb_fn, void *cb_arg);
+
+typedef void (*vbdev_cache_flush_cb)(void *cb_arg, int rc);
+
+/**
+ * Destage all the dirty data of a cache vbdev to its core bdev.
+ *
+ * \param name Name of the cache vbdev.
+ * \param cb_fn Function to call when there is no dirty data left.
+ * \param cb_arg Argument to pass to cb_fn.
+ * \return 0 if the flush was started, negative errno otherwise.
+ */
+int vbdev_cache_flush(const char *name, vbdev_cache_flush_cb cb_fn, void *cb_arg);
+
+/**
+ * Get the string representation of a cache mode.
+ *
+ * \param mode Cache mode.
+ * \return Name of the mode or NULL if it is invalid.
+ */
+const char *vbdev_cache_mode_to_str(enum vbdev_cache_mode mode);
+
+/**
+ * Parse a cache mode.
+ *
+ * \param str Name of the mode, "wb" or "wt".
+ * \return The mode or -EINVAL if str is not a valid mode.
+ */
+int vbdev_cache_mode_from_str(const char *str);
+
+#endif /* SPDK_VBDEV_CACHE_H */
@@ -0,0 +1,202 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_cache.h"
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/string.h"
+#include "spdk/log.h"
+
+struct rpc_construct_cache {
+	char *name;
+	char *core_bdev_name;
+	char *cache_bdev_name;
+	char *mode;
+	struct spdk_uuid uuid;
+	uint32_t line_size_kb;
+	uint32_t num_shards;
+	uint32_t seq_cutoff_kb;
+	struct spdk_jsonrpc_request *request;
+};
+
+static void
+free_rpc_construct_cache(struct rpc_construct_cache *r)
+{
+	free(r->name);
+	free(r->core_bdev_name);
+	free(r->cache_bdev_name);
+	free(r->mode);
+	free(r);
+}
+
+static const struct spdk_json_object_decoder rpc_construct_cache_decoders[] = {
+	{"name", offsetof(struct rpc_construct_cache, name), spdk_json_decode_string},
+	{"core_bdev_name", offsetof(struct rpc_construct_cache, core_bdev_name), spdk_json_decode_string},
+	{"cache_bdev_name", offsetof(struct rpc_construct_cache, cache_bdev_name), spdk_json_decode_string},
+	{"mode", offsetof(struct rpc_construct_cache, mode), spdk_json_decode_string},
+	{"uuid", offsetof(struct rpc_construct_cache, uuid), spdk_json_decode_uuid, true},
+	{"line_size_kb", offsetof(struct rpc_construct_cache, line_size_kb), spdk_json_decode_uint32, true},
+	{"num_shards", offsetof(struct rpc_construct_cache, num_shards), spdk_json_decode_uint32, true},
+	{"seq_cutoff_kb", offsetof(struct rpc_construct_cache, seq_cutoff_kb), spdk_json_decode_uint32, true},
+};
+
+static void
+rpc_bdev_cache_create_cb(void *cb_arg, struct spdk_bdev *bdev, int rc)
+{
+	struct rpc_construct_cache *req = cb_arg;
+	struct spdk_json_write_ctx *w;
+
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(req->request, rc, spdk_strerror(-rc));
+	} else {
+		w = spdk_jsonrpc_begin_result(req->request);
+		spdk_json_write_string(w, spdk_bdev_get_name(bdev));
+		spdk_jsonrpc_end_result(req->request, w);
+	}
+
+	free_rpc_construct_cache(req);
+}
+
+static void
+rpc_bdev_cache_create(struct spdk_jsonrpc_request *request,
+		      const struct spdk_json_val *params)
+{
+	struct rpc_construct_cache *req;
+	struct vbdev_cache_opts opts;
+	int rc;
+
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	vbdev_cache_get_default_opts(&opts);
+	req->line_size_kb = opts.line_size_kb;
+	req->num_shards = opts.num_shards;
+	req->seq_cutoff_kb = opts.seq_cutoff_kb;
+	req->request = request;
+
+	if (spdk_json_decode_object(params, rpc_construct_cache_decoders,
+				    SPDK_COUNTOF(rpc_construct_cache_decoders),
+				    req)) {
+		SPDK_DEBUGLOG(vbdev_cache, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = vbdev_cache_mode_from_str(req->mode);
+	if (rc < 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Invalid cache mode: %s", req->mode);
+		goto cleanup;
+	}
+
+	opts.name = req->name;
+	opts.core_bdev_name = req->core_bdev_name;
+	opts.cache_bdev_name = req->cache_bdev_name;
+	opts.mode = rc;
+	spdk_uuid_copy(&opts.uuid, &req->uuid);
+	opts.line_size_kb = req->line_size_kb;
+	opts.num_shards = req->num_shards;
+	opts.seq_cutoff_kb = req->seq_cutoff_kb;
+
+	rc = vbdev_cache_create(&opts, rpc_bdev_cache_create_cb, req);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	return;
+
+cleanup:
+	free_rpc_construct_cache(req);
+}
+SPDK_RPC_REGISTER("bdev_cache_create", rpc_bdev_cache_create, SPDK_RPC_RUNTIME)
+
+struct rpc_cache_name {
+	char *name;
+};
+
+static void
+free_rpc_cache_name(struct rpc_cache_name *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_cache_name_decoders[] = {
+	{"name", offsetof(struct rpc_cache_name, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_cache_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (bdeverrno == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, bdeverrno, spdk_strerror(-bdeverrno));
+	}
+}
+
+static void
+rpc_bdev_cache_delete(struct spdk_jsonrpc_request *request,
+		      const struct spdk_json_val *params)
+{
+	struct rpc_cache_name req = {NULL};
+
+	if (spdk_json_decode_object(params, rpc_cache_name_decoders,
+				    SPDK_COUNTOF(rpc_cache_name_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	vbdev_cache_delete(req.name, rpc_bdev_cache_delete_cb, request);
+
+cleanup:
+	free_rpc_cache_name(&req);
+}
+SPDK_RPC_REGISTER("bdev_cache_delete", rpc_bdev_cache_delete, SPDK_RPC_RUNTIME)
+
+static void
+rpc_bdev_cache_flush_cb(void *cb_arg, int rc)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (rc == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+}
+
+static void
+rpc_bdev_cache_flush(struct spdk_jsonrpc_request *request,
+		     const struct spdk_json_val *params)
+{
+	struct rpc_cache_name req = {NULL};
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_cache_name_decoders,
+				    SPDK_COUNTOF(rpc_cache_name_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = vbdev_cache_flush(req.name, rpc_bdev_cache_flush_cb, request);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+
+cleanup:
+	free_rpc_cache_name(&req);
+}
+SPDK_RPC_REGISTER("bdev_cache_flush", rpc_bdev_cache_flush, SPDK_RPC_RUNTIME)
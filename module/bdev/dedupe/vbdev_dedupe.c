@@ -0,0 +1,1826 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * Deduplicating virtual bdev. The blocks of the dedupe vbdev are 4 KiB chunks of data stored
+ * once on the base bdev, however many blocks hold the same data. A block is written to a new
+ * chunk only if no chunk holds its data already, otherwise it just takes a reference on the
+ * existing one.
+ *
+ * Chunks are found by their fingerprint, made of the CRC-32C of both halves of the data,
+ * computed on the thread the write was submitted on with the CRC-32C implementation of
+ * lib/util (ISA-L or SSE4.2). A matching fingerprint is only a hint: the data of the chunk is
+ * read back and compared before it is shared. When these reads get slower than the latency
+ * budget, duplicates are written as unique chunks instead, which costs capacity but not
+ * latency, and only a few of them are still verified to follow the latency of the base bdev.
+ *
+ * All the metadata is owned by a single SPDK thread, which processes the writes, unmaps and
+ * flushes, as the fingerprint index is shared by all the blocks. They are forwarded to that
+ * thread and completed back on the thread they were submitted on. Reads only look the map up
+ * and are served by the thread they were submitted on: a reader is counted in the chunk before
+ * checking that the map still points to it, and the metadata thread does not reuse a chunk
+ * still being read.
+ *
+ * Layout of the base bdev, in 4 KiB units:
+ *   - superblock,
+ *   - map, the chunk of each block plus one, 0 for blocks that were never written, unmapped
+ *     or written with zeroes,
+ *   - fingerprint of each chunk,
+ *   - data of the chunks.
+ *
+ * The reference counts of the chunks are not persisted, they are rebuilt from the map when
+ * the dedupe vbdev is created again. The data and the fingerprint of a new chunk are
+ * written before the map points to it, and a chunk is only released once the map does not
+ * point to it anymore on the base bdev, so the map always points to valid chunks.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "vbdev_dedupe.h"
+#include "spdk/crc32.h"
+#include "spdk/env.h"
+#include "spdk/json.h"
+#include "spdk/likely.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+#include "spdk_internal/vbdev_md.h"
+
+/* Namespace of the UUIDs generated from the UUID of the base bdev, fixed once and for all: the
+ * dedupe vbdevs would get another UUID if it changed.
+ */
+#define BDEV_DEDUPE_NAMESPACE_UUID "72501617-ba7a-478b-8e99-d91bcfab7b29"
+
+#define DEDUPE_SB_SIGNATURE		"SPDKDDUP"
+#define DEDUPE_SB_VERSION		1
+
+/* Size of the blocks of the dedupe vbdev, of the chunks and of the metadata blocks */
+#define DEDUPE_CHUNK_SIZE		0x1000
+#define DEDUPE_MAP_ENTRIES_PER_BLOCK	(DEDUPE_CHUNK_SIZE / sizeof(uint32_t))
+#define DEDUPE_FPS_PER_BLOCK		(DEDUPE_CHUNK_SIZE / sizeof(uint64_t))
+#define DEDUPE_CHUNKS_MAX		(1u << 30)
+#define DEDUPE_CHUNK_NONE		UINT32_MAX
+
+#define DEDUPE_LATENCY_BUDGET_US_DEFAULT	500
+/* Weight of a new sample in the average verification latency, as a shift */
+#define DEDUPE_LATENCY_EWMA_SHIFT	3
+/* Over the latency budget, one candidate out of this many is still verified */
+#define DEDUPE_VERIFY_PROBE_INTERVAL	16
+/* Maximum number of verifications in progress */
+#define DEDUPE_VERIFY_QD		16
+
+#define DEDUPE_UNMAP_BLOCKS_MAX		64
+/* Size of the I/Os loading and initializing the metadata, in metadata blocks */
+#define DEDUPE_MD_IO_BLOCKS		256
+#define DEDUPE_STOP_POLL_PERIOD_US	100
+
+SPDK_STATIC_ASSERT(DEDUPE_UNMAP_BLOCKS_MAX <= DEDUPE_MAP_ENTRIES_PER_BLOCK,
+		   "an unmap must not span more than two metadata blocks");
+
+struct dedupe_sb {
+	uint8_t			signature[8];
+	uint32_t		version;
+	/* CRC32C of the superblock, computed with this field set to 0 */
+	uint32_t		crc;
+	struct spdk_uuid	uuid;
+	uint32_t		chunk_size;
+	uint32_t		reserved;
+	uint64_t		num_blocks;
+	uint64_t		num_chunks;
+	/* Offsets in chunks, the fingerprints follow the map */
+	uint64_t		map_offset;
+	uint64_t		fp_offset;
+	uint64_t		data_offset;
+};
+SPDK_STATIC_ASSERT(sizeof(struct dedupe_sb) <= DEDUPE_CHUNK_SIZE, "superblock too big");
+
+struct dedupe_stats {
+	uint64_t	unique_writes;
+	uint64_t	duplicate_writes;
+	uint64_t	zero_writes;
+	/* Candidates whose data differed from the block written despite the same fingerprint */
+	uint64_t	verify_mismatches;
+	/* Candidates written as unique chunks without verification */
+	uint64_t	verify_skips;
+};
+
+struct dedupe_create_ctx;
+
+struct vbdev_dedupe {
+	struct spdk_bdev			bdev;
+	struct spdk_bdev			*base_bdev;
+	struct spdk_bdev_desc			*base_desc;
+	/* Thread the base bdev was opened on */
+	struct spdk_thread			*thread;
+	/* Thread owning the metadata */
+	struct spdk_thread			*md_thread;
+	struct spdk_io_channel			*base_ch;
+	struct spdk_poller			*stop_poller;
+	int					start_status;
+
+	/* Number of base blocks per chunk */
+	uint32_t				chunk_base_blocks;
+	size_t					buf_align;
+	uint64_t				num_chunks;
+	uint64_t				map_offset;
+	uint64_t				fp_offset;
+	uint64_t				data_offset;
+
+	/* Image of the map and of the fingerprints on the base bdev */
+	void					*md;
+	uint32_t				*map;
+	uint64_t				*fps;
+	struct vbdev_md_writer			md_writer;
+
+	/* References of the map and of the writes in progress on each chunk */
+	uint32_t				*refs;
+	/* Number of reads in progress on each chunk, updated by the submitting threads */
+	uint32_t				*readers;
+	uint64_t				num_used_chunks;
+	uint64_t				num_mapped_blocks;
+	uint64_t				alloc_cursor;
+
+	/* Open addressing hash of the chunks by fingerprint, each slot holds a chunk plus one */
+	uint32_t				*index;
+	uint64_t				index_mask;
+
+	void					*verify_bufs;
+	void					*free_verify_bufs[DEDUPE_VERIFY_QD];
+	uint32_t				num_free_verify_bufs;
+	uint32_t				latency_budget_us;
+	uint64_t				latency_budget_ticks;
+	/* Average latency of the verification reads */
+	uint64_t				verify_ticks;
+	uint64_t				verify_skip_count;
+	struct dedupe_stats			stats;
+
+	struct dedupe_create_ctx		*create_ctx;
+	void					(*stop_cb)(struct vbdev_dedupe *dedupe);
+	bool					base_claimed;
+	TAILQ_ENTRY(vbdev_dedupe)		link;
+};
+
+struct dedupe_io_channel {
+	struct spdk_io_channel			*base_ch;
+};
+
+struct dedupe_bdev_io {
+	struct vbdev_dedupe			*dedupe;
+	/* Fingerprint of the data written, unused if zero is set */
+	uint64_t				fp;
+	bool					zero;
+	/* Chunk the I/O holds a reference on, read or written by it */
+	uint32_t				pinned;
+	uint32_t				num_outstanding;
+	/* Map entries replaced by the I/O, released once the map has been persisted */
+	uint32_t				num_old_entries;
+	uint32_t				old_entries[DEDUPE_UNMAP_BLOCKS_MAX];
+	void					*verify_buf;
+	uint64_t				verify_tsc;
+	enum spdk_bdev_io_status		status;
+	void (*retry_fn)(struct dedupe_bdev_io *io);
+	struct spdk_bdev_io_wait_entry		bdev_io_wait;
+	struct vbdev_md_waiter			md_waiters[2];
+};
+
+struct dedupe_create_ctx {
+	struct vbdev_dedupe			*dedupe;
+	vbdev_dedupe_create_cb			cb_fn;
+	void					*cb_arg;
+	struct spdk_io_channel			*ch;
+	struct dedupe_sb			*sb;
+	/* The metadata is loaded from the base bdev instead of initialized */
+	bool					load;
+	/* The metadata is being written, after its initialization or its load */
+	bool					write_md;
+	/* Next metadata block to read or write */
+	uint64_t				md_idx;
+	/* UUID of a new dedupe vbdev if none was given */
+	struct spdk_uuid			uuid;
+	int					status;
+};
+
+static int vbdev_dedupe_init(void);
+static int vbdev_dedupe_get_ctx_size(void);
+static int vbdev_dedupe_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module dedupe_if = {
+	.name = "dedupe",
+	.module_init = vbdev_dedupe_init,
+	.get_ctx_size = vbdev_dedupe_get_ctx_size,
+	.config_json = vbdev_dedupe_config_json,
+};
+
+SPDK_BDEV_MODULE_REGISTER(dedupe, &dedupe_if)
+
+static TAILQ_HEAD(, vbdev_dedupe) g_dedupe_nodes = TAILQ_HEAD_INITIALIZER(g_dedupe_nodes);
+
+static void dedupe_io_process(struct dedupe_bdev_io *io);
+
+static inline uint64_t
+dedupe_chunk_offset(struct vbdev_dedupe *dedupe, uint32_t chunk)
+{
+	return (dedupe->data_offset + chunk) * dedupe->chunk_base_blocks;
+}
+
+static inline uint64_t
+dedupe_map_md_blocks(uint64_t num_blocks)
+{
+	return spdk_divide_round_up(num_blocks, DEDUPE_MAP_ENTRIES_PER_BLOCK);
+}
+
+static inline uint64_t
+dedupe_fp_md_blocks(uint64_t num_chunks)
+{
+	return spdk_divide_round_up(num_chunks, DEDUPE_FPS_PER_BLOCK);
+}
+
+/*
+ * Fingerprint of the data of a block: the CRC-32C of its first half in the upper 32 bits
+ * and the one of its second half in the lower 32 bits.
+ */
+static uint64_t
+dedupe_fingerprint(struct iovec *iovs, int iovcnt)
+{
+	const size_t half = DEDUPE_CHUNK_SIZE / 2;
+	uint32_t crc[2] = { ~0u, ~0u };
+	size_t offset = 0, len, rem;
+	uint8_t *buf;
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		buf = iovs[i].iov_base;
+		rem = iovs[i].iov_len;
+		while (rem > 0 && offset < DEDUPE_CHUNK_SIZE) {
+			len = spdk_min(rem, half - offset % half);
+			crc[offset / half] = spdk_crc32c_update(buf, len, crc[offset / half]);
+			buf += len;
+			rem -= len;
+			offset += len;
+		}
+	}
+
+	return ((uint64_t)crc[0] << 32) | crc[1];
+}
+
+static bool
+dedupe_iovs_all_zero(struct iovec *iovs, int iovcnt)
+{
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		if (!spdk_mem_all_zero(iovs[i].iov_base, iovs[i].iov_len)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool
+dedupe_iovs_equal(struct iovec *iovs, int iovcnt, const uint8_t *buf)
+{
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		if (memcmp(iovs[i].iov_base, buf, iovs[i].iov_len) != 0) {
+			return false;
+		}
+		buf += iovs[i].iov_len;
+	}
+
+	return true;
+}
+
+static inline uint64_t
+dedupe_index_slot(struct vbdev_dedupe *dedupe, uint64_t fp)
+{
+	return (fp ^ (fp >> 32)) & dedupe->index_mask;
+}
+
+static uint32_t
+dedupe_index_lookup(struct vbdev_dedupe *dedupe, uint64_t fp)
+{
+	uint64_t slot = dedupe_index_slot(dedupe, fp);
+	uint32_t entry;
+
+	while ((entry = dedupe->index[slot]) != 0) {
+		if (dedupe->fps[entry - 1] == fp) {
+			return entry - 1;
+		}
+		slot = (slot + 1) & dedupe->index_mask;
+	}
+
+	return DEDUPE_CHUNK_NONE;
+}
+
+/* Only one chunk is indexed per fingerprint, the others are not shared */
+static void
+dedupe_index_insert(struct vbdev_dedupe *dedupe, uint32_t chunk)
+{
+	uint64_t fp = dedupe->fps[chunk];
+	uint64_t slot = dedupe_index_slot(dedupe, fp);
+	uint32_t entry;
+
+	while ((entry = dedupe->index[slot]) != 0) {
+		if (dedupe->fps[entry - 1] == fp) {
+			return;
+		}
+		slot = (slot + 1) & dedupe->index_mask;
+	}
+
+	dedupe->index[slot] = chunk + 1;
+}
+
+static void
+dedupe_index_remove(struct vbdev_dedupe *dedupe, uint32_t chunk)
+{
+	uint64_t slot = dedupe_index_slot(dedupe, dedupe->fps[chunk]);
+	uint64_t next, home;
+	uint32_t entry;
+
+	while ((entry = dedupe->index[slot]) != chunk + 1) {
+		if (entry == 0) {
+			return;
+		}
+		slot = (slot + 1) & dedupe->index_mask;
+	}
+
+	/* Shift back the following entries that would not be found past the hole anymore */
+	next = slot;
+	for (;;) {
+		next = (next + 1) & dedupe->index_mask;
+		entry = dedupe->index[next];
+		if (entry == 0) {
+			break;
+		}
+		home = dedupe_index_slot(dedupe, dedupe->fps[entry - 1]);
+		if (((next - home) & dedupe->index_mask) < ((next - slot) & dedupe->index_mask)) {
+			continue;
+		}
+		dedupe->index[slot] = entry;
+		slot = next;
+	}
+
+	dedupe->index[slot] = 0;
+}
+
+static uint32_t
+dedupe_chunk_alloc(struct vbdev_dedupe *dedupe)
+{
+	uint64_t i;
+	uint32_t chunk;
+
+	if (dedupe->num_used_chunks == dedupe->num_chunks) {
+		return DEDUPE_CHUNK_NONE;
+	}
+
+	for (i = 0; i < dedupe->num_chunks; i++) {
+		chunk = (dedupe->alloc_cursor + i) % dedupe->num_chunks;
+		if (dedupe->refs[chunk] == 0 &&
+		    __atomic_load_n(&dedupe->readers[chunk], __ATOMIC_SEQ_CST) == 0) {
+			dedupe->alloc_cursor = chunk + 1;
+			dedupe->refs[chunk] = 1;
+			dedupe->num_used_chunks++;
+			return chunk;
+		}
+	}
+
+	/* The free chunks left are still being read */
+	return DEDUPE_CHUNK_NONE;
+}
+
+static void
+dedupe_chunk_put(struct vbdev_dedupe *dedupe, uint32_t chunk)
+{
+	assert(dedupe->refs[chunk] > 0);
+	if (--dedupe->refs[chunk] == 0) {
+		dedupe_index_remove(dedupe, chunk);
+		dedupe->num_used_chunks--;
+	}
+}
+
+/* Map a block to a map entry and return the previous one */
+static uint32_t
+dedupe_map_set(struct vbdev_dedupe *dedupe, uint64_t offset_blocks, uint32_t entry)
+{
+	uint32_t old = dedupe->map[offset_blocks];
+
+	__atomic_store_n(&dedupe->map[offset_blocks], entry, __ATOMIC_SEQ_CST);
+	if (old == 0 && entry != 0) {
+		dedupe->num_mapped_blocks++;
+	} else if (old != 0 && entry == 0) {
+		dedupe->num_mapped_blocks--;
+	}
+
+	return old;
+}
+
+/* Write a metadata block, after it has been updated */
+static void
+dedupe_md_persist(struct dedupe_bdev_io *io, uint64_t idx, struct vbdev_md_waiter *waiter,
+		  void (*cb_fn)(struct vbdev_md_waiter *waiter, int status))
+{
+	vbdev_md_persist(&io->dedupe->md_writer, idx, waiter, cb_fn, io);
+}
+
+static inline uint64_t
+dedupe_map_md_block(uint64_t offset_blocks)
+{
+	return offset_blocks / DEDUPE_MAP_ENTRIES_PER_BLOCK;
+}
+
+static inline uint64_t
+dedupe_fp_md_block(struct vbdev_dedupe *dedupe, uint32_t chunk)
+{
+	return dedupe->fp_offset - dedupe->map_offset + chunk / DEDUPE_FPS_PER_BLOCK;
+}
+
+static void
+dedupe_put_verify_buf(struct vbdev_dedupe *dedupe, void *buf)
+{
+	assert(dedupe->num_free_verify_bufs < DEDUPE_VERIFY_QD);
+	dedupe->free_verify_bufs[dedupe->num_free_verify_bufs++] = buf;
+}
+
+static void
+_dedupe_io_complete(void *ctx)
+{
+	struct dedupe_bdev_io *io = ctx;
+
+	spdk_bdev_io_complete(spdk_bdev_io_from_ctx(io), io->status);
+}
+
+/* Release everything held by the I/O and complete it on the thread it was submitted on */
+static void
+dedupe_io_finish(struct dedupe_bdev_io *io, enum spdk_bdev_io_status status)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct spdk_thread *thread = spdk_bdev_io_get_thread(bdev_io);
+
+	if (io->pinned != DEDUPE_CHUNK_NONE) {
+		dedupe_chunk_put(io->dedupe, io->pinned);
+		io->pinned = DEDUPE_CHUNK_NONE;
+	}
+	if (io->verify_buf != NULL) {
+		dedupe_put_verify_buf(io->dedupe, io->verify_buf);
+		io->verify_buf = NULL;
+	}
+
+	io->status = status;
+	if (thread == spdk_get_thread()) {
+		spdk_bdev_io_complete(bdev_io, status);
+	} else {
+		spdk_thread_send_msg(thread, _dedupe_io_complete, io);
+	}
+}
+
+static void
+_dedupe_io_retry(void *arg)
+{
+	struct dedupe_bdev_io *io = arg;
+
+	io->retry_fn(io);
+}
+
+/* Handle the return code of the submission of a base I/O, cb_fn is called if it failed */
+static void
+dedupe_io_submitted(struct dedupe_bdev_io *io, int rc, struct spdk_io_channel *ch,
+		    void (*retry_fn)(struct dedupe_bdev_io *io), spdk_bdev_io_completion_cb cb_fn)
+{
+	struct vbdev_dedupe *dedupe = io->dedupe;
+
+	if (spdk_likely(rc == 0)) {
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		io->retry_fn = retry_fn;
+		io->bdev_io_wait.bdev = dedupe->base_bdev;
+		io->bdev_io_wait.cb_fn = _dedupe_io_retry;
+		io->bdev_io_wait.cb_arg = io;
+		rc = spdk_bdev_queue_io_wait(dedupe->base_bdev, ch, &io->bdev_io_wait);
+		if (rc == 0) {
+			return;
+		}
+	}
+
+	SPDK_ERRLOG("Failed to submit an I/O to %s: %s\n", spdk_bdev_get_name(dedupe->base_bdev),
+		    spdk_strerror(-rc));
+	cb_fn(NULL, false, io);
+}
+
+static void
+dedupe_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedupe_bdev_io *io = cb_arg;
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+
+	dedupe_io_finish(io, success ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+dedupe_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedupe_bdev_io *io = cb_arg;
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+
+	__atomic_fetch_sub(&io->dedupe->readers[io->pinned], 1, __ATOMIC_SEQ_CST);
+	spdk_bdev_io_complete(spdk_bdev_io_from_ctx(io), success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+dedupe_read_chunk(struct dedupe_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct spdk_io_channel *ch = spdk_bdev_io_get_io_channel(bdev_io);
+	struct dedupe_io_channel *dedupe_ch = spdk_io_channel_get_ctx(ch);
+	struct vbdev_dedupe *dedupe = io->dedupe;
+	int rc;
+
+	rc = spdk_bdev_readv_blocks(dedupe->base_desc, dedupe_ch->base_ch, bdev_io->u.bdev.iovs,
+				    bdev_io->u.bdev.iovcnt, dedupe_chunk_offset(dedupe, io->pinned),
+				    dedupe->chunk_base_blocks, dedupe_read_done, io);
+	dedupe_io_submitted(io, rc, dedupe_ch->base_ch, dedupe_read_chunk, dedupe_read_done);
+}
+
+/* Read a block on the thread it was submitted on */
+static void
+dedupe_read(struct dedupe_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct vbdev_dedupe *dedupe = io->dedupe;
+	uint32_t *entry = &dedupe->map[bdev_io->u.bdev.offset_blocks];
+	uint32_t chunk, mapped = __atomic_load_n(entry, __ATOMIC_SEQ_CST);
+
+	do {
+		if (mapped == 0) {
+			spdk_iov_memset(bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt, 0);
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+			return;
+		}
+
+		/* Keep the chunk from being reused while it is read, if the block still maps to it */
+		chunk = mapped - 1;
+		__atomic_fetch_add(&dedupe->readers[chunk], 1, __ATOMIC_SEQ_CST);
+		mapped = __atomic_load_n(entry, __ATOMIC_SEQ_CST);
+		if (mapped == chunk + 1) {
+			break;
+		}
+		__atomic_fetch_sub(&dedupe->readers[chunk], 1, __ATOMIC_SEQ_CST);
+	} while (true);
+
+	io->pinned = chunk;
+	dedupe_read_chunk(io);
+}
+
+static void
+dedupe_map_persisted(struct vbdev_md_waiter *waiter, int status)
+{
+	struct dedupe_bdev_io *io = waiter->ctx;
+	uint32_t i;
+
+	if (status != 0) {
+		io->status = SPDK_BDEV_IO_STATUS_FAILED;
+	}
+
+	assert(io->num_outstanding > 0);
+	if (--io->num_outstanding > 0) {
+		return;
+	}
+
+	/* The map on the base bdev may still point to the old chunks if it could not be written */
+	if (io->status == SPDK_BDEV_IO_STATUS_SUCCESS) {
+		for (i = 0; i < io->num_old_entries; i++) {
+			dedupe_chunk_put(io->dedupe, io->old_entries[i] - 1);
+		}
+	}
+
+	dedupe_io_finish(io, io->status);
+}
+
+/* Map the block written by the I/O to a chunk, the reference of the I/O on it goes to the map */
+static void
+dedupe_write_commit(struct dedupe_bdev_io *io, uint32_t entry)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct vbdev_dedupe *dedupe = io->dedupe;
+	uint64_t offset_blocks = bdev_io->u.bdev.offset_blocks;
+	uint32_t old;
+
+	io->pinned = DEDUPE_CHUNK_NONE;
+	old = dedupe_map_set(dedupe, offset_blocks, entry);
+	if (old == entry) {
+		/* Same data written again, drop the extra reference */
+		if (old != 0) {
+			dedupe_chunk_put(dedupe, old - 1);
+		}
+		dedupe_io_finish(io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	if (old != 0) {
+		io->old_entries[io->num_old_entries++] = old;
+	}
+	io->num_outstanding = 1;
+	dedupe_md_persist(io, dedupe_map_md_block(offset_blocks), &io->md_waiters[0],
+			  dedupe_map_persisted);
+}
+
+static void
+dedupe_write_unique_done(struct dedupe_bdev_io *io)
+{
+	struct vbdev_dedupe *dedupe = io->dedupe;
+
+	assert(io->num_outstanding > 0);
+	if (--io->num_outstanding > 0) {
+		return;
+	}
+
+	if (io->status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		dedupe_io_finish(io, io->status);
+		return;
+	}
+
+	dedupe->stats.unique_writes++;
+	dedupe_index_insert(dedupe, io->pinned);
+	dedupe_write_commit(io, io->pinned + 1);
+}
+
+static void
+dedupe_write_fp_done(struct vbdev_md_waiter *waiter, int status)
+{
+	struct dedupe_bdev_io *io = waiter->ctx;
+
+	if (status != 0) {
+		io->status = SPDK_BDEV_IO_STATUS_FAILED;
+	}
+
+	dedupe_write_unique_done(io);
+}
+
+static void
+dedupe_write_data_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedupe_bdev_io *io = cb_arg;
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+
+	if (!success) {
+		io->status = SPDK_BDEV_IO_STATUS_FAILED;
+	}
+
+	dedupe_write_unique_done(io);
+}
+
+static void
+dedupe_write_data(struct dedupe_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct vbdev_dedupe *dedupe = io->dedupe;
+	int rc;
+
+	rc = spdk_bdev_writev_blocks(dedupe->base_desc, dedupe->base_ch, bdev_io->u.bdev.iovs,
+				     bdev_io->u.bdev.iovcnt, dedupe_chunk_offset(dedupe, io->pinned),
+				     dedupe->chunk_base_blocks, dedupe_write_data_done, io);
+	dedupe_io_submitted(io, rc, dedupe->base_ch, dedupe_write_data, dedupe_write_data_done);
+}
+
+/* Write the data to a new chunk, its fingerprint is written at the same time */
+static void
+dedupe_write_unique(struct dedupe_bdev_io *io)
+{
+	struct vbdev_dedupe *dedupe = io->dedupe;
+	uint32_t chunk;
+
+	chunk = dedupe_chunk_alloc(dedupe);
+	if (chunk == DEDUPE_CHUNK_NONE) {
+		SPDK_ERRLOG("%s: no free chunk left on %s\n", dedupe->bdev.name,
+			    spdk_bdev_get_name(dedupe->base_bdev));
+		dedupe_io_finish(io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	io->pinned = chunk;
+	dedupe->fps[chunk] = io->fp;
+	io->num_outstanding = 2;
+	dedupe_md_persist(io, dedupe_fp_md_block(dedupe, chunk), &io->md_waiters[0],
+			  dedupe_write_fp_done);
+	dedupe_write_data(io);
+}
+
+static void
+dedupe_verify_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedupe_bdev_io *io = cb_arg;
+	struct spdk_bdev_io *orig_io = spdk_bdev_io_from_ctx(io);
+	struct vbdev_dedupe *dedupe = io->dedupe;
+	int64_t ticks;
+	bool equal;
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+
+	if (success) {
+		/* Exponentially weighted moving average of the latency of the verifications */
+		ticks = spdk_get_ticks() - io->verify_tsc;
+		dedupe->verify_ticks += (ticks - (int64_t)dedupe->verify_ticks) >>
+					DEDUPE_LATENCY_EWMA_SHIFT;
+	}
+
+	equal = success && dedupe_iovs_equal(orig_io->u.bdev.iovs, orig_io->u.bdev.iovcnt,
+					     io->verify_buf);
+	dedupe_put_verify_buf(dedupe, io->verify_buf);
+	io->verify_buf = NULL;
+
+	if (equal) {
+		dedupe->stats.duplicate_writes++;
+		dedupe_write_commit(io, io->pinned + 1);
+		return;
+	}
+
+	/* Not a duplicate after all, or it could not be verified */
+	if (success) {
+		dedupe->stats.verify_mismatches++;
+	}
+	dedupe_chunk_put(dedupe, io->pinned);
+	io->pinned = DEDUPE_CHUNK_NONE;
+	dedupe_write_unique(io);
+}
+
+static void
+dedupe_verify_read(struct dedupe_bdev_io *io)
+{
+	struct vbdev_dedupe *dedupe = io->dedupe;
+	int rc;
+
+	rc = spdk_bdev_read_blocks(dedupe->base_desc, dedupe->base_ch, io->verify_buf,
+				   dedupe_chunk_offset(dedupe, io->pinned), dedupe->chunk_base_blocks,
+				   dedupe_verify_done, io);
+	dedupe_io_submitted(io, rc, dedupe->base_ch, dedupe_verify_read, dedupe_verify_done);
+}
+
+/* Decide whether a candidate duplicate is verified, or its block written as a unique chunk */
+static bool
+dedupe_verify_allowed(struct vbdev_dedupe *dedupe)
+{
+	if (dedupe->num_free_verify_bufs == 0) {
+		return false;
+	}
+
+	if (dedupe->latency_budget_ticks == 0 ||
+	    dedupe->verify_ticks <= dedupe->latency_budget_ticks) {
+		return true;
+	}
+
+	/* Keep measuring the latency, so that deduplication resumes once it is back in budget */
+	return ++dedupe->verify_skip_count % DEDUPE_VERIFY_PROBE_INTERVAL == 0;
+}
+
+static void
+dedupe_process_write(struct dedupe_bdev_io *io)
+{
+	struct vbdev_dedupe *dedupe = io->dedupe;
+	uint32_t chunk;
+
+	if (io->zero) {
+		dedupe->stats.zero_writes++;
+		dedupe_write_commit(io, 0);
+		return;
+	}
+
+	chunk = dedupe_index_lookup(dedupe, io->fp);
+	if (chunk == DEDUPE_CHUNK_NONE) {
+		dedupe_write_unique(io);
+		return;
+	}
+
+	if (!dedupe_verify_allowed(dedupe)) {
+		dedupe->stats.verify_skips++;
+		dedupe_write_unique(io);
+		return;
+	}
+
+	/* Keep the candidate from being reused while it is verified */
+	io->pinned = chunk;
+	dedupe->refs[chunk]++;
+	io->verify_buf = dedupe->free_verify_bufs[--dedupe->num_free_verify_bufs];
+	io->verify_tsc = spdk_get_ticks();
+	dedupe_verify_read(io);
+}
+
+/* Unmapped blocks and blocks written with zeroes do not use any chunk */
+static void
+dedupe_process_unmap(struct dedupe_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct vbdev_dedupe *dedupe = io->dedupe;
+	uint64_t offset_blocks = bdev_io->u.bdev.offset_blocks;
+	uint64_t num_blocks = bdev_io->u.bdev.num_blocks;
+	uint64_t first, last, i;
+	uint32_t old;
+
+	assert(num_blocks > 0 && num_blocks <= DEDUPE_UNMAP_BLOCKS_MAX);
+
+	for (i = 0; i < num_blocks; i++) {
+		old = dedupe_map_set(dedupe, offset_blocks + i, 0);
+		if (old != 0) {
+			io->old_entries[io->num_old_entries++] = old;
+		}
+	}
+
+	if (io->num_old_entries == 0) {
+		dedupe_io_finish(io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	first = dedupe_map_md_block(offset_blocks);
+	last = dedupe_map_md_block(offset_blocks + num_blocks - 1);
+	io->num_outstanding = last - first + 1;
+	for (i = first; i <= last; i++) {
+		dedupe_md_persist(io, i, &io->md_waiters[i - first], dedupe_map_persisted);
+	}
+}
+
+/* The metadata of the completed writes is already on the base bdev, only its cache is flushed */
+static void
+dedupe_process_flush(struct dedupe_bdev_io *io)
+{
+	struct vbdev_dedupe *dedupe = io->dedupe;
+	int rc;
+
+	rc = spdk_bdev_flush_blocks(dedupe->base_desc, dedupe->base_ch, 0,
+				    spdk_bdev_get_num_blocks(dedupe->base_bdev), dedupe_io_done, io);
+	dedupe_io_submitted(io, rc, dedupe->base_ch, dedupe_process_flush, dedupe_io_done);
+}
+
+static void
+dedupe_io_process(struct dedupe_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		dedupe_process_write(io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		dedupe_process_unmap(io);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		dedupe_process_flush(io);
+		break;
+	default:
+		assert(false);
+		dedupe_io_finish(io, SPDK_BDEV_IO_STATUS_FAILED);
+		break;
+	}
+}
+
+static void
+_dedupe_io_process(void *ctx)
+{
+	dedupe_io_process(ctx);
+}
+
+static void
+dedupe_io_submit_to_md_thread(struct vbdev_dedupe *dedupe, struct dedupe_bdev_io *io)
+{
+	if (dedupe->md_thread == spdk_get_thread()) {
+		dedupe_io_process(io);
+	} else {
+		spdk_thread_send_msg(dedupe->md_thread, _dedupe_io_process, io);
+	}
+}
+
+static void
+dedupe_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	dedupe_read((struct dedupe_bdev_io *)bdev_io->driver_ctx);
+}
+
+static void
+vbdev_dedupe_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_dedupe *dedupe = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_dedupe, bdev);
+	struct dedupe_bdev_io *io = (struct dedupe_bdev_io *)bdev_io->driver_ctx;
+
+	memset(io, 0, offsetof(struct dedupe_bdev_io, old_entries));
+	io->dedupe = dedupe;
+	io->pinned = DEDUPE_CHUNK_NONE;
+	io->verify_buf = NULL;
+	io->status = SPDK_BDEV_IO_STATUS_SUCCESS;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, dedupe_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		return;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		/* Fingerprint the data here to spread the cost over the submitting threads */
+		io->zero = dedupe_iovs_all_zero(bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt);
+		if (!io->zero) {
+			io->fp = dedupe_fingerprint(bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt);
+		}
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		break;
+	default:
+		SPDK_ERRLOG("dedupe: unknown I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	dedupe_io_submit_to_md_thread(dedupe, io);
+}
+
+static bool
+vbdev_dedupe_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_dedupe *dedupe = ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		return true;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		return spdk_bdev_io_type_supported(dedupe->base_bdev, io_type);
+	default:
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_dedupe_get_io_channel(void *ctx)
+{
+	return spdk_get_io_channel(ctx);
+}
+
+static int
+dedupe_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct vbdev_dedupe *dedupe = io_device;
+	struct dedupe_io_channel *dedupe_ch = ctx_buf;
+
+	dedupe_ch->base_ch = spdk_bdev_get_io_channel(dedupe->base_desc);
+	if (dedupe_ch->base_ch == NULL) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+dedupe_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct dedupe_io_channel *dedupe_ch = ctx_buf;
+
+	spdk_put_io_channel(dedupe_ch->base_ch);
+}
+
+static void
+dedupe_thread_stopped(void *ctx)
+{
+	struct vbdev_dedupe *dedupe = ctx;
+
+	dedupe->md_thread = NULL;
+	dedupe->stop_cb(dedupe);
+}
+
+static void
+_dedupe_thread_stop(struct vbdev_dedupe *dedupe)
+{
+	if (dedupe->base_ch != NULL) {
+		spdk_put_io_channel(dedupe->base_ch);
+		dedupe->base_ch = NULL;
+	}
+
+	spdk_thread_exit(dedupe->md_thread);
+	spdk_thread_send_msg(dedupe->thread, dedupe_thread_stopped, dedupe);
+}
+
+static int
+dedupe_thread_stop_poll(void *arg)
+{
+	struct vbdev_dedupe *dedupe = arg;
+
+	if (dedupe->md_writer.num_writes > 0) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	spdk_poller_unregister(&dedupe->stop_poller);
+	_dedupe_thread_stop(dedupe);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+dedupe_thread_stop(void *ctx)
+{
+	struct vbdev_dedupe *dedupe = ctx;
+
+	if (dedupe->md_writer.num_writes > 0) {
+		dedupe->stop_poller = SPDK_POLLER_REGISTER(dedupe_thread_stop_poll, dedupe,
+				      DEDUPE_STOP_POLL_PERIOD_US);
+		return;
+	}
+
+	_dedupe_thread_stop(dedupe);
+}
+
+/* Stop the metadata thread, must be called on the thread of the dedupe vbdev */
+static void
+dedupe_stop_md_thread(struct vbdev_dedupe *dedupe, void (*cb_fn)(struct vbdev_dedupe *dedupe))
+{
+	assert(dedupe->thread == spdk_get_thread());
+
+	dedupe->stop_cb = cb_fn;
+	if (dedupe->md_thread == NULL) {
+		cb_fn(dedupe);
+		return;
+	}
+
+	spdk_thread_send_msg(dedupe->md_thread, dedupe_thread_stop, dedupe);
+}
+
+static void
+dedupe_close_base_bdev(struct vbdev_dedupe *dedupe)
+{
+	if (dedupe->base_claimed) {
+		spdk_bdev_module_release_bdev(dedupe->base_bdev);
+		dedupe->base_claimed = false;
+	}
+	if (dedupe->base_desc != NULL) {
+		spdk_bdev_close(dedupe->base_desc);
+		dedupe->base_desc = NULL;
+	}
+}
+
+static void
+dedupe_free(struct vbdev_dedupe *dedupe)
+{
+	dedupe_close_base_bdev(dedupe);
+
+	spdk_free(dedupe->md);
+	spdk_free(dedupe->verify_bufs);
+	vbdev_md_writer_fini(&dedupe->md_writer);
+	free(dedupe->refs);
+	free(dedupe->readers);
+	free(dedupe->index);
+	free(dedupe->bdev.name);
+	free(dedupe);
+}
+
+static int
+dedupe_alloc_md(struct vbdev_dedupe *dedupe)
+{
+	uint64_t map_md_blocks = dedupe->fp_offset - dedupe->map_offset;
+	uint64_t num_md_blocks = map_md_blocks + dedupe_fp_md_blocks(dedupe->num_chunks);
+	uint64_t i;
+
+	dedupe->md = spdk_zmalloc(num_md_blocks * DEDUPE_CHUNK_SIZE, dedupe->buf_align,
+				  NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	dedupe->refs = calloc(dedupe->num_chunks, sizeof(*dedupe->refs));
+	dedupe->readers = calloc(dedupe->num_chunks, sizeof(*dedupe->readers));
+	dedupe->index_mask = spdk_align64pow2(dedupe->num_chunks * 2) - 1;
+	dedupe->index = calloc(dedupe->index_mask + 1, sizeof(*dedupe->index));
+	dedupe->verify_bufs = spdk_zmalloc(DEDUPE_VERIFY_QD * DEDUPE_CHUNK_SIZE, dedupe->buf_align,
+					   NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (dedupe->md == NULL || dedupe->refs == NULL || dedupe->readers == NULL ||
+	    dedupe->index == NULL ||
+	    dedupe->verify_bufs == NULL ||
+	    vbdev_md_writer_init(&dedupe->md_writer, num_md_blocks) != 0) {
+		return -ENOMEM;
+	}
+	dedupe->md_writer.name = dedupe->bdev.name;
+	dedupe->md_writer.desc = dedupe->base_desc;
+	dedupe->md_writer.buf = dedupe->md;
+	dedupe->md_writer.block_size = DEDUPE_CHUNK_SIZE;
+	dedupe->md_writer.base_blocks = dedupe->chunk_base_blocks;
+	dedupe->md_writer.offset_blocks = dedupe->map_offset * dedupe->chunk_base_blocks;
+
+	dedupe->map = dedupe->md;
+	dedupe->fps = (uint64_t *)((char *)dedupe->md + map_md_blocks * DEDUPE_CHUNK_SIZE);
+
+	for (i = 0; i < DEDUPE_VERIFY_QD; i++) {
+		dedupe_put_verify_buf(dedupe, (char *)dedupe->verify_bufs + i * DEDUPE_CHUNK_SIZE);
+	}
+
+	return 0;
+}
+
+/* Rebuild the references and the index from the map, returns the number of invalid entries,
+ * which are cleared.
+ */
+static uint64_t
+dedupe_rebuild(struct vbdev_dedupe *dedupe)
+{
+	uint64_t i, num_invalid = 0;
+	uint32_t entry;
+
+	for (i = 0; i < dedupe->bdev.blockcnt; i++) {
+		entry = dedupe->map[i];
+		if (entry == 0) {
+			continue;
+		}
+		if (entry > dedupe->num_chunks) {
+			dedupe->map[i] = 0;
+			num_invalid++;
+			continue;
+		}
+		dedupe->refs[entry - 1]++;
+		dedupe->num_mapped_blocks++;
+	}
+
+	for (i = 0; i < dedupe->num_chunks; i++) {
+		if (dedupe->refs[i] > 0) {
+			dedupe->num_used_chunks++;
+			dedupe_index_insert(dedupe, i);
+		}
+	}
+
+	return num_invalid;
+}
+
+/* Use as much of the base bdev as possible for chunks */
+static int
+dedupe_calc_layout(struct vbdev_dedupe *dedupe, uint64_t num_blocks)
+{
+	uint64_t base_chunks = spdk_bdev_get_num_blocks(dedupe->base_bdev) /
+			       dedupe->chunk_base_blocks;
+	uint64_t chunks, blocks = 0, map_md_blocks = 0, end;
+
+	/* The first chunk holds the superblock */
+	chunks = base_chunks > 1 ? spdk_min(base_chunks - 1, DEDUPE_CHUNKS_MAX) : 0;
+
+	while (chunks > 0) {
+		blocks = num_blocks != 0 ? num_blocks : chunks;
+		map_md_blocks = dedupe_map_md_blocks(blocks);
+		end = 1 + map_md_blocks + dedupe_fp_md_blocks(chunks) + chunks;
+		if (end <= base_chunks) {
+			break;
+		}
+		chunks = chunks > end - base_chunks ? chunks - (end - base_chunks) : 0;
+	}
+
+	if (chunks == 0) {
+		SPDK_ERRLOG("Base bdev %s is too small\n", spdk_bdev_get_name(dedupe->base_bdev));
+		return -ENOSPC;
+	}
+
+	dedupe->bdev.blockcnt = blocks;
+	dedupe->num_chunks = chunks;
+	dedupe->map_offset = 1;
+	dedupe->fp_offset = dedupe->map_offset + map_md_blocks;
+	dedupe->data_offset = dedupe->fp_offset + dedupe_fp_md_blocks(chunks);
+
+	return 0;
+}
+
+static bool
+dedupe_sb_is_valid(struct dedupe_sb *sb)
+{
+	uint32_t crc = sb->crc;
+	bool valid;
+
+	if (memcmp(sb->signature, DEDUPE_SB_SIGNATURE, sizeof(sb->signature)) != 0) {
+		return false;
+	}
+
+	sb->crc = 0;
+	valid = spdk_crc32c_update(sb, sizeof(*sb), 0) == crc;
+	sb->crc = crc;
+
+	return valid && sb->version == DEDUPE_SB_VERSION;
+}
+
+static int
+dedupe_sb_load(struct vbdev_dedupe *dedupe, const struct dedupe_sb *sb)
+{
+	uint64_t base_chunks = spdk_bdev_get_num_blocks(dedupe->base_bdev) /
+			       dedupe->chunk_base_blocks;
+
+	if (sb->chunk_size != DEDUPE_CHUNK_SIZE || sb->num_blocks == 0 ||
+	    sb->num_chunks == 0 || sb->num_chunks > DEDUPE_CHUNKS_MAX || sb->map_offset == 0 ||
+	    sb->fp_offset != sb->map_offset + dedupe_map_md_blocks(sb->num_blocks) ||
+	    sb->data_offset < sb->fp_offset + dedupe_fp_md_blocks(sb->num_chunks) ||
+	    sb->data_offset > base_chunks || sb->num_chunks > base_chunks - sb->data_offset) {
+		SPDK_ERRLOG("Invalid superblock on base bdev %s\n",
+			    spdk_bdev_get_name(dedupe->base_bdev));
+		return -EINVAL;
+	}
+
+	dedupe->bdev.blockcnt = sb->num_blocks;
+	dedupe->num_chunks = sb->num_chunks;
+	dedupe->map_offset = sb->map_offset;
+	dedupe->fp_offset = sb->fp_offset;
+	dedupe->data_offset = sb->data_offset;
+
+	return 0;
+}
+
+static void
+dedupe_create_stopped(struct vbdev_dedupe *dedupe)
+{
+	struct dedupe_create_ctx *ctx = dedupe->create_ctx;
+
+	ctx->cb_fn(ctx->cb_arg, NULL, ctx->status);
+
+	dedupe_free(dedupe);
+	free(ctx);
+}
+
+static void
+dedupe_create_fail(struct dedupe_create_ctx *ctx, int status)
+{
+	ctx->status = status;
+
+	if (ctx->ch != NULL) {
+		spdk_put_io_channel(ctx->ch);
+		ctx->ch = NULL;
+	}
+	spdk_free(ctx->sb);
+	ctx->sb = NULL;
+
+	dedupe_stop_md_thread(ctx->dedupe, dedupe_create_stopped);
+}
+
+static const struct spdk_bdev_fn_table vbdev_dedupe_fn_table;
+
+static void
+dedupe_create_register(struct dedupe_create_ctx *ctx)
+{
+	struct vbdev_dedupe *dedupe = ctx->dedupe;
+	struct spdk_bdev *base_bdev = dedupe->base_bdev;
+	int rc;
+
+	dedupe->bdev.product_name = "dedupe";
+	dedupe->bdev.write_cache = base_bdev->write_cache;
+	dedupe->bdev.required_alignment = base_bdev->required_alignment;
+	dedupe->bdev.optimal_io_boundary = 1;
+	dedupe->bdev.split_on_optimal_io_boundary = true;
+	dedupe->bdev.max_unmap = DEDUPE_UNMAP_BLOCKS_MAX;
+	dedupe->bdev.max_unmap_segments = 1;
+	dedupe->bdev.max_write_zeroes = DEDUPE_UNMAP_BLOCKS_MAX;
+	dedupe->bdev.blocklen = DEDUPE_CHUNK_SIZE;
+	dedupe->bdev.ctxt = dedupe;
+	dedupe->bdev.fn_table = &vbdev_dedupe_fn_table;
+	dedupe->bdev.module = &dedupe_if;
+
+	spdk_io_device_register(dedupe, dedupe_bdev_ch_create_cb, dedupe_bdev_ch_destroy_cb,
+				sizeof(struct dedupe_io_channel), dedupe->bdev.name);
+
+	rc = spdk_bdev_register(&dedupe->bdev);
+	if (rc != 0) {
+		SPDK_ERRLOG("could not register dedupe bdev %s\n", dedupe->bdev.name);
+		spdk_io_device_unregister(dedupe, NULL);
+		dedupe_create_fail(ctx, rc);
+		return;
+	}
+
+	TAILQ_INSERT_TAIL(&g_dedupe_nodes, dedupe, link);
+	dedupe->create_ctx = NULL;
+
+	ctx->cb_fn(ctx->cb_arg, &dedupe->bdev, 0);
+	free(ctx);
+}
+
+static void
+dedupe_create_md_thread_started(void *arg)
+{
+	struct vbdev_dedupe *dedupe = arg;
+	struct dedupe_create_ctx *ctx = dedupe->create_ctx;
+
+	if (dedupe->start_status != 0) {
+		dedupe_create_fail(ctx, dedupe->start_status);
+		return;
+	}
+
+	dedupe_create_register(ctx);
+}
+
+static void
+dedupe_md_thread_start(void *arg)
+{
+	struct vbdev_dedupe *dedupe = arg;
+
+	dedupe->base_ch = spdk_bdev_get_io_channel(dedupe->base_desc);
+	dedupe->md_writer.ch = dedupe->base_ch;
+	if (dedupe->base_ch == NULL) {
+		dedupe->start_status = -ENOMEM;
+	}
+
+	spdk_thread_send_msg(dedupe->thread, dedupe_create_md_thread_started, dedupe);
+}
+
+static void
+dedupe_create_start_md_thread(struct dedupe_create_ctx *ctx)
+{
+	struct vbdev_dedupe *dedupe = ctx->dedupe;
+
+	spdk_put_io_channel(ctx->ch);
+	ctx->ch = NULL;
+	spdk_free(ctx->sb);
+	ctx->sb = NULL;
+
+	dedupe->md_thread = spdk_thread_create(dedupe->bdev.name, NULL);
+	if (dedupe->md_thread == NULL) {
+		SPDK_ERRLOG("Failed to create thread %s\n", dedupe->bdev.name);
+		dedupe_create_fail(ctx, -ENOMEM);
+		return;
+	}
+
+	spdk_thread_send_msg(dedupe->md_thread, dedupe_md_thread_start, dedupe);
+}
+
+static void
+dedupe_create_write_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedupe_create_ctx *ctx = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to write the superblock of %s\n", ctx->dedupe->bdev.name);
+		dedupe_create_fail(ctx, -EIO);
+		return;
+	}
+
+	dedupe_create_start_md_thread(ctx);
+}
+
+static void
+dedupe_create_write_sb(struct dedupe_create_ctx *ctx)
+{
+	struct vbdev_dedupe *dedupe = ctx->dedupe;
+	struct dedupe_sb *sb = ctx->sb;
+	int rc;
+
+	memset(sb, 0, DEDUPE_CHUNK_SIZE);
+	memcpy(sb->signature, DEDUPE_SB_SIGNATURE, sizeof(sb->signature));
+	sb->version = DEDUPE_SB_VERSION;
+	spdk_uuid_copy(&sb->uuid, &dedupe->bdev.uuid);
+	sb->chunk_size = DEDUPE_CHUNK_SIZE;
+	sb->num_blocks = dedupe->bdev.blockcnt;
+	sb->num_chunks = dedupe->num_chunks;
+	sb->map_offset = dedupe->map_offset;
+	sb->fp_offset = dedupe->fp_offset;
+	sb->data_offset = dedupe->data_offset;
+	sb->crc = spdk_crc32c_update(sb, sizeof(*sb), 0);
+
+	rc = spdk_bdev_write_blocks(dedupe->base_desc, ctx->ch, sb, 0, dedupe->chunk_base_blocks,
+				    dedupe_create_write_sb_done, ctx);
+	if (rc != 0) {
+		dedupe_create_fail(ctx, rc);
+	}
+}
+
+static void dedupe_create_md_io(struct dedupe_create_ctx *ctx);
+
+static void
+dedupe_create_md_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedupe_create_ctx *ctx = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to %s the metadata of %s\n", ctx->write_md ? "write" : "read",
+			    ctx->dedupe->bdev.name);
+		dedupe_create_fail(ctx, -EIO);
+		return;
+	}
+
+	ctx->md_idx += spdk_min(DEDUPE_MD_IO_BLOCKS, ctx->dedupe->md_writer.num_blocks - ctx->md_idx);
+	dedupe_create_md_io(ctx);
+}
+
+static void
+dedupe_create_md_done(struct dedupe_create_ctx *ctx)
+{
+	struct vbdev_dedupe *dedupe = ctx->dedupe;
+	uint64_t num_invalid;
+
+	if (ctx->write_md) {
+		/* The metadata is written before the superblock, so that a valid superblock
+		 * never comes with stale metadata.
+		 */
+		if (ctx->load) {
+			dedupe_create_start_md_thread(ctx);
+		} else {
+			dedupe_create_write_sb(ctx);
+		}
+		return;
+	}
+
+	num_invalid = dedupe_rebuild(dedupe);
+	if (num_invalid > 0) {
+		/* Clear the invalid entries on disk too, their chunks may be reused */
+		SPDK_WARNLOG("%s: %" PRIu64 " invalid map entries cleared\n", dedupe->bdev.name,
+			     num_invalid);
+		ctx->write_md = true;
+		ctx->md_idx = 0;
+		dedupe_create_md_io(ctx);
+		return;
+	}
+
+	dedupe_create_start_md_thread(ctx);
+}
+
+/* Read or write the whole metadata, a few blocks at a time */
+static void
+dedupe_create_md_io(struct dedupe_create_ctx *ctx)
+{
+	struct vbdev_dedupe *dedupe = ctx->dedupe;
+	uint64_t num_md_blocks, offset_blocks, num_blocks;
+	void *buf;
+	int rc;
+
+	if (ctx->md_idx == dedupe->md_writer.num_blocks) {
+		dedupe_create_md_done(ctx);
+		return;
+	}
+
+	num_md_blocks = spdk_min(DEDUPE_MD_IO_BLOCKS, dedupe->md_writer.num_blocks - ctx->md_idx);
+	buf = (char *)dedupe->md + ctx->md_idx * DEDUPE_CHUNK_SIZE;
+	offset_blocks = (dedupe->map_offset + ctx->md_idx) * dedupe->chunk_base_blocks;
+	num_blocks = num_md_blocks * dedupe->chunk_base_blocks;
+
+	if (ctx->write_md) {
+		rc = spdk_bdev_write_blocks(dedupe->base_desc, ctx->ch, buf, offset_blocks,
+					    num_blocks, dedupe_create_md_io_done, ctx);
+	} else {
+		rc = spdk_bdev_read_blocks(dedupe->base_desc, ctx->ch, buf, offset_blocks,
+					   num_blocks, dedupe_create_md_io_done, ctx);
+	}
+	if (rc != 0) {
+		dedupe_create_fail(ctx, rc);
+	}
+}
+
+static void
+dedupe_create_read_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedupe_create_ctx *ctx = cb_arg;
+	struct vbdev_dedupe *dedupe = ctx->dedupe;
+	struct dedupe_sb *sb = ctx->sb;
+	uint64_t num_blocks = dedupe->bdev.blockcnt;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to read the superblock of %s\n", dedupe->bdev.name);
+		dedupe_create_fail(ctx, -EIO);
+		return;
+	}
+
+	if (dedupe_sb_is_valid(sb)) {
+		if (!spdk_uuid_is_null(&dedupe->bdev.uuid) &&
+		    spdk_uuid_compare(&sb->uuid, &dedupe->bdev.uuid) != 0) {
+			SPDK_ERRLOG("Base bdev %s holds the data of another dedupe vbdev\n",
+				    spdk_bdev_get_name(dedupe->base_bdev));
+			dedupe_create_fail(ctx, -EEXIST);
+			return;
+		}
+
+		rc = dedupe_sb_load(dedupe, sb);
+		if (rc != 0) {
+			dedupe_create_fail(ctx, rc);
+			return;
+		}
+		if (num_blocks != 0 && num_blocks != sb->num_blocks) {
+			SPDK_NOTICELOG("%s: using the size (%" PRIu64 " blocks) of the existing "
+				       "dedupe vbdev\n", dedupe->bdev.name, sb->num_blocks);
+		}
+		spdk_uuid_copy(&dedupe->bdev.uuid, &sb->uuid);
+		ctx->load = true;
+	} else {
+		rc = dedupe_calc_layout(dedupe, num_blocks);
+		if (rc != 0) {
+			dedupe_create_fail(ctx, rc);
+			return;
+		}
+		if (spdk_uuid_is_null(&dedupe->bdev.uuid)) {
+			spdk_uuid_copy(&dedupe->bdev.uuid, &ctx->uuid);
+		}
+		ctx->write_md = true;
+	}
+
+	rc = dedupe_alloc_md(dedupe);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to allocate the metadata of %s\n", dedupe->bdev.name);
+		dedupe_create_fail(ctx, rc);
+		return;
+	}
+
+	SPDK_DEBUGLOG(vbdev_dedupe, "%s: %" PRIu64 " blocks, %" PRIu64 " chunks at chunk %"
+		      PRIu64 "\n", dedupe->bdev.name, dedupe->bdev.blockcnt, dedupe->num_chunks,
+		      dedupe->data_offset);
+
+	ctx->md_idx = 0;
+	dedupe_create_md_io(ctx);
+}
+
+static void
+dedupe_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+			  void *event_ctx)
+{
+	struct vbdev_dedupe *dedupe, *tmp;
+
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		TAILQ_FOREACH_SAFE(dedupe, &g_dedupe_nodes, link, tmp) {
+			if (dedupe->base_bdev == bdev) {
+				spdk_bdev_unregister(&dedupe->bdev, NULL, NULL);
+			}
+		}
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+void
+vbdev_dedupe_get_default_opts(struct vbdev_dedupe_opts *opts)
+{
+	memset(opts, 0, sizeof(*opts));
+	opts->latency_budget_us = DEDUPE_LATENCY_BUDGET_US_DEFAULT;
+}
+
+int
+vbdev_dedupe_create(const struct vbdev_dedupe_opts *opts, vbdev_dedupe_create_cb cb_fn,
+		    void *cb_arg)
+{
+	struct vbdev_dedupe *dedupe;
+	struct dedupe_create_ctx *ctx;
+	struct spdk_uuid ns_uuid;
+	uint32_t blocklen;
+	int rc;
+
+	if (opts->name == NULL || opts->base_bdev_name == NULL) {
+		return -EINVAL;
+	}
+	if (spdk_bdev_get_by_name(opts->name) != NULL) {
+		SPDK_ERRLOG("Bdev %s already exists\n", opts->name);
+		return -EEXIST;
+	}
+
+	dedupe = calloc(1, sizeof(*dedupe));
+	ctx = calloc(1, sizeof(*ctx));
+	if (dedupe == NULL || ctx == NULL) {
+		free(dedupe);
+		free(ctx);
+		return -ENOMEM;
+	}
+
+	dedupe->bdev.name = strdup(opts->name);
+	if (dedupe->bdev.name == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	rc = spdk_bdev_open_ext(opts->base_bdev_name, true, dedupe_base_bdev_event_cb, NULL,
+				&dedupe->base_desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("could not open bdev %s: %s\n", opts->base_bdev_name, spdk_strerror(-rc));
+		goto err;
+	}
+	dedupe->base_bdev = spdk_bdev_desc_get_bdev(dedupe->base_desc);
+
+	rc = spdk_bdev_module_claim_bdev(dedupe->base_bdev, dedupe->base_desc, &dedupe_if);
+	if (rc != 0) {
+		SPDK_ERRLOG("could not claim bdev %s\n", opts->base_bdev_name);
+		goto err;
+	}
+	dedupe->base_claimed = true;
+
+	blocklen = spdk_bdev_get_block_size(dedupe->base_bdev);
+	if (!spdk_u32_is_pow2(blocklen) || blocklen > DEDUPE_CHUNK_SIZE) {
+		SPDK_ERRLOG("Block size of the base bdev must divide %u\n", DEDUPE_CHUNK_SIZE);
+		rc = -EINVAL;
+		goto err;
+	}
+	if (spdk_bdev_get_md_size(dedupe->base_bdev) != 0) {
+		SPDK_ERRLOG("Bdevs with metadata are not supported\n");
+		rc = -ENOTSUP;
+		goto err;
+	}
+
+	if (spdk_uuid_is_null(&opts->uuid)) {
+		/* Generate UUID based on namespace UUID + base bdev UUID, unless the base bdev
+		 * already holds a dedupe vbdev, whose UUID is used then.
+		 */
+		spdk_uuid_parse(&ns_uuid, BDEV_DEDUPE_NAMESPACE_UUID);
+		rc = spdk_uuid_generate_sha1(&ctx->uuid, &ns_uuid,
+					     (const char *)&dedupe->base_bdev->uuid,
+					     sizeof(struct spdk_uuid));
+		if (rc != 0) {
+			goto err;
+		}
+	} else {
+		spdk_uuid_copy(&dedupe->bdev.uuid, &opts->uuid);
+	}
+
+	dedupe->thread = spdk_get_thread();
+	dedupe->chunk_base_blocks = DEDUPE_CHUNK_SIZE / blocklen;
+	dedupe->bdev.blockcnt = opts->num_blocks;
+	dedupe->latency_budget_us = opts->latency_budget_us;
+	dedupe->latency_budget_ticks = (uint64_t)opts->latency_budget_us * spdk_get_ticks_hz() /
+				       SPDK_SEC_TO_USEC;
+	dedupe->buf_align = spdk_max(spdk_bdev_get_buf_align(dedupe->base_bdev), 0x1000);
+	dedupe->create_ctx = ctx;
+
+	ctx->dedupe = dedupe;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	ctx->ch = spdk_bdev_get_io_channel(dedupe->base_desc);
+	if (ctx->ch == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	ctx->sb = spdk_zmalloc(DEDUPE_CHUNK_SIZE, dedupe->buf_align, NULL, SPDK_ENV_LCORE_ID_ANY,
+			       SPDK_MALLOC_DMA);
+	if (ctx->sb == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	rc = spdk_bdev_read_blocks(dedupe->base_desc, ctx->ch, ctx->sb, 0, dedupe->chunk_base_blocks,
+				   dedupe_create_read_sb_done, ctx);
+	if (rc != 0) {
+		goto err;
+	}
+
+	return 0;
+err:
+	if (ctx->ch != NULL) {
+		spdk_put_io_channel(ctx->ch);
+	}
+	spdk_free(ctx->sb);
+	free(ctx);
+	dedupe_free(dedupe);
+	return rc;
+}
+
+static void
+dedupe_destruct_stopped(struct vbdev_dedupe *dedupe)
+{
+	dedupe_close_base_bdev(dedupe);
+	spdk_bdev_destruct_done(&dedupe->bdev, 0);
+	dedupe_free(dedupe);
+}
+
+static void
+_dedupe_destruct(void *ctx)
+{
+	dedupe_stop_md_thread(ctx, dedupe_destruct_stopped);
+}
+
+static void
+dedupe_io_device_unregister_cb(void *io_device)
+{
+	struct vbdev_dedupe *dedupe = io_device;
+
+	/* The base bdev has to be closed on the thread it was opened on */
+	if (dedupe->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(dedupe->thread, _dedupe_destruct, dedupe);
+	} else {
+		_dedupe_destruct(dedupe);
+	}
+}
+
+static int
+vbdev_dedupe_destruct(void *ctx)
+{
+	struct vbdev_dedupe *dedupe = ctx;
+
+	TAILQ_REMOVE(&g_dedupe_nodes, dedupe, link);
+	spdk_io_device_unregister(dedupe, dedupe_io_device_unregister_cb);
+
+	/* Wait for the metadata thread to stop */
+	return 1;
+}
+
+void
+vbdev_dedupe_delete(const char *name, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	int rc;
+
+	rc = spdk_bdev_unregister_by_name(name, &dedupe_if, cb_fn, cb_arg);
+	if (rc != 0) {
+		cb_fn(cb_arg, rc);
+	}
+}
+
+static void
+dedupe_write_conf_values(struct vbdev_dedupe *dedupe, struct spdk_json_write_ctx *w)
+{
+	spdk_json_write_named_string(w, "name", dedupe->bdev.name);
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(dedupe->base_bdev));
+	spdk_json_write_named_uuid(w, "uuid", &dedupe->bdev.uuid);
+	spdk_json_write_named_uint64(w, "num_blocks", dedupe->bdev.blockcnt);
+	spdk_json_write_named_uint32(w, "latency_budget_us", dedupe->latency_budget_us);
+}
+
+static int
+vbdev_dedupe_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_dedupe *dedupe = ctx;
+	uint64_t mapped = dedupe->num_mapped_blocks, used = dedupe->num_used_chunks;
+
+	/* The counters belong to the metadata thread, they are only approximate here */
+	spdk_json_write_named_object_begin(w, "dedupe");
+	dedupe_write_conf_values(dedupe, w);
+	spdk_json_write_named_uint64(w, "num_chunks", dedupe->num_chunks);
+	spdk_json_write_named_uint64(w, "used_chunks", used);
+	spdk_json_write_named_uint64(w, "mapped_blocks", mapped);
+	spdk_json_write_named_uint64(w, "saved_blocks", mapped > used ? mapped - used : 0);
+	spdk_json_write_named_uint64(w, "verify_latency_us",
+				     dedupe->verify_ticks * SPDK_SEC_TO_USEC / spdk_get_ticks_hz());
+	spdk_json_write_named_object_begin(w, "stats");
+	spdk_json_write_named_uint64(w, "unique_writes", dedupe->stats.unique_writes);
+	spdk_json_write_named_uint64(w, "duplicate_writes", dedupe->stats.duplicate_writes);
+	spdk_json_write_named_uint64(w, "zero_writes", dedupe->stats.zero_writes);
+	spdk_json_write_named_uint64(w, "verify_mismatches", dedupe->stats.verify_mismatches);
+	spdk_json_write_named_uint64(w, "verify_skips", dedupe->stats.verify_skips);
+	spdk_json_write_object_end(w);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+/* This is used to generate JSON that can configure this module to its current state. */
+static int
+vbdev_dedupe_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_dedupe *dedupe;
+
+	TAILQ_FOREACH(dedupe, &g_dedupe_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_dedupe_create");
+		spdk_json_write_named_object_begin(w, "params");
+		dedupe_write_conf_values(dedupe, w);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+
+	return 0;
+}
+
+static void
+vbdev_dedupe_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+	/* No config per bdev needed */
+}
+
+static const struct spdk_bdev_fn_table vbdev_dedupe_fn_table = {
+	.destruct		= vbdev_dedupe_destruct,
+	.submit_request		= vbdev_dedupe_submit_request,
+	.io_type_supported	= vbdev_dedupe_io_type_supported,
+	.get_io_channel		= vbdev_dedupe_get_io_channel,
+	.dump_info_json		= vbdev_dedupe_dump_info_json,
+	.write_config_json	= vbdev_dedupe_write_config_json,
+};
+
+static int
+vbdev_dedupe_init(void)
+{
+	return 0;
+}
+
+static int
+vbdev_dedupe_get_ctx_size(void)
+{
+	return sizeof(struct dedupe_bdev_io);
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_dedupe)
@@ -0,0 +1,64 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_VBDEV_DEDUPE_H
+#define SPDK_VBDEV_DEDUPE_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+struct vbdev_dedupe_opts {
+	/* Name of the dedupe vbdev */
+	const char *name;
+	/* Name of the bdev that holds the unique blocks and the metadata */
+	const char *base_bdev_name;
+	/* UUID of the dedupe vbdev, generated from the base bdev's if null */
+	struct spdk_uuid uuid;
+	/* Number of 4 KiB blocks of the dedupe vbdev, 0 to use the number of blocks the base
+	 * bdev can hold without any duplicate.
+	 */
+	uint64_t num_blocks;
+	/* Duplicates are written as unique blocks while the reads verifying them take longer
+	 * than this on average, 0 disables the limit.
+	 */
+	uint32_t latency_budget_us;
+};
+
+/**
+ * Fill the dedupe vbdev options with the default values.
+ *
+ * \param opts Options to initialize.
+ */
+void vbdev_dedupe_get_default_opts(struct vbdev_dedupe_opts *opts);
+
+typedef void (*vbdev_dedupe_create_cb)(void *cb_arg, struct spdk_bdev *bdev, int rc);
+
+/**
+ * Create a dedupe vbdev. If the base bdev holds the metadata of a previous dedupe vbdev,
+ * its data is recovered and the geometry stored in the metadata is used instead of the
+ * one in opts.
+ *
+ * \param opts Options of the dedupe vbdev.
+ * \param cb_fn Function to call when the dedupe vbdev is registered or its creation failed.
+ * \param cb_arg Argument to pass to cb_fn.
+ * \return 0 if the creation was started, negative errno otherwise. cb_fn is not called
+ * if this function fails.
+ */
+int vbdev_dedupe_create(const struct vbdev_dedupe_opts *opts, vbdev_dedupe_create_cb cb_fn,
+			void *cb_arg);
+
+/**
+ * Delete a dedupe vbdev. Its data stays on the base bdev and is recovered when the dedupe
+ * vbdev is created again.
+ *
+ * \param name Name of the dedupe vbdev.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void vbdev_dedupe_delete(const char *name, spdk_bdev_unregister_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_DEDUPE_H */
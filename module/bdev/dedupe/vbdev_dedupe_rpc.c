@@ -0,0 +1,145 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_dedupe.h"
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/string.h"
+#include "spdk/log.h"
+
+struct rpc_construct_dedupe {
+	char *name;
+	char *base_bdev_name;
+	struct spdk_uuid uuid;
+	uint64_t num_blocks;
+	uint32_t latency_budget_us;
+	struct spdk_jsonrpc_request *request;
+};
+
+static void
+free_rpc_construct_dedupe(struct rpc_construct_dedupe *r)
+{
+	free(r->name);
+	free(r->base_bdev_name);
+	free(r);
+}
+
+static const struct spdk_json_object_decoder rpc_construct_dedupe_decoders[] = {
+	{"name", offsetof(struct rpc_construct_dedupe, name), spdk_json_decode_string},
+	{"base_bdev_name", offsetof(struct rpc_construct_dedupe, base_bdev_name), spdk_json_decode_string},
+	{"uuid", offsetof(struct rpc_construct_dedupe, uuid), spdk_json_decode_uuid, true},
+	{"num_blocks", offsetof(struct rpc_construct_dedupe, num_blocks), spdk_json_decode_uint64, true},
+	{"latency_budget_us", offsetof(struct rpc_construct_dedupe, latency_budget_us), spdk_json_decode_uint32, true},
+};
+
+static void
+rpc_bdev_dedupe_create_cb(void *cb_arg, struct spdk_bdev *bdev, int rc)
+{
+	struct rpc_construct_dedupe *req = cb_arg;
+	struct spdk_json_write_ctx *w;
+
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(req->request, rc, spdk_strerror(-rc));
+	} else {
+		w = spdk_jsonrpc_begin_result(req->request);
+		spdk_json_write_string(w, spdk_bdev_get_name(bdev));
+		spdk_jsonrpc_end_result(req->request, w);
+	}
+
+	free_rpc_construct_dedupe(req);
+}
+
+static void
+rpc_bdev_dedupe_create(struct spdk_jsonrpc_request *request,
+		       const struct spdk_json_val *params)
+{
+	struct rpc_construct_dedupe *req;
+	struct vbdev_dedupe_opts opts;
+	int rc;
+
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	vbdev_dedupe_get_default_opts(&opts);
+	req->latency_budget_us = opts.latency_budget_us;
+	req->request = request;
+
+	if (spdk_json_decode_object(params, rpc_construct_dedupe_decoders,
+				    SPDK_COUNTOF(rpc_construct_dedupe_decoders),
+				    req)) {
+		SPDK_DEBUGLOG(vbdev_dedupe, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	opts.name = req->name;
+	opts.base_bdev_name = req->base_bdev_name;
+	spdk_uuid_copy(&opts.uuid, &req->uuid);
+	opts.num_blocks = req->num_blocks;
+	opts.latency_budget_us = req->latency_budget_us;
+
+	rc = vbdev_dedupe_create(&opts, rpc_bdev_dedupe_create_cb, req);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	return;
+
+cleanup:
+	free_rpc_construct_dedupe(req);
+}
+SPDK_RPC_REGISTER("bdev_dedupe_create", rpc_bdev_dedupe_create, SPDK_RPC_RUNTIME)
+
+struct rpc_delete_dedupe {
+	char *name;
+};
+
+static void
+free_rpc_delete_dedupe(struct rpc_delete_dedupe *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_delete_dedupe_decoders[] = {
+	{"name", offsetof(struct rpc_delete_dedupe, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_dedupe_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (bdeverrno == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, bdeverrno, spdk_strerror(-bdeverrno));
+	}
+}
+
+static void
+rpc_bdev_dedupe_delete(struct spdk_jsonrpc_request *request,
+		       const struct spdk_json_val *params)
+{
+	struct rpc_delete_dedupe req = {NULL};
+
+	if (spdk_json_decode_object(params, rpc_delete_dedupe_decoders,
+				    SPDK_COUNTOF(rpc_delete_dedupe_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	vbdev_dedupe_delete(req.name, rpc_bdev_dedupe_delete_cb, request);
+
+cleanup:
+	free_rpc_delete_dedupe(&req);
+}
+SPDK_RPC_REGISTER("bdev_dedupe_delete", rpc_bdev_dedupe_delete, SPDK_RPC_RUNTIME)
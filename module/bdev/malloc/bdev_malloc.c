@@ -4,6 +4,8 @@
  *   Copyright (c) 2021 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
  */
 
+#include <sys/file.h>
+
 #include "spdk/stdinc.h"
 
 #include "bdev_malloc.h"
@@ -12,7 +14,9 @@
 #include "spdk/accel.h"
 #include "spdk/dma.h"
 #include "spdk/likely.h"
+#include "spdk/memory.h"
 #include "spdk/string.h"
+#include "spdk/thread.h"
 
 #include "spdk/log.h"
 
@@ -20,9 +24,36 @@ struct malloc_disk {
 	struct spdk_bdev		disk;
 	void				*malloc_buf;
 	void				*malloc_md_buf;
+	/* Only used by the disks backed by a file */
+	char				*file;
+	int				fd;
+	size_t				map_len;
+	uint32_t			checkpoint_interval_ms;
+	struct spdk_poller		*checkpoint_poller;
+	/* Set by the writes completed since the last checkpoint */
+	bool				dirty;
+	struct spdk_thread		*thread;
 	TAILQ_ENTRY(malloc_disk)	link;
 };
 
+/*
+ * Stored in a file after the data and the separate metadata, so that a disk created again
+ * with the same file is checked to have the same block layout
+ */
+struct malloc_file_layout {
+	char		magic[8];
+	uint64_t	num_blocks;
+	uint32_t	block_size;
+	uint32_t	md_size;
+	uint8_t		md_interleave;
+	uint8_t		dif_type;
+	uint8_t		dif_is_head_of_md;
+	uint8_t		reserved[5];
+};
+SPDK_STATIC_ASSERT(sizeof(struct malloc_file_layout) == 32, "Incorrect size");
+
+#define MALLOC_FILE_MAGIC	"SPDKMALC"
+
 struct malloc_task {
 	struct iovec			iov;
 	int				num_outstanding;
@@ -156,6 +187,16 @@ malloc_unmap_write_zeroes_generate_pi(struct spdk_bdev_io *bdev_io)
 	return rc;
 }
 
+static inline void
+malloc_disk_mark_dirty(struct malloc_disk *mdisk)
+{
+	/* Only store when needed, every write would bounce the cache line otherwise */
+	if (mdisk->checkpoint_interval_ms != 0 &&
+	    !__atomic_load_n(&mdisk->dirty, __ATOMIC_RELAXED)) {
+		__atomic_store_n(&mdisk->dirty, true, __ATOMIC_RELEASE);
+	}
+}
+
 static void
 malloc_done(void *ref, int status)
 {
@@ -195,6 +236,10 @@ malloc_done(void *ref, int status)
 		}
 	}
 
+	if (bdev_io->type != SPDK_BDEV_IO_TYPE_READ && task->status == SPDK_BDEV_IO_STATUS_SUCCESS) {
+		malloc_disk_mark_dirty(bdev_io->bdev->ctxt);
+	}
+
 	assert(!bdev_io->u.bdev.accel_sequence || task->status == SPDK_BDEV_IO_STATUS_NOMEM);
 	spdk_bdev_io_complete(spdk_bdev_io_from_ctx(task), task->status);
 }
@@ -230,6 +275,21 @@ static struct spdk_bdev_module malloc_if = {
 
 SPDK_BDEV_MODULE_REGISTER(malloc, &malloc_if)
 
+static void
+malloc_disk_unmap_file(struct malloc_disk *malloc_disk)
+{
+	if (malloc_disk->malloc_buf != NULL) {
+		spdk_mem_unregister(malloc_disk->malloc_buf, malloc_disk->map_len);
+		/* The data stays in the page cache, just make sure its writeback is started */
+		msync(malloc_disk->malloc_buf, malloc_disk->map_len, MS_ASYNC);
+		munmap(malloc_disk->malloc_buf, malloc_disk->map_len);
+	}
+
+	if (malloc_disk->fd >= 0) {
+		close(malloc_disk->fd);
+	}
+}
+
 static void
 malloc_disk_free(struct malloc_disk *malloc_disk)
 {
@@ -237,22 +297,96 @@ malloc_disk_free(struct malloc_disk *malloc_disk)
 		return;
 	}
 
+	spdk_poller_unregister(&malloc_disk->checkpoint_poller);
 	free(malloc_disk->disk.name);
-	spdk_free(malloc_disk->malloc_buf);
-	spdk_free(malloc_disk->malloc_md_buf);
+	if (malloc_disk->file != NULL) {
+		malloc_disk_unmap_file(malloc_disk);
+		free(malloc_disk->file);
+	} else {
+		spdk_free(malloc_disk->malloc_buf);
+		spdk_free(malloc_disk->malloc_md_buf);
+	}
 	free(malloc_disk);
 }
 
+static void
+_bdev_malloc_destruct(void *ctx)
+{
+	struct malloc_disk *malloc_disk = ctx;
+
+	spdk_bdev_destruct_done(&malloc_disk->disk, 0);
+	malloc_disk_free(malloc_disk);
+}
+
 static int
 bdev_malloc_destruct(void *ctx)
 {
 	struct malloc_disk *malloc_disk = ctx;
 
 	TAILQ_REMOVE(&g_malloc_disks, malloc_disk, link);
+
+	/* The checkpoint poller has to be unregistered from the thread that created it */
+	if (malloc_disk->checkpoint_poller != NULL) {
+		spdk_thread_send_msg(malloc_disk->thread, _bdev_malloc_destruct, malloc_disk);
+		return 1;
+	}
+
 	malloc_disk_free(malloc_disk);
 	return 0;
 }
 
+static int
+malloc_disk_sync(struct malloc_disk *mdisk, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev *bdev = &mdisk->disk;
+	uint64_t page_mask = sysconf(_SC_PAGESIZE) - 1;
+	uint64_t start, end;
+
+	/* Like the fsync of the aio bdev, this waits for the writeback on the current thread.
+	 * The checkpoint poller keeps the amount of dirty pages to write here low.
+	 */
+	start = (offset_blocks * bdev->blocklen) & ~page_mask;
+	end = (offset_blocks + num_blocks) * bdev->blocklen;
+	if (msync(mdisk->malloc_buf + start, end - start, MS_SYNC) != 0) {
+		return -errno;
+	}
+
+	if (mdisk->malloc_md_buf != NULL) {
+		start = (uintptr_t)mdisk->malloc_md_buf + offset_blocks * bdev->md_len;
+		end = (uintptr_t)mdisk->malloc_md_buf + (offset_blocks + num_blocks) * bdev->md_len;
+		start &= ~page_mask;
+		if (msync((void *)start, end - start, MS_SYNC) != 0) {
+			return -errno;
+		}
+	}
+
+	return 0;
+}
+
+static int
+malloc_disk_checkpoint(void *ctx)
+{
+	struct malloc_disk *mdisk = ctx;
+	int rc;
+
+	if (!__atomic_exchange_n(&mdisk->dirty, false, __ATOMIC_ACQUIRE)) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	/* Only start the writeback of the dirty pages, waiting for it would block the thread */
+#ifdef __linux__
+	rc = sync_file_range(mdisk->fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+#else
+	rc = msync(mdisk->malloc_buf, mdisk->map_len, MS_ASYNC);
+#endif
+	if (rc != 0) {
+		SPDK_ERRLOG("Checkpoint of %s to %s failed: %s\n", mdisk->disk.name, mdisk->file,
+			    spdk_strerror(errno));
+	}
+
+	return SPDK_POLLER_BUSY;
+}
+
 static int
 bdev_malloc_check_iov_len(struct iovec *iovs, int iovcnt, size_t nbytes)
 {
@@ -481,6 +615,16 @@ _bdev_malloc_submit_request(struct malloc_channel *mch, struct spdk_bdev_io *bde
 		return 0;
 
 	case SPDK_BDEV_IO_TYPE_FLUSH:
+		if (disk->file != NULL) {
+			rc = malloc_disk_sync(disk, bdev_io->u.bdev.offset_blocks,
+					      bdev_io->u.bdev.num_blocks);
+			if (rc != 0) {
+				SPDK_ERRLOG("Flush of %s to %s failed: %s\n", disk->disk.name,
+					    disk->file, spdk_strerror(-rc));
+				malloc_complete_task(task, mch, SPDK_BDEV_IO_STATUS_FAILED);
+				return 0;
+			}
+		}
 		malloc_complete_task(task, mch, SPDK_BDEV_IO_STATUS_SUCCESS);
 		return 0;
 
@@ -504,6 +648,8 @@ _bdev_malloc_submit_request(struct malloc_channel *mch, struct spdk_bdev_io *bde
 			len = bdev_io->u.bdev.num_blocks * block_size;
 			spdk_bdev_io_set_buf(bdev_io, buf, len);
 
+		} else if (bdev_io->u.bdev.zcopy.commit) {
+			malloc_disk_mark_dirty(disk);
 		}
 		malloc_complete_task(task, mch, SPDK_BDEV_IO_STATUS_SUCCESS);
 		return 0;
@@ -563,6 +709,8 @@ bdev_malloc_get_io_channel(void *ctx)
 static void
 bdev_malloc_write_json_config(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 {
+	struct malloc_disk *mdisk = bdev->ctxt;
+
 	spdk_json_write_object_begin(w);
 
 	spdk_json_write_named_string(w, "method", "bdev_malloc_create");
@@ -574,6 +722,11 @@ bdev_malloc_write_json_config(struct spdk_bdev *bdev, struct spdk_json_write_ctx
 	spdk_json_write_named_uint32(w, "physical_block_size", bdev->phys_blocklen);
 	spdk_json_write_named_uuid(w, "uuid", &bdev->uuid);
 	spdk_json_write_named_uint32(w, "optimal_io_boundary", bdev->optimal_io_boundary);
+	if (mdisk->file != NULL) {
+		spdk_json_write_named_string(w, "file", mdisk->file);
+		spdk_json_write_named_uint32(w, "checkpoint_interval_ms",
+					     mdisk->checkpoint_interval_ms);
+	}
 
 	spdk_json_write_object_end(w);
 
@@ -677,11 +830,119 @@ malloc_disk_setup_pi(struct malloc_disk *mdisk)
 	return rc;
 }
 
+static int
+malloc_disk_map_file(struct malloc_disk *mdisk, const struct malloc_bdev_opts *opts,
+		     uint64_t data_len, uint64_t md_len, bool *formatted)
+{
+	struct malloc_file_layout layout = {}, *file_layout;
+	struct stat st;
+	uint64_t align;
+	size_t reserved_len;
+	void *reserved, *buf;
+	int rc;
+
+	memcpy(layout.magic, MALLOC_FILE_MAGIC, sizeof(layout.magic));
+	layout.num_blocks = opts->num_blocks;
+	layout.block_size = opts->block_size;
+	layout.md_size = opts->md_size;
+	layout.md_interleave = opts->md_interleave;
+	layout.dif_type = opts->dif_type;
+	layout.dif_is_head_of_md = opts->dif_is_head_of_md;
+
+	mdisk->fd = open(mdisk->file, O_RDWR | O_CREAT, 0600);
+	if (mdisk->fd < 0) {
+		rc = -errno;
+		SPDK_ERRLOG("Could not open %s: %s\n", mdisk->file, spdk_strerror(-rc));
+		return rc;
+	}
+
+	/* Two disks (or targets) writing the same file would corrupt each other's data */
+	if (flock(mdisk->fd, LOCK_EX | LOCK_NB) != 0) {
+		rc = errno == EWOULDBLOCK ? -EBUSY : -errno;
+		SPDK_ERRLOG("Could not lock %s: %s\n", mdisk->file, spdk_strerror(-rc));
+		return rc;
+	}
+
+	if (fstat(mdisk->fd, &st) != 0) {
+		rc = -errno;
+		SPDK_ERRLOG("Could not stat %s: %s\n", mdisk->file, spdk_strerror(-rc));
+		return rc;
+	}
+
+	/* The files on a hugetlbfs have to be sized and mapped in huge pages, whose size is
+	 * reported as the block size of the file.
+	 */
+	align = spdk_max(VALUE_2MB, (uint64_t)st.st_blksize);
+	mdisk->map_len = SPDK_ALIGN_CEIL(data_len + md_len + sizeof(layout), align);
+	*formatted = st.st_size != 0;
+
+	if (*formatted && (uint64_t)st.st_size != mdisk->map_len) {
+		SPDK_ERRLOG("%s has %" PRIu64 " bytes, the disk needs %zu\n", mdisk->file,
+			    (uint64_t)st.st_size, mdisk->map_len);
+		return -EINVAL;
+	}
+
+	if (!*formatted && ftruncate(mdisk->fd, mdisk->map_len) != 0) {
+		rc = -errno;
+		SPDK_ERRLOG("Could not resize %s: %s\n", mdisk->file, spdk_strerror(-rc));
+		return rc;
+	}
+
+	/* Reserve an aligned range of addresses first, spdk_mem_register() needs 2MB alignment */
+	reserved_len = mdisk->map_len + align;
+	reserved = mmap(NULL, reserved_len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+			-1, 0);
+	if (reserved == MAP_FAILED) {
+		SPDK_ERRLOG("Could not reserve %zu bytes for %s\n", reserved_len, mdisk->file);
+		return -ENOMEM;
+	}
+
+	buf = (void *)SPDK_ALIGN_CEIL((uintptr_t)reserved, align);
+	if (mmap(buf, mdisk->map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+		 mdisk->fd, 0) == MAP_FAILED) {
+		rc = -errno;
+		SPDK_ERRLOG("Could not map %s: %s\n", mdisk->file, spdk_strerror(-rc));
+		munmap(reserved, reserved_len);
+		return rc;
+	}
+
+	if (buf != reserved) {
+		munmap(reserved, (uintptr_t)buf - (uintptr_t)reserved);
+	}
+	munmap((uint8_t *)buf + mdisk->map_len,
+	       (uintptr_t)reserved + reserved_len - (uintptr_t)buf - mdisk->map_len);
+
+	file_layout = (struct malloc_file_layout *)((uint8_t *)buf + data_len + md_len);
+	if (!*formatted) {
+		*file_layout = layout;
+	} else if (memcmp(file_layout, &layout, sizeof(layout)) != 0) {
+		SPDK_ERRLOG("%s holds a disk with a different block layout\n", mdisk->file);
+		munmap(buf, mdisk->map_len);
+		return -EINVAL;
+	}
+
+	rc = spdk_mem_register(buf, mdisk->map_len);
+	if (rc != 0) {
+		SPDK_ERRLOG("Could not register %s for DMA: %s\n", mdisk->file, spdk_strerror(-rc));
+		munmap(buf, mdisk->map_len);
+		return rc;
+	}
+
+	mdisk->malloc_buf = buf;
+	if (md_len != 0) {
+		mdisk->malloc_md_buf = (uint8_t *)buf + data_len;
+	}
+
+	return 0;
+}
+
 int
 create_malloc_disk(struct spdk_bdev **bdev, const struct malloc_bdev_opts *opts)
 {
 	struct malloc_disk *mdisk;
 	uint32_t block_size;
+	uint64_t md_len;
+	bool formatted = false;
 	int rc;
 
 	assert(opts != NULL);
@@ -730,34 +991,57 @@ create_malloc_disk(struct spdk_bdev **bdev, const struct malloc_bdev_opts *opts)
 		return -EINVAL;
 	}
 
+	if (opts->checkpoint_interval_ms != 0 && opts->file == NULL) {
+		SPDK_ERRLOG("Checkpoints require a file backed disk\n");
+		return -EINVAL;
+	}
+
 	mdisk = calloc(1, sizeof(*mdisk));
 	if (!mdisk) {
 		SPDK_ERRLOG("mdisk calloc() failed\n");
 		return -ENOMEM;
 	}
+	mdisk->fd = -1;
 
-	/*
-	 * Allocate the large backend memory buffer from pinned memory.
-	 *
-	 * TODO: need to pass a hint so we know which socket to allocate
-	 *  from on multi-socket systems.
-	 */
-	mdisk->malloc_buf = spdk_zmalloc(opts->num_blocks * block_size, 2 * 1024 * 1024, NULL,
-					 SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
-	if (!mdisk->malloc_buf) {
-		SPDK_ERRLOG("malloc_buf spdk_zmalloc() failed\n");
-		malloc_disk_free(mdisk);
-		return -ENOMEM;
-	}
+	if (opts->file != NULL) {
+		mdisk->file = strdup(opts->file);
+		if (mdisk->file == NULL) {
+			malloc_disk_free(mdisk);
+			return -ENOMEM;
+		}
 
-	if (!opts->md_interleave && opts->md_size != 0) {
-		mdisk->malloc_md_buf = spdk_zmalloc(opts->num_blocks * opts->md_size, 2 * 1024 * 1024, NULL,
-						    SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
-		if (!mdisk->malloc_md_buf) {
-			SPDK_ERRLOG("malloc_md_buf spdk_zmalloc() failed\n");
+		md_len = opts->md_interleave ? 0 : opts->num_blocks * opts->md_size;
+		rc = malloc_disk_map_file(mdisk, opts, opts->num_blocks * block_size, md_len,
+					  &formatted);
+		if (rc != 0) {
+			malloc_disk_free(mdisk);
+			return rc;
+		}
+	} else {
+		/*
+		 * Allocate the large backend memory buffer from pinned memory.
+		 *
+		 * TODO: need to pass a hint so we know which socket to allocate
+		 *  from on multi-socket systems.
+		 */
+		mdisk->malloc_buf = spdk_zmalloc(opts->num_blocks * block_size, 2 * 1024 * 1024,
+						 NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+		if (!mdisk->malloc_buf) {
+			SPDK_ERRLOG("malloc_buf spdk_zmalloc() failed\n");
 			malloc_disk_free(mdisk);
 			return -ENOMEM;
 		}
+
+		if (!opts->md_interleave && opts->md_size != 0) {
+			mdisk->malloc_md_buf = spdk_zmalloc(opts->num_blocks * opts->md_size,
+							    2 * 1024 * 1024, NULL,
+							    SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+			if (!mdisk->malloc_md_buf) {
+				SPDK_ERRLOG("malloc_md_buf spdk_zmalloc() failed\n");
+				malloc_disk_free(mdisk);
+				return -ENOMEM;
+			}
+		}
 	}
 
 	if (opts->name) {
@@ -798,7 +1082,8 @@ create_malloc_disk(struct spdk_bdev **bdev, const struct malloc_bdev_opts *opts)
 		break;
 	}
 
-	if (opts->dif_type != SPDK_DIF_DISABLE) {
+	/* A file that already holds data has been formatted when it was created */
+	if (opts->dif_type != SPDK_DIF_DISABLE && !formatted) {
 		rc = malloc_disk_setup_pi(mdisk);
 		if (rc) {
 			SPDK_ERRLOG("Failed to set up protection information.\n");
@@ -820,6 +1105,19 @@ create_malloc_disk(struct spdk_bdev **bdev, const struct malloc_bdev_opts *opts)
 	mdisk->disk.fn_table = &malloc_fn_table;
 	mdisk->disk.module = &malloc_if;
 
+	if (opts->checkpoint_interval_ms != 0) {
+		mdisk->checkpoint_interval_ms = opts->checkpoint_interval_ms;
+		mdisk->thread = spdk_get_thread();
+		mdisk->checkpoint_poller = SPDK_POLLER_REGISTER(malloc_disk_checkpoint, mdisk,
+					   opts->checkpoint_interval_ms * 1000ULL);
+		if (mdisk->checkpoint_poller == NULL) {
+			SPDK_ERRLOG("Failed to register the checkpoint poller of %s\n",
+				    mdisk->disk.name);
+			malloc_disk_free(mdisk);
+			return -ENOMEM;
+		}
+	}
+
 	rc = spdk_bdev_register(&mdisk->disk);
 	if (rc) {
 		malloc_disk_free(mdisk);
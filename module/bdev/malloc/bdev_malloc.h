@@ -24,6 +24,12 @@ struct malloc_bdev_opts {
 	bool md_interleave;
 	enum spdk_dif_type dif_type;
 	bool dif_is_head_of_md;
+	/* Path of a file that backs the disk instead of pinned memory, e.g. on a hugetlbfs or
+	 * a regular file system. Its contents are kept when the disk is created again.
+	 */
+	char *file;
+	/* Period of the writeback of the file backed disks, 0 disables it */
+	uint32_t checkpoint_interval_ms;
 };
 
 int create_malloc_disk(struct spdk_bdev **bdev, const struct malloc_bdev_opts *opts);
@@ -13,6 +13,7 @@ static void
 free_rpc_construct_malloc(struct malloc_bdev_opts *r)
 {
 	free(r->name);
+	free(r->file);
 }
 
 static const struct spdk_json_object_decoder rpc_construct_malloc_decoders[] = {
@@ -26,6 +27,8 @@ static const struct spdk_json_object_decoder rpc_construct_malloc_decoders[] = {
 	{"md_interleave", offsetof(struct malloc_bdev_opts, md_interleave), spdk_json_decode_bool, true},
 	{"dif_type", offsetof(struct malloc_bdev_opts, dif_type), spdk_json_decode_int32, true},
 	{"dif_is_head_of_md", offsetof(struct malloc_bdev_opts, dif_is_head_of_md), spdk_json_decode_bool, true},
+	{"file", offsetof(struct malloc_bdev_opts, file), spdk_json_decode_string, true},
+	{"checkpoint_interval_ms", offsetof(struct malloc_bdev_opts, checkpoint_interval_ms), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -13,8 +13,18 @@
 #include "spdk/json.h"
 #include "spdk/likely.h"
 
+#define RAID_OFFSET_BLOCKS_INVALID	UINT64_MAX
+#define RAID_BDEV_PROCESS_MAX_QD	16
+#define RAID_BDEV_WIB_CLEAR_PERIOD_US	(5 * 1000 * 1000)
+#define RAID_BDEV_WRITE_BEHIND_WAIT_US	1000
+
 static bool g_shutdown_started = false;
 
+static struct raid_bdev_opts g_opts = {
+	.process_window_size_kb = 1024,
+	.process_max_bandwidth_mb_sec = 0,
+};
+
 /* List of all raid bdevs */
 struct raid_all_tailq g_raid_bdev_list = TAILQ_HEAD_INITIALIZER(g_raid_bdev_list);
 
@@ -30,6 +40,137 @@ struct raid_bdev_io_channel {
 
 	/* Private raid module IO channel */
 	struct spdk_io_channel	*module_channel;
+
+	/* Background process data */
+	struct {
+		/*
+		 * The blocks below this offset have been processed by the rebuild and are
+		 * accessed through ch_processed. RAID_OFFSET_BLOCKS_INVALID if no rebuild is
+		 * running.
+		 */
+		uint64_t offset;
+
+		/*
+		 * The writes below this offset also go to the rebuild target. It is the same as
+		 * offset, except for a rebuild of the write-intent bitmap regions, where all the
+		 * writes go to the target.
+		 */
+		uint64_t write_offset;
+
+		/* Copy of this channel that also includes the rebuild target */
+		struct raid_bdev_io_channel *ch_processed;
+	} process;
+};
+
+enum raid_process_state {
+	RAID_PROCESS_STATE_INIT,
+	RAID_PROCESS_STATE_RUNNING,
+	RAID_PROCESS_STATE_STOPPING,
+	RAID_PROCESS_STATE_STOPPED,
+};
+
+struct raid_process_finish_action {
+	spdk_msg_fn cb;
+	void *cb_ctx;
+	TAILQ_ENTRY(raid_process_finish_action) link;
+};
+
+struct raid_bdev_process {
+	struct raid_bdev		*raid_bdev;
+	enum raid_process_type		type;
+	enum raid_process_state		state;
+	struct spdk_thread		*thread;
+
+	/* io channel of the raid bdev on the process thread */
+	struct raid_bdev_io_channel	*raid_ch;
+
+	/* The base bdev being rebuilt and its io channel on the process thread */
+	struct raid_base_bdev_info	*target;
+	struct spdk_io_channel		*target_ch;
+
+	/* Free process requests */
+	TAILQ_HEAD(, raid_bdev_process_request) requests;
+
+	/* The process window is quiesced while it is processed */
+	uint64_t			max_window_size;
+	uint64_t			window_align;
+	uint64_t			window_offset;
+	uint64_t			window_size;
+	uint64_t			window_submitted;
+	uint64_t			window_remaining;
+	int				window_status;
+	bool				window_range_locked;
+	uint64_t			window_range_offset;
+	uint64_t			window_range_size;
+
+	/* End of the range being processed, the end of the current region for a resync */
+	uint64_t			range_end;
+
+	/* Regions left to resync, a copy of the write-intent bitmap */
+	uint64_t			*resync_bitmap;
+	uint64_t			resync_region;
+
+	/* Rate limiting - the next window is not started before this time */
+	uint32_t			max_bandwidth_mb_sec;
+	uint64_t			next_window_tsc;
+	struct spdk_poller		*qos_poller;
+
+	int				status;
+	int				stop_status;
+	bool				bdev_quiesced;
+	TAILQ_HEAD(, raid_process_finish_action) finish_actions;
+};
+
+struct raid_bdev_wib {
+	struct raid_bdev		*raid_bdev;
+	uint64_t			num_regions;
+	uint32_t			region_size_shift;
+	uint64_t			nbytes;
+
+	/* The bitmap in its on-disk format. Modified under the lock. */
+	uint64_t			*bitmap;
+
+	/* Copy of the bitmap that is being written to the base bdevs */
+	uint64_t			*write_buf;
+
+	/*
+	 * Number of writes in progress in each region, including writes waiting for the
+	 * bitmap update. Regions waiting for a resync also hold a reference.
+	 */
+	uint32_t			*writes;
+
+	/* Set if the region's bit is set on disk, so writes to it can proceed right away */
+	uint8_t				*persisted;
+
+	/* Set by writes and cleared by the clear poller, recently written regions stay set */
+	uint8_t				*touched;
+
+	/* Dirty regions found at startup, to be resynced */
+	uint64_t			*resync_bitmap;
+
+	struct spdk_spinlock		lock;
+
+	/* Writes waiting for the next bitmap update */
+	TAILQ_HEAD(, raid_bdev_io)	waiting;
+
+	/* Writes waiting for the bitmap update in progress */
+	TAILQ_HEAD(, raid_bdev_io)	flushing;
+
+	bool				flush_needed;
+	bool				flush_scheduled;
+	bool				flush_in_progress;
+
+	struct spdk_poller		*clear_poller;
+
+	/*
+	 * Set while a member is missing or being rebuilt. The bits are not cleared then, so that
+	 * a former member can rejoin with a rebuild of the marked regions only.
+	 */
+	bool				degraded;
+
+	/* Set when the bitmap is being stopped */
+	spdk_msg_fn			stop_cb;
+	void				*stop_cb_ctx;
 };
 
 static struct raid_bdev_module *
@@ -77,6 +218,86 @@ static void	raid_bdev_examine(struct spdk_bdev *bdev);
 static int	raid_bdev_init(void);
 static void	raid_bdev_deconfigure(struct raid_bdev *raid_bdev,
 				      raid_bdev_destruct_cb cb_fn, void *cb_arg);
+static void	raid_bdev_wib_flush_msg(void *ctx);
+static void	raid_bdev_process_stop(struct raid_bdev_process *process, int status,
+				       spdk_msg_fn cb, void *cb_ctx);
+static void	raid_bdev_wib_stop(struct raid_bdev_wib *wib, spdk_msg_fn cb, void *cb_ctx);
+
+static void
+raid_bdev_ch_process_cleanup(struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_bdev_io_channel *raid_ch_processed = raid_ch->process.ch_processed;
+	struct raid_bdev *raid_bdev = spdk_io_channel_get_io_device(spdk_io_channel_from_ctx(raid_ch));
+	uint8_t i;
+
+	raid_ch->process.offset = RAID_OFFSET_BLOCKS_INVALID;
+
+	if (raid_ch_processed == NULL) {
+		return;
+	}
+
+	/* Only the channels that are not shared with the parent channel are owned by the copy */
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (raid_ch_processed->base_channel[i] != NULL &&
+		    raid_ch_processed->base_channel[i] != raid_ch->base_channel[i]) {
+			spdk_put_io_channel(raid_ch_processed->base_channel[i]);
+		}
+	}
+
+	free(raid_ch_processed->base_channel);
+	free(raid_ch_processed);
+	raid_ch->process.ch_processed = NULL;
+}
+
+static int
+raid_bdev_ch_process_setup(struct raid_bdev_io_channel *raid_ch, struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct raid_bdev_io_channel *raid_ch_processed;
+	struct raid_base_bdev_info *base_info;
+	uint8_t i;
+
+	if (raid_ch->process.ch_processed != NULL) {
+		return 0;
+	}
+
+	raid_ch_processed = calloc(1, sizeof(*raid_ch_processed));
+	if (raid_ch_processed == NULL) {
+		return -ENOMEM;
+	}
+
+	raid_ch_processed->base_channel = calloc(raid_bdev->num_base_bdevs,
+					  sizeof(struct spdk_io_channel *));
+	if (raid_ch_processed->base_channel == NULL) {
+		free(raid_ch_processed);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		base_info = &raid_bdev->base_bdev_info[i];
+
+		if (base_info == process->target) {
+			raid_ch_processed->base_channel[i] = spdk_bdev_get_io_channel(base_info->desc);
+			if (raid_ch_processed->base_channel[i] == NULL) {
+				free(raid_ch_processed->base_channel);
+				free(raid_ch_processed);
+				return -ENOMEM;
+			}
+		} else {
+			raid_ch_processed->base_channel[i] = raid_ch->base_channel[i];
+		}
+	}
+
+	raid_ch_processed->module_channel = raid_ch->module_channel;
+	raid_ch_processed->process.offset = RAID_OFFSET_BLOCKS_INVALID;
+
+	raid_ch->process.ch_processed = raid_ch_processed;
+	raid_ch->process.offset = process->window_offset;
+	raid_ch->process.write_offset = process->resync_bitmap != NULL ? UINT64_MAX :
+					process->window_offset;
+
+	return 0;
+}
 
 /*
  * brief:
@@ -116,7 +337,8 @@ raid_bdev_create_cb(void *io_device, void *ctx_buf)
 		 * split logic to send the respective child bdev ios to respective base
 		 * bdev io channel.
 		 */
-		if (raid_bdev->base_bdev_info[i].desc == NULL) {
+		if (raid_bdev->base_bdev_info[i].desc == NULL ||
+		    raid_bdev->base_bdev_info[i].is_process_target) {
 			continue;
 		}
 		raid_ch->base_channel[i] = spdk_bdev_get_io_channel(
@@ -137,7 +359,24 @@ raid_bdev_create_cb(void *io_device, void *ctx_buf)
 		}
 	}
 
+	raid_ch->process.offset = RAID_OFFSET_BLOCKS_INVALID;
+	if (!ret) {
+		spdk_spin_lock(&raid_bdev->base_bdev_lock);
+		if (raid_bdev->process != NULL && raid_bdev->process->state == RAID_PROCESS_STATE_RUNNING &&
+		    raid_bdev->process->target != NULL && raid_bdev->process->target->is_process_target) {
+			ret = raid_bdev_ch_process_setup(raid_ch, raid_bdev->process);
+			if (ret) {
+				SPDK_ERRLOG("Unable to set up io channel for the raid bdev process\n");
+			}
+		}
+		spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+	}
+
 	if (ret) {
+		if (raid_ch->module_channel != NULL) {
+			spdk_put_io_channel(raid_ch->module_channel);
+			raid_ch->module_channel = NULL;
+		}
 		for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
 			if (raid_ch->base_channel[i] != NULL) {
 				spdk_put_io_channel(raid_ch->base_channel[i]);
@@ -171,6 +410,8 @@ raid_bdev_destroy_cb(void *io_device, void *ctx_buf)
 	assert(raid_ch != NULL);
 	assert(raid_ch->base_channel);
 
+	raid_bdev_ch_process_cleanup(raid_ch);
+
 	if (raid_ch->module_channel) {
 		spdk_put_io_channel(raid_ch->module_channel);
 	}
@@ -246,6 +487,7 @@ raid_bdev_free_base_bdev_resource(struct raid_base_bdev_info *base_info)
 
 	free(base_info->name);
 	base_info->name = NULL;
+	base_info->wib_rebuild = false;
 	if (raid_bdev->state != RAID_BDEV_STATE_CONFIGURING) {
 		spdk_uuid_set_null(&base_info->uuid);
 	}
@@ -257,6 +499,7 @@ raid_bdev_free_base_bdev_resource(struct raid_base_bdev_info *base_info)
 	spdk_bdev_module_release_bdev(spdk_bdev_desc_get_bdev(base_info->desc));
 	spdk_bdev_close(base_info->desc);
 	base_info->desc = NULL;
+	base_info->is_process_target = false;
 	spdk_put_io_channel(base_info->app_thread_ch);
 	base_info->app_thread_ch = NULL;
 
@@ -291,6 +534,58 @@ raid_bdev_module_stop_done(struct raid_bdev *raid_bdev)
 	}
 }
 
+struct raid_bdev_write_behind_wait_ctx {
+	struct raid_base_bdev_info	*base_info;
+	spdk_msg_fn			cb;
+	void				*cb_ctx;
+	struct spdk_poller		*poller;
+};
+
+static int
+raid_bdev_write_behind_wait_poll(void *_ctx)
+{
+	struct raid_bdev_write_behind_wait_ctx *ctx = _ctx;
+
+	if (__atomic_load_n(&ctx->base_info->write_behind_outstanding, __ATOMIC_SEQ_CST) != 0) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	spdk_poller_unregister(&ctx->poller);
+	ctx->cb(ctx->cb_ctx);
+	free(ctx);
+
+	return SPDK_POLLER_BUSY;
+}
+
+/*
+ * Returns false if there is no write-behind in progress on the base bdev. Otherwise cb is
+ * called when it is done.
+ */
+static bool
+raid_bdev_wait_write_behind(struct raid_base_bdev_info *base_info, spdk_msg_fn cb, void *cb_ctx)
+{
+	struct raid_bdev_write_behind_wait_ctx *ctx;
+
+	if (__atomic_load_n(&base_info->write_behind_outstanding, __ATOMIC_SEQ_CST) == 0) {
+		return false;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		/* Just try again later */
+		spdk_thread_send_msg(spdk_get_thread(), cb, cb_ctx);
+		return true;
+	}
+
+	ctx->base_info = base_info;
+	ctx->cb = cb;
+	ctx->cb_ctx = cb_ctx;
+	ctx->poller = SPDK_POLLER_REGISTER(raid_bdev_write_behind_wait_poll, ctx,
+					   RAID_BDEV_WRITE_BEHIND_WAIT_US);
+
+	return true;
+}
+
 static void
 _raid_bdev_destruct(void *ctxt)
 {
@@ -299,6 +594,22 @@ _raid_bdev_destruct(void *ctxt)
 
 	SPDK_DEBUGLOG(bdev_raid, "raid_bdev_destruct\n");
 
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (raid_bdev_wait_write_behind(base_info, _raid_bdev_destruct, raid_bdev)) {
+			return;
+		}
+	}
+
+	if (raid_bdev->process != NULL) {
+		raid_bdev_process_stop(raid_bdev->process, -ECANCELED, _raid_bdev_destruct, raid_bdev);
+		return;
+	}
+
+	if (raid_bdev->wib != NULL) {
+		raid_bdev_wib_stop(raid_bdev->wib, _raid_bdev_destruct, raid_bdev);
+		return;
+	}
+
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		/*
 		 * Close all base bdev descriptors for which call has come from below
@@ -330,6 +641,147 @@ raid_bdev_destruct(void *ctx)
 	return 1;
 }
 
+/*
+ * Gets the write-intent bitmap regions of a range. The range is extended to whole redundancy
+ * units first, so that e.g. a partial stripe write of a parity raid marks the whole stripe
+ * whose parity it updates and a resync after a crash closes the write hole.
+ */
+static inline void
+raid_bdev_wib_regions(struct raid_bdev_wib *wib, uint64_t offset_blocks, uint64_t num_blocks,
+		      uint64_t *first, uint64_t *last)
+{
+	struct raid_bdev *raid_bdev = wib->raid_bdev;
+	uint64_t unit = raid_bdev->write_unit_blocks;
+	uint64_t end = offset_blocks + num_blocks;
+
+	if (unit > 1) {
+		offset_blocks = offset_blocks / unit * unit;
+		end = spdk_min(spdk_divide_round_up(end, unit) * unit, raid_bdev->bdev.blockcnt);
+	}
+
+	*first = offset_blocks >> wib->region_size_shift;
+	*last = (end - 1) >> wib->region_size_shift;
+}
+
+static inline void
+raid_bdev_wib_io_regions(struct raid_bdev_wib *wib, struct raid_bdev_io *raid_io,
+			 uint64_t *first, uint64_t *last)
+{
+	raid_bdev_wib_regions(wib, raid_io->offset_blocks, raid_io->num_blocks, first, last);
+}
+
+/*
+ * Takes references on the write-intent bitmap regions written by the raid_io. Returns true
+ * if the regions are already marked on the base bdevs and the write can be submitted right
+ * away. Otherwise the raid_io is queued until the bitmap is written and then resubmitted.
+ */
+static bool
+raid_bdev_wib_write_start(struct raid_bdev_wib *wib, struct raid_bdev_io *raid_io)
+{
+	uint64_t first, last, r;
+	bool persisted = true;
+	bool send_flush = false;
+
+	raid_bdev_wib_io_regions(wib, raid_io, &first, &last);
+	raid_io->wib_tracked = true;
+
+	/*
+	 * The writes counter is incremented before checking the persisted flag and the clear
+	 * poller resets the flag before checking the counter, so at least one of them sees
+	 * the other's update.
+	 */
+	for (r = first; r <= last; r++) {
+		__atomic_fetch_add(&wib->writes[r], 1, __ATOMIC_SEQ_CST);
+		if (!__atomic_load_n(&wib->touched[r], __ATOMIC_RELAXED)) {
+			__atomic_store_n(&wib->touched[r], 1, __ATOMIC_RELAXED);
+		}
+		if (!__atomic_load_n(&wib->persisted[r], __ATOMIC_SEQ_CST)) {
+			persisted = false;
+		}
+	}
+
+	if (spdk_likely(persisted)) {
+		return true;
+	}
+
+	spdk_spin_lock(&wib->lock);
+	persisted = true;
+	for (r = first; r <= last; r++) {
+		wib->bitmap[r / 64] |= 1ull << (r % 64);
+		if (!wib->persisted[r]) {
+			persisted = false;
+		}
+	}
+
+	if (!persisted) {
+		TAILQ_INSERT_TAIL(&wib->waiting, raid_io, module_link);
+		wib->flush_needed = true;
+		if (!wib->flush_in_progress && !wib->flush_scheduled) {
+			wib->flush_scheduled = true;
+			send_flush = true;
+		}
+	}
+	spdk_spin_unlock(&wib->lock);
+
+	if (send_flush) {
+		spdk_thread_send_msg(spdk_thread_get_app_thread(), raid_bdev_wib_flush_msg, wib);
+	}
+
+	return persisted;
+}
+
+static void
+raid_bdev_wib_write_done(struct raid_bdev_wib *wib, struct raid_bdev_io *raid_io)
+{
+	uint64_t first, last, r;
+
+	raid_bdev_wib_io_regions(wib, raid_io, &first, &last);
+
+	for (r = first; r <= last; r++) {
+		assert(wib->writes[r] > 0);
+		__atomic_fetch_sub(&wib->writes[r], 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+/*
+ * Takes references on the write-intent bitmap regions of a range for I/O that outlives the
+ * raid_io that wrote it, such as write-behind. The raid_io must still hold its own references,
+ * so the regions are already marked on the base bdevs.
+ */
+void
+raid_bdev_wib_range_get(struct raid_bdev *raid_bdev, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+	uint64_t first, last, r;
+
+	if (wib == NULL) {
+		return;
+	}
+
+	raid_bdev_wib_regions(wib, offset_blocks, num_blocks, &first, &last);
+	for (r = first; r <= last; r++) {
+		assert(wib->writes[r] > 0);
+		__atomic_fetch_add(&wib->writes[r], 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+void
+raid_bdev_wib_range_put(struct raid_bdev *raid_bdev, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+	uint64_t first, last, r;
+
+	if (wib == NULL) {
+		return;
+	}
+
+	raid_bdev_wib_regions(wib, offset_blocks, num_blocks, &first, &last);
+	for (r = first; r <= last; r++) {
+		assert(wib->writes[r] > 0);
+		__atomic_fetch_sub(&wib->writes[r], 1, __ATOMIC_SEQ_CST);
+	}
+}
+
 void
 raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
 {
@@ -338,6 +790,9 @@ raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status sta
 	if (spdk_unlikely(raid_io->completion_cb != NULL)) {
 		raid_io->completion_cb(raid_io, status);
 	} else {
+		if (spdk_unlikely(raid_io->wib_tracked)) {
+			raid_bdev_wib_write_done(raid_io->raid_bdev->wib, raid_io);
+		}
 		spdk_bdev_io_complete(bdev_io, status);
 	}
 }
@@ -472,6 +927,56 @@ raid_bdev_submit_reset_request(struct raid_bdev_io *raid_io)
 	}
 }
 
+/*
+ * While a rebuild is running, the I/O to the range that has already been rebuilt also goes
+ * to the rebuild target. Reads must be entirely within that range.
+ */
+static inline void
+raid_bdev_io_route(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev_io_channel *raid_ch = raid_io->raid_ch;
+
+	if (spdk_likely(raid_ch->process.offset == RAID_OFFSET_BLOCKS_INVALID)) {
+		return;
+	}
+
+	if (raid_io->type == SPDK_BDEV_IO_TYPE_READ) {
+		if (raid_io->offset_blocks + raid_io->num_blocks <= raid_ch->process.offset) {
+			raid_io->raid_ch = raid_ch->process.ch_processed;
+		}
+	} else if (raid_io->offset_blocks < raid_ch->process.write_offset) {
+		raid_io->raid_ch = raid_ch->process.ch_processed;
+	}
+}
+
+static void
+raid_bdev_submit_rw_request(struct raid_bdev_io *raid_io)
+{
+	raid_bdev_io_route(raid_io);
+
+	raid_io->raid_bdev->module->submit_rw_request(raid_io);
+}
+
+static void
+raid_bdev_submit_null_payload_request(struct raid_bdev_io *raid_io)
+{
+	raid_bdev_io_route(raid_io);
+
+	raid_io->raid_bdev->module->submit_null_payload_request(raid_io);
+}
+
+static void
+_raid_bdev_submit_write_request(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	if (raid_io->type == SPDK_BDEV_IO_TYPE_WRITE) {
+		raid_bdev_submit_rw_request(raid_io);
+	} else {
+		raid_bdev_submit_null_payload_request(raid_io);
+	}
+}
+
 /*
  * brief:
  * Callback function to spdk_bdev_io_get_buf.
@@ -493,7 +998,7 @@ raid_bdev_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
 		return;
 	}
 
-	raid_io->raid_bdev->module->submit_rw_request(raid_io);
+	raid_bdev_submit_rw_request(raid_io);
 }
 
 void
@@ -520,6 +1025,7 @@ raid_bdev_io_init(struct raid_bdev_io *raid_io, struct raid_bdev_io_channel *rai
 	raid_io->base_bdev_io_submitted = 0;
 	raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_SUCCESS;
 	raid_io->completion_cb = NULL;
+	raid_io->wib_tracked = false;
 }
 
 /*
@@ -549,16 +1055,25 @@ raid_bdev_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
-		raid_io->raid_bdev->module->submit_rw_request(raid_io);
+		if (raid_io->raid_bdev->wib != NULL &&
+		    !raid_bdev_wib_write_start(raid_io->raid_bdev->wib, raid_io)) {
+			break;
+		}
+		raid_bdev_submit_rw_request(raid_io);
 		break;
 
 	case SPDK_BDEV_IO_TYPE_RESET:
 		raid_bdev_submit_reset_request(raid_io);
 		break;
 
-	case SPDK_BDEV_IO_TYPE_FLUSH:
 	case SPDK_BDEV_IO_TYPE_UNMAP:
-		raid_io->raid_bdev->module->submit_null_payload_request(raid_io);
+		if (raid_io->raid_bdev->wib != NULL &&
+		    !raid_bdev_wib_write_start(raid_io->raid_bdev->wib, raid_io)) {
+			break;
+		}
+	/* fallthrough */
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		raid_bdev_submit_null_payload_request(raid_io);
 		break;
 
 	default:
@@ -674,6 +1189,9 @@ raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ct
 	spdk_json_write_named_uint32(w, "num_base_bdevs_discovered", raid_bdev->num_base_bdevs_discovered);
 	spdk_json_write_named_uint32(w, "num_base_bdevs_operational",
 				     raid_bdev->num_base_bdevs_operational);
+	if (raid_bdev->write_behind != 0) {
+		spdk_json_write_named_uint32(w, "write_behind", raid_bdev->write_behind);
+	}
 	spdk_json_write_name(w, "base_bdevs_list");
 	spdk_json_write_array_begin(w);
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
@@ -689,9 +1207,28 @@ raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ct
 		spdk_json_write_named_bool(w, "is_configured", base_info->is_configured);
 		spdk_json_write_named_uint64(w, "data_offset", base_info->data_offset);
 		spdk_json_write_named_uint64(w, "data_size", base_info->data_size);
+		if (base_info->write_mostly) {
+			spdk_json_write_named_bool(w, "write_mostly", true);
+		}
 		spdk_json_write_object_end(w);
 	}
 	spdk_json_write_array_end(w);
+
+	if (raid_bdev->process != NULL) {
+		struct raid_bdev_process *process = raid_bdev->process;
+		uint64_t offset = process->window_offset;
+
+		spdk_json_write_named_object_begin(w, "process");
+		spdk_json_write_named_string(w, "type", raid_bdev_process_to_str(process->type));
+		if (process->target != NULL) {
+			spdk_json_write_named_string(w, "target", process->target->name);
+		}
+		spdk_json_write_named_object_begin(w, "progress");
+		spdk_json_write_named_uint64(w, "blocks", offset);
+		spdk_json_write_named_uint32(w, "percent", offset * 100.0 / raid_bdev->bdev.blockcnt);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
 }
 
 /*
@@ -734,6 +1271,7 @@ raid_bdev_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *
 	struct raid_bdev *raid_bdev = bdev->ctxt;
 	struct raid_base_bdev_info *base_info;
 	char uuid_str[SPDK_UUID_STRING_LEN];
+	bool write_mostly = false;
 
 	assert(spdk_get_thread() == spdk_thread_get_app_thread());
 
@@ -761,6 +1299,19 @@ raid_bdev_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *
 		}
 	}
 	spdk_json_write_array_end(w);
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		write_mostly |= base_info->desc != NULL && base_info->write_mostly;
+	}
+	if (write_mostly) {
+		spdk_json_write_named_array_begin(w, "write_mostly_base_bdevs");
+		RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+			if (base_info->desc && base_info->write_mostly) {
+				spdk_json_write_string(w, spdk_bdev_desc_get_bdev(base_info->desc)->name);
+			}
+		}
+		spdk_json_write_array_end(w);
+	}
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
@@ -849,6 +1400,8 @@ static struct {
 	{ "0", RAID0 },
 	{ "raid1", RAID1 },
 	{ "1", RAID1 },
+	{ "raid10", RAID10 },
+	{ "10", RAID10 },
 	{ "raid5f", RAID5F },
 	{ "5f", RAID5F },
 	{ "concat", CONCAT },
@@ -865,6 +1418,16 @@ static struct {
 	{ }
 };
 
+static struct {
+	const char *name;
+	enum raid_process_type value;
+} g_raid_process_type_names[] = {
+	{ "none", RAID_PROCESS_NONE },
+	{ "rebuild", RAID_PROCESS_REBUILD },
+	{ "resync", RAID_PROCESS_RESYNC },
+	{ }
+};
+
 /* We have to use the typedef in the function declaration to appease astyle. */
 typedef enum raid_level raid_level_t;
 typedef enum raid_bdev_state raid_bdev_state_t;
@@ -930,16 +1493,48 @@ raid_bdev_state_to_str(enum raid_bdev_state state)
 	return "";
 }
 
-/*
- * brief:
- * raid_bdev_fini_start is called when bdev layer is starting the
- * shutdown process
- * params:
- * none
- * returns:
- * none
- */
-static void
+const char *
+raid_bdev_process_to_str(enum raid_process_type value)
+{
+	unsigned int i;
+
+	for (i = 0; g_raid_process_type_names[i].name != NULL; i++) {
+		if (g_raid_process_type_names[i].value == value) {
+			return g_raid_process_type_names[i].name;
+		}
+	}
+
+	return "";
+}
+
+void
+raid_bdev_get_opts(struct raid_bdev_opts *opts)
+{
+	*opts = g_opts;
+}
+
+int
+raid_bdev_set_opts(const struct raid_bdev_opts *opts)
+{
+	if (opts->process_window_size_kb == 0) {
+		return -EINVAL;
+	}
+
+	g_opts = *opts;
+
+	return 0;
+}
+
+/*
+ * brief:
+ * raid_bdev_fini_start is called when bdev layer is starting the
+ * shutdown process
+ * params:
+ * none
+ * returns:
+ * none
+ */
+static void
 raid_bdev_fini_start(void)
 {
 	SPDK_DEBUGLOG(bdev_raid, "raid_bdev_fini_start\n");
@@ -982,31 +1577,1251 @@ raid_bdev_get_ctx_size(void)
 	return sizeof(struct raid_bdev_io);
 }
 
-static struct spdk_bdev_module g_raid_if = {
-	.name = "raid",
-	.module_init = raid_bdev_init,
-	.fini_start = raid_bdev_fini_start,
-	.module_fini = raid_bdev_exit,
-	.get_ctx_size = raid_bdev_get_ctx_size,
-	.examine_disk = raid_bdev_examine,
-	.async_init = false,
-	.async_fini = false,
-};
-SPDK_BDEV_MODULE_REGISTER(raid, &g_raid_if)
+static int
+raid_bdev_config_json(struct spdk_json_write_ctx *w)
+{
+	spdk_json_write_object_begin(w);
+
+	spdk_json_write_named_string(w, "method", "bdev_raid_set_options");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_uint32(w, "process_window_size_kb", g_opts.process_window_size_kb);
+	spdk_json_write_named_uint32(w, "process_max_bandwidth_mb_sec",
+				     g_opts.process_max_bandwidth_mb_sec);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static struct spdk_bdev_module g_raid_if = {
+	.name = "raid",
+	.module_init = raid_bdev_init,
+	.fini_start = raid_bdev_fini_start,
+	.module_fini = raid_bdev_exit,
+	.config_json = raid_bdev_config_json,
+	.get_ctx_size = raid_bdev_get_ctx_size,
+	.examine_disk = raid_bdev_examine,
+	.async_init = false,
+	.async_fini = false,
+};
+SPDK_BDEV_MODULE_REGISTER(raid, &g_raid_if)
+
+/*
+ * brief:
+ * raid_bdev_init is the initialization function for raid bdev module
+ * params:
+ * none
+ * returns:
+ * 0 - success
+ * non zero - failure
+ */
+static int
+raid_bdev_init(void)
+{
+	return 0;
+}
+
+static void raid_bdev_process_thread_run(struct raid_bdev_process *process);
+static void raid_bdev_process_finish(struct raid_bdev_process *process, int status);
+static int _raid_bdev_remove_base_bdev(struct raid_base_bdev_info *base_info,
+				       raid_bdev_remove_base_bdev_cb cb_fn, void *cb_ctx);
+static void raid_bdev_remove_base_bdev_done(struct raid_base_bdev_info *base_info, int status);
+static int raid_bdev_start_process(struct raid_bdev *raid_bdev, enum raid_process_type type,
+				   struct raid_base_bdev_info *target);
+
+static void
+raid_bdev_process_request_free(struct raid_bdev_process_request *process_req)
+{
+	spdk_dma_free(process_req->iov.iov_base);
+	spdk_dma_free(process_req->md_buf);
+	free(process_req);
+}
+
+static struct raid_bdev_process_request *
+raid_bdev_process_alloc_request(struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct raid_bdev_process_request *process_req;
+
+	process_req = calloc(1, sizeof(*process_req));
+	if (process_req == NULL) {
+		return NULL;
+	}
+
+	process_req->process = process;
+	process_req->iov.iov_len = process->max_window_size * raid_bdev->bdev.blocklen;
+	process_req->iov.iov_base = spdk_dma_malloc(process_req->iov.iov_len, 4096, NULL);
+	if (process_req->iov.iov_base == NULL) {
+		free(process_req);
+		return NULL;
+	}
+
+	if (spdk_bdev_is_md_separate(&raid_bdev->bdev)) {
+		process_req->md_buf = spdk_dma_malloc(process->max_window_size * raid_bdev->bdev.md_len,
+						      4096, NULL);
+		if (process_req->md_buf == NULL) {
+			raid_bdev_process_request_free(process_req);
+			return NULL;
+		}
+	}
+
+	return process_req;
+}
+
+static void
+raid_bdev_process_free(struct raid_bdev_process *process)
+{
+	struct raid_bdev_process_request *process_req;
+
+	while ((process_req = TAILQ_FIRST(&process->requests)) != NULL) {
+		TAILQ_REMOVE(&process->requests, process_req, link);
+		raid_bdev_process_request_free(process_req);
+	}
+
+	free(process->resync_bitmap);
+	free(process);
+}
+
+static struct raid_bdev_process *
+raid_bdev_process_alloc(struct raid_bdev *raid_bdev, enum raid_process_type type,
+			struct raid_base_bdev_info *target)
+{
+	struct raid_bdev_process *process;
+	struct raid_bdev_process_request *process_req;
+	uint64_t window_size;
+	int i;
+
+	process = calloc(1, sizeof(*process));
+	if (process == NULL) {
+		return NULL;
+	}
+
+	process->raid_bdev = raid_bdev;
+	process->type = type;
+	process->target = target;
+	TAILQ_INIT(&process->requests);
+	TAILQ_INIT(&process->finish_actions);
+
+	/* The windows of the striped raid levels cover whole stripes */
+	if (raid_bdev->strip_size != 0) {
+		process->window_align = raid_bdev->strip_size * raid_bdev->min_base_bdevs_operational;
+	} else {
+		process->window_align = 1;
+	}
+
+	window_size = spdk_divide_round_up(g_opts.process_window_size_kb * 1024UL,
+					   raid_bdev->bdev.blocklen);
+	window_size = spdk_divide_round_up(window_size, process->window_align) * process->window_align;
+	process->max_window_size = spdk_min(window_size, raid_bdev->bdev.blockcnt);
+
+	for (i = 0; i < RAID_BDEV_PROCESS_MAX_QD; i++) {
+		process_req = raid_bdev_process_alloc_request(process);
+		if (process_req == NULL) {
+			raid_bdev_process_free(process);
+			return NULL;
+		}
+
+		TAILQ_INSERT_TAIL(&process->requests, process_req, link);
+	}
+
+	return process;
+}
+
+static void
+raid_bdev_wib_region_put(struct raid_bdev_wib *wib, uint64_t region)
+{
+	assert(wib->writes[region] > 0);
+	__atomic_fetch_sub(&wib->writes[region], 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Sets the range of the next part of the raid bdev to process. A rebuild processes the whole
+ * raid bdev, a resync and the rebuild of a rejoining member process the dirty regions of the
+ * write-intent bitmap one by one.
+ */
+static bool
+raid_bdev_process_next_range(struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+	uint64_t region_size, r;
+
+	if (process->resync_bitmap == NULL) {
+		assert(process->type == RAID_PROCESS_REBUILD);
+		if (process->range_end != 0) {
+			return false;
+		}
+		process->range_end = raid_bdev->bdev.blockcnt;
+		return true;
+	}
+
+	/* Drop the reference of the region that has just been resynced */
+	if (process->range_end != 0) {
+		r = process->resync_region;
+		process->resync_bitmap[r / 64] &= ~(1ULL << (r % 64));
+		raid_bdev_wib_region_put(wib, r);
+		process->resync_region++;
+	}
+
+	for (r = process->resync_region; r < wib->num_regions; r++) {
+		if (process->resync_bitmap[r / 64] & (1ULL << (r % 64))) {
+			break;
+		}
+	}
+
+	if (r == wib->num_regions) {
+		return false;
+	}
+
+	region_size = 1ULL << wib->region_size_shift;
+	process->resync_region = r;
+	process->window_offset = (r * region_size) / process->window_align * process->window_align;
+	process->range_end = spdk_min(raid_bdev->bdev.blockcnt,
+				      spdk_divide_round_up((r + 1) * region_size, process->window_align) *
+				      process->window_align);
+
+	return true;
+}
+
+/*
+ * Drops the references of the regions that a rebuild of the write-intent bitmap regions
+ * didn't get to. Unlike the ones left by an interrupted resync, these regions stay marked
+ * only while the raid bdev is degraded.
+ */
+static void
+raid_bdev_process_put_regions(struct raid_bdev_process *process)
+{
+	struct raid_bdev_wib *wib = process->raid_bdev->wib;
+	uint64_t r;
+
+	if (process->resync_bitmap == NULL) {
+		return;
+	}
+
+	for (r = process->resync_region; r < wib->num_regions; r++) {
+		if (process->resync_bitmap[r / 64] & (1ULL << (r % 64))) {
+			raid_bdev_wib_region_put(wib, r);
+		}
+	}
+}
+
+static void
+raid_bdev_process_thread_exit(void *ctx)
+{
+	struct raid_bdev_process *process = ctx;
+
+	spdk_thread_exit(spdk_get_thread());
+	raid_bdev_process_free(process);
+}
+
+static void
+raid_bdev_process_finish_write_sb_cb(int status, struct raid_bdev *raid_bdev, void *ctx)
+{
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to write raid bdev '%s' superblock: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-status));
+	}
+}
+
+static void
+raid_bdev_process_finish_target(struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct raid_base_bdev_info *target = process->target;
+
+	if (process->status != 0) {
+		spdk_spin_lock(&raid_bdev->base_bdev_lock);
+		raid_bdev_free_base_bdev_resource(target);
+		spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+
+		if (target->remove_scheduled) {
+			raid_bdev_remove_base_bdev_done(target, 0);
+		}
+		return;
+	}
+
+	raid_bdev->num_base_bdevs_operational++;
+	target->wib_rebuild = false;
+
+	if (raid_bdev->wib != NULL &&
+	    raid_bdev->num_base_bdevs_operational == raid_bdev->num_base_bdevs) {
+		__atomic_store_n(&raid_bdev->wib->degraded, false, __ATOMIC_SEQ_CST);
+	}
+
+	if (raid_bdev->sb != NULL) {
+		struct raid_bdev_superblock *sb = raid_bdev->sb;
+		struct raid_bdev_sb_base_bdev *sb_base_bdev = NULL;
+		uint8_t slot = raid_bdev_base_bdev_slot(target);
+		uint8_t i;
+
+		for (i = 0; i < sb->base_bdevs_size; i++) {
+			sb_base_bdev = &sb->base_bdevs[i];
+
+			if (sb_base_bdev->slot == slot) {
+				break;
+			}
+		}
+
+		assert(i < sb->base_bdevs_size);
+
+		spdk_uuid_copy(&sb_base_bdev->uuid, &target->uuid);
+		sb_base_bdev->data_offset = target->data_offset;
+		sb_base_bdev->data_size = target->data_size;
+		sb_base_bdev->state = RAID_SB_BASE_BDEV_CONFIGURED;
+		sb_base_bdev->flags = target->write_mostly ? RAID_SB_BASE_BDEV_FLAG_WRITE_MOSTLY : 0;
+
+		raid_bdev_write_superblock(raid_bdev, raid_bdev_process_finish_write_sb_cb, NULL);
+	}
+
+	if (target->remove_scheduled) {
+		/* The target was removed while the rebuild was finishing, remove it now */
+		target->remove_scheduled = false;
+		_raid_bdev_remove_base_bdev(target, target->remove_cb, target->remove_cb_ctx);
+	}
+}
+
+static void
+raid_bdev_process_finish_done(void *ctx)
+{
+	struct raid_bdev_process *process = ctx;
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct raid_process_finish_action *finish_action;
+	int rc;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
+	raid_bdev->process = NULL;
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+
+	if (process->type == RAID_PROCESS_REBUILD) {
+		raid_bdev_process_put_regions(process);
+	}
+
+	if (process->target != NULL) {
+		raid_bdev_process_finish_target(process);
+
+		/* Resync the dirty regions that were left while the raid bdev was degraded */
+		if (process->status == 0 && raid_bdev->wib != NULL &&
+		    raid_bdev->wib->resync_bitmap != NULL &&
+		    raid_bdev->num_base_bdevs_operational == raid_bdev->num_base_bdevs &&
+		    raid_bdev->state == RAID_BDEV_STATE_ONLINE && !raid_bdev->destroy_started) {
+			rc = raid_bdev_start_process(raid_bdev, RAID_PROCESS_RESYNC, NULL);
+			if (rc != 0) {
+				SPDK_ERRLOG("Failed to start resync on raid bdev %s: %s\n",
+					    raid_bdev->bdev.name, spdk_strerror(-rc));
+			}
+		}
+	}
+
+	while ((finish_action = TAILQ_FIRST(&process->finish_actions)) != NULL) {
+		TAILQ_REMOVE(&process->finish_actions, finish_action, link);
+		finish_action->cb(finish_action->cb_ctx);
+		free(finish_action);
+	}
+
+	/*
+	 * The process is freed on its own thread, after any stop messages that were sent to it
+	 * before it finished.
+	 */
+	spdk_thread_send_msg(process->thread, raid_bdev_process_thread_exit, process);
+}
+
+static void
+raid_bdev_process_thread_fini(struct raid_bdev_process *process)
+{
+	spdk_poller_unregister(&process->qos_poller);
+
+	if (process->target_ch != NULL) {
+		spdk_put_io_channel(process->target_ch);
+		process->target_ch = NULL;
+	}
+
+	if (process->raid_ch != NULL) {
+		spdk_put_io_channel(spdk_io_channel_from_ctx(process->raid_ch));
+		process->raid_ch = NULL;
+	}
+
+	process->state = RAID_PROCESS_STATE_STOPPED;
+
+	spdk_thread_send_msg(spdk_thread_get_app_thread(), raid_bdev_process_finish_done, process);
+}
+
+static void
+raid_bdev_process_finish_unquiesced(void *ctx, int status)
+{
+	struct raid_bdev_process *process = ctx;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to unquiesce raid bdev %s: %s\n",
+			    process->raid_bdev->bdev.name, spdk_strerror(-status));
+	}
+
+	raid_bdev_process_thread_fini(process);
+}
+
+static void
+raid_bdev_channel_process_finish(struct spdk_io_channel_iter *i)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
+	uint8_t slot = raid_bdev_base_bdev_slot(process->target);
+
+	if (raid_ch->process.ch_processed != NULL) {
+		if (process->status == 0) {
+			/*
+			 * The target's channel moves to this channel. The copy stays until the
+			 * channel is destroyed, as the I/O in progress may still refer to it.
+			 */
+			assert(raid_ch->base_channel[slot] == NULL);
+			raid_ch->base_channel[slot] = raid_ch->process.ch_processed->base_channel[slot];
+			raid_ch->process.offset = RAID_OFFSET_BLOCKS_INVALID;
+		} else {
+			raid_bdev_ch_process_cleanup(raid_ch);
+		}
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+raid_bdev_channels_process_finish_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	int rc;
+
+	if (process->status != 0 && process->bdev_quiesced) {
+		rc = spdk_bdev_unquiesce(&raid_bdev->bdev, &g_raid_if,
+					 raid_bdev_process_finish_unquiesced, process);
+		if (rc != 0) {
+			raid_bdev_process_finish_unquiesced(process, rc);
+		}
+		return;
+	}
+
+	raid_bdev_process_thread_fini(process);
+}
+
+static void
+raid_bdev_process_finish_quiesced(void *ctx, int status)
+{
+	struct raid_bdev_process *process = ctx;
+
+	/* Without the quiesce the raid bdev is being unregistered and has no I/O */
+	process->bdev_quiesced = status == 0;
+
+	spdk_for_each_channel(process->raid_bdev, raid_bdev_channel_process_finish, process,
+			      raid_bdev_channels_process_finish_done);
+}
+
+static void
+raid_bdev_process_finish_unlocked(struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	int rc;
+
+	if (process->status == 0) {
+		SPDK_NOTICELOG("Finished %s on raid bdev %s\n",
+			       raid_bdev_process_to_str(process->type), raid_bdev->bdev.name);
+	} else {
+		SPDK_WARNLOG("Finished %s on raid bdev %s: %s\n",
+			     raid_bdev_process_to_str(process->type), raid_bdev->bdev.name,
+			     spdk_strerror(-process->status));
+	}
+
+	if (process->type != RAID_PROCESS_REBUILD) {
+		raid_bdev_process_thread_fini(process);
+		return;
+	}
+
+	if (process->status == 0) {
+		spdk_spin_lock(&raid_bdev->base_bdev_lock);
+		process->target->is_process_target = false;
+		spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+
+		spdk_for_each_channel(raid_bdev, raid_bdev_channel_process_finish, process,
+				      raid_bdev_channels_process_finish_done);
+	} else {
+		/* The I/O to the target has to be drained before its channels are released */
+		rc = spdk_bdev_quiesce(&raid_bdev->bdev, &g_raid_if, raid_bdev_process_finish_quiesced,
+				       process);
+		if (rc != 0) {
+			raid_bdev_process_finish_quiesced(process, rc);
+		}
+	}
+}
+
+static void
+raid_bdev_process_window_range_unlocked(void *ctx, int status)
+{
+	struct raid_bdev_process *process = ctx;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to unquiesce range of raid bdev %s: %s\n",
+			    process->raid_bdev->bdev.name, spdk_strerror(-status));
+	}
+
+	if (process->state == RAID_PROCESS_STATE_STOPPING) {
+		raid_bdev_process_finish_unlocked(process);
+	} else if (status != 0) {
+		raid_bdev_process_finish(process, status);
+	} else {
+		raid_bdev_process_thread_run(process);
+	}
+}
+
+static void
+raid_bdev_process_unlock_window_range(struct raid_bdev_process *process)
+{
+	int rc;
+
+	assert(process->window_range_locked == true);
+	process->window_range_locked = false;
+
+	rc = spdk_bdev_unquiesce_range(&process->raid_bdev->bdev, &g_raid_if,
+				       process->window_range_offset, process->window_range_size,
+				       raid_bdev_process_window_range_unlocked, process);
+	if (rc != 0) {
+		raid_bdev_process_window_range_unlocked(process, rc);
+	}
+}
+
+static void
+raid_bdev_process_finish(struct raid_bdev_process *process, int status)
+{
+	assert(spdk_get_thread() == process->thread);
+
+	if (process->status == 0) {
+		process->status = status;
+	}
+
+	if (process->state != RAID_PROCESS_STATE_RUNNING) {
+		return;
+	}
+
+	process->state = RAID_PROCESS_STATE_STOPPING;
+
+	if (process->window_range_locked) {
+		raid_bdev_process_unlock_window_range(process);
+	} else {
+		raid_bdev_process_finish_unlocked(process);
+	}
+}
+
+static void
+raid_bdev_channel_process_update(struct spdk_io_channel_iter *i)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
+
+	if (raid_ch->process.ch_processed != NULL) {
+		raid_ch->process.offset = process->window_offset;
+		if (process->resync_bitmap == NULL) {
+			raid_ch->process.write_offset = process->window_offset;
+		}
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+raid_bdev_channels_process_update_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+
+	raid_bdev_process_unlock_window_range(process);
+}
+
+static void
+raid_bdev_process_window_done(struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+
+	if (process->window_status != 0) {
+		raid_bdev_process_finish(process, process->window_status);
+		return;
+	}
+
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
+	process->window_offset += process->window_size;
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+
+	if (process->type == RAID_PROCESS_REBUILD) {
+		/* Let the channels use the target for the rebuilt range before unquiescing it */
+		spdk_for_each_channel(raid_bdev, raid_bdev_channel_process_update, process,
+				      raid_bdev_channels_process_update_done);
+	} else {
+		raid_bdev_process_unlock_window_range(process);
+	}
+}
+
+static void
+raid_bdev_process_window_submit(struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct raid_bdev_process_request *process_req;
+	int ret;
+
+	while (process->window_submitted < process->window_size &&
+	       (process_req = TAILQ_FIRST(&process->requests)) != NULL) {
+		process_req->target = process->target;
+		process_req->target_ch = process->target_ch;
+		process_req->offset_blocks = process->window_offset + process->window_submitted;
+		process_req->num_blocks = process->window_size - process->window_submitted;
+		process_req->iov.iov_len = process->max_window_size * raid_bdev->bdev.blocklen;
+		process_req->status = 0;
+
+		ret = raid_bdev->module->submit_process_request(process_req, process->raid_ch);
+		if (ret <= 0) {
+			/* -ENOMEM is retried when a request completes, if there is any */
+			if (ret != -ENOMEM || process->window_remaining == 0) {
+				SPDK_ERRLOG("Failed to submit process request on raid bdev %s: %s\n",
+					    raid_bdev->bdev.name, spdk_strerror(ret == 0 ? EINVAL : -ret));
+				process->window_status = ret == 0 ? -EINVAL : ret;
+			}
+			break;
+		}
+
+		assert((uint64_t)ret <= process_req->num_blocks);
+		TAILQ_REMOVE(&process->requests, process_req, link);
+		process_req->num_blocks = ret;
+		process->window_submitted += ret;
+		process->window_remaining += ret;
+	}
+
+	if (process->window_remaining == 0) {
+		raid_bdev_process_window_done(process);
+	}
+}
+
+static void
+_raid_bdev_process_request_complete(void *ctx)
+{
+	struct raid_bdev_process_request *process_req = ctx;
+	struct raid_bdev_process *process = process_req->process;
+
+	assert(process->window_remaining >= process_req->num_blocks);
+	process->window_remaining -= process_req->num_blocks;
+
+	if (process_req->status != 0) {
+		process->window_status = process_req->status;
+	}
+
+	TAILQ_INSERT_TAIL(&process->requests, process_req, link);
+
+	if (process->window_status == 0 && process->window_submitted < process->window_size) {
+		raid_bdev_process_window_submit(process);
+	} else if (process->window_remaining == 0) {
+		raid_bdev_process_window_done(process);
+	}
+}
+
+void
+raid_bdev_process_request_complete(struct raid_bdev_process_request *process_req, int status)
+{
+	process_req->status = status;
+
+	/* Always deferred, so that the request isn't completed before the submit returns */
+	spdk_thread_send_msg(process_req->process->thread, _raid_bdev_process_request_complete,
+			     process_req);
+}
+
+static void
+raid_bdev_process_window_range_locked(void *ctx, int status)
+{
+	struct raid_bdev_process *process = ctx;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to quiesce range of raid bdev %s: %s\n",
+			    process->raid_bdev->bdev.name, spdk_strerror(-status));
+		raid_bdev_process_finish(process, status);
+		return;
+	}
+
+	process->window_range_locked = true;
+
+	if (process->status != 0) {
+		raid_bdev_process_finish(process, process->status);
+		return;
+	}
+
+	raid_bdev_process_window_submit(process);
+}
+
+static int
+raid_bdev_process_qos_poll(void *ctx)
+{
+	struct raid_bdev_process *process = ctx;
+
+	spdk_poller_unregister(&process->qos_poller);
+
+	raid_bdev_process_thread_run(process);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+raid_bdev_process_thread_run(struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	uint64_t now, ticks_hz;
+	int rc;
+
+	assert(spdk_get_thread() == process->thread);
+	assert(process->window_remaining == 0);
+	assert(process->window_range_locked == false);
+
+	if (process->status != 0) {
+		raid_bdev_process_finish(process, process->status);
+		return;
+	}
+
+	if (process->window_offset >= process->range_end && !raid_bdev_process_next_range(process)) {
+		raid_bdev_process_finish(process, 0);
+		return;
+	}
+
+	now = spdk_get_ticks();
+	ticks_hz = spdk_get_ticks_hz();
+
+	if (now < process->next_window_tsc) {
+		process->qos_poller = SPDK_POLLER_REGISTER(raid_bdev_process_qos_poll, process,
+				      (process->next_window_tsc - now) * SPDK_SEC_TO_USEC / ticks_hz);
+		return;
+	}
+
+	process->window_size = spdk_min(process->max_window_size,
+					process->range_end - process->window_offset);
+	process->window_submitted = 0;
+	process->window_status = 0;
+
+	if (process->max_bandwidth_mb_sec != 0) {
+		process->next_window_tsc = now + process->window_size * raid_bdev->bdev.blocklen *
+					   ticks_hz / (process->max_bandwidth_mb_sec * 1024ULL * 1024ULL);
+	}
+
+	process->window_range_offset = process->window_offset;
+	process->window_range_size = process->window_size;
+
+	rc = spdk_bdev_quiesce_range(&raid_bdev->bdev, &g_raid_if, process->window_offset,
+				     process->window_size, raid_bdev_process_window_range_locked, process);
+	if (rc != 0) {
+		raid_bdev_process_window_range_locked(process, rc);
+	}
+}
+
+static void
+raid_bdev_channel_process_setup(struct spdk_io_channel_iter *i)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
+	int rc;
+
+	rc = raid_bdev_ch_process_setup(raid_ch, process);
+
+	spdk_for_each_channel_continue(i, rc);
+}
+
+static void
+raid_bdev_channels_process_setup_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to set up io channels for the %s of raid bdev %s: %s\n",
+			    raid_bdev_process_to_str(process->type), process->raid_bdev->bdev.name,
+			    spdk_strerror(-status));
+		raid_bdev_process_finish(process, status);
+		return;
+	}
+
+	raid_bdev_process_thread_run(process);
+}
+
+static void
+raid_bdev_process_thread_init(void *ctx)
+{
+	struct raid_bdev_process *process = ctx;
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct spdk_io_channel *ch;
+
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
+	process->state = RAID_PROCESS_STATE_RUNNING;
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+
+	ch = spdk_get_io_channel(raid_bdev);
+	if (ch == NULL) {
+		raid_bdev_process_finish(process, -ENOMEM);
+		return;
+	}
+	process->raid_ch = spdk_io_channel_get_ctx(ch);
+
+	if (process->target != NULL) {
+		process->target_ch = spdk_bdev_get_io_channel(process->target->desc);
+		if (process->target_ch == NULL) {
+			raid_bdev_process_finish(process, -ENOMEM);
+			return;
+		}
+
+		spdk_for_each_channel(raid_bdev, raid_bdev_channel_process_setup, process,
+				      raid_bdev_channels_process_setup_done);
+	} else {
+		raid_bdev_process_thread_run(process);
+	}
+}
+
+static void
+_raid_bdev_process_stop(void *ctx)
+{
+	struct raid_bdev_process *process = ctx;
+
+	if (process->state != RAID_PROCESS_STATE_RUNNING) {
+		return;
+	}
+
+	if (process->status == 0) {
+		process->status = process->stop_status;
+	}
+
+	/* Otherwise the process stops when the I/O of the current window is done */
+	if (process->qos_poller != NULL) {
+		spdk_poller_unregister(&process->qos_poller);
+		raid_bdev_process_finish(process, process->status);
+	}
+}
+
+static void
+raid_bdev_process_stop(struct raid_bdev_process *process, int status, spdk_msg_fn cb,
+		       void *cb_ctx)
+{
+	struct raid_process_finish_action *finish_action;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+	assert(status != 0);
+
+	if (cb != NULL) {
+		finish_action = calloc(1, sizeof(*finish_action));
+		if (finish_action == NULL) {
+			SPDK_ERRLOG("Failed to allocate process finish action\n");
+			assert(false);
+		} else {
+			finish_action->cb = cb;
+			finish_action->cb_ctx = cb_ctx;
+			TAILQ_INSERT_TAIL(&process->finish_actions, finish_action, link);
+		}
+	}
+
+	if (process->stop_status == 0) {
+		process->stop_status = status;
+		spdk_thread_send_msg(process->thread, _raid_bdev_process_stop, process);
+	}
+}
+
+/*
+ * Copies the bitmap for the rebuild of a rejoining member. The dirty regions get a reference,
+ * so that they stay marked until they are rebuilt.
+ */
+static uint64_t *
+raid_bdev_wib_get_dirty(struct raid_bdev_wib *wib)
+{
+	uint64_t *bitmap;
+	uint64_t r;
+
+	bitmap = calloc(1, wib->nbytes);
+	if (bitmap == NULL) {
+		return NULL;
+	}
+
+	spdk_spin_lock(&wib->lock);
+	memcpy(bitmap, wib->bitmap, wib->nbytes);
+	for (r = 0; r < wib->num_regions; r++) {
+		if (bitmap[r / 64] & (1ULL << (r % 64))) {
+			__atomic_fetch_add(&wib->writes[r], 1, __ATOMIC_SEQ_CST);
+		}
+	}
+	spdk_spin_unlock(&wib->lock);
+
+	return bitmap;
+}
+
+static int
+raid_bdev_start_process(struct raid_bdev *raid_bdev, enum raid_process_type type,
+			struct raid_base_bdev_info *target)
+{
+	struct raid_bdev_process *process;
+	char thread_name[RAID_BDEV_SB_NAME_SIZE + 16];
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+	assert(raid_bdev->module->submit_process_request != NULL);
+
+	if (raid_bdev->process != NULL) {
+		return -EBUSY;
+	}
+
+	process = raid_bdev_process_alloc(raid_bdev, type, target);
+	if (process == NULL) {
+		return -ENOMEM;
+	}
+
+	process->max_bandwidth_mb_sec = g_opts.process_max_bandwidth_mb_sec;
+
+	if (type == RAID_PROCESS_RESYNC) {
+		assert(raid_bdev->wib != NULL && raid_bdev->wib->resync_bitmap != NULL);
+		process->resync_bitmap = raid_bdev->wib->resync_bitmap;
+		raid_bdev->wib->resync_bitmap = NULL;
+	} else if (target->wib_rebuild && raid_bdev->wib != NULL) {
+		process->resync_bitmap = raid_bdev_wib_get_dirty(raid_bdev->wib);
+		if (process->resync_bitmap == NULL) {
+			raid_bdev_process_free(process);
+			return -ENOMEM;
+		}
+	}
+
+	/* Not pinned to any core, the scheduler places the process thread like any other */
+	snprintf(thread_name, sizeof(thread_name), "%s_%s", raid_bdev->bdev.name,
+		 raid_bdev_process_to_str(type));
+	process->thread = spdk_thread_create(thread_name, NULL);
+	if (process->thread == NULL) {
+		SPDK_ERRLOG("Failed to create %s thread for raid bdev %s\n",
+			    raid_bdev_process_to_str(type), raid_bdev->bdev.name);
+		if (type == RAID_PROCESS_REBUILD) {
+			raid_bdev_process_put_regions(process);
+		}
+		raid_bdev_process_free(process);
+		return -ENOMEM;
+	}
+
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
+	raid_bdev->process = process;
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+
+	SPDK_NOTICELOG("Started %s on raid bdev %s\n", raid_bdev_process_to_str(type),
+		       raid_bdev->bdev.name);
+
+	spdk_thread_send_msg(process->thread, raid_bdev_process_thread_init, process);
+
+	return 0;
+}
+
+static void
+raid_bdev_wib_free(struct raid_bdev_wib *wib)
+{
+	spdk_dma_free(wib->bitmap);
+	spdk_dma_free(wib->write_buf);
+	free(wib->writes);
+	free(wib->persisted);
+	free(wib->touched);
+	free(wib->resync_bitmap);
+	spdk_spin_destroy(&wib->lock);
+	free(wib);
+}
+
+static struct raid_bdev_wib *
+raid_bdev_wib_alloc(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_superblock *sb = raid_bdev->sb;
+	struct raid_bdev_wib *wib;
+
+	assert(spdk_u64_is_pow2(sb->wib_region_size));
+
+	wib = calloc(1, sizeof(*wib));
+	if (wib == NULL) {
+		return NULL;
+	}
+
+	wib->raid_bdev = raid_bdev;
+	wib->num_regions = spdk_divide_round_up(raid_bdev->bdev.blockcnt, sb->wib_region_size);
+	wib->region_size_shift = spdk_u64log2(sb->wib_region_size);
+	wib->nbytes = (uint64_t)sb->wib_size * sb->block_size;
+	spdk_spin_init(&wib->lock);
+	TAILQ_INIT(&wib->waiting);
+	TAILQ_INIT(&wib->flushing);
+
+	if (wib->num_regions > wib->nbytes * 8) {
+		SPDK_ERRLOG("Write-intent bitmap of raid bdev %s is too small\n", raid_bdev->bdev.name);
+		raid_bdev_wib_free(wib);
+		return NULL;
+	}
+
+	wib->bitmap = spdk_dma_zmalloc(wib->nbytes, 4096, NULL);
+	wib->write_buf = spdk_dma_zmalloc(wib->nbytes, 4096, NULL);
+	wib->writes = calloc(wib->num_regions, sizeof(*wib->writes));
+	wib->persisted = calloc(wib->num_regions, sizeof(*wib->persisted));
+	wib->touched = calloc(wib->num_regions, sizeof(*wib->touched));
+	if (wib->bitmap == NULL || wib->write_buf == NULL || wib->writes == NULL ||
+	    wib->persisted == NULL || wib->touched == NULL) {
+		raid_bdev_wib_free(wib);
+		return NULL;
+	}
+
+	return wib;
+}
+
+/*
+ * The regions marked in the bitmap that was read at startup hold a reference until they are
+ * resynced, so they stay marked until then.
+ */
+static int
+raid_bdev_wib_load(struct raid_bdev_wib *wib)
+{
+	uint64_t r, dirty = 0;
+
+	for (r = 0; r < wib->nbytes * 8; r++) {
+		if (!(wib->bitmap[r / 64] & (1ULL << (r % 64)))) {
+			continue;
+		}
+
+		if (r >= wib->num_regions) {
+			wib->bitmap[r / 64] &= ~(1ULL << (r % 64));
+			continue;
+		}
+
+		wib->writes[r] = 1;
+		wib->persisted[r] = 1;
+		dirty++;
+	}
+
+	if (dirty == 0) {
+		return 0;
+	}
+
+	SPDK_NOTICELOG("Raid bdev %s has %" PRIu64 " dirty regions in the write-intent bitmap\n",
+		       wib->raid_bdev->bdev.name, dirty);
+
+	wib->resync_bitmap = calloc(1, wib->nbytes);
+	if (wib->resync_bitmap == NULL) {
+		return -ENOMEM;
+	}
+	memcpy(wib->resync_bitmap, wib->bitmap, wib->nbytes);
+
+	return 0;
+}
+
+static void raid_bdev_wib_flush(struct raid_bdev_wib *wib);
+
+static void
+raid_bdev_wib_stop_write_cb(int status, struct raid_bdev *raid_bdev, void *ctx)
+{
+	struct raid_bdev_wib *wib = ctx;
+	spdk_msg_fn stop_cb = wib->stop_cb;
+	void *stop_cb_ctx = wib->stop_cb_ctx;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to write the write-intent bitmap of raid bdev %s: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-status));
+	}
+
+	raid_bdev->wib = NULL;
+	raid_bdev_wib_free(wib);
+
+	stop_cb(stop_cb_ctx);
+}
+
+/*
+ * All writes are done, so only the regions that still wait for a resync stay marked on the
+ * base bdevs.
+ */
+static void
+_raid_bdev_wib_stop(struct raid_bdev_wib *wib)
+{
+	uint64_t r;
+
+	memset(wib->write_buf, 0, wib->nbytes);
+	for (r = 0; r < wib->num_regions; r++) {
+		if (wib->writes[r] != 0) {
+			wib->write_buf[r / 64] |= 1ULL << (r % 64);
+		}
+	}
+
+	raid_bdev_write_wib(wib->raid_bdev, wib->write_buf, raid_bdev_wib_stop_write_cb, wib);
+}
+
+static void
+raid_bdev_wib_flush_done(int status, struct raid_bdev *raid_bdev, void *ctx)
+{
+	struct raid_bdev_wib *wib = ctx;
+	TAILQ_HEAD(, raid_bdev_io) flushed = TAILQ_HEAD_INITIALIZER(flushed);
+	struct raid_bdev_io *raid_io;
+	struct spdk_thread *thread;
+	uint64_t r, word;
+	bool flush_again;
+
+	spdk_spin_lock(&wib->lock);
+
+	/* The bits that were written and are still set can be used without waiting */
+	for (r = 0; r < wib->num_regions; r++) {
+		word = wib->write_buf[r / 64] & wib->bitmap[r / 64];
+		__atomic_store_n(&wib->persisted[r], status == 0 && (word & (1ULL << (r % 64))),
+				 __ATOMIC_SEQ_CST);
+	}
+
+	TAILQ_CONCAT(&flushed, &wib->flushing, module_link);
+	wib->flush_in_progress = false;
+	flush_again = wib->flush_needed;
+
+	spdk_spin_unlock(&wib->lock);
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to write the write-intent bitmap of raid bdev %s: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-status));
+	}
+
+	while ((raid_io = TAILQ_FIRST(&flushed)) != NULL) {
+		TAILQ_REMOVE(&flushed, raid_io, module_link);
+
+		if (status != 0) {
+			raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+			continue;
+		}
+
+		thread = spdk_io_channel_get_thread(spdk_io_channel_from_ctx(raid_io->raid_ch));
+		spdk_thread_send_msg(thread, _raid_bdev_submit_write_request, raid_io);
+	}
+
+	if (flush_again) {
+		raid_bdev_wib_flush(wib);
+	} else if (wib->stop_cb != NULL) {
+		_raid_bdev_wib_stop(wib);
+	}
+}
+
+static void
+raid_bdev_wib_flush(struct raid_bdev_wib *wib)
+{
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+
+	spdk_spin_lock(&wib->lock);
+
+	if (wib->flush_in_progress) {
+		spdk_spin_unlock(&wib->lock);
+		return;
+	}
+
+	if (!wib->flush_needed) {
+		spdk_spin_unlock(&wib->lock);
+		if (wib->stop_cb != NULL) {
+			_raid_bdev_wib_stop(wib);
+		}
+		return;
+	}
+
+	wib->flush_needed = false;
+	wib->flush_in_progress = true;
+	memcpy(wib->write_buf, wib->bitmap, wib->nbytes);
+	TAILQ_CONCAT(&wib->flushing, &wib->waiting, module_link);
+
+	spdk_spin_unlock(&wib->lock);
+
+	raid_bdev_write_wib(wib->raid_bdev, wib->write_buf, raid_bdev_wib_flush_done, wib);
+}
+
+static void
+raid_bdev_wib_flush_msg(void *ctx)
+{
+	struct raid_bdev_wib *wib = ctx;
+
+	spdk_spin_lock(&wib->lock);
+	wib->flush_scheduled = false;
+	spdk_spin_unlock(&wib->lock);
+
+	raid_bdev_wib_flush(wib);
+}
+
+/*
+ * Clears the bits of the regions that had no writes since the previous run. A region's
+ * persisted flag is reset before its writes counter is checked, so a write racing with the
+ * clearing either is seen here or takes the slow path and sets the bit again.
+ */
+static int
+raid_bdev_wib_clear_poll(void *ctx)
+{
+	struct raid_bdev_wib *wib = ctx;
+	uint64_t r;
+	uint8_t persisted;
+	bool cleared = false;
+
+	if (__atomic_load_n(&wib->degraded, __ATOMIC_SEQ_CST)) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	spdk_spin_lock(&wib->lock);
+
+	for (r = 0; r < wib->num_regions; r++) {
+		if (!(wib->bitmap[r / 64] & (1ULL << (r % 64)))) {
+			continue;
+		}
+
+		if (__atomic_load_n(&wib->touched[r], __ATOMIC_RELAXED)) {
+			__atomic_store_n(&wib->touched[r], 0, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		persisted = __atomic_exchange_n(&wib->persisted[r], 0, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&wib->writes[r], __ATOMIC_SEQ_CST) != 0) {
+			__atomic_store_n(&wib->persisted[r], persisted, __ATOMIC_SEQ_CST);
+			continue;
+		}
+
+		wib->bitmap[r / 64] &= ~(1ULL << (r % 64));
+		cleared = true;
+	}
+
+	if (cleared) {
+		wib->flush_needed = true;
+	}
+
+	spdk_spin_unlock(&wib->lock);
+
+	if (cleared) {
+		raid_bdev_wib_flush(wib);
+	}
+
+	return cleared ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+static void
+raid_bdev_wib_start(struct raid_bdev_wib *wib)
+{
+	wib->clear_poller = SPDK_POLLER_REGISTER(raid_bdev_wib_clear_poll, wib,
+			    RAID_BDEV_WIB_CLEAR_PERIOD_US);
+}
+
+static void
+raid_bdev_wib_stop(struct raid_bdev_wib *wib, spdk_msg_fn cb, void *cb_ctx)
+{
+	bool busy;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+	assert(TAILQ_EMPTY(&wib->waiting));
+
+	spdk_poller_unregister(&wib->clear_poller);
+
+	wib->stop_cb = cb;
+	wib->stop_cb_ctx = cb_ctx;
+
+	spdk_spin_lock(&wib->lock);
+	busy = wib->flush_in_progress || wib->flush_scheduled;
+	spdk_spin_unlock(&wib->lock);
+
+	/* Otherwise the flush in progress completes the stop */
+	if (!busy) {
+		_raid_bdev_wib_stop(wib);
+	}
+}
 
-/*
- * brief:
- * raid_bdev_init is the initialization function for raid bdev module
- * params:
- * none
- * returns:
- * 0 - success
- * non zero - failure
- */
-static int
-raid_bdev_init(void)
+static void
+raid_bdev_wib_discard(struct raid_bdev *raid_bdev)
 {
-	return 0;
+	if (raid_bdev->wib != NULL) {
+		raid_bdev_wib_free(raid_bdev->wib);
+		raid_bdev->wib = NULL;
+	}
 }
 
 static int
@@ -1040,6 +2855,11 @@ _raid_bdev_create(const char *name, uint32_t strip_size, uint8_t num_base_bdevs,
 		return -EINVAL;
 	}
 
+	if (level == RAID10 && num_base_bdevs % 2 != 0) {
+		SPDK_ERRLOG("raid10 requires an even number of base bdevs\n");
+		return -EINVAL;
+	}
+
 	module = raid_bdev_module_find(level);
 	if (module == NULL) {
 		SPDK_ERRLOG("Unsupported raid level '%d'\n", level);
@@ -1249,6 +3069,7 @@ raid_bdev_configure_cont(struct raid_bdev *raid_bdev)
 	rc = spdk_bdev_register(raid_bdev_gen);
 	if (rc != 0) {
 		SPDK_ERRLOG("Unable to register raid bdev and stay at configuring state\n");
+		raid_bdev_wib_discard(raid_bdev);
 		if (raid_bdev->module->stop != NULL) {
 			raid_bdev->module->stop(raid_bdev);
 		}
@@ -1259,6 +3080,29 @@ raid_bdev_configure_cont(struct raid_bdev *raid_bdev)
 	SPDK_DEBUGLOG(bdev_raid, "raid bdev generic %p\n", raid_bdev_gen);
 	SPDK_DEBUGLOG(bdev_raid, "raid bdev is created with name %s, raid_bdev %p\n",
 		      raid_bdev_gen->name, raid_bdev);
+
+	if (raid_bdev->wib != NULL) {
+		/* The dirty regions stay marked until the raid bdev is complete again */
+		raid_bdev->wib->degraded = raid_bdev->num_base_bdevs_operational <
+					   raid_bdev->num_base_bdevs;
+		raid_bdev_wib_start(raid_bdev->wib);
+
+		if (raid_bdev->wib->resync_bitmap == NULL) {
+			return;
+		}
+
+		if (raid_bdev->wib->degraded) {
+			SPDK_WARNLOG("Raid bdev %s is degraded, not resyncing its dirty regions\n",
+				     raid_bdev_gen->name);
+			return;
+		}
+
+		rc = raid_bdev_start_process(raid_bdev, RAID_PROCESS_RESYNC, NULL);
+		if (rc != 0) {
+			SPDK_ERRLOG("Failed to start resync on raid bdev %s: %s\n",
+				    raid_bdev_gen->name, spdk_strerror(-rc));
+		}
+	}
 }
 
 static void
@@ -1269,10 +3113,66 @@ raid_bdev_configure_write_sb_cb(int status, struct raid_bdev *raid_bdev, void *c
 	} else {
 		SPDK_ERRLOG("Failed to write raid bdev '%s' superblock: %s\n",
 			    raid_bdev->bdev.name, spdk_strerror(-status));
+		raid_bdev_wib_discard(raid_bdev);
+		if (raid_bdev->module->stop != NULL) {
+			raid_bdev->module->stop(raid_bdev);
+		}
+	}
+}
+
+static void
+raid_bdev_configure_wib_cb(int status, struct raid_bdev *raid_bdev, void *ctx)
+{
+	if (status == 0) {
+		status = raid_bdev_wib_load(raid_bdev->wib);
+	}
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to set up raid bdev '%s' write-intent bitmap: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-status));
+		raid_bdev_wib_discard(raid_bdev);
 		if (raid_bdev->module->stop != NULL) {
 			raid_bdev->module->stop(raid_bdev);
 		}
+		return;
+	}
+
+	raid_bdev_write_superblock(raid_bdev, raid_bdev_configure_write_sb_cb, NULL);
+}
+
+/*
+ * Set up the write-intent bitmap before the superblock is written. The bitmap of a new raid
+ * bdev is zeroed, an existing one is read from the base bdevs. Superblocks that predate the
+ * bitmap get one if there is space for it.
+ */
+static int
+raid_bdev_configure_wib(struct raid_bdev *raid_bdev, bool new_sb)
+{
+	struct raid_bdev_superblock *sb = raid_bdev->sb;
+
+	if (!new_sb && sb->version.minor < 1) {
+		raid_bdev_init_superblock_wib(raid_bdev);
+		sb->version.minor = RAID_BDEV_SB_VERSION_MINOR;
+		new_sb = true;
 	}
+
+	if (sb->wib_size == 0 || raid_bdev->module->submit_process_request == NULL) {
+		raid_bdev_write_superblock(raid_bdev, raid_bdev_configure_write_sb_cb, NULL);
+		return 0;
+	}
+
+	raid_bdev->wib = raid_bdev_wib_alloc(raid_bdev);
+	if (raid_bdev->wib == NULL) {
+		return -ENOMEM;
+	}
+
+	if (new_sb) {
+		raid_bdev_write_wib(raid_bdev, raid_bdev->wib->write_buf, raid_bdev_configure_wib_cb, NULL);
+	} else {
+		raid_bdev_read_wib(raid_bdev, raid_bdev->wib->bitmap, raid_bdev_configure_wib_cb, NULL);
+	}
+
+	return 0;
 }
 
 /*
@@ -1342,7 +3242,9 @@ raid_bdev_configure(struct raid_bdev *raid_bdev)
 	}
 
 	if (raid_bdev->sb != NULL) {
-		if (spdk_uuid_is_null(&raid_bdev->sb->uuid)) {
+		bool new_sb = spdk_uuid_is_null(&raid_bdev->sb->uuid);
+
+		if (new_sb) {
 			/* NULL UUID is not valid in the sb so it means that we are creating a new
 			 * raid bdev and should initialize the superblock.
 			 */
@@ -1365,7 +3267,13 @@ raid_bdev_configure(struct raid_bdev *raid_bdev)
 			}
 		}
 
-		raid_bdev_write_superblock(raid_bdev, raid_bdev_configure_write_sb_cb, NULL);
+		rc = raid_bdev_configure_wib(raid_bdev, new_sb);
+		if (rc != 0) {
+			if (raid_bdev->module->stop != NULL) {
+				raid_bdev->module->stop(raid_bdev);
+			}
+			return rc;
+		}
 	} else {
 		raid_bdev_configure_cont(raid_bdev);
 	}
@@ -1488,6 +3396,9 @@ raid_bdev_remove_base_bdev_on_unquiesced(void *ctx, int status)
 
 		/* TODO: distinguish between failure and intentional removal */
 		sb_base_bdev->state = RAID_SB_BASE_BDEV_FAILED;
+		if (raid_bdev->wib != NULL) {
+			sb_base_bdev->flags |= RAID_SB_BASE_BDEV_FLAG_WIB_TRACKED;
+		}
 
 		raid_bdev_write_superblock(raid_bdev, raid_bdev_remove_base_bdev_write_sb_cb, base_info);
 		return;
@@ -1511,6 +3422,10 @@ raid_bdev_channel_remove_base_bdev(struct spdk_io_channel_iter *i)
 		raid_ch->base_channel[idx] = NULL;
 	}
 
+	if (raid_ch->process.ch_processed != NULL) {
+		raid_ch->process.ch_processed->base_channel[idx] = NULL;
+	}
+
 	spdk_for_each_channel_continue(i, 0);
 }
 
@@ -1524,6 +3439,20 @@ raid_bdev_channels_remove_base_bdev_done(struct spdk_io_channel_iter *i, int sta
 			    base_info);
 }
 
+static void
+raid_bdev_remove_base_bdev_channels(void *ctx)
+{
+	struct raid_base_bdev_info *base_info = ctx;
+
+	/* The write-behind I/O uses the base bdev's io channels */
+	if (raid_bdev_wait_write_behind(base_info, raid_bdev_remove_base_bdev_channels, base_info)) {
+		return;
+	}
+
+	spdk_for_each_channel(base_info->raid_bdev, raid_bdev_channel_remove_base_bdev, base_info,
+			      raid_bdev_channels_remove_base_bdev_done);
+}
+
 static void
 raid_bdev_remove_base_bdev_on_quiesced(void *ctx, int status)
 {
@@ -1537,8 +3466,7 @@ raid_bdev_remove_base_bdev_on_quiesced(void *ctx, int status)
 		return;
 	}
 
-	spdk_for_each_channel(raid_bdev, raid_bdev_channel_remove_base_bdev, base_info,
-			      raid_bdev_channels_remove_base_bdev_done);
+	raid_bdev_remove_base_bdev_channels(base_info);
 }
 
 static int
@@ -1560,7 +3488,13 @@ _raid_bdev_remove_base_bdev(struct raid_base_bdev_info *base_info,
 	base_info->remove_cb = cb_fn;
 	base_info->remove_cb_ctx = cb_ctx;
 
-	if (raid_bdev->state != RAID_BDEV_STATE_ONLINE) {
+	if (raid_bdev->process != NULL && raid_bdev->process->target == base_info) {
+		/*
+		 * The rebuild target is not an operational member yet. It is released when the
+		 * rebuild stops.
+		 */
+		raid_bdev_process_stop(raid_bdev->process, -ENODEV, NULL, NULL);
+	} else if (raid_bdev->state != RAID_BDEV_STATE_ONLINE) {
 		/*
 		 * As raid bdev is not registered yet or already unregistered,
 		 * so cleanup should be done here itself.
@@ -1582,6 +3516,10 @@ _raid_bdev_remove_base_bdev(struct raid_base_bdev_info *base_info,
 	} else {
 		int ret;
 
+		if (raid_bdev->wib != NULL) {
+			__atomic_store_n(&raid_bdev->wib->degraded, true, __ATOMIC_SEQ_CST);
+		}
+
 		ret = spdk_bdev_quiesce(&raid_bdev->bdev, &g_raid_if,
 					raid_bdev_remove_base_bdev_on_quiesced, base_info);
 		if (ret != 0) {
@@ -1621,6 +3559,48 @@ raid_bdev_remove_base_bdev(struct spdk_bdev *base_bdev, raid_bdev_remove_base_bd
 	return _raid_bdev_remove_base_bdev(base_info, cb_fn, cb_ctx);
 }
 
+static void
+_raid_bdev_fail_base_bdev(void *ctx)
+{
+	struct raid_base_bdev_info *base_info = ctx;
+	int rc;
+
+	if (base_info->desc == NULL || base_info->remove_scheduled) {
+		return;
+	}
+
+	SPDK_ERRLOG("Removing failed base bdev %s from raid bdev %s\n", base_info->name,
+		    base_info->raid_bdev->bdev.name);
+
+	rc = _raid_bdev_remove_base_bdev(base_info, NULL, NULL);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to remove base bdev %s: %s\n", base_info->name, spdk_strerror(-rc));
+	}
+}
+
+/*
+ * brief:
+ * raid_bdev_fail_base_bdev is called by the raid modules when a base bdev fails an I/O that
+ * the raid bdev doesn't fail. The base bdev is removed from the raid bdev. Can be called
+ * from any thread.
+ * params:
+ * base_info - raid base bdev info of the failed base bdev
+ * returns:
+ * none
+ */
+void
+raid_bdev_fail_base_bdev(struct raid_base_bdev_info *base_info)
+{
+	struct raid_bdev_wib *wib = base_info->raid_bdev->wib;
+
+	/* Keep the regions written so far marked before the write completes */
+	if (wib != NULL) {
+		__atomic_store_n(&wib->degraded, true, __ATOMIC_SEQ_CST);
+	}
+
+	spdk_thread_send_msg(spdk_thread_get_app_thread(), _raid_bdev_fail_base_bdev, base_info);
+}
+
 /*
  * brief:
  * raid_bdev_resize_base_bdev function is called by below layers when base_bdev
@@ -1741,12 +3721,70 @@ raid_bdev_delete(struct raid_bdev *raid_bdev, raid_bdev_destruct_cb cb_fn, void
 	}
 }
 
+/*
+ * Checks that a base bdev added to an online raid bdev can replace its missing member.
+ */
+static int
+raid_bdev_check_rebuild_target(struct raid_base_bdev_info *target)
+{
+	struct raid_bdev *raid_bdev = target->raid_bdev;
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(target->desc);
+	struct raid_base_bdev_info *base_info;
+	uint64_t data_size = 0;
+
+	if (bdev->blocklen != raid_bdev->bdev.blocklen) {
+		SPDK_ERRLOG("Blocklen of bdev %s does not match raid bdev %s\n",
+			    bdev->name, raid_bdev->bdev.name);
+		return -EINVAL;
+	}
+
+	if (spdk_bdev_get_md_size(bdev) != raid_bdev->bdev.md_len ||
+	    spdk_bdev_is_md_interleaved(bdev) != raid_bdev->bdev.md_interleave ||
+	    spdk_bdev_get_dif_type(bdev) != SPDK_DIF_DISABLE) {
+		SPDK_ERRLOG("Metadata format of bdev %s does not match raid bdev %s\n",
+			    bdev->name, raid_bdev->bdev.name);
+		return -EINVAL;
+	}
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info != target && base_info->is_configured) {
+			data_size = base_info->data_size;
+			break;
+		}
+	}
+
+	if (target->data_size < data_size) {
+		SPDK_ERRLOG("Bdev %s is too small for raid bdev %s\n", bdev->name, raid_bdev->bdev.name);
+		return -EINVAL;
+	}
+	target->data_size = data_size;
+
+	return 0;
+}
+
 static void
 raid_bdev_configure_base_bdev_cont(struct raid_base_bdev_info *base_info)
 {
 	struct raid_bdev *raid_bdev = base_info->raid_bdev;
 	int rc;
 
+	if (raid_bdev->state == RAID_BDEV_STATE_ONLINE) {
+		rc = raid_bdev_check_rebuild_target(base_info);
+		if (rc == 0) {
+			base_info->is_configured = true;
+			raid_bdev->num_base_bdevs_discovered++;
+			rc = raid_bdev_start_process(raid_bdev, RAID_PROCESS_REBUILD, base_info);
+		}
+		if (rc != 0) {
+			SPDK_ERRLOG("Failed to start rebuild on raid bdev %s: %s\n",
+				    raid_bdev->bdev.name, spdk_strerror(-rc));
+			spdk_spin_lock(&raid_bdev->base_bdev_lock);
+			raid_bdev_free_base_bdev_resource(base_info);
+			spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+		}
+		return;
+	}
+
 	base_info->is_configured = true;
 
 	raid_bdev->num_base_bdevs_discovered++;
@@ -1768,15 +3806,53 @@ raid_bdev_configure_base_bdev_cont(struct raid_base_bdev_info *base_info)
 	}
 }
 
+/*
+ * Returns the superblock entry of a former member of the raid bdev that failed or was removed
+ * from the base bdev's slot, NULL if the base bdev is not one.
+ */
+static const struct raid_bdev_sb_base_bdev *
+raid_bdev_find_former_member(struct raid_bdev *raid_bdev, const struct spdk_uuid *uuid,
+			     uint8_t slot)
+{
+	const struct raid_bdev_superblock *sb = raid_bdev->sb;
+	uint8_t i;
+
+	if (sb == NULL) {
+		return NULL;
+	}
+
+	for (i = 0; i < sb->base_bdevs_size; i++) {
+		if (sb->base_bdevs[i].slot == slot &&
+		    sb->base_bdevs[i].state == RAID_SB_BASE_BDEV_FAILED &&
+		    spdk_uuid_compare(&sb->base_bdevs[i].uuid, uuid) == 0) {
+			return &sb->base_bdevs[i];
+		}
+	}
+
+	return NULL;
+}
+
 static void
 raid_bdev_configure_base_bdev_check_sb_cb(const struct raid_bdev_superblock *sb, int status,
 		void *ctx)
 {
 	struct raid_base_bdev_info *base_info = ctx;
+	struct raid_bdev *raid_bdev = base_info->raid_bdev;
+	const struct raid_bdev_sb_base_bdev *sb_base_bdev;
 
 	switch (status) {
 	case 0:
 		/* valid superblock found */
+		sb_base_bdev = raid_bdev_find_former_member(raid_bdev, &base_info->uuid,
+				raid_bdev_base_bdev_slot(base_info));
+		if (raid_bdev->state == RAID_BDEV_STATE_ONLINE && sb_base_bdev != NULL &&
+		    spdk_uuid_compare(&sb->uuid, &raid_bdev->bdev.uuid) == 0) {
+			/* A former member rejoins, rebuild only what it missed if that's known */
+			base_info->wib_rebuild = raid_bdev->wib != NULL &&
+						 (sb_base_bdev->flags & RAID_SB_BASE_BDEV_FLAG_WIB_TRACKED);
+			raid_bdev_configure_base_bdev_cont(base_info);
+			break;
+		}
 		SPDK_ERRLOG("Existing raid superblock found on bdev %s\n", base_info->name);
 		raid_bdev_free_base_bdev_resource(base_info);
 		break;
@@ -1865,8 +3941,6 @@ raid_bdev_configure_base_bdev(struct raid_base_bdev_info *base_info, bool existi
 
 	SPDK_DEBUGLOG(bdev_raid, "bdev %s is claimed\n", bdev->name);
 
-	assert(raid_bdev->state != RAID_BDEV_STATE_ONLINE);
-
 	base_info->app_thread_ch = spdk_bdev_get_io_channel(desc);
 	if (base_info->app_thread_ch == NULL) {
 		SPDK_ERRLOG("Failed to get io channel\n");
@@ -1875,7 +3949,14 @@ raid_bdev_configure_base_bdev(struct raid_base_bdev_info *base_info, bool existi
 		return -ENOMEM;
 	}
 
+	/*
+	 * A base bdev added to an online raid bdev must be rebuilt before the io channels of the
+	 * raid bdev can use it.
+	 */
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
 	base_info->desc = desc;
+	base_info->is_process_target = raid_bdev->state == RAID_BDEV_STATE_ONLINE;
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
 	base_info->blockcnt = bdev->blockcnt;
 
 	if (raid_bdev->sb != NULL) {
@@ -1991,6 +4072,78 @@ raid_bdev_add_base_device(struct raid_bdev *raid_bdev, const char *name, uint8_t
 	return 0;
 }
 
+/*
+ * brief:
+ * raid_bdev_add_base_bdev adds a base bdev to a free slot of the raid bdev. If the raid bdev
+ * is online, the new base bdev is rebuilt in the background.
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * name - name of the base bdev
+ * returns:
+ * 0 - success
+ * non zero - failure
+ */
+int
+raid_bdev_add_base_bdev(struct raid_bdev *raid_bdev, const char *name, bool write_mostly)
+{
+	struct raid_base_bdev_info *base_info;
+	struct spdk_bdev *bdev;
+	int rc;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+
+	if (raid_bdev->destroy_started) {
+		return -EBUSY;
+	}
+
+	if (raid_bdev->state == RAID_BDEV_STATE_ONLINE) {
+		if (raid_bdev->module->submit_process_request == NULL) {
+			SPDK_ERRLOG("Raid level %s does not support adding base bdevs to an online raid bdev\n",
+				    raid_bdev_level_to_str(raid_bdev->level));
+			return -ENOTSUP;
+		}
+
+		if (raid_bdev->process != NULL) {
+			SPDK_ERRLOG("Raid bdev %s is busy with a %s\n", raid_bdev->bdev.name,
+				    raid_bdev_process_to_str(raid_bdev->process->type));
+			return -EBUSY;
+		}
+	} else if (raid_bdev->state != RAID_BDEV_STATE_CONFIGURING) {
+		return -EINVAL;
+	}
+
+	/* A former member goes back to its own slot */
+	bdev = spdk_bdev_get_by_name(name);
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->name == NULL && spdk_uuid_is_null(&base_info->uuid) && bdev != NULL &&
+		    raid_bdev_find_former_member(raid_bdev, spdk_bdev_get_uuid(bdev),
+						 raid_bdev_base_bdev_slot(base_info)) != NULL) {
+			break;
+		}
+	}
+
+	if (base_info == raid_bdev->base_bdev_info + raid_bdev->num_base_bdevs) {
+		RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+			if (base_info->name == NULL && spdk_uuid_is_null(&base_info->uuid)) {
+				break;
+			}
+		}
+	}
+
+	if (base_info == raid_bdev->base_bdev_info + raid_bdev->num_base_bdevs) {
+		SPDK_ERRLOG("No free slot on raid bdev %s for bdev %s\n", raid_bdev->bdev.name, name);
+		return -EINVAL;
+	}
+
+	base_info->write_mostly = write_mostly;
+	rc = raid_bdev_add_base_device(raid_bdev, name, raid_bdev_base_bdev_slot(base_info));
+	if (rc != 0) {
+		base_info->write_mostly = false;
+	}
+
+	return rc;
+}
+
 static int
 raid_bdev_create_from_sb(const struct raid_bdev_superblock *sb, struct raid_bdev **raid_bdev_out)
 {
@@ -2018,8 +4171,11 @@ raid_bdev_create_from_sb(const struct raid_bdev_superblock *sb, struct raid_bdev
 
 		base_info->data_offset = sb_base_bdev->data_offset;
 		base_info->data_size = sb_base_bdev->data_size;
+		base_info->write_mostly = sb_base_bdev->flags & RAID_SB_BASE_BDEV_FLAG_WRITE_MOSTLY;
 	}
 
+	raid_bdev->write_behind = sb->write_behind;
+
 	*raid_bdev_out = raid_bdev;
 	return 0;
 }
@@ -2041,6 +4197,43 @@ raid_bdev_examine_no_sb(struct spdk_bdev *bdev)
 	}
 }
 
+/*
+ * A former member that reappears, e.g. when the connection to a remote base bdev is restored,
+ * rejoins the raid bdev with a rebuild of the regions it missed.
+ */
+static void
+raid_bdev_examine_rejoin(struct raid_bdev *raid_bdev,
+			 const struct raid_bdev_sb_base_bdev *sb_base_bdev, struct spdk_bdev *bdev)
+{
+	struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[sb_base_bdev->slot];
+	int rc;
+
+	if (raid_bdev->destroy_started || raid_bdev->process != NULL || base_info->name != NULL ||
+	    !spdk_uuid_is_null(&base_info->uuid)) {
+		SPDK_NOTICELOG("Bdev %s can't rejoin raid bdev %s now. Ignoring.\n",
+			       bdev->name, raid_bdev->bdev.name);
+		return;
+	}
+
+	base_info->name = strdup(bdev->name);
+	if (base_info->name == NULL) {
+		SPDK_ERRLOG("Failed to allocate memory for bdev %s\n", bdev->name);
+		return;
+	}
+	spdk_uuid_copy(&base_info->uuid, spdk_bdev_get_uuid(bdev));
+	base_info->write_mostly = sb_base_bdev->flags & RAID_SB_BASE_BDEV_FLAG_WRITE_MOSTLY;
+	base_info->wib_rebuild = true;
+
+	SPDK_NOTICELOG("Bdev %s rejoins raid bdev %s\n", bdev->name, raid_bdev->bdev.name);
+
+	rc = raid_bdev_configure_base_bdev(base_info, true);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to configure bdev %s as base bdev of raid %s: %s\n",
+			    bdev->name, raid_bdev->bdev.name, spdk_strerror(-rc));
+		raid_bdev_free_base_bdev_resource(base_info);
+	}
+}
+
 static void
 raid_bdev_examine_sb(const struct raid_bdev_superblock *sb, struct spdk_bdev *bdev)
 {
@@ -2114,6 +4307,13 @@ raid_bdev_examine_sb(const struct raid_bdev_superblock *sb, struct spdk_bdev *bd
 		}
 	}
 
+	if (sb_base_bdev->state == RAID_SB_BASE_BDEV_FAILED &&
+	    (sb_base_bdev->flags & RAID_SB_BASE_BDEV_FLAG_WIB_TRACKED) &&
+	    raid_bdev->state == RAID_BDEV_STATE_ONLINE && raid_bdev->wib != NULL) {
+		raid_bdev_examine_rejoin(raid_bdev, sb_base_bdev, bdev);
+		return;
+	}
+
 	if (sb_base_bdev->state != RAID_SB_BASE_BDEV_CONFIGURED) {
 		SPDK_NOTICELOG("Bdev %s is not an active member of raid bdev %s. Ignoring.\n",
 			       bdev->name, raid_bdev->bdev.name);
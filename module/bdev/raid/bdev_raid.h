@@ -15,6 +15,7 @@ enum raid_level {
 	INVALID_RAID_LEVEL	= -1,
 	RAID0			= 0,
 	RAID1			= 1,
+	RAID10			= 10,
 	RAID5F			= 95, /* 0x5f */
 	CONCAT			= 99,
 };
@@ -93,6 +94,31 @@ struct raid_base_bdev_info {
 
 	/* Set to true when base bdev has completed the configuration process */
 	bool			is_configured;
+
+	/*
+	 * Set to true while this base bdev is the target of a rebuild. The io channels of the
+	 * raid bdev only use it for the range that has already been rebuilt.
+	 */
+	bool			is_process_target;
+
+	/*
+	 * Set for a write-mostly member, e.g. a bdev on a remote node. Reads go to it only if
+	 * no other member can serve them and, if the raid module supports it, writes to it may
+	 * complete in the background (write-behind).
+	 */
+	bool			write_mostly;
+
+	/*
+	 * Set when a former member rejoins the raid bdev and only the regions marked in the
+	 * write-intent bitmap have to be rebuilt.
+	 */
+	bool			wib_rebuild;
+
+	/*
+	 * Number of write-behind I/Os in progress on this base bdev. They outlive the raid_io,
+	 * so the base bdev is not released until they are done.
+	 */
+	uint32_t		write_behind_outstanding;
 };
 
 struct raid_bdev_io;
@@ -132,8 +158,60 @@ struct raid_bdev_io {
 
 	/* Custom completion callback. Overrides bdev_io completion if set. */
 	raid_bdev_io_completion_cb	completion_cb;
+
+	/*
+	 * Used by the raid bdev to queue the raid_io until the write-intent bitmap is updated
+	 * and after that by the raid module to put the raid_io into its own list.
+	 */
+	TAILQ_ENTRY(raid_bdev_io)	module_link;
+
+	/* Set if the raid_io holds references on the regions of the write-intent bitmap */
+	bool				wib_tracked;
+};
+
+enum raid_process_type {
+	RAID_PROCESS_NONE,
+	/* Copy or reconstruct the data of a newly added base bdev */
+	RAID_PROCESS_REBUILD,
+	/* Make the regions marked in the write-intent bitmap consistent again */
+	RAID_PROCESS_RESYNC,
+	RAID_PROCESS_MAX
+};
+
+struct raid_bdev_process;
+
+/*
+ * raid_bdev_process_request describes a part of the process window that is processed
+ * by the raid module. Requests are submitted and completed on the process thread.
+ */
+struct raid_bdev_process_request {
+	struct raid_bdev_process	*process;
+
+	/* The base bdev being rebuilt or NULL for a resync */
+	struct raid_base_bdev_info	*target;
+
+	/* io channel of the target base bdev on the process thread */
+	struct spdk_io_channel		*target_ch;
+
+	/* Range of the raid bdev processed by this request */
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+
+	/* Buffer of the size of the process window, for the raid module's use */
+	struct iovec			iov;
+	void				*md_buf;
+
+	/* Used by the raid module to track the base bdev I/Os of the request */
+	struct raid_bdev_io		raid_io;
+
+	/* Completion status, passed to raid_bdev_process_request_complete() */
+	int				status;
+
+	TAILQ_ENTRY(raid_bdev_process_request) link;
 };
 
+struct raid_bdev_wib;
+
 /*
  * raid_bdev is the single entity structure which contains SPDK block device
  * and the information related to any raid bdev either configured or
@@ -164,6 +242,12 @@ struct raid_bdev {
 	/* block length bit shift for optimized calculation */
 	uint32_t			blocklen_shift;
 
+	/*
+	 * Number of blocks whose redundancy a write updates together, e.g. a raid5f stripe.
+	 * Set by the module, 0 or 1 if each block is independent.
+	 */
+	uint64_t			write_unit_blocks;
+
 	/* state of raid bdev */
 	enum raid_bdev_state		state;
 
@@ -196,6 +280,15 @@ struct raid_bdev {
 
 	/* Superblock */
 	struct raid_bdev_superblock	*sb;
+
+	/* Background process (rebuild or resync), NULL if none is running */
+	struct raid_bdev_process	*process;
+
+	/* In-memory state of the write-intent bitmap, NULL if it is disabled */
+	struct raid_bdev_wib		*wib;
+
+	/* Maximum number of write-behind I/Os to the write-mostly members, 0 disables it */
+	uint32_t			write_behind;
 };
 
 #define RAID_FOR_EACH_BASE_BDEV(r, i) \
@@ -215,6 +308,7 @@ int raid_bdev_create(const char *name, uint32_t strip_size, uint8_t num_base_bde
 		     struct raid_bdev **raid_bdev_out);
 void raid_bdev_delete(struct raid_bdev *raid_bdev, raid_bdev_destruct_cb cb_fn, void *cb_ctx);
 int raid_bdev_add_base_device(struct raid_bdev *raid_bdev, const char *name, uint8_t slot);
+int raid_bdev_add_base_bdev(struct raid_bdev *raid_bdev, const char *name, bool write_mostly);
 struct raid_bdev *raid_bdev_find_by_name(const char *name);
 enum raid_level raid_bdev_str_to_level(const char *str);
 const char *raid_bdev_level_to_str(enum raid_level level);
@@ -223,9 +317,22 @@ const char *raid_bdev_state_to_str(enum raid_bdev_state state);
 void raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ctx *w);
 int raid_bdev_remove_base_bdev(struct spdk_bdev *base_bdev, raid_bdev_remove_base_bdev_cb cb_fn,
 			       void *cb_ctx);
+void raid_bdev_fail_base_bdev(struct raid_base_bdev_info *base_info);
 struct spdk_io_channel *raid_bdev_channel_get_base_channel(struct raid_bdev_io_channel *raid_ch,
 		uint8_t idx);
 void *raid_bdev_channel_get_module_ctx(struct raid_bdev_io_channel *raid_ch);
+const char *raid_bdev_process_to_str(enum raid_process_type value);
+
+struct raid_bdev_opts {
+	/* Size of the range of the raid bdev processed at a time by the background process */
+	uint32_t process_window_size_kb;
+
+	/* Maximum bandwidth of the background process, 0 means unlimited */
+	uint32_t process_max_bandwidth_mb_sec;
+};
+
+void raid_bdev_get_opts(struct raid_bdev_opts *opts);
+int raid_bdev_set_opts(const struct raid_bdev_opts *opts);
 
 /*
  * RAID module descriptor
@@ -290,6 +397,20 @@ struct raid_bdev_module {
 	 */
 	void (*resize)(struct raid_bdev *raid_bdev);
 
+	/*
+	 * Handler for background process requests (rebuild and resync). Called on the process
+	 * thread, with the process thread's io channel of the raid bdev, which does not include
+	 * the rebuild target. The range of the request is quiesced. Optional, the raid levels
+	 * that don't implement it can't be rebuilt.
+	 *
+	 * Returns the number of blocks of the request that the module will process, starting
+	 * from its offset, or a negative errno. When the processing is done, the module must
+	 * call raid_bdev_process_request_complete(). -ENOMEM means that the request should be
+	 * retried after another one completes.
+	 */
+	int (*submit_process_request)(struct raid_bdev_process_request *process_req,
+				      struct raid_bdev_io_channel *raid_ch);
+
 	TAILQ_ENTRY(raid_bdev_module) link;
 };
 
@@ -315,6 +436,11 @@ void raid_bdev_io_init(struct raid_bdev_io *raid_io, struct raid_bdev_io_channel
 		       enum spdk_bdev_io_type type, uint64_t offset_blocks,
 		       uint64_t num_blocks, struct iovec *iovs, int iovcnt, void *md_buf,
 		       struct spdk_memory_domain *memory_domain, void *memory_domain_ctx);
+void raid_bdev_process_request_complete(struct raid_bdev_process_request *process_req, int status);
+void raid_bdev_wib_range_get(struct raid_bdev *raid_bdev, uint64_t offset_blocks,
+			     uint64_t num_blocks);
+void raid_bdev_wib_range_put(struct raid_bdev *raid_bdev, uint64_t offset_blocks,
+			     uint64_t num_blocks);
 
 static inline uint8_t
 raid_bdev_base_bdev_slot(struct raid_base_bdev_info *base_info)
@@ -377,7 +503,7 @@ raid_bdev_flush_blocks(struct raid_base_bdev_info *base_info, struct spdk_io_cha
  */
 
 #define RAID_BDEV_SB_VERSION_MAJOR	1
-#define RAID_BDEV_SB_VERSION_MINOR	0
+#define RAID_BDEV_SB_VERSION_MINOR	1
 
 #define RAID_BDEV_SB_NAME_SIZE		64
 
@@ -388,6 +514,11 @@ enum raid_bdev_sb_base_bdev_state {
 	RAID_SB_BASE_BDEV_SPARE		= 3,
 };
 
+/* The base bdev is a write-mostly member */
+#define RAID_SB_BASE_BDEV_FLAG_WRITE_MOSTLY	(1u << 0)
+/* The write-intent bitmap has kept track of the writes that the failed base bdev missed */
+#define RAID_SB_BASE_BDEV_FLAG_WIB_TRACKED	(1u << 1)
+
 struct raid_bdev_sb_base_bdev {
 	/* uuid of the base bdev */
 	struct spdk_uuid	uuid;
@@ -440,7 +571,18 @@ struct raid_bdev_superblock {
 	/* number of raid base devices */
 	uint8_t			num_base_bdevs;
 
-	uint8_t			reserved[118];
+	uint8_t			reserved1[3];
+
+	/* size in blocks of the write-intent bitmap, 0 if the raid has no bitmap (since v1.1) */
+	uint32_t		wib_size;
+	/* offset in blocks from base device start to the write-intent bitmap */
+	uint64_t		wib_offset;
+	/* number of raid bdev blocks covered by a single bit of the write-intent bitmap */
+	uint64_t		wib_region_size;
+	/* maximum number of write-behind I/Os to the write-mostly base bdevs, 0 if disabled */
+	uint32_t		write_behind;
+
+	uint8_t			reserved[91];
 
 	/* size of the base bdevs array */
 	uint8_t			base_bdevs_size;
@@ -455,12 +597,28 @@ SPDK_STATIC_ASSERT(sizeof(struct raid_bdev_superblock) == 256, "incorrect size")
 SPDK_STATIC_ASSERT(RAID_BDEV_SB_MAX_LENGTH < RAID_BDEV_MIN_DATA_OFFSET_SIZE,
 		   "Incorrect min data offset");
 
+/*
+ * The write-intent bitmap is stored on each base bdev right after the superblock. A bit
+ * covers a region of at least RAID_BDEV_WIB_MIN_REGION_SIZE bytes of the raid bdev, larger
+ * raid bdevs use larger regions to stay within RAID_BDEV_WIB_MAX_REGIONS.
+ */
+#define RAID_BDEV_WIB_MIN_REGION_SIZE	(64 * 1024 * 1024) /* 64 MiB */
+#define RAID_BDEV_WIB_MAX_REGIONS	(1u << 16)
+
+SPDK_STATIC_ASSERT(RAID_BDEV_SB_MAX_LENGTH + RAID_BDEV_WIB_MAX_REGIONS / 8 <=
+		   RAID_BDEV_MIN_DATA_OFFSET_SIZE, "Incorrect min data offset");
+
 typedef void (*raid_bdev_write_sb_cb)(int status, struct raid_bdev *raid_bdev, void *ctx);
 typedef void (*raid_bdev_load_sb_cb)(const struct raid_bdev_superblock *sb, int status, void *ctx);
 
 void raid_bdev_init_superblock(struct raid_bdev *raid_bdev);
+void raid_bdev_init_superblock_wib(struct raid_bdev *raid_bdev);
 void raid_bdev_write_superblock(struct raid_bdev *raid_bdev, raid_bdev_write_sb_cb cb,
 				void *cb_ctx);
+void raid_bdev_write_wib(struct raid_bdev *raid_bdev, void *buf, raid_bdev_write_sb_cb cb,
+			 void *cb_ctx);
+void raid_bdev_read_wib(struct raid_bdev *raid_bdev, void *buf, raid_bdev_write_sb_cb cb,
+			void *cb_ctx);
 int raid_bdev_load_base_bdev_superblock(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 					raid_bdev_load_sb_cb cb, void *cb_ctx);
 
@@ -137,6 +137,12 @@ struct rpc_bdev_raid_create {
 
 	/* If set, information about raid bdev will be stored in superblock on each base bdev */
 	bool                                 superblock_enabled;
+
+	/* Base bdevs that are write-mostly members */
+	struct rpc_bdev_raid_create_base_bdevs write_mostly_base_bdevs;
+
+	/* Maximum number of write-behind I/Os to the write-mostly members */
+	uint32_t                             write_behind;
 };
 
 /*
@@ -156,6 +162,9 @@ free_rpc_bdev_raid_create(struct rpc_bdev_raid_create *req)
 	for (i = 0; i < req->base_bdevs.num_base_bdevs; i++) {
 		free(req->base_bdevs.base_bdevs[i]);
 	}
+	for (i = 0; i < req->write_mostly_base_bdevs.num_base_bdevs; i++) {
+		free(req->write_mostly_base_bdevs.base_bdevs[i]);
+	}
 }
 
 /*
@@ -203,8 +212,27 @@ static const struct spdk_json_object_decoder rpc_bdev_raid_create_decoders[] = {
 	{"base_bdevs", offsetof(struct rpc_bdev_raid_create, base_bdevs), decode_base_bdevs},
 	{"uuid", offsetof(struct rpc_bdev_raid_create, uuid), spdk_json_decode_uuid, true},
 	{"superblock", offsetof(struct rpc_bdev_raid_create, superblock_enabled), spdk_json_decode_bool, true},
+	{"write_mostly_base_bdevs", offsetof(struct rpc_bdev_raid_create, write_mostly_base_bdevs), decode_base_bdevs, true},
+	{"write_behind", offsetof(struct rpc_bdev_raid_create, write_behind), spdk_json_decode_uint32, true},
 };
 
+/*
+ * Returns true if the base bdev is in the list of write-mostly base bdevs
+ */
+static bool
+rpc_bdev_raid_create_is_write_mostly(struct rpc_bdev_raid_create *req, const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < req->write_mostly_base_bdevs.num_base_bdevs; i++) {
+		if (strcmp(req->write_mostly_base_bdevs.base_bdevs[i], name) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /*
  * brief:
  * rpc_bdev_raid_create function is the RPC for creating RAID bdevs. It takes
@@ -222,7 +250,7 @@ rpc_bdev_raid_create(struct spdk_jsonrpc_request *request,
 	struct rpc_bdev_raid_create	req = {};
 	struct raid_bdev		*raid_bdev;
 	int				rc;
-	size_t				i;
+	size_t				i, j;
 
 	if (spdk_json_decode_object(params, rpc_bdev_raid_create_decoders,
 				    SPDK_COUNTOF(rpc_bdev_raid_create_decoders),
@@ -232,6 +260,34 @@ rpc_bdev_raid_create(struct spdk_jsonrpc_request *request,
 		goto cleanup;
 	}
 
+	if ((req.write_mostly_base_bdevs.num_base_bdevs != 0 || req.write_behind != 0) &&
+	    req.level != RAID1) {
+		spdk_jsonrpc_send_error_response(request, -EINVAL,
+						 "Write-mostly base bdevs are only supported by raid1");
+		goto cleanup;
+	}
+
+	if (req.write_behind != 0 && !req.superblock_enabled) {
+		spdk_jsonrpc_send_error_response(request, -EINVAL,
+						 "Write-behind requires the superblock");
+		goto cleanup;
+	}
+
+	for (i = 0; i < req.write_mostly_base_bdevs.num_base_bdevs; i++) {
+		for (j = 0; j < req.base_bdevs.num_base_bdevs; j++) {
+			if (strcmp(req.write_mostly_base_bdevs.base_bdevs[i],
+				   req.base_bdevs.base_bdevs[j]) == 0) {
+				break;
+			}
+		}
+		if (j == req.base_bdevs.num_base_bdevs) {
+			spdk_jsonrpc_send_error_response_fmt(request, -EINVAL,
+							     "Write-mostly bdev %s is not a base bdev",
+							     req.write_mostly_base_bdevs.base_bdevs[i]);
+			goto cleanup;
+		}
+	}
+
 	rc = raid_bdev_create(req.name, req.strip_size_kb, req.base_bdevs.num_base_bdevs,
 			      req.level, req.superblock_enabled, &req.uuid, &raid_bdev);
 	if (rc != 0) {
@@ -241,9 +297,13 @@ rpc_bdev_raid_create(struct spdk_jsonrpc_request *request,
 		goto cleanup;
 	}
 
+	raid_bdev->write_behind = req.write_behind;
+
 	for (i = 0; i < req.base_bdevs.num_base_bdevs; i++) {
 		const char *base_bdev_name = req.base_bdevs.base_bdevs[i];
 
+		raid_bdev->base_bdev_info[i].write_mostly = rpc_bdev_raid_create_is_write_mostly(&req,
+				base_bdev_name);
 		rc = raid_bdev_add_base_device(raid_bdev, base_bdev_name, i);
 		if (rc == -ENODEV) {
 			SPDK_DEBUGLOG(bdev_raid, "base bdev %s doesn't exist now\n", base_bdev_name);
@@ -447,3 +507,143 @@ err:
 	rpc_bdev_raid_remove_base_bdev_done(request, rc);
 }
 SPDK_RPC_REGISTER("bdev_raid_remove_base_bdev", rpc_bdev_raid_remove_base_bdev, SPDK_RPC_RUNTIME)
+
+/*
+ * Input structure for RPC rpc_bdev_raid_add_base_bdev
+ */
+struct rpc_bdev_raid_add_base_bdev {
+	/* Base bdev name */
+	char *base_bdev;
+
+	/* Raid bdev name */
+	char *raid_bdev;
+
+	/* Add the base bdev as a write-mostly member */
+	bool write_mostly;
+};
+
+/*
+ * brief:
+ * free_rpc_bdev_raid_add_base_bdev frees RPC bdev_raid_add_base_bdev related parameters
+ * params:
+ * req - pointer to RPC request
+ * returns:
+ * none
+ */
+static void
+free_rpc_bdev_raid_add_base_bdev(struct rpc_bdev_raid_add_base_bdev *req)
+{
+	free(req->base_bdev);
+	free(req->raid_bdev);
+}
+
+/*
+ * Decoder object for RPC bdev_raid_add_base_bdev
+ */
+static const struct spdk_json_object_decoder rpc_bdev_raid_add_base_bdev_decoders[] = {
+	{"base_bdev", offsetof(struct rpc_bdev_raid_add_base_bdev, base_bdev), spdk_json_decode_string},
+	{"raid_bdev", offsetof(struct rpc_bdev_raid_add_base_bdev, raid_bdev), spdk_json_decode_string},
+	{"write_mostly", offsetof(struct rpc_bdev_raid_add_base_bdev, write_mostly), spdk_json_decode_bool, true},
+};
+
+/*
+ * brief:
+ * bdev_raid_add_base_bdev function is the RPC for adding a base bdev to a free slot of a
+ * raid bdev. If the raid bdev is online, the base bdev is rebuilt in the background.
+ * params:
+ * request - pointer to json rpc request
+ * params - pointer to request parameters
+ * returns:
+ * none
+ */
+static void
+rpc_bdev_raid_add_base_bdev(struct spdk_jsonrpc_request *request,
+			    const struct spdk_json_val *params)
+{
+	struct rpc_bdev_raid_add_base_bdev req = {};
+	struct raid_bdev *raid_bdev;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_raid_add_base_bdev_decoders,
+				    SPDK_COUNTOF(rpc_bdev_raid_add_base_bdev_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_PARSE_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	raid_bdev = raid_bdev_find_by_name(req.raid_bdev);
+	if (raid_bdev == NULL) {
+		spdk_jsonrpc_send_error_response_fmt(request, -ENODEV, "raid bdev %s not found",
+						     req.raid_bdev);
+		goto cleanup;
+	}
+
+	if (spdk_bdev_get_by_name(req.base_bdev) == NULL) {
+		spdk_jsonrpc_send_error_response_fmt(request, -ENODEV, "base bdev %s not found",
+						     req.base_bdev);
+		goto cleanup;
+	}
+
+	if (req.write_mostly && raid_bdev->level != RAID1) {
+		spdk_jsonrpc_send_error_response(request, -EINVAL,
+						 "Write-mostly base bdevs are only supported by raid1");
+		goto cleanup;
+	}
+
+	rc = raid_bdev_add_base_bdev(raid_bdev, req.base_bdev, req.write_mostly);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, rc,
+						     "Failed to add base bdev %s to raid bdev %s: %s",
+						     req.base_bdev, req.raid_bdev, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_raid_add_base_bdev(&req);
+}
+SPDK_RPC_REGISTER("bdev_raid_add_base_bdev", rpc_bdev_raid_add_base_bdev, SPDK_RPC_RUNTIME)
+
+static const struct spdk_json_object_decoder rpc_bdev_raid_set_options_decoders[] = {
+	{"process_window_size_kb", offsetof(struct raid_bdev_opts, process_window_size_kb), spdk_json_decode_uint32, true},
+	{"process_max_bandwidth_mb_sec", offsetof(struct raid_bdev_opts, process_max_bandwidth_mb_sec), spdk_json_decode_uint32, true},
+};
+
+/*
+ * brief:
+ * bdev_raid_set_options function is the RPC for setting the global options of the raid
+ * bdev module.
+ * params:
+ * request - pointer to json rpc request
+ * params - pointer to request parameters
+ * returns:
+ * none
+ */
+static void
+rpc_bdev_raid_set_options(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct raid_bdev_opts opts;
+	int rc;
+
+	raid_bdev_get_opts(&opts);
+	if (params && spdk_json_decode_object(params, rpc_bdev_raid_set_options_decoders,
+					      SPDK_COUNTOF(rpc_bdev_raid_set_options_decoders),
+					      &opts)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_PARSE_ERROR,
+						 "spdk_json_decode_object failed");
+		return;
+	}
+
+	rc = raid_bdev_set_opts(&opts);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+SPDK_RPC_REGISTER("bdev_raid_set_options", rpc_bdev_raid_set_options,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
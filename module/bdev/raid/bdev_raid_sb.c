@@ -15,6 +15,8 @@
 struct raid_bdev_write_sb_ctx {
 	struct raid_bdev *raid_bdev;
 	int status;
+	void *buf;
+	uint64_t offset;
 	uint64_t nbytes;
 	uint8_t submitted;
 	uint8_t remaining;
@@ -23,6 +25,21 @@ struct raid_bdev_write_sb_ctx {
 	struct spdk_bdev_io_wait_entry wait_entry;
 };
 
+struct raid_bdev_read_wib_ctx {
+	struct raid_bdev *raid_bdev;
+	int status;
+	void *buf;
+	uint64_t nbytes;
+	uint8_t remaining;
+	raid_bdev_write_sb_cb cb;
+	void *cb_ctx;
+};
+
+struct raid_bdev_read_wib_base_ctx {
+	struct raid_bdev_read_wib_ctx *ctx;
+	void *buf;
+};
+
 struct raid_bdev_read_sb_ctx {
 	struct spdk_bdev_desc *desc;
 	struct spdk_io_channel *ch;
@@ -58,6 +75,7 @@ raid_bdev_init_superblock(struct raid_bdev *raid_bdev)
 	sb->strip_size = raid_bdev->strip_size;
 	/* TODO: sb->state */
 	sb->num_base_bdevs = sb->base_bdevs_size = raid_bdev->num_base_bdevs;
+	sb->write_behind = raid_bdev->write_behind;
 	sb->length = sizeof(*sb) + sizeof(*sb_base_bdev) * sb->base_bdevs_size;
 
 	sb_base_bdev = &sb->base_bdevs[0];
@@ -66,9 +84,60 @@ raid_bdev_init_superblock(struct raid_bdev *raid_bdev)
 		sb_base_bdev->data_offset = base_info->data_offset;
 		sb_base_bdev->data_size = base_info->data_size;
 		sb_base_bdev->state = RAID_SB_BASE_BDEV_CONFIGURED;
+		sb_base_bdev->flags = base_info->write_mostly ? RAID_SB_BASE_BDEV_FLAG_WRITE_MOSTLY : 0;
 		sb_base_bdev->slot = raid_bdev_base_bdev_slot(base_info);
 		sb_base_bdev++;
 	}
+
+	raid_bdev_init_superblock_wib(raid_bdev);
+}
+
+/*
+ * Place the write-intent bitmap between the superblock and the data of the base bdevs. The
+ * bitmap is left disabled if it doesn't fit there or if the raid level has no redundancy to
+ * resync.
+ */
+void
+raid_bdev_init_superblock_wib(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_superblock *sb = raid_bdev->sb;
+	struct raid_base_bdev_info *base_info;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint64_t min_data_offset = UINT64_MAX;
+	uint64_t region_size, num_regions, wib_offset, wib_size;
+
+	sb->wib_size = 0;
+	sb->wib_offset = 0;
+	sb->wib_region_size = 0;
+
+	if (raid_bdev->module->submit_process_request == NULL) {
+		return;
+	}
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->desc != NULL) {
+			min_data_offset = spdk_min(min_data_offset, base_info->data_offset);
+		}
+	}
+
+	region_size = spdk_max(RAID_BDEV_WIB_MIN_REGION_SIZE / blocklen,
+			       spdk_divide_round_up(sb->raid_size, RAID_BDEV_WIB_MAX_REGIONS));
+	region_size = spdk_align64pow2(region_size);
+	num_regions = spdk_divide_round_up(sb->raid_size, region_size);
+
+	wib_offset = align_ceil(RAID_BDEV_SB_MAX_LENGTH, blocklen) / blocklen;
+	wib_size = align_ceil(spdk_divide_round_up(num_regions, 64) * sizeof(uint64_t),
+			      blocklen) / blocklen;
+
+	if (min_data_offset == UINT64_MAX || wib_offset + wib_size > min_data_offset) {
+		SPDK_NOTICELOG("No space for the write-intent bitmap of raid bdev %s\n",
+			       raid_bdev->bdev.name);
+		return;
+	}
+
+	sb->wib_size = wib_size;
+	sb->wib_offset = wib_offset;
+	sb->wib_region_size = region_size;
 }
 
 static void
@@ -288,7 +357,7 @@ _raid_bdev_write_superblock(void *_ctx)
 		}
 
 		rc = spdk_bdev_write(base_info->desc, base_info->app_thread_ch,
-				     (void *)raid_bdev->sb, 0, ctx->nbytes,
+				     ctx->buf, ctx->offset, ctx->nbytes,
 				     raid_bdev_write_superblock_cb, ctx);
 		if (rc != 0) {
 			struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(base_info->desc);
@@ -328,6 +397,8 @@ raid_bdev_write_superblock(struct raid_bdev *raid_bdev, raid_bdev_write_sb_cb cb
 	}
 
 	ctx->raid_bdev = raid_bdev;
+	ctx->buf = sb;
+	ctx->offset = 0;
 	ctx->nbytes = align_ceil(sb->length, spdk_bdev_get_block_size(&raid_bdev->bdev));
 	ctx->remaining = raid_bdev->num_base_bdevs + 1;
 	ctx->cb = cb;
@@ -339,4 +410,140 @@ raid_bdev_write_superblock(struct raid_bdev *raid_bdev, raid_bdev_write_sb_cb cb
 	_raid_bdev_write_superblock(ctx);
 }
 
+/*
+ * Write the write-intent bitmap in buf to all base bdevs. The buffer must stay valid until
+ * the callback is called.
+ */
+void
+raid_bdev_write_wib(struct raid_bdev *raid_bdev, void *buf, raid_bdev_write_sb_cb cb, void *cb_ctx)
+{
+	struct raid_bdev_write_sb_ctx *ctx;
+	struct raid_bdev_superblock *sb = raid_bdev->sb;
+	uint32_t blocklen = spdk_bdev_get_block_size(&raid_bdev->bdev);
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+	assert(sb != NULL && sb->wib_size != 0);
+	assert(cb != NULL);
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb(-ENOMEM, raid_bdev, cb_ctx);
+		return;
+	}
+
+	ctx->raid_bdev = raid_bdev;
+	ctx->buf = buf;
+	ctx->offset = sb->wib_offset * blocklen;
+	ctx->nbytes = (uint64_t)sb->wib_size * blocklen;
+	ctx->remaining = raid_bdev->num_base_bdevs + 1;
+	ctx->cb = cb;
+	ctx->cb_ctx = cb_ctx;
+
+	_raid_bdev_write_superblock(ctx);
+}
+
+static void
+raid_bdev_read_wib_base_bdev_done(int status, struct raid_bdev_read_wib_ctx *ctx)
+{
+	if (status != 0) {
+		ctx->status = status;
+	}
+
+	if (--ctx->remaining == 0) {
+		ctx->cb(ctx->status, ctx->raid_bdev, ctx->cb_ctx);
+		free(ctx);
+	}
+}
+
+static void
+raid_bdev_read_wib_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_read_wib_base_ctx *base_ctx = cb_arg;
+	struct raid_bdev_read_wib_ctx *ctx = base_ctx->ctx;
+	uint64_t *dst = ctx->buf, *src = base_ctx->buf;
+	uint64_t i;
+	int status = 0;
+
+	if (success) {
+		/* A bit set on any of the base bdevs marks the region as dirty */
+		for (i = 0; i < ctx->nbytes / sizeof(uint64_t); i++) {
+			dst[i] |= src[i];
+		}
+	} else {
+		SPDK_ERRLOG("Failed to read write-intent bitmap on bdev %s\n", bdev_io->bdev->name);
+		status = -EIO;
+	}
+
+	spdk_bdev_free_io(bdev_io);
+	spdk_dma_free(base_ctx->buf);
+	free(base_ctx);
+
+	raid_bdev_read_wib_base_bdev_done(status, ctx);
+}
+
+/*
+ * Read the write-intent bitmap from all base bdevs and merge it into buf, which must be
+ * zeroed by the caller.
+ */
+void
+raid_bdev_read_wib(struct raid_bdev *raid_bdev, void *buf, raid_bdev_write_sb_cb cb, void *cb_ctx)
+{
+	struct raid_bdev_read_wib_ctx *ctx;
+	struct raid_bdev_read_wib_base_ctx *base_ctx;
+	struct raid_bdev_superblock *sb = raid_bdev->sb;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_bdev *bdev;
+	uint32_t blocklen = spdk_bdev_get_block_size(&raid_bdev->bdev);
+	int rc;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+	assert(sb != NULL && sb->wib_size != 0);
+	assert(cb != NULL);
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb(-ENOMEM, raid_bdev, cb_ctx);
+		return;
+	}
+
+	ctx->raid_bdev = raid_bdev;
+	ctx->buf = buf;
+	ctx->nbytes = (uint64_t)sb->wib_size * blocklen;
+	ctx->remaining = 1;
+	ctx->cb = cb;
+	ctx->cb_ctx = cb_ctx;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->desc == NULL) {
+			continue;
+		}
+		bdev = spdk_bdev_desc_get_bdev(base_info->desc);
+
+		base_ctx = calloc(1, sizeof(*base_ctx));
+		if (!base_ctx) {
+			ctx->status = -ENOMEM;
+			break;
+		}
+		base_ctx->ctx = ctx;
+		base_ctx->buf = spdk_dma_malloc(ctx->nbytes, spdk_bdev_get_buf_align(bdev), NULL);
+		if (!base_ctx->buf) {
+			free(base_ctx);
+			ctx->status = -ENOMEM;
+			break;
+		}
+
+		rc = spdk_bdev_read(base_info->desc, base_info->app_thread_ch, base_ctx->buf,
+				    sb->wib_offset * blocklen, ctx->nbytes, raid_bdev_read_wib_cb, base_ctx);
+		if (rc != 0) {
+			spdk_dma_free(base_ctx->buf);
+			free(base_ctx);
+			ctx->status = rc;
+			break;
+		}
+		ctx->remaining++;
+	}
+
+	raid_bdev_read_wib_base_bdev_done(0, ctx);
+}
+
 SPDK_LOG_REGISTER_COMPONENT(bdev_raid_sb)
@@ -5,37 +5,139 @@
 
 #include "bdev_raid.h"
 
+#include "spdk/env.h"
 #include "spdk/likely.h"
 #include "spdk/log.h"
+#include "spdk/util.h"
+
+/*
+ * Reads of at least two parts of this size are split into parts of at least this size and
+ * submitted to different mirrors in parallel.
+ */
+#define RAID1_READ_SPLIT_PART_SIZE_MIN	(512 * 1024)
+#define RAID1_READ_SPLIT_PARTS_MAX	4
+#define RAID1_READ_SPLIT_IOVS_MAX	16
+#define RAID1_SPLIT_READS_PER_CHANNEL	16
+
+/*
+ * A sequential stream stays on its mirror as long as the mirror's estimated cost is at
+ * most this many times the cost of the best mirror.
+ */
+#define RAID1_SEQUENTIAL_AFFINITY_FACTOR	4
+
+/* Weight of a new sample in the moving average of the read latency, as a power of 2 */
+#define RAID1_READ_LATENCY_SHIFT	3
+
+struct raid1_write_behind;
 
 struct raid1_info {
 	/* The parent raid bdev */
 	struct raid_bdev *raid_bdev;
+
+	/* Protects the write-behind state below, which is shared by all the channels */
+	struct spdk_spinlock write_behind_lock;
+
+	/* Number of write-behind writes in progress, at most raid_bdev->write_behind */
+	uint32_t write_behind_outstanding;
+
+	/* Write-behind writes in progress */
+	TAILQ_HEAD(, raid1_write_behind) write_behind_ios;
+
+	/* I/Os that overlap a write-behind write in progress and wait for it to complete */
+	TAILQ_HEAD(, raid_bdev_io) write_behind_waiting;
+};
+
+struct raid1_write_behind_part {
+	struct raid1_write_behind *write_behind;
+	struct raid_base_bdev_info *base_info;
+	/* Reference on the base bdev channel, taken for the duration of the write */
+	struct spdk_io_channel *ch;
+};
+
+/*
+ * A write to the write-mostly members that completes after the raid_io. It writes a copy of
+ * the payload and holds the write-intent bitmap regions of its range until it is done.
+ */
+struct raid1_write_behind {
+	struct raid1_info *r1info;
+	uint64_t offset_blocks;
+	uint64_t num_blocks;
+	struct iovec iov;
+	void *md_buf;
+	/* Parts in progress, plus one held while the parts are submitted */
+	uint8_t remaining;
+	TAILQ_ENTRY(raid1_write_behind) link;
+	struct raid1_write_behind_part parts[0];
+};
+
+struct raid1_base_channel {
+	/* Outstanding read blocks on this channel */
+	uint64_t read_blocks_outstanding;
+
+	/* Offset following the last read submitted, used to detect sequential streams */
+	uint64_t read_next_offset_blocks;
+
+	/* Moving average of the read latency in ticks, 0 until the first read completes */
+	uint64_t read_latency_ticks;
+};
+
+struct raid1_split_read;
+
+struct raid1_read_part {
+	struct raid1_split_read *split_read;
+	uint64_t offset_blocks;
+	uint64_t num_blocks;
+	uint64_t submit_tsc;
+	uint8_t idx;
+	int iovcnt;
+	struct iovec iovs[RAID1_READ_SPLIT_IOVS_MAX];
+};
+
+/* A read split in parts that are read from different mirrors */
+struct raid1_split_read {
+	struct raid_bdev_io *raid_io;
+	uint8_t num_parts;
+	struct raid1_read_part parts[RAID1_READ_SPLIT_PARTS_MAX];
+	TAILQ_ENTRY(raid1_split_read) link;
 };
 
 struct raid1_io_channel {
-	/* Array of per-base_bdev counters of outstanding read blocks on this channel */
-	uint64_t read_blocks_outstanding[0];
+	struct raid1_split_read *split_reads;
+	TAILQ_HEAD(, raid1_split_read) free_split_reads;
+
+	/* Array of per-base_bdev read statistics on this channel */
+	struct raid1_base_channel base[0];
 };
 
 static void
 raid1_channel_inc_read_counters(struct raid_bdev_io_channel *raid_ch, uint8_t idx,
-				uint64_t num_blocks)
+				uint64_t offset_blocks, uint64_t num_blocks)
 {
 	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
 
-	assert(raid1_ch->read_blocks_outstanding[idx] <= UINT64_MAX - num_blocks);
-	raid1_ch->read_blocks_outstanding[idx] += num_blocks;
+	assert(raid1_ch->base[idx].read_blocks_outstanding <= UINT64_MAX - num_blocks);
+	raid1_ch->base[idx].read_blocks_outstanding += num_blocks;
+	raid1_ch->base[idx].read_next_offset_blocks = offset_blocks + num_blocks;
 }
 
 static void
 raid1_channel_dec_read_counters(struct raid_bdev_io_channel *raid_ch, uint8_t idx,
-				uint64_t num_blocks)
+				uint64_t num_blocks, uint64_t submit_tsc)
 {
 	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	struct raid1_base_channel *base = &raid1_ch->base[idx];
+	uint64_t latency = spdk_get_ticks() - submit_tsc;
+
+	assert(base->read_blocks_outstanding >= num_blocks);
+	base->read_blocks_outstanding -= num_blocks;
 
-	assert(raid1_ch->read_blocks_outstanding[idx] >= num_blocks);
-	raid1_ch->read_blocks_outstanding[idx] -= num_blocks;
+	if (base->read_latency_ticks == 0) {
+		base->read_latency_ticks = spdk_max(latency, 1);
+	} else {
+		base->read_latency_ticks = spdk_max(base->read_latency_ticks -
+						    (base->read_latency_ticks >> RAID1_READ_LATENCY_SHIFT) +
+						    (latency >> RAID1_READ_LATENCY_SHIFT), 1);
+	}
 }
 
 static inline void
@@ -48,11 +150,40 @@ raid1_bdev_io_completion(struct spdk_bdev_io *bdev_io, bool success, struct raid
 				   SPDK_BDEV_IO_STATUS_FAILED);
 }
 
+/*
+ * A failed write to a write-mostly member doesn't fail the raid_io as long as other members
+ * are left. The member is removed instead and brought up to date when it rejoins.
+ */
+static bool
+raid1_write_mostly_failed(struct raid_bdev *raid_bdev, struct spdk_bdev *bdev)
+{
+	struct raid_base_bdev_info *base_info;
+
+	if (raid_bdev->num_base_bdevs_operational < 2) {
+		return false;
+	}
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->write_mostly && base_info->desc != NULL &&
+		    spdk_bdev_desc_get_bdev(base_info->desc) == bdev) {
+			SPDK_ERRLOG("Write to write-mostly base bdev %s failed\n", base_info->name);
+			raid_bdev_fail_base_bdev(base_info);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static void
 raid1_write_bdev_io_completion(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
 	struct raid_bdev_io *raid_io = cb_arg;
 
+	if (spdk_unlikely(!success)) {
+		success = raid1_write_mostly_failed(raid_io->raid_bdev, bdev_io->bdev);
+	}
+
 	raid1_bdev_io_completion(bdev_io, success, raid_io);
 }
 
@@ -61,8 +192,9 @@ raid1_read_bdev_io_completion(struct spdk_bdev_io *bdev_io, bool success, void *
 {
 	struct raid_bdev_io *raid_io = cb_arg;
 
+	/* module_private holds the submission time of a read that isn't split */
 	raid1_channel_dec_read_counters(raid_io->raid_ch, raid_io->base_bdev_io_submitted,
-					raid_io->num_blocks);
+					raid_io->num_blocks, (uint64_t)(uintptr_t)raid_io->module_private);
 
 	raid1_bdev_io_completion(bdev_io, success, raid_io);
 }
@@ -87,25 +219,427 @@ raid1_init_ext_io_opts(struct spdk_bdev_ext_io_opts *opts, struct raid_bdev_io *
 	opts->metadata = raid_io->md_buf;
 }
 
-static uint8_t
-raid1_channel_next_read_base_bdev(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+/*
+ * Estimated cost of reading num_blocks from a mirror - the blocks that would be outstanding
+ * on it, weighted by its read latency. Mirrors without a latency sample yet get the weight
+ * of the fastest mirror.
+ */
+static inline uint64_t
+raid1_read_cost(struct raid1_base_channel *base, uint64_t num_blocks, uint64_t latency_min)
+{
+	uint64_t latency = base->read_latency_ticks != 0 ? base->read_latency_ticks : latency_min;
+
+	return (base->read_blocks_outstanding + num_blocks) * latency;
+}
+
+static uint64_t
+raid1_channel_read_latency_min(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
 {
 	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
-	uint64_t read_blocks_min = UINT64_MAX;
-	uint8_t idx = UINT8_MAX;
+	uint64_t latency_min = UINT64_MAX;
 	uint8_t i;
 
 	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
 		if (raid_bdev_channel_get_base_channel(raid_ch, i) != NULL &&
-		    raid1_ch->read_blocks_outstanding[i] < read_blocks_min) {
-			read_blocks_min = raid1_ch->read_blocks_outstanding[i];
+		    raid1_ch->base[i].read_latency_ticks != 0) {
+			latency_min = spdk_min(latency_min, raid1_ch->base[i].read_latency_ticks);
+		}
+	}
+
+	return latency_min != UINT64_MAX ? latency_min : 1;
+}
+
+/*
+ * Picks the mirror to read from, among the write-mostly members or the other ones. A read
+ * that continues a sequential stream goes to the mirror of that stream, so that the device's
+ * read-ahead keeps working, unless that mirror is much more loaded than the others. Any other
+ * read goes to the mirror with the lowest cost.
+ */
+static uint8_t
+_raid1_channel_next_read_base_bdev(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+				   uint64_t offset_blocks, uint64_t num_blocks, bool write_mostly)
+{
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	uint64_t latency_min = raid1_channel_read_latency_min(raid_bdev, raid_ch);
+	uint64_t cost, cost_min = UINT64_MAX, seq_cost = UINT64_MAX;
+	uint8_t idx = UINT8_MAX, seq_idx = UINT8_MAX;
+	uint8_t i;
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (raid_bdev_channel_get_base_channel(raid_ch, i) == NULL ||
+		    raid_bdev->base_bdev_info[i].write_mostly != write_mostly) {
+			continue;
+		}
+
+		cost = raid1_read_cost(&raid1_ch->base[i], num_blocks, latency_min);
+		if (cost < cost_min) {
+			cost_min = cost;
 			idx = i;
 		}
+
+		if (raid1_ch->base[i].read_next_offset_blocks == offset_blocks) {
+			seq_cost = cost;
+			seq_idx = i;
+		}
+	}
+
+	if (seq_idx != UINT8_MAX && seq_cost / RAID1_SEQUENTIAL_AFFINITY_FACTOR <= cost_min) {
+		return seq_idx;
 	}
 
 	return idx;
 }
 
+/*
+ * Picks the mirror to read from. The write-mostly members are used only if no other member
+ * is available.
+ */
+static uint8_t
+raid1_channel_next_read_base_bdev(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+				  uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint8_t idx;
+
+	idx = _raid1_channel_next_read_base_bdev(raid_bdev, raid_ch, offset_blocks, num_blocks, false);
+	if (spdk_unlikely(idx == UINT8_MAX)) {
+		idx = _raid1_channel_next_read_base_bdev(raid_bdev, raid_ch, offset_blocks, num_blocks,
+				true);
+	}
+
+	return idx;
+}
+
+/*
+ * Picks up to max_mirrors different mirrors with the lowest cost for the parts of a split read.
+ * The write-mostly members never serve a part.
+ */
+static uint8_t
+raid1_channel_split_read_base_bdevs(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+				    uint64_t num_blocks, uint8_t *mirrors, uint8_t max_mirrors)
+{
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	uint64_t latency_min = raid1_channel_read_latency_min(raid_bdev, raid_ch);
+	uint64_t cost, cost_min;
+	uint8_t num_mirrors, i, j;
+
+	for (num_mirrors = 0; num_mirrors < max_mirrors; num_mirrors++) {
+		mirrors[num_mirrors] = UINT8_MAX;
+		cost_min = UINT64_MAX;
+
+		for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+			if (raid_bdev_channel_get_base_channel(raid_ch, i) == NULL ||
+			    raid_bdev->base_bdev_info[i].write_mostly) {
+				continue;
+			}
+
+			for (j = 0; j < num_mirrors; j++) {
+				if (mirrors[j] == i) {
+					break;
+				}
+			}
+			if (j < num_mirrors) {
+				continue;
+			}
+
+			cost = raid1_read_cost(&raid1_ch->base[i], num_blocks, latency_min);
+			if (cost < cost_min) {
+				cost_min = cost;
+				mirrors[num_mirrors] = i;
+			}
+		}
+
+		if (mirrors[num_mirrors] == UINT8_MAX) {
+			break;
+		}
+	}
+
+	return num_mirrors;
+}
+
+static bool
+raid1_write_behind_overlaps(struct raid1_info *r1info, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct raid1_write_behind *write_behind;
+
+	TAILQ_FOREACH(write_behind, &r1info->write_behind_ios, link) {
+		if (offset_blocks < write_behind->offset_blocks + write_behind->num_blocks &&
+		    write_behind->offset_blocks < offset_blocks + num_blocks) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Queues the raid_io if it overlaps a write-behind write in progress, so that it doesn't
+ * reorder with it on the write-mostly members. cb_fn resubmits it on its thread later.
+ * Must be called with the write-behind lock held.
+ */
+static bool
+_raid1_write_behind_wait(struct raid_bdev_io *raid_io, spdk_msg_fn cb_fn)
+{
+	struct raid1_info *r1info = raid_io->raid_bdev->module_private;
+
+	if (!raid1_write_behind_overlaps(r1info, raid_io->offset_blocks, raid_io->num_blocks)) {
+		return false;
+	}
+
+	raid_io->waitq_entry.cb_fn = cb_fn;
+	raid_io->module_private = spdk_get_thread();
+	TAILQ_INSERT_TAIL(&r1info->write_behind_waiting, raid_io, module_link);
+
+	return true;
+}
+
+static bool
+raid1_write_behind_wait(struct raid_bdev_io *raid_io, spdk_msg_fn cb_fn)
+{
+	struct raid1_info *r1info = raid_io->raid_bdev->module_private;
+	bool waiting;
+
+	if (__atomic_load_n(&r1info->write_behind_outstanding, __ATOMIC_SEQ_CST) == 0) {
+		return false;
+	}
+
+	spdk_spin_lock(&r1info->write_behind_lock);
+	waiting = _raid1_write_behind_wait(raid_io, cb_fn);
+	spdk_spin_unlock(&r1info->write_behind_lock);
+
+	return waiting;
+}
+
+static void
+raid1_write_behind_free(struct raid1_write_behind *write_behind)
+{
+	spdk_dma_free(write_behind->iov.iov_base);
+	spdk_dma_free(write_behind->md_buf);
+	free(write_behind);
+}
+
+static void
+raid1_write_behind_put(struct raid1_write_behind *write_behind)
+{
+	struct raid1_info *r1info = write_behind->r1info;
+	struct raid_bdev_io *raid_io, *tmp;
+	TAILQ_HEAD(, raid_bdev_io) waiting;
+
+	assert(write_behind->remaining > 0);
+	if (--write_behind->remaining > 0) {
+		return;
+	}
+
+	raid_bdev_wib_range_put(r1info->raid_bdev, write_behind->offset_blocks,
+				write_behind->num_blocks);
+
+	TAILQ_INIT(&waiting);
+	spdk_spin_lock(&r1info->write_behind_lock);
+	TAILQ_REMOVE(&r1info->write_behind_ios, write_behind, link);
+	r1info->write_behind_outstanding--;
+	TAILQ_SWAP(&waiting, &r1info->write_behind_waiting, raid_bdev_io, module_link);
+	spdk_spin_unlock(&r1info->write_behind_lock);
+
+	raid1_write_behind_free(write_behind);
+
+	/* The waiting I/Os check again for overlaps with the write-behind writes left */
+	TAILQ_FOREACH_SAFE(raid_io, &waiting, module_link, tmp) {
+		TAILQ_REMOVE(&waiting, raid_io, module_link);
+		spdk_thread_send_msg(raid_io->module_private, raid_io->waitq_entry.cb_fn, raid_io);
+	}
+}
+
+static void
+raid1_write_behind_part_completion(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid1_write_behind_part *part = cb_arg;
+	struct raid_base_bdev_info *base_info = part->base_info;
+
+	spdk_bdev_free_io(bdev_io);
+	spdk_put_io_channel(part->ch);
+
+	if (spdk_unlikely(!success)) {
+		SPDK_ERRLOG("Write-behind write to base bdev %s failed\n", base_info->name);
+		raid_bdev_fail_base_bdev(base_info);
+	}
+
+	raid1_write_behind_put(part->write_behind);
+	__atomic_fetch_sub(&base_info->write_behind_outstanding, 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Write-behind is used for a write if the raid bdev has a write-intent bitmap to track the
+ * regions it's still writing, the limit of write-behind writes in progress isn't reached
+ * and the write goes both to a write-mostly member and to at least one other member.
+ */
+static bool
+raid1_write_behind_allowed(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid1_info *r1info = raid_bdev->module_private;
+	struct raid_base_bdev_info *base_info;
+	bool write_mostly = false, other = false;
+	uint8_t i;
+
+	if (raid_bdev->write_behind == 0 || raid_bdev->wib == NULL || raid_io->memory_domain != NULL) {
+		return false;
+	}
+
+	if (__atomic_load_n(&r1info->write_behind_outstanding,
+			    __ATOMIC_SEQ_CST) >= raid_bdev->write_behind) {
+		return false;
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		base_info = &raid_bdev->base_bdev_info[i];
+
+		if (raid_bdev_channel_get_base_channel(raid_io->raid_ch, i) == NULL) {
+			continue;
+		}
+
+		if (!base_info->write_mostly) {
+			other = true;
+		} else if (!base_info->is_process_target) {
+			write_mostly = true;
+		}
+	}
+
+	return write_mostly && other;
+}
+
+static struct raid1_write_behind *
+raid1_write_behind_alloc(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid1_write_behind *write_behind;
+
+	write_behind = calloc(1, sizeof(*write_behind) +
+			      raid_bdev->num_base_bdevs * sizeof(struct raid1_write_behind_part));
+	if (write_behind == NULL) {
+		return NULL;
+	}
+
+	write_behind->r1info = raid_bdev->module_private;
+	write_behind->offset_blocks = raid_io->offset_blocks;
+	write_behind->num_blocks = raid_io->num_blocks;
+	write_behind->iov.iov_len = raid_io->num_blocks * raid_bdev->bdev.blocklen;
+	write_behind->iov.iov_base = spdk_dma_malloc(write_behind->iov.iov_len, 4096, NULL);
+	if (write_behind->iov.iov_base == NULL) {
+		goto err;
+	}
+
+	if (raid_io->md_buf != NULL) {
+		write_behind->md_buf = spdk_dma_malloc(raid_io->num_blocks * raid_bdev->bdev.md_len, 4096,
+						       NULL);
+		if (write_behind->md_buf == NULL) {
+			goto err;
+		}
+	}
+
+	/* held until all the parts are submitted */
+	write_behind->remaining = 1;
+
+	return write_behind;
+err:
+	raid1_write_behind_free(write_behind);
+	return NULL;
+}
+
+/*
+ * Called before a write is submitted to the base bdevs. Queues it if it overlaps a
+ * write-behind write in progress, otherwise sets up its own write-behind if allowed, in
+ * module_private. Returns -EAGAIN if the write was queued.
+ */
+static int
+raid1_write_behind_start(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid1_info *r1info = raid_bdev->module_private;
+	struct raid1_write_behind *write_behind = NULL;
+	int ret = 0;
+
+	raid_io->module_private = NULL;
+
+	if (raid1_write_behind_allowed(raid_io)) {
+		write_behind = raid1_write_behind_alloc(raid_io);
+	}
+
+	if (write_behind == NULL) {
+		return raid1_write_behind_wait(raid_io, _raid1_submit_rw_request) ? -EAGAIN : 0;
+	}
+
+	spdk_spin_lock(&r1info->write_behind_lock);
+	if (_raid1_write_behind_wait(raid_io, _raid1_submit_rw_request)) {
+		ret = -EAGAIN;
+	} else if (r1info->write_behind_outstanding < raid_bdev->write_behind) {
+		r1info->write_behind_outstanding++;
+		TAILQ_INSERT_TAIL(&r1info->write_behind_ios, write_behind, link);
+		raid_io->module_private = write_behind;
+	}
+	spdk_spin_unlock(&r1info->write_behind_lock);
+
+	if (raid_io->module_private != write_behind) {
+		raid1_write_behind_free(write_behind);
+		return ret;
+	}
+
+	spdk_copy_iovs_to_buf(write_behind->iov.iov_base, write_behind->iov.iov_len,
+			      raid_io->iovs, raid_io->iovcnt);
+	if (raid_io->md_buf != NULL) {
+		memcpy(write_behind->md_buf, raid_io->md_buf,
+		       raid_io->num_blocks * raid_bdev->bdev.md_len);
+	}
+
+	/* the regions stay marked in the write-intent bitmap until the write-behind is done */
+	raid_bdev_wib_range_get(raid_bdev, raid_io->offset_blocks, raid_io->num_blocks);
+
+	return 0;
+}
+
+/*
+ * Submits the write-behind write to a write-mostly member. The member's part of the raid_io
+ * is completed once the write is submitted.
+ */
+static int
+raid1_write_behind_submit(struct raid1_write_behind *write_behind, uint8_t idx,
+			  struct spdk_io_channel *base_ch)
+{
+	struct raid1_write_behind_part *part = &write_behind->parts[idx];
+	struct raid_base_bdev_info *base_info;
+	struct spdk_bdev_ext_io_opts io_opts;
+	int ret;
+
+	base_info = &write_behind->r1info->raid_bdev->base_bdev_info[idx];
+
+	part->write_behind = write_behind;
+	part->base_info = base_info;
+	/* the raid_io's channel may go away before the write is done, so take a reference */
+	part->ch = spdk_bdev_get_io_channel(base_info->desc);
+	if (spdk_unlikely(part->ch == NULL)) {
+		return -EIO;
+	}
+	assert(part->ch == base_ch);
+
+	memset(&io_opts, 0, sizeof(io_opts));
+	io_opts.size = sizeof(io_opts);
+	io_opts.metadata = write_behind->md_buf;
+
+	ret = raid_bdev_writev_blocks_ext(base_info, part->ch, &write_behind->iov, 1,
+					  write_behind->offset_blocks, write_behind->num_blocks,
+					  raid1_write_behind_part_completion, part, &io_opts);
+	if (spdk_unlikely(ret != 0)) {
+		spdk_put_io_channel(part->ch);
+		return ret;
+	}
+
+	__atomic_fetch_add(&base_info->write_behind_outstanding, 1, __ATOMIC_SEQ_CST);
+	write_behind->remaining++;
+
+	return 0;
+}
+
+static void
+_raid1_submit_read_request(void *_raid_io);
+
 static int
 raid1_submit_read_request(struct raid_bdev_io *raid_io)
 {
@@ -117,7 +651,8 @@ raid1_submit_read_request(struct raid_bdev_io *raid_io)
 	uint8_t idx;
 	int ret;
 
-	idx = raid1_channel_next_read_base_bdev(raid_bdev, raid_ch);
+	idx = raid1_channel_next_read_base_bdev(raid_bdev, raid_ch, raid_io->offset_blocks,
+						raid_io->num_blocks);
 	if (spdk_unlikely(idx == UINT8_MAX)) {
 		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
 		return 0;
@@ -126,7 +661,14 @@ raid1_submit_read_request(struct raid_bdev_io *raid_io)
 	base_info = &raid_bdev->base_bdev_info[idx];
 	base_ch = raid_bdev_channel_get_base_channel(raid_ch, idx);
 
+	/* a write-mostly member may not have the data of a write-behind write in progress yet */
+	if (spdk_unlikely(base_info->write_mostly) &&
+	    raid1_write_behind_wait(raid_io, _raid1_submit_read_request)) {
+		return 0;
+	}
+
 	raid_io->base_bdev_io_remaining = 1;
+	raid_io->module_private = (void *)(uintptr_t)spdk_get_ticks();
 
 	raid1_init_ext_io_opts(&io_opts, raid_io);
 	ret = raid_bdev_readv_blocks_ext(base_info, base_ch, raid_io->iovs, raid_io->iovcnt,
@@ -134,7 +676,7 @@ raid1_submit_read_request(struct raid_bdev_io *raid_io)
 					 raid1_read_bdev_io_completion, raid_io, &io_opts);
 
 	if (spdk_likely(ret == 0)) {
-		raid1_channel_inc_read_counters(raid_ch, idx, raid_io->num_blocks);
+		raid1_channel_inc_read_counters(raid_ch, idx, raid_io->offset_blocks, raid_io->num_blocks);
 		raid_io->base_bdev_io_submitted = idx;
 	} else if (spdk_unlikely(ret == -ENOMEM)) {
 		raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
@@ -145,23 +687,241 @@ raid1_submit_read_request(struct raid_bdev_io *raid_io)
 	return ret;
 }
 
+static void
+_raid1_submit_read_request(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	if (raid1_submit_read_request(raid_io) != 0) {
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+raid1_split_read_complete_part(struct raid1_split_read *split_read, uint64_t completed,
+			       enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_io *raid_io = split_read->raid_io;
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_io->raid_ch);
+
+	if (raid_io->base_bdev_io_remaining == completed) {
+		TAILQ_INSERT_HEAD(&raid1_ch->free_split_reads, split_read, link);
+	}
+
+	raid_bdev_io_complete_part(raid_io, completed, status);
+}
+
+static void
+raid1_split_read_part_completion(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid1_read_part *part = cb_arg;
+	struct raid1_split_read *split_read = part->split_read;
+
+	raid1_channel_dec_read_counters(split_read->raid_io->raid_ch, part->idx, part->num_blocks,
+					part->submit_tsc);
+
+	spdk_bdev_free_io(bdev_io);
+
+	raid1_split_read_complete_part(split_read, 1, success ?
+				       SPDK_BDEV_IO_STATUS_SUCCESS :
+				       SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void raid1_submit_split_read_parts(struct raid1_split_read *split_read);
+
+static void
+_raid1_submit_split_read_parts(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid1_submit_split_read_parts(raid_io->module_private);
+}
+
+static void
+raid1_submit_split_read_parts(struct raid1_split_read *split_read)
+{
+	struct raid_bdev_io *raid_io = split_read->raid_io;
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid_bdev_io_channel *raid_ch = raid_io->raid_ch;
+	struct spdk_bdev_ext_io_opts io_opts;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_io_channel *base_ch;
+	struct raid1_read_part *part;
+	int ret;
+
+	raid1_init_ext_io_opts(&io_opts, raid_io);
+
+	for (; raid_io->base_bdev_io_submitted < split_read->num_parts; raid_io->base_bdev_io_submitted++) {
+		part = &split_read->parts[raid_io->base_bdev_io_submitted];
+
+		if (spdk_unlikely(raid_bdev_channel_get_base_channel(raid_ch, part->idx) == NULL)) {
+			/* the mirror went away while waiting for resources, pick another one */
+			part->idx = raid1_channel_next_read_base_bdev(raid_bdev, raid_ch, part->offset_blocks,
+					part->num_blocks);
+			if (part->idx == UINT8_MAX) {
+				raid1_split_read_complete_part(split_read, split_read->num_parts -
+							       raid_io->base_bdev_io_submitted,
+							       SPDK_BDEV_IO_STATUS_FAILED);
+				return;
+			}
+		}
+
+		base_info = &raid_bdev->base_bdev_info[part->idx];
+		base_ch = raid_bdev_channel_get_base_channel(raid_ch, part->idx);
+
+		if (raid_io->md_buf != NULL) {
+			io_opts.metadata = (char *)raid_io->md_buf +
+					   (part->offset_blocks - raid_io->offset_blocks) * raid_bdev->bdev.md_len;
+		}
+
+		part->submit_tsc = spdk_get_ticks();
+		ret = raid_bdev_readv_blocks_ext(base_info, base_ch, part->iovs, part->iovcnt,
+						 part->offset_blocks, part->num_blocks,
+						 raid1_split_read_part_completion, part, &io_opts);
+		if (spdk_unlikely(ret != 0)) {
+			if (spdk_likely(ret == -ENOMEM)) {
+				raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
+							base_ch, _raid1_submit_split_read_parts);
+				return;
+			}
+
+			raid1_split_read_complete_part(split_read, split_read->num_parts -
+						       raid_io->base_bdev_io_submitted,
+						       SPDK_BDEV_IO_STATUS_FAILED);
+			return;
+		}
+
+		raid1_channel_inc_read_counters(raid_ch, part->idx, part->offset_blocks, part->num_blocks);
+	}
+}
+
+/*
+ * Describes the part of the read payload starting at offset bytes and len bytes long with
+ * the part's own iovecs. Fails if that needs more than RAID1_READ_SPLIT_IOVS_MAX of them.
+ */
+static int
+raid1_read_part_init_iovs(struct raid1_read_part *part, struct raid_bdev_io *raid_io,
+			  size_t offset, size_t len)
+{
+	size_t iov_len;
+	int i;
+
+	part->iovcnt = 0;
+
+	for (i = 0; i < raid_io->iovcnt && len > 0; i++) {
+		if (offset >= raid_io->iovs[i].iov_len) {
+			offset -= raid_io->iovs[i].iov_len;
+			continue;
+		}
+
+		if (part->iovcnt == RAID1_READ_SPLIT_IOVS_MAX) {
+			return -EINVAL;
+		}
+
+		iov_len = spdk_min(raid_io->iovs[i].iov_len - offset, len);
+		part->iovs[part->iovcnt].iov_base = (char *)raid_io->iovs[i].iov_base + offset;
+		part->iovs[part->iovcnt].iov_len = iov_len;
+		part->iovcnt++;
+
+		len -= iov_len;
+		offset = 0;
+	}
+
+	return len == 0 ? 0 : -EINVAL;
+}
+
+/*
+ * Splits a large read in parts read from different mirrors in parallel. Returns -EAGAIN if
+ * the read should not or can not be split and has to be submitted to a single mirror.
+ */
+static int
+raid1_submit_split_read_request(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid_bdev_io_channel *raid_ch = raid_io->raid_ch;
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	uint8_t mirrors[RAID1_READ_SPLIT_PARTS_MAX];
+	struct raid1_split_read *split_read;
+	struct raid1_read_part *part;
+	uint64_t offset_blocks, num_blocks;
+	size_t part_offset;
+	uint8_t num_parts, i;
+
+	if (raid_io->memory_domain != NULL) {
+		return -EAGAIN;
+	}
+
+	num_parts = spdk_min((raid_io->num_blocks << raid_bdev->blocklen_shift) /
+			     RAID1_READ_SPLIT_PART_SIZE_MIN, RAID1_READ_SPLIT_PARTS_MAX);
+	if (num_parts < 2) {
+		return -EAGAIN;
+	}
+
+	num_parts = raid1_channel_split_read_base_bdevs(raid_bdev, raid_ch, raid_io->num_blocks / num_parts,
+			mirrors, num_parts);
+
+	split_read = TAILQ_FIRST(&raid1_ch->free_split_reads);
+	if (num_parts < 2 || split_read == NULL) {
+		return -EAGAIN;
+	}
+
+	offset_blocks = raid_io->offset_blocks;
+	for (i = 0; i < num_parts; i++) {
+		part = &split_read->parts[i];
+		num_blocks = i < num_parts - 1 ? raid_io->num_blocks / num_parts :
+			     raid_io->offset_blocks + raid_io->num_blocks - offset_blocks;
+
+		part_offset = (offset_blocks - raid_io->offset_blocks) << raid_bdev->blocklen_shift;
+		if (raid1_read_part_init_iovs(part, raid_io, part_offset,
+					      num_blocks << raid_bdev->blocklen_shift) != 0) {
+			return -EAGAIN;
+		}
+
+		part->split_read = split_read;
+		part->offset_blocks = offset_blocks;
+		part->num_blocks = num_blocks;
+		part->idx = mirrors[i];
+
+		offset_blocks += num_blocks;
+	}
+
+	TAILQ_REMOVE(&raid1_ch->free_split_reads, split_read, link);
+	split_read->raid_io = raid_io;
+	split_read->num_parts = num_parts;
+
+	raid_io->module_private = split_read;
+	raid_io->base_bdev_io_remaining = num_parts;
+	raid_io->base_bdev_io_submitted = 0;
+
+	raid1_submit_split_read_parts(split_read);
+
+	return 0;
+}
+
 static int
 raid1_submit_write_request(struct raid_bdev_io *raid_io)
 {
 	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid1_write_behind *write_behind;
 	struct spdk_bdev_ext_io_opts io_opts;
 	struct raid_base_bdev_info *base_info;
 	struct spdk_io_channel *base_ch;
-	uint8_t idx;
+	uint8_t idx, num_base_bdevs = raid_bdev->num_base_bdevs;
 	uint64_t base_bdev_io_not_submitted;
 	int ret = 0;
 
 	if (raid_io->base_bdev_io_submitted == 0) {
-		raid_io->base_bdev_io_remaining = raid_bdev->num_base_bdevs;
+		if (spdk_unlikely(raid1_write_behind_start(raid_io) != 0)) {
+			return 0;
+		}
+		raid_io->base_bdev_io_remaining = num_base_bdevs;
 	}
 
+	/* the raid_io may complete before the loop ends, so only locals are used after it */
+	write_behind = raid_io->module_private;
+
 	raid1_init_ext_io_opts(&io_opts, raid_io);
-	for (idx = raid_io->base_bdev_io_submitted; idx < raid_bdev->num_base_bdevs; idx++) {
+	for (idx = raid_io->base_bdev_io_submitted; idx < num_base_bdevs; idx++) {
 		base_info = &raid_bdev->base_bdev_info[idx];
 		base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch, idx);
 
@@ -172,9 +932,18 @@ raid1_submit_write_request(struct raid_bdev_io *raid_io)
 			continue;
 		}
 
-		ret = raid_bdev_writev_blocks_ext(base_info, base_ch, raid_io->iovs, raid_io->iovcnt,
-						  raid_io->offset_blocks, raid_io->num_blocks,
-						  raid1_write_bdev_io_completion, raid_io, &io_opts);
+		if (write_behind != NULL && base_info->write_mostly && !base_info->is_process_target) {
+			ret = raid1_write_behind_submit(write_behind, idx, base_ch);
+			if (spdk_likely(ret == 0)) {
+				raid_io->base_bdev_io_submitted++;
+				raid_bdev_io_complete_part(raid_io, 1, SPDK_BDEV_IO_STATUS_SUCCESS);
+				continue;
+			}
+		} else {
+			ret = raid_bdev_writev_blocks_ext(base_info, base_ch, raid_io->iovs, raid_io->iovcnt,
+							  raid_io->offset_blocks, raid_io->num_blocks,
+							  raid1_write_bdev_io_completion, raid_io, &io_opts);
+		}
 		if (spdk_unlikely(ret != 0)) {
 			if (spdk_unlikely(ret == -ENOMEM)) {
 				raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
@@ -182,17 +951,19 @@ raid1_submit_write_request(struct raid_bdev_io *raid_io)
 				return 0;
 			}
 
-			base_bdev_io_not_submitted = raid_bdev->num_base_bdevs -
-						     raid_io->base_bdev_io_submitted;
+			base_bdev_io_not_submitted = num_base_bdevs - raid_io->base_bdev_io_submitted;
 			raid_bdev_io_complete_part(raid_io, base_bdev_io_not_submitted,
 						   SPDK_BDEV_IO_STATUS_FAILED);
-			return 0;
+			ret = 0;
+			break;
 		}
 
 		raid_io->base_bdev_io_submitted++;
 	}
 
-	if (raid_io->base_bdev_io_submitted == 0) {
+	if (write_behind != NULL) {
+		raid1_write_behind_put(write_behind);
+	} else if (idx == num_base_bdevs && raid_io->base_bdev_io_submitted == 0) {
 		ret = -ENODEV;
 	}
 
@@ -206,7 +977,10 @@ raid1_submit_rw_request(struct raid_bdev_io *raid_io)
 
 	switch (raid_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
-		ret = raid1_submit_read_request(raid_io);
+		ret = raid1_submit_split_read_request(raid_io);
+		if (ret == -EAGAIN) {
+			ret = raid1_submit_read_request(raid_io);
+		}
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
 		ret = raid1_submit_write_request(raid_io);
@@ -221,14 +995,164 @@ raid1_submit_rw_request(struct raid_bdev_io *raid_io)
 	}
 }
 
+static void raid1_process_submit_write(struct raid_bdev_process_request *process_req);
+
+static void
+_raid1_process_submit_write(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid1_process_submit_write(SPDK_CONTAINEROF(raid_io, struct raid_bdev_process_request,
+				   raid_io));
+}
+
+static void
+raid1_process_write_completed(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_process_request *process_req;
+
+	process_req = SPDK_CONTAINEROF(raid_io, struct raid_bdev_process_request, raid_io);
+
+	raid_bdev_process_request_complete(process_req,
+					   status == SPDK_BDEV_IO_STATUS_SUCCESS ? 0 : -EIO);
+}
+
+/*
+ * Write the data read from a healthy mirror to the rebuild target or, for a resync,
+ * to every other mirror.
+ */
+static void
+raid1_process_submit_write(struct raid_bdev_process_request *process_req)
+{
+	struct raid_bdev_io *raid_io = &process_req->raid_io;
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	uint8_t read_idx = (uint8_t)(uintptr_t)raid_io->module_private;
+	struct spdk_bdev_ext_io_opts io_opts;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_io_channel *base_ch;
+	uint8_t idx;
+	int ret;
+
+	raid1_init_ext_io_opts(&io_opts, raid_io);
+
+	if (process_req->target != NULL) {
+		ret = raid_bdev_writev_blocks_ext(process_req->target, process_req->target_ch,
+						  raid_io->iovs, raid_io->iovcnt,
+						  raid_io->offset_blocks, raid_io->num_blocks,
+						  raid1_write_bdev_io_completion, raid_io, &io_opts);
+		if (spdk_unlikely(ret == -ENOMEM)) {
+			raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(process_req->target->desc),
+						process_req->target_ch, _raid1_process_submit_write);
+		} else if (spdk_unlikely(ret != 0)) {
+			raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		}
+		return;
+	}
+
+	for (idx = raid_io->base_bdev_io_submitted; idx < raid_bdev->num_base_bdevs; idx++) {
+		base_info = &raid_bdev->base_bdev_info[idx];
+		base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch, idx);
+
+		if (base_ch == NULL || idx == read_idx) {
+			raid_io->base_bdev_io_submitted++;
+			raid_bdev_io_complete_part(raid_io, 1, SPDK_BDEV_IO_STATUS_SUCCESS);
+			continue;
+		}
+
+		ret = raid_bdev_writev_blocks_ext(base_info, base_ch, raid_io->iovs, raid_io->iovcnt,
+						  raid_io->offset_blocks, raid_io->num_blocks,
+						  raid1_write_bdev_io_completion, raid_io, &io_opts);
+		if (spdk_unlikely(ret != 0)) {
+			if (spdk_unlikely(ret == -ENOMEM)) {
+				raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
+							base_ch, _raid1_process_submit_write);
+				return;
+			}
+
+			raid_bdev_io_complete_part(raid_io, raid_bdev->num_base_bdevs -
+						   raid_io->base_bdev_io_submitted,
+						   SPDK_BDEV_IO_STATUS_FAILED);
+			return;
+		}
+
+		raid_io->base_bdev_io_submitted++;
+	}
+}
+
+static void
+raid1_process_read_completed(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_process_request *process_req;
+
+	process_req = SPDK_CONTAINEROF(raid_io, struct raid_bdev_process_request, raid_io);
+
+	if (status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		raid_bdev_process_request_complete(process_req, -EIO);
+		return;
+	}
+
+	/* remember the mirror the data came from, so that a resync doesn't write it back */
+	raid_io->module_private = (void *)(uintptr_t)raid_io->base_bdev_io_submitted;
+	raid_io->completion_cb = raid1_process_write_completed;
+	raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_SUCCESS;
+	raid_io->base_bdev_io_submitted = 0;
+	raid_io->base_bdev_io_remaining = process_req->target != NULL ? 1 :
+					  raid_io->raid_bdev->num_base_bdevs;
+
+	raid1_process_submit_write(process_req);
+}
+
+static int
+raid1_submit_process_request(struct raid_bdev_process_request *process_req,
+			     struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_bdev_io *raid_io = &process_req->raid_io;
+	int ret;
+
+	raid_bdev_io_init(raid_io, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+			  process_req->offset_blocks, process_req->num_blocks,
+			  &process_req->iov, 1, process_req->md_buf, NULL, NULL);
+	raid_io->completion_cb = raid1_process_read_completed;
+	process_req->iov.iov_len = process_req->num_blocks << raid_io->raid_bdev->blocklen_shift;
+
+	ret = raid1_submit_read_request(raid_io);
+	if (spdk_unlikely(ret != 0)) {
+		return ret;
+	}
+
+	return process_req->num_blocks;
+}
+
 static void
 raid1_ioch_destroy(void *io_device, void *ctx_buf)
 {
+	struct raid1_io_channel *raid1_ch = ctx_buf;
+
+	free(raid1_ch->split_reads);
 }
 
 static int
 raid1_ioch_create(void *io_device, void *ctx_buf)
 {
+	struct raid1_info *r1info = io_device;
+	struct raid1_io_channel *raid1_ch = ctx_buf;
+	uint8_t i;
+
+	raid1_ch->split_reads = calloc(RAID1_SPLIT_READS_PER_CHANNEL, sizeof(*raid1_ch->split_reads));
+	if (raid1_ch->split_reads == NULL) {
+		SPDK_ERRLOG("Failed to allocate split read contexts\n");
+		return -ENOMEM;
+	}
+
+	TAILQ_INIT(&raid1_ch->free_split_reads);
+	for (i = 0; i < RAID1_SPLIT_READS_PER_CHANNEL; i++) {
+		TAILQ_INSERT_TAIL(&raid1_ch->free_split_reads, &raid1_ch->split_reads[i], link);
+	}
+
+	for (i = 0; i < r1info->raid_bdev->num_base_bdevs; i++) {
+		raid1_ch->base[i].read_next_offset_blocks = UINT64_MAX;
+	}
+
 	return 0;
 }
 
@@ -239,6 +1163,8 @@ raid1_io_device_unregister_done(void *io_device)
 
 	raid_bdev_module_stop_done(r1info->raid_bdev);
 
+	assert(TAILQ_EMPTY(&r1info->write_behind_ios));
+	spdk_spin_destroy(&r1info->write_behind_lock);
 	free(r1info);
 }
 
@@ -256,6 +1182,9 @@ raid1_start(struct raid_bdev *raid_bdev)
 		return -ENOMEM;
 	}
 	r1info->raid_bdev = raid_bdev;
+	spdk_spin_init(&r1info->write_behind_lock);
+	TAILQ_INIT(&r1info->write_behind_ios);
+	TAILQ_INIT(&r1info->write_behind_waiting);
 
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		min_blockcnt = spdk_min(min_blockcnt, base_info->data_size);
@@ -270,7 +1199,8 @@ raid1_start(struct raid_bdev *raid_bdev)
 
 	snprintf(name, sizeof(name), "raid1_%s", raid_bdev->bdev.name);
 	spdk_io_device_register(r1info, raid1_ioch_create, raid1_ioch_destroy,
-				sizeof(struct raid1_io_channel) + raid_bdev->num_base_bdevs * sizeof(uint64_t),
+				sizeof(struct raid1_io_channel) +
+				raid_bdev->num_base_bdevs * sizeof(struct raid1_base_channel),
 				name);
 
 	return 0;
@@ -302,6 +1232,7 @@ static struct raid_bdev_module g_raid1_module = {
 	.start = raid1_start,
 	.stop = raid1_stop,
 	.submit_rw_request = raid1_submit_rw_request,
+	.submit_process_request = raid1_submit_process_request,
 	.get_io_channel = raid1_get_io_channel,
 };
 RAID_MODULE_REGISTER(&g_raid1_module)
@@ -0,0 +1,642 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "bdev_raid.h"
+
+#include "spdk/likely.h"
+#include "spdk/log.h"
+
+/*
+ * raid10 stripes the data in strips across mirror groups, like raid0 does across base bdevs.
+ * Each mirror group is made of RAID10_MIRRORS adjacent base bdevs holding the same data, so
+ * base bdevs 0 and 1 form the first group, 2 and 3 the second, and so on.
+ */
+#define RAID10_MIRRORS	2
+
+struct raid10_info {
+	/* The parent raid bdev */
+	struct raid_bdev *raid_bdev;
+};
+
+struct raid10_io_channel {
+	/* Array of per-base_bdev counters of outstanding read blocks on this channel */
+	uint64_t read_blocks_outstanding[0];
+};
+
+static inline uint8_t
+raid10_num_groups(struct raid_bdev *raid_bdev)
+{
+	return raid_bdev->num_base_bdevs / RAID10_MIRRORS;
+}
+
+/*
+ * Maps an offset on the raid bdev to its mirror group and to the offset on the base bdevs
+ * of that group.
+ */
+static inline uint8_t
+raid10_map_offset(struct raid_bdev *raid_bdev, uint64_t offset_blocks, uint64_t *base_offset_blocks)
+{
+	uint8_t num_groups = raid10_num_groups(raid_bdev);
+	uint64_t strip = offset_blocks >> raid_bdev->strip_size_shift;
+
+	*base_offset_blocks = ((strip / num_groups) << raid_bdev->strip_size_shift) +
+			      (offset_blocks & (raid_bdev->strip_size - 1));
+
+	return strip % num_groups;
+}
+
+static void
+raid10_channel_inc_read_counters(struct raid_bdev_io_channel *raid_ch, uint8_t idx,
+				 uint64_t num_blocks)
+{
+	struct raid10_io_channel *raid10_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+
+	assert(raid10_ch->read_blocks_outstanding[idx] <= UINT64_MAX - num_blocks);
+	raid10_ch->read_blocks_outstanding[idx] += num_blocks;
+}
+
+static void
+raid10_channel_dec_read_counters(struct raid_bdev_io_channel *raid_ch, uint8_t idx,
+				 uint64_t num_blocks)
+{
+	struct raid10_io_channel *raid10_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+
+	assert(raid10_ch->read_blocks_outstanding[idx] >= num_blocks);
+	raid10_ch->read_blocks_outstanding[idx] -= num_blocks;
+}
+
+static void
+raid10_bdev_io_completion(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_io *raid_io = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	raid_bdev_io_complete_part(raid_io, 1, success ?
+				   SPDK_BDEV_IO_STATUS_SUCCESS :
+				   SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+raid10_read_bdev_io_completion(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_io *raid_io = cb_arg;
+
+	raid10_channel_dec_read_counters(raid_io->raid_ch, raid_io->base_bdev_io_submitted,
+					 raid_io->num_blocks);
+
+	raid10_bdev_io_completion(bdev_io, success, raid_io);
+}
+
+static void raid10_submit_rw_request(struct raid_bdev_io *raid_io);
+
+static void
+_raid10_submit_rw_request(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid10_submit_rw_request(raid_io);
+}
+
+static void
+raid10_init_ext_io_opts(struct spdk_bdev_ext_io_opts *opts, struct raid_bdev_io *raid_io)
+{
+	memset(opts, 0, sizeof(*opts));
+	opts->size = sizeof(*opts);
+	opts->memory_domain = raid_io->memory_domain;
+	opts->memory_domain_ctx = raid_io->memory_domain_ctx;
+	opts->metadata = raid_io->md_buf;
+}
+
+/*
+ * Picks the member of the mirror group with the least read blocks outstanding on this channel.
+ */
+static uint8_t
+raid10_channel_next_read_base_bdev(struct raid_bdev_io_channel *raid_ch, uint8_t group)
+{
+	struct raid10_io_channel *raid10_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	uint64_t read_blocks_min = UINT64_MAX;
+	uint8_t idx = UINT8_MAX;
+	uint8_t i;
+
+	for (i = group * RAID10_MIRRORS; i < (group + 1) * RAID10_MIRRORS; i++) {
+		if (raid_bdev_channel_get_base_channel(raid_ch, i) != NULL &&
+		    raid10_ch->read_blocks_outstanding[i] < read_blocks_min) {
+			read_blocks_min = raid10_ch->read_blocks_outstanding[i];
+			idx = i;
+		}
+	}
+
+	return idx;
+}
+
+static int
+raid10_submit_read_request(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid_bdev_io_channel *raid_ch = raid_io->raid_ch;
+	struct spdk_bdev_ext_io_opts io_opts;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_io_channel *base_ch;
+	uint64_t base_offset_blocks;
+	uint8_t group, idx;
+	int ret;
+
+	group = raid10_map_offset(raid_bdev, raid_io->offset_blocks, &base_offset_blocks);
+
+	idx = raid10_channel_next_read_base_bdev(raid_ch, group);
+	if (spdk_unlikely(idx == UINT8_MAX)) {
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return 0;
+	}
+
+	base_info = &raid_bdev->base_bdev_info[idx];
+	base_ch = raid_bdev_channel_get_base_channel(raid_ch, idx);
+
+	raid_io->base_bdev_io_remaining = 1;
+
+	raid10_init_ext_io_opts(&io_opts, raid_io);
+	ret = raid_bdev_readv_blocks_ext(base_info, base_ch, raid_io->iovs, raid_io->iovcnt,
+					 base_offset_blocks, raid_io->num_blocks,
+					 raid10_read_bdev_io_completion, raid_io, &io_opts);
+
+	if (spdk_likely(ret == 0)) {
+		raid10_channel_inc_read_counters(raid_ch, idx, raid_io->num_blocks);
+		raid_io->base_bdev_io_submitted = idx;
+	} else if (spdk_unlikely(ret == -ENOMEM)) {
+		raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
+					base_ch, _raid10_submit_rw_request);
+		return 0;
+	}
+
+	return ret;
+}
+
+static int
+raid10_submit_write_request(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct spdk_bdev_ext_io_opts io_opts;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_io_channel *base_ch;
+	uint64_t base_offset_blocks;
+	uint8_t group, idx;
+	uint64_t i;
+	int ret;
+
+	group = raid10_map_offset(raid_bdev, raid_io->offset_blocks, &base_offset_blocks);
+
+	if (raid_io->base_bdev_io_submitted == 0) {
+		for (i = 0; i < RAID10_MIRRORS; i++) {
+			if (raid_bdev_channel_get_base_channel(raid_io->raid_ch,
+							       group * RAID10_MIRRORS + i) != NULL) {
+				break;
+			}
+		}
+		if (spdk_unlikely(i == RAID10_MIRRORS)) {
+			/* the whole mirror group is missing */
+			return -ENODEV;
+		}
+
+		raid_io->base_bdev_io_remaining = RAID10_MIRRORS;
+	}
+
+	raid10_init_ext_io_opts(&io_opts, raid_io);
+	for (i = raid_io->base_bdev_io_submitted; i < RAID10_MIRRORS; i++) {
+		idx = group * RAID10_MIRRORS + i;
+		base_info = &raid_bdev->base_bdev_info[idx];
+		base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch, idx);
+
+		raid_io->base_bdev_io_submitted = i + 1;
+
+		if (base_ch == NULL) {
+			/* skip a missing member of the group */
+			raid_bdev_io_complete_part(raid_io, 1, SPDK_BDEV_IO_STATUS_SUCCESS);
+			continue;
+		}
+
+		ret = raid_bdev_writev_blocks_ext(base_info, base_ch, raid_io->iovs, raid_io->iovcnt,
+						  base_offset_blocks, raid_io->num_blocks,
+						  raid10_bdev_io_completion, raid_io, &io_opts);
+		if (spdk_unlikely(ret != 0)) {
+			raid_io->base_bdev_io_submitted = i;
+
+			if (spdk_unlikely(ret == -ENOMEM)) {
+				raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
+							base_ch, _raid10_submit_rw_request);
+				return 0;
+			}
+
+			raid_bdev_io_complete_part(raid_io, RAID10_MIRRORS - i,
+						   SPDK_BDEV_IO_STATUS_FAILED);
+			return 0;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * brief:
+ * raid10_submit_rw_request function is used to submit I/O to the mirror group of a raid10
+ * bdev. I/O doesn't span a strip boundary, so it is handled by a single mirror group. Reads
+ * go to one member of the group and writes go to all of them.
+ * params:
+ * raid_io
+ * returns:
+ * none
+ */
+static void
+raid10_submit_rw_request(struct raid_bdev_io *raid_io)
+{
+	int ret;
+
+	assert((raid_io->offset_blocks >> raid_io->raid_bdev->strip_size_shift) ==
+	       ((raid_io->offset_blocks + raid_io->num_blocks - 1) >>
+		raid_io->raid_bdev->strip_size_shift));
+
+	switch (raid_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		ret = raid10_submit_read_request(raid_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		ret = raid10_submit_write_request(raid_io);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	if (spdk_unlikely(ret != 0)) {
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void raid10_submit_null_payload_request(struct raid_bdev_io *raid_io);
+
+static void
+_raid10_submit_null_payload_request(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid10_submit_null_payload_request(raid_io);
+}
+
+/*
+ * brief:
+ * raid10_submit_null_payload_request function submits requests with a range but without
+ * payload, like FLUSH and UNMAP, to all the members of the mirror groups covered by the
+ * range. It submits as many as possible unless one of them fails with -ENOMEM, in which
+ * case it queues itself for later submission.
+ * params:
+ * raid_io
+ * returns:
+ * none
+ */
+static void
+raid10_submit_null_payload_request(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	uint8_t num_groups = raid10_num_groups(raid_bdev);
+	uint64_t start_strip, end_strip, first_strip, last_strip;
+	uint64_t start_offset, end_offset;
+	uint64_t offset_in_disk, nblocks_in_disk;
+	uint64_t n_groups_involved, total, i;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_io_channel *base_ch;
+	uint8_t idx;
+	int ret;
+
+	start_strip = raid_io->offset_blocks >> raid_bdev->strip_size_shift;
+	end_strip = (raid_io->offset_blocks + raid_io->num_blocks - 1) >> raid_bdev->strip_size_shift;
+	n_groups_involved = spdk_min(end_strip - start_strip + 1, num_groups);
+	total = n_groups_involved * RAID10_MIRRORS;
+
+	if (raid_io->base_bdev_io_remaining == 0) {
+		raid_io->base_bdev_io_remaining = total;
+	}
+
+	for (i = raid_io->base_bdev_io_submitted; i < total; i++) {
+		/* The first and the last strip of the range on this mirror group */
+		first_strip = start_strip + i / RAID10_MIRRORS;
+		last_strip = end_strip - (end_strip - first_strip) % num_groups;
+
+		start_offset = first_strip == start_strip ?
+			       raid_io->offset_blocks & (raid_bdev->strip_size - 1) : 0;
+		end_offset = last_strip == end_strip ?
+			     (raid_io->offset_blocks + raid_io->num_blocks - 1) & (raid_bdev->strip_size - 1) :
+			     raid_bdev->strip_size - 1;
+
+		offset_in_disk = ((first_strip / num_groups) << raid_bdev->strip_size_shift) + start_offset;
+		nblocks_in_disk = (((last_strip / num_groups) << raid_bdev->strip_size_shift) + end_offset) -
+				  offset_in_disk + 1;
+
+		idx = (first_strip % num_groups) * RAID10_MIRRORS + i % RAID10_MIRRORS;
+		base_info = &raid_bdev->base_bdev_info[idx];
+		base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch, idx);
+
+		raid_io->base_bdev_io_submitted = i + 1;
+
+		if (base_ch == NULL) {
+			/* skip a missing member of the group */
+			raid_bdev_io_complete_part(raid_io, 1, SPDK_BDEV_IO_STATUS_SUCCESS);
+			continue;
+		}
+
+		switch (raid_io->type) {
+		case SPDK_BDEV_IO_TYPE_UNMAP:
+			ret = raid_bdev_unmap_blocks(base_info, base_ch, offset_in_disk, nblocks_in_disk,
+						     raid10_bdev_io_completion, raid_io);
+			break;
+
+		case SPDK_BDEV_IO_TYPE_FLUSH:
+			ret = raid_bdev_flush_blocks(base_info, base_ch, offset_in_disk, nblocks_in_disk,
+						     raid10_bdev_io_completion, raid_io);
+			break;
+
+		default:
+			SPDK_ERRLOG("submit request, invalid io type with null payload %u\n", raid_io->type);
+			assert(false);
+			ret = -EIO;
+		}
+
+		if (spdk_unlikely(ret != 0)) {
+			raid_io->base_bdev_io_submitted = i;
+
+			if (ret == -ENOMEM) {
+				raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
+							base_ch, _raid10_submit_null_payload_request);
+				return;
+			}
+
+			SPDK_ERRLOG("bdev io submit error not due to ENOMEM, it should not happen\n");
+			assert(false);
+			raid_bdev_io_complete_part(raid_io, total - i, SPDK_BDEV_IO_STATUS_FAILED);
+			return;
+		}
+	}
+}
+
+static void raid10_process_submit_write(struct raid_bdev_process_request *process_req);
+
+static void
+_raid10_process_submit_write(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid10_process_submit_write(SPDK_CONTAINEROF(raid_io, struct raid_bdev_process_request,
+				    raid_io));
+}
+
+static void
+raid10_process_write_completed(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_process_request *process_req;
+
+	process_req = SPDK_CONTAINEROF(raid_io, struct raid_bdev_process_request, raid_io);
+
+	raid_bdev_process_request_complete(process_req,
+					   status == SPDK_BDEV_IO_STATUS_SUCCESS ? 0 : -EIO);
+}
+
+/*
+ * Write the data read from a member of the mirror group to the rebuild target or, for a
+ * resync, to the other members of the group.
+ */
+static void
+raid10_process_submit_write(struct raid_bdev_process_request *process_req)
+{
+	struct raid_bdev_io *raid_io = &process_req->raid_io;
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	uint8_t read_idx = (uint8_t)(uintptr_t)raid_io->module_private;
+	uint8_t group = read_idx / RAID10_MIRRORS;
+	struct spdk_bdev_ext_io_opts io_opts;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_io_channel *base_ch;
+	uint64_t base_offset_blocks;
+	uint8_t idx;
+	uint64_t i;
+	int ret;
+
+	raid10_map_offset(raid_bdev, raid_io->offset_blocks, &base_offset_blocks);
+	raid10_init_ext_io_opts(&io_opts, raid_io);
+
+	if (process_req->target != NULL) {
+		ret = raid_bdev_writev_blocks_ext(process_req->target, process_req->target_ch,
+						  raid_io->iovs, raid_io->iovcnt,
+						  base_offset_blocks, raid_io->num_blocks,
+						  raid10_bdev_io_completion, raid_io, &io_opts);
+		if (spdk_unlikely(ret == -ENOMEM)) {
+			raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(process_req->target->desc),
+						process_req->target_ch, _raid10_process_submit_write);
+		} else if (spdk_unlikely(ret != 0)) {
+			raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		}
+		return;
+	}
+
+	for (i = raid_io->base_bdev_io_submitted; i < RAID10_MIRRORS; i++) {
+		idx = group * RAID10_MIRRORS + i;
+		base_info = &raid_bdev->base_bdev_info[idx];
+		base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch, idx);
+
+		raid_io->base_bdev_io_submitted = i + 1;
+
+		if (base_ch == NULL || idx == read_idx) {
+			raid_bdev_io_complete_part(raid_io, 1, SPDK_BDEV_IO_STATUS_SUCCESS);
+			continue;
+		}
+
+		ret = raid_bdev_writev_blocks_ext(base_info, base_ch, raid_io->iovs, raid_io->iovcnt,
+						  base_offset_blocks, raid_io->num_blocks,
+						  raid10_bdev_io_completion, raid_io, &io_opts);
+		if (spdk_unlikely(ret != 0)) {
+			raid_io->base_bdev_io_submitted = i;
+
+			if (spdk_unlikely(ret == -ENOMEM)) {
+				raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
+							base_ch, _raid10_process_submit_write);
+				return;
+			}
+
+			raid_bdev_io_complete_part(raid_io, RAID10_MIRRORS - i,
+						   SPDK_BDEV_IO_STATUS_FAILED);
+			return;
+		}
+	}
+}
+
+static void
+raid10_process_read_completed(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_process_request *process_req;
+
+	process_req = SPDK_CONTAINEROF(raid_io, struct raid_bdev_process_request, raid_io);
+
+	if (status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		raid_bdev_process_request_complete(process_req, -EIO);
+		return;
+	}
+
+	/* remember the member the data came from, so that a resync doesn't write it back */
+	raid_io->module_private = (void *)(uintptr_t)raid_io->base_bdev_io_submitted;
+	raid_io->completion_cb = raid10_process_write_completed;
+	raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_SUCCESS;
+	raid_io->base_bdev_io_submitted = 0;
+	raid_io->base_bdev_io_remaining = process_req->target != NULL ? 1 : RAID10_MIRRORS;
+
+	raid10_process_submit_write(process_req);
+}
+
+/*
+ * A process request handles at most one strip. A rebuild only touches the strips of the
+ * target's mirror group, so the strips of the other groups are skipped right away.
+ */
+static int
+raid10_submit_process_request(struct raid_bdev_process_request *process_req,
+			      struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_bdev_io *raid_io = &process_req->raid_io;
+	struct raid_bdev *raid_bdev;
+	uint64_t offset_blocks = process_req->offset_blocks;
+	uint64_t base_offset_blocks, strip_end, num_blocks;
+	uint8_t group, target_group, num_groups;
+	int ret;
+
+	raid_bdev_io_init(raid_io, raid_ch, SPDK_BDEV_IO_TYPE_READ, offset_blocks, 0,
+			  &process_req->iov, 1, process_req->md_buf, NULL, NULL);
+	raid_bdev = raid_io->raid_bdev;
+	num_groups = raid10_num_groups(raid_bdev);
+
+	group = raid10_map_offset(raid_bdev, offset_blocks, &base_offset_blocks);
+	strip_end = ((offset_blocks >> raid_bdev->strip_size_shift) + 1) << raid_bdev->strip_size_shift;
+
+	if (process_req->target != NULL) {
+		target_group = raid_bdev_base_bdev_slot(process_req->target) / RAID10_MIRRORS;
+		if (target_group != group) {
+			/* skip to the next strip of the target's group */
+			num_blocks = strip_end - offset_blocks +
+				     ((uint64_t)((target_group + num_groups - group - 1) % num_groups) <<
+				      raid_bdev->strip_size_shift);
+			num_blocks = spdk_min(num_blocks, process_req->num_blocks);
+			process_req->num_blocks = num_blocks;
+			raid_bdev_process_request_complete(process_req, 0);
+			return num_blocks;
+		}
+	}
+
+	num_blocks = spdk_min(strip_end - offset_blocks, process_req->num_blocks);
+	process_req->num_blocks = num_blocks;
+	process_req->iov.iov_len = num_blocks << raid_bdev->blocklen_shift;
+	raid_io->num_blocks = num_blocks;
+	raid_io->completion_cb = raid10_process_read_completed;
+
+	ret = raid10_submit_read_request(raid_io);
+	if (spdk_unlikely(ret != 0)) {
+		return ret;
+	}
+
+	return num_blocks;
+}
+
+static void
+raid10_ioch_destroy(void *io_device, void *ctx_buf)
+{
+}
+
+static int
+raid10_ioch_create(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+raid10_io_device_unregister_done(void *io_device)
+{
+	struct raid10_info *r10info = io_device;
+
+	raid_bdev_module_stop_done(r10info->raid_bdev);
+
+	free(r10info);
+}
+
+static int
+raid10_start(struct raid_bdev *raid_bdev)
+{
+	uint64_t min_blockcnt = UINT64_MAX;
+	uint64_t base_bdev_data_size;
+	struct raid_base_bdev_info *base_info;
+	struct raid10_info *r10info;
+	char name[256];
+
+	assert(raid_bdev->num_base_bdevs % RAID10_MIRRORS == 0);
+
+	r10info = calloc(1, sizeof(*r10info));
+	if (!r10info) {
+		SPDK_ERRLOG("Failed to allocate RAID10 info device structure\n");
+		return -ENOMEM;
+	}
+	r10info->raid_bdev = raid_bdev;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		min_blockcnt = spdk_min(min_blockcnt, base_info->data_size);
+	}
+
+	base_bdev_data_size = (min_blockcnt >> raid_bdev->strip_size_shift) << raid_bdev->strip_size_shift;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		base_info->data_size = base_bdev_data_size;
+	}
+
+	raid_bdev->bdev.blockcnt = base_bdev_data_size * raid10_num_groups(raid_bdev);
+	raid_bdev->bdev.optimal_io_boundary = raid_bdev->strip_size;
+	raid_bdev->bdev.split_on_optimal_io_boundary = true;
+	raid_bdev->module_private = r10info;
+
+	snprintf(name, sizeof(name), "raid10_%s", raid_bdev->bdev.name);
+	spdk_io_device_register(r10info, raid10_ioch_create, raid10_ioch_destroy,
+				sizeof(struct raid10_io_channel) + raid_bdev->num_base_bdevs * sizeof(uint64_t),
+				name);
+
+	return 0;
+}
+
+static bool
+raid10_stop(struct raid_bdev *raid_bdev)
+{
+	struct raid10_info *r10info = raid_bdev->module_private;
+
+	spdk_io_device_unregister(r10info, raid10_io_device_unregister_done);
+
+	return false;
+}
+
+static struct spdk_io_channel *
+raid10_get_io_channel(struct raid_bdev *raid_bdev)
+{
+	struct raid10_info *r10info = raid_bdev->module_private;
+
+	return spdk_get_io_channel(r10info);
+}
+
+static struct raid_bdev_module g_raid10_module = {
+	.level = RAID10,
+	.base_bdevs_min = 2 * RAID10_MIRRORS,
+	/*
+	 * A raid10 bdev survives the loss of one member of every mirror group, but the
+	 * constraint can only express how many base bdevs may be missing in total.
+	 */
+	.base_bdevs_constraint = {CONSTRAINT_MAX_BASE_BDEVS_REMOVED, RAID10_MIRRORS - 1},
+	.memory_domains_supported = true,
+	.start = raid10_start,
+	.stop = raid10_stop,
+	.submit_rw_request = raid10_submit_rw_request,
+	.submit_null_payload_request = raid10_submit_null_payload_request,
+	.submit_process_request = raid10_submit_process_request,
+	.get_io_channel = raid10_get_io_channel,
+};
+RAID_MODULE_REGISTER(&g_raid10_module)
+
+SPDK_LOG_REGISTER_COMPONENT(bdev_raid10)
@@ -13,9 +13,12 @@
 #include "spdk/log.h"
 #include "spdk/accel.h"
 
-/* Maximum concurrent full stripe writes per io channel */
+/* Maximum concurrent stripe writes per io channel */
 #define RAID5F_MAX_STRIPES 32
 
+/* Number of hash buckets of the stripes locked for writing */
+#define RAID5F_LOCKED_STRIPES_BUCKETS 64
+
 struct chunk {
 	/* Corresponds to base_bdev index */
 	uint8_t index;
@@ -31,6 +34,38 @@ struct chunk {
 
 	/* Pointer to buffer with I/O metadata */
 	void *md_buf;
+
+	/* Range of blocks within the chunk written by a stripe write */
+	uint64_t write_offset;
+	uint64_t write_blocks;
+
+	/* Read the chunk's old data before a partial stripe write */
+	bool read_old;
+
+	/* Buffer for the chunk's old data */
+	struct iovec old_iov;
+
+	/* Chunk data after a partial stripe write, used for the parity calculation */
+	struct iovec *xor_iovs;
+	int xor_iovcnt;
+	int xor_iovcnt_max;
+};
+
+enum stripe_write_mode {
+	/* All data chunks are written, parity is calculated from the new data */
+	STRIPE_WRITE_FULL,
+	/* Old data of the written chunks and old parity are read (read-modify-write) */
+	STRIPE_WRITE_RMW,
+	/* Old data of the chunks that are not fully written is read (reconstruct-write) */
+	STRIPE_WRITE_RCW,
+	/*
+	 * Reconstruct-write of a degraded stripe whose missing chunk is written partially. The
+	 * old data of the missing chunk is reconstructed from the old data of the rest of the
+	 * stripe first.
+	 */
+	STRIPE_WRITE_RCW_RECONSTRUCT,
+	/* The parity chunk's base bdev is missing, only the data is written */
+	STRIPE_WRITE_NO_PARITY,
 };
 
 struct stripe_request;
@@ -60,6 +95,27 @@ struct stripe_request {
 
 			/* Buffer for stripe io metadata parity */
 			void *parity_md_buf;
+
+			/* Array of buffers for reading old chunk data, indexed like chunks */
+			void **chunk_buffers;
+
+			/* The raid_ios written by this request, sorted by offset */
+			TAILQ_HEAD(, raid_bdev_io) raid_ios;
+
+			/* Number of blocks written by the raid_ios */
+			uint64_t blocks;
+
+			/* Range of blocks within the chunks updated by the write */
+			uint64_t range_offset;
+			uint64_t range_blocks;
+
+			enum stripe_write_mode mode;
+
+			/* Old data is being read */
+			bool reading;
+
+			/* Missing chunk whose old data is reconstructed before the parity update */
+			struct chunk *reconstruct_chunk;
 		} write;
 
 		struct {
@@ -74,6 +130,9 @@ struct stripe_request {
 
 			/* Offset from chunk start */
 			uint64_t chunk_offset;
+
+			/* The raid_io's own completion_cb, called when the reconstruction is done */
+			raid_bdev_io_completion_cb completion_cb;
 		} reconstruct;
 	};
 
@@ -90,12 +149,19 @@ struct stripe_request {
 		size_t len;
 		size_t remaining;
 		size_t remaining_md;
+		uint8_t n_src;
 		int status;
 		stripe_req_xor_cb cb;
 	} xor;
 
 	TAILQ_ENTRY(stripe_request) link;
 
+	/* Requests of the same stripe waiting for this one to finish */
+	TAILQ_HEAD(, stripe_request) lock_waiters;
+
+	/* Link in the locked stripes of raid5f_info or in lock_waiters of the holder */
+	TAILQ_ENTRY(stripe_request) lock_link;
+
 	/* Array of chunks corresponding to base_bdevs */
 	struct chunk chunks[0];
 };
@@ -112,6 +178,16 @@ struct raid5f_info {
 
 	/* Alignment for buffer allocation */
 	size_t buf_alignment;
+
+	/*
+	 * Requests holding the lock of their stripe, hashed by the stripe index. Only one write
+	 * request at a time updates the parity of a stripe, across all io channels, and a
+	 * degraded read doesn't reconstruct data from a stripe while its parity is updated.
+	 */
+	TAILQ_HEAD(, stripe_request) locked_stripes[RAID5F_LOCKED_STRIPES_BUCKETS];
+
+	/* Lock protecting locked_stripes */
+	struct spdk_spinlock locked_stripes_lock;
 };
 
 struct raid5f_io_channel {
@@ -127,6 +203,12 @@ struct raid5f_io_channel {
 	/* For retrying xor if accel_ch runs out of resources */
 	TAILQ_HEAD(, stripe_request) xor_retry_queue;
 
+	/* Partial stripe writes waiting for more writes to the same stripe */
+	TAILQ_HEAD(, stripe_request) write_cache;
+
+	/* Flushing write_cache is scheduled */
+	bool write_cache_flush_scheduled;
+
 	/* For iterating over chunk iovecs during xor calculation */
 	void **chunk_xor_buffers;
 	struct iovec **chunk_xor_iovs;
@@ -167,12 +249,27 @@ raid5f_stripe_data_chunks_num(const struct raid_bdev *raid_bdev)
 	return raid_bdev->min_base_bdevs_operational;
 }
 
+/* Maximum number of iovec arrays used for a parity calculation, including the destination */
+static inline uint8_t
+raid5f_xor_iovs_max(const struct raid_bdev *raid_bdev)
+{
+	return raid_bdev->num_base_bdevs * 2;
+}
+
 static inline uint8_t
 raid5f_stripe_parity_chunk_index(const struct raid_bdev *raid_bdev, uint64_t stripe_index)
 {
 	return raid5f_stripe_data_chunks_num(raid_bdev) - stripe_index % raid_bdev->num_base_bdevs;
 }
 
+static inline struct chunk *
+raid5f_stripe_data_chunk(struct stripe_request *stripe_req, uint8_t data_chunk_idx)
+{
+	struct chunk *chunk = &stripe_req->chunks[data_chunk_idx];
+
+	return chunk < stripe_req->parity_chunk ? chunk : chunk + 1;
+}
+
 static inline void
 raid5f_stripe_request_release(struct stripe_request *stripe_req)
 {
@@ -249,9 +346,7 @@ static void
 raid5f_xor_stripe_continue(struct stripe_request *stripe_req)
 {
 	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
-	struct raid_bdev_io *raid_io = stripe_req->raid_io;
-	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
-	uint8_t n_src = raid5f_stripe_data_chunks_num(raid_bdev);
+	uint8_t n_src = stripe_req->xor.n_src;
 	uint8_t i;
 	int ret;
 
@@ -274,6 +369,53 @@ raid5f_xor_stripe_continue(struct stripe_request *stripe_req)
 	}
 }
 
+static inline void
+raid5f_xor_set_iovs(struct raid5f_io_channel *r5ch, uint8_t i, struct iovec *iovs, int iovcnt)
+{
+	r5ch->chunk_xor_iovs[i] = iovs;
+	r5ch->chunk_xor_iovcnt[i] = iovcnt;
+}
+
+static uint8_t
+raid5f_stripe_write_request_set_xor_src(struct stripe_request *stripe_req)
+{
+	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
+	struct chunk *chunk;
+	uint8_t c = 0;
+
+	if (stripe_req->write.mode == STRIPE_WRITE_RMW) {
+		/* new parity = old parity ^ old data ^ new data of each written chunk */
+		raid5f_xor_set_iovs(r5ch, c++, &stripe_req->parity_chunk->old_iov, 1);
+	}
+
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		switch (stripe_req->write.mode) {
+		case STRIPE_WRITE_FULL:
+			raid5f_xor_set_iovs(r5ch, c++, chunk->iovs, chunk->iovcnt);
+			break;
+		case STRIPE_WRITE_RMW:
+			if (chunk->write_blocks != 0) {
+				raid5f_xor_set_iovs(r5ch, c++, &chunk->old_iov, 1);
+				raid5f_xor_set_iovs(r5ch, c++, chunk->xor_iovs, chunk->xor_iovcnt);
+			}
+			break;
+		case STRIPE_WRITE_RCW:
+		case STRIPE_WRITE_RCW_RECONSTRUCT:
+			if (chunk->write_blocks != 0) {
+				raid5f_xor_set_iovs(r5ch, c++, chunk->xor_iovs, chunk->xor_iovcnt);
+			} else {
+				raid5f_xor_set_iovs(r5ch, c++, &chunk->old_iov, 1);
+			}
+			break;
+		default:
+			assert(false);
+			break;
+		}
+	}
+
+	return c;
+}
+
 static void
 raid5f_xor_stripe(struct stripe_request *stripe_req, stripe_req_xor_cb cb)
 {
@@ -282,35 +424,55 @@ raid5f_xor_stripe(struct stripe_request *stripe_req, stripe_req_xor_cb cb)
 	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
 	struct chunk *chunk;
 	struct chunk *dest_chunk;
+	struct iovec *dest_iovs;
+	int dest_iovcnt;
 	uint64_t num_blocks;
 	uint8_t c;
 
 	assert(cb != NULL);
 
 	if (spdk_likely(stripe_req->type == STRIPE_REQ_WRITE)) {
-		num_blocks = raid_bdev->strip_size;
-		dest_chunk = stripe_req->parity_chunk;
+		num_blocks = stripe_req->write.range_blocks;
+		dest_chunk = stripe_req->write.reconstruct_chunk;
+		if (spdk_unlikely(dest_chunk != NULL)) {
+			/* old data of the missing chunk = old parity ^ old data of the other chunks */
+			c = 0;
+			FOR_EACH_CHUNK(stripe_req, chunk) {
+				if (chunk != dest_chunk) {
+					raid5f_xor_set_iovs(r5ch, c++, &chunk->old_iov, 1);
+				}
+			}
+			dest_iovs = &dest_chunk->old_iov;
+			dest_iovcnt = 1;
+		} else {
+			dest_chunk = stripe_req->parity_chunk;
+			dest_iovs = dest_chunk->iovs;
+			dest_iovcnt = dest_chunk->iovcnt;
+			c = raid5f_stripe_write_request_set_xor_src(stripe_req);
+		}
 	} else if (stripe_req->type == STRIPE_REQ_RECONSTRUCT) {
 		num_blocks = raid_io->num_blocks;
 		dest_chunk = stripe_req->reconstruct.chunk;
+		dest_iovs = dest_chunk->iovs;
+		dest_iovcnt = dest_chunk->iovcnt;
+
+		c = 0;
+		FOR_EACH_CHUNK(stripe_req, chunk) {
+			if (chunk == dest_chunk) {
+				continue;
+			}
+			raid5f_xor_set_iovs(r5ch, c++, chunk->iovs, chunk->iovcnt);
+		}
 	} else {
 		assert(false);
+		return;
 	}
 
-	c = 0;
-	FOR_EACH_CHUNK(stripe_req, chunk) {
-		if (chunk == dest_chunk) {
-			continue;
-		}
-		r5ch->chunk_xor_iovs[c] = chunk->iovs;
-		r5ch->chunk_xor_iovcnt[c] = chunk->iovcnt;
-		c++;
-	}
-	r5ch->chunk_xor_iovs[c] = dest_chunk->iovs;
-	r5ch->chunk_xor_iovcnt[c] = dest_chunk->iovcnt;
+	stripe_req->xor.n_src = c;
+	raid5f_xor_set_iovs(r5ch, c, dest_iovs, dest_iovcnt);
 
 	stripe_req->xor.len = spdk_ioviter_firstv(stripe_req->chunk_iov_iters,
-			      raid_bdev->num_base_bdevs,
+			      c + 1,
 			      r5ch->chunk_xor_iovs,
 			      r5ch->chunk_xor_iovcnt,
 			      r5ch->chunk_xor_buffers);
@@ -360,24 +522,6 @@ raid5f_xor_stripe_retry(struct stripe_request *stripe_req)
 	}
 }
 
-static void
-raid5f_stripe_request_chunk_write_complete(struct stripe_request *stripe_req,
-		enum spdk_bdev_io_status status)
-{
-	if (raid_bdev_io_complete_part(stripe_req->raid_io, 1, status)) {
-		raid5f_stripe_request_release(stripe_req);
-	}
-}
-
-static void
-raid5f_stripe_request_chunk_read_complete(struct stripe_request *stripe_req,
-		enum spdk_bdev_io_status status)
-{
-	struct raid_bdev_io *raid_io = stripe_req->raid_io;
-
-	raid_bdev_io_complete_part(raid_io, 1, status);
-}
-
 static void
 raid5f_chunk_complete_bdev_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
@@ -388,13 +532,8 @@ raid5f_chunk_complete_bdev_io(struct spdk_bdev_io *bdev_io, bool success, void *
 
 	spdk_bdev_free_io(bdev_io);
 
-	if (spdk_likely(stripe_req->type == STRIPE_REQ_WRITE)) {
-		raid5f_stripe_request_chunk_write_complete(stripe_req, status);
-	} else if (stripe_req->type == STRIPE_REQ_RECONSTRUCT) {
-		raid5f_stripe_request_chunk_read_complete(stripe_req, status);
-	} else {
-		assert(false);
-	}
+	/* The stripe request continues in the completion_cb of its raid_io */
+	raid_bdev_io_complete_part(stripe_req->raid_io, 1, status);
 }
 
 static void raid5f_stripe_request_submit_chunks(struct stripe_request *stripe_req);
@@ -413,9 +552,11 @@ raid5f_init_ext_io_opts(struct spdk_bdev_ext_io_opts *opts, struct raid_bdev_io
 {
 	memset(opts, 0, sizeof(*opts));
 	opts->size = sizeof(*opts);
-	opts->memory_domain = raid_io->memory_domain;
-	opts->memory_domain_ctx = raid_io->memory_domain_ctx;
-	opts->metadata = raid_io->md_buf;
+	if (raid_io != NULL) {
+		opts->memory_domain = raid_io->memory_domain;
+		opts->memory_domain_ctx = raid_io->memory_domain_ctx;
+		opts->metadata = raid_io->md_buf;
+	}
 }
 
 static int
@@ -438,13 +579,34 @@ raid5f_chunk_submit(struct chunk *chunk)
 
 	switch (stripe_req->type) {
 	case STRIPE_REQ_WRITE:
-		if (base_ch == NULL) {
+		if (stripe_req->write.reading) {
+			if (!chunk->read_old) {
+				raid_bdev_io_complete_part(raid_io, 1, SPDK_BDEV_IO_STATUS_SUCCESS);
+				return 0;
+			}
+
+			/* Old data is read into the stripe request's own buffers */
+			raid5f_init_ext_io_opts(&io_opts, NULL);
+
+			ret = raid_bdev_readv_blocks_ext(base_info, base_ch, &chunk->old_iov, 1,
+							 base_offset_blocks + stripe_req->write.range_offset,
+							 stripe_req->write.range_blocks,
+							 raid5f_chunk_complete_bdev_io, chunk, &io_opts);
+			break;
+		}
+
+		if (base_ch == NULL || chunk->write_blocks == 0) {
 			raid_bdev_io_complete_part(raid_io, 1, SPDK_BDEV_IO_STATUS_SUCCESS);
 			return 0;
 		}
 
+		if (chunk == stripe_req->parity_chunk) {
+			raid5f_init_ext_io_opts(&io_opts, NULL);
+			io_opts.metadata = chunk->md_buf;
+		}
+
 		ret = raid_bdev_writev_blocks_ext(base_info, base_ch, chunk->iovs, chunk->iovcnt,
-						  base_offset_blocks, raid_bdev->strip_size,
+						  base_offset_blocks + chunk->write_offset, chunk->write_blocks,
 						  raid5f_chunk_complete_bdev_io, chunk, &io_opts);
 		break;
 	case STRIPE_REQ_RECONSTRUCT:
@@ -473,23 +635,14 @@ raid5f_chunk_submit(struct chunk *chunk)
 		} else {
 			/*
 			 * Implicitly complete any I/Os not yet submitted as FAILED. If completing
-			 * these means there are no more to complete for the stripe request, we can
-			 * release the stripe request as well.
+			 * these means there are no more to complete for the stripe request, the
+			 * completion_cb of the raid_io releases the stripe request.
 			 */
-			uint64_t base_bdev_io_not_submitted;
+			uint64_t base_bdev_io_not_submitted = raid_bdev->num_base_bdevs -
+							      raid_io->base_bdev_io_submitted;
 
-			if (stripe_req->type == STRIPE_REQ_WRITE) {
-				base_bdev_io_not_submitted = raid_bdev->num_base_bdevs -
-							     raid_io->base_bdev_io_submitted;
-			} else {
-				base_bdev_io_not_submitted = raid5f_stripe_data_chunks_num(raid_bdev) -
-							     raid_io->base_bdev_io_submitted;
-			}
-
-			if (raid_bdev_io_complete_part(raid_io, base_bdev_io_not_submitted,
-						       SPDK_BDEV_IO_STATUS_FAILED)) {
-				raid5f_stripe_request_release(stripe_req);
-			}
+			raid_bdev_io_complete_part(raid_io, base_bdev_io_not_submitted,
+						   SPDK_BDEV_IO_STATUS_FAILED);
 		}
 	}
 
@@ -497,17 +650,31 @@ raid5f_chunk_submit(struct chunk *chunk)
 }
 
 static int
-raid5f_chunk_set_iovcnt(struct chunk *chunk, int iovcnt)
+raid5f_iovs_resize(struct iovec **_iovs, int *iovcnt_max, int iovcnt)
 {
-	if (iovcnt > chunk->iovcnt_max) {
-		struct iovec *iovs = chunk->iovs;
+	if (iovcnt > *iovcnt_max) {
+		struct iovec *iovs = *_iovs;
+		int n = spdk_max(iovcnt, *iovcnt_max * 2);
 
-		iovs = realloc(iovs, iovcnt * sizeof(*iovs));
+		iovs = realloc(iovs, n * sizeof(*iovs));
 		if (!iovs) {
 			return -ENOMEM;
 		}
-		chunk->iovs = iovs;
-		chunk->iovcnt_max = iovcnt;
+		*_iovs = iovs;
+		*iovcnt_max = n;
+	}
+
+	return 0;
+}
+
+static int
+raid5f_chunk_set_iovcnt(struct chunk *chunk, int iovcnt)
+{
+	int ret;
+
+	ret = raid5f_iovs_resize(&chunk->iovs, &chunk->iovcnt_max, iovcnt);
+	if (ret) {
+		return ret;
 	}
 	chunk->iovcnt = iovcnt;
 
@@ -517,68 +684,72 @@ raid5f_chunk_set_iovcnt(struct chunk *chunk, int iovcnt)
 static int
 raid5f_stripe_request_map_iovecs(struct stripe_request *stripe_req)
 {
-	struct raid_bdev_io *raid_io = stripe_req->raid_io;
-	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
-	void *raid_io_md = raid_io->md_buf;
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+	struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
 	uint32_t raid_io_md_size = spdk_bdev_get_md_size(&raid_bdev->bdev);
+	uint64_t stripe_offset_blocks = stripe_req->stripe_index * r5f_info->stripe_blocks;
+	struct raid_bdev_io *raid_io;
 	struct chunk *chunk;
-	int raid_io_iov_idx = 0;
-	size_t raid_io_offset = 0;
-	size_t raid_io_iov_offset = 0;
-	int i;
+	int ret;
 
 	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
-		int chunk_iovcnt = 0;
-		uint64_t len = raid_bdev->strip_size << raid_bdev->blocklen_shift;
-		size_t off = raid_io_iov_offset;
-		int ret;
+		chunk->iovcnt = 0;
+	}
 
-		for (i = raid_io_iov_idx; i < raid_io->iovcnt; i++) {
-			chunk_iovcnt++;
-			off += raid_io->iovs[i].iov_len;
-			if (off >= raid_io_offset + len) {
-				break;
+	TAILQ_FOREACH(raid_io, &stripe_req->write.raid_ios, module_link) {
+		uint64_t offset = raid_io->offset_blocks - stripe_offset_blocks;
+		uint64_t end = offset + raid_io->num_blocks;
+		int raid_io_iov_idx = 0;
+		size_t raid_io_iov_offset = 0;
+
+		while (offset < end) {
+			uint8_t data_chunk_idx = offset >> raid_bdev->strip_size_shift;
+			uint64_t chunk_end = spdk_min(end,
+						      (uint64_t)(data_chunk_idx + 1) << raid_bdev->strip_size_shift);
+			size_t len = (chunk_end - offset) << raid_bdev->blocklen_shift;
+
+			chunk = raid5f_stripe_data_chunk(stripe_req, data_chunk_idx);
+
+			if (raid_io->md_buf) {
+				chunk->md_buf = raid_io->md_buf +
+						(offset + stripe_offset_blocks - raid_io->offset_blocks) * raid_io_md_size;
 			}
-		}
 
-		assert(raid_io_iov_idx + chunk_iovcnt <= raid_io->iovcnt);
+			while (len > 0) {
+				const struct iovec *raid_io_iov;
+				struct iovec *chunk_iov;
+				size_t n;
 
-		ret = raid5f_chunk_set_iovcnt(chunk, chunk_iovcnt);
-		if (ret) {
-			return ret;
-		}
+				if (spdk_unlikely(raid_io_iov_idx >= raid_io->iovcnt)) {
+					return -EINVAL;
+				}
 
-		if (raid_io_md) {
-			chunk->md_buf = raid_io_md +
-					(raid_io_offset >> raid_bdev->blocklen_shift) * raid_io_md_size;
-		}
+				raid_io_iov = &raid_io->iovs[raid_io_iov_idx];
+				n = spdk_min(len, raid_io_iov->iov_len - raid_io_iov_offset);
 
-		for (i = 0; i < chunk_iovcnt; i++) {
-			struct iovec *chunk_iov = &chunk->iovs[i];
-			const struct iovec *raid_io_iov = &raid_io->iovs[raid_io_iov_idx];
-			size_t chunk_iov_offset = raid_io_offset - raid_io_iov_offset;
+				if (n > 0) {
+					ret = raid5f_chunk_set_iovcnt(chunk, chunk->iovcnt + 1);
+					if (ret) {
+						return ret;
+					}
 
-			chunk_iov->iov_base = raid_io_iov->iov_base + chunk_iov_offset;
-			chunk_iov->iov_len = spdk_min(len, raid_io_iov->iov_len - chunk_iov_offset);
-			raid_io_offset += chunk_iov->iov_len;
-			len -= chunk_iov->iov_len;
+					chunk_iov = &chunk->iovs[chunk->iovcnt - 1];
+					chunk_iov->iov_base = raid_io_iov->iov_base + raid_io_iov_offset;
+					chunk_iov->iov_len = n;
+					raid_io_iov_offset += n;
+					len -= n;
+				}
 
-			if (raid_io_offset >= raid_io_iov_offset + raid_io_iov->iov_len) {
-				raid_io_iov_idx++;
-				raid_io_iov_offset += raid_io_iov->iov_len;
+				if (raid_io_iov_offset == raid_io_iov->iov_len) {
+					raid_io_iov_idx++;
+					raid_io_iov_offset = 0;
+				}
 			}
-		}
 
-		if (spdk_unlikely(len > 0)) {
-			return -EINVAL;
+			offset = chunk_end;
 		}
 	}
 
-	stripe_req->parity_chunk->iovs[0].iov_base = stripe_req->write.parity_buf;
-	stripe_req->parity_chunk->iovs[0].iov_len = raid_bdev->strip_size << raid_bdev->blocklen_shift;
-	stripe_req->parity_chunk->iovcnt = 1;
-	stripe_req->parity_chunk->md_buf = stripe_req->write.parity_md_buf;
-
 	return 0;
 }
 
@@ -604,50 +775,541 @@ raid5f_stripe_request_init(struct stripe_request *stripe_req, struct raid_bdev_i
 	stripe_req->stripe_index = stripe_index;
 	stripe_req->parity_chunk = &stripe_req->chunks[raid5f_stripe_parity_chunk_index(raid_io->raid_bdev,
 				   stripe_index)];
+	TAILQ_INIT(&stripe_req->lock_waiters);
+
+	if (stripe_req->type == STRIPE_REQ_WRITE) {
+		struct chunk *chunk;
+
+		TAILQ_INIT(&stripe_req->write.raid_ios);
+		stripe_req->write.blocks = 0;
+
+		FOR_EACH_CHUNK(stripe_req, chunk) {
+			chunk->write_offset = 0;
+			chunk->write_blocks = 0;
+		}
+	}
+}
+
+static bool
+raid5f_stripe_write_request_can_add(struct stripe_request *stripe_req,
+				    struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	uint64_t offset = raid_io->offset_blocks - stripe_req->stripe_index * r5f_info->stripe_blocks;
+	uint64_t end = offset + raid_io->num_blocks;
+	struct chunk *chunk;
+
+	/* The written range of each chunk must stay contiguous and must not overlap */
+	while (offset < end) {
+		uint8_t data_chunk_idx = offset >> raid_bdev->strip_size_shift;
+		uint64_t chunk_offset = offset - ((uint64_t)data_chunk_idx << raid_bdev->strip_size_shift);
+		uint64_t blocks = spdk_min(end - offset, raid_bdev->strip_size - chunk_offset);
+
+		chunk = raid5f_stripe_data_chunk(stripe_req, data_chunk_idx);
+		if (chunk->write_blocks != 0 &&
+		    chunk_offset + blocks != chunk->write_offset &&
+		    chunk_offset != chunk->write_offset + chunk->write_blocks) {
+			return false;
+		}
+
+		offset += blocks;
+	}
+
+	return true;
 }
 
 static void
-raid5f_stripe_write_request_xor_done(struct stripe_request *stripe_req, int status)
+raid5f_stripe_write_request_add(struct stripe_request *stripe_req, struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	uint64_t offset = raid_io->offset_blocks - stripe_req->stripe_index * r5f_info->stripe_blocks;
+	uint64_t end = offset + raid_io->num_blocks;
+	struct raid_bdev_io *pos;
+	struct chunk *chunk;
+
+	while (offset < end) {
+		uint8_t data_chunk_idx = offset >> raid_bdev->strip_size_shift;
+		uint64_t chunk_offset = offset - ((uint64_t)data_chunk_idx << raid_bdev->strip_size_shift);
+		uint64_t blocks = spdk_min(end - offset, raid_bdev->strip_size - chunk_offset);
+
+		chunk = raid5f_stripe_data_chunk(stripe_req, data_chunk_idx);
+		if (chunk->write_blocks == 0 || chunk_offset < chunk->write_offset) {
+			chunk->write_offset = chunk_offset;
+		}
+		chunk->write_blocks += blocks;
+
+		offset += blocks;
+	}
+
+	stripe_req->write.blocks += raid_io->num_blocks;
+
+	TAILQ_FOREACH(pos, &stripe_req->write.raid_ios, module_link) {
+		if (pos->offset_blocks > raid_io->offset_blocks) {
+			break;
+		}
+	}
+
+	if (pos != NULL) {
+		TAILQ_INSERT_BEFORE(pos, raid_io, module_link);
+	} else {
+		TAILQ_INSERT_TAIL(&stripe_req->write.raid_ios, raid_io, module_link);
+	}
+}
+
+static bool
+raid5f_stripe_lock(struct stripe_request *stripe_req)
+{
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+	uint64_t bucket = stripe_req->stripe_index % RAID5F_LOCKED_STRIPES_BUCKETS;
+	struct stripe_request *holder;
+
+	spdk_spin_lock(&r5f_info->locked_stripes_lock);
+
+	TAILQ_FOREACH(holder, &r5f_info->locked_stripes[bucket], lock_link) {
+		if (holder->stripe_index == stripe_req->stripe_index) {
+			break;
+		}
+	}
+
+	if (holder != NULL) {
+		TAILQ_INSERT_TAIL(&holder->lock_waiters, stripe_req, lock_link);
+	} else {
+		TAILQ_INSERT_TAIL(&r5f_info->locked_stripes[bucket], stripe_req, lock_link);
+	}
+
+	spdk_spin_unlock(&r5f_info->locked_stripes_lock);
+
+	return holder == NULL;
+}
+
+static void raid5f_stripe_request_locked(void *_stripe_req);
+
+static void
+raid5f_stripe_unlock(struct stripe_request *stripe_req)
+{
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+	uint64_t bucket = stripe_req->stripe_index % RAID5F_LOCKED_STRIPES_BUCKETS;
+	struct stripe_request *next;
+	int ret;
+
+	spdk_spin_lock(&r5f_info->locked_stripes_lock);
+
+	TAILQ_REMOVE(&r5f_info->locked_stripes[bucket], stripe_req, lock_link);
+
+	/* Pass the lock to the first waiter, along with the remaining waiters */
+	next = TAILQ_FIRST(&stripe_req->lock_waiters);
+	if (next != NULL) {
+		TAILQ_REMOVE(&stripe_req->lock_waiters, next, lock_link);
+		TAILQ_CONCAT(&next->lock_waiters, &stripe_req->lock_waiters, lock_link);
+		TAILQ_INSERT_TAIL(&r5f_info->locked_stripes[bucket], next, lock_link);
+	}
+
+	spdk_spin_unlock(&r5f_info->locked_stripes_lock);
+
+	if (next != NULL) {
+		ret = spdk_thread_send_msg(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(next->r5ch)),
+					   raid5f_stripe_request_locked, next);
+		if (spdk_unlikely(ret)) {
+			SPDK_ERRLOG("Failed to pass stripe lock: %s\n", spdk_strerror(-ret));
+			assert(false);
+		}
+	}
+}
+
+static void
+raid5f_stripe_write_request_complete(struct stripe_request *stripe_req,
+				     enum spdk_bdev_io_status status)
+{
+	TAILQ_HEAD(, raid_bdev_io) raid_ios = TAILQ_HEAD_INITIALIZER(raid_ios);
+	struct raid_bdev_io *raid_io;
+
+	stripe_req->raid_io->completion_cb = NULL;
+	TAILQ_CONCAT(&raid_ios, &stripe_req->write.raid_ios, module_link);
+
+	raid5f_stripe_unlock(stripe_req);
+	raid5f_stripe_request_release(stripe_req);
+
+	while ((raid_io = TAILQ_FIRST(&raid_ios))) {
+		TAILQ_REMOVE(&raid_ios, raid_io, module_link);
+		raid_bdev_io_complete(raid_io, status);
+	}
+}
+
+static void
+raid5f_stripe_write_request_writes_completed_cb(struct raid_bdev_io *raid_io,
+		enum spdk_bdev_io_status status)
+{
+	raid5f_stripe_write_request_complete(raid_io->module_private, status);
+}
+
+static void
+raid5f_stripe_write_request_submit_writes(struct stripe_request *stripe_req)
 {
 	struct raid_bdev_io *raid_io = stripe_req->raid_io;
 
+	stripe_req->write.reading = false;
+
+	raid_io->base_bdev_io_remaining = raid_io->raid_bdev->num_base_bdevs;
+	raid_io->base_bdev_io_submitted = 0;
+	raid_io->completion_cb = raid5f_stripe_write_request_writes_completed_cb;
+
+	raid5f_stripe_request_submit_chunks(stripe_req);
+}
+
+static void
+raid5f_stripe_write_request_xor_done(struct stripe_request *stripe_req, int status)
+{
 	if (status != 0) {
-		raid5f_stripe_request_release(stripe_req);
-		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		raid5f_stripe_write_request_complete(stripe_req, SPDK_BDEV_IO_STATUS_FAILED);
+	} else {
+		raid5f_stripe_write_request_submit_writes(stripe_req);
+	}
+}
+
+static void
+raid5f_stripe_write_request_reconstruct_done(struct stripe_request *stripe_req, int status)
+{
+	if (status != 0) {
+		raid5f_stripe_write_request_complete(stripe_req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* The missing chunk's old data is known now, the rest is a regular reconstruct-write */
+	stripe_req->write.reconstruct_chunk = NULL;
+	raid5f_xor_stripe(stripe_req, raid5f_stripe_write_request_xor_done);
+}
+
+static void
+raid5f_stripe_write_request_reads_completed_cb(struct raid_bdev_io *raid_io,
+		enum spdk_bdev_io_status status)
+{
+	struct stripe_request *stripe_req = raid_io->module_private;
+
+	if (status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		raid5f_stripe_write_request_complete(stripe_req, status);
+		return;
+	}
+
+	if (stripe_req->write.reconstruct_chunk != NULL) {
+		raid5f_xor_stripe(stripe_req, raid5f_stripe_write_request_reconstruct_done);
+	} else {
+		raid5f_xor_stripe(stripe_req, raid5f_stripe_write_request_xor_done);
+	}
+}
+
+static int
+raid5f_chunk_set_xor_iovs(struct chunk *chunk, uint64_t range_offset, uint64_t range_blocks,
+			  uint32_t blocklen_shift)
+{
+	uint64_t head = chunk->write_offset - range_offset;
+	uint64_t tail = range_offset + range_blocks - chunk->write_offset - chunk->write_blocks;
+	int i = 0;
+	int ret;
+
+	ret = raid5f_iovs_resize(&chunk->xor_iovs, &chunk->xor_iovcnt_max, chunk->iovcnt + 2);
+	if (ret) {
+		return ret;
+	}
+
+	/* The parts of the range not written in this chunk keep their old data */
+	if (head > 0) {
+		chunk->xor_iovs[i].iov_base = chunk->old_iov.iov_base;
+		chunk->xor_iovs[i].iov_len = head << blocklen_shift;
+		i++;
+	}
+
+	memcpy(&chunk->xor_iovs[i], chunk->iovs, chunk->iovcnt * sizeof(*chunk->iovs));
+	i += chunk->iovcnt;
+
+	if (tail > 0) {
+		chunk->xor_iovs[i].iov_base = chunk->old_iov.iov_base +
+					      ((range_blocks - tail) << blocklen_shift);
+		chunk->xor_iovs[i].iov_len = tail << blocklen_shift;
+		i++;
+	}
+
+	chunk->xor_iovcnt = i;
+
+	return 0;
+}
+
+static int
+raid5f_stripe_write_request_prepare(struct stripe_request *stripe_req)
+{
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+	struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+	struct raid_bdev_io_channel *raid_ch = stripe_req->raid_io->raid_ch;
+	struct chunk *parity_chunk = stripe_req->parity_chunk;
+	struct chunk *missing_chunk = NULL;
+	struct chunk *chunk;
+	uint64_t range_offset = UINT64_MAX;
+	uint64_t range_end = 0;
+	uint64_t range_blocks;
+	uint8_t data_chunks = raid5f_stripe_data_chunks_num(raid_bdev);
+	uint8_t written = 0;
+	uint8_t written_partially = 0;
+	int ret;
+
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		if (raid_bdev_channel_get_base_channel(raid_ch, chunk->index) == NULL) {
+			missing_chunk = chunk;
+		}
+		if (chunk != parity_chunk && chunk->write_blocks != 0) {
+			range_offset = spdk_min(range_offset, chunk->write_offset);
+			range_end = spdk_max(range_end, chunk->write_offset + chunk->write_blocks);
+			written++;
+		}
+	}
+
+	assert(written > 0);
+	range_blocks = range_end - range_offset;
+
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		if (chunk->write_blocks != 0 && chunk->write_blocks != range_blocks) {
+			written_partially++;
+		}
+	}
+
+	if (missing_chunk == parity_chunk) {
+		stripe_req->write.mode = STRIPE_WRITE_NO_PARITY;
+	} else if (stripe_req->write.blocks == r5f_info->stripe_blocks) {
+		stripe_req->write.mode = STRIPE_WRITE_FULL;
+	} else if (missing_chunk != NULL) {
+		/*
+		 * The old data of a missing chunk can't be read. If the write needs it, because
+		 * the chunk is only partially written, it's reconstructed from the rest of the stripe.
+		 */
+		if (missing_chunk->write_blocks == 0) {
+			stripe_req->write.mode = STRIPE_WRITE_RMW;
+		} else if (missing_chunk->write_blocks == range_blocks) {
+			stripe_req->write.mode = STRIPE_WRITE_RCW;
+		} else {
+			stripe_req->write.mode = STRIPE_WRITE_RCW_RECONSTRUCT;
+		}
+	} else if (1 + written < data_chunks - written + written_partially) {
+		/* Read-modify-write reads less chunks */
+		stripe_req->write.mode = STRIPE_WRITE_RMW;
+	} else {
+		stripe_req->write.mode = STRIPE_WRITE_RCW;
+	}
+
+	stripe_req->write.range_offset = range_offset;
+	stripe_req->write.range_blocks = range_blocks;
+	stripe_req->write.reading = false;
+	stripe_req->write.reconstruct_chunk = NULL;
+	if (stripe_req->write.mode == STRIPE_WRITE_RCW_RECONSTRUCT) {
+		stripe_req->write.reconstruct_chunk = missing_chunk;
+	}
+
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		switch (stripe_req->write.mode) {
+		case STRIPE_WRITE_RMW:
+			chunk->read_old = chunk == parity_chunk || chunk->write_blocks != 0;
+			break;
+		case STRIPE_WRITE_RCW:
+			chunk->read_old = chunk != parity_chunk && chunk->write_blocks != range_blocks;
+			break;
+		case STRIPE_WRITE_RCW_RECONSTRUCT:
+			chunk->read_old = chunk != missing_chunk;
+			break;
+		default:
+			chunk->read_old = false;
+			break;
+		}
+
+		/* The old data of a missing chunk is reconstructed into its buffer */
+		if (chunk->read_old || chunk == stripe_req->write.reconstruct_chunk) {
+			chunk->old_iov.iov_base = stripe_req->write.chunk_buffers[chunk->index];
+			chunk->old_iov.iov_len = range_blocks << raid_bdev->blocklen_shift;
+			stripe_req->write.reading |= chunk->read_old;
+		}
+
+		if ((stripe_req->write.mode == STRIPE_WRITE_RMW ||
+		     stripe_req->write.mode == STRIPE_WRITE_RCW ||
+		     stripe_req->write.mode == STRIPE_WRITE_RCW_RECONSTRUCT) &&
+		    chunk != parity_chunk && chunk->write_blocks != 0) {
+			ret = raid5f_chunk_set_xor_iovs(chunk, range_offset, range_blocks,
+							raid_bdev->blocklen_shift);
+			if (ret) {
+				return ret;
+			}
+		}
+	}
+
+	if (stripe_req->write.mode != STRIPE_WRITE_NO_PARITY) {
+		parity_chunk->iovs[0].iov_base = stripe_req->write.parity_buf;
+		parity_chunk->iovs[0].iov_len = range_blocks << raid_bdev->blocklen_shift;
+		parity_chunk->iovcnt = 1;
+		parity_chunk->md_buf = stripe_req->write.parity_md_buf;
+		parity_chunk->write_offset = range_offset;
+		parity_chunk->write_blocks = range_blocks;
+	} else {
+		parity_chunk->write_blocks = 0;
+	}
+
+	return 0;
+}
+
+static void
+raid5f_stripe_write_request_locked(void *_stripe_req)
+{
+	struct stripe_request *stripe_req = _stripe_req;
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+	int ret;
+
+	ret = raid5f_stripe_request_map_iovecs(stripe_req);
+	if (spdk_likely(ret == 0)) {
+		ret = raid5f_stripe_write_request_prepare(stripe_req);
+	}
+
+	if (spdk_unlikely(ret)) {
+		raid5f_stripe_write_request_complete(stripe_req, ret == -ENOMEM ?
+						     SPDK_BDEV_IO_STATUS_NOMEM : SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (stripe_req->write.reading) {
+		raid_io->base_bdev_io_remaining = raid_io->raid_bdev->num_base_bdevs;
+		raid_io->base_bdev_io_submitted = 0;
+		raid_io->completion_cb = raid5f_stripe_write_request_reads_completed_cb;
+
+		raid5f_stripe_request_submit_chunks(stripe_req);
+	} else if (stripe_req->write.mode != STRIPE_WRITE_NO_PARITY) {
+		raid5f_xor_stripe(stripe_req, raid5f_stripe_write_request_xor_done);
+	} else {
+		raid5f_stripe_write_request_submit_writes(stripe_req);
+	}
+}
+
+static void
+raid5f_stripe_request_locked(void *_stripe_req)
+{
+	struct stripe_request *stripe_req = _stripe_req;
+
+	if (stripe_req->type == STRIPE_REQ_WRITE) {
+		raid5f_stripe_write_request_locked(stripe_req);
 	} else {
 		raid5f_stripe_request_submit_chunks(stripe_req);
 	}
 }
 
+static void
+raid5f_stripe_write_request_submit(struct stripe_request *stripe_req)
+{
+	/* Otherwise the request continues when the current holder unlocks the stripe */
+	if (raid5f_stripe_lock(stripe_req)) {
+		raid5f_stripe_write_request_locked(stripe_req);
+	}
+}
+
+static void
+raid5f_write_cache_flush(void *_r5ch)
+{
+	struct raid5f_io_channel *r5ch = _r5ch;
+	struct stripe_request *stripe_req;
+
+	r5ch->write_cache_flush_scheduled = false;
+
+	while ((stripe_req = TAILQ_FIRST(&r5ch->write_cache))) {
+		TAILQ_REMOVE(&r5ch->write_cache, stripe_req, link);
+		raid5f_stripe_write_request_submit(stripe_req);
+	}
+}
+
+static void
+raid5f_write_cache_schedule_flush(struct raid5f_io_channel *r5ch)
+{
+	if (r5ch->write_cache_flush_scheduled) {
+		return;
+	}
+
+	/*
+	 * Partial stripe writes are held until the writes submitted from the current poller
+	 * iteration, e.g. the children of a split I/O, have been added to them.
+	 */
+	if (spdk_thread_send_msg(spdk_get_thread(), raid5f_write_cache_flush, r5ch) == 0) {
+		r5ch->write_cache_flush_scheduled = true;
+	} else {
+		raid5f_write_cache_flush(r5ch);
+	}
+}
+
+static bool
+raid5f_io_channel_degraded(struct raid_bdev_io_channel *raid_ch, struct raid_bdev *raid_bdev)
+{
+	uint8_t i;
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (raid_bdev_channel_get_base_channel(raid_ch, i) == NULL) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static int
 raid5f_submit_write_request(struct raid_bdev_io *raid_io, uint64_t stripe_index)
 {
 	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
 	struct raid5f_io_channel *r5ch = raid_bdev_channel_get_module_ctx(raid_io->raid_ch);
-	struct stripe_request *stripe_req;
-	int ret;
+	struct stripe_request *stripe_req = NULL;
+	bool cacheable;
 
-	stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.write);
-	if (!stripe_req) {
-		return -ENOMEM;
+	if (spdk_unlikely(raid_io->md_buf != NULL && raid_io->num_blocks != r5f_info->stripe_blocks)) {
+		/* Parity of separate metadata is only calculated for full stripes */
+		return -EINVAL;
 	}
 
-	raid5f_stripe_request_init(stripe_req, raid_io, stripe_index);
+	/*
+	 * Writes with a memory domain or to a degraded array are not merged with other writes
+	 * of the same stripe.
+	 */
+	cacheable = raid_io->memory_domain == NULL &&
+		    !raid5f_io_channel_degraded(raid_io->raid_ch, raid_bdev);
 
-	ret = raid5f_stripe_request_map_iovecs(stripe_req);
-	if (spdk_unlikely(ret)) {
-		return ret;
+	if (cacheable) {
+		TAILQ_FOREACH(stripe_req, &r5ch->write_cache, link) {
+			if (stripe_req->stripe_index == stripe_index) {
+				break;
+			}
+		}
+
+		if (stripe_req != NULL && !raid5f_stripe_write_request_can_add(stripe_req, raid_io)) {
+			TAILQ_REMOVE(&r5ch->write_cache, stripe_req, link);
+			raid5f_stripe_write_request_submit(stripe_req);
+			stripe_req = NULL;
+		}
 	}
 
-	TAILQ_REMOVE(&r5ch->free_stripe_requests.write, stripe_req, link);
+	if (stripe_req == NULL) {
+		stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.write);
+		if (!stripe_req) {
+			return -ENOMEM;
+		}
 
-	raid_io->module_private = stripe_req;
-	raid_io->base_bdev_io_remaining = raid_bdev->num_base_bdevs;
+		TAILQ_REMOVE(&r5ch->free_stripe_requests.write, stripe_req, link);
 
-	if (raid_bdev_channel_get_base_channel(raid_io->raid_ch, stripe_req->parity_chunk->index) != NULL) {
-		raid5f_xor_stripe(stripe_req, raid5f_stripe_write_request_xor_done);
+		raid5f_stripe_request_init(stripe_req, raid_io, stripe_index);
+		raid_io->module_private = stripe_req;
+
+		if (cacheable) {
+			TAILQ_INSERT_TAIL(&r5ch->write_cache, stripe_req, link);
+		}
+	}
+
+	raid5f_stripe_write_request_add(stripe_req, raid_io);
+
+	if (!cacheable || stripe_req->write.blocks == r5f_info->stripe_blocks) {
+		if (cacheable) {
+			TAILQ_REMOVE(&r5ch->write_cache, stripe_req, link);
+		}
+		raid5f_stripe_write_request_submit(stripe_req);
 	} else {
-		raid5f_stripe_write_request_xor_done(stripe_req, 0);
+		raid5f_write_cache_schedule_flush(r5ch);
 	}
 
 	return 0;
@@ -679,6 +1341,7 @@ raid5f_stripe_request_reconstruct_xor_done(struct stripe_request *stripe_req, in
 {
 	struct raid_bdev_io *raid_io = stripe_req->raid_io;
 
+	raid5f_stripe_unlock(stripe_req);
 	raid5f_stripe_request_release(stripe_req);
 
 	raid_bdev_io_complete(raid_io,
@@ -690,9 +1353,10 @@ raid5f_reconstruct_reads_completed_cb(struct raid_bdev_io *raid_io, enum spdk_bd
 {
 	struct stripe_request *stripe_req = raid_io->module_private;
 
-	raid_io->completion_cb = NULL;
+	raid_io->completion_cb = stripe_req->reconstruct.completion_cb;
 
 	if (status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		raid5f_stripe_unlock(stripe_req);
 		raid5f_stripe_request_release(stripe_req);
 		raid_bdev_io_complete(raid_io, status);
 		return;
@@ -755,11 +1419,15 @@ raid5f_submit_reconstruct_read(struct raid_bdev_io *raid_io, uint64_t stripe_ind
 
 	raid_io->module_private = stripe_req;
 	raid_io->base_bdev_io_remaining = raid_bdev->num_base_bdevs;
+	stripe_req->reconstruct.completion_cb = raid_io->completion_cb;
 	raid_io->completion_cb = raid5f_reconstruct_reads_completed_cb;
 
 	TAILQ_REMOVE(&r5ch->free_stripe_requests.reconstruct, stripe_req, link);
 
-	raid5f_stripe_request_submit_chunks(stripe_req);
+	/* Otherwise the reads are submitted when the current holder unlocks the stripe */
+	if (raid5f_stripe_lock(stripe_req)) {
+		raid5f_stripe_request_submit_chunks(stripe_req);
+	}
 
 	return 0;
 }
@@ -811,8 +1479,7 @@ raid5f_submit_rw_request(struct raid_bdev_io *raid_io)
 		ret = raid5f_submit_read_request(raid_io, stripe_index, stripe_offset);
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
-		assert(stripe_offset == 0);
-		assert(raid_io->num_blocks == r5f_info->stripe_blocks);
+		assert(stripe_offset + raid_io->num_blocks <= r5f_info->stripe_blocks);
 		ret = raid5f_submit_write_request(raid_io, stripe_index);
 		break;
 	default:
@@ -826,6 +1493,131 @@ raid5f_submit_rw_request(struct raid_bdev_io *raid_io)
 	}
 }
 
+static void
+raid5f_process_write_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_process_request *process_req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	raid_bdev_process_request_complete(process_req, success ? 0 : -EIO);
+}
+
+static void raid5f_process_submit_write(struct raid_bdev_process_request *process_req);
+
+static void
+_raid5f_process_submit_write(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid5f_process_submit_write(SPDK_CONTAINEROF(raid_io, struct raid_bdev_process_request,
+				    raid_io));
+}
+
+static void
+raid5f_process_submit_write(struct raid_bdev_process_request *process_req)
+{
+	struct raid_bdev_io *raid_io = &process_req->raid_io;
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	uint64_t stripe_index = process_req->offset_blocks / r5f_info->stripe_blocks;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_io_channel *base_ch;
+	struct spdk_bdev_ext_io_opts io_opts;
+	int ret;
+
+	if (process_req->target != NULL) {
+		base_info = process_req->target;
+		base_ch = process_req->target_ch;
+	} else {
+		uint8_t p_idx = raid5f_stripe_parity_chunk_index(raid_bdev, stripe_index);
+
+		base_info = &raid_bdev->base_bdev_info[p_idx];
+		base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch, p_idx);
+		if (base_ch == NULL) {
+			raid_bdev_process_request_complete(process_req, -ENODEV);
+			return;
+		}
+	}
+
+	raid5f_init_ext_io_opts(&io_opts, NULL);
+	io_opts.metadata = process_req->md_buf;
+
+	ret = raid_bdev_writev_blocks_ext(base_info, base_ch, &process_req->iov, 1,
+					  stripe_index << raid_bdev->strip_size_shift, raid_bdev->strip_size,
+					  raid5f_process_write_complete, process_req, &io_opts);
+	if (spdk_unlikely(ret == -ENOMEM)) {
+		raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
+					base_ch, _raid5f_process_submit_write);
+	} else if (spdk_unlikely(ret != 0)) {
+		raid_bdev_process_request_complete(process_req, ret);
+	}
+}
+
+static void
+raid5f_process_reconstruct_done(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_process_request *process_req = SPDK_CONTAINEROF(raid_io,
+			struct raid_bdev_process_request, raid_io);
+
+	if (status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		raid_bdev_process_request_complete(process_req, -EIO);
+		return;
+	}
+
+	raid5f_process_submit_write(process_req);
+}
+
+/*
+ * A process request handles a single stripe. The strip of the rebuild target, or the parity
+ * strip for a resync, is reconstructed from the other strips and then written.
+ */
+static int
+raid5f_submit_process_request(struct raid_bdev_process_request *process_req,
+			      struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_bdev_io *raid_io = &process_req->raid_io;
+	struct raid_bdev *raid_bdev;
+	struct raid5f_info *r5f_info;
+	uint64_t stripe_index;
+	uint8_t chunk_idx, i;
+	int ret;
+
+	raid_bdev_io_init(raid_io, raid_ch, SPDK_BDEV_IO_TYPE_READ, process_req->offset_blocks, 0,
+			  &process_req->iov, 1, process_req->md_buf, NULL, NULL);
+	raid_bdev = raid_io->raid_bdev;
+	r5f_info = raid_bdev->module_private;
+	stripe_index = process_req->offset_blocks / r5f_info->stripe_blocks;
+
+	assert(process_req->offset_blocks % r5f_info->stripe_blocks == 0);
+	assert(process_req->num_blocks >= r5f_info->stripe_blocks);
+
+	if (process_req->target != NULL) {
+		chunk_idx = raid_bdev_base_bdev_slot(process_req->target);
+	} else {
+		chunk_idx = raid5f_stripe_parity_chunk_index(raid_bdev, stripe_index);
+	}
+
+	/* All the other strips are needed for the reconstruction */
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (i != chunk_idx && raid_bdev_channel_get_base_channel(raid_ch, i) == NULL) {
+			return -ENODEV;
+		}
+	}
+
+	/* Only the reconstructed strip is read into the buffer */
+	raid_io->num_blocks = raid_bdev->strip_size;
+	process_req->iov.iov_len = raid_bdev->strip_size << raid_bdev->blocklen_shift;
+	raid_io->completion_cb = raid5f_process_reconstruct_done;
+
+	ret = raid5f_submit_reconstruct_read(raid_io, stripe_index, chunk_idx, 0);
+	if (spdk_unlikely(ret != 0)) {
+		return ret;
+	}
+
+	return r5f_info->stripe_blocks;
+}
+
 static void
 raid5f_stripe_request_free(struct stripe_request *stripe_req)
 {
@@ -833,11 +1625,23 @@ raid5f_stripe_request_free(struct stripe_request *stripe_req)
 
 	FOR_EACH_CHUNK(stripe_req, chunk) {
 		free(chunk->iovs);
+		free(chunk->xor_iovs);
 	}
 
 	if (stripe_req->type == STRIPE_REQ_WRITE) {
+		struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+		struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+		uint8_t i;
+
 		spdk_dma_free(stripe_req->write.parity_buf);
 		spdk_dma_free(stripe_req->write.parity_md_buf);
+
+		if (stripe_req->write.chunk_buffers) {
+			for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+				spdk_dma_free(stripe_req->write.chunk_buffers[i]);
+			}
+			free(stripe_req->write.chunk_buffers);
+		}
 	} else if (stripe_req->type == STRIPE_REQ_RECONSTRUCT) {
 		struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
 		struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
@@ -897,11 +1701,27 @@ raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch, enum stripe_request_
 	chunk_len = raid_bdev->strip_size << raid_bdev->blocklen_shift;
 
 	if (type == STRIPE_REQ_WRITE) {
+		void *buf;
+		uint8_t i;
+
 		stripe_req->write.parity_buf = spdk_dma_malloc(chunk_len, r5f_info->buf_alignment, NULL);
 		if (!stripe_req->write.parity_buf) {
 			goto err;
 		}
 
+		stripe_req->write.chunk_buffers = calloc(raid_bdev->num_base_bdevs, sizeof(void *));
+		if (!stripe_req->write.chunk_buffers) {
+			goto err;
+		}
+
+		for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+			buf = spdk_dma_malloc(chunk_len, r5f_info->buf_alignment, NULL);
+			if (!buf) {
+				goto err;
+			}
+			stripe_req->write.chunk_buffers[i] = buf;
+		}
+
 		if (raid_io_md_size != 0) {
 			stripe_req->write.parity_md_buf = spdk_dma_malloc(raid_bdev->strip_size * raid_io_md_size,
 							  r5f_info->buf_alignment, NULL);
@@ -946,12 +1766,13 @@ raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch, enum stripe_request_
 		return NULL;
 	}
 
-	stripe_req->chunk_iov_iters = malloc(SPDK_IOVITER_SIZE(raid_bdev->num_base_bdevs));
+	/* A read-modify-write uses the old and new data of each chunk and the old parity */
+	stripe_req->chunk_iov_iters = malloc(SPDK_IOVITER_SIZE(raid5f_xor_iovs_max(raid_bdev)));
 	if (!stripe_req->chunk_iov_iters) {
 		goto err;
 	}
 
-	stripe_req->chunk_xor_buffers = calloc(raid5f_stripe_data_chunks_num(raid_bdev),
+	stripe_req->chunk_xor_buffers = calloc(raid5f_xor_iovs_max(raid_bdev),
 					       sizeof(stripe_req->chunk_xor_buffers[0]));
 	if (!stripe_req->chunk_xor_buffers) {
 		goto err;
@@ -976,6 +1797,7 @@ raid5f_ioch_destroy(void *io_device, void *ctx_buf)
 	struct stripe_request *stripe_req;
 
 	assert(TAILQ_EMPTY(&r5ch->xor_retry_queue));
+	assert(TAILQ_EMPTY(&r5ch->write_cache));
 
 	while ((stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.write))) {
 		TAILQ_REMOVE(&r5ch->free_stripe_requests.write, stripe_req, link);
@@ -1008,6 +1830,7 @@ raid5f_ioch_create(void *io_device, void *ctx_buf)
 	TAILQ_INIT(&r5ch->free_stripe_requests.write);
 	TAILQ_INIT(&r5ch->free_stripe_requests.reconstruct);
 	TAILQ_INIT(&r5ch->xor_retry_queue);
+	TAILQ_INIT(&r5ch->write_cache);
 
 	for (i = 0; i < RAID5F_MAX_STRIPES; i++) {
 		stripe_req = raid5f_stripe_request_alloc(r5ch, STRIPE_REQ_WRITE);
@@ -1033,17 +1856,17 @@ raid5f_ioch_create(void *io_device, void *ctx_buf)
 		goto err;
 	}
 
-	r5ch->chunk_xor_buffers = calloc(raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_buffers));
+	r5ch->chunk_xor_buffers = calloc(raid5f_xor_iovs_max(raid_bdev), sizeof(*r5ch->chunk_xor_buffers));
 	if (!r5ch->chunk_xor_buffers) {
 		goto err;
 	}
 
-	r5ch->chunk_xor_iovs = calloc(raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_iovs));
+	r5ch->chunk_xor_iovs = calloc(raid5f_xor_iovs_max(raid_bdev), sizeof(*r5ch->chunk_xor_iovs));
 	if (!r5ch->chunk_xor_iovs) {
 		goto err;
 	}
 
-	r5ch->chunk_xor_iovcnt = calloc(raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_iovcnt));
+	r5ch->chunk_xor_iovcnt = calloc(raid5f_xor_iovs_max(raid_bdev), sizeof(*r5ch->chunk_xor_iovcnt));
 	if (!r5ch->chunk_xor_iovcnt) {
 		goto err;
 	}
@@ -1064,6 +1887,7 @@ raid5f_start(struct raid_bdev *raid_bdev)
 	struct spdk_bdev *base_bdev;
 	struct raid5f_info *r5f_info;
 	size_t alignment = 0;
+	int i;
 
 	r5f_info = calloc(1, sizeof(*r5f_info));
 	if (!r5f_info) {
@@ -1072,6 +1896,11 @@ raid5f_start(struct raid_bdev *raid_bdev)
 	}
 	r5f_info->raid_bdev = raid_bdev;
 
+	for (i = 0; i < RAID5F_LOCKED_STRIPES_BUCKETS; i++) {
+		TAILQ_INIT(&r5f_info->locked_stripes[i]);
+	}
+	spdk_spin_init(&r5f_info->locked_stripes_lock);
+
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		min_blockcnt = spdk_min(min_blockcnt, base_info->data_size);
 		if (base_info->desc) {
@@ -1093,8 +1922,14 @@ raid5f_start(struct raid_bdev *raid_bdev)
 	raid_bdev->bdev.blockcnt = r5f_info->stripe_blocks * r5f_info->total_stripes;
 	raid_bdev->bdev.optimal_io_boundary = raid_bdev->strip_size;
 	raid_bdev->bdev.split_on_optimal_io_boundary = true;
-	raid_bdev->bdev.write_unit_size = r5f_info->stripe_blocks;
-	raid_bdev->bdev.split_on_write_unit = true;
+	/* Partial stripe writes update the parity of the whole stripe */
+	raid_bdev->write_unit_blocks = r5f_info->stripe_blocks;
+
+	if (raid_bdev->bdev.md_len != 0 && !raid_bdev->bdev.md_interleave) {
+		/* Parity of separate metadata is only calculated for full stripes */
+		raid_bdev->bdev.write_unit_size = r5f_info->stripe_blocks;
+		raid_bdev->bdev.split_on_write_unit = true;
+	}
 
 	raid_bdev->module_private = r5f_info;
 
@@ -1111,6 +1946,7 @@ raid5f_io_device_unregister_done(void *io_device)
 
 	raid_bdev_module_stop_done(r5f_info->raid_bdev);
 
+	spdk_spin_destroy(&r5f_info->locked_stripes_lock);
 	free(r5f_info);
 }
 
@@ -1140,6 +1976,7 @@ static struct raid_bdev_module g_raid5f_module = {
 	.stop = raid5f_stop,
 	.submit_rw_request = raid5f_submit_rw_request,
 	.get_io_channel = raid5f_get_io_channel,
+	.submit_process_request = raid5f_submit_process_request,
 };
 RAID_MODULE_REGISTER(&g_raid5f_module)
 
@@ -0,0 +1,2207 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * Tiering virtual bdev. The tier vbdev has the size of its capacity bdev, on which every extent
+ * has its home location. The hottest extents are moved to a fast bdev, which then serves all
+ * their I/Os, and moved back when hotter extents need their place.
+ *
+ * The heat of an extent is a saturating 8 bit counter, incremented by each read or write and
+ * halved once per decay period, a slice of the extents at a time. An extent whose heat reaches
+ * the promotion threshold becomes a candidate, promoted by a background poller into a free slot
+ * of the fast bdev, or into the slot of the coldest of a few promoted extents if it is hotter.
+ * Migrations are paced by a token bucket filled at the migration bandwidth.
+ *
+ * The metadata is owned by a single SPDK thread, which runs the migrations and writes the remap
+ * table. Reads and writes look their extent up and are submitted to the base bdevs on the
+ * thread they were submitted on. Only the other I/O types, the I/Os to an extent being migrated,
+ * the first write to a clean slot and the access making an extent a candidate are forwarded to
+ * the metadata thread, and completed back on the thread they were submitted on.
+ *
+ * The I/Os to an extent being migrated wait for the end of the migration, which itself waits for
+ * the I/Os in progress on the extent. Submitting threads count their I/O in the extent before
+ * checking whether it is migrating, and the metadata thread marks the extent migrating before
+ * checking whether I/Os are in progress, so that either the I/O or the migration waits for the
+ * other. The heat of an extent is updated without locking, an increment may be lost to a
+ * concurrent one.
+ *
+ * Layout of the fast bdev:
+ *   - superblock, in a 4 KiB metadata block,
+ *   - remap table, the extent held by each slot plus one, 0 for free slots, in 4 KiB metadata
+ *     blocks,
+ *   - slots, aligned to the extent size.
+ *
+ * A slot is mapped to its extent only after the extent has been copied to it. The first write
+ * to a promoted extent marks its slot dirty in the remap table, and only the extents with a
+ * dirty slot are copied back to the capacity bdev when they are demoted, before their slot is
+ * freed.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "vbdev_tier.h"
+#include "spdk/crc32.h"
+#include "spdk/env.h"
+#include "spdk/json.h"
+#include "spdk/likely.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+#include "spdk_internal/vbdev_md.h"
+
+/* Namespace of the UUIDs generated from the UUID of the base bdev, fixed once and for all: the
+ * tier vbdevs would get another UUID if it changed.
+ */
+#define BDEV_TIER_NAMESPACE_UUID	"e008c825-a410-47b9-a378-43b663765422"
+
+#define TIER_SB_SIGNATURE		"SPDKTIER"
+#define TIER_SB_VERSION			1
+
+#define TIER_MD_BLOCK_SIZE		0x1000
+#define TIER_SLOTS_PER_MD_BLOCK		(TIER_MD_BLOCK_SIZE / sizeof(uint32_t))
+#define TIER_SLOT_DIRTY			(1u << 31)
+#define TIER_SLOT_NONE			UINT32_MAX
+#define TIER_EXTENTS_MAX		(1u << 30)
+#define TIER_EXTENT_NONE		UINT64_MAX
+
+#define TIER_EXTENT_SIZE_KB_DEFAULT	1024
+#define TIER_EXTENT_SIZE_KB_MAX		16384
+#define TIER_MIGRATION_BW_MBPS_DEFAULT	64
+#define TIER_PROMOTE_THRESHOLD_DEFAULT	8
+#define TIER_DECAY_PERIOD_MS_DEFAULT	1000
+
+#define TIER_HEAT_MAX			UINT8_MAX
+/* A candidate replaces a promoted extent only if it is hotter by more than this */
+#define TIER_DEMOTE_HYSTERESIS		2
+/* Number of slots looked at to find the extent to demote */
+#define TIER_VICTIM_SCAN_MAX		64
+#define TIER_CANDIDATES_MAX		256
+/* Maximum number of migrations in progress */
+#define TIER_MIGRATIONS_MAX		4
+#define TIER_MIGRATE_POLL_PERIOD_US	10000
+#define TIER_STOP_POLL_PERIOD_US	100
+
+#define TIER_EXTENT_MIGRATING		(1u << 0)
+#define TIER_EXTENT_CANDIDATE		(1u << 1)
+/* The dirty bit of the slot of the extent is being written */
+#define TIER_EXTENT_DIRTYING		(1u << 2)
+
+struct tier_sb {
+	uint8_t			signature[8];
+	uint32_t		version;
+	/* CRC32C of the superblock, computed with this field set to 0 */
+	uint32_t		crc;
+	struct spdk_uuid	uuid;
+	/* UUID of the capacity bdev the slots hold the extents of */
+	struct spdk_uuid	capacity_uuid;
+	uint32_t		block_size;
+	uint32_t		extent_size;
+	uint32_t		num_slots;
+	uint32_t		reserved;
+	/* Offset of the remap table in metadata blocks */
+	uint64_t		md_offset;
+	/* Offset of the first slot in blocks */
+	uint64_t		data_offset;
+};
+SPDK_STATIC_ASSERT(sizeof(struct tier_sb) <= TIER_MD_BLOCK_SIZE, "superblock too big");
+
+/* Only written by the metadata thread, except for inflight and heat */
+struct tier_extent {
+	/* Slot of the fast bdev holding the extent, TIER_SLOT_NONE if it is not promoted */
+	uint32_t	slot;
+	/* Number of I/Os in progress on the extent */
+	uint32_t	inflight;
+	uint8_t		heat;
+	uint8_t		flags;
+};
+
+struct tier_bdev_io;
+
+struct tier_migration {
+	struct vbdev_tier			*tier;
+	uint64_t				extent;
+	uint32_t				slot;
+	bool					promote;
+	/* The I/Os in progress on the extent are done, its data is being moved */
+	bool					copying;
+	/* Remap table entry of the slot before the migration */
+	uint32_t				old_entry;
+	void					*buf;
+	void (*retry_fn)(struct tier_migration *mig);
+	struct spdk_bdev_io_wait_entry		bdev_io_wait;
+	struct vbdev_md_waiter			md_waiter;
+	/* I/Os to the extent, waiting for the end of the migration */
+	TAILQ_HEAD(, tier_bdev_io)		waiters;
+	TAILQ_ENTRY(tier_migration)		link;
+};
+
+struct tier_stats {
+	/* Updated by the submitting threads too */
+	uint64_t	fast_ios;
+	uint64_t	capacity_ios;
+	uint64_t	promotions;
+	uint64_t	demotions;
+	uint64_t	migrated_bytes;
+	uint64_t	failed_migrations;
+};
+
+struct tier_create_ctx;
+
+struct vbdev_tier {
+	struct spdk_bdev			bdev;
+	struct spdk_bdev			*fast_bdev;
+	struct spdk_bdev_desc			*fast_desc;
+	struct spdk_bdev			*capacity_bdev;
+	struct spdk_bdev_desc			*capacity_desc;
+	/* Thread the base bdevs were opened on */
+	struct spdk_thread			*thread;
+	/* Thread owning the metadata */
+	struct spdk_thread			*md_thread;
+	struct spdk_io_channel			*fast_ch;
+	struct spdk_io_channel			*capacity_ch;
+	struct spdk_poller			*migrate_poller;
+	struct spdk_poller			*stop_poller;
+	int					start_status;
+
+	/* Number of blocks per metadata block */
+	uint32_t				md_base_blocks;
+	uint32_t				extent_size;
+	uint32_t				extent_blocks;
+	size_t					buf_align;
+	uint64_t				num_extents;
+	uint32_t				num_slots;
+	uint64_t				md_offset;
+	uint64_t				data_offset;
+
+	struct tier_extent			*extents;
+	/* Image of the remap table on the fast bdev */
+	uint32_t				*slots;
+	struct vbdev_md_writer			md_writer;
+	uint32_t				*free_slots;
+	uint32_t				num_free_slots;
+	uint32_t				num_used_slots;
+	uint32_t				num_dirty_slots;
+	uint32_t				victim_cursor;
+
+	uint32_t				candidates[TIER_CANDIDATES_MAX];
+	uint32_t				candidates_head;
+	uint32_t				num_candidates;
+	uint32_t				promote_threshold;
+	uint32_t				decay_period_ms;
+	uint64_t				decay_cursor;
+	/* Number of extents decayed by each poll */
+	uint64_t				decay_per_poll;
+
+	uint32_t				migration_bw_mbps;
+	uint64_t				migration_bw_bytes;
+	/* Bytes that can be migrated, refilled at the migration bandwidth */
+	uint64_t				tokens;
+	uint64_t				last_refill_tsc;
+	void					*migration_bufs;
+	struct tier_migration			migrations[TIER_MIGRATIONS_MAX];
+	TAILQ_HEAD(, tier_migration)		free_migrations;
+	TAILQ_HEAD(, tier_migration)		active_migrations;
+	uint32_t				num_migrations;
+	struct tier_stats			stats;
+
+	struct tier_create_ctx			*create_ctx;
+	void					(*stop_cb)(struct vbdev_tier *tier);
+	bool					fast_claimed;
+	bool					capacity_claimed;
+	TAILQ_ENTRY(vbdev_tier)			link;
+};
+
+struct tier_io_channel {
+	struct spdk_io_channel			*fast_ch;
+	struct spdk_io_channel			*capacity_ch;
+};
+
+struct tier_bdev_io {
+	struct vbdev_tier			*tier;
+	/* Range left to process, one extent at a time */
+	uint64_t				offset_blocks;
+	uint64_t				num_blocks;
+	/* Extent of the part of the range in progress and its size */
+	uint64_t				extent;
+	uint64_t				piece_blocks;
+	uint32_t				num_outstanding;
+	enum spdk_bdev_io_status		status;
+	void (*retry_fn)(struct tier_bdev_io *io);
+	struct spdk_bdev_io_wait_entry		bdev_io_wait;
+	struct vbdev_md_waiter			md_waiter;
+	TAILQ_ENTRY(tier_bdev_io)		link;
+};
+
+struct tier_create_ctx {
+	struct vbdev_tier			*tier;
+	vbdev_tier_create_cb			cb_fn;
+	void					*cb_arg;
+	struct spdk_io_channel			*ch;
+	struct tier_sb				*sb;
+	/* The metadata is loaded from the fast bdev instead of initialized */
+	bool					load;
+	/* The metadata is being written, after its initialization or its load */
+	bool					write_md;
+	/* UUID of a new tier vbdev if none was given */
+	struct spdk_uuid			uuid;
+	int					status;
+};
+
+static int vbdev_tier_init(void);
+static int vbdev_tier_get_ctx_size(void);
+static int vbdev_tier_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module tier_if = {
+	.name = "tier",
+	.module_init = vbdev_tier_init,
+	.get_ctx_size = vbdev_tier_get_ctx_size,
+	.config_json = vbdev_tier_config_json,
+};
+
+SPDK_BDEV_MODULE_REGISTER(tier, &tier_if)
+
+static TAILQ_HEAD(, vbdev_tier) g_tier_nodes = TAILQ_HEAD_INITIALIZER(g_tier_nodes);
+
+static void tier_io_next(struct tier_bdev_io *io);
+static void tier_migration_copy(struct tier_migration *mig);
+
+static inline uint64_t
+tier_slot_offset(struct vbdev_tier *tier, uint32_t slot)
+{
+	return tier->data_offset + (uint64_t)slot * tier->extent_blocks;
+}
+
+static inline uint64_t
+tier_extent_num_blocks(struct vbdev_tier *tier, uint64_t extent)
+{
+	return spdk_min(tier->extent_blocks, tier->bdev.blockcnt - extent * tier->extent_blocks);
+}
+
+static inline uint64_t
+tier_slot_md_block(uint32_t slot)
+{
+	return slot / TIER_SLOTS_PER_MD_BLOCK;
+}
+
+static inline uint64_t
+tier_slot_extent(uint32_t entry)
+{
+	return (entry & ~TIER_SLOT_DIRTY) - 1;
+}
+
+static void
+tier_push_candidate(struct vbdev_tier *tier, uint64_t extent)
+{
+	if (tier->num_candidates == TIER_CANDIDATES_MAX) {
+		return;
+	}
+
+	tier->candidates[(tier->candidates_head + tier->num_candidates) % TIER_CANDIDATES_MAX] = extent;
+	tier->num_candidates++;
+	__atomic_fetch_or(&tier->extents[extent].flags, TIER_EXTENT_CANDIDATE, __ATOMIC_SEQ_CST);
+}
+
+static uint64_t
+tier_pop_candidate(struct vbdev_tier *tier)
+{
+	uint64_t extent;
+
+	assert(tier->num_candidates > 0);
+	extent = tier->candidates[tier->candidates_head];
+	tier->candidates_head = (tier->candidates_head + 1) % TIER_CANDIDATES_MAX;
+	tier->num_candidates--;
+	__atomic_fetch_and(&tier->extents[extent].flags, ~TIER_EXTENT_CANDIDATE, __ATOMIC_SEQ_CST);
+
+	return extent;
+}
+
+static inline uint8_t
+tier_extent_heat(struct tier_extent *ext)
+{
+	return __atomic_load_n(&ext->heat, __ATOMIC_RELAXED);
+}
+
+static inline void
+tier_extent_set_heat(struct tier_extent *ext, uint8_t heat)
+{
+	__atomic_store_n(&ext->heat, heat, __ATOMIC_RELAXED);
+}
+
+static inline uint8_t
+tier_extent_heat_up(struct tier_extent *ext)
+{
+	uint8_t heat = tier_extent_heat(ext);
+
+	if (heat < TIER_HEAT_MAX) {
+		tier_extent_set_heat(ext, ++heat);
+	}
+
+	return heat;
+}
+
+/* Check whether an access would make an extent, not promoted, a candidate */
+static inline bool
+tier_extent_becomes_candidate(struct vbdev_tier *tier, uint8_t heat, uint8_t flags)
+{
+	return heat >= tier->promote_threshold &&
+	       !(flags & (TIER_EXTENT_CANDIDATE | TIER_EXTENT_MIGRATING)) &&
+	       tier->migration_bw_mbps != 0;
+}
+
+/* Account an access to an extent, which becomes a candidate once hot enough */
+static void
+tier_extent_touch(struct vbdev_tier *tier, uint64_t extent)
+{
+	struct tier_extent *ext = &tier->extents[extent];
+	uint8_t heat = tier_extent_heat_up(ext);
+
+	if (ext->slot == TIER_SLOT_NONE && tier_extent_becomes_candidate(tier, heat, ext->flags)) {
+		tier_push_candidate(tier, extent);
+	}
+}
+
+/* Halve the heat of a slice of the extents, so that each is halved once per decay period */
+static void
+tier_decay(struct vbdev_tier *tier)
+{
+	struct tier_extent *ext;
+	uint64_t i;
+
+	for (i = 0; i < tier->decay_per_poll; i++) {
+		ext = &tier->extents[tier->decay_cursor];
+		tier_extent_set_heat(ext, tier_extent_heat(ext) >> 1);
+		if (++tier->decay_cursor == tier->num_extents) {
+			tier->decay_cursor = 0;
+		}
+	}
+}
+
+/* Write the metadata block of a slot, after its remap table entry has been updated */
+static void
+tier_md_persist(struct vbdev_tier *tier, uint32_t slot, struct vbdev_md_waiter *waiter,
+		void (*cb_fn)(struct vbdev_md_waiter *waiter, int status), void *ctx)
+{
+	vbdev_md_persist(&tier->md_writer, tier_slot_md_block(slot), waiter, cb_fn, ctx);
+}
+
+/* Start the copy of the migrations whose extent has no I/O in progress anymore */
+static void
+tier_migrations_check(struct vbdev_tier *tier)
+{
+	struct tier_migration *mig;
+
+	TAILQ_FOREACH(mig, &tier->active_migrations, link) {
+		if (!mig->copying &&
+		    __atomic_load_n(&tier->extents[mig->extent].inflight, __ATOMIC_SEQ_CST) == 0) {
+			tier_migration_copy(mig);
+		}
+	}
+}
+
+static void
+_tier_migrations_check(void *ctx)
+{
+	tier_migrations_check(ctx);
+}
+
+/* Count an I/O in an extent, returns the flags of the extent once counted */
+static inline uint8_t
+tier_extent_get(struct tier_extent *ext)
+{
+	__atomic_fetch_add(&ext->inflight, 1, __ATOMIC_SEQ_CST);
+
+	return __atomic_load_n(&ext->flags, __ATOMIC_SEQ_CST);
+}
+
+/* The last I/O in progress on an extent being migrated starts the copy */
+static void
+tier_extent_put(struct vbdev_tier *tier, struct tier_extent *ext)
+{
+	assert(__atomic_load_n(&ext->inflight, __ATOMIC_RELAXED) > 0);
+	if (__atomic_sub_fetch(&ext->inflight, 1, __ATOMIC_SEQ_CST) > 0 ||
+	    !(__atomic_load_n(&ext->flags, __ATOMIC_SEQ_CST) & TIER_EXTENT_MIGRATING)) {
+		return;
+	}
+
+	if (tier->md_thread == spdk_get_thread()) {
+		tier_migrations_check(tier);
+	} else {
+		spdk_thread_send_msg(tier->md_thread, _tier_migrations_check, tier);
+	}
+}
+
+static struct tier_migration *
+tier_find_migration(struct vbdev_tier *tier, uint64_t extent)
+{
+	struct tier_migration *mig;
+
+	TAILQ_FOREACH(mig, &tier->active_migrations, link) {
+		if (mig->extent == extent) {
+			return mig;
+		}
+	}
+
+	assert(false);
+	return NULL;
+}
+
+static void
+_tier_io_complete(void *ctx)
+{
+	struct tier_bdev_io *io = ctx;
+
+	spdk_bdev_io_complete(spdk_bdev_io_from_ctx(io), io->status);
+}
+
+/* Complete the I/O on the thread it was submitted on */
+static void
+tier_io_finish(struct tier_bdev_io *io, enum spdk_bdev_io_status status)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct spdk_thread *thread = spdk_bdev_io_get_thread(bdev_io);
+
+	io->status = status;
+	if (thread == spdk_get_thread()) {
+		spdk_bdev_io_complete(bdev_io, status);
+	} else {
+		spdk_thread_send_msg(thread, _tier_io_complete, io);
+	}
+}
+
+static void
+_tier_io_retry(void *arg)
+{
+	struct tier_bdev_io *io = arg;
+
+	io->retry_fn(io);
+}
+
+/* Handle the return code of the submission of a base I/O, cb_fn is called if it failed */
+static void
+tier_io_submitted(struct tier_bdev_io *io, int rc, struct spdk_bdev_desc *desc,
+		  struct spdk_io_channel *ch, void (*retry_fn)(struct tier_bdev_io *io),
+		  spdk_bdev_io_completion_cb cb_fn)
+{
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(desc);
+
+	if (spdk_likely(rc == 0)) {
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		io->retry_fn = retry_fn;
+		io->bdev_io_wait.bdev = bdev;
+		io->bdev_io_wait.cb_fn = _tier_io_retry;
+		io->bdev_io_wait.cb_arg = io;
+		rc = spdk_bdev_queue_io_wait(bdev, ch, &io->bdev_io_wait);
+		if (rc == 0) {
+			return;
+		}
+	}
+
+	SPDK_ERRLOG("Failed to submit an I/O to %s: %s\n", spdk_bdev_get_name(bdev),
+		    spdk_strerror(-rc));
+	cb_fn(NULL, false, io);
+}
+
+/* The part of the range in one extent is done, go on with the next one */
+static void
+tier_io_piece_done(struct tier_bdev_io *io)
+{
+	struct vbdev_tier *tier = io->tier;
+
+	tier_extent_put(tier, &tier->extents[io->extent]);
+
+	io->offset_blocks += io->piece_blocks;
+	io->num_blocks -= io->piece_blocks;
+	tier_io_next(io);
+}
+
+static void
+tier_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct tier_bdev_io *io = cb_arg;
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+
+	if (!success) {
+		io->status = SPDK_BDEV_IO_STATUS_FAILED;
+	}
+
+	assert(io->num_outstanding > 0);
+	if (--io->num_outstanding == 0) {
+		tier_io_piece_done(io);
+	}
+}
+
+static void
+tier_io_dirty_persisted(struct vbdev_md_waiter *waiter, int status)
+{
+	struct tier_bdev_io *io = waiter->ctx;
+
+	if (status == 0) {
+		__atomic_fetch_and(&io->tier->extents[io->extent].flags, ~TIER_EXTENT_DIRTYING,
+				   __ATOMIC_SEQ_CST);
+	}
+	tier_io_done(NULL, status == 0, io);
+}
+
+/* Submit the part of the I/O in an extent, whose slot cannot change until it is done */
+static void
+_tier_io_submit_piece(struct tier_bdev_io *io, struct spdk_io_channel *fast_ch,
+		      struct spdk_io_channel *capacity_ch, void (*retry_fn)(struct tier_bdev_io *io),
+		      spdk_bdev_io_completion_cb cb_fn)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct vbdev_tier *tier = io->tier;
+	uint32_t slot = __atomic_load_n(&tier->extents[io->extent].slot, __ATOMIC_SEQ_CST);
+	struct spdk_bdev_desc *desc;
+	struct spdk_io_channel *ch;
+	uint64_t offset_blocks;
+	int rc;
+
+	if (slot != TIER_SLOT_NONE) {
+		desc = tier->fast_desc;
+		ch = fast_ch;
+		offset_blocks = tier_slot_offset(tier, slot) +
+				io->offset_blocks - io->extent * tier->extent_blocks;
+	} else {
+		desc = tier->capacity_desc;
+		ch = capacity_ch;
+		offset_blocks = io->offset_blocks;
+	}
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		rc = spdk_bdev_readv_blocks(desc, ch, bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+					    offset_blocks, io->piece_blocks, cb_fn, io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		rc = spdk_bdev_writev_blocks(desc, ch, bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+					     offset_blocks, io->piece_blocks, cb_fn, io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		rc = spdk_bdev_unmap_blocks(desc, ch, offset_blocks, io->piece_blocks, cb_fn, io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		rc = spdk_bdev_write_zeroes_blocks(desc, ch, offset_blocks, io->piece_blocks,
+						   cb_fn, io);
+		break;
+	default:
+		assert(false);
+		rc = -EINVAL;
+		break;
+	}
+
+	tier_io_submitted(io, rc, desc, ch, retry_fn, cb_fn);
+}
+
+static void
+tier_io_submit_piece(struct tier_bdev_io *io)
+{
+	struct vbdev_tier *tier = io->tier;
+
+	_tier_io_submit_piece(io, tier->fast_ch, tier->capacity_ch, tier_io_submit_piece,
+			      tier_io_done);
+}
+
+/* Process the part of the range of the I/O in the next extent */
+static void
+tier_io_next(struct tier_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct vbdev_tier *tier = io->tier;
+	struct tier_extent *ext;
+	uint32_t slot;
+
+	if (io->num_blocks == 0 || io->status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		tier_io_finish(io, io->status);
+		return;
+	}
+
+	io->extent = io->offset_blocks / tier->extent_blocks;
+	io->piece_blocks = spdk_min(io->num_blocks,
+				    (io->extent + 1) * tier->extent_blocks - io->offset_blocks);
+	ext = &tier->extents[io->extent];
+
+	if (ext->flags & TIER_EXTENT_MIGRATING) {
+		TAILQ_INSERT_TAIL(&tier_find_migration(tier, io->extent)->waiters, io, link);
+		return;
+	}
+
+	__atomic_fetch_add(&ext->inflight, 1, __ATOMIC_SEQ_CST);
+	io->num_outstanding = 1;
+	slot = ext->slot;
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_READ || bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE) {
+		tier_extent_touch(tier, io->extent);
+	}
+
+	if (slot != TIER_SLOT_NONE) {
+		__atomic_fetch_add(&tier->stats.fast_ios, 1, __ATOMIC_RELAXED);
+		/* The slot must be marked dirty on the fast bdev before a write to it completes,
+		 * otherwise the extent would not be copied back when demoted.
+		 */
+		if (bdev_io->type != SPDK_BDEV_IO_TYPE_READ &&
+		    (!(tier->slots[slot] & TIER_SLOT_DIRTY) || (ext->flags & TIER_EXTENT_DIRTYING))) {
+			if (!(tier->slots[slot] & TIER_SLOT_DIRTY)) {
+				__atomic_store_n(&tier->slots[slot], tier->slots[slot] | TIER_SLOT_DIRTY,
+						 __ATOMIC_SEQ_CST);
+				tier->num_dirty_slots++;
+			}
+			__atomic_fetch_or(&ext->flags, TIER_EXTENT_DIRTYING, __ATOMIC_SEQ_CST);
+			io->num_outstanding++;
+			tier_md_persist(tier, slot, &io->md_waiter, tier_io_dirty_persisted, io);
+		}
+	} else {
+		__atomic_fetch_add(&tier->stats.capacity_ios, 1, __ATOMIC_RELAXED);
+	}
+
+	tier_io_submit_piece(io);
+}
+
+static void tier_flush_capacity(struct tier_bdev_io *io);
+
+static void
+tier_flush_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct tier_bdev_io *io = cb_arg;
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+
+	if (!success) {
+		io->status = SPDK_BDEV_IO_STATUS_FAILED;
+	}
+
+	assert(io->num_outstanding > 0);
+	if (--io->num_outstanding == 0) {
+		tier_io_finish(io, io->status);
+	}
+}
+
+static void
+tier_flush_fast(struct tier_bdev_io *io)
+{
+	struct vbdev_tier *tier = io->tier;
+	int rc;
+
+	rc = spdk_bdev_flush_blocks(tier->fast_desc, tier->fast_ch, 0,
+				    spdk_bdev_get_num_blocks(tier->fast_bdev), tier_flush_done, io);
+	tier_io_submitted(io, rc, tier->fast_desc, tier->fast_ch, tier_flush_fast, tier_flush_done);
+}
+
+static void
+tier_flush_capacity(struct tier_bdev_io *io)
+{
+	struct vbdev_tier *tier = io->tier;
+	int rc;
+
+	rc = spdk_bdev_flush_blocks(tier->capacity_desc, tier->capacity_ch, 0,
+				    spdk_bdev_get_num_blocks(tier->capacity_bdev), tier_flush_done, io);
+	tier_io_submitted(io, rc, tier->capacity_desc, tier->capacity_ch, tier_flush_capacity,
+			  tier_flush_done);
+}
+
+/* The remap table of the completed writes is already on the fast bdev, only the caches of the
+ * base bdevs are flushed.
+ */
+static void
+tier_process_flush(struct tier_bdev_io *io)
+{
+	struct vbdev_tier *tier = io->tier;
+	bool fast = spdk_bdev_io_type_supported(tier->fast_bdev, SPDK_BDEV_IO_TYPE_FLUSH);
+	bool capacity = spdk_bdev_io_type_supported(tier->capacity_bdev, SPDK_BDEV_IO_TYPE_FLUSH);
+
+	io->num_outstanding = fast + capacity;
+	if (fast) {
+		tier_flush_fast(io);
+	}
+	if (capacity) {
+		tier_flush_capacity(io);
+	}
+}
+
+static void
+tier_io_process(struct tier_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_FLUSH) {
+		tier_process_flush(io);
+	} else {
+		tier_io_next(io);
+	}
+}
+
+static void
+_tier_io_process(void *ctx)
+{
+	tier_io_process(ctx);
+}
+
+static void
+tier_io_submit_to_md_thread(struct vbdev_tier *tier, struct tier_bdev_io *io)
+{
+	if (tier->md_thread == spdk_get_thread()) {
+		tier_io_process(io);
+	} else {
+		spdk_thread_send_msg(tier->md_thread, _tier_io_process, io);
+	}
+}
+
+static void
+tier_direct_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct tier_bdev_io *io = cb_arg;
+	struct vbdev_tier *tier = io->tier;
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+
+	tier_extent_put(tier, &tier->extents[io->extent]);
+	spdk_bdev_io_complete(spdk_bdev_io_from_ctx(io), success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+tier_direct_io_submit(struct tier_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct tier_io_channel *tier_ch = spdk_io_channel_get_ctx(spdk_bdev_io_get_io_channel(bdev_io));
+
+	_tier_io_submit_piece(io, tier_ch->fast_ch, tier_ch->capacity_ch, tier_direct_io_submit,
+			      tier_direct_io_done);
+}
+
+/*
+ * Submit a read or a write to the base bdevs on the thread it was submitted on, returns false
+ * if it has to be processed by the metadata thread. The bdev layer splits the I/Os on extent
+ * boundaries.
+ */
+static bool
+tier_direct_io(struct tier_bdev_io *io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct vbdev_tier *tier = io->tier;
+	struct tier_extent *ext;
+	uint32_t slot;
+	uint8_t flags, heat;
+
+	io->extent = io->offset_blocks / tier->extent_blocks;
+	io->piece_blocks = io->num_blocks;
+	assert(io->offset_blocks + io->num_blocks <= (io->extent + 1) * tier->extent_blocks);
+	ext = &tier->extents[io->extent];
+
+	flags = tier_extent_get(ext);
+	slot = __atomic_load_n(&ext->slot, __ATOMIC_SEQ_CST);
+	heat = spdk_min(tier_extent_heat(ext) + 1, TIER_HEAT_MAX);
+	if ((flags & TIER_EXTENT_MIGRATING) ||
+	    (slot == TIER_SLOT_NONE && tier_extent_becomes_candidate(tier, heat, flags)) ||
+	    (slot != TIER_SLOT_NONE && bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE &&
+	     (!(__atomic_load_n(&tier->slots[slot], __ATOMIC_SEQ_CST) & TIER_SLOT_DIRTY) ||
+	      (flags & TIER_EXTENT_DIRTYING)))) {
+		tier_extent_put(tier, ext);
+		return false;
+	}
+
+	tier_extent_heat_up(ext);
+	__atomic_fetch_add(slot != TIER_SLOT_NONE ? &tier->stats.fast_ios : &tier->stats.capacity_ios,
+			   1, __ATOMIC_RELAXED);
+	tier_direct_io_submit(io);
+
+	return true;
+}
+
+static void
+tier_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	struct vbdev_tier *tier = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_tier, bdev);
+	struct tier_bdev_io *io = (struct tier_bdev_io *)bdev_io->driver_ctx;
+
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (!tier_direct_io(io)) {
+		tier_io_submit_to_md_thread(tier, io);
+	}
+}
+
+static void
+vbdev_tier_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_tier *tier = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_tier, bdev);
+	struct tier_bdev_io *io = (struct tier_bdev_io *)bdev_io->driver_ctx;
+
+	memset(io, 0, sizeof(*io));
+	io->tier = tier;
+	io->status = SPDK_BDEV_IO_STATUS_SUCCESS;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		io->offset_blocks = bdev_io->u.bdev.offset_blocks;
+		io->num_blocks = bdev_io->u.bdev.num_blocks;
+		spdk_bdev_io_get_buf(bdev_io, tier_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		return;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		io->offset_blocks = bdev_io->u.bdev.offset_blocks;
+		io->num_blocks = bdev_io->u.bdev.num_blocks;
+		if (tier_direct_io(io)) {
+			return;
+		}
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		io->offset_blocks = bdev_io->u.bdev.offset_blocks;
+		io->num_blocks = bdev_io->u.bdev.num_blocks;
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		break;
+	default:
+		SPDK_ERRLOG("tier: unknown I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	tier_io_submit_to_md_thread(tier, io);
+}
+
+static bool
+vbdev_tier_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_tier *tier = ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		return true;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		/* An extent can be on either bdev */
+		return spdk_bdev_io_type_supported(tier->fast_bdev, io_type) &&
+		       spdk_bdev_io_type_supported(tier->capacity_bdev, io_type);
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		return spdk_bdev_io_type_supported(tier->fast_bdev, io_type) ||
+		       spdk_bdev_io_type_supported(tier->capacity_bdev, io_type);
+	default:
+		return false;
+	}
+}
+
+static void
+tier_migration_end(struct tier_migration *mig, bool success)
+{
+	struct vbdev_tier *tier = mig->tier;
+	TAILQ_HEAD(, tier_bdev_io) waiters = TAILQ_HEAD_INITIALIZER(waiters);
+	struct tier_bdev_io *io;
+
+	if (!success) {
+		tier->stats.failed_migrations++;
+	}
+
+	__atomic_fetch_and(&tier->extents[mig->extent].flags, ~TIER_EXTENT_MIGRATING,
+			   __ATOMIC_SEQ_CST);
+	TAILQ_REMOVE(&tier->active_migrations, mig, link);
+	TAILQ_INSERT_TAIL(&tier->free_migrations, mig, link);
+	tier->num_migrations--;
+
+	TAILQ_CONCAT(&waiters, &mig->waiters, link);
+	while ((io = TAILQ_FIRST(&waiters))) {
+		TAILQ_REMOVE(&waiters, io, link);
+		tier_io_next(io);
+	}
+}
+
+static void
+_tier_migration_retry(void *arg)
+{
+	struct tier_migration *mig = arg;
+
+	mig->retry_fn(mig);
+}
+
+/* Handle the return code of the submission of a migration I/O, cb_fn is called if it failed */
+static void
+tier_migration_submitted(struct tier_migration *mig, int rc, struct spdk_bdev_desc *desc,
+			 struct spdk_io_channel *ch, void (*retry_fn)(struct tier_migration *mig),
+			 spdk_bdev_io_completion_cb cb_fn)
+{
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(desc);
+
+	if (spdk_likely(rc == 0)) {
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		mig->retry_fn = retry_fn;
+		mig->bdev_io_wait.bdev = bdev;
+		mig->bdev_io_wait.cb_fn = _tier_migration_retry;
+		mig->bdev_io_wait.cb_arg = mig;
+		rc = spdk_bdev_queue_io_wait(bdev, ch, &mig->bdev_io_wait);
+		if (rc == 0) {
+			return;
+		}
+	}
+
+	SPDK_ERRLOG("Failed to submit an I/O to %s: %s\n", spdk_bdev_get_name(bdev),
+		    spdk_strerror(-rc));
+	cb_fn(NULL, false, mig);
+}
+
+static void
+tier_migration_persisted(struct vbdev_md_waiter *waiter, int status)
+{
+	struct tier_migration *mig = waiter->ctx;
+	struct vbdev_tier *tier = mig->tier;
+	struct tier_extent *ext = &tier->extents[mig->extent];
+
+	if (status != 0) {
+		if (mig->promote) {
+			/* The slot may still be mapped to the extent on the fast bdev */
+			SPDK_ERRLOG("%s: slot %" PRIu32 " is not reused until the tier vbdev is "
+				    "created again\n", tier->bdev.name, mig->slot);
+		}
+		__atomic_store_n(&tier->slots[mig->slot], mig->old_entry, __ATOMIC_SEQ_CST);
+		tier_migration_end(mig, false);
+		return;
+	}
+
+	if (mig->promote) {
+		__atomic_store_n(&ext->slot, mig->slot, __ATOMIC_SEQ_CST);
+		tier->num_used_slots++;
+		tier->stats.promotions++;
+	} else {
+		__atomic_store_n(&ext->slot, TIER_SLOT_NONE, __ATOMIC_SEQ_CST);
+		tier->num_used_slots--;
+		if (mig->old_entry & TIER_SLOT_DIRTY) {
+			tier->num_dirty_slots--;
+		}
+		tier->free_slots[tier->num_free_slots++] = mig->slot;
+		tier->stats.demotions++;
+	}
+
+	tier_migration_end(mig, true);
+}
+
+/* Map the slot to the extent when promoting it, unmap it when demoting it */
+static void
+tier_migration_commit(struct tier_migration *mig)
+{
+	struct vbdev_tier *tier = mig->tier;
+
+	__atomic_store_n(&tier->slots[mig->slot], mig->promote ? mig->extent + 1 : 0,
+			 __ATOMIC_SEQ_CST);
+	tier_md_persist(tier, mig->slot, &mig->md_waiter, tier_migration_persisted, mig);
+}
+
+static void
+tier_migration_copy_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct tier_migration *mig = cb_arg;
+	struct vbdev_tier *tier = mig->tier;
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+
+	if (!success) {
+		SPDK_ERRLOG("%s: failed to %s extent %" PRIu64 "\n", tier->bdev.name,
+			    mig->promote ? "promote" : "demote", mig->extent);
+		if (mig->promote) {
+			tier->free_slots[tier->num_free_slots++] = mig->slot;
+		}
+		tier_migration_end(mig, false);
+		return;
+	}
+
+	tier_migration_commit(mig);
+}
+
+/* Make the extent written back to the capacity bdev durable before freeing its slot */
+static void
+tier_migration_flush(struct tier_migration *mig)
+{
+	struct vbdev_tier *tier = mig->tier;
+	int rc;
+
+	rc = spdk_bdev_flush_blocks(tier->capacity_desc, tier->capacity_ch,
+				    mig->extent * tier->extent_blocks,
+				    tier_extent_num_blocks(tier, mig->extent),
+				    tier_migration_copy_done, mig);
+	tier_migration_submitted(mig, rc, tier->capacity_desc, tier->capacity_ch,
+				 tier_migration_flush, tier_migration_copy_done);
+}
+
+static void
+tier_migration_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct tier_migration *mig = cb_arg;
+	struct vbdev_tier *tier = mig->tier;
+
+	if (success) {
+		tier->stats.migrated_bytes += tier_extent_num_blocks(tier, mig->extent) *
+					      tier->bdev.blocklen;
+		if (!mig->promote && tier->capacity_bdev->write_cache &&
+		    spdk_bdev_io_type_supported(tier->capacity_bdev, SPDK_BDEV_IO_TYPE_FLUSH)) {
+			spdk_bdev_free_io(bdev_io);
+			tier_migration_flush(mig);
+			return;
+		}
+	}
+
+	tier_migration_copy_done(bdev_io, success, mig);
+}
+
+static void
+tier_migration_write(struct tier_migration *mig)
+{
+	struct vbdev_tier *tier = mig->tier;
+	struct spdk_bdev_desc *desc;
+	struct spdk_io_channel *ch;
+	uint64_t offset_blocks;
+	int rc;
+
+	if (mig->promote) {
+		desc = tier->fast_desc;
+		ch = tier->fast_ch;
+		offset_blocks = tier_slot_offset(tier, mig->slot);
+	} else {
+		desc = tier->capacity_desc;
+		ch = tier->capacity_ch;
+		offset_blocks = mig->extent * tier->extent_blocks;
+	}
+
+	rc = spdk_bdev_write_blocks(desc, ch, mig->buf, offset_blocks,
+				    tier_extent_num_blocks(tier, mig->extent),
+				    tier_migration_write_done, mig);
+	tier_migration_submitted(mig, rc, desc, ch, tier_migration_write, tier_migration_copy_done);
+}
+
+static void
+tier_migration_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct tier_migration *mig = cb_arg;
+
+	if (!success) {
+		tier_migration_copy_done(bdev_io, false, mig);
+		return;
+	}
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+	tier_migration_write(mig);
+}
+
+static void
+tier_migration_read(struct tier_migration *mig)
+{
+	struct vbdev_tier *tier = mig->tier;
+	struct spdk_bdev_desc *desc;
+	struct spdk_io_channel *ch;
+	uint64_t offset_blocks;
+	int rc;
+
+	if (mig->promote) {
+		desc = tier->capacity_desc;
+		ch = tier->capacity_ch;
+		offset_blocks = mig->extent * tier->extent_blocks;
+	} else {
+		desc = tier->fast_desc;
+		ch = tier->fast_ch;
+		offset_blocks = tier_slot_offset(tier, mig->slot);
+	}
+
+	rc = spdk_bdev_read_blocks(desc, ch, mig->buf, offset_blocks,
+				   tier_extent_num_blocks(tier, mig->extent),
+				   tier_migration_read_done, mig);
+	tier_migration_submitted(mig, rc, desc, ch, tier_migration_read, tier_migration_copy_done);
+}
+
+/* No I/O is in progress on the extent anymore, move its data */
+static void
+tier_migration_copy(struct tier_migration *mig)
+{
+	mig->copying = true;
+	if (mig->promote || (mig->old_entry & TIER_SLOT_DIRTY)) {
+		tier_migration_read(mig);
+	} else {
+		/* The capacity bdev still holds the data of a clean extent */
+		tier_migration_commit(mig);
+	}
+}
+
+static void
+tier_migration_start(struct vbdev_tier *tier, uint64_t extent, uint32_t slot, bool promote)
+{
+	struct tier_migration *mig = TAILQ_FIRST(&tier->free_migrations);
+	struct tier_extent *ext = &tier->extents[extent];
+
+	assert(mig != NULL);
+	TAILQ_REMOVE(&tier->free_migrations, mig, link);
+	TAILQ_INSERT_TAIL(&tier->active_migrations, mig, link);
+	tier->num_migrations++;
+
+	mig->extent = extent;
+	mig->slot = slot;
+	mig->promote = promote;
+	mig->copying = false;
+	mig->old_entry = tier->slots[slot];
+	__atomic_fetch_or(&ext->flags, TIER_EXTENT_MIGRATING, __ATOMIC_SEQ_CST);
+
+	SPDK_DEBUGLOG(vbdev_tier, "%s: %s extent %" PRIu64 " (heat %u), slot %" PRIu32 "\n",
+		      tier->bdev.name, promote ? "promoting" : "demoting", extent,
+		      tier_extent_heat(ext), slot);
+
+	/* Otherwise the last I/O in progress on the extent starts the copy */
+	if (__atomic_load_n(&ext->inflight, __ATOMIC_SEQ_CST) == 0) {
+		tier_migration_copy(mig);
+	}
+}
+
+/* Find the coldest extent in the next few slots */
+static uint64_t
+tier_find_victim(struct vbdev_tier *tier)
+{
+	uint64_t victim = TIER_EXTENT_NONE, extent;
+	uint32_t i, slot, entry, num_scan = spdk_min(tier->num_slots, TIER_VICTIM_SCAN_MAX);
+
+	for (i = 0; i < num_scan; i++) {
+		slot = tier->victim_cursor;
+		tier->victim_cursor = (slot + 1) % tier->num_slots;
+
+		entry = tier->slots[slot];
+		if (entry == 0) {
+			continue;
+		}
+		extent = tier_slot_extent(entry);
+		if (tier->extents[extent].flags & TIER_EXTENT_MIGRATING) {
+			continue;
+		}
+		if (victim == TIER_EXTENT_NONE ||
+		    tier_extent_heat(&tier->extents[extent]) < tier_extent_heat(&tier->extents[victim])) {
+			victim = extent;
+		}
+	}
+
+	return victim;
+}
+
+/* Start the next migration, returns false if there is nothing to migrate */
+static bool
+tier_migrate_next(struct vbdev_tier *tier)
+{
+	struct tier_extent *ext, *victim_ext;
+	uint64_t extent, victim;
+	uint32_t slot;
+
+	while (tier->num_candidates > 0) {
+		extent = tier_pop_candidate(tier);
+		ext = &tier->extents[extent];
+		if (ext->slot != TIER_SLOT_NONE || (ext->flags & TIER_EXTENT_MIGRATING) ||
+		    tier_extent_heat(ext) < tier->promote_threshold) {
+			continue;
+		}
+
+		if (tier->num_free_slots > 0) {
+			slot = tier->free_slots[--tier->num_free_slots];
+			tier->tokens -= tier->extent_size;
+			tier_migration_start(tier, extent, slot, true);
+			return true;
+		}
+
+		/* The candidate is promoted once the demotion has freed a slot, if it is still hot
+		 * on its next access.
+		 */
+		victim = tier_find_victim(tier);
+		if (victim == TIER_EXTENT_NONE ||
+		    tier_extent_heat(&tier->extents[victim]) + TIER_DEMOTE_HYSTERESIS >=
+		    tier_extent_heat(ext)) {
+			continue;
+		}
+
+		victim_ext = &tier->extents[victim];
+		if (tier->slots[victim_ext->slot] & TIER_SLOT_DIRTY) {
+			tier->tokens -= tier->extent_size;
+		}
+		tier_migration_start(tier, victim, victim_ext->slot, false);
+		return true;
+	}
+
+	return false;
+}
+
+static int
+tier_migrate_poll(void *arg)
+{
+	struct vbdev_tier *tier = arg;
+	uint64_t now = spdk_get_ticks(), hz = spdk_get_ticks_hz(), elapsed;
+	int busy = SPDK_POLLER_IDLE;
+
+	tier_decay(tier);
+
+	if (tier->migration_bw_mbps == 0) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	/* Bursts are limited to a migration per migration slot */
+	elapsed = spdk_min(now - tier->last_refill_tsc, hz);
+	tier->last_refill_tsc = now;
+	tier->tokens = spdk_min(tier->tokens + tier->migration_bw_bytes * elapsed / hz,
+				(uint64_t)TIER_MIGRATIONS_MAX * tier->extent_size);
+
+	while (tier->num_migrations < TIER_MIGRATIONS_MAX && tier->tokens >= tier->extent_size &&
+	       tier_migrate_next(tier)) {
+		busy = SPDK_POLLER_BUSY;
+	}
+
+	return busy;
+}
+
+static struct spdk_io_channel *
+vbdev_tier_get_io_channel(void *ctx)
+{
+	return spdk_get_io_channel(ctx);
+}
+
+static int
+tier_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct vbdev_tier *tier = io_device;
+	struct tier_io_channel *tier_ch = ctx_buf;
+
+	tier_ch->fast_ch = spdk_bdev_get_io_channel(tier->fast_desc);
+	if (tier_ch->fast_ch == NULL) {
+		return -ENOMEM;
+	}
+
+	tier_ch->capacity_ch = spdk_bdev_get_io_channel(tier->capacity_desc);
+	if (tier_ch->capacity_ch == NULL) {
+		spdk_put_io_channel(tier_ch->fast_ch);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+tier_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct tier_io_channel *tier_ch = ctx_buf;
+
+	spdk_put_io_channel(tier_ch->fast_ch);
+	spdk_put_io_channel(tier_ch->capacity_ch);
+}
+
+static void
+tier_thread_stopped(void *ctx)
+{
+	struct vbdev_tier *tier = ctx;
+
+	tier->md_thread = NULL;
+	tier->stop_cb(tier);
+}
+
+static void
+_tier_thread_stop(struct vbdev_tier *tier)
+{
+	if (tier->fast_ch != NULL) {
+		spdk_put_io_channel(tier->fast_ch);
+		tier->fast_ch = NULL;
+	}
+	if (tier->capacity_ch != NULL) {
+		spdk_put_io_channel(tier->capacity_ch);
+		tier->capacity_ch = NULL;
+	}
+
+	spdk_thread_exit(tier->md_thread);
+	spdk_thread_send_msg(tier->thread, tier_thread_stopped, tier);
+}
+
+static int
+tier_thread_stop_poll(void *arg)
+{
+	struct vbdev_tier *tier = arg;
+
+	if (tier->num_migrations > 0 || tier->md_writer.num_writes > 0) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	spdk_poller_unregister(&tier->stop_poller);
+	_tier_thread_stop(tier);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+tier_thread_stop(void *ctx)
+{
+	struct vbdev_tier *tier = ctx;
+
+	spdk_poller_unregister(&tier->migrate_poller);
+
+	if (tier->num_migrations > 0 || tier->md_writer.num_writes > 0) {
+		tier->stop_poller = SPDK_POLLER_REGISTER(tier_thread_stop_poll, tier,
+				    TIER_STOP_POLL_PERIOD_US);
+		return;
+	}
+
+	_tier_thread_stop(tier);
+}
+
+/* Stop the metadata thread, must be called on the thread of the tier vbdev */
+static void
+tier_stop_md_thread(struct vbdev_tier *tier, void (*cb_fn)(struct vbdev_tier *tier))
+{
+	assert(tier->thread == spdk_get_thread());
+
+	tier->stop_cb = cb_fn;
+	if (tier->md_thread == NULL) {
+		cb_fn(tier);
+		return;
+	}
+
+	spdk_thread_send_msg(tier->md_thread, tier_thread_stop, tier);
+}
+
+static void
+tier_close_base_bdevs(struct vbdev_tier *tier)
+{
+	if (tier->fast_claimed) {
+		spdk_bdev_module_release_bdev(tier->fast_bdev);
+		tier->fast_claimed = false;
+	}
+	if (tier->fast_desc != NULL) {
+		spdk_bdev_close(tier->fast_desc);
+		tier->fast_desc = NULL;
+	}
+	if (tier->capacity_claimed) {
+		spdk_bdev_module_release_bdev(tier->capacity_bdev);
+		tier->capacity_claimed = false;
+	}
+	if (tier->capacity_desc != NULL) {
+		spdk_bdev_close(tier->capacity_desc);
+		tier->capacity_desc = NULL;
+	}
+}
+
+static void
+tier_free(struct vbdev_tier *tier)
+{
+	tier_close_base_bdevs(tier);
+
+	spdk_free(tier->slots);
+	spdk_free(tier->migration_bufs);
+	vbdev_md_writer_fini(&tier->md_writer);
+	free(tier->extents);
+	free(tier->free_slots);
+	free(tier->bdev.name);
+	free(tier);
+}
+
+static int
+tier_alloc_md(struct vbdev_tier *tier)
+{
+	uint64_t num_md_blocks = spdk_divide_round_up(tier->num_slots, TIER_SLOTS_PER_MD_BLOCK);
+	struct tier_migration *mig;
+	uint64_t i;
+
+	tier->slots = spdk_zmalloc(num_md_blocks * TIER_MD_BLOCK_SIZE, tier->buf_align, NULL,
+				   SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	tier->extents = calloc(tier->num_extents, sizeof(*tier->extents));
+	tier->free_slots = calloc(tier->num_slots, sizeof(*tier->free_slots));
+	tier->migration_bufs = spdk_zmalloc((size_t)TIER_MIGRATIONS_MAX * tier->extent_size,
+					    tier->buf_align, NULL, SPDK_ENV_LCORE_ID_ANY,
+					    SPDK_MALLOC_DMA);
+	if (tier->slots == NULL || tier->extents == NULL || tier->free_slots == NULL ||
+	    tier->migration_bufs == NULL ||
+	    vbdev_md_writer_init(&tier->md_writer, num_md_blocks) != 0) {
+		return -ENOMEM;
+	}
+	tier->md_writer.name = tier->bdev.name;
+	tier->md_writer.desc = tier->fast_desc;
+	tier->md_writer.buf = tier->slots;
+	tier->md_writer.block_size = TIER_MD_BLOCK_SIZE;
+	tier->md_writer.base_blocks = tier->md_base_blocks;
+	tier->md_writer.offset_blocks = tier->md_offset * tier->md_base_blocks;
+
+	for (i = 0; i < tier->num_extents; i++) {
+		tier->extents[i].slot = TIER_SLOT_NONE;
+	}
+
+	TAILQ_INIT(&tier->free_migrations);
+	TAILQ_INIT(&tier->active_migrations);
+	for (i = 0; i < TIER_MIGRATIONS_MAX; i++) {
+		mig = &tier->migrations[i];
+		mig->tier = tier;
+		mig->buf = (char *)tier->migration_bufs + i * tier->extent_size;
+		TAILQ_INIT(&mig->waiters);
+		TAILQ_INSERT_TAIL(&tier->free_migrations, mig, link);
+	}
+
+	return 0;
+}
+
+/* Map the extents to the slots of the remap table and build the list of free slots, returns the
+ * number of invalid entries, which are cleared.
+ */
+static uint64_t
+tier_rebuild(struct vbdev_tier *tier)
+{
+	uint64_t extent, num_invalid = 0;
+	uint32_t slot, entry;
+
+	for (slot = 0; slot < tier->num_slots; slot++) {
+		entry = tier->slots[slot];
+		if (entry == 0) {
+			continue;
+		}
+		extent = tier_slot_extent(entry);
+		if (extent >= tier->num_extents || tier->extents[extent].slot != TIER_SLOT_NONE) {
+			tier->slots[slot] = 0;
+			num_invalid++;
+			continue;
+		}
+		tier->extents[extent].slot = slot;
+		tier->num_used_slots++;
+		if (entry & TIER_SLOT_DIRTY) {
+			tier->num_dirty_slots++;
+		}
+	}
+
+	/* The lowest slots are used first */
+	for (slot = tier->num_slots; slot > 0; slot--) {
+		if (tier->slots[slot - 1] == 0) {
+			tier->free_slots[tier->num_free_slots++] = slot - 1;
+		}
+	}
+
+	return num_invalid;
+}
+
+static inline uint64_t
+tier_data_offset(struct vbdev_tier *tier, uint64_t num_slots)
+{
+	uint64_t md_blocks = 1 + spdk_divide_round_up(num_slots, TIER_SLOTS_PER_MD_BLOCK);
+
+	return SPDK_ALIGN_CEIL(md_blocks * tier->md_base_blocks, tier->extent_blocks);
+}
+
+/* Use as much of the fast bdev as possible for slots */
+static int
+tier_calc_layout(struct vbdev_tier *tier)
+{
+	uint64_t fast_blocks = spdk_bdev_get_num_blocks(tier->fast_bdev);
+	uint64_t slots, end;
+
+	slots = spdk_min(fast_blocks / tier->extent_blocks, tier->num_extents);
+	while (slots > 0) {
+		end = tier_data_offset(tier, slots) + slots * tier->extent_blocks;
+		if (end <= fast_blocks) {
+			break;
+		}
+		slots--;
+	}
+
+	if (slots == 0) {
+		SPDK_ERRLOG("Fast bdev %s is too small\n", spdk_bdev_get_name(tier->fast_bdev));
+		return -ENOSPC;
+	}
+
+	tier->num_slots = slots;
+	tier->md_offset = 1;
+	tier->data_offset = tier_data_offset(tier, slots);
+
+	return 0;
+}
+
+static bool
+tier_sb_is_valid(struct tier_sb *sb)
+{
+	uint32_t crc = sb->crc;
+	bool valid;
+
+	if (memcmp(sb->signature, TIER_SB_SIGNATURE, sizeof(sb->signature)) != 0) {
+		return false;
+	}
+
+	sb->crc = 0;
+	valid = spdk_crc32c_update(sb, sizeof(*sb), 0) == crc;
+	sb->crc = crc;
+
+	return valid && sb->version == TIER_SB_VERSION;
+}
+
+static int
+tier_sb_load(struct vbdev_tier *tier, const struct tier_sb *sb)
+{
+	uint64_t fast_blocks = spdk_bdev_get_num_blocks(tier->fast_bdev);
+	uint32_t extent_blocks = sb->extent_size / tier->bdev.blocklen;
+
+	if (sb->block_size != tier->bdev.blocklen || !spdk_u32_is_pow2(sb->extent_size) ||
+	    sb->extent_size < TIER_MD_BLOCK_SIZE ||
+	    sb->extent_size > TIER_EXTENT_SIZE_KB_MAX * 1024 || sb->num_slots == 0 ||
+	    sb->md_offset != 1 || sb->data_offset % extent_blocks != 0 ||
+	    sb->data_offset > fast_blocks ||
+	    (uint64_t)sb->num_slots * extent_blocks > fast_blocks - sb->data_offset) {
+		SPDK_ERRLOG("Invalid superblock on fast bdev %s\n",
+			    spdk_bdev_get_name(tier->fast_bdev));
+		return -EINVAL;
+	}
+
+	tier->extent_size = sb->extent_size;
+	tier->extent_blocks = extent_blocks;
+	tier->num_extents = spdk_divide_round_up(tier->bdev.blockcnt, extent_blocks);
+	tier->num_slots = sb->num_slots;
+	tier->md_offset = sb->md_offset;
+	tier->data_offset = sb->data_offset;
+
+	if (sb->data_offset < tier_data_offset(tier, sb->num_slots) ||
+	    tier->num_extents > TIER_EXTENTS_MAX) {
+		SPDK_ERRLOG("Invalid superblock on fast bdev %s\n",
+			    spdk_bdev_get_name(tier->fast_bdev));
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void
+tier_create_stopped(struct vbdev_tier *tier)
+{
+	struct tier_create_ctx *ctx = tier->create_ctx;
+
+	ctx->cb_fn(ctx->cb_arg, NULL, ctx->status);
+
+	tier_free(tier);
+	free(ctx);
+}
+
+static void
+tier_create_fail(struct tier_create_ctx *ctx, int status)
+{
+	ctx->status = status;
+
+	if (ctx->ch != NULL) {
+		spdk_put_io_channel(ctx->ch);
+		ctx->ch = NULL;
+	}
+	spdk_free(ctx->sb);
+	ctx->sb = NULL;
+
+	tier_stop_md_thread(ctx->tier, tier_create_stopped);
+}
+
+static const struct spdk_bdev_fn_table vbdev_tier_fn_table;
+
+static void
+tier_create_register(struct tier_create_ctx *ctx)
+{
+	struct vbdev_tier *tier = ctx->tier;
+	int rc;
+
+	tier->bdev.product_name = "tier";
+	tier->bdev.write_cache = tier->fast_bdev->write_cache || tier->capacity_bdev->write_cache;
+	tier->bdev.required_alignment = spdk_max(tier->fast_bdev->required_alignment,
+				       tier->capacity_bdev->required_alignment);
+	tier->bdev.optimal_io_boundary = tier->extent_blocks;
+	tier->bdev.split_on_optimal_io_boundary = true;
+	tier->bdev.ctxt = tier;
+	tier->bdev.fn_table = &vbdev_tier_fn_table;
+	tier->bdev.module = &tier_if;
+
+	spdk_io_device_register(tier, tier_bdev_ch_create_cb, tier_bdev_ch_destroy_cb,
+				sizeof(struct tier_io_channel), tier->bdev.name);
+
+	rc = spdk_bdev_register(&tier->bdev);
+	if (rc != 0) {
+		SPDK_ERRLOG("could not register tier bdev %s\n", tier->bdev.name);
+		spdk_io_device_unregister(tier, NULL);
+		tier_create_fail(ctx, rc);
+		return;
+	}
+
+	TAILQ_INSERT_TAIL(&g_tier_nodes, tier, link);
+	tier->create_ctx = NULL;
+
+	ctx->cb_fn(ctx->cb_arg, &tier->bdev, 0);
+	free(ctx);
+}
+
+static void
+tier_create_md_thread_started(void *arg)
+{
+	struct vbdev_tier *tier = arg;
+	struct tier_create_ctx *ctx = tier->create_ctx;
+
+	if (tier->start_status != 0) {
+		tier_create_fail(ctx, tier->start_status);
+		return;
+	}
+
+	tier_create_register(ctx);
+}
+
+static void
+tier_md_thread_start(void *arg)
+{
+	struct vbdev_tier *tier = arg;
+
+	tier->fast_ch = spdk_bdev_get_io_channel(tier->fast_desc);
+	tier->md_writer.ch = tier->fast_ch;
+	tier->capacity_ch = spdk_bdev_get_io_channel(tier->capacity_desc);
+	if (tier->fast_ch == NULL || tier->capacity_ch == NULL) {
+		tier->start_status = -ENOMEM;
+	} else {
+		tier->last_refill_tsc = spdk_get_ticks();
+		tier->migrate_poller = SPDK_POLLER_REGISTER(tier_migrate_poll, tier,
+				       TIER_MIGRATE_POLL_PERIOD_US);
+	}
+
+	spdk_thread_send_msg(tier->thread, tier_create_md_thread_started, tier);
+}
+
+static void
+tier_create_start_md_thread(struct tier_create_ctx *ctx)
+{
+	struct vbdev_tier *tier = ctx->tier;
+
+	spdk_put_io_channel(ctx->ch);
+	ctx->ch = NULL;
+	spdk_free(ctx->sb);
+	ctx->sb = NULL;
+
+	tier->md_thread = spdk_thread_create(tier->bdev.name, NULL);
+	if (tier->md_thread == NULL) {
+		SPDK_ERRLOG("Failed to create thread %s\n", tier->bdev.name);
+		tier_create_fail(ctx, -ENOMEM);
+		return;
+	}
+
+	spdk_thread_send_msg(tier->md_thread, tier_md_thread_start, tier);
+}
+
+static void
+tier_create_write_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct tier_create_ctx *ctx = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to write the superblock of %s\n", ctx->tier->bdev.name);
+		tier_create_fail(ctx, -EIO);
+		return;
+	}
+
+	tier_create_start_md_thread(ctx);
+}
+
+static void
+tier_create_write_sb(struct tier_create_ctx *ctx)
+{
+	struct vbdev_tier *tier = ctx->tier;
+	struct tier_sb *sb = ctx->sb;
+	int rc;
+
+	memset(sb, 0, TIER_MD_BLOCK_SIZE);
+	memcpy(sb->signature, TIER_SB_SIGNATURE, sizeof(sb->signature));
+	sb->version = TIER_SB_VERSION;
+	spdk_uuid_copy(&sb->uuid, &tier->bdev.uuid);
+	spdk_uuid_copy(&sb->capacity_uuid, &tier->capacity_bdev->uuid);
+	sb->block_size = tier->bdev.blocklen;
+	sb->extent_size = tier->extent_size;
+	sb->num_slots = tier->num_slots;
+	sb->md_offset = tier->md_offset;
+	sb->data_offset = tier->data_offset;
+	sb->crc = spdk_crc32c_update(sb, sizeof(*sb), 0);
+
+	rc = spdk_bdev_write_blocks(tier->fast_desc, ctx->ch, sb, 0, tier->md_base_blocks,
+				    tier_create_write_sb_done, ctx);
+	if (rc != 0) {
+		tier_create_fail(ctx, rc);
+	}
+}
+
+static void
+tier_create_md_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct tier_create_ctx *ctx = cb_arg;
+	struct vbdev_tier *tier = ctx->tier;
+	uint64_t num_invalid;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to %s the remap table of %s\n", ctx->write_md ? "write" : "read",
+			    tier->bdev.name);
+		tier_create_fail(ctx, -EIO);
+		return;
+	}
+
+	if (ctx->write_md) {
+		/* The remap table is written before the superblock, so that a valid superblock
+		 * never comes with a stale remap table.
+		 */
+		if (ctx->load) {
+			tier_create_start_md_thread(ctx);
+		} else {
+			tier_create_write_sb(ctx);
+		}
+		return;
+	}
+
+	num_invalid = tier_rebuild(tier);
+	SPDK_NOTICELOG("%s: %" PRIu32 " extents recovered on %s\n", tier->bdev.name,
+		       tier->num_used_slots, spdk_bdev_get_name(tier->fast_bdev));
+	if (num_invalid == 0) {
+		tier_create_start_md_thread(ctx);
+		return;
+	}
+
+	/* Clear the invalid entries on disk too, their slots may be reused */
+	SPDK_WARNLOG("%s: %" PRIu64 " invalid remap table entries cleared\n", tier->bdev.name,
+		     num_invalid);
+	ctx->write_md = true;
+	rc = spdk_bdev_write_blocks(tier->fast_desc, ctx->ch, tier->slots,
+				    tier->md_offset * tier->md_base_blocks,
+				    tier->md_writer.num_blocks * tier->md_base_blocks,
+				    tier_create_md_io_done, ctx);
+	if (rc != 0) {
+		tier_create_fail(ctx, rc);
+	}
+}
+
+static void
+tier_create_read_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct tier_create_ctx *ctx = cb_arg;
+	struct vbdev_tier *tier = ctx->tier;
+	struct tier_sb *sb = ctx->sb;
+	uint32_t extent_size = tier->extent_size;
+	uint64_t offset_blocks, num_blocks;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to read the superblock of %s\n", tier->bdev.name);
+		tier_create_fail(ctx, -EIO);
+		return;
+	}
+
+	if (tier_sb_is_valid(sb)) {
+		if (spdk_uuid_compare(&sb->capacity_uuid, &tier->capacity_bdev->uuid) != 0 ||
+		    (!spdk_uuid_is_null(&tier->bdev.uuid) &&
+		     spdk_uuid_compare(&sb->uuid, &tier->bdev.uuid) != 0)) {
+			SPDK_ERRLOG("Fast bdev %s holds the extents of another tier vbdev\n",
+				    spdk_bdev_get_name(tier->fast_bdev));
+			tier_create_fail(ctx, -EEXIST);
+			return;
+		}
+
+		rc = tier_sb_load(tier, sb);
+		if (rc != 0) {
+			tier_create_fail(ctx, rc);
+			return;
+		}
+		if (extent_size != sb->extent_size) {
+			SPDK_NOTICELOG("%s: using the extent size (%" PRIu32 " KiB) of the existing "
+				       "tier vbdev\n", tier->bdev.name, sb->extent_size / 1024);
+		}
+		spdk_uuid_copy(&tier->bdev.uuid, &sb->uuid);
+		ctx->load = true;
+	} else {
+		rc = tier_calc_layout(tier);
+		if (rc != 0) {
+			tier_create_fail(ctx, rc);
+			return;
+		}
+		if (spdk_uuid_is_null(&tier->bdev.uuid)) {
+			spdk_uuid_copy(&tier->bdev.uuid, &ctx->uuid);
+		}
+		ctx->write_md = true;
+	}
+
+	rc = tier_alloc_md(tier);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to allocate the metadata of %s\n", tier->bdev.name);
+		tier_create_fail(ctx, rc);
+		return;
+	}
+
+	if (!ctx->load) {
+		/* All the slots of the new remap table are free */
+		tier_rebuild(tier);
+	}
+
+	tier->decay_per_poll = spdk_divide_round_up(tier->num_extents * TIER_MIGRATE_POLL_PERIOD_US,
+			       (uint64_t)tier->decay_period_ms * 1000);
+	tier->decay_per_poll = spdk_min(tier->decay_per_poll, tier->num_extents);
+
+	SPDK_DEBUGLOG(vbdev_tier, "%s: %" PRIu64 " extents of %" PRIu32 " KiB, %" PRIu32
+		      " slots at block %" PRIu64 "\n", tier->bdev.name, tier->num_extents,
+		      tier->extent_size / 1024, tier->num_slots, tier->data_offset);
+
+	/* The remap table is small enough to be read or written at once */
+	offset_blocks = tier->md_offset * tier->md_base_blocks;
+	num_blocks = tier->md_writer.num_blocks * tier->md_base_blocks;
+	if (ctx->write_md) {
+		rc = spdk_bdev_write_blocks(tier->fast_desc, ctx->ch, tier->slots, offset_blocks,
+					    num_blocks, tier_create_md_io_done, ctx);
+	} else {
+		rc = spdk_bdev_read_blocks(tier->fast_desc, ctx->ch, tier->slots, offset_blocks,
+					   num_blocks, tier_create_md_io_done, ctx);
+	}
+	if (rc != 0) {
+		tier_create_fail(ctx, rc);
+	}
+}
+
+static void
+tier_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+			void *event_ctx)
+{
+	struct vbdev_tier *tier, *tmp;
+
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		TAILQ_FOREACH_SAFE(tier, &g_tier_nodes, link, tmp) {
+			if (tier->fast_bdev == bdev || tier->capacity_bdev == bdev) {
+				spdk_bdev_unregister(&tier->bdev, NULL, NULL);
+			}
+		}
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+void
+vbdev_tier_get_default_opts(struct vbdev_tier_opts *opts)
+{
+	memset(opts, 0, sizeof(*opts));
+	opts->extent_size_kb = TIER_EXTENT_SIZE_KB_DEFAULT;
+	opts->migration_bw_mbps = TIER_MIGRATION_BW_MBPS_DEFAULT;
+	opts->promote_threshold = TIER_PROMOTE_THRESHOLD_DEFAULT;
+	opts->decay_period_ms = TIER_DECAY_PERIOD_MS_DEFAULT;
+}
+
+static int
+tier_open_base_bdev(const char *name, struct spdk_bdev_desc **desc, bool *claimed)
+{
+	int rc;
+
+	rc = spdk_bdev_open_ext(name, true, tier_base_bdev_event_cb, NULL, desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("could not open bdev %s: %s\n", name, spdk_strerror(-rc));
+		return rc;
+	}
+
+	rc = spdk_bdev_module_claim_bdev(spdk_bdev_desc_get_bdev(*desc), *desc, &tier_if);
+	if (rc != 0) {
+		SPDK_ERRLOG("could not claim bdev %s\n", name);
+		return rc;
+	}
+	*claimed = true;
+
+	return 0;
+}
+
+int
+vbdev_tier_create(const struct vbdev_tier_opts *opts, vbdev_tier_create_cb cb_fn, void *cb_arg)
+{
+	struct vbdev_tier *tier;
+	struct tier_create_ctx *ctx;
+	struct spdk_uuid ns_uuid;
+	uint32_t blocklen;
+	int rc;
+
+	if (opts->name == NULL || opts->fast_bdev_name == NULL || opts->capacity_bdev_name == NULL) {
+		return -EINVAL;
+	}
+	if (!spdk_u32_is_pow2(opts->extent_size_kb) || opts->extent_size_kb < 4 ||
+	    opts->extent_size_kb > TIER_EXTENT_SIZE_KB_MAX) {
+		SPDK_ERRLOG("Extent size must be a power of 2 between 4 and %u KiB\n",
+			    TIER_EXTENT_SIZE_KB_MAX);
+		return -EINVAL;
+	}
+	if (opts->promote_threshold == 0 || opts->promote_threshold > TIER_HEAT_MAX ||
+	    opts->decay_period_ms == 0) {
+		SPDK_ERRLOG("Promotion threshold must be between 1 and %u, decay period not 0\n",
+			    TIER_HEAT_MAX);
+		return -EINVAL;
+	}
+	if (spdk_bdev_get_by_name(opts->name) != NULL) {
+		SPDK_ERRLOG("Bdev %s already exists\n", opts->name);
+		return -EEXIST;
+	}
+
+	tier = calloc(1, sizeof(*tier));
+	ctx = calloc(1, sizeof(*ctx));
+	if (tier == NULL || ctx == NULL) {
+		free(tier);
+		free(ctx);
+		return -ENOMEM;
+	}
+
+	tier->bdev.name = strdup(opts->name);
+	if (tier->bdev.name == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	rc = tier_open_base_bdev(opts->fast_bdev_name, &tier->fast_desc, &tier->fast_claimed);
+	if (rc != 0) {
+		goto err;
+	}
+	tier->fast_bdev = spdk_bdev_desc_get_bdev(tier->fast_desc);
+
+	rc = tier_open_base_bdev(opts->capacity_bdev_name, &tier->capacity_desc,
+				 &tier->capacity_claimed);
+	if (rc != 0) {
+		goto err;
+	}
+	tier->capacity_bdev = spdk_bdev_desc_get_bdev(tier->capacity_desc);
+
+	blocklen = spdk_bdev_get_block_size(tier->capacity_bdev);
+	if (spdk_bdev_get_block_size(tier->fast_bdev) != blocklen) {
+		SPDK_ERRLOG("Fast and capacity bdevs must have the same block size\n");
+		rc = -EINVAL;
+		goto err;
+	}
+	if (!spdk_u32_is_pow2(blocklen) || blocklen > TIER_MD_BLOCK_SIZE) {
+		SPDK_ERRLOG("Block size of the base bdevs must divide %u\n", TIER_MD_BLOCK_SIZE);
+		rc = -EINVAL;
+		goto err;
+	}
+	if (spdk_bdev_get_md_size(tier->fast_bdev) != 0 ||
+	    spdk_bdev_get_md_size(tier->capacity_bdev) != 0) {
+		SPDK_ERRLOG("Bdevs with metadata are not supported\n");
+		rc = -ENOTSUP;
+		goto err;
+	}
+
+	tier->bdev.blocklen = blocklen;
+	tier->bdev.blockcnt = spdk_bdev_get_num_blocks(tier->capacity_bdev);
+	tier->extent_size = opts->extent_size_kb * 1024;
+	tier->extent_blocks = tier->extent_size / blocklen;
+	tier->num_extents = spdk_divide_round_up(tier->bdev.blockcnt, tier->extent_blocks);
+	if (tier->num_extents > TIER_EXTENTS_MAX) {
+		SPDK_ERRLOG("Capacity bdev %s has too many extents, use a larger extent size\n",
+			    opts->capacity_bdev_name);
+		rc = -EINVAL;
+		goto err;
+	}
+
+	if (spdk_uuid_is_null(&opts->uuid)) {
+		/* Generate UUID based on namespace UUID + capacity bdev UUID, unless the fast bdev
+		 * already holds a tier vbdev, whose UUID is used then.
+		 */
+		spdk_uuid_parse(&ns_uuid, BDEV_TIER_NAMESPACE_UUID);
+		rc = spdk_uuid_generate_sha1(&ctx->uuid, &ns_uuid,
+					     (const char *)&tier->capacity_bdev->uuid,
+					     sizeof(struct spdk_uuid));
+		if (rc != 0) {
+			goto err;
+		}
+	} else {
+		spdk_uuid_copy(&tier->bdev.uuid, &opts->uuid);
+	}
+
+	tier->thread = spdk_get_thread();
+	tier->md_base_blocks = TIER_MD_BLOCK_SIZE / blocklen;
+	tier->promote_threshold = opts->promote_threshold;
+	tier->decay_period_ms = opts->decay_period_ms;
+	tier->migration_bw_mbps = opts->migration_bw_mbps;
+	tier->migration_bw_bytes = (uint64_t)opts->migration_bw_mbps * 1024 * 1024;
+	tier->buf_align = spdk_max(spdk_max(spdk_bdev_get_buf_align(tier->fast_bdev),
+					    spdk_bdev_get_buf_align(tier->capacity_bdev)), 0x1000);
+	tier->create_ctx = ctx;
+
+	ctx->tier = tier;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	ctx->ch = spdk_bdev_get_io_channel(tier->fast_desc);
+	if (ctx->ch == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	ctx->sb = spdk_zmalloc(TIER_MD_BLOCK_SIZE, tier->buf_align, NULL, SPDK_ENV_LCORE_ID_ANY,
+			       SPDK_MALLOC_DMA);
+	if (ctx->sb == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	rc = spdk_bdev_read_blocks(tier->fast_desc, ctx->ch, ctx->sb, 0, tier->md_base_blocks,
+				   tier_create_read_sb_done, ctx);
+	if (rc != 0) {
+		goto err;
+	}
+
+	return 0;
+err:
+	if (ctx->ch != NULL) {
+		spdk_put_io_channel(ctx->ch);
+	}
+	spdk_free(ctx->sb);
+	free(ctx);
+	tier_free(tier);
+	return rc;
+}
+
+static void
+tier_destruct_stopped(struct vbdev_tier *tier)
+{
+	tier_close_base_bdevs(tier);
+	spdk_bdev_destruct_done(&tier->bdev, 0);
+	tier_free(tier);
+}
+
+static void
+_tier_destruct(void *ctx)
+{
+	tier_stop_md_thread(ctx, tier_destruct_stopped);
+}
+
+static void
+tier_io_device_unregister_cb(void *io_device)
+{
+	struct vbdev_tier *tier = io_device;
+
+	/* The base bdevs have to be closed on the thread they were opened on */
+	if (tier->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(tier->thread, _tier_destruct, tier);
+	} else {
+		_tier_destruct(tier);
+	}
+}
+
+static int
+vbdev_tier_destruct(void *ctx)
+{
+	struct vbdev_tier *tier = ctx;
+
+	TAILQ_REMOVE(&g_tier_nodes, tier, link);
+	spdk_io_device_unregister(tier, tier_io_device_unregister_cb);
+
+	/* Wait for the metadata thread to stop */
+	return 1;
+}
+
+void
+vbdev_tier_delete(const char *name, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	int rc;
+
+	rc = spdk_bdev_unregister_by_name(name, &tier_if, cb_fn, cb_arg);
+	if (rc != 0) {
+		cb_fn(cb_arg, rc);
+	}
+}
+
+static void
+tier_write_conf_values(struct vbdev_tier *tier, struct spdk_json_write_ctx *w)
+{
+	spdk_json_write_named_string(w, "name", tier->bdev.name);
+	spdk_json_write_named_string(w, "fast_bdev_name", spdk_bdev_get_name(tier->fast_bdev));
+	spdk_json_write_named_string(w, "capacity_bdev_name",
+				     spdk_bdev_get_name(tier->capacity_bdev));
+	spdk_json_write_named_uuid(w, "uuid", &tier->bdev.uuid);
+	spdk_json_write_named_uint32(w, "extent_size_kb", tier->extent_size / 1024);
+	spdk_json_write_named_uint32(w, "migration_bw_mbps", tier->migration_bw_mbps);
+	spdk_json_write_named_uint32(w, "promote_threshold", tier->promote_threshold);
+	spdk_json_write_named_uint32(w, "decay_period_ms", tier->decay_period_ms);
+}
+
+static int
+vbdev_tier_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_tier *tier = ctx;
+
+	/* The counters belong to the metadata thread, they are only approximate here */
+	spdk_json_write_named_object_begin(w, "tier");
+	tier_write_conf_values(tier, w);
+	spdk_json_write_named_uint64(w, "num_extents", tier->num_extents);
+	spdk_json_write_named_uint32(w, "num_slots", tier->num_slots);
+	spdk_json_write_named_uint32(w, "used_slots", tier->num_used_slots);
+	spdk_json_write_named_uint32(w, "dirty_slots", tier->num_dirty_slots);
+	spdk_json_write_named_object_begin(w, "stats");
+	spdk_json_write_named_uint64(w, "fast_ios",
+				     __atomic_load_n(&tier->stats.fast_ios, __ATOMIC_RELAXED));
+	spdk_json_write_named_uint64(w, "capacity_ios",
+				     __atomic_load_n(&tier->stats.capacity_ios, __ATOMIC_RELAXED));
+	spdk_json_write_named_uint64(w, "promotions", tier->stats.promotions);
+	spdk_json_write_named_uint64(w, "demotions", tier->stats.demotions);
+	spdk_json_write_named_uint64(w, "migrated_bytes", tier->stats.migrated_bytes);
+	spdk_json_write_named_uint64(w, "failed_migrations", tier->stats.failed_migrations);
+	spdk_json_write_object_end(w);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+/* This is used to generate JSON that can configure this module to its current state. */
+static int
+vbdev_tier_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_tier *tier;
+
+	TAILQ_FOREACH(tier, &g_tier_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_tier_create");
+		spdk_json_write_named_object_begin(w, "params");
+		tier_write_conf_values(tier, w);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+
+	return 0;
+}
+
+static void
+vbdev_tier_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+	/* No config per bdev needed */
+}
+
+static const struct spdk_bdev_fn_table vbdev_tier_fn_table = {
+	.destruct		= vbdev_tier_destruct,
+	.submit_request		= vbdev_tier_submit_request,
+	.io_type_supported	= vbdev_tier_io_type_supported,
+	.get_io_channel		= vbdev_tier_get_io_channel,
+	.dump_info_json		= vbdev_tier_dump_info_json,
+	.write_config_json	= vbdev_tier_write_config_json,
+};
+
+static int
+vbdev_tier_init(void)
+{
+	return 0;
+}
+
+static int
+vbdev_tier_get_ctx_size(void)
+{
+	return sizeof(struct tier_bdev_io);
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_tier)
@@ -0,0 +1,66 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_VBDEV_TIER_H
+#define SPDK_VBDEV_TIER_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+struct vbdev_tier_opts {
+	/* Name of the tier vbdev */
+	const char *name;
+	/* Name of the fast bdev that holds the hot extents and the metadata */
+	const char *fast_bdev_name;
+	/* Name of the capacity bdev, which has the size of the tier vbdev */
+	const char *capacity_bdev_name;
+	/* UUID of the tier vbdev, generated from the capacity bdev's if null */
+	struct spdk_uuid uuid;
+	/* Size of the extents moved between the bdevs, a power of 2 */
+	uint32_t extent_size_kb;
+	/* Bandwidth used to move extents between the bdevs, 0 disables the migrations */
+	uint32_t migration_bw_mbps;
+	/* Heat an extent must reach to be promoted to the fast bdev */
+	uint32_t promote_threshold;
+	/* The heat of the extents is halved once per period */
+	uint32_t decay_period_ms;
+};
+
+/**
+ * Fill the tier vbdev options with the default values.
+ *
+ * \param opts Options to initialize.
+ */
+void vbdev_tier_get_default_opts(struct vbdev_tier_opts *opts);
+
+typedef void (*vbdev_tier_create_cb)(void *cb_arg, struct spdk_bdev *bdev, int rc);
+
+/**
+ * Create a tier vbdev. If the fast bdev holds the metadata of a previous tier vbdev created
+ * for the same capacity bdev, the extents it holds are recovered and the geometry stored in
+ * the metadata is used instead of the one in opts.
+ *
+ * \param opts Options of the tier vbdev.
+ * \param cb_fn Function to call when the tier vbdev is registered or its creation failed.
+ * \param cb_arg Argument to pass to cb_fn.
+ * \return 0 if the creation was started, negative errno otherwise. cb_fn is not called
+ * if this function fails.
+ */
+int vbdev_tier_create(const struct vbdev_tier_opts *opts, vbdev_tier_create_cb cb_fn,
+		      void *cb_arg);
+
+/**
+ * Delete a tier vbdev. The extents on the fast bdev stay there and are recovered when the
+ * tier vbdev is created again.
+ *
+ * \param name Name of the tier vbdev.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void vbdev_tier_delete(const char *name, spdk_bdev_unregister_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_TIER_H */
@@ -0,0 +1,158 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_tier.h"
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/string.h"
+#include "spdk/log.h"
+
+struct rpc_construct_tier {
+	char *name;
+	char *fast_bdev_name;
+	char *capacity_bdev_name;
+	struct spdk_uuid uuid;
+	uint32_t extent_size_kb;
+	uint32_t migration_bw_mbps;
+	uint32_t promote_threshold;
+	uint32_t decay_period_ms;
+	struct spdk_jsonrpc_request *request;
+};
+
+static void
+free_rpc_construct_tier(struct rpc_construct_tier *r)
+{
+	free(r->name);
+	free(r->fast_bdev_name);
+	free(r->capacity_bdev_name);
+	free(r);
+}
+
+static const struct spdk_json_object_decoder rpc_construct_tier_decoders[] = {
+	{"name", offsetof(struct rpc_construct_tier, name), spdk_json_decode_string},
+	{"fast_bdev_name", offsetof(struct rpc_construct_tier, fast_bdev_name), spdk_json_decode_string},
+	{"capacity_bdev_name", offsetof(struct rpc_construct_tier, capacity_bdev_name), spdk_json_decode_string},
+	{"uuid", offsetof(struct rpc_construct_tier, uuid), spdk_json_decode_uuid, true},
+	{"extent_size_kb", offsetof(struct rpc_construct_tier, extent_size_kb), spdk_json_decode_uint32, true},
+	{"migration_bw_mbps", offsetof(struct rpc_construct_tier, migration_bw_mbps), spdk_json_decode_uint32, true},
+	{"promote_threshold", offsetof(struct rpc_construct_tier, promote_threshold), spdk_json_decode_uint32, true},
+	{"decay_period_ms", offsetof(struct rpc_construct_tier, decay_period_ms), spdk_json_decode_uint32, true},
+};
+
+static void
+rpc_bdev_tier_create_cb(void *cb_arg, struct spdk_bdev *bdev, int rc)
+{
+	struct rpc_construct_tier *req = cb_arg;
+	struct spdk_json_write_ctx *w;
+
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(req->request, rc, spdk_strerror(-rc));
+	} else {
+		w = spdk_jsonrpc_begin_result(req->request);
+		spdk_json_write_string(w, spdk_bdev_get_name(bdev));
+		spdk_jsonrpc_end_result(req->request, w);
+	}
+
+	free_rpc_construct_tier(req);
+}
+
+static void
+rpc_bdev_tier_create(struct spdk_jsonrpc_request *request,
+		     const struct spdk_json_val *params)
+{
+	struct rpc_construct_tier *req;
+	struct vbdev_tier_opts opts;
+	int rc;
+
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	vbdev_tier_get_default_opts(&opts);
+	req->extent_size_kb = opts.extent_size_kb;
+	req->migration_bw_mbps = opts.migration_bw_mbps;
+	req->promote_threshold = opts.promote_threshold;
+	req->decay_period_ms = opts.decay_period_ms;
+	req->request = request;
+
+	if (spdk_json_decode_object(params, rpc_construct_tier_decoders,
+				    SPDK_COUNTOF(rpc_construct_tier_decoders),
+				    req)) {
+		SPDK_DEBUGLOG(vbdev_tier, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	opts.name = req->name;
+	opts.fast_bdev_name = req->fast_bdev_name;
+	opts.capacity_bdev_name = req->capacity_bdev_name;
+	spdk_uuid_copy(&opts.uuid, &req->uuid);
+	opts.extent_size_kb = req->extent_size_kb;
+	opts.migration_bw_mbps = req->migration_bw_mbps;
+	opts.promote_threshold = req->promote_threshold;
+	opts.decay_period_ms = req->decay_period_ms;
+
+	rc = vbdev_tier_create(&opts, rpc_bdev_tier_create_cb, req);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	return;
+
+cleanup:
+	free_rpc_construct_tier(req);
+}
+SPDK_RPC_REGISTER("bdev_tier_create", rpc_bdev_tier_create, SPDK_RPC_RUNTIME)
+
+struct rpc_delete_tier {
+	char *name;
+};
+
+static void
+free_rpc_delete_tier(struct rpc_delete_tier *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_delete_tier_decoders[] = {
+	{"name", offsetof(struct rpc_delete_tier, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_tier_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (bdeverrno == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, bdeverrno, spdk_strerror(-bdeverrno));
+	}
+}
+
+static void
+rpc_bdev_tier_delete(struct spdk_jsonrpc_request *request,
+		     const struct spdk_json_val *params)
+{
+	struct rpc_delete_tier req = {NULL};
+
+	if (spdk_json_decode_object(params, rpc_delete_tier_decoders,
+				    SPDK_COUNTOF(rpc_delete_tier_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	vbdev_tier_delete(req.name, rpc_bdev_tier_delete_cb, request);
+
+cleanup:
+	free_rpc_delete_tier(&req);
+}
+SPDK_RPC_REGISTER("bdev_tier_delete", rpc_bdev_tier_delete, SPDK_RPC_RUNTIME)
@@ -33,6 +33,7 @@
 
 #define MAX_TMPBUF 1024
 #define PORTNUMLEN 32
+#define DEFAULT_FLUSH_BATCH_BYTES (64 * 1024)
 
 #if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
 #define SPDK_ZEROCOPY
@@ -53,6 +54,11 @@ struct spdk_posix_sock {
 
 	int			placement_id;
 
+	/* Requests queued since batch_start_tsc are sent together, see posix_sock_flush_is_due() */
+	uint64_t		batch_start_tsc;
+	uint64_t		batch_bytes;
+	uint64_t		batch_timeout_ticks;
+
 	SSL_CTX			*ctx;
 	SSL			*ssl;
 
@@ -84,7 +90,10 @@ static struct spdk_sock_impl_opts g_posix_impl_opts = {
 	.psk_identity = NULL,
 	.get_key = NULL,
 	.get_key_ctx = NULL,
-	.tls_cipher_suites = NULL
+	.tls_cipher_suites = NULL,
+	.flush_batch_timeout = 0,
+	.flush_batch_iovcnt_threshold = IOV_BATCH_SIZE,
+	.flush_batch_bytes_threshold = DEFAULT_FLUSH_BATCH_BYTES
 };
 
 static struct spdk_sock_impl_opts g_ssl_impl_opts = {
@@ -99,7 +108,10 @@ static struct spdk_sock_impl_opts g_ssl_impl_opts = {
 	.tls_version = 0,
 	.enable_ktls = false,
 	.psk_key = NULL,
-	.psk_identity = NULL
+	.psk_identity = NULL,
+	.flush_batch_timeout = 0,
+	.flush_batch_iovcnt_threshold = IOV_BATCH_SIZE,
+	.flush_batch_bytes_threshold = DEFAULT_FLUSH_BATCH_BYTES
 };
 
 static struct spdk_sock_map g_map = {
@@ -145,6 +157,9 @@ posix_sock_copy_impl_opts(struct spdk_sock_impl_opts *dest, const struct spdk_so
 	SET_FIELD(get_key);
 	SET_FIELD(get_key_ctx);
 	SET_FIELD(tls_cipher_suites);
+	SET_FIELD(flush_batch_timeout);
+	SET_FIELD(flush_batch_iovcnt_threshold);
+	SET_FIELD(flush_batch_bytes_threshold);
 
 #undef SET_FIELD
 #undef FIELD_OK
@@ -464,6 +479,9 @@ posix_sock_init(struct spdk_posix_sock *sock, bool enable_zero_copy)
 		spdk_sock_map_insert(&g_map, sock->placement_id, NULL);
 	}
 #endif
+
+	sock->batch_timeout_ticks = (uint64_t)sock->base.impl_opts.flush_batch_timeout *
+				    spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
 }
 
 static struct spdk_posix_sock *
@@ -519,6 +537,14 @@ posix_fd_create(struct addrinfo *res, struct spdk_sock_opts *opts,
 		/* error */
 		return -1;
 	}
+	if (opts->reuseport) {
+		rc = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &val, sizeof val);
+		if (rc != 0) {
+			close(fd);
+			/* error */
+			return -1;
+		}
+	}
 	rc = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof val);
 	if (rc != 0) {
 		close(fd);
@@ -1370,6 +1396,9 @@ _sock_flush(struct spdk_sock *sock)
 
 	sent = rc;
 
+	spdk_sock_tally_flush(sock, sent);
+	psock->batch_bytes -= spdk_min((uint64_t)sent, psock->batch_bytes);
+
 	if (is_zcopy) {
 		/* Handling overflow case, because we use psock->sendmsg_idx - 1 for the
 		 * req->internal.offset, so sendmsg_idx should not be zero  */
@@ -1661,7 +1690,19 @@ posix_sock_recv_next(struct spdk_sock *_sock, void **buf, void **ctx)
 static void
 posix_sock_writev_async(struct spdk_sock *sock, struct spdk_sock_request *req)
 {
-	int rc;
+	struct spdk_posix_sock *psock = __posix_sock(sock);
+	int rc, i;
+
+	if (psock->batch_timeout_ticks != 0) {
+		if (TAILQ_EMPTY(&sock->queued_reqs)) {
+			psock->batch_start_tsc = spdk_get_ticks();
+			psock->batch_bytes = 0;
+		}
+
+		for (i = 0; i < req->iovcnt; i++) {
+			psock->batch_bytes += SPDK_SOCK_REQUEST_IOV(req, i)->iov_len;
+		}
+	}
 
 	spdk_sock_request_queue(sock, req);
 
@@ -1959,6 +2000,23 @@ posix_sock_group_impl_remove_sock(struct spdk_sock_group_impl *_group, struct sp
 	return rc;
 }
 
+/* Check whether the requests queued to a socket in a group should be sent now, or can wait
+ * to be sent together with requests queued later.
+ */
+static bool
+posix_sock_flush_is_due(struct spdk_sock *sock, uint64_t now)
+{
+	struct spdk_posix_sock *psock = __posix_sock(sock);
+
+	if (psock->batch_timeout_ticks == 0 || TAILQ_EMPTY(&sock->queued_reqs)) {
+		return true;
+	}
+
+	return (uint32_t)sock->queued_iovcnt >= sock->impl_opts.flush_batch_iovcnt_threshold ||
+	       psock->batch_bytes >= sock->impl_opts.flush_batch_bytes_threshold ||
+	       now - psock->batch_start_tsc >= psock->batch_timeout_ticks;
+}
+
 static int
 posix_sock_group_impl_poll(struct spdk_sock_group_impl *_group, int max_events,
 			   struct spdk_sock **socks)
@@ -1967,6 +2025,7 @@ posix_sock_group_impl_poll(struct spdk_sock_group_impl *_group, int max_events,
 	struct spdk_sock *sock, *tmp;
 	int num_events, i, rc;
 	struct spdk_posix_sock *psock, *ptmp;
+	uint64_t now;
 #if defined(SPDK_EPOLL)
 	struct epoll_event events[MAX_EVENTS_PER_POLL];
 #elif defined(SPDK_KEVENT)
@@ -2022,7 +2081,12 @@ posix_sock_group_impl_poll(struct spdk_sock_group_impl *_group, int max_events,
 	/* This must be a TAILQ_FOREACH_SAFE because while flushing,
 	 * a completion callback could remove the sock from the
 	 * group. */
+	now = spdk_get_ticks();
 	TAILQ_FOREACH_SAFE(sock, &_group->socks, link, tmp) {
+		if (!posix_sock_flush_is_due(sock, now)) {
+			continue;
+		}
+
 		rc = _sock_flush(sock);
 		if (rc < 0 && errno != EAGAIN) {
 			spdk_sock_abort_requests(sock);
@@ -2169,6 +2233,15 @@ ssl_sock_group_impl_close(struct spdk_sock_group_impl *_group)
 	return _sock_group_impl_close(_group, g_ssl_impl_opts.enable_placement_id);
 }
 
+static int
+posix_sock_group_impl_get_interrupt_fd(struct spdk_sock_group_impl *_group)
+{
+	struct spdk_posix_sock_group_impl *group = __posix_group_impl(_group);
+
+	/* The epoll/kqueue fd is readable while any of its sockets has events. */
+	return group->fd;
+}
+
 static struct spdk_net_impl g_posix_net_impl = {
 	.name		= "posix",
 	.getaddr	= posix_sock_getaddr,
@@ -2194,6 +2267,7 @@ static struct spdk_net_impl g_posix_net_impl = {
 	.group_impl_remove_sock = posix_sock_group_impl_remove_sock,
 	.group_impl_poll	= posix_sock_group_impl_poll,
 	.group_impl_close	= posix_sock_group_impl_close,
+	.group_impl_get_interrupt_fd	= posix_sock_group_impl_get_interrupt_fd,
 	.get_opts	= posix_sock_impl_get_opts,
 	.set_opts	= posix_sock_impl_set_opts,
 };
@@ -2243,6 +2317,7 @@ static struct spdk_net_impl g_ssl_net_impl = {
 	.group_impl_remove_sock = posix_sock_group_impl_remove_sock,
 	.group_impl_poll	= posix_sock_group_impl_poll,
 	.group_impl_close	= ssl_sock_group_impl_close,
+	.group_impl_get_interrupt_fd	= posix_sock_group_impl_get_interrupt_fd,
 	.get_opts	= ssl_sock_impl_get_opts,
 	.set_opts	= ssl_sock_impl_set_opts,
 };
@@ -32,12 +32,27 @@ enum uring_task_type {
 	URING_TASK_ERRQUEUE,
 	URING_TASK_WRITE,
 	URING_TASK_CANCEL,
+	URING_TASK_WRITE_ZC,
 };
 
 #if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
 #define SPDK_ZEROCOPY
 #endif
 
+/* Multishot receive and IORING_OP_SEND_ZC need liburing 2.3 or newer. Whether the running
+ * kernel supports them is checked when a poll group is created. */
+#ifdef IORING_RECV_MULTISHOT
+#define SPDK_URING_RECV_MULTISHOT
+#endif
+
+#if defined(SPDK_ZEROCOPY) && defined(IORING_CQE_F_NOTIF)
+#define SPDK_URING_SEND_ZC
+#endif
+
+/* The number of IORING_OP_SENDMSG_ZC requests per socket that may wait for their
+ * notification at the same time. Once all are in use, data is sent by copying. */
+#define URING_SEND_ZC_TASKS 4
+
 /* We don't know how big the buffers that the user posts will be, but this
  * is the maximum we'll ever allow it to receive in a single command.
  * If the user buffers are smaller, it will just receive less. */
@@ -49,6 +64,8 @@ enum uring_task_type {
 
 /* We use 1 just so it's not zero and we can validate it's right. */
 #define URING_BUF_GROUP_ID 1
+/* Buffer group of the receive probing for multishot support */
+#define URING_PROBE_BUF_GROUP_ID 2
 
 enum spdk_uring_sock_task_status {
 	SPDK_URING_SOCK_TASK_NOT_IN_USE = 0,
@@ -64,6 +81,7 @@ struct spdk_uring_task {
 	int					iov_cnt;
 	struct spdk_sock_request		*last_req;
 	bool					is_zcopy;
+	uint32_t				zcopy_idx;
 	STAILQ_ENTRY(spdk_uring_task)		link;
 };
 
@@ -78,6 +96,11 @@ struct spdk_uring_sock {
 	struct spdk_uring_task			errqueue_task;
 	struct spdk_uring_task			read_task;
 	struct spdk_uring_task			cancel_task;
+#ifdef SPDK_URING_SEND_ZC
+	struct spdk_uring_task			zc_tasks[URING_SEND_ZC_TASKS];
+	/* The zc_tasks entry used as user data of the send in flight, if any */
+	struct spdk_uring_task			*write_zc_task;
+#endif
 	struct spdk_pipe			*recv_pipe;
 	void					*recv_buf;
 	int					recv_buf_sz;
@@ -109,6 +132,8 @@ struct spdk_uring_sock_group_impl {
 	uint32_t				io_queued;
 	uint32_t				io_avail;
 	struct pending_recv_list		pending_recv;
+	bool					recv_multishot;
+	bool					send_zc;
 
 	struct io_uring_buf_ring		*buf_ring;
 	uint32_t				buf_ring_count;
@@ -549,6 +574,16 @@ retry:
 			/* error */
 			continue;
 		}
+		if (opts->reuseport) {
+			val = 1;
+			rc = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &val, sizeof val);
+			if (rc != 0) {
+				close(fd);
+				fd = -1;
+				/* error */
+				continue;
+			}
+		}
 		rc = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof val);
 		if (rc != 0) {
 			close(fd);
@@ -834,6 +869,7 @@ uring_sock_recv_next(struct spdk_sock *_sock, void **_buf, void **ctx)
 	struct spdk_uring_sock *sock = __uring_sock(_sock);
 	struct spdk_uring_sock_group_impl *group;
 	struct spdk_uring_buf_tracker *tr;
+	ssize_t len;
 
 	if (sock->connection_status < 0) {
 		errno = -sock->connection_status;
@@ -864,6 +900,8 @@ uring_sock_recv_next(struct spdk_sock *_sock, void **_buf, void **ctx)
 
 	*_buf = tr->buf + sock->recv_offset;
 	*ctx = tr->ctx;
+	len = tr->len - sock->recv_offset;
+	sock->recv_offset = 0;
 
 	STAILQ_REMOVE_HEAD(&sock->recv_stream, link);
 	STAILQ_INSERT_HEAD(&group->free_trackers, tr, link);
@@ -873,7 +911,7 @@ uring_sock_recv_next(struct spdk_sock *_sock, void **_buf, void **ctx)
 		TAILQ_REMOVE(&group->pending_recv, sock, link);
 	}
 
-	return tr->len - sock->recv_offset;
+	return len;
 }
 
 static ssize_t
@@ -1057,6 +1095,8 @@ sock_complete_write_reqs(struct spdk_sock *_sock, ssize_t rc, bool is_zcopy)
 	struct spdk_sock_request *req;
 	int retval;
 
+	spdk_sock_tally_flush(_sock, rc);
+
 	if (is_zcopy) {
 		/* Handling overflow case, because we use psock->sendmsg_idx - 1 for the
 		 * req->internal.offset, so sendmsg_idx should not be zero */
@@ -1105,16 +1145,49 @@ sock_complete_write_reqs(struct spdk_sock *_sock, ssize_t rc, bool is_zcopy)
 }
 
 #ifdef SPDK_ZEROCOPY
+static int
+_sock_complete_zcopy_idx(struct spdk_sock *_sock, uint32_t idx)
+{
+	struct spdk_sock_request *req, *treq;
+	bool found = false;
+	int rc;
+
+	/* Most of the time, the pending_reqs array is in the exact
+	 * order we need such that all of the requests to complete are
+	 * in order, in the front. It is guaranteed that all requests
+	 * belonging to the same sendmsg call are sequential, so once
+	 * we encounter one match we can stop looping as soon as a
+	 * non-match is found.
+	 */
+	TAILQ_FOREACH_SAFE(req, &_sock->pending_reqs, internal.link, treq) {
+		if (!req->internal.is_zcopy) {
+			/* This wasn't a zcopy request. It was just waiting in line to complete */
+			rc = spdk_sock_request_put(_sock, req, 0);
+			if (rc < 0) {
+				return rc;
+			}
+		} else if (req->internal.offset == idx) {
+			found = true;
+			rc = spdk_sock_request_put(_sock, req, 0);
+			if (rc < 0) {
+				return rc;
+			}
+		} else if (found) {
+			break;
+		}
+	}
+
+	return 0;
+}
+
 static int
 _sock_check_zcopy(struct spdk_sock *_sock, int status)
 {
 	struct spdk_uring_sock *sock = __uring_sock(_sock);
-	ssize_t rc;
+	int rc;
 	struct sock_extended_err *serr;
 	struct cmsghdr *cm;
 	uint32_t idx;
-	struct spdk_sock_request *req, *treq;
-	bool found;
 
 	assert(sock->zcopy == true);
 	if (spdk_unlikely(status) < 0) {
@@ -1140,31 +1213,10 @@ _sock_check_zcopy(struct spdk_sock *_sock, int status)
 		return 0;
 	}
 
-	/* Most of the time, the pending_reqs array is in the exact
-	 * order we need such that all of the requests to complete are
-	 * in order, in the front. It is guaranteed that all requests
-	 * belonging to the same sendmsg call are sequential, so once
-	 * we encounter one match we can stop looping as soon as a
-	 * non-match is found.
-	 */
 	for (idx = serr->ee_info; idx <= serr->ee_data; idx++) {
-		found = false;
-		TAILQ_FOREACH_SAFE(req, &_sock->pending_reqs, internal.link, treq) {
-			if (!req->internal.is_zcopy) {
-				/* This wasn't a zcopy request. It was just waiting in line to complete */
-				rc = spdk_sock_request_put(_sock, req, 0);
-				if (rc < 0) {
-					return rc;
-				}
-			} else if (req->internal.offset == idx) {
-				found = true;
-				rc = spdk_sock_request_put(_sock, req, 0);
-				if (rc < 0) {
-					return rc;
-				}
-			} else if (found) {
-				break;
-			}
+		rc = _sock_complete_zcopy_idx(_sock, idx);
+		if (rc < 0) {
+			return rc;
 		}
 	}
 
@@ -1197,11 +1249,30 @@ _sock_prep_errqueue(struct spdk_sock *_sock)
 
 #endif
 
+#ifdef SPDK_URING_SEND_ZC
+static struct spdk_uring_task *
+_sock_get_zc_task(struct spdk_uring_sock *sock)
+{
+	int i;
+
+	for (i = 0; i < URING_SEND_ZC_TASKS; i++) {
+		if (sock->zc_tasks[i].status == SPDK_URING_SOCK_TASK_NOT_IN_USE) {
+			return &sock->zc_tasks[i];
+		}
+	}
+
+	return NULL;
+}
+#endif
+
 static void
 _sock_flush(struct spdk_sock *_sock)
 {
 	struct spdk_uring_sock *sock = __uring_sock(_sock);
 	struct spdk_uring_task *task = &sock->write_task;
+#ifdef SPDK_URING_SEND_ZC
+	struct spdk_uring_task *zc_task = NULL;
+#endif
 	uint32_t iovcnt;
 	struct io_uring_sqe *sqe;
 	int flags;
@@ -1228,14 +1299,33 @@ _sock_flush(struct spdk_sock *_sock)
 	assert(sock->group != NULL);
 	task->msg.msg_iov = task->iovs;
 	task->msg.msg_iovlen = task->iov_cnt;
+#ifdef SPDK_URING_SEND_ZC
+	if ((flags & MSG_ZEROCOPY) && sock->group->send_zc) {
+		/* The completion of the buffers is reported by a notification CQE instead
+		 * of the error queue, so the send must not ask for MSG_ZEROCOPY itself.
+		 * Without a free task to receive the notification, just copy the data. */
+		flags &= ~MSG_ZEROCOPY;
+		zc_task = _sock_get_zc_task(sock);
+	}
+#endif
 #ifdef SPDK_ZEROCOPY
 	task->is_zcopy = (flags & MSG_ZEROCOPY) ? true : false;
 #endif
 	sock->group->io_queued++;
 
 	sqe = io_uring_get_sqe(&sock->group->uring);
-	io_uring_prep_sendmsg(sqe, sock->fd, &sock->write_task.msg, flags);
-	io_uring_sqe_set_data(sqe, task);
+#ifdef SPDK_URING_SEND_ZC
+	if (zc_task != NULL) {
+		io_uring_prep_sendmsg_zc(sqe, sock->fd, &sock->write_task.msg, flags);
+		io_uring_sqe_set_data(sqe, zc_task);
+		zc_task->status = SPDK_URING_SOCK_TASK_IN_PROCESS;
+		sock->write_zc_task = zc_task;
+	} else
+#endif
+	{
+		io_uring_prep_sendmsg(sqe, sock->fd, &sock->write_task.msg, flags);
+		io_uring_sqe_set_data(sqe, task);
+	}
 	task->status = SPDK_URING_SOCK_TASK_IN_PROCESS;
 }
 
@@ -1259,7 +1349,16 @@ _sock_prep_read(struct spdk_sock *_sock)
 	sock->group->io_queued++;
 
 	sqe = io_uring_get_sqe(&sock->group->uring);
-	io_uring_prep_recv(sqe, sock->fd, NULL, URING_MAX_RECV_SIZE, 0);
+#ifdef SPDK_URING_RECV_MULTISHOT
+	if (sock->group->recv_multishot) {
+		/* The request stays armed and posts a CQE for each buffer it fills, until
+		 * it fails or the buffer ring runs out. The length comes from the buffers. */
+		io_uring_prep_recv_multishot(sqe, sock->fd, NULL, 0, 0);
+	} else
+#endif
+	{
+		io_uring_prep_recv(sqe, sock->fd, NULL, URING_MAX_RECV_SIZE, 0);
+	}
 	sqe->buf_group = URING_BUF_GROUP_ID;
 	sqe->flags |= IOSQE_BUFFER_SELECT;
 	io_uring_sqe_set_data(sqe, task);
@@ -1330,13 +1429,17 @@ sock_uring_group_reap(struct spdk_uring_sock_group_impl *group, int max, int max
 		assert(sock != NULL);
 		assert(sock->group != NULL);
 		assert(sock->group == group);
-		sock->group->io_inflight--;
-		sock->group->io_avail++;
 		status = cqe->res;
 		flags = cqe->flags;
 		io_uring_cqe_seen(&group->uring, cqe);
 
-		task->status = SPDK_URING_SOCK_TASK_NOT_IN_USE;
+		/* Multishot receives and zero-copy sends post more than one CQE per
+		 * request. Only the last one releases the request and its task. */
+		if (!(flags & IORING_CQE_F_MORE)) {
+			sock->group->io_inflight--;
+			sock->group->io_avail++;
+			task->status = SPDK_URING_SOCK_TASK_NOT_IN_USE;
+		}
 
 		switch (task->type) {
 		case URING_TASK_READ:
@@ -1413,6 +1516,40 @@ sock_uring_group_reap(struct spdk_uring_sock_group_impl *group, int max, int max
 				_sock_prep_errqueue(&sock->base);
 			}
 			break;
+#endif
+#ifdef SPDK_URING_SEND_ZC
+		case URING_TASK_WRITE_ZC:
+			if (flags & IORING_CQE_F_NOTIF) {
+				/* The kernel no longer references the buffers of this send */
+				if (task->is_zcopy) {
+					task->is_zcopy = false;
+					_sock_complete_zcopy_idx(&sock->base, task->zcopy_idx);
+				}
+				break;
+			}
+
+			/* The result of the send itself. The notification, if any, follows
+			 * in a separate CQE that keeps this task busy until then. */
+			assert(sock->write_zc_task == task);
+			sock->write_zc_task = NULL;
+			sock->write_task.status = SPDK_URING_SOCK_TASK_NOT_IN_USE;
+			if (status == -EAGAIN || status == -EWOULDBLOCK || status == -ENOBUFS ||
+			    status == -ECANCELED) {
+				continue;
+			} else if (spdk_unlikely(status < 0)) {
+				uring_sock_fail(sock, status);
+			} else {
+				sock->write_task.last_req = NULL;
+				sock->write_task.iov_cnt = 0;
+				sock_complete_write_reqs(&sock->base, status, true);
+				if (flags & IORING_CQE_F_MORE) {
+					task->zcopy_idx = sock->sendmsg_idx - 1;
+					task->is_zcopy = true;
+				} else {
+					_sock_complete_zcopy_idx(&sock->base, sock->sendmsg_idx - 1);
+				}
+			}
+			break;
 #endif
 		case URING_TASK_CANCEL:
 			/* Do nothing */
@@ -1676,6 +1813,119 @@ uring_sock_group_impl_buf_pool_alloc(struct spdk_uring_sock_group_impl *group_im
 	return 0;
 }
 
+#ifdef SPDK_URING_RECV_MULTISHOT
+/* Wait for the next CQE and reap it, returns its result */
+static int
+uring_sock_probe_reap(struct io_uring *ring, unsigned *flags)
+{
+	struct io_uring_cqe *cqe;
+	int rc;
+
+	*flags = 0;
+	rc = io_uring_wait_cqe(ring, &cqe);
+	if (rc < 0) {
+		return rc;
+	}
+
+	rc = cqe->res;
+	*flags = cqe->flags;
+	io_uring_cqe_seen(ring, cqe);
+
+	return rc;
+}
+
+/* Submit the SQE prepared last and reap its first CQE */
+static int
+uring_sock_probe_submit(struct io_uring *ring, unsigned *flags)
+{
+	int rc;
+
+	*flags = 0;
+	rc = io_uring_submit(ring);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return uring_sock_probe_reap(ring, flags);
+}
+
+/* Multishot receive has no opcode of its own to probe for, and a kernel without it either
+ * rejects the flag or ignores it. Receive a byte from a socket pair with it: the request
+ * stays armed, which its first CQE reports, only if the kernel supports it. The peer is shut
+ * down so that the request then terminates, and the ring is left empty.
+ */
+static bool
+uring_sock_probe_recv_multishot(struct io_uring *ring)
+{
+	struct io_uring_sqe *sqe;
+	unsigned flags = 0;
+	char buf = 0;
+	int fds[2], rc;
+	bool supported = false;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		return false;
+	}
+
+	if (write(fds[1], &buf, 1) != 1 || shutdown(fds[1], SHUT_WR) != 0) {
+		goto out;
+	}
+
+	sqe = io_uring_get_sqe(ring);
+	if (sqe == NULL) {
+		goto out;
+	}
+	io_uring_prep_provide_buffers(sqe, &buf, 1, 1, URING_PROBE_BUF_GROUP_ID, 0);
+	if (uring_sock_probe_submit(ring, &flags) < 0) {
+		goto out;
+	}
+
+	sqe = io_uring_get_sqe(ring);
+	if (sqe == NULL) {
+		goto remove_buf;
+	}
+	io_uring_prep_recv_multishot(sqe, fds[0], NULL, 0, 0);
+	sqe->buf_group = URING_PROBE_BUF_GROUP_ID;
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	rc = uring_sock_probe_submit(ring, &flags);
+	supported = rc == 1 && (flags & IORING_CQE_F_MORE);
+	/* Reap the end of the request, which sees the shutdown or runs out of buffers */
+	while (flags & IORING_CQE_F_MORE) {
+		uring_sock_probe_reap(ring, &flags);
+	}
+
+remove_buf:
+	/* The buffer is left in its group if the receive failed */
+	sqe = io_uring_get_sqe(ring);
+	if (sqe != NULL) {
+		io_uring_prep_remove_buffers(sqe, 1, URING_PROBE_BUF_GROUP_ID);
+		uring_sock_probe_submit(ring, &flags);
+	}
+out:
+	close(fds[0]);
+	close(fds[1]);
+
+	return supported;
+}
+#endif
+
+static void
+uring_sock_group_impl_probe(struct spdk_uring_sock_group_impl *group_impl)
+{
+#ifdef SPDK_URING_SEND_ZC
+	struct io_uring_probe *probe;
+
+	probe = io_uring_get_probe_ring(&group_impl->uring);
+	if (probe != NULL) {
+		group_impl->send_zc = io_uring_opcode_supported(probe, IORING_OP_SENDMSG_ZC);
+		io_uring_free_probe(probe);
+	}
+#endif
+#ifdef SPDK_URING_RECV_MULTISHOT
+	group_impl->recv_multishot = uring_sock_probe_recv_multishot(&group_impl->uring);
+#endif
+}
+
 static struct spdk_sock_group_impl *
 uring_sock_group_impl_create(void)
 {
@@ -1696,6 +1946,7 @@ uring_sock_group_impl_create(void)
 	}
 
 	TAILQ_INIT(&group_impl->pending_recv);
+	uring_sock_group_impl_probe(group_impl);
 
 	if (uring_sock_group_impl_buf_pool_alloc(group_impl) < 0) {
 		SPDK_ERRLOG("Failed to create buffer ring. Your kernel is likely not new enough. "
@@ -1719,6 +1970,9 @@ uring_sock_group_impl_add_sock(struct spdk_sock_group_impl *_group,
 	struct spdk_uring_sock *sock = __uring_sock(_sock);
 	struct spdk_uring_sock_group_impl *group = __uring_group_impl(_group);
 	int rc;
+#ifdef SPDK_URING_SEND_ZC
+	int i;
+#endif
 
 	sock->group = group;
 	sock->write_task.sock = sock;
@@ -1735,6 +1989,13 @@ uring_sock_group_impl_add_sock(struct spdk_sock_group_impl *_group,
 	sock->cancel_task.sock = sock;
 	sock->cancel_task.type = URING_TASK_CANCEL;
 
+#ifdef SPDK_URING_SEND_ZC
+	for (i = 0; i < URING_SEND_ZC_TASKS; i++) {
+		sock->zc_tasks[i].sock = sock;
+		sock->zc_tasks[i].type = URING_TASK_WRITE_ZC;
+	}
+#endif
+
 	/* switched from another polling group due to scheduling */
 	if (spdk_unlikely(sock->recv_pipe != NULL &&
 			  (spdk_pipe_reader_bytes_available(sock->recv_pipe) > 0))) {
@@ -1754,7 +2015,8 @@ uring_sock_group_impl_add_sock(struct spdk_sock_group_impl *_group,
 	/* We get an async read going immediately */
 	_sock_prep_read(&sock->base);
 #ifdef SPDK_ZEROCOPY
-	if (sock->zcopy) {
+	/* Completions of IORING_OP_SENDMSG_ZC come as CQEs, not on the error queue */
+	if (sock->zcopy && !group->send_zc) {
 		_sock_prep_errqueue(_sock);
 	}
 #endif
@@ -1851,11 +2113,19 @@ uring_sock_group_impl_remove_sock(struct spdk_sock_group_impl *_group,
 {
 	struct spdk_uring_sock *sock = __uring_sock(_sock);
 	struct spdk_uring_sock_group_impl *group = __uring_group_impl(_group);
+	void *write_user_data = &sock->write_task;
+#ifdef SPDK_URING_SEND_ZC
+	int i;
+
+	if (sock->write_zc_task != NULL) {
+		write_user_data = sock->write_zc_task;
+	}
+#endif
 
 	sock->pending_group_remove = true;
 
 	if (sock->write_task.status != SPDK_URING_SOCK_TASK_NOT_IN_USE) {
-		_sock_prep_cancel_task(_sock, &sock->write_task);
+		_sock_prep_cancel_task(_sock, write_user_data);
 		/* Since spdk_sock_group_remove_sock is not asynchronous interface, so
 		 * currently can use a while loop here. */
 		while ((sock->write_task.status != SPDK_URING_SOCK_TASK_NOT_IN_USE) ||
@@ -1884,6 +2154,16 @@ uring_sock_group_impl_remove_sock(struct spdk_sock_group_impl *_group,
 		}
 	}
 
+#ifdef SPDK_URING_SEND_ZC
+	/* Notifications of zero-copy sends can't be cancelled. Wait until the kernel
+	 * releases the buffers, as the CQEs refer to this socket. */
+	for (i = 0; i < URING_SEND_ZC_TASKS; i++) {
+		while (sock->zc_tasks[i].status != SPDK_URING_SOCK_TASK_NOT_IN_USE) {
+			uring_sock_group_impl_poll(_group, 32, NULL);
+		}
+	}
+#endif
+
 	/* Make sure the cancelling the tasks above didn't cause sending new requests */
 	assert(sock->write_task.status == SPDK_URING_SOCK_TASK_NOT_IN_USE);
 	assert(sock->read_task.status == SPDK_URING_SOCK_TASK_NOT_IN_USE);
@@ -1933,6 +2213,18 @@ uring_sock_group_impl_close(struct spdk_sock_group_impl *_group)
 	return 0;
 }
 
+static int
+uring_sock_group_impl_get_interrupt_fd(struct spdk_sock_group_impl *_group)
+{
+	struct spdk_uring_sock_group_impl *group = __uring_group_impl(_group);
+
+	/* The ring fd is readable while its completion queue is not empty. Requests
+	 * are always submitted before the completions are reaped, so anything that can
+	 * make progress without a completion has already been handled by the poll.
+	 */
+	return group->uring.ring_fd;
+}
+
 static int
 uring_sock_flush(struct spdk_sock *_sock)
 {
@@ -1965,6 +2257,13 @@ uring_sock_flush(struct spdk_sock *_sock)
 		return 0;
 	}
 
+#ifdef SPDK_URING_SEND_ZC
+	/* The error queue isn't polled for sockets in a group using IORING_OP_SENDMSG_ZC */
+	if (sock->group != NULL && sock->group->send_zc) {
+		flags &= ~MSG_ZEROCOPY;
+	}
+#endif
+
 	/* Perform the vectored write */
 	msg.msg_iov = iovs;
 	msg.msg_iovlen = iovcnt;
@@ -1987,6 +2286,11 @@ uring_sock_flush(struct spdk_sock *_sock)
 	}
 
 #ifdef SPDK_ZEROCOPY
+#ifdef SPDK_URING_SEND_ZC
+	if (sock->group != NULL && sock->group->send_zc) {
+		return rc;
+	}
+#endif
 	/* At least do once to check zero copy case */
 	if (sock->zcopy && !TAILQ_EMPTY(&_sock->pending_reqs)) {
 		retval = recvmsg(sock->fd, &task->msg, MSG_ERRQUEUE);
@@ -2027,6 +2331,7 @@ static struct spdk_net_impl g_uring_net_impl = {
 	.group_impl_remove_sock	= uring_sock_group_impl_remove_sock,
 	.group_impl_poll	= uring_sock_group_impl_poll,
 	.group_impl_close	= uring_sock_group_impl_close,
+	.group_impl_get_interrupt_fd	= uring_sock_group_impl_get_interrupt_fd,
 	.get_opts		= uring_sock_impl_get_opts,
 	.set_opts		= uring_sock_impl_set_opts,
 };
@@ -284,7 +284,8 @@ def bdev_ocf_flush_status(client, name):
 
 
 def bdev_malloc_create(client, num_blocks, block_size, physical_block_size=None, name=None, uuid=None, optimal_io_boundary=None,
-                       md_size=None, md_interleave=None, dif_type=None, dif_is_head_of_md=None):
+                       md_size=None, md_interleave=None, dif_type=None, dif_is_head_of_md=None, file=None,
+                       checkpoint_interval_ms=None):
     """Construct a malloc block device.
 
     Args:
@@ -298,6 +299,8 @@ def bdev_malloc_create(client, num_blocks, block_size, physical_block_size=None,
         md_interleave: metadata location, interleaved if set, and separated if omitted (optional)
         dif_type: protection information type (optional)
         dif_is_head_of_md: protection information is in the first 8 bytes of metadata (optional)
+        file: path of a file that backs the block device instead of hugepage memory (optional)
+        checkpoint_interval_ms: period of the writeback of the file in ms, default 0 (disabled, optional)
 
     Returns:
         Name of created block device.
@@ -319,6 +322,10 @@ def bdev_malloc_create(client, num_blocks, block_size, physical_block_size=None,
         params['dif_type'] = dif_type
     if dif_is_head_of_md:
         params['dif_is_head_of_md'] = dif_is_head_of_md
+    if file:
+        params['file'] = file
+    if checkpoint_interval_ms:
+        params['checkpoint_interval_ms'] = checkpoint_interval_ms
 
     return client.call('bdev_malloc_create', params)
 
@@ -402,18 +409,23 @@ def bdev_raid_get_bdevs(client, category):
     return client.call('bdev_raid_get_bdevs', params)
 
 
-def bdev_raid_create(client, name, raid_level, base_bdevs, strip_size=None, strip_size_kb=None, uuid=None, superblock=False):
+def bdev_raid_create(client, name, raid_level, base_bdevs, strip_size=None, strip_size_kb=None, uuid=None, superblock=False,
+                     write_mostly_base_bdevs=None, write_behind=None):
     """Create raid bdev. Either strip size arg will work but one is required.
 
     Args:
         name: user defined raid bdev name
         strip_size (deprecated): strip size of raid bdev in KB, supported values like 8, 16, 32, 64, 128, 256, etc
         strip_size_kb: strip size of raid bdev in KB, supported values like 8, 16, 32, 64, 128, 256, etc
-        raid_level: raid level of raid bdev, supported values 0
+        raid_level: raid level of raid bdev, supported values 0, 1, 10, 5f and concat
         base_bdevs: Space separated names of Nvme bdevs in double quotes, like "Nvme0n1 Nvme1n1 Nvme2n1"
         uuid: UUID for this raid bdev (optional)
         superblock: information about raid bdev will be stored in superblock on each base bdev,
                     disabled by default due to backward compatibility
+        write_mostly_base_bdevs: names of the base bdevs that are read only if no other base bdev
+                                 can serve the read, raid1 only (optional)
+        write_behind: maximum number of writes to the write-mostly base bdevs that may still be in
+                      progress when the write completes, requires superblock (optional)
 
     Returns:
         None
@@ -429,6 +441,12 @@ def bdev_raid_create(client, name, raid_level, base_bdevs, strip_size=None, stri
     if uuid:
         params['uuid'] = uuid
 
+    if write_mostly_base_bdevs:
+        params['write_mostly_base_bdevs'] = write_mostly_base_bdevs
+
+    if write_behind is not None:
+        params['write_behind'] = write_behind
+
     return client.call('bdev_raid_create', params)
 
 
@@ -458,6 +476,46 @@ def bdev_raid_remove_base_bdev(client, name):
     return client.call('bdev_raid_remove_base_bdev', params)
 
 
+def bdev_raid_add_base_bdev(client, base_bdev, raid_bdev, write_mostly=False):
+    """Add base bdev to existing raid bdev
+
+    Args:
+        base_bdev: base bdev name
+        raid_bdev: raid bdev name
+        write_mostly: the base bdev is read only if no other base bdev can serve the read,
+                      raid1 only (optional)
+
+    Returns:
+        None
+    """
+    params = {'base_bdev': base_bdev, 'raid_bdev': raid_bdev}
+
+    if write_mostly:
+        params['write_mostly'] = write_mostly
+
+    return client.call('bdev_raid_add_base_bdev', params)
+
+
+def bdev_raid_set_options(client, process_window_size_kb=None, process_max_bandwidth_mb_sec=None):
+    """Set options for bdev raid.
+
+    Args:
+        process_window_size_kb: size of the range of the raid bdev processed at a time by the
+                                background rebuild or resync process (optional)
+        process_max_bandwidth_mb_sec: maximum bandwidth of the background process, 0 means
+                                      unlimited (optional)
+    """
+    params = {}
+
+    if process_window_size_kb is not None:
+        params['process_window_size_kb'] = process_window_size_kb
+
+    if process_max_bandwidth_mb_sec is not None:
+        params['process_max_bandwidth_mb_sec'] = process_max_bandwidth_mb_sec
+
+    return client.call('bdev_raid_set_options', params)
+
+
 def bdev_aio_create(client, filename, name, block_size=None, readonly=False):
     """Construct a Linux AIO block device.
 
@@ -1252,6 +1310,141 @@ def bdev_error_create(client, base_name, uuid=None):
     return client.call('bdev_error_create', params)
 
 
+def bdev_cache_create(client, name, core_bdev_name, cache_bdev_name, mode, uuid=None, line_size_kb=None,
+                      num_shards=None, seq_cutoff_kb=None):
+    """Construct a cache block device.
+
+    Args:
+        name: name of block device
+        core_bdev_name: name of the bdev to cache
+        cache_bdev_name: name of the bdev holding the cached data
+        mode: cache mode, wb (write-back) or wt (write-through)
+        uuid: UUID of block device (optional)
+        line_size_kb: size of a cache line in KiB (optional)
+        num_shards: number of shards, each one owned by its own thread (optional)
+        seq_cutoff_kb: length of the sequential streams that bypass the cache in KiB, 0 disables (optional)
+
+    Returns:
+        Name of created block device.
+    """
+    params = {
+        'name': name,
+        'core_bdev_name': core_bdev_name,
+        'cache_bdev_name': cache_bdev_name,
+        'mode': mode,
+    }
+    if uuid:
+        params['uuid'] = uuid
+    if line_size_kb is not None:
+        params['line_size_kb'] = line_size_kb
+    if num_shards is not None:
+        params['num_shards'] = num_shards
+    if seq_cutoff_kb is not None:
+        params['seq_cutoff_kb'] = seq_cutoff_kb
+    return client.call('bdev_cache_create', params)
+
+
+def bdev_cache_delete(client, name):
+    """Remove cache bdev from the system. Its dirty data stays on the cache bdev.
+
+    Args:
+        name: name of cache bdev to delete
+    """
+    params = {'name': name}
+    return client.call('bdev_cache_delete', params)
+
+
+def bdev_cache_flush(client, name):
+    """Destage the dirty data of a cache bdev to its core bdev.
+
+    Args:
+        name: name of the cache bdev
+    """
+    params = {'name': name}
+    return client.call('bdev_cache_flush', params)
+
+
+def bdev_dedupe_create(client, name, base_bdev_name, uuid=None, num_blocks=None, latency_budget_us=None):
+    """Construct a dedupe block device.
+
+    Args:
+        name: name of block device
+        base_bdev_name: name of the bdev holding the data and the metadata
+        uuid: UUID of block device (optional)
+        num_blocks: number of 4 KiB blocks of the block device (optional)
+        latency_budget_us: latency budget of the verification of duplicates in us, 0 disables (optional)
+
+    Returns:
+        Name of created block device.
+    """
+    params = {
+        'name': name,
+        'base_bdev_name': base_bdev_name,
+    }
+    if uuid:
+        params['uuid'] = uuid
+    if num_blocks is not None:
+        params['num_blocks'] = num_blocks
+    if latency_budget_us is not None:
+        params['latency_budget_us'] = latency_budget_us
+    return client.call('bdev_dedupe_create', params)
+
+
+def bdev_dedupe_delete(client, name):
+    """Remove dedupe bdev from the system. Its data stays on the base bdev.
+
+    Args:
+        name: name of dedupe bdev to delete
+    """
+    params = {'name': name}
+    return client.call('bdev_dedupe_delete', params)
+
+
+def bdev_tier_create(client, name, fast_bdev_name, capacity_bdev_name, uuid=None, extent_size_kb=None,
+                     migration_bw_mbps=None, promote_threshold=None, decay_period_ms=None):
+    """Construct a tier block device.
+
+    Args:
+        name: name of block device
+        fast_bdev_name: name of the bdev holding the hot extents and the remap table
+        capacity_bdev_name: name of the bdev holding the other extents
+        uuid: UUID of block device (optional)
+        extent_size_kb: size of the extents in KiB (optional)
+        migration_bw_mbps: bandwidth used to move the extents in MiB/s, 0 disables the moves (optional)
+        promote_threshold: heat an extent must reach to be moved to the fast bdev (optional)
+        decay_period_ms: period after which the heat of the extents is halved (optional)
+
+    Returns:
+        Name of created block device.
+    """
+    params = {
+        'name': name,
+        'fast_bdev_name': fast_bdev_name,
+        'capacity_bdev_name': capacity_bdev_name,
+    }
+    if uuid:
+        params['uuid'] = uuid
+    if extent_size_kb is not None:
+        params['extent_size_kb'] = extent_size_kb
+    if migration_bw_mbps is not None:
+        params['migration_bw_mbps'] = migration_bw_mbps
+    if promote_threshold is not None:
+        params['promote_threshold'] = promote_threshold
+    if decay_period_ms is not None:
+        params['decay_period_ms'] = decay_period_ms
+    return client.call('bdev_tier_create', params)
+
+
+def bdev_tier_delete(client, name):
+    """Remove tier bdev from the system. The extents stay on the fast bdev.
+
+    Args:
+        name: name of tier bdev to delete
+    """
+    params = {'name': name}
+    return client.call('bdev_tier_delete', params)
+
+
 def bdev_delay_create(client, base_bdev_name, name, avg_read_latency, p99_read_latency, avg_write_latency, p99_write_latency, uuid=None):
     """Construct a delay block device.
 
@@ -1649,12 +1842,13 @@ def bdev_get_bdevs(client, name=None, timeout=None):
     return client.call('bdev_get_bdevs', params)
 
 
-def bdev_get_iostat(client, name=None, per_channel=None):
+def bdev_get_iostat(client, name=None, per_channel=None, interval_ms=None):
     """Get I/O statistics for block devices.
 
     Args:
         name: bdev name to query (optional; if omitted, query all bdevs)
         per_channel: display per channel IO stats for specified bdev
+        interval_ms: return the I/O statistics accumulated over this interval (optional)
 
     Returns:
         I/O statistics for the requested block devices.
@@ -1664,6 +1858,8 @@ def bdev_get_iostat(client, name=None, per_channel=None):
         params['name'] = name
     if per_channel:
         params['per_channel'] = per_channel
+    if interval_ms:
+        params['interval_ms'] = interval_ms
     return client.call('bdev_get_iostat', params)
 
 
@@ -1777,6 +1973,105 @@ def bdev_set_qos_limit(
     return client.call('bdev_set_qos_limit', params)
 
 
+def bdev_qos_group_create(
+        client,
+        name,
+        rw_ios_per_sec=None,
+        rw_mbytes_per_sec=None,
+        r_mbytes_per_sec=None,
+        w_mbytes_per_sec=None):
+    """Create a QoS group whose rate limits are shared by its block devices.
+
+    Args:
+        name: name of the QoS group
+        rw_ios_per_sec: R/W IOs per second limit (>=1000, example: 20000). 0 means unlimited.
+        rw_mbytes_per_sec: R/W megabytes per second limit (>=10, example: 100). 0 means unlimited.
+        r_mbytes_per_sec: Read megabytes per second limit (>=10, example: 100). 0 means unlimited.
+        w_mbytes_per_sec: Write megabytes per second limit (>=10, example: 100). 0 means unlimited.
+    """
+    params = {}
+    params['name'] = name
+    if rw_ios_per_sec is not None:
+        params['rw_ios_per_sec'] = rw_ios_per_sec
+    if rw_mbytes_per_sec is not None:
+        params['rw_mbytes_per_sec'] = rw_mbytes_per_sec
+    if r_mbytes_per_sec is not None:
+        params['r_mbytes_per_sec'] = r_mbytes_per_sec
+    if w_mbytes_per_sec is not None:
+        params['w_mbytes_per_sec'] = w_mbytes_per_sec
+    return client.call('bdev_qos_group_create', params)
+
+
+def bdev_qos_group_delete(client, name):
+    """Delete a QoS group without block devices.
+
+    Args:
+        name: name of the QoS group
+    """
+    params = {'name': name}
+    return client.call('bdev_qos_group_delete', params)
+
+
+def bdev_set_qos_group(
+        client,
+        name,
+        group=None,
+        min_rw_ios_per_sec=None,
+        min_rw_mbytes_per_sec=None,
+        min_r_mbytes_per_sec=None,
+        min_w_mbytes_per_sec=None):
+    """Add a block device to a QoS group or remove it from its group.
+
+    Args:
+        name: name of block device
+        group: name of the QoS group, omit to remove the block device from its group
+        min_rw_ios_per_sec: R/W IOs per second guaranteed within the group
+        min_rw_mbytes_per_sec: R/W megabytes per second guaranteed within the group
+        min_r_mbytes_per_sec: Read megabytes per second guaranteed within the group
+        min_w_mbytes_per_sec: Write megabytes per second guaranteed within the group
+    """
+    params = {}
+    params['name'] = name
+    if group is not None:
+        params['group'] = group
+    if min_rw_ios_per_sec is not None:
+        params['min_rw_ios_per_sec'] = min_rw_ios_per_sec
+    if min_rw_mbytes_per_sec is not None:
+        params['min_rw_mbytes_per_sec'] = min_rw_mbytes_per_sec
+    if min_r_mbytes_per_sec is not None:
+        params['min_r_mbytes_per_sec'] = min_r_mbytes_per_sec
+    if min_w_mbytes_per_sec is not None:
+        params['min_w_mbytes_per_sec'] = min_w_mbytes_per_sec
+    return client.call('bdev_set_qos_group', params)
+
+
+def bdev_set_qos_latency_target(client, name, latency_target_us):
+    """Set the average latency QoS keeps a block device under by scaling its rate limits down.
+
+    Args:
+        name: name of block device
+        latency_target_us: latency target in microseconds. 0 disables it.
+    """
+    params = {'name': name, 'latency_target_us': latency_target_us}
+    return client.call('bdev_set_qos_latency_target', params)
+
+
+def bdev_part_set_fairness(client, name, weight=None, base_queue_depth=None):
+    """Set how a partition shares the queue slots of its base bdev with the other partitions.
+
+    Args:
+        name: name of the partition bdev
+        weight: weight of the partition, from 1 to 1024 (optional)
+        base_queue_depth: number of I/Os each thread submits to the base bdev, 0 for no limit (optional)
+    """
+    params = {'name': name}
+    if weight is not None:
+        params['weight'] = weight
+    if base_queue_depth is not None:
+        params['base_queue_depth'] = base_queue_depth
+    return client.call('bdev_part_set_fairness', params)
+
+
 def bdev_nvme_apply_firmware(client, bdev_name, filename):
     """Download and commit firmware to NVMe device.
 
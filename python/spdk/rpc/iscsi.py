@@ -26,7 +26,14 @@ def iscsi_set_options(
         max_r2t_per_connection=None,
         pdu_pool_size=None,
         immediate_data_pool_size=None,
-        data_out_pool_size=None):
+        data_out_pool_size=None,
+        recv_buf_count=None,
+        reuseport=None,
+        interrupt_busy_poll_us=None,
+        tls=None,
+        ktls=None,
+        tls_psk_identity=None,
+        tls_psk_path=None):
     """Set iSCSI target options.
 
     Args:
@@ -52,6 +59,13 @@ def iscsi_set_options(
         pdu_pool_size: Number of PDUs in the pool (optional)
         immediate_data_pool_size: Number of immediate data buffers in the pool (optional)
         data_out_pool_size: Number of data out buffers in the pool (optional)
+        recv_buf_count: Number of socket receive buffers per poll group (optional)
+        reuseport: Accept and log in connections on every poll group (optional)
+        interrupt_busy_poll_us: Time to keep busy polling sockets after the last event in interrupt mode (optional)
+        tls: Run the portals over TLS 1.3 with PSK (optional)
+        ktls: Offload TLS records to the kernel, only used with tls (optional)
+        tls_psk_identity: PSK identity for TLS, required with tls (optional)
+        tls_psk_path: Path to the file with the hex PSK for TLS, required with tls (optional)
 
     Returns:
         True or False
@@ -102,6 +116,20 @@ def iscsi_set_options(
         params['immediate_data_pool_size'] = immediate_data_pool_size
     if data_out_pool_size:
         params['data_out_pool_size'] = data_out_pool_size
+    if recv_buf_count:
+        params['recv_buf_count'] = recv_buf_count
+    if reuseport:
+        params['reuseport'] = reuseport
+    if interrupt_busy_poll_us is not None:
+        params['interrupt_busy_poll_us'] = interrupt_busy_poll_us
+    if tls:
+        params['tls'] = tls
+    if ktls is not None:
+        params['ktls'] = ktls
+    if tls_psk_identity:
+        params['tls_psk_identity'] = tls_psk_identity
+    if tls_psk_path:
+        params['tls_psk_path'] = tls_psk_path
 
     return client.call('iscsi_set_options', params)
 
@@ -600,6 +628,15 @@ def iscsi_get_connections(client):
     return client.call('iscsi_get_connections')
 
 
+def iscsi_get_sock_flush_histogram(client):
+    """Get histogram of the bytes sent by each flush of the iSCSI connection sockets.
+
+    Returns:
+        Base64 encoded histogram and its bucket shift.
+    """
+    return client.call('iscsi_get_sock_flush_histogram')
+
+
 def iscsi_get_options(client):
     """Display iSCSI global parameters.
 
@@ -27,7 +27,10 @@ def sock_impl_set_options(client,
                           enable_zerocopy_send_client=None,
                           zerocopy_threshold=None,
                           tls_version=None,
-                          enable_ktls=None):
+                          enable_ktls=None,
+                          flush_batch_timeout=None,
+                          flush_batch_iovcnt_threshold=None,
+                          flush_batch_bytes_threshold=None):
     """Set parameters for the socket layer implementation.
 
     Args:
@@ -42,6 +45,10 @@ def sock_impl_set_options(client,
         zerocopy_threshold: set zerocopy_threshold in bytes(optional)
         tls_version: set TLS protocol version (optional)
         enable_ktls: enable or disable Kernel TLS (optional)
+        flush_batch_timeout: time in microseconds for which queued requests may wait to be sent
+        together with later requests, 0 disables batching (optional)
+        flush_batch_iovcnt_threshold: number of queued iovecs which causes the batch to be sent (optional)
+        flush_batch_bytes_threshold: number of queued bytes which causes the batch to be sent (optional)
     """
     params = {}
 
@@ -66,6 +73,12 @@ def sock_impl_set_options(client,
         params['tls_version'] = tls_version
     if enable_ktls is not None:
         params['enable_ktls'] = enable_ktls
+    if flush_batch_timeout is not None:
+        params['flush_batch_timeout'] = flush_batch_timeout
+    if flush_batch_iovcnt_threshold is not None:
+        params['flush_batch_iovcnt_threshold'] = flush_batch_iovcnt_threshold
+    if flush_batch_bytes_threshold is not None:
+        params['flush_batch_bytes_threshold'] = flush_batch_bytes_threshold
 
     return client.call('sock_impl_set_options', params)
 
@@ -396,7 +396,9 @@ if __name__ == "__main__":
                                                md_size=args.md_size,
                                                md_interleave=args.md_interleave,
                                                dif_type=args.dif_type,
-                                               dif_is_head_of_md=args.dif_is_head_of_md))
+                                               dif_is_head_of_md=args.dif_is_head_of_md,
+                                               file=args.file,
+                                               checkpoint_interval_ms=args.checkpoint_interval_ms))
     p = subparsers.add_parser('bdev_malloc_create', help='Create a bdev with malloc backend')
     p.add_argument('-b', '--name', help="Name of the bdev")
     p.add_argument('-u', '--uuid', help="UUID of the bdev")
@@ -415,6 +417,9 @@ if __name__ == "__main__":
                         'to be set along --dif-type. Default=0 - no protection.')
     p.add_argument('-d', '--dif-is-head-of-md', action='store_true',
                    help='Protection information is in the first 8 bytes of metadata. Default=false.')
+    p.add_argument('-f', '--file', help='Path of a file that backs the bdev instead of hugepage memory')
+    p.add_argument('-c', '--checkpoint-interval-ms', type=int,
+                   help='Period of the writeback of the file in ms. Default=0 - only on flush.')
     p.set_defaults(func=bdev_malloc_create)
 
     def bdev_malloc_delete(args):
@@ -1069,6 +1074,106 @@ if __name__ == "__main__":
     p.add_argument('new_size', help='new bdev size for resize operation. The unit is MiB')
     p.set_defaults(func=bdev_rbd_resize)
 
+    def bdev_cache_create(args):
+        print_json(rpc.bdev.bdev_cache_create(args.client,
+                                              name=args.name,
+                                              core_bdev_name=args.core_bdev_name,
+                                              cache_bdev_name=args.cache_bdev_name,
+                                              mode=args.mode,
+                                              uuid=args.uuid,
+                                              line_size_kb=args.line_size_kb,
+                                              num_shards=args.num_shards,
+                                              seq_cutoff_kb=args.seq_cutoff_kb))
+
+    p = subparsers.add_parser('bdev_cache_create',
+                              help='Add a cache bdev caching a slow bdev on a fast one')
+    p.add_argument('-n', '--name', help="Name of the cache bdev", required=True)
+    p.add_argument('-c', '--core-bdev-name', help="Name of the bdev to cache", required=True)
+    p.add_argument('-f', '--cache-bdev-name', help="Name of the bdev holding the cached data", required=True)
+    p.add_argument('-m', '--mode', help="Cache mode", choices=['wb', 'wt'], required=True)
+    p.add_argument('-u', '--uuid', help='UUID of the bdev (optional)')
+    p.add_argument('-l', '--line-size-kb', help="Size of a cache line in KiB, a power of 2 (default 64)", type=int)
+    p.add_argument('-s', '--num-shards', help="Number of shards, each one owned by its own thread (default 1)", type=int)
+    p.add_argument('-q', '--seq-cutoff-kb',
+                   help="Sequential streams of this length bypass the cache on misses, 0 disables (default 1024)", type=int)
+    p.set_defaults(func=bdev_cache_create)
+
+    def bdev_cache_delete(args):
+        rpc.bdev.bdev_cache_delete(args.client,
+                                   name=args.name)
+
+    p = subparsers.add_parser('bdev_cache_delete', help='Delete a cache bdev, its dirty data stays on the cache bdev')
+    p.add_argument('name', help='cache bdev name')
+    p.set_defaults(func=bdev_cache_delete)
+
+    def bdev_cache_flush(args):
+        rpc.bdev.bdev_cache_flush(args.client,
+                                  name=args.name)
+
+    p = subparsers.add_parser('bdev_cache_flush', help='Destage the dirty data of a cache bdev to its core bdev')
+    p.add_argument('name', help='cache bdev name')
+    p.set_defaults(func=bdev_cache_flush)
+
+    def bdev_dedupe_create(args):
+        print_json(rpc.bdev.bdev_dedupe_create(args.client,
+                                               name=args.name,
+                                               base_bdev_name=args.base_bdev_name,
+                                               uuid=args.uuid,
+                                               num_blocks=args.num_blocks,
+                                               latency_budget_us=args.latency_budget_us))
+
+    p = subparsers.add_parser('bdev_dedupe_create',
+                              help='Add a dedupe bdev storing each distinct block once on a base bdev')
+    p.add_argument('-n', '--name', help="Name of the dedupe bdev", required=True)
+    p.add_argument('-b', '--base-bdev-name', help="Name of the bdev holding the data and the metadata", required=True)
+    p.add_argument('-u', '--uuid', help='UUID of the bdev (optional)')
+    p.add_argument('-s', '--num-blocks', help="Number of 4 KiB blocks (default: as many as the base bdev holds)", type=int)
+    p.add_argument('-l', '--latency-budget-us',
+                   help="Duplicates are not verified while it takes longer than this, 0 disables (default 500)", type=int)
+    p.set_defaults(func=bdev_dedupe_create)
+
+    def bdev_dedupe_delete(args):
+        rpc.bdev.bdev_dedupe_delete(args.client,
+                                    name=args.name)
+
+    p = subparsers.add_parser('bdev_dedupe_delete', help='Delete a dedupe bdev, its data stays on the base bdev')
+    p.add_argument('name', help='dedupe bdev name')
+    p.set_defaults(func=bdev_dedupe_delete)
+
+    def bdev_tier_create(args):
+        print_json(rpc.bdev.bdev_tier_create(args.client,
+                                             name=args.name,
+                                             fast_bdev_name=args.fast_bdev_name,
+                                             capacity_bdev_name=args.capacity_bdev_name,
+                                             uuid=args.uuid,
+                                             extent_size_kb=args.extent_size_kb,
+                                             migration_bw_mbps=args.migration_bw_mbps,
+                                             promote_threshold=args.promote_threshold,
+                                             decay_period_ms=args.decay_period_ms))
+
+    p = subparsers.add_parser('bdev_tier_create',
+                              help='Add a tier bdev keeping the hot extents of a capacity bdev on a fast bdev')
+    p.add_argument('-n', '--name', help="Name of the tier bdev", required=True)
+    p.add_argument('-f', '--fast-bdev-name', help="Name of the bdev holding the hot extents and the remap table",
+                   required=True)
+    p.add_argument('-c', '--capacity-bdev-name', help="Name of the bdev holding the other extents", required=True)
+    p.add_argument('-u', '--uuid', help='UUID of the bdev (optional)')
+    p.add_argument('-e', '--extent-size-kb', help="Size of the extents in KiB (default 1024)", type=int)
+    p.add_argument('-w', '--migration-bw-mbps',
+                   help="Bandwidth used to move the extents in MiB/s, 0 disables the moves (default 64)", type=int)
+    p.add_argument('-t', '--promote-threshold', help="Heat an extent must reach to be promoted (default 8)", type=int)
+    p.add_argument('-d', '--decay-period-ms', help="The heat of the extents is halved once per period (default 1000)",
+                   type=int)
+    p.set_defaults(func=bdev_tier_create)
+
+    def bdev_tier_delete(args):
+        rpc.bdev.bdev_tier_delete(args.client,
+                                  name=args.name)
+
+    p = subparsers.add_parser('bdev_tier_delete', help='Delete a tier bdev, the extents stay on the fast bdev')
+    p.add_argument('name', help='tier bdev name')
+    p.set_defaults(func=bdev_tier_delete)
+
     def bdev_delay_create(args):
         print_json(rpc.bdev.bdev_delay_create(args.client,
                                               base_bdev_name=args.base_bdev_name,
@@ -1197,13 +1302,16 @@ if __name__ == "__main__":
     def bdev_get_iostat(args):
         print_dict(rpc.bdev.bdev_get_iostat(args.client,
                                             name=args.name,
-                                            per_channel=args.per_channel))
+                                            per_channel=args.per_channel,
+                                            interval_ms=args.interval_ms))
 
     p = subparsers.add_parser('bdev_get_iostat',
                               help='Display current I/O statistics of all the blockdevs or specified blockdev.')
     p.add_argument('-b', '--name', help="Name of the Blockdev. Example: Nvme0n1", required=False)
     p.add_argument('-c', '--per-channel', default=False, dest='per_channel', help='Display per channel IO stats for specified device',
                    action='store_true', required=False)
+    p.add_argument('-i', '--interval-ms', dest='interval_ms', type=int,
+                   help='Display IO stats accumulated over this many milliseconds', required=False)
     p.set_defaults(func=bdev_get_iostat)
 
     def bdev_reset_iostat(args):
@@ -1271,6 +1379,87 @@ if __name__ == "__main__":
                    type=int, required=False)
     p.set_defaults(func=bdev_set_qos_limit)
 
+    def bdev_qos_group_create(args):
+        rpc.bdev.bdev_qos_group_create(args.client,
+                                       name=args.name,
+                                       rw_ios_per_sec=args.rw_ios_per_sec,
+                                       rw_mbytes_per_sec=args.rw_mbytes_per_sec,
+                                       r_mbytes_per_sec=args.r_mbytes_per_sec,
+                                       w_mbytes_per_sec=args.w_mbytes_per_sec)
+
+    p = subparsers.add_parser('bdev_qos_group_create',
+                              help='Create a QoS group whose rate limits are shared by its blockdevs')
+    p.add_argument('name', help='Name of the QoS group')
+    p.add_argument('--rw-ios-per-sec',
+                   help='R/W IOs per second limit (>=1000, example: 20000). 0 means unlimited.',
+                   type=int, required=False)
+    p.add_argument('--rw-mbytes-per-sec',
+                   help="R/W megabytes per second limit (>=10, example: 100). 0 means unlimited.",
+                   type=int, required=False)
+    p.add_argument('--r-mbytes-per-sec',
+                   help="Read megabytes per second limit (>=10, example: 100). 0 means unlimited.",
+                   type=int, required=False)
+    p.add_argument('--w-mbytes-per-sec',
+                   help="Write megabytes per second limit (>=10, example: 100). 0 means unlimited.",
+                   type=int, required=False)
+    p.set_defaults(func=bdev_qos_group_create)
+
+    def bdev_qos_group_delete(args):
+        rpc.bdev.bdev_qos_group_delete(args.client, name=args.name)
+
+    p = subparsers.add_parser('bdev_qos_group_delete', help='Delete a QoS group without blockdevs')
+    p.add_argument('name', help='Name of the QoS group')
+    p.set_defaults(func=bdev_qos_group_delete)
+
+    def bdev_set_qos_group(args):
+        rpc.bdev.bdev_set_qos_group(args.client,
+                                    name=args.name,
+                                    group=args.group,
+                                    min_rw_ios_per_sec=args.min_rw_ios_per_sec,
+                                    min_rw_mbytes_per_sec=args.min_rw_mbytes_per_sec,
+                                    min_r_mbytes_per_sec=args.min_r_mbytes_per_sec,
+                                    min_w_mbytes_per_sec=args.min_w_mbytes_per_sec)
+
+    p = subparsers.add_parser('bdev_set_qos_group',
+                              help='Add a blockdev to a QoS group or remove it from its group')
+    p.add_argument('name', help='Blockdev name. Example: Malloc0')
+    p.add_argument('-g', '--group', help='Name of the QoS group. Omit to remove the blockdev from its group',
+                   required=False)
+    p.add_argument('--min-rw-ios-per-sec', help='R/W IOs per second guaranteed within the group',
+                   type=int, required=False)
+    p.add_argument('--min-rw-mbytes-per-sec', help='R/W megabytes per second guaranteed within the group',
+                   type=int, required=False)
+    p.add_argument('--min-r-mbytes-per-sec', help='Read megabytes per second guaranteed within the group',
+                   type=int, required=False)
+    p.add_argument('--min-w-mbytes-per-sec', help='Write megabytes per second guaranteed within the group',
+                   type=int, required=False)
+    p.set_defaults(func=bdev_set_qos_group)
+
+    def bdev_set_qos_latency_target(args):
+        rpc.bdev.bdev_set_qos_latency_target(args.client,
+                                             name=args.name,
+                                             latency_target_us=args.latency_target_us)
+
+    p = subparsers.add_parser('bdev_set_qos_latency_target',
+                              help='Scale the QoS rate limits of a blockdev down to keep its latency under a target')
+    p.add_argument('name', help='Blockdev name. Example: Malloc0')
+    p.add_argument('latency_target_us', help='Average latency target in microseconds. 0 disables it.', type=int)
+    p.set_defaults(func=bdev_set_qos_latency_target)
+
+    def bdev_part_set_fairness(args):
+        rpc.bdev.bdev_part_set_fairness(args.client,
+                                        name=args.name,
+                                        weight=args.weight,
+                                        base_queue_depth=args.base_queue_depth)
+
+    p = subparsers.add_parser('bdev_part_set_fairness',
+                              help='Set how a partition shares the queue slots of its base bdev')
+    p.add_argument('name', help='Partition bdev name. Example: Nvme0n1p1')
+    p.add_argument('-w', '--weight', help='Weight of the partition, from 1 to 1024', type=int)
+    p.add_argument('-q', '--base-queue-depth',
+                   help='Number of I/Os each thread submits to the base bdev, 0 for no limit', type=int)
+    p.set_defaults(func=bdev_part_set_fairness)
+
     def bdev_error_inject_error(args):
         rpc.bdev.bdev_error_inject_error(args.client,
                                          name=args.name,
@@ -1346,7 +1535,14 @@ if __name__ == "__main__":
             max_r2t_per_connection=args.max_r2t_per_connection,
             pdu_pool_size=args.pdu_pool_size,
             immediate_data_pool_size=args.immediate_data_pool_size,
-            data_out_pool_size=args.data_out_pool_size)
+            data_out_pool_size=args.data_out_pool_size,
+            recv_buf_count=args.recv_buf_count,
+            reuseport=args.reuseport,
+            interrupt_busy_poll_us=args.interrupt_busy_poll_us,
+            tls=args.tls,
+            ktls=args.ktls,
+            tls_psk_identity=args.tls_psk_identity,
+            tls_psk_path=args.tls_psk_path)
 
     p = subparsers.add_parser('iscsi_set_options',
                               help="""Set options of iSCSI subsystem""")
@@ -1375,6 +1571,16 @@ if __name__ == "__main__":
     p.add_argument('-u', '--pdu-pool-size', help='Number of PDUs in the pool', type=int)
     p.add_argument('-j', '--immediate-data-pool-size', help='Number of immediate data buffers in the pool', type=int)
     p.add_argument('-z', '--data-out-pool-size', help='Number of data out buffers in the pool', type=int)
+    p.add_argument('-e', '--recv-buf-count', help='Number of socket receive buffers per poll group', type=int)
+    p.add_argument('--reuseport', help='Accept and log in connections on every poll group', action='store_true')
+    p.add_argument('--interrupt-busy-poll-us',
+                   help='Time in microseconds to busy poll sockets after the last event in interrupt mode',
+                   type=int)
+    p.add_argument('--tls', help='Run the portals over TLS 1.3 with PSK', action='store_true')
+    p.add_argument('--disable-ktls', help='Do not offload TLS records to the kernel', action='store_false', dest='ktls',
+                   default=None)
+    p.add_argument('--tls-psk-identity', help='PSK identity for TLS')
+    p.add_argument('--tls-psk-path', help='Path to the file with the PSK for TLS in hex')
     p.set_defaults(func=iscsi_set_options)
 
     def iscsi_set_discovery_auth(args):
@@ -1812,6 +2018,13 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                               help='Display iSCSI connections')
     p.set_defaults(func=iscsi_get_connections)
 
+    def iscsi_get_sock_flush_histogram(args):
+        print_dict(rpc.iscsi.iscsi_get_sock_flush_histogram(args.client))
+
+    p = subparsers.add_parser('iscsi_get_sock_flush_histogram',
+                              help='Display histogram of bytes sent by each flush of iSCSI connection sockets')
+    p.set_defaults(func=iscsi_get_sock_flush_histogram)
+
     def iscsi_get_options(args):
         print_dict(rpc.iscsi.iscsi_get_options(args.client))
 
@@ -2127,21 +2340,31 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
         for u in args.base_bdevs.strip().split(" "):
             base_bdevs.append(u)
 
+        write_mostly_base_bdevs = None
+        if args.write_mostly_base_bdevs:
+            write_mostly_base_bdevs = args.write_mostly_base_bdevs.strip().split(" ")
+
         rpc.bdev.bdev_raid_create(args.client,
                                   name=args.name,
                                   strip_size_kb=args.strip_size_kb,
                                   raid_level=args.raid_level,
                                   base_bdevs=base_bdevs,
                                   uuid=args.uuid,
-                                  superblock=args.superblock)
+                                  superblock=args.superblock,
+                                  write_mostly_base_bdevs=write_mostly_base_bdevs,
+                                  write_behind=args.write_behind)
     p = subparsers.add_parser('bdev_raid_create', help='Create new raid bdev')
     p.add_argument('-n', '--name', help='raid bdev name', required=True)
     p.add_argument('-z', '--strip-size-kb', help='strip size in KB', type=int)
-    p.add_argument('-r', '--raid-level', help='raid level, raid0, raid1 and a special level concat are supported', required=True)
+    p.add_argument('-r', '--raid-level', help='raid level, raid0, raid1, raid10 and a special level concat are supported', required=True)
     p.add_argument('-b', '--base-bdevs', help='base bdevs name, whitespace separated list in quotes', required=True)
     p.add_argument('--uuid', help='UUID for this raid bdev', required=False)
     p.add_argument('-s', '--superblock', help='information about raid bdev will be stored in superblock on each base bdev, '
                                               'disabled by default due to backward compatibility', action='store_true')
+    p.add_argument('-m', '--write-mostly-base-bdevs', help='base bdevs read only if no other base bdev can serve the read, '
+                   'whitespace separated list in quotes, raid1 only')
+    p.add_argument('-w', '--write-behind', help='maximum number of writes to the write-mostly base bdevs still in progress '
+                   'when the write completes, requires superblock', type=int)
     p.set_defaults(func=bdev_raid_create)
 
     def bdev_raid_delete(args):
@@ -2158,6 +2381,29 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('name', help='base bdev name')
     p.set_defaults(func=bdev_raid_remove_base_bdev)
 
+    def bdev_raid_add_base_bdev(args):
+        rpc.bdev.bdev_raid_add_base_bdev(args.client,
+                                         base_bdev=args.base_bdev,
+                                         raid_bdev=args.raid_bdev,
+                                         write_mostly=args.write_mostly)
+    p = subparsers.add_parser('bdev_raid_add_base_bdev', help='Add base bdev to existing raid bdev')
+    p.add_argument('raid_bdev', help='raid bdev name')
+    p.add_argument('base_bdev', help='base bdev name')
+    p.add_argument('-m', '--write-mostly', help='read from the base bdev only if no other base bdev can serve the read',
+                   action='store_true')
+    p.set_defaults(func=bdev_raid_add_base_bdev)
+
+    def bdev_raid_set_options(args):
+        rpc.bdev.bdev_raid_set_options(args.client,
+                                       process_window_size_kb=args.process_window_size_kb,
+                                       process_max_bandwidth_mb_sec=args.process_max_bandwidth_mb_sec)
+    p = subparsers.add_parser('bdev_raid_set_options', help='Set options for bdev raid.')
+    p.add_argument('-w', '--process-window-size-kb', type=int,
+                   help="Size of the range processed at a time by the background rebuild or resync process")
+    p.add_argument('-b', '--process-max-bandwidth-mb-sec', type=int,
+                   help="Maximum bandwidth of the background process in MiB/s, 0 means unlimited")
+    p.set_defaults(func=bdev_raid_set_options)
+
     # split
     def bdev_split_create(args):
         print_array(rpc.bdev.bdev_split_create(args.client,
@@ -2452,6 +2698,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-w', '--no-wr-batching', action='store_true', help='Disable work requests batching. Relevant only for RDMA transport')
     p.add_argument('-e', '--control-msg-num', help="""The number of control messages per poll group.
     Relevant only for TCP transport""", type=int)
+    p.add_argument('--recv-buf-count', help="""The number of socket receive buffers per poll group.
+    Relevant only for TCP transport""", type=int)
     p.add_argument('-M', '--disable-mappable-bar0', action='store_true', help="""Disable mmap() of BAR0.
     Relevant only for VFIO-USER transport""")
     p.add_argument('-I', '--disable-adaptive-irq', action='store_true', help="""Disable adaptive interrupt feature.
@@ -3377,7 +3625,10 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                        enable_zerocopy_send_client=args.enable_zerocopy_send_client,
                                        zerocopy_threshold=args.zerocopy_threshold,
                                        tls_version=args.tls_version,
-                                       enable_ktls=args.enable_ktls)
+                                       enable_ktls=args.enable_ktls,
+                                       flush_batch_timeout=args.flush_batch_timeout,
+                                       flush_batch_iovcnt_threshold=args.flush_batch_iovcnt_threshold,
+                                       flush_batch_bytes_threshold=args.flush_batch_bytes_threshold)
 
     p = subparsers.add_parser('sock_impl_set_options', help="""Set options of socket layer implementation""")
     p.add_argument('-i', '--impl', help='Socket implementation name, e.g. posix', required=True)
@@ -3406,9 +3657,16 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                    action='store_true', dest='enable_ktls')
     p.add_argument('--disable-ktls', help='Disable Kernel TLS',
                    action='store_false', dest='enable_ktls')
+    p.add_argument('--flush-batch-timeout', help="""Time in microseconds for which queued requests may wait
+    to be sent together with later requests. 0 disables batching""", type=int)
+    p.add_argument('--flush-batch-iovcnt-threshold', help='Number of queued iovecs which causes the batch to be sent',
+                   type=int)
+    p.add_argument('--flush-batch-bytes-threshold', help='Number of queued bytes which causes the batch to be sent',
+                   type=int)
     p.set_defaults(func=sock_impl_set_options, enable_recv_pipe=None, enable_quickack=None,
                    enable_placement_id=None, enable_zerocopy_send_server=None, enable_zerocopy_send_client=None,
-                   zerocopy_threshold=None, tls_version=None, enable_ktls=None)
+                   zerocopy_threshold=None, tls_version=None, enable_ktls=None, flush_batch_timeout=None,
+                   flush_batch_iovcnt_threshold=None, flush_batch_bytes_threshold=None)
 
     def sock_set_default_impl(args):
         print_json(rpc.sock.sock_set_default_impl(args.client,
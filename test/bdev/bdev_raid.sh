@@ -186,7 +186,7 @@ function verify_raid_bdev_state() {
 
 function has_redundancy() {
 	case $1 in
-		"raid1" | "raid5f") return 0 ;;
+		"raid1" | "raid10" | "raid5f") return 0 ;;
 		*) return 1 ;;
 	esac
 }
@@ -523,6 +523,10 @@ for n in {2..4}; do
 	done
 done
 
+raid_state_function_test raid10 4 false
+raid_state_function_test raid10 4 true
+raid_superblock_test raid10 4
+
 if [ "$CONFIG_RAID5F" == y ]; then
 	for n in {3..4}; do
 		raid_state_function_test raid5f $n false
@@ -42,6 +42,9 @@ DEFINE_STUB(spdk_sock_group_poll_count, int, (struct spdk_sock_group *group, int
 DEFINE_STUB(spdk_sock_group_close, int, (struct spdk_sock_group **group), 0);
 DEFINE_STUB(spdk_sock_group_provide_buf, int, (struct spdk_sock_group *group, void *buf, size_t len,
 		void *ctx), 0);
+DEFINE_STUB(spdk_sock_group_register_interrupt, int, (struct spdk_sock_group *group,
+		uint32_t busy_poll_us, spdk_interrupt_fn fn, void *arg, const char *name), 0);
+DEFINE_STUB_V(spdk_sock_group_unregister_interrupt, (struct spdk_sock_group *group));
 
 static uint8_t g_buf[0x1000] = {};
 
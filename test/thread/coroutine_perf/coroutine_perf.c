@@ -0,0 +1,232 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk/env.h"
+#include "spdk/event.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#define MAX_NUM_COROUTINES	1000
+
+static int g_time_in_sec;
+static int g_num_coroutines;
+static bool g_stop;
+
+static struct spdk_poller *g_poller;
+static struct spdk_poller *g_timer;
+static struct spdk_coroutine *g_coroutines[MAX_NUM_COROUTINES];
+
+static uint64_t g_switch_count;
+static uint64_t g_switch_tsc;
+static uint64_t g_create_count;
+static uint64_t g_create_tsc;
+
+static void
+coroutine_loop(void *arg)
+{
+	while (!g_stop) {
+		spdk_coroutine_yield();
+	}
+}
+
+static void
+coroutine_noop(void *arg)
+{
+}
+
+static int
+coroutine_perf_poll(void *arg)
+{
+	struct spdk_coroutine *co;
+	uint64_t start, end;
+	int i;
+
+	/* Each enter switches to the coroutine and its yield switches back. */
+	start = spdk_get_ticks();
+	for (i = 0; i < g_num_coroutines; i++) {
+		spdk_coroutine_enter(g_coroutines[i]);
+	}
+	end = spdk_get_ticks();
+
+	g_switch_tsc += end - start;
+	g_switch_count += 2 * g_num_coroutines;
+
+	/* Short-lived coroutines, as used for a single control path operation. */
+	start = end;
+	for (i = 0; i < g_num_coroutines; i++) {
+		co = spdk_coroutine_create(coroutine_noop, NULL, 0);
+		if (co == NULL) {
+			fprintf(stderr, "failed to create coroutine\n");
+			spdk_app_stop(-ENOMEM);
+			return SPDK_POLLER_IDLE;
+		}
+		spdk_coroutine_enter(co);
+	}
+	end = spdk_get_ticks();
+
+	g_create_tsc += end - start;
+	g_create_count += g_num_coroutines;
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+_coroutine_perf_end(void)
+{
+	uint64_t tsc_hz, switch_cost_cyc, switch_cost_nsec, create_cost_cyc, create_cost_nsec;
+	int i;
+
+	spdk_poller_unregister(&g_timer);
+	spdk_poller_unregister(&g_poller);
+
+	g_stop = true;
+	for (i = 0; i < g_num_coroutines; i++) {
+		if (g_coroutines[i] != NULL) {
+			spdk_coroutine_enter(g_coroutines[i]);
+			g_coroutines[i] = NULL;
+		}
+	}
+
+	tsc_hz = spdk_get_ticks_hz();
+
+	printf("\r ======================================\n");
+
+	printf("\r total_switch_count: %" PRIu64 "\n", g_switch_count);
+	printf("\r total_create_count: %" PRIu64 "\n", g_create_count);
+	printf("\r tsc_hz: %" PRIu64 " (cyc)\n", tsc_hz);
+
+	printf("\r ======================================\n");
+
+	if (g_switch_count == 0 || g_create_count == 0) {
+		spdk_app_stop(0);
+		return;
+	}
+
+	switch_cost_cyc = g_switch_tsc / g_switch_count;
+	switch_cost_nsec = (switch_cost_cyc * SPDK_SEC_TO_NSEC) / tsc_hz;
+	create_cost_cyc = g_create_tsc / g_create_count;
+	create_cost_nsec = (create_cost_cyc * SPDK_SEC_TO_NSEC) / tsc_hz;
+
+	printf("\r switch_cost: %" PRIu64 " (cyc), %" PRIu64 " (nsec)\n",
+	       switch_cost_cyc, switch_cost_nsec);
+	printf("\r create_run_cost: %" PRIu64 " (cyc), %" PRIu64 " (nsec)\n",
+	       create_cost_cyc, create_cost_nsec);
+
+	spdk_app_stop(0);
+}
+
+static int
+coroutine_perf_end(void *arg)
+{
+	_coroutine_perf_end();
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+coroutine_perf_start(void *arg1)
+{
+	int i;
+
+	printf("Running %d coroutines for %d seconds.\n", g_num_coroutines, g_time_in_sec);
+	fflush(stdout);
+
+	for (i = 0; i < g_num_coroutines; i++) {
+		g_coroutines[i] = spdk_coroutine_create(coroutine_loop, NULL, 0);
+		if (g_coroutines[i] == NULL) {
+			fprintf(stderr, "failed to create coroutine\n");
+			_coroutine_perf_end();
+			return;
+		}
+	}
+
+	g_poller = SPDK_POLLER_REGISTER(coroutine_perf_poll, NULL, 0);
+	g_timer = SPDK_POLLER_REGISTER(coroutine_perf_end, NULL, g_time_in_sec * SPDK_SEC_TO_USEC);
+}
+
+static void
+coroutine_perf_shutdown_cb(void)
+{
+	_coroutine_perf_end();
+}
+
+static int
+coroutine_perf_parse_arg(int ch, char *arg)
+{
+	int tmp;
+
+	tmp = spdk_strtol(optarg, 10);
+	if (tmp < 0) {
+		fprintf(stderr, "Parse failed for the option %c.\n", ch);
+		return tmp;
+	}
+
+	switch (ch) {
+	case 'n':
+		g_num_coroutines = tmp;
+		break;
+	case 't':
+		g_time_in_sec = tmp;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void
+coroutine_perf_usage(void)
+{
+	printf(" -n <number>            number of coroutines\n");
+	printf(" -t <time>              run time in seconds\n");
+}
+
+static int
+coroutine_perf_verify_params(void)
+{
+	if (g_num_coroutines <= 0 || g_num_coroutines > MAX_NUM_COROUTINES) {
+		fprintf(stderr, "number of coroutines must be between 1 and %d\n", MAX_NUM_COROUTINES);
+		return -EINVAL;
+	}
+
+	if (g_time_in_sec <= 0) {
+		fprintf(stderr, "run time must be positive\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct spdk_app_opts opts;
+	int rc;
+
+	spdk_app_opts_init(&opts, sizeof(opts));
+	opts.name = "coroutine_perf";
+	opts.shutdown_cb = coroutine_perf_shutdown_cb;
+
+	rc = spdk_app_parse_args(argc, argv, &opts, "n:t:", NULL,
+				 coroutine_perf_parse_arg, coroutine_perf_usage);
+	if (rc != SPDK_APP_PARSE_ARGS_SUCCESS) {
+		return rc;
+	}
+
+	rc = coroutine_perf_verify_params();
+	if (rc != 0) {
+		return rc;
+	}
+
+	rc = spdk_app_start(&opts, coroutine_perf_start, NULL);
+
+	spdk_app_fini();
+
+	return rc;
+}
@@ -9,7 +9,7 @@
 #include "spdk/thread.h"
 #include "spdk/util.h"
 
-#define MAX_NUM_POLLERS	1000
+#define MAX_NUM_POLLERS	100000
 
 static int g_time_in_sec;
 static int g_period_in_usec;
@@ -18,6 +18,7 @@ static int g_num_pollers;
 static struct spdk_poller *g_timer;
 static struct spdk_poller *g_pollers[MAX_NUM_POLLERS];
 static uint64_t g_run_count;
+static uint64_t g_register_tsc;
 
 static struct spdk_thread_stats g_start_stats;
 
@@ -34,11 +35,21 @@ _poller_perf_end(void)
 {
 	struct spdk_thread_stats end_stats;
 	uint64_t tsc_hz, busy_cyc, poller_cost_cyc, poller_cost_nsec;
+	uint64_t unregister_tsc, register_cost_cyc, register_cost_nsec;
+	uint64_t unregister_cost_cyc, unregister_cost_nsec;
 	int i;
 
 	spdk_thread_get_stats(&end_stats);
 	busy_cyc = end_stats.busy_tsc - g_start_stats.busy_tsc;
 
+	spdk_poller_unregister(&g_timer);
+
+	unregister_tsc = spdk_get_ticks();
+	for (i = 0; i < g_num_pollers; i++) {
+		spdk_poller_unregister(&g_pollers[i]);
+	}
+	unregister_tsc = spdk_get_ticks() - unregister_tsc;
+
 	tsc_hz = spdk_get_ticks_hz();
 
 	printf("\r ======================================\n");
@@ -49,16 +60,22 @@ _poller_perf_end(void)
 
 	printf("\r ======================================\n");
 
-	poller_cost_cyc = busy_cyc / g_run_count;
-	poller_cost_nsec = (poller_cost_cyc * SPDK_SEC_TO_NSEC) / tsc_hz;
+	register_cost_cyc = g_register_tsc / g_num_pollers;
+	register_cost_nsec = (register_cost_cyc * SPDK_SEC_TO_NSEC) / tsc_hz;
+	unregister_cost_cyc = unregister_tsc / g_num_pollers;
+	unregister_cost_nsec = (unregister_cost_cyc * SPDK_SEC_TO_NSEC) / tsc_hz;
 
-	printf("\r poller_cost: %" PRIu64 " (cyc), %" PRIu64 " (nsec)\n",
-	       poller_cost_cyc, poller_cost_nsec);
+	printf("\r register_cost: %" PRIu64 " (cyc), %" PRIu64 " (nsec)\n",
+	       register_cost_cyc, register_cost_nsec);
+	printf("\r unregister_cost: %" PRIu64 " (cyc), %" PRIu64 " (nsec)\n",
+	       unregister_cost_cyc, unregister_cost_nsec);
 
-	spdk_poller_unregister(&g_timer);
+	if (g_run_count > 0) {
+		poller_cost_cyc = busy_cyc / g_run_count;
+		poller_cost_nsec = (poller_cost_cyc * SPDK_SEC_TO_NSEC) / tsc_hz;
 
-	for (i = 0; i < g_num_pollers; i++) {
-		spdk_poller_unregister(&g_pollers[i]);
+		printf("\r poller_cost: %" PRIu64 " (cyc), %" PRIu64 " (nsec)\n",
+		       poller_cost_cyc, poller_cost_nsec);
 	}
 
 	spdk_app_stop(0);
@@ -81,9 +98,11 @@ poller_perf_start(void *arg1)
 	       g_num_pollers, g_time_in_sec, g_period_in_usec);
 	fflush(stdout);
 
+	g_register_tsc = spdk_get_ticks();
 	for (i = 0; i < g_num_pollers; i++) {
 		g_pollers[i] = SPDK_POLLER_REGISTER(poller_run, NULL, g_period_in_usec);
 	}
+	g_register_tsc = spdk_get_ticks() - g_register_tsc;
 
 	spdk_thread_get_stats(&g_start_stats);
 
@@ -10,6 +10,8 @@ source $rootdir/test/common/autotest_common.sh
 
 run_test "thread_poller_perf" $testdir/poller_perf/poller_perf -b 1000 -l 1 -t 1
 run_test "thread_poller_perf" $testdir/poller_perf/poller_perf -b 1000 -l 0 -t 1
+run_test "thread_poller_perf" $testdir/poller_perf/poller_perf -b 100000 -l 1000 -t 1
+run_test "thread_coroutine_perf" $testdir/coroutine_perf/coroutine_perf -n 100 -t 1
 
 # spdk_lock.c includes thread.c, which causes problems when registering the same
 # tracepoint for "thread" in the program and shared library. It is sufficient
@@ -4079,6 +4079,75 @@ test_sequence_crc32(void)
 	poll_threads();
 }
 
+static void
+test_digest_crc32c(void)
+{
+	struct spdk_accel_digest_stats stats = {};
+	struct spdk_io_channel *ioch;
+	struct ut_sequence ut_seq;
+	struct accel_module modules[SPDK_ACCEL_OPC_LAST];
+	char tmp[4096];
+	struct iovec iov;
+	uint32_t crc;
+	int i, rc;
+
+	ioch = spdk_accel_get_io_channel();
+	SPDK_CU_ASSERT_FATAL(ioch != NULL);
+
+	g_module_if.submit_tasks = ut_sequnce_submit_tasks;
+	for (i = 0; i < SPDK_ACCEL_OPC_LAST; ++i) {
+		g_seq_operations[i].submit = sw_accel_submit_tasks;
+		modules[i] = g_modules_opc[i];
+		g_modules_opc[i] = g_module;
+	}
+
+	memset(tmp, 0xa5, sizeof(tmp));
+	iov.iov_base = tmp;
+	iov.iov_len = sizeof(tmp);
+
+	/* Check that the digest is calculated by the module */
+	crc = 0;
+	ut_seq.complete = false;
+	rc = spdk_accel_digest_crc32c(ioch, &crc, &iov, 1, &stats, ut_sequence_complete_cb, &ut_seq);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT(!ut_seq.complete);
+
+	poll_threads();
+	CU_ASSERT(ut_seq.complete);
+	CU_ASSERT_EQUAL(ut_seq.status, 0);
+	CU_ASSERT_EQUAL(g_seq_operations[SPDK_ACCEL_OPC_CRC32C].count, 1);
+	CU_ASSERT_EQUAL(crc, spdk_crc32c_update(tmp, sizeof(tmp), ~0u));
+	CU_ASSERT_EQUAL(stats.offloaded, 1);
+	CU_ASSERT_EQUAL(stats.inlined, 0);
+	g_seq_operations[SPDK_ACCEL_OPC_CRC32C].count = 0;
+
+	/* Without a channel, the digest is calculated inline */
+	crc = 0;
+	ut_seq.complete = false;
+	rc = spdk_accel_digest_crc32c(NULL, &crc, &iov, 1, &stats, ut_sequence_complete_cb, &ut_seq);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT(ut_seq.complete);
+	CU_ASSERT_EQUAL(ut_seq.status, 0);
+	CU_ASSERT_EQUAL(g_seq_operations[SPDK_ACCEL_OPC_CRC32C].count, 0);
+	CU_ASSERT_EQUAL(crc, spdk_crc32c_update(tmp, sizeof(tmp), ~0u));
+	CU_ASSERT_EQUAL(stats.offloaded, 1);
+	CU_ASSERT_EQUAL(stats.inlined, 1);
+
+	/* Check that a missing payload is rejected */
+	ut_seq.complete = false;
+	rc = spdk_accel_digest_crc32c(ioch, &crc, NULL, 0, &stats, ut_sequence_complete_cb, &ut_seq);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	CU_ASSERT(!ut_seq.complete);
+
+	for (i = 0; i < SPDK_ACCEL_OPC_LAST; ++i) {
+		g_modules_opc[i] = modules[i];
+	}
+
+	ut_clear_operations();
+	spdk_put_io_channel(ioch);
+	poll_threads();
+}
+
 static int
 test_sequence_setup(void)
 {
@@ -4165,6 +4234,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(seq_suite, test_sequence_driver);
 	CU_ADD_TEST(seq_suite, test_sequence_same_iovs);
 	CU_ADD_TEST(seq_suite, test_sequence_crc32);
+	CU_ADD_TEST(seq_suite, test_digest_crc32c);
 
 	suite = CU_add_suite("accel", test_setup, test_cleanup);
 	CU_ADD_TEST(suite, test_spdk_accel_task_complete);
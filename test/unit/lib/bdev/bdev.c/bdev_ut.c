@@ -17,21 +17,46 @@
 
 DEFINE_STUB(spdk_notify_send, uint64_t, (const char *type, const char *ctx), 0);
 DEFINE_STUB(spdk_notify_type_register, struct spdk_notify_type *, (const char *type), NULL);
+DEFINE_STUB_V(bdev_part_config_json, (struct spdk_bdev *bdev, struct spdk_json_write_ctx *w));
 DEFINE_STUB(spdk_memory_domain_get_dma_device_id, const char *, (struct spdk_memory_domain *domain),
 	    "test_domain");
 DEFINE_STUB(spdk_memory_domain_get_dma_device_type, enum spdk_dma_device_type,
 	    (struct spdk_memory_domain *domain), 0);
-DEFINE_STUB_V(spdk_accel_sequence_finish,
-	      (struct spdk_accel_sequence *seq, spdk_accel_completion_cb cb_fn, void *cb_arg));
 DEFINE_STUB_V(spdk_accel_sequence_abort, (struct spdk_accel_sequence *seq));
 DEFINE_STUB_V(spdk_accel_sequence_reverse, (struct spdk_accel_sequence *seq));
-DEFINE_STUB(spdk_accel_append_copy, int,
-	    (struct spdk_accel_sequence **seq, struct spdk_io_channel *ch, struct iovec *dst_iovs,
-	     uint32_t dst_iovcnt, struct spdk_memory_domain *dst_domain, void *dst_domain_ctx,
-	     struct iovec *src_iovs, uint32_t src_iovcnt, struct spdk_memory_domain *src_domain,
-	     void *src_domain_ctx, int flags, spdk_accel_step_cb cb_fn, void *cb_arg), 0);
 DEFINE_STUB(spdk_accel_get_memory_domain, struct spdk_memory_domain *, (void), NULL);
 
+void
+spdk_accel_sequence_finish(struct spdk_accel_sequence *seq, spdk_accel_completion_cb cb_fn,
+			   void *cb_arg)
+{
+	cb_fn(cb_arg, 0);
+}
+
+static struct spdk_memory_domain *g_accel_copy_dst_domain;
+static void *g_accel_copy_dst_domain_ctx;
+static struct spdk_memory_domain *g_accel_copy_src_domain;
+static void *g_accel_copy_src_domain_ctx;
+static bool g_accel_copy_called;
+
+DEFINE_RETURN_MOCK(spdk_accel_append_copy, int);
+int
+spdk_accel_append_copy(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+		       struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		       struct spdk_memory_domain *dst_domain, void *dst_domain_ctx,
+		       struct iovec *src_iovs, uint32_t src_iovcnt,
+		       struct spdk_memory_domain *src_domain, void *src_domain_ctx,
+		       int flags, spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	g_accel_copy_called = true;
+	g_accel_copy_dst_domain = dst_domain;
+	g_accel_copy_dst_domain_ctx = dst_domain_ctx;
+	g_accel_copy_src_domain = src_domain;
+	g_accel_copy_src_domain_ctx = src_domain_ctx;
+	HANDLE_RETURN_MOCK(spdk_accel_append_copy);
+	return 0;
+}
+
 static bool g_memory_domain_pull_data_called;
 static bool g_memory_domain_push_data_called;
 static int g_accel_io_device;
@@ -1288,6 +1313,83 @@ bdev_io_wait_test(void)
 	ut_fini_bdev();
 }
 
+static void
+bdev_io_cache_size_test(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_mgmt_channel *mgmt_ch;
+	struct spdk_bdev_opts bdev_opts = {};
+	uint32_t i, j;
+	int rc;
+
+	spdk_bdev_get_opts(&bdev_opts, sizeof(bdev_opts));
+	bdev_opts.bdev_io_pool_size = 512;
+	bdev_opts.bdev_io_cache_size = 64;
+	ut_init_bdev(&bdev_opts);
+
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open_ext("bdev0", true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	SPDK_CU_ASSERT_FATAL(io_ch != NULL);
+	mgmt_ch = __io_ch_to_bdev_ch(io_ch)->shared_resource->mgmt_ch;
+
+	/* The cache starts out fully populated. */
+	CU_ASSERT(mgmt_ch->bdev_io_cache_size == 64);
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 64);
+
+	/* A window of I/O at queue depth 1 shrinks the cache to its minimum size. */
+	for (i = 0; i < SPDK_BDEV_IO_CACHE_WINDOW; i++) {
+		rc = spdk_bdev_read_blocks(desc, io_ch, (void *)0xF000, 0, 1, io_done, NULL);
+		CU_ASSERT(rc == 0);
+		stub_complete_io(1);
+	}
+	CU_ASSERT(mgmt_ch->bdev_io_cache_size == SPDK_BDEV_IO_CACHE_MIN_SIZE);
+	CU_ASSERT(mgmt_ch->io_outstanding == 0);
+
+	/* The surplus is given back to the pool as the I/O complete. */
+	for (i = 0; i < 64; i++) {
+		rc = spdk_bdev_read_blocks(desc, io_ch, (void *)0xF000, 0, 1, io_done, NULL);
+		CU_ASSERT(rc == 0);
+		stub_complete_io(1);
+	}
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == SPDK_BDEV_IO_CACHE_MIN_SIZE);
+
+	/* A higher queue depth grows it again, up to bdev_io_cache_size. */
+	for (i = 0; i < SPDK_BDEV_IO_CACHE_WINDOW / 16; i++) {
+		for (j = 0; j < 16; j++) {
+			rc = spdk_bdev_read_blocks(desc, io_ch, (void *)0xF000, 0, 1, io_done, NULL);
+			CU_ASSERT(rc == 0);
+		}
+		stub_complete_io(16);
+	}
+	CU_ASSERT(mgmt_ch->bdev_io_cache_size == 32);
+
+	for (i = 0; i < SPDK_BDEV_IO_CACHE_WINDOW / 48; i++) {
+		for (j = 0; j < 48; j++) {
+			rc = spdk_bdev_read_blocks(desc, io_ch, (void *)0xF000, 0, 1, io_done, NULL);
+			CU_ASSERT(rc == 0);
+		}
+		stub_complete_io(48);
+	}
+	for (j = 0; j < 48; j++) {
+		rc = spdk_bdev_read_blocks(desc, io_ch, (void *)0xF000, 0, 1, io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	stub_complete_io(48);
+	CU_ASSERT(mgmt_ch->bdev_io_cache_size == 64);
+	CU_ASSERT(mgmt_ch->io_outstanding == 0);
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	ut_fini_bdev();
+}
+
 static void
 bdev_io_spans_split_test(void)
 {
@@ -6094,6 +6196,84 @@ bdev_io_ext_bounce_buffer(void)
 	ut_fini_bdev();
 }
 
+static void
+bdev_io_ext_sequence_stale_memory_domain(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_opts bdev_opts = {};
+	struct spdk_bdev_io *bdev_io;
+	struct spdk_bdev_ext_io_opts ext_io_opts = {
+		.size = sizeof(ext_io_opts)
+	};
+	struct iovec iov;
+	void *buf;
+	int rc;
+
+	spdk_bdev_get_opts(&bdev_opts, sizeof(bdev_opts));
+	bdev_opts.bdev_io_pool_size = 4;
+	bdev_opts.bdev_io_cache_size = 1;
+	ut_init_bdev(&bdev_opts);
+
+	fn_table.submit_request = stub_submit_request_get_buf;
+	bdev = allocate_bdev("bdev0");
+	bdev->required_alignment = spdk_u32log2(512);
+
+	rc = spdk_bdev_open_ext("bdev0", true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+
+	rc = posix_memalign(&buf, 4096, 8192);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	/* Use the bdev_io with a memory domain first.  The bdev doesn't support memory domains,
+	 * so the data is pulled into a bounce buffer. */
+	ext_io_opts.memory_domain = (struct spdk_memory_domain *)0xdeadbeef;
+	ext_io_opts.memory_domain_ctx = (void *)0xbeefdead;
+	g_io_done = false;
+	g_memory_domain_pull_data_called = false;
+	iov.iov_base = buf;
+	iov.iov_len = 512;
+	rc = spdk_bdev_writev_blocks_ext(desc, io_ch, &iov, 1, 0, 1, io_done, NULL, &ext_io_opts);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_memory_domain_pull_data_called == true);
+	bdev_io = g_bdev_io;
+	stub_complete_io(1);
+	CU_ASSERT(g_io_done == true);
+
+	/* Then reuse it for an unaligned read with an accel sequence, but without a memory
+	 * domain.  The copy appended to the sequence mustn't see the previous I/O's domain. */
+	ext_io_opts.memory_domain = NULL;
+	ext_io_opts.memory_domain_ctx = NULL;
+	ext_io_opts.accel_sequence = (struct spdk_accel_sequence *)0xfeedbeef;
+	g_io_done = false;
+	g_accel_copy_called = false;
+	g_accel_copy_src_domain = (struct spdk_memory_domain *)0x1;
+	g_accel_copy_src_domain_ctx = (void *)0x1;
+	iov.iov_base = (char *)buf + 4;
+	rc = spdk_bdev_readv_blocks_ext(desc, io_ch, &iov, 1, 0, 1, io_done, NULL, &ext_io_opts);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_io == bdev_io);
+	CU_ASSERT(g_bdev_io->internal.orig_iovcnt == 1);
+	CU_ASSERT(g_accel_copy_called == true);
+	CU_ASSERT(g_accel_copy_src_domain == NULL);
+	CU_ASSERT(g_accel_copy_src_domain_ctx == NULL);
+	CU_ASSERT(g_accel_copy_dst_domain == NULL);
+	CU_ASSERT(g_accel_copy_dst_domain_ctx == NULL);
+	stub_complete_io(1);
+	CU_ASSERT(g_io_done == true);
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	free(buf);
+	fn_table.submit_request = stub_submit_request;
+	ut_fini_bdev();
+}
+
 static void
 bdev_register_uuid_alias(void)
 {
@@ -7369,6 +7549,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, get_device_stat_test);
 	CU_ADD_TEST(suite, bdev_io_types_test);
 	CU_ADD_TEST(suite, bdev_io_wait_test);
+	CU_ADD_TEST(suite, bdev_io_cache_size_test);
 	CU_ADD_TEST(suite, bdev_io_spans_split_test);
 	CU_ADD_TEST(suite, bdev_io_boundary_split_test);
 	CU_ADD_TEST(suite, bdev_io_max_size_and_segment_split_test);
@@ -7405,6 +7586,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, bdev_io_ext_invalid_opts);
 	CU_ADD_TEST(suite, bdev_io_ext_split);
 	CU_ADD_TEST(suite, bdev_io_ext_bounce_buffer);
+	CU_ADD_TEST(suite, bdev_io_ext_sequence_stale_memory_domain);
 	CU_ADD_TEST(suite, bdev_register_uuid_alias);
 	CU_ADD_TEST(suite, bdev_unregister_by_name);
 	CU_ADD_TEST(suite, for_each_bdev_test);
@@ -0,0 +1,619 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_internal/cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+
+#include "common/lib/ut_multithread.c"
+
+/* The shards run on the threads allocated by the test */
+struct spdk_thread *ut_cache_thread_create(const char *name, const struct spdk_cpuset *cpumask);
+int ut_cache_thread_exit(struct spdk_thread *thread);
+#define spdk_thread_create ut_cache_thread_create
+#define spdk_thread_exit ut_cache_thread_exit
+#include "bdev/cache/vbdev_cache.c"
+#undef spdk_thread_create
+#undef spdk_thread_exit
+
+#include "../vbdev_common.c"
+
+#define UT_CORE_BLOCKS		4096
+#define UT_CACHE_BLOCKS		512
+#define UT_LINE_SIZE_KB		4
+#define UT_LINE_BLOCKS		(UT_LINE_SIZE_KB * 1024 / UT_BLOCK_SIZE)
+#define UT_NUM_SHARDS		2
+
+static struct ut_base_bdev g_core;
+static struct ut_base_bdev g_cache;
+static uint32_t g_next_thread;
+static struct spdk_bdev *g_created_bdev;
+static int g_create_status;
+static int g_flush_status;
+static bool g_flush_done;
+
+struct spdk_thread *
+ut_cache_thread_create(const char *name, const struct spdk_cpuset *cpumask)
+{
+	SPDK_CU_ASSERT_FATAL(g_next_thread < g_ut_num_threads);
+	return g_ut_threads[g_next_thread++].thread;
+}
+
+int
+ut_cache_thread_exit(struct spdk_thread *thread)
+{
+	return 0;
+}
+
+static void
+ut_fill_pattern(uint8_t *buf, uint64_t offset_blocks, uint64_t num_blocks, uint8_t seed)
+{
+	uint64_t i;
+
+	for (i = 0; i < num_blocks * UT_BLOCK_SIZE; i++) {
+		buf[i] = (uint8_t)(seed + (offset_blocks * UT_BLOCK_SIZE + i) / 7);
+	}
+}
+
+static int
+test_setup(void)
+{
+	ut_base_bdev_init(&g_core, "core", UT_CORE_BLOCKS);
+	ut_base_bdev_init(&g_cache, "cache", UT_CACHE_BLOCKS);
+	ut_fill_pattern(g_core.data, 0, UT_CORE_BLOCKS, 0);
+	ut_vbdev_setup(1 + UT_NUM_SHARDS);
+
+	return 0;
+}
+
+static int
+test_cleanup(void)
+{
+	ut_vbdev_cleanup();
+	ut_base_bdev_fini(&g_core);
+	ut_base_bdev_fini(&g_cache);
+
+	return 0;
+}
+
+static void
+ut_create_cb(void *cb_arg, struct spdk_bdev *bdev, int rc)
+{
+	g_created_bdev = bdev;
+	g_create_status = rc;
+}
+
+static struct vbdev_cache *
+ut_cache_create(enum vbdev_cache_mode mode, uint32_t seq_cutoff_kb)
+{
+	struct vbdev_cache_opts opts;
+	int rc;
+
+	vbdev_cache_get_default_opts(&opts);
+	opts.name = "cache0";
+	opts.core_bdev_name = "core";
+	opts.cache_bdev_name = "cache";
+	opts.mode = mode;
+	opts.line_size_kb = UT_LINE_SIZE_KB;
+	opts.num_shards = UT_NUM_SHARDS;
+	opts.seq_cutoff_kb = seq_cutoff_kb;
+
+	g_next_thread = 1;
+	g_created_bdev = NULL;
+	g_create_status = 1;
+
+	set_thread(UT_SUBMIT_THREAD);
+	rc = vbdev_cache_create(&opts, ut_create_cb, NULL);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(g_create_status == 0);
+	SPDK_CU_ASSERT_FATAL(g_created_bdev != NULL);
+
+	return SPDK_CONTAINEROF(g_created_bdev, struct vbdev_cache, bdev);
+}
+
+static void
+ut_cache_delete(struct vbdev_cache *cache)
+{
+	int rc;
+
+	set_thread(UT_SUBMIT_THREAD);
+	g_destruct_done = false;
+	rc = vbdev_cache_destruct(cache);
+	CU_ASSERT(rc == 1);
+	poll_threads();
+	CU_ASSERT(g_destruct_done == true);
+}
+
+static int
+ut_submit(struct vbdev_cache *cache, enum spdk_bdev_io_type type, void *buf,
+	  uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+	struct spdk_io_channel *ch;
+	int status;
+
+	set_thread(UT_SUBMIT_THREAD);
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct cache_bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = &cache->bdev;
+	bdev_io->type = type;
+	bdev_io->iov.iov_base = buf;
+	bdev_io->iov.iov_len = num_blocks * UT_BLOCK_SIZE;
+	bdev_io->u.bdev.iovs = &bdev_io->iov;
+	bdev_io->u.bdev.iovcnt = 1;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->internal.in_submit_request = true;
+	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+
+	ch = spdk_get_io_channel(cache);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	vbdev_cache_submit_request(ch, bdev_io);
+	poll_threads();
+
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	status = bdev_io->internal.status;
+	set_thread(UT_SUBMIT_THREAD);
+	spdk_put_io_channel(ch);
+	poll_threads();
+	free(bdev_io);
+
+	return status;
+}
+
+static uint64_t
+ut_cache_line_offset(struct vbdev_cache *cache, uint64_t core_line)
+{
+	struct cache_shard *shard = &cache->shards[core_line % cache->num_shards];
+	struct cache_line *line = cache_shard_lookup(shard, core_line);
+
+	SPDK_CU_ASSERT_FATAL(line != NULL);
+	return cache_line_data_offset(shard, line);
+}
+
+static struct cache_md_entry *
+ut_md_entry_on_disk(struct vbdev_cache *cache, uint64_t core_line)
+{
+	struct cache_shard *shard = &cache->shards[core_line % cache->num_shards];
+	struct cache_line *line = cache_shard_lookup(shard, core_line);
+	uint64_t offset_blocks = cache_shard_md_offset(shard);
+
+	SPDK_CU_ASSERT_FATAL(line != NULL);
+	return (struct cache_md_entry *)(g_cache.data + offset_blocks * UT_BLOCK_SIZE) +
+	       cache_line_idx(shard, line);
+}
+
+static void
+ut_flush_cb(void *cb_arg, int rc)
+{
+	g_flush_done = true;
+	g_flush_status = rc;
+}
+
+static void
+ut_cache_flush(struct vbdev_cache *cache)
+{
+	int rc;
+
+	set_thread(UT_SUBMIT_THREAD);
+	g_flush_done = false;
+	rc = vbdev_cache_flush("cache0", ut_flush_cb, NULL);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(g_flush_done == true);
+	CU_ASSERT(g_flush_status == 0);
+}
+
+static void
+test_cache_create(void)
+{
+	struct vbdev_cache *cache;
+	struct cache_sb *sb = (struct cache_sb *)g_cache.data;
+	uint64_t md_end;
+
+	memset(g_cache.data, 0xaa, UT_CACHE_BLOCKS * UT_BLOCK_SIZE);
+
+	cache = ut_cache_create(VBDEV_CACHE_MODE_WB, 0);
+	CU_ASSERT(cache->line_blocks == UT_LINE_BLOCKS);
+	CU_ASSERT(cache->num_core_lines == UT_CORE_BLOCKS / UT_LINE_BLOCKS);
+	CU_ASSERT(cache->bdev.blockcnt == UT_CORE_BLOCKS);
+	CU_ASSERT(cache->bdev.optimal_io_boundary == UT_LINE_BLOCKS);
+	CU_ASSERT(cache->bdev.split_on_optimal_io_boundary == true);
+
+	/* The layout fits in the cache bdev and uses most of it */
+	md_end = cache->md_offset_blocks + cache->num_shards * cache->md_blocks_per_shard;
+	CU_ASSERT(md_end <= cache->data_offset_blocks);
+	CU_ASSERT(cache->data_offset_blocks % UT_LINE_BLOCKS == 0);
+	CU_ASSERT(cache->data_offset_blocks + (uint64_t)cache->num_shards * cache->lines_per_shard *
+		  UT_LINE_BLOCKS <= UT_CACHE_BLOCKS);
+	CU_ASSERT(cache->data_offset_blocks + (uint64_t)cache->num_shards *
+		  (cache->lines_per_shard + 1) * UT_LINE_BLOCKS > UT_CACHE_BLOCKS);
+
+	/* The superblock is valid and the metadata has been cleared */
+	CU_ASSERT(cache_sb_is_valid(sb));
+	CU_ASSERT(spdk_uuid_compare(&sb->core_uuid, &g_core.bdev.uuid) == 0);
+	CU_ASSERT(sb->lines_per_shard == cache->lines_per_shard);
+	CU_ASSERT(spdk_mem_all_zero(g_cache.data + cache->md_offset_blocks * UT_BLOCK_SIZE,
+				    (md_end - cache->md_offset_blocks) * UT_BLOCK_SIZE));
+
+	ut_cache_delete(cache);
+}
+
+static void
+test_cache_read(void)
+{
+	struct vbdev_cache *cache;
+	uint8_t buf[UT_LINE_BLOCKS * UT_BLOCK_SIZE], expected[UT_LINE_BLOCKS * UT_BLOCK_SIZE];
+	uint64_t core_line = 5, offset_blocks = core_line * UT_LINE_BLOCKS + 2;
+	uint32_t core_reads;
+	int status;
+
+	cache = ut_cache_create(VBDEV_CACHE_MODE_WB, 0);
+
+	/* Miss: the whole line is read from the core bdev and written to the cache bdev */
+	core_reads = g_core.num_reads;
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_READ, buf, offset_blocks, 4);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_core.num_reads == core_reads + 1);
+	CU_ASSERT(memcmp(buf, g_core.data + offset_blocks * UT_BLOCK_SIZE, 4 * UT_BLOCK_SIZE) == 0);
+	CU_ASSERT(memcmp(g_cache.data + ut_cache_line_offset(cache, core_line) * UT_BLOCK_SIZE,
+			 g_core.data + core_line * UT_LINE_BLOCKS * UT_BLOCK_SIZE,
+			 UT_LINE_BLOCKS * UT_BLOCK_SIZE) == 0);
+	CU_ASSERT(cache->shards[core_line % UT_NUM_SHARDS].stats.read_misses == 1);
+
+	/* Hit: served by the cache bdev, change the core bdev to make sure */
+	memset(g_core.data + core_line * UT_LINE_BLOCKS * UT_BLOCK_SIZE, 0xff,
+	       UT_LINE_BLOCKS * UT_BLOCK_SIZE);
+	ut_fill_pattern(expected, core_line * UT_LINE_BLOCKS, UT_LINE_BLOCKS, 0);
+	core_reads = g_core.num_reads;
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_READ, buf, core_line * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_core.num_reads == core_reads);
+	CU_ASSERT(memcmp(buf, expected, sizeof(buf)) == 0);
+	CU_ASSERT(cache->shards[core_line % UT_NUM_SHARDS].stats.read_hits == 1);
+	ut_fill_pattern(g_core.data, core_line * UT_LINE_BLOCKS, UT_LINE_BLOCKS, 0);
+
+	ut_cache_delete(cache);
+}
+
+static void
+test_cache_write_back(void)
+{
+	struct vbdev_cache *cache;
+	struct cache_md_entry *entry;
+	uint8_t buf[UT_LINE_BLOCKS * UT_BLOCK_SIZE], core[UT_LINE_BLOCKS * UT_BLOCK_SIZE];
+	uint64_t core_line = 8;
+	int status;
+
+	cache = ut_cache_create(VBDEV_CACHE_MODE_WB, 0);
+
+	/* A full line write miss is cached and marked dirty on disk */
+	memcpy(core, g_core.data + core_line * UT_LINE_BLOCKS * UT_BLOCK_SIZE, sizeof(core));
+	ut_fill_pattern(buf, core_line * UT_LINE_BLOCKS, UT_LINE_BLOCKS, 0x55);
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_WRITE, buf, core_line * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(g_core.data + core_line * UT_LINE_BLOCKS * UT_BLOCK_SIZE, core,
+			 sizeof(core)) == 0);
+	CU_ASSERT(memcmp(g_cache.data + ut_cache_line_offset(cache, core_line) * UT_BLOCK_SIZE, buf,
+			 sizeof(buf)) == 0);
+	entry = ut_md_entry_on_disk(cache, core_line);
+	CU_ASSERT(entry->core_line == core_line);
+	CU_ASSERT(entry->flags == CACHE_MD_ENTRY_DIRTY);
+	CU_ASSERT(cache->shards[core_line % UT_NUM_SHARDS].num_dirty == 1);
+
+	/* A partial write of the dirty line stays in the cache */
+	memset(buf, 0x77, UT_BLOCK_SIZE);
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_WRITE, buf, core_line * UT_LINE_BLOCKS + 3, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(g_core.data + core_line * UT_LINE_BLOCKS * UT_BLOCK_SIZE, core,
+			 sizeof(core)) == 0);
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_READ, buf, core_line * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	ut_fill_pattern(core, core_line * UT_LINE_BLOCKS, UT_LINE_BLOCKS, 0x55);
+	memset(core + 3 * UT_BLOCK_SIZE, 0x77, UT_BLOCK_SIZE);
+	CU_ASSERT(memcmp(buf, core, sizeof(buf)) == 0);
+
+	/* A partial write miss goes around the cache */
+	memset(buf, 0x33, UT_BLOCK_SIZE);
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_WRITE, buf,
+			   (core_line + 1) * UT_LINE_BLOCKS, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(g_core.data + (core_line + 1) * UT_LINE_BLOCKS * UT_BLOCK_SIZE, buf,
+			 UT_BLOCK_SIZE) == 0);
+	CU_ASSERT(cache_shard_lookup(&cache->shards[(core_line + 1) % UT_NUM_SHARDS],
+				     core_line + 1) == NULL);
+
+	/* Flush destages the dirty line and marks it clean on disk */
+	ut_cache_flush(cache);
+	CU_ASSERT(memcmp(g_core.data + core_line * UT_LINE_BLOCKS * UT_BLOCK_SIZE, core,
+			 sizeof(core)) == 0);
+	CU_ASSERT(entry->flags == 0);
+	CU_ASSERT(cache->shards[core_line % UT_NUM_SHARDS].num_dirty == 0);
+	CU_ASSERT(cache->shards[core_line % UT_NUM_SHARDS].stats.destaged_lines == 1);
+
+	ut_cache_delete(cache);
+	ut_fill_pattern(g_core.data, 0, UT_CORE_BLOCKS, 0);
+}
+
+static void
+test_cache_destage_poller(void)
+{
+	struct vbdev_cache *cache;
+	struct cache_shard *shard;
+	uint8_t buf[UT_LINE_BLOCKS * UT_BLOCK_SIZE];
+	uint64_t core_line = 3;
+	int status;
+
+	cache = ut_cache_create(VBDEV_CACHE_MODE_WB, 0);
+	shard = &cache->shards[core_line % UT_NUM_SHARDS];
+
+	ut_fill_pattern(buf, core_line * UT_LINE_BLOCKS, UT_LINE_BLOCKS, 0x11);
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_WRITE, buf, core_line * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(shard->num_dirty == 1);
+
+	/* The first poll sees the write, the next one destages the line of the idle shard */
+	spdk_delay_us(CACHE_DESTAGE_POLL_PERIOD_US);
+	poll_threads();
+	CU_ASSERT(shard->num_dirty == 1);
+	spdk_delay_us(CACHE_DESTAGE_POLL_PERIOD_US);
+	poll_threads();
+	CU_ASSERT(shard->num_dirty == 0);
+	CU_ASSERT(memcmp(g_core.data + core_line * UT_LINE_BLOCKS * UT_BLOCK_SIZE, buf,
+			 sizeof(buf)) == 0);
+
+	/* Failed destages keep the line dirty */
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_WRITE, buf, core_line * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(shard->num_dirty == 1);
+	g_core.fail_writes = true;
+	spdk_delay_us(CACHE_DESTAGE_POLL_PERIOD_US);
+	poll_threads();
+	spdk_delay_us(CACHE_DESTAGE_POLL_PERIOD_US);
+	poll_threads();
+	CU_ASSERT(shard->num_dirty == 1);
+	CU_ASSERT(shard->stats.destage_errors == 1);
+	g_core.fail_writes = false;
+	ut_cache_flush(cache);
+	CU_ASSERT(shard->num_dirty == 0);
+
+	ut_cache_delete(cache);
+	ut_fill_pattern(g_core.data, 0, UT_CORE_BLOCKS, 0);
+}
+
+static void
+test_cache_recovery(void)
+{
+	struct vbdev_cache_opts opts;
+	struct vbdev_cache *cache;
+	struct cache_shard *shard;
+	uint8_t buf[UT_LINE_BLOCKS * UT_BLOCK_SIZE], data[UT_LINE_BLOCKS * UT_BLOCK_SIZE];
+	uint64_t dirty_line = 10, clean_line = 11;
+	int status;
+
+	cache = ut_cache_create(VBDEV_CACHE_MODE_WB, 0);
+
+	ut_fill_pattern(data, dirty_line * UT_LINE_BLOCKS, UT_LINE_BLOCKS, 0x99);
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_WRITE, data, dirty_line * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_READ, buf, clean_line * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	ut_cache_delete(cache);
+
+	/* The dirty line is recovered, the clean one is dropped */
+	cache = ut_cache_create(VBDEV_CACHE_MODE_WB, 0);
+	CU_ASSERT(cache->shards[dirty_line % UT_NUM_SHARDS].num_dirty == 1);
+	shard = &cache->shards[dirty_line % UT_NUM_SHARDS];
+	CU_ASSERT(cache_shard_lookup(shard, dirty_line) != NULL);
+	shard = &cache->shards[clean_line % UT_NUM_SHARDS];
+	CU_ASSERT(cache_shard_lookup(shard, clean_line) == NULL);
+
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_READ, buf, dirty_line * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, data, sizeof(buf)) == 0);
+
+	ut_cache_flush(cache);
+	CU_ASSERT(memcmp(g_core.data + dirty_line * UT_LINE_BLOCKS * UT_BLOCK_SIZE, data,
+			 sizeof(data)) == 0);
+	ut_cache_delete(cache);
+
+	/* A cache bdev holding the data of another core bdev is not reused */
+	spdk_uuid_generate(&g_core.bdev.uuid);
+	g_next_thread = 1;
+	g_create_status = 0;
+	vbdev_cache_get_default_opts(&opts);
+	opts.name = "cache0";
+	opts.core_bdev_name = "core";
+	opts.cache_bdev_name = "cache";
+	set_thread(UT_SUBMIT_THREAD);
+	CU_ASSERT(vbdev_cache_create(&opts, ut_create_cb, NULL) == 0);
+	poll_threads();
+	CU_ASSERT(g_create_status == -EEXIST);
+
+	ut_fill_pattern(g_core.data, 0, UT_CORE_BLOCKS, 0);
+}
+
+static void
+test_cache_write_through(void)
+{
+	struct vbdev_cache *cache;
+	uint8_t buf[UT_LINE_BLOCKS * UT_BLOCK_SIZE];
+	uint64_t core_line = 7;
+	int status;
+
+	memset(g_cache.data, 0, UT_CACHE_BLOCKS * UT_BLOCK_SIZE);
+	cache = ut_cache_create(VBDEV_CACHE_MODE_WT, 0);
+
+	/* Misses are not cached */
+	ut_fill_pattern(buf, core_line * UT_LINE_BLOCKS, UT_LINE_BLOCKS, 0x21);
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_WRITE, buf, core_line * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(cache_shard_lookup(&cache->shards[core_line % UT_NUM_SHARDS], core_line) == NULL);
+	CU_ASSERT(memcmp(g_core.data + core_line * UT_LINE_BLOCKS * UT_BLOCK_SIZE, buf,
+			 sizeof(buf)) == 0);
+
+	/* Hits update both bdevs and the line stays clean */
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_READ, buf, core_line * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	memset(buf, 0x42, UT_BLOCK_SIZE);
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_WRITE, buf, core_line * UT_LINE_BLOCKS, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(g_core.data + core_line * UT_LINE_BLOCKS * UT_BLOCK_SIZE, buf,
+			 UT_BLOCK_SIZE) == 0);
+	CU_ASSERT(memcmp(g_cache.data + ut_cache_line_offset(cache, core_line) * UT_BLOCK_SIZE, buf,
+			 UT_BLOCK_SIZE) == 0);
+	CU_ASSERT(cache->shards[core_line % UT_NUM_SHARDS].num_dirty == 0);
+
+	ut_cache_delete(cache);
+	ut_fill_pattern(g_core.data, 0, UT_CORE_BLOCKS, 0);
+}
+
+static void
+test_cache_seq_bypass(void)
+{
+	struct vbdev_cache *cache;
+	struct spdk_io_channel *ch;
+	uint8_t buf[UT_LINE_BLOCKS * UT_BLOCK_SIZE];
+	uint64_t i, start_line = 20;
+	uint32_t num_lines = 6;
+	int status;
+
+	memset(g_cache.data, 0, UT_CACHE_BLOCKS * UT_BLOCK_SIZE);
+	/* The cutoff is reached on the third line */
+	cache = ut_cache_create(VBDEV_CACHE_MODE_WB, 3 * UT_LINE_SIZE_KB);
+	/* The streams are tracked per channel, keep it around between the I/Os */
+	ch = spdk_get_io_channel(cache);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	for (i = start_line; i < start_line + num_lines; i++) {
+		status = ut_submit(cache, SPDK_BDEV_IO_TYPE_READ, buf, i * UT_LINE_BLOCKS,
+				   UT_LINE_BLOCKS);
+		CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(memcmp(buf, g_core.data + i * UT_LINE_BLOCKS * UT_BLOCK_SIZE,
+				 sizeof(buf)) == 0);
+		CU_ASSERT((cache_shard_lookup(&cache->shards[i % UT_NUM_SHARDS], i) != NULL) ==
+			  (i < start_line + 2));
+	}
+
+	/* Random reads are still cached */
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_READ, buf, 100 * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(cache_shard_lookup(&cache->shards[100 % UT_NUM_SHARDS], 100) != NULL);
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_cache_delete(cache);
+}
+
+static void
+test_cache_unmap(void)
+{
+	struct vbdev_cache *cache;
+	struct cache_shard *shard;
+	struct cache_md_entry *entry;
+	uint8_t buf[UT_LINE_BLOCKS * UT_BLOCK_SIZE];
+	uint64_t core_line = 12;
+	int status;
+
+	memset(g_cache.data, 0, UT_CACHE_BLOCKS * UT_BLOCK_SIZE);
+	cache = ut_cache_create(VBDEV_CACHE_MODE_WB, 0);
+	shard = &cache->shards[core_line % UT_NUM_SHARDS];
+
+	ut_fill_pattern(buf, core_line * UT_LINE_BLOCKS, UT_LINE_BLOCKS, 0x66);
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_WRITE, buf, core_line * UT_LINE_BLOCKS,
+			   UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	entry = ut_md_entry_on_disk(cache, core_line);
+
+	/* A partial unmap of a dirty line zeroes its part of the line */
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_UNMAP, NULL, core_line * UT_LINE_BLOCKS + 1, 2);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(shard->num_dirty == 1);
+	CU_ASSERT(spdk_mem_all_zero(g_cache.data + (ut_cache_line_offset(cache, core_line) + 1) *
+				    UT_BLOCK_SIZE, 2 * UT_BLOCK_SIZE));
+
+	/* Unmapping the whole line drops it and clears its metadata entry */
+	status = ut_submit(cache, SPDK_BDEV_IO_TYPE_UNMAP, NULL, (core_line - 1) * UT_LINE_BLOCKS,
+			   3 * UT_LINE_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(cache_shard_lookup(shard, core_line) == NULL);
+	CU_ASSERT(shard->num_dirty == 0);
+	CU_ASSERT(entry->flags == 0);
+	CU_ASSERT(spdk_mem_all_zero(g_core.data + (core_line - 1) * UT_LINE_BLOCKS * UT_BLOCK_SIZE,
+				    3 * UT_LINE_BLOCKS * UT_BLOCK_SIZE));
+
+	ut_cache_delete(cache);
+	ut_fill_pattern(g_core.data, 0, UT_CORE_BLOCKS, 0);
+}
+
+static void
+test_cache_eviction(void)
+{
+	struct vbdev_cache *cache;
+	uint8_t buf[UT_LINE_BLOCKS * UT_BLOCK_SIZE];
+	uint64_t i, num_lines;
+	uint64_t evictions = 0;
+	int status;
+
+	memset(g_cache.data, 0, UT_CACHE_BLOCKS * UT_BLOCK_SIZE);
+	cache = ut_cache_create(VBDEV_CACHE_MODE_WB, 0);
+	num_lines = (uint64_t)cache->num_shards * cache->lines_per_shard;
+
+	/* Read twice as many lines as the cache holds, the oldest ones are evicted */
+	for (i = 0; i < 2 * num_lines; i++) {
+		status = ut_submit(cache, SPDK_BDEV_IO_TYPE_READ, buf, i * UT_LINE_BLOCKS,
+				   UT_LINE_BLOCKS);
+		CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(memcmp(buf, g_core.data + i * UT_LINE_BLOCKS * UT_BLOCK_SIZE,
+				 sizeof(buf)) == 0);
+	}
+
+	for (i = 0; i < UT_NUM_SHARDS; i++) {
+		evictions += cache->shards[i].stats.evictions;
+	}
+	CU_ASSERT(evictions == num_lines);
+	CU_ASSERT(cache_shard_lookup(&cache->shards[0], 0) == NULL);
+	CU_ASSERT(cache_shard_lookup(&cache->shards[(2 * num_lines - 1) % UT_NUM_SHARDS],
+				     2 * num_lines - 1) != NULL);
+
+	ut_cache_delete(cache);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("cache", test_setup, test_cleanup);
+	CU_ADD_TEST(suite, test_cache_create);
+	CU_ADD_TEST(suite, test_cache_read);
+	CU_ADD_TEST(suite, test_cache_write_back);
+	CU_ADD_TEST(suite, test_cache_destage_poller);
+	CU_ADD_TEST(suite, test_cache_recovery);
+	CU_ADD_TEST(suite, test_cache_write_through);
+	CU_ADD_TEST(suite, test_cache_seq_bypass);
+	CU_ADD_TEST(suite, test_cache_unmap);
+	CU_ADD_TEST(suite, test_cache_eviction);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+	CU_cleanup_registry();
+	return num_failures;
+}
@@ -0,0 +1,715 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_internal/cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+
+#include "common/lib/ut_multithread.c"
+
+/* The metadata thread runs on a thread allocated by the test */
+struct spdk_thread *ut_dedupe_thread_create(const char *name, const struct spdk_cpuset *cpumask);
+int ut_dedupe_thread_exit(struct spdk_thread *thread);
+#define spdk_thread_create ut_dedupe_thread_create
+#define spdk_thread_exit ut_dedupe_thread_exit
+#include "bdev/dedupe/vbdev_dedupe.c"
+#undef spdk_thread_create
+#undef spdk_thread_exit
+
+#include "../vbdev_common.c"
+
+#define UT_CHUNK_BLOCKS		(DEDUPE_CHUNK_SIZE / UT_BLOCK_SIZE)
+#define UT_BASE_CHUNKS		128
+#define UT_BASE_BLOCKS		(UT_BASE_CHUNKS * UT_CHUNK_BLOCKS)
+#define UT_NUM_BLOCKS		256
+#define UT_MD_THREAD		1
+
+static struct ut_base_bdev g_base;
+static struct spdk_bdev *g_created_bdev;
+static int g_create_status;
+
+struct spdk_thread *
+ut_dedupe_thread_create(const char *name, const struct spdk_cpuset *cpumask)
+{
+	return g_ut_threads[UT_MD_THREAD].thread;
+}
+
+int
+ut_dedupe_thread_exit(struct spdk_thread *thread)
+{
+	return 0;
+}
+
+static void
+ut_fill_pattern(uint8_t *buf, uint8_t seed)
+{
+	uint32_t i;
+
+	for (i = 0; i < DEDUPE_CHUNK_SIZE; i++) {
+		buf[i] = (uint8_t)(seed + i / 7);
+	}
+}
+
+static int
+test_setup(void)
+{
+	ut_base_bdev_init(&g_base, "base", UT_BASE_BLOCKS);
+	ut_vbdev_setup(2);
+
+	return 0;
+}
+
+static int
+test_cleanup(void)
+{
+	ut_vbdev_cleanup();
+	ut_base_bdev_fini(&g_base);
+
+	return 0;
+}
+
+static void
+ut_create_cb(void *cb_arg, struct spdk_bdev *bdev, int rc)
+{
+	g_created_bdev = bdev;
+	g_create_status = rc;
+}
+
+static struct vbdev_dedupe *
+ut_dedupe_create(uint64_t num_blocks, uint32_t latency_budget_us)
+{
+	struct vbdev_dedupe_opts opts;
+	int rc;
+
+	vbdev_dedupe_get_default_opts(&opts);
+	opts.name = "dedupe0";
+	opts.base_bdev_name = "base";
+	opts.num_blocks = num_blocks;
+	opts.latency_budget_us = latency_budget_us;
+
+	g_created_bdev = NULL;
+	g_create_status = 1;
+
+	set_thread(UT_SUBMIT_THREAD);
+	rc = vbdev_dedupe_create(&opts, ut_create_cb, NULL);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(g_create_status == 0);
+	SPDK_CU_ASSERT_FATAL(g_created_bdev != NULL);
+
+	return SPDK_CONTAINEROF(g_created_bdev, struct vbdev_dedupe, bdev);
+}
+
+static void
+ut_dedupe_delete(struct vbdev_dedupe *dedupe)
+{
+	int rc;
+
+	set_thread(UT_SUBMIT_THREAD);
+	g_destruct_done = false;
+	rc = vbdev_dedupe_destruct(dedupe);
+	CU_ASSERT(rc == 1);
+	poll_threads();
+	CU_ASSERT(g_destruct_done == true);
+}
+
+static struct spdk_bdev_io *
+ut_io_alloc(struct vbdev_dedupe *dedupe, enum spdk_bdev_io_type type, struct iovec *iovs,
+	    int iovcnt, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct dedupe_bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = &dedupe->bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.iovs = iovs;
+	bdev_io->u.bdev.iovcnt = iovcnt;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->internal.in_submit_request = true;
+	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+
+	return bdev_io;
+}
+
+/* Submit an I/O without processing it */
+static void
+ut_io_start(struct vbdev_dedupe *dedupe, struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_io_channel *ch;
+
+	set_thread(UT_SUBMIT_THREAD);
+	ch = spdk_get_io_channel(dedupe);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	bdev_io->internal.ch = spdk_io_channel_get_ctx(ch);
+	vbdev_dedupe_submit_request(ch, bdev_io);
+	spdk_put_io_channel(ch);
+}
+
+static int
+ut_io_end(struct spdk_bdev_io *bdev_io)
+{
+	int status;
+
+	poll_threads();
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	status = bdev_io->internal.status;
+	free(bdev_io);
+
+	return status;
+}
+
+static int
+ut_submit_iovs(struct vbdev_dedupe *dedupe, enum spdk_bdev_io_type type, struct iovec *iovs,
+	       int iovcnt, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	bdev_io = ut_io_alloc(dedupe, type, iovs, iovcnt, offset_blocks, num_blocks);
+	ut_io_start(dedupe, bdev_io);
+
+	return ut_io_end(bdev_io);
+}
+
+static int
+ut_submit(struct vbdev_dedupe *dedupe, enum spdk_bdev_io_type type, void *buf,
+	  uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct iovec iov = { .iov_base = buf, .iov_len = num_blocks * DEDUPE_CHUNK_SIZE };
+
+	return ut_submit_iovs(dedupe, type, &iov, 1, offset_blocks, num_blocks);
+}
+
+static uint8_t *
+ut_chunk_data(struct vbdev_dedupe *dedupe, uint32_t chunk)
+{
+	return g_base.data + dedupe_chunk_offset(dedupe, chunk) * UT_BLOCK_SIZE;
+}
+
+static uint32_t
+ut_map_on_disk(struct vbdev_dedupe *dedupe, uint64_t offset_blocks)
+{
+	uint32_t *map = (uint32_t *)(g_base.data + dedupe->map_offset * DEDUPE_CHUNK_SIZE);
+
+	return map[offset_blocks];
+}
+
+static void
+test_dedupe_create(void)
+{
+	struct vbdev_dedupe *dedupe;
+	struct dedupe_sb *sb = (struct dedupe_sb *)g_base.data;
+	uint64_t map_md_blocks, fp_md_blocks;
+
+	memset(g_base.data, 0xaa, UT_BASE_BLOCKS * UT_BLOCK_SIZE);
+
+	/* By default the dedupe vbdev is as big as the data area of the base bdev */
+	dedupe = ut_dedupe_create(0, 0);
+	CU_ASSERT(dedupe->bdev.blocklen == DEDUPE_CHUNK_SIZE);
+	CU_ASSERT(dedupe->chunk_base_blocks == UT_CHUNK_BLOCKS);
+	CU_ASSERT(dedupe->bdev.blockcnt == dedupe->num_chunks);
+	CU_ASSERT(dedupe->num_chunks == UT_BASE_CHUNKS - 3);
+	CU_ASSERT(dedupe->bdev.optimal_io_boundary == 1);
+	CU_ASSERT(dedupe->bdev.split_on_optimal_io_boundary == true);
+	CU_ASSERT(dedupe->data_offset + dedupe->num_chunks == UT_BASE_CHUNKS);
+	ut_dedupe_delete(dedupe);
+
+	/* Start from scratch with a bigger size, the superblock is dropped */
+	memset(g_base.data, 0xaa, UT_BASE_BLOCKS * UT_BLOCK_SIZE);
+	dedupe = ut_dedupe_create(UT_NUM_BLOCKS, 0);
+	map_md_blocks = dedupe_map_md_blocks(UT_NUM_BLOCKS);
+	fp_md_blocks = dedupe_fp_md_blocks(dedupe->num_chunks);
+	CU_ASSERT(dedupe->bdev.blockcnt == UT_NUM_BLOCKS);
+	CU_ASSERT(dedupe->map_offset == 1);
+	CU_ASSERT(dedupe->fp_offset == 1 + map_md_blocks);
+	CU_ASSERT(dedupe->data_offset == dedupe->fp_offset + fp_md_blocks);
+	CU_ASSERT(dedupe->data_offset + dedupe->num_chunks == UT_BASE_CHUNKS);
+	CU_ASSERT(dedupe->num_used_chunks == 0);
+
+	/* The superblock is valid and the metadata has been cleared */
+	CU_ASSERT(dedupe_sb_is_valid(sb));
+	CU_ASSERT(spdk_uuid_compare(&sb->uuid, &dedupe->bdev.uuid) == 0);
+	CU_ASSERT(sb->num_blocks == UT_NUM_BLOCKS);
+	CU_ASSERT(sb->num_chunks == dedupe->num_chunks);
+	CU_ASSERT(spdk_mem_all_zero(g_base.data + DEDUPE_CHUNK_SIZE,
+				    (map_md_blocks + fp_md_blocks) * DEDUPE_CHUNK_SIZE));
+
+	ut_dedupe_delete(dedupe);
+}
+
+static void
+test_dedupe_fingerprint(void)
+{
+	uint8_t buf[DEDUPE_CHUNK_SIZE];
+	struct iovec iovs[3];
+	uint64_t fp;
+
+	ut_fill_pattern(buf, 3);
+	iovs[0].iov_base = buf;
+	iovs[0].iov_len = sizeof(buf);
+	fp = dedupe_fingerprint(iovs, 1);
+	CU_ASSERT(fp >> 32 == spdk_crc32c_update(buf, DEDUPE_CHUNK_SIZE / 2, ~0u));
+	CU_ASSERT((uint32_t)fp == spdk_crc32c_update(buf + DEDUPE_CHUNK_SIZE / 2,
+			DEDUPE_CHUNK_SIZE / 2, ~0u));
+
+	/* The vectors do not have to be split on the halves */
+	iovs[0].iov_len = 1000;
+	iovs[1].iov_base = buf + 1000;
+	iovs[1].iov_len = 2000;
+	iovs[2].iov_base = buf + 3000;
+	iovs[2].iov_len = sizeof(buf) - 3000;
+	CU_ASSERT(dedupe_fingerprint(iovs, 3) == fp);
+
+	buf[DEDUPE_CHUNK_SIZE - 1]++;
+	CU_ASSERT(dedupe_fingerprint(iovs, 3) != fp);
+}
+
+static void
+test_dedupe_read_write(void)
+{
+	struct vbdev_dedupe *dedupe;
+	uint8_t buf[DEDUPE_CHUNK_SIZE], data[DEDUPE_CHUNK_SIZE];
+	struct iovec iovs[2];
+	uint32_t entry, writes;
+	int status;
+
+	memset(g_base.data, 0, UT_BASE_BLOCKS * UT_BLOCK_SIZE);
+	dedupe = ut_dedupe_create(UT_NUM_BLOCKS, 0);
+
+	/* Blocks never written read as zeroes, without reading the base bdev */
+	memset(buf, 0xff, sizeof(buf));
+	g_base.num_reads = 0;
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_READ, buf, 7, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(spdk_mem_all_zero(buf, sizeof(buf)));
+	CU_ASSERT(g_base.num_reads == 0);
+
+	/* Unique block: the data, its fingerprint and the map are written */
+	ut_fill_pattern(data, 1);
+	writes = g_base.num_writes;
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, 7, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_base.num_writes == writes + 3);
+	CU_ASSERT(dedupe->stats.unique_writes == 1);
+	CU_ASSERT(dedupe->num_used_chunks == 1);
+	CU_ASSERT(dedupe->num_mapped_blocks == 1);
+	entry = dedupe->map[7];
+	SPDK_CU_ASSERT_FATAL(entry != 0);
+	CU_ASSERT(ut_map_on_disk(dedupe, 7) == entry);
+	CU_ASSERT(dedupe->refs[entry - 1] == 1);
+	CU_ASSERT(memcmp(ut_chunk_data(dedupe, entry - 1), data, sizeof(data)) == 0);
+	iovs[0].iov_base = data;
+	iovs[0].iov_len = sizeof(data);
+	CU_ASSERT(dedupe_index_lookup(dedupe, dedupe_fingerprint(iovs, 1)) == entry - 1);
+
+	/* Read it back into two vectors */
+	memset(buf, 0, sizeof(buf));
+	iovs[0].iov_base = buf;
+	iovs[0].iov_len = 512;
+	iovs[1].iov_base = buf + 512;
+	iovs[1].iov_len = sizeof(buf) - 512;
+	status = ut_submit_iovs(dedupe, SPDK_BDEV_IO_TYPE_READ, iovs, 2, 7, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, data, sizeof(data)) == 0);
+	CU_ASSERT(dedupe->refs[entry - 1] == 1);
+
+	/* Overwrite with other data, the previous chunk is released */
+	ut_fill_pattern(data, 2);
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, 7, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(dedupe->map[7] != entry);
+	CU_ASSERT(dedupe->refs[entry - 1] == 0);
+	CU_ASSERT(dedupe->num_used_chunks == 1);
+	CU_ASSERT(dedupe->num_mapped_blocks == 1);
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_READ, buf, 7, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, data, sizeof(data)) == 0);
+
+	/* The flush goes to the base bdev */
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_FLUSH, NULL, 0, UT_NUM_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	ut_dedupe_delete(dedupe);
+}
+
+static void
+test_dedupe_duplicate(void)
+{
+	struct vbdev_dedupe *dedupe;
+	uint8_t buf[DEDUPE_CHUNK_SIZE], data_a[DEDUPE_CHUNK_SIZE], data_b[DEDUPE_CHUNK_SIZE];
+	uint32_t entry_a, entry_b, writes, reads;
+	uint64_t fp_a;
+	int status;
+
+	memset(g_base.data, 0, UT_BASE_BLOCKS * UT_BLOCK_SIZE);
+	dedupe = ut_dedupe_create(UT_NUM_BLOCKS, 0);
+	ut_fill_pattern(data_a, 10);
+	ut_fill_pattern(data_b, 20);
+
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data_a, 1, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	entry_a = dedupe->map[1];
+	fp_a = dedupe->fps[entry_a - 1];
+
+	/* Duplicate: the chunk is verified and shared, only the map is written */
+	writes = g_base.num_writes;
+	reads = g_base.num_reads;
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data_a, 2, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_base.num_writes == writes + 1);
+	CU_ASSERT(g_base.num_reads == reads + 1);
+	CU_ASSERT(dedupe->map[2] == entry_a);
+	CU_ASSERT(ut_map_on_disk(dedupe, 2) == entry_a);
+	CU_ASSERT(dedupe->refs[entry_a - 1] == 2);
+	CU_ASSERT(dedupe->stats.duplicate_writes == 1);
+	CU_ASSERT(dedupe->num_used_chunks == 1);
+	CU_ASSERT(dedupe->num_mapped_blocks == 2);
+	CU_ASSERT(dedupe->num_free_verify_bufs == DEDUPE_VERIFY_QD);
+
+	/* Writing the same data again to the same block does not change anything */
+	writes = g_base.num_writes;
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data_a, 2, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_base.num_writes == writes);
+	CU_ASSERT(dedupe->refs[entry_a - 1] == 2);
+
+	/* Both blocks read the shared chunk */
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_READ, buf, 2, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, data_a, sizeof(buf)) == 0);
+
+	/* Moving both blocks to other data releases the chunk and its fingerprint */
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data_b, 1, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	entry_b = dedupe->map[1];
+	CU_ASSERT(entry_b != entry_a);
+	CU_ASSERT(dedupe->refs[entry_a - 1] == 1);
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data_b, 2, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(dedupe->map[2] == entry_b);
+	CU_ASSERT(dedupe->refs[entry_a - 1] == 0);
+	CU_ASSERT(dedupe->refs[entry_b - 1] == 2);
+	CU_ASSERT(dedupe->num_used_chunks == 1);
+	CU_ASSERT(dedupe_index_lookup(dedupe, fp_a) == DEDUPE_CHUNK_NONE);
+
+	ut_dedupe_delete(dedupe);
+}
+
+static void
+test_dedupe_verify(void)
+{
+	struct vbdev_dedupe *dedupe;
+	uint8_t buf[DEDUPE_CHUNK_SIZE], data[DEDUPE_CHUNK_SIZE];
+	uint32_t entry, i;
+	int status;
+
+	memset(g_base.data, 0, UT_BASE_BLOCKS * UT_BLOCK_SIZE);
+	dedupe = ut_dedupe_create(UT_NUM_BLOCKS, 100);
+	CU_ASSERT(dedupe->latency_budget_ticks == 100 * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC);
+	ut_fill_pattern(data, 30);
+
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, 0, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	entry = dedupe->map[0];
+
+	/* Same fingerprint but different data, as if it collided: the block gets its own chunk */
+	ut_chunk_data(dedupe, entry - 1)[0] ^= 0xff;
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, 1, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(dedupe->stats.verify_mismatches == 1);
+	CU_ASSERT(dedupe->map[1] != entry);
+	CU_ASSERT(dedupe->refs[entry - 1] == 1);
+	CU_ASSERT(dedupe->num_used_chunks == 2);
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_READ, buf, 1, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, data, sizeof(buf)) == 0);
+	ut_chunk_data(dedupe, entry - 1)[0] ^= 0xff;
+
+	/* The indexed chunk is still the first one, duplicates of it are shared again */
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, 2, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(dedupe->map[2] == entry);
+
+	/* Over the latency budget, duplicates are written as unique chunks without verification,
+	 * except for one in DEDUPE_VERIFY_PROBE_INTERVAL
+	 */
+	dedupe->verify_ticks = dedupe->latency_budget_ticks + 1;
+	dedupe->verify_skip_count = 0;
+	for (i = 1; i < DEDUPE_VERIFY_PROBE_INTERVAL; i++) {
+		status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, 2 + i, 1);
+		CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(dedupe->map[2 + i] != entry);
+	}
+	CU_ASSERT(dedupe->stats.verify_skips == DEDUPE_VERIFY_PROBE_INTERVAL - 1);
+	CU_ASSERT(dedupe->refs[entry - 1] == 2);
+
+	/* The probe is verified and shared, its latency (none here) brings the average down */
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, 2 + i, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(dedupe->map[2 + i] == entry);
+	CU_ASSERT(dedupe->verify_ticks < dedupe->latency_budget_ticks + 1);
+
+	/* Without any verification buffer left, duplicates are not verified either */
+	dedupe->verify_ticks = 0;
+	dedupe->num_free_verify_bufs = 0;
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, 3 + i, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(dedupe->map[3 + i] != entry);
+	CU_ASSERT(dedupe->stats.verify_skips == DEDUPE_VERIFY_PROBE_INTERVAL);
+	dedupe->num_free_verify_bufs = DEDUPE_VERIFY_QD;
+
+	ut_dedupe_delete(dedupe);
+}
+
+static void
+test_dedupe_unmap(void)
+{
+	struct vbdev_dedupe *dedupe;
+	uint8_t buf[DEDUPE_CHUNK_SIZE], data[DEDUPE_CHUNK_SIZE], zeroes[DEDUPE_CHUNK_SIZE] = {};
+	uint32_t i, writes;
+	int status;
+
+	memset(g_base.data, 0, UT_BASE_BLOCKS * UT_BLOCK_SIZE);
+	dedupe = ut_dedupe_create(UT_NUM_BLOCKS, 0);
+
+	for (i = 0; i < 8; i++) {
+		ut_fill_pattern(data, i % 2);
+		status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, i, 1);
+		CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+	CU_ASSERT(dedupe->num_used_chunks == 2);
+	CU_ASSERT(dedupe->num_mapped_blocks == 8);
+
+	/* Writes of zeroes unmap the block */
+	writes = g_base.num_writes;
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, zeroes, 0, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_base.num_writes == writes + 1);
+	CU_ASSERT(dedupe->map[0] == 0);
+	CU_ASSERT(ut_map_on_disk(dedupe, 0) == 0);
+	CU_ASSERT(dedupe->stats.zero_writes == 1);
+	CU_ASSERT(dedupe->num_mapped_blocks == 7);
+
+	/* Unmapping the blocks with the second pattern releases its chunk */
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 1, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE_ZEROES, NULL, 3, 5);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(dedupe->num_used_chunks == 1);
+	CU_ASSERT(dedupe->num_mapped_blocks == 1);
+	CU_ASSERT(dedupe->map[2] != 0);
+	for (i = 3; i < 8; i++) {
+		CU_ASSERT(dedupe->map[i] == 0);
+		CU_ASSERT(ut_map_on_disk(dedupe, i) == 0);
+	}
+	memset(buf, 0xff, sizeof(buf));
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_READ, buf, 3, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(spdk_mem_all_zero(buf, sizeof(buf)));
+
+	/* Unmapping blocks that are not mapped does not write anything */
+	writes = g_base.num_writes;
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 3, 5);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_base.num_writes == writes);
+
+	ut_dedupe_delete(dedupe);
+}
+
+static void
+test_dedupe_read_thread(void)
+{
+	struct vbdev_dedupe *dedupe;
+	struct spdk_bdev_io *bdev_io, *unmap_io, *write_io;
+	struct iovec iov, write_iov;
+	uint8_t buf[DEDUPE_CHUNK_SIZE], data[DEDUPE_CHUNK_SIZE], other[DEDUPE_CHUNK_SIZE];
+	uint32_t chunk;
+	int status;
+
+	memset(g_base.data, 0, UT_BASE_BLOCKS * UT_BLOCK_SIZE);
+	dedupe = ut_dedupe_create(UT_NUM_BLOCKS, 0);
+	ut_fill_pattern(data, 1);
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, 0, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	SPDK_CU_ASSERT_FATAL(dedupe->map[0] != 0);
+	chunk = dedupe->map[0] - 1;
+
+	/* Reads are served by the thread they are submitted on */
+	iov.iov_base = buf;
+	iov.iov_len = sizeof(buf);
+	memset(buf, 0, sizeof(buf));
+	bdev_io = ut_io_alloc(dedupe, SPDK_BDEV_IO_TYPE_READ, &iov, 1, 0, 1);
+	ut_io_start(dedupe, bdev_io);
+	poll_thread(UT_SUBMIT_THREAD);
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	status = ut_io_end(bdev_io);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, data, sizeof(buf)) == 0);
+	CU_ASSERT(dedupe->readers[chunk] == 0);
+
+	/* A chunk being read is not reused, even once it has been released */
+	memset(buf, 0, sizeof(buf));
+	bdev_io = ut_io_alloc(dedupe, SPDK_BDEV_IO_TYPE_READ, &iov, 1, 0, 1);
+	ut_io_start(dedupe, bdev_io);
+	CU_ASSERT(dedupe->readers[chunk] == 1);
+
+	unmap_io = ut_io_alloc(dedupe, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 0, 0, 1);
+	ut_io_start(dedupe, unmap_io);
+	poll_thread(UT_MD_THREAD);
+	CU_ASSERT(dedupe->map[0] == 0);
+	CU_ASSERT(dedupe->refs[chunk] == 0);
+	CU_ASSERT(dedupe->num_used_chunks == 0);
+
+	/* The allocation would start from the chunk being read */
+	dedupe->alloc_cursor = chunk;
+	ut_fill_pattern(other, 2);
+	write_iov.iov_base = other;
+	write_iov.iov_len = sizeof(other);
+	write_io = ut_io_alloc(dedupe, SPDK_BDEV_IO_TYPE_WRITE, &write_iov, 1, 1, 1);
+	ut_io_start(dedupe, write_io);
+	poll_thread(UT_MD_THREAD);
+	SPDK_CU_ASSERT_FATAL(dedupe->map[1] != 0);
+	CU_ASSERT(dedupe->map[1] - 1 != chunk);
+
+	poll_thread(UT_SUBMIT_THREAD);
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	CU_ASSERT(dedupe->readers[chunk] == 0);
+	status = ut_io_end(bdev_io);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, data, sizeof(buf)) == 0);
+	status = ut_io_end(unmap_io);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	status = ut_io_end(write_io);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	ut_dedupe_delete(dedupe);
+}
+
+static void
+test_dedupe_recovery(void)
+{
+	struct vbdev_dedupe *dedupe;
+	uint8_t buf[DEDUPE_CHUNK_SIZE], data[DEDUPE_CHUNK_SIZE];
+	struct spdk_uuid uuid;
+	uint32_t *map;
+	uint32_t i;
+	int status;
+
+	memset(g_base.data, 0, UT_BASE_BLOCKS * UT_BLOCK_SIZE);
+	dedupe = ut_dedupe_create(UT_NUM_BLOCKS, 0);
+	spdk_uuid_copy(&uuid, &dedupe->bdev.uuid);
+	for (i = 0; i < 6; i++) {
+		ut_fill_pattern(data, i % 3);
+		status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, 10 + i, 1);
+		CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+	CU_ASSERT(dedupe->num_used_chunks == 3);
+	ut_dedupe_delete(dedupe);
+
+	/* An entry pointing past the chunks is dropped when the map is loaded */
+	map = (uint32_t *)(g_base.data + DEDUPE_CHUNK_SIZE);
+	map[20] = UINT32_MAX;
+
+	/* The size asked for is ignored, the one of the existing dedupe vbdev is used */
+	dedupe = ut_dedupe_create(UT_NUM_BLOCKS * 2, 0);
+	CU_ASSERT(dedupe->bdev.blockcnt == UT_NUM_BLOCKS);
+	CU_ASSERT(spdk_uuid_compare(&dedupe->bdev.uuid, &uuid) == 0);
+	CU_ASSERT(dedupe->num_used_chunks == 3);
+	CU_ASSERT(dedupe->num_mapped_blocks == 6);
+	CU_ASSERT(dedupe->map[20] == 0);
+	CU_ASSERT(ut_map_on_disk(dedupe, 20) == 0);
+	CU_ASSERT(dedupe->refs[dedupe->map[10] - 1] == 2);
+
+	for (i = 0; i < 6; i++) {
+		ut_fill_pattern(data, i % 3);
+		status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_READ, buf, 10 + i, 1);
+		CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(memcmp(buf, data, sizeof(buf)) == 0);
+	}
+
+	/* The index has been rebuilt too */
+	ut_fill_pattern(data, 1);
+	status = ut_submit(dedupe, SPDK_BDEV_IO_TYPE_WRITE, data, 30, 1);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(dedupe->map[30] == dedupe->map[11]);
+	CU_ASSERT(dedupe->stats.duplicate_writes == 1);
+	ut_dedupe_delete(dedupe);
+}
+
+static void
+test_dedupe_index(void)
+{
+	struct vbdev_dedupe *dedupe;
+	uint64_t mask;
+	uint32_t i;
+
+	memset(g_base.data, 0, UT_BASE_BLOCKS * UT_BLOCK_SIZE);
+	dedupe = ut_dedupe_create(UT_NUM_BLOCKS, 0);
+	mask = dedupe->index_mask;
+	CU_ASSERT(mask + 1 >= dedupe->num_chunks * 2);
+
+	/* Chunks 0-3 share the same home slot, the last one of the table, 4 takes the next one */
+	for (i = 0; i < 4; i++) {
+		dedupe->fps[i] = ((uint64_t)i << 56) | mask;
+		dedupe_index_insert(dedupe, i);
+	}
+	dedupe->fps[4] = 0;
+	dedupe_index_insert(dedupe, 4);
+	CU_ASSERT(dedupe->index[mask] == 1);
+	CU_ASSERT(dedupe->index[0] == 2);
+	CU_ASSERT(dedupe->index[3] == 5);
+
+	/* A second chunk with the same fingerprint is not indexed */
+	dedupe->fps[5] = dedupe->fps[1];
+	dedupe_index_insert(dedupe, 5);
+	CU_ASSERT(dedupe_index_lookup(dedupe, dedupe->fps[1]) == 1);
+	dedupe_index_remove(dedupe, 5);
+	CU_ASSERT(dedupe_index_lookup(dedupe, dedupe->fps[1]) == 1);
+
+	/* Removing an entry shifts back the ones that follow it */
+	dedupe_index_remove(dedupe, 0);
+	CU_ASSERT(dedupe->index[mask] == 2);
+	CU_ASSERT(dedupe_index_lookup(dedupe, dedupe->fps[0]) == DEDUPE_CHUNK_NONE);
+	for (i = 1; i < 5; i++) {
+		CU_ASSERT(dedupe_index_lookup(dedupe, dedupe->fps[i]) == i);
+	}
+	dedupe_index_remove(dedupe, 2);
+	dedupe_index_remove(dedupe, 4);
+	CU_ASSERT(dedupe_index_lookup(dedupe, dedupe->fps[1]) == 1);
+	CU_ASSERT(dedupe_index_lookup(dedupe, dedupe->fps[3]) == 3);
+	dedupe_index_remove(dedupe, 1);
+	dedupe_index_remove(dedupe, 3);
+	for (i = 0; i <= mask; i++) {
+		CU_ASSERT(dedupe->index[i] == 0);
+	}
+
+	ut_dedupe_delete(dedupe);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("dedupe", test_setup, test_cleanup);
+	CU_ADD_TEST(suite, test_dedupe_create);
+	CU_ADD_TEST(suite, test_dedupe_fingerprint);
+	CU_ADD_TEST(suite, test_dedupe_read_write);
+	CU_ADD_TEST(suite, test_dedupe_duplicate);
+	CU_ADD_TEST(suite, test_dedupe_verify);
+	CU_ADD_TEST(suite, test_dedupe_unmap);
+	CU_ADD_TEST(suite, test_dedupe_read_thread);
+	CU_ADD_TEST(suite, test_dedupe_recovery);
+	CU_ADD_TEST(suite, test_dedupe_index);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+	CU_cleanup_registry();
+	return num_failures;
+}
@@ -0,0 +1,385 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_internal/cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+
+#include "common/lib/ut_multithread.c"
+
+/* Record the writeback of the file backed disks */
+int ut_msync(void *addr, size_t length, int flags);
+int ut_sync_file_range(int fd, off64_t offset, off64_t nbytes, unsigned int flags);
+#define msync ut_msync
+#define sync_file_range ut_sync_file_range
+#include "bdev/malloc/bdev_malloc.c"
+#undef msync
+#undef sync_file_range
+
+#define UT_BLOCK_SIZE	512
+#define UT_NUM_BLOCKS	64
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB(spdk_bdev_register, int, (struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_bdev_unregister_by_name, int, (const char *bdev_name,
+		struct spdk_bdev_module *module, spdk_bdev_unregister_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB_V(spdk_bdev_destruct_done, (struct spdk_bdev *bdev, int bdeverrno));
+DEFINE_STUB_V(spdk_bdev_io_set_buf, (struct spdk_bdev_io *bdev_io, void *buf, uint64_t len));
+DEFINE_STUB(spdk_bdev_is_md_interleaved, bool, (const struct spdk_bdev *bdev), false);
+DEFINE_STUB(spdk_mem_register, int, (void *vaddr, size_t len), 0);
+DEFINE_STUB(spdk_mem_unregister, int, (void *vaddr, size_t len), 0);
+DEFINE_STUB(spdk_accel_get_io_channel, struct spdk_io_channel *, (void), NULL);
+DEFINE_STUB(spdk_accel_append_copy, int, (struct spdk_accel_sequence **seq,
+		struct spdk_io_channel *ch, struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		struct spdk_memory_domain *dst_domain, void *dst_domain_ctx,
+		struct iovec *src_iovs, uint32_t src_iovcnt, struct spdk_memory_domain *src_domain,
+		void *src_domain_ctx, int flags, spdk_accel_step_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB_V(spdk_accel_sequence_abort, (struct spdk_accel_sequence *seq));
+DEFINE_STUB_V(spdk_accel_sequence_finish, (struct spdk_accel_sequence *seq,
+		spdk_accel_completion_cb cb_fn, void *cb_arg));
+DEFINE_STUB_V(spdk_accel_sequence_reverse, (struct spdk_accel_sequence *seq));
+DEFINE_STUB(spdk_accel_submit_copy, int, (struct spdk_io_channel *ch, void *dst, void *src,
+		uint64_t nbytes, int flags, spdk_accel_completion_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(spdk_accel_submit_fill, int, (struct spdk_io_channel *ch, void *dst, uint8_t fill,
+		uint64_t nbytes, int flags, spdk_accel_completion_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(spdk_memory_domain_get_first, struct spdk_memory_domain *, (const char *id), NULL);
+DEFINE_STUB(spdk_memory_domain_get_next, struct spdk_memory_domain *,
+	    (struct spdk_memory_domain *prev, const char *id), NULL);
+DEFINE_STUB(spdk_json_write_named_string, int, (struct spdk_json_write_ctx *w,
+		const char *name, const char *val), 0);
+DEFINE_STUB(spdk_json_write_named_uuid, int, (struct spdk_json_write_ctx *w, const char *name,
+		const struct spdk_uuid *val), 0);
+DEFINE_STUB(spdk_json_write_named_uint32, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint32_t val), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint64_t val), 0);
+DEFINE_STUB(spdk_json_write_named_object_begin, int, (struct spdk_json_write_ctx *w,
+		const char *name), 0);
+DEFINE_STUB(spdk_json_write_object_begin, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_object_end, int, (struct spdk_json_write_ctx *w), 0);
+
+static char g_dir[] = "/tmp/malloc_ut.XXXXXX";
+static char g_file[64];
+static int g_msync_flags;
+static uint32_t g_msync_count;
+static uint32_t g_sync_file_range_count;
+static enum spdk_bdev_io_status g_io_status;
+
+int
+ut_msync(void *addr, size_t length, int flags)
+{
+	g_msync_flags = flags;
+	g_msync_count++;
+
+	return msync(addr, length, flags);
+}
+
+int
+ut_sync_file_range(int fd, off64_t offset, off64_t nbytes, unsigned int flags)
+{
+	CU_ASSERT(flags == SYNC_FILE_RANGE_WRITE);
+	g_sync_file_range_count++;
+
+	return sync_file_range(fd, offset, nbytes, flags);
+}
+
+void
+spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	g_io_status = status;
+}
+
+static void
+ut_init_opts(struct malloc_bdev_opts *opts)
+{
+	memset(opts, 0, sizeof(*opts));
+	opts->name = "malloc_ut";
+	opts->num_blocks = UT_NUM_BLOCKS;
+	opts->block_size = UT_BLOCK_SIZE;
+	opts->file = g_file;
+}
+
+static struct malloc_disk *
+ut_create_disk(const struct malloc_bdev_opts *opts, int *rc)
+{
+	struct spdk_bdev *bdev = NULL;
+
+	*rc = create_malloc_disk(&bdev, opts);
+
+	return *rc == 0 ? bdev->ctxt : NULL;
+}
+
+static void
+ut_delete_disk(struct malloc_disk *mdisk)
+{
+	if (bdev_malloc_destruct(mdisk) != 0) {
+		poll_threads();
+	}
+}
+
+static void
+test_malloc_file_create(void)
+{
+	struct malloc_bdev_opts opts;
+	struct malloc_file_layout *layout;
+	struct malloc_disk *mdisk;
+	struct stat st;
+	uint8_t *buf;
+	int rc;
+
+	ut_init_opts(&opts);
+
+	/* A new file is sized to the mapping and gets the layout after the data */
+	mdisk = ut_create_disk(&opts, &rc);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	CU_ASSERT(stat(g_file, &st) == 0);
+	CU_ASSERT((size_t)st.st_size == mdisk->map_len);
+	CU_ASSERT(mdisk->map_len % VALUE_2MB == 0);
+	CU_ASSERT(((uintptr_t)mdisk->malloc_buf & (VALUE_2MB - 1)) == 0);
+	CU_ASSERT(mdisk->malloc_md_buf == NULL);
+	layout = (struct malloc_file_layout *)((uint8_t *)mdisk->malloc_buf +
+					       UT_NUM_BLOCKS * UT_BLOCK_SIZE);
+	CU_ASSERT(memcmp(layout->magic, MALLOC_FILE_MAGIC, sizeof(layout->magic)) == 0);
+	CU_ASSERT(layout->num_blocks == UT_NUM_BLOCKS);
+	CU_ASSERT(layout->block_size == UT_BLOCK_SIZE);
+
+	buf = mdisk->malloc_buf;
+	CU_ASSERT(spdk_mem_all_zero(buf, UT_NUM_BLOCKS * UT_BLOCK_SIZE));
+	memset(buf, 0xa5, UT_NUM_BLOCKS * UT_BLOCK_SIZE);
+	ut_delete_disk(mdisk);
+
+	/* A disk created again with the same file gets its data back */
+	mdisk = ut_create_disk(&opts, &rc);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	buf = mdisk->malloc_buf;
+	CU_ASSERT(buf[0] == 0xa5);
+	CU_ASSERT(buf[UT_NUM_BLOCKS * UT_BLOCK_SIZE - 1] == 0xa5);
+	ut_delete_disk(mdisk);
+
+	unlink(g_file);
+}
+
+static void
+test_malloc_file_layout_mismatch(void)
+{
+	struct malloc_bdev_opts opts;
+	struct malloc_disk *mdisk;
+	int rc;
+
+	ut_init_opts(&opts);
+	mdisk = ut_create_disk(&opts, &rc);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	ut_delete_disk(mdisk);
+
+	/* The same mapping size, but a different number of blocks */
+	opts.num_blocks = UT_NUM_BLOCKS / 2;
+	mdisk = ut_create_disk(&opts, &rc);
+	CU_ASSERT(rc == -EINVAL);
+	CU_ASSERT(mdisk == NULL);
+
+	/* A different block size */
+	opts.num_blocks = UT_NUM_BLOCKS;
+	opts.block_size = UT_BLOCK_SIZE * 2;
+	mdisk = ut_create_disk(&opts, &rc);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Separate metadata */
+	opts.block_size = UT_BLOCK_SIZE;
+	opts.md_size = 8;
+	mdisk = ut_create_disk(&opts, &rc);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* A different size of the file */
+	opts.md_size = 0;
+	opts.num_blocks = VALUE_2MB / UT_BLOCK_SIZE * 2;
+	mdisk = ut_create_disk(&opts, &rc);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* The original layout is still accepted */
+	opts.num_blocks = UT_NUM_BLOCKS;
+	mdisk = ut_create_disk(&opts, &rc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(mdisk != NULL);
+	ut_delete_disk(mdisk);
+
+	unlink(g_file);
+}
+
+static void
+test_malloc_file_lock(void)
+{
+	struct malloc_bdev_opts opts;
+	struct malloc_disk *mdisk, *mdisk2;
+	int rc;
+
+	ut_init_opts(&opts);
+	mdisk = ut_create_disk(&opts, &rc);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	/* The file is in use */
+	opts.name = "malloc_ut2";
+	mdisk2 = ut_create_disk(&opts, &rc);
+	CU_ASSERT(rc == -EBUSY);
+	CU_ASSERT(mdisk2 == NULL);
+
+	/* The lock goes away with the disk */
+	ut_delete_disk(mdisk);
+	mdisk2 = ut_create_disk(&opts, &rc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(mdisk2 != NULL);
+	ut_delete_disk(mdisk2);
+
+	unlink(g_file);
+}
+
+static void
+test_malloc_file_flush(void)
+{
+	struct malloc_bdev_opts opts;
+	struct malloc_disk *mdisk;
+	struct malloc_channel mch = {};
+	struct spdk_bdev_io *bdev_io;
+	struct malloc_task *task;
+	int rc;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct malloc_task));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	task = (struct malloc_task *)bdev_io->driver_ctx;
+	TAILQ_INIT(&mch.completed_tasks);
+
+	ut_init_opts(&opts);
+	mdisk = ut_create_disk(&opts, &rc);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	bdev_io->bdev = &mdisk->disk;
+	bdev_io->type = SPDK_BDEV_IO_TYPE_FLUSH;
+	bdev_io->u.bdev.offset_blocks = 1;
+	bdev_io->u.bdev.num_blocks = 2;
+
+	/* A flush waits for the writeback of the flushed range */
+	g_msync_count = 0;
+	CU_ASSERT(_bdev_malloc_submit_request(&mch, bdev_io) == 0);
+	CU_ASSERT(g_msync_count == 1);
+	CU_ASSERT(g_msync_flags == MS_SYNC);
+	CU_ASSERT(TAILQ_FIRST(&mch.completed_tasks) == task);
+	CU_ASSERT(task->status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	ut_delete_disk(mdisk);
+	unlink(g_file);
+	free(bdev_io);
+}
+
+static void
+test_malloc_file_checkpoint(void)
+{
+	struct malloc_bdev_opts opts;
+	struct malloc_disk *mdisk;
+	struct malloc_channel mch = {};
+	struct spdk_bdev_io *bdev_io;
+	struct malloc_task *task;
+	int rc;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct malloc_task));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	task = (struct malloc_task *)bdev_io->driver_ctx;
+	TAILQ_INIT(&mch.completed_tasks);
+
+	ut_init_opts(&opts);
+	opts.checkpoint_interval_ms = 100;
+	mdisk = ut_create_disk(&opts, &rc);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	CU_ASSERT(mdisk->checkpoint_poller != NULL);
+
+	/* Nothing was written */
+	g_sync_file_range_count = 0;
+	CU_ASSERT(malloc_disk_checkpoint(mdisk) == SPDK_POLLER_IDLE);
+	CU_ASSERT(g_sync_file_range_count == 0);
+
+	/* Reads don't dirty the disk */
+	bdev_io->bdev = &mdisk->disk;
+	bdev_io->type = SPDK_BDEV_IO_TYPE_READ;
+	task->status = SPDK_BDEV_IO_STATUS_SUCCESS;
+	task->num_outstanding = 1;
+	malloc_done(task, 0);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(malloc_disk_checkpoint(mdisk) == SPDK_POLLER_IDLE);
+
+	/* A failed write doesn't either */
+	bdev_io->type = SPDK_BDEV_IO_TYPE_WRITE;
+	task->status = SPDK_BDEV_IO_STATUS_SUCCESS;
+	task->num_outstanding = 1;
+	malloc_done(task, -EIO);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	CU_ASSERT(malloc_disk_checkpoint(mdisk) == SPDK_POLLER_IDLE);
+
+	/* A completed write starts the writeback on the next checkpoint only */
+	task->status = SPDK_BDEV_IO_STATUS_SUCCESS;
+	task->num_outstanding = 1;
+	malloc_done(task, 0);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(malloc_disk_checkpoint(mdisk) == SPDK_POLLER_BUSY);
+	CU_ASSERT(g_sync_file_range_count == 1);
+	CU_ASSERT(malloc_disk_checkpoint(mdisk) == SPDK_POLLER_IDLE);
+	CU_ASSERT(g_sync_file_range_count == 1);
+
+	/* So does a committed zcopy write */
+	bdev_io->type = SPDK_BDEV_IO_TYPE_ZCOPY;
+	bdev_io->u.bdev.zcopy.start = 0;
+	bdev_io->u.bdev.zcopy.commit = 1;
+	CU_ASSERT(_bdev_malloc_submit_request(&mch, bdev_io) == 0);
+	CU_ASSERT(TAILQ_FIRST(&mch.completed_tasks) == task);
+	CU_ASSERT(malloc_disk_checkpoint(mdisk) == SPDK_POLLER_BUSY);
+	CU_ASSERT(g_sync_file_range_count == 2);
+
+	ut_delete_disk(mdisk);
+	unlink(g_file);
+	free(bdev_io);
+}
+
+static int
+test_suite_init(void)
+{
+	if (mkdtemp(g_dir) == NULL) {
+		return -1;
+	}
+	snprintf(g_file, sizeof(g_file), "%s/disk", g_dir);
+
+	return 0;
+}
+
+static int
+test_suite_fini(void)
+{
+	unlink(g_file);
+	return rmdir(g_dir);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("malloc", test_suite_init, test_suite_fini);
+
+	CU_ADD_TEST(suite, test_malloc_file_create);
+	CU_ADD_TEST(suite, test_malloc_file_layout_mismatch);
+	CU_ADD_TEST(suite, test_malloc_file_lock);
+	CU_ADD_TEST(suite, test_malloc_file_flush);
+	CU_ADD_TEST(suite, test_malloc_file_checkpoint);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+	CU_cleanup_registry();
+
+	free_threads();
+
+	return num_failures;
+}
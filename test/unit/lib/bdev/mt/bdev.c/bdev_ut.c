@@ -19,6 +19,7 @@
 
 DEFINE_STUB(spdk_notify_send, uint64_t, (const char *type, const char *ctx), 0);
 DEFINE_STUB(spdk_notify_type_register, struct spdk_notify_type *, (const char *type), NULL);
+DEFINE_STUB_V(bdev_part_config_json, (struct spdk_bdev *bdev, struct spdk_json_write_ctx *w));
 DEFINE_STUB_V(spdk_scsi_nvme_translate, (const struct spdk_bdev_io *bdev_io, int *sc, int *sk,
 		int *asc, int *ascq));
 DEFINE_STUB(spdk_memory_domain_get_dma_device_id, const char *, (struct spdk_memory_domain *domain),
@@ -1845,6 +1846,356 @@ qos_dynamic_enable(void)
 	teardown_test();
 }
 
+static void
+qos_group(void)
+{
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_channel *bdev_ch;
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_qos_group *group;
+	enum spdk_bdev_io_status bdev_io_status[5];
+	uint64_t limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES] = {};
+	uint64_t min_limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES] = {};
+	int status, rc, i;
+
+	setup_test();
+	MOCK_SET(spdk_get_ticks, 0);
+
+	bdev = &g_bdev.bdev;
+
+	g_get_io_channel = true;
+
+	set_thread(0);
+	io_ch = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch = spdk_io_channel_get_ctx(io_ch);
+	CU_ASSERT(bdev_ch->flags == 0);
+
+	/* A group needs at least one rate limit */
+	rc = spdk_bdev_qos_group_create("group0", limits);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* 4000 read/write I/O per second, or 4 per millisecond */
+	limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] = 4000;
+	rc = spdk_bdev_qos_group_create("group0", limits);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_qos_group_create("group0", limits);
+	CU_ASSERT(rc == -EEXIST);
+
+	/* Adding the bdev to a group that doesn't exist fails */
+	status = -1;
+	spdk_bdev_set_qos_group(bdev, "group1", NULL, qos_dynamic_enable_done, &status);
+	poll_threads();
+	CU_ASSERT(status == -ENODEV);
+	CU_ASSERT(bdev_ch->flags == 0);
+
+	/* Add the bdev to the group with 1 read/write I/O per millisecond guaranteed */
+	status = -1;
+	min_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] = 1000;
+	spdk_bdev_set_qos_group(bdev, "group0", min_limits, qos_dynamic_enable_done, &status);
+	poll_threads();
+	CU_ASSERT(status == 0);
+	CU_ASSERT((bdev_ch->flags & BDEV_CH_QOS_ENABLED) != 0);
+	SPDK_CU_ASSERT_FATAL(bdev->internal.qos != NULL);
+	group = bdev->internal.qos->group;
+	SPDK_CU_ASSERT_FATAL(group != NULL);
+	CU_ASSERT(group->num_bdevs == 1);
+
+	rc = spdk_bdev_qos_group_delete("group0");
+	CU_ASSERT(rc == -EBUSY);
+
+	/*
+	 * Start a new timeslice. The group hands out 3 I/O, as 1 of its 4 I/O per
+	 * timeslice is guaranteed to the bdev, so a fifth I/O is queued.
+	 */
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	for (i = 0; i < 5; i++) {
+		bdev_io_status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch, NULL, 0, 1, io_during_io_done, &bdev_io_status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 4);
+	poll_threads();
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT(bdev_io_status[i] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+	CU_ASSERT(bdev_io_status[4] == SPDK_BDEV_IO_STATUS_PENDING);
+
+	/* The queued I/O is submitted in the next timeslice */
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 1);
+	poll_threads();
+	CU_ASSERT(bdev_io_status[4] == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* Once other bdevs use up the group, the guaranteed I/O is still allowed */
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	group->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].remaining_this_timeslice = 0;
+	for (i = 0; i < 2; i++) {
+		bdev_io_status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch, NULL, 0, 1, io_during_io_done, &bdev_io_status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 1);
+	poll_threads();
+	CU_ASSERT(bdev_io_status[0] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_io_status[1] == SPDK_BDEV_IO_STATUS_PENDING);
+
+	/* Removing the bdev from the group disables QoS and resubmits the queued I/O */
+	status = -1;
+	spdk_bdev_set_qos_group(bdev, NULL, NULL, qos_dynamic_enable_done, &status);
+	poll_threads();
+	CU_ASSERT(status == 0);
+	CU_ASSERT((bdev_ch->flags & BDEV_CH_QOS_ENABLED) == 0);
+	CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 1);
+	poll_threads();
+	CU_ASSERT(bdev_io_status[1] == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	rc = spdk_bdev_qos_group_delete("group0");
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_qos_group_delete("group0");
+	CU_ASSERT(rc == -ENODEV);
+
+	spdk_put_io_channel(io_ch);
+	poll_threads();
+
+	teardown_test();
+}
+
+static void
+qos_latency_target(void)
+{
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_channel *bdev_ch;
+	struct spdk_bdev *bdev;
+	enum spdk_bdev_io_status bdev_io_status;
+	uint64_t limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES] = {};
+	int status, rc, i;
+
+	setup_test();
+	MOCK_SET(spdk_get_ticks, 0);
+
+	bdev = &g_bdev.bdev;
+
+	g_get_io_channel = true;
+
+	set_thread(0);
+	io_ch = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch = spdk_io_channel_get_ctx(io_ch);
+
+	/* A latency target needs QoS to be enabled */
+	rc = spdk_bdev_set_qos_latency_target(bdev, 100);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* 10000 read/write I/O per second, or 10 per millisecond */
+	status = -1;
+	limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] = 10000;
+	spdk_bdev_set_qos_rate_limits(bdev, limits, qos_dynamic_enable_done, &status);
+	poll_threads();
+	CU_ASSERT(status == 0);
+	CU_ASSERT((bdev_ch->flags & BDEV_CH_QOS_ENABLED) != 0);
+	CU_ASSERT(bdev->internal.qos->rate_scale == SPDK_BDEV_QOS_RATE_SCALE_MAX);
+
+	rc = spdk_bdev_set_qos_latency_target(bdev, 100);
+	CU_ASSERT(rc == 0);
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+
+	/*
+	 * Complete one I/O taking 500us in each of two timeslices. The channel reports
+	 * the latency of the first one once the second one completes. As the latency
+	 * is above the target, the next timeslice allows fewer I/O.
+	 */
+	for (i = 0; i < 2; i++) {
+		CU_ASSERT(bdev->internal.qos->rate_scale == SPDK_BDEV_QOS_RATE_SCALE_MAX);
+		bdev_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch, NULL, 0, 1, io_during_io_done, &bdev_io_status);
+		CU_ASSERT(rc == 0);
+		poll_threads();
+		spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC / 2);
+		CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 1);
+		poll_threads();
+		CU_ASSERT(bdev_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC / 2);
+		poll_threads();
+	}
+	CU_ASSERT(bdev->internal.qos->rate_scale == SPDK_BDEV_QOS_RATE_SCALE_MAX * 3 / 4);
+	CU_ASSERT(bdev->internal.qos->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].remaining_this_timeslice
+		  == 7);
+
+	/* Without a target, the full rate limit applies again */
+	rc = spdk_bdev_set_qos_latency_target(bdev, 0);
+	CU_ASSERT(rc == 0);
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	CU_ASSERT(bdev->internal.qos->rate_scale == SPDK_BDEV_QOS_RATE_SCALE_MAX);
+	CU_ASSERT(bdev->internal.qos->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].remaining_this_timeslice
+		  == 10);
+
+	spdk_put_io_channel(io_ch);
+	poll_threads();
+
+	teardown_test();
+}
+
+static void
+qos_quota_batch(void)
+{
+	struct spdk_io_channel *io_ch[2];
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_qos_limit *limit;
+	enum spdk_bdev_io_status bdev_io_status[2];
+	uint64_t limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES] = {};
+	int status, rc, round, i;
+
+	setup_test();
+	MOCK_SET(spdk_get_ticks, 0);
+
+	bdev = &g_bdev.bdev;
+
+	g_get_io_channel = true;
+
+	for (i = 0; i < 2; i++) {
+		set_thread(i);
+		io_ch[i] = spdk_bdev_get_io_channel(g_desc);
+	}
+
+	/* 320000 read/write I/O per second, or 320 per millisecond */
+	set_thread(0);
+	status = -1;
+	limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] = 320000;
+	spdk_bdev_set_qos_rate_limits(bdev, limits, qos_dynamic_enable_done, &status);
+	poll_threads();
+	CU_ASSERT(status == 0);
+	SPDK_CU_ASSERT_FATAL(bdev->internal.qos != NULL);
+	limit = &bdev->internal.qos->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT];
+	CU_ASSERT(limit->quota_batch == 10);
+
+	/*
+	 * In the first timeslice, each channel takes a batch of 10 I/O on top of the
+	 * one it submits. As two channels were active, the batch is halved in the
+	 * next timeslice, so that the quota cached by all channels together doesn't
+	 * grow with the number of channels.
+	 */
+	for (round = 0; round < 2; round++) {
+		spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+		poll_threads();
+		CU_ASSERT(limit->quota_batch == (round == 0 ? 10 : 5));
+		CU_ASSERT(limit->remaining_this_timeslice == 320);
+
+		for (i = 0; i < 2; i++) {
+			set_thread(i);
+			bdev_io_status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+			rc = spdk_bdev_read_blocks(g_desc, io_ch[i], NULL, 0, 1, io_during_io_done,
+						   &bdev_io_status[i]);
+			CU_ASSERT(rc == 0);
+		}
+		poll_threads();
+		CU_ASSERT(limit->remaining_this_timeslice == (round == 0 ? 298 : 308));
+		CU_ASSERT(limit->active_channels == 2);
+
+		for (i = 0; i < 2; i++) {
+			set_thread(i);
+			CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 1);
+		}
+		poll_threads();
+		CU_ASSERT(bdev_io_status[0] == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(bdev_io_status[1] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+
+	for (i = 0; i < 2; i++) {
+		set_thread(i);
+		spdk_put_io_channel(io_ch[i]);
+	}
+	poll_threads();
+
+	teardown_test();
+}
+
+static void
+get_device_stat_mt_done(struct spdk_bdev *bdev, struct spdk_bdev_io_stat *stat, void *cb_arg, int rc)
+{
+	int *status = cb_arg;
+
+	*status = rc;
+}
+
+static void
+get_device_stat_mt(void)
+{
+	struct spdk_io_channel *io_ch[2];
+	struct spdk_bdev_io_stat *stat, *prev_stat;
+	enum spdk_bdev_io_status bdev_io_status;
+	int status, rc, i;
+
+	setup_test();
+
+	stat = bdev_alloc_io_stat(true);
+	prev_stat = bdev_alloc_io_stat(true);
+	SPDK_CU_ASSERT_FATAL(stat != NULL && prev_stat != NULL);
+
+	/* Complete a read on each of two threads */
+	for (i = 0; i < 2; i++) {
+		set_thread(i);
+		io_ch[i] = spdk_bdev_get_io_channel(g_desc);
+		SPDK_CU_ASSERT_FATAL(io_ch[i] != NULL);
+
+		bdev_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch[i], NULL, 0, 1, io_during_io_done, &bdev_io_status);
+		CU_ASSERT(rc == 0);
+		poll_threads();
+		stub_complete_io(g_bdev.io_target, 0);
+		poll_threads();
+		CU_ASSERT(bdev_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+
+	/* The statistics of both channels are read without any message to their threads */
+	set_thread(0);
+	bdev_read_device_stat(&g_bdev.bdev, prev_stat);
+	CU_ASSERT(prev_stat->num_read_ops == 2);
+	CU_ASSERT(prev_stat->bytes_read == 2 * g_bdev.bdev.blocklen);
+
+	/* The callback is still called asynchronously */
+	status = 1;
+	spdk_bdev_get_device_stat(&g_bdev.bdev, stat, get_device_stat_mt_done, &status);
+	CU_ASSERT(status == 1);
+	poll_threads();
+	CU_ASSERT(status == 0);
+	CU_ASSERT(stat->num_read_ops == 2);
+
+	/* The statistics of a deleted channel are kept */
+	set_thread(1);
+	spdk_put_io_channel(io_ch[1]);
+	poll_threads();
+	set_thread(0);
+
+	bdev_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch[0], NULL, 0, 1, io_during_io_done, &bdev_io_status);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+
+	bdev_read_device_stat(&g_bdev.bdev, stat);
+	CU_ASSERT(stat->num_read_ops == 3);
+
+	/* The difference covers only the last read */
+	bdev_sub_io_stat(stat, prev_stat);
+	CU_ASSERT(stat->num_read_ops == 1);
+	CU_ASSERT(stat->bytes_read == g_bdev.bdev.blocklen);
+
+	spdk_put_io_channel(io_ch[0]);
+	poll_threads();
+
+	bdev_free_io_stat(stat);
+	bdev_free_io_stat(prev_stat);
+
+	teardown_test();
+}
+
 static void
 histogram_status_cb(void *cb_arg, int status)
 {
@@ -2659,6 +3010,10 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, enomem_multi_bdev_unregister);
 	CU_ADD_TEST(suite, enomem_multi_io_target);
 	CU_ADD_TEST(suite, qos_dynamic_enable);
+	CU_ADD_TEST(suite, qos_group);
+	CU_ADD_TEST(suite, qos_latency_target);
+	CU_ADD_TEST(suite, qos_quota_batch);
+	CU_ADD_TEST(suite, get_device_stat_mt);
 	CU_ADD_TEST(suite, bdev_histograms_mt);
 	CU_ADD_TEST(suite, bdev_set_io_timeout_mt);
 	CU_ADD_TEST(suite, lock_lba_range_then_submit_io);
@@ -211,13 +211,39 @@ __io_type_supported(void *ctx, enum spdk_bdev_io_type type)
 	return true;
 }
 
+static uint64_t g_base_offset_blocks;
+
+static void
+base_ut_submit_request(struct spdk_io_channel *_ch, struct spdk_bdev_io *bdev_io)
+{
+	struct bdev_ut_channel *ch = spdk_io_channel_get_ctx(_ch);
+
+	g_base_offset_blocks = bdev_io->u.bdev.offset_blocks;
+	TAILQ_INSERT_TAIL(&ch->outstanding_io, bdev_io, module_link);
+	ch->outstanding_io_count++;
+}
+
+static void
+part_ut_submit_request(struct spdk_io_channel *_ch, struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_part_channel *ch = spdk_io_channel_get_ctx(_ch);
+	int rc;
+
+	rc = spdk_bdev_part_submit_request(ch, bdev_io);
+	if (rc != 0) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
 static struct spdk_bdev_fn_table base_fn_table = {
 	.destruct		= __destruct,
+	.submit_request		= base_ut_submit_request,
 	.get_io_channel = part_ut_get_io_channel,
 	.io_type_supported	= __io_type_supported,
 };
 static struct spdk_bdev_fn_table part_fn_table = {
 	.destruct		= __destruct,
+	.submit_request		= part_ut_submit_request,
 	.io_type_supported	= __io_type_supported,
 };
 
@@ -444,6 +470,178 @@ part_construct_ext(void)
 	poll_threads();
 }
 
+static uint32_t g_io_done;
+static uint32_t g_io_failed;
+
+static void
+part_ut_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	g_io_done++;
+	if (!success) {
+		g_io_failed++;
+	}
+	spdk_bdev_free_io(bdev_io);
+}
+
+/* Complete the oldest I/O submitted to the base bdev. */
+static void
+base_ut_complete_io(void)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	bdev_io = TAILQ_FIRST(&g_bdev_ut_channel->outstanding_io);
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	TAILQ_REMOVE(&g_bdev_ut_channel->outstanding_io, bdev_io, module_link);
+	g_bdev_ut_channel->outstanding_io_count--;
+	spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+	poll_threads();
+}
+
+static void
+part_fairness_test(void)
+{
+	struct spdk_bdev_part_base	*base = NULL;
+	struct spdk_bdev_part		*part1, *part2;
+	struct spdk_bdev_desc		*desc1 = NULL, *desc2 = NULL;
+	struct spdk_io_channel		*io_ch1, *io_ch2;
+	struct spdk_bdev		bdev_base = {};
+	SPDK_BDEV_PART_TAILQ		tailq = TAILQ_HEAD_INITIALIZER(tailq);
+	/* Parts the base bdev I/Os are submitted for, part2 having three times the weight */
+	const int			expected[] = { 1, 2, 2, 2, 1, 2, 2, 2, 1, 2, 2, 1 };
+	char				buf[512];
+	uint32_t			i;
+	int rc;
+
+	ut_init_bdev();
+	bdev_base.name = "base";
+	bdev_base.blocklen = 512;
+	bdev_base.blockcnt = 1024;
+	bdev_base.fn_table = &base_fn_table;
+	bdev_base.module = &bdev_ut_if;
+	rc = spdk_bdev_register(&bdev_base);
+	CU_ASSERT(rc == 0);
+
+	rc = spdk_bdev_part_base_construct_ext("base", NULL, &vbdev_ut_if,
+					       &part_fn_table, &tailq, NULL,
+					       NULL, sizeof(struct spdk_bdev_part_channel),
+					       NULL, NULL, &base);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(base != NULL);
+
+	part1 = calloc(1, sizeof(*part1));
+	part2 = calloc(1, sizeof(*part2));
+	SPDK_CU_ASSERT_FATAL(part1 != NULL && part2 != NULL);
+	rc = spdk_bdev_part_construct(part1, base, "test1", 0, 512, "test");
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	rc = spdk_bdev_part_construct(part2, base, "test2", 512, 512, "test");
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	CU_ASSERT(bdev_part_get_by_bdev(&part1->internal.bdev) == part1);
+	CU_ASSERT(bdev_part_get_by_bdev(&bdev_base) == NULL);
+
+	CU_ASSERT(spdk_bdev_part_get_weight(part1) == SPDK_BDEV_PART_DEFAULT_WEIGHT);
+	CU_ASSERT(spdk_bdev_part_set_weight(part2, 0) == -EINVAL);
+	CU_ASSERT(spdk_bdev_part_set_weight(part2, SPDK_BDEV_PART_MAX_WEIGHT + 1) == -EINVAL);
+	CU_ASSERT(spdk_bdev_part_set_weight(part2, 3) == 0);
+	CU_ASSERT(spdk_bdev_part_get_weight(part2) == 3);
+	CU_ASSERT(spdk_bdev_part_base_get_queue_depth(base) == 0);
+	spdk_bdev_part_base_set_queue_depth(base, 4);
+	CU_ASSERT(spdk_bdev_part_base_get_queue_depth(base) == 4);
+
+	rc = spdk_bdev_open_ext("test1", true, bdev_ut_event_cb, NULL, &desc1);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_open_ext("test2", true, bdev_ut_event_cb, NULL, &desc2);
+	CU_ASSERT(rc == 0);
+	io_ch1 = spdk_bdev_get_io_channel(desc1);
+	io_ch2 = spdk_bdev_get_io_channel(desc2);
+	SPDK_CU_ASSERT_FATAL(io_ch1 != NULL && io_ch2 != NULL);
+
+	/* The first I/Os take all the queue slots of the base bdev */
+	g_io_done = 0;
+	g_io_failed = 0;
+	for (i = 0; i < 8; i++) {
+		rc = spdk_bdev_read_blocks(desc1, io_ch1, buf, i, 1, part_ut_io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	for (i = 0; i < 8; i++) {
+		rc = spdk_bdev_read_blocks(desc2, io_ch2, buf, i, 1, part_ut_io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 4);
+
+	/* The queued I/Os are submitted in proportion to the weight of the parts */
+	for (i = 0; i < SPDK_COUNTOF(expected); i++) {
+		base_ut_complete_io();
+		CU_ASSERT((g_base_offset_blocks < 512 ? 1 : 2) == expected[i]);
+		CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 4);
+	}
+	CU_ASSERT(g_io_done == SPDK_COUNTOF(expected));
+	CU_ASSERT(part1->internal.stat.queued_ios == 4);
+	CU_ASSERT(part2->internal.stat.queued_ios == 8);
+
+	while (g_bdev_ut_channel->outstanding_io_count > 0) {
+		base_ut_complete_io();
+	}
+	CU_ASSERT(g_io_done == 16);
+	CU_ASSERT(g_io_failed == 0);
+
+	/* Without a queue depth, the I/Os go to the base bdev right away */
+	spdk_bdev_part_base_set_queue_depth(base, 0);
+	for (i = 0; i < 8; i++) {
+		rc = spdk_bdev_read_blocks(desc1, io_ch1, buf, i, 1, part_ut_io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 8);
+	CU_ASSERT(part1->internal.stat.queued_ios == 4);
+	while (g_bdev_ut_channel->outstanding_io_count > 0) {
+		base_ut_complete_io();
+	}
+	CU_ASSERT(g_io_done == 24);
+
+	/* A reset fails the I/Os its part queued */
+	spdk_bdev_part_base_set_queue_depth(base, 1);
+	rc = spdk_bdev_read_blocks(desc1, io_ch1, buf, 0, 1, part_ut_io_done, NULL);
+	CU_ASSERT(rc == 0);
+	for (i = 0; i < 2; i++) {
+		rc = spdk_bdev_read_blocks(desc2, io_ch2, buf, i, 1, part_ut_io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 1);
+	rc = spdk_bdev_reset(desc2, io_ch2, part_ut_io_done, NULL);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(g_io_done == 26);
+	CU_ASSERT(g_io_failed == 2);
+	/* The reset itself doesn't take a queue slot */
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 2);
+	while (g_bdev_ut_channel->outstanding_io_count > 0) {
+		base_ut_complete_io();
+	}
+	CU_ASSERT(g_io_done == 28);
+	CU_ASSERT(g_io_failed == 2);
+
+	spdk_put_io_channel(io_ch1);
+	spdk_put_io_channel(io_ch2);
+	spdk_bdev_close(desc1);
+	spdk_bdev_close(desc2);
+	spdk_bdev_unregister(&part1->internal.bdev, NULL, NULL);
+	spdk_bdev_unregister(&part2->internal.bdev, NULL, NULL);
+	poll_threads();
+
+	rc = spdk_bdev_part_free(part1);
+	CU_ASSERT(rc == 1);
+	rc = spdk_bdev_part_free(part2);
+	CU_ASSERT(rc == 1);
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&tailq));
+
+	spdk_bdev_unregister(&bdev_base, NULL, NULL);
+	ut_fini_bdev();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -458,6 +656,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, part_free_test);
 	CU_ADD_TEST(suite, part_get_io_channel_test);
 	CU_ADD_TEST(suite, part_construct_ext);
+	CU_ADD_TEST(suite, part_fairness_test);
 
 	allocate_cores(1);
 	allocate_threads(1);
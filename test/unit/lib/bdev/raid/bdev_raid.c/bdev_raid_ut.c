@@ -121,11 +121,13 @@ DEFINE_STUB(spdk_bdev_get_memory_domains, int, (struct spdk_bdev *bdev,
 DEFINE_STUB(spdk_bdev_get_name, const char *, (const struct spdk_bdev *bdev), "test_bdev");
 DEFINE_STUB(spdk_bdev_get_md_size, uint32_t, (const struct spdk_bdev *bdev), 0);
 DEFINE_STUB(spdk_bdev_is_md_interleaved, bool, (const struct spdk_bdev *bdev), false);
+DEFINE_STUB(spdk_bdev_is_md_separate, bool, (const struct spdk_bdev *bdev), false);
 DEFINE_STUB(spdk_bdev_get_dif_type, enum spdk_dif_type, (const struct spdk_bdev *bdev),
 	    SPDK_DIF_DISABLE);
 DEFINE_STUB(spdk_bdev_is_dif_head_of_md, bool, (const struct spdk_bdev *bdev), false);
 DEFINE_STUB(spdk_bdev_notify_blockcnt_change, int, (struct spdk_bdev *bdev, uint64_t size), 0);
 DEFINE_STUB_V(raid_bdev_init_superblock, (struct raid_bdev *raid_bdev));
+DEFINE_STUB_V(raid_bdev_init_superblock_wib, (struct raid_bdev *raid_bdev));
 
 int
 raid_bdev_load_base_bdev_superblock(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
@@ -142,6 +144,18 @@ raid_bdev_write_superblock(struct raid_bdev *raid_bdev, raid_bdev_write_sb_cb cb
 	cb(0, raid_bdev, cb_ctx);
 }
 
+void
+raid_bdev_write_wib(struct raid_bdev *raid_bdev, void *buf, raid_bdev_write_sb_cb cb, void *cb_ctx)
+{
+	cb(0, raid_bdev, cb_ctx);
+}
+
+void
+raid_bdev_read_wib(struct raid_bdev *raid_bdev, void *buf, raid_bdev_write_sb_cb cb, void *cb_ctx)
+{
+	cb(0, raid_bdev, cb_ctx);
+}
+
 const struct spdk_uuid *
 spdk_bdev_get_uuid(const struct spdk_bdev *bdev)
 {
@@ -644,6 +658,30 @@ spdk_bdev_unquiesce(struct spdk_bdev *bdev, struct spdk_bdev_module *module,
 	return 0;
 }
 
+int
+spdk_bdev_quiesce_range(struct spdk_bdev *bdev, struct spdk_bdev_module *module,
+			uint64_t offset, uint64_t length,
+			spdk_bdev_quiesce_cb cb_fn, void *cb_arg)
+{
+	if (cb_fn) {
+		cb_fn(cb_arg, 0);
+	}
+
+	return 0;
+}
+
+int
+spdk_bdev_unquiesce_range(struct spdk_bdev *bdev, struct spdk_bdev_module *module,
+			  uint64_t offset, uint64_t length,
+			  spdk_bdev_quiesce_cb cb_fn, void *cb_arg)
+{
+	if (cb_fn) {
+		cb_fn(cb_arg, 0);
+	}
+
+	return 0;
+}
+
 static void
 bdev_io_cleanup(struct spdk_bdev_io *bdev_io)
 {
@@ -1972,6 +2010,106 @@ test_create_raid_superblock(void)
 
 }
 
+static void
+test_raid_process_options(void)
+{
+	struct raid_bdev_opts opts, orig_opts;
+	const char *process_str;
+
+	raid_bdev_get_opts(&orig_opts);
+	CU_ASSERT(orig_opts.process_window_size_kb == 1024);
+	CU_ASSERT(orig_opts.process_max_bandwidth_mb_sec == 0);
+
+	opts = orig_opts;
+	opts.process_window_size_kb = 0;
+	CU_ASSERT(raid_bdev_set_opts(&opts) == -EINVAL);
+
+	opts.process_window_size_kb = 512;
+	opts.process_max_bandwidth_mb_sec = 100;
+	CU_ASSERT(raid_bdev_set_opts(&opts) == 0);
+	memset(&opts, 0, sizeof(opts));
+	raid_bdev_get_opts(&opts);
+	CU_ASSERT(opts.process_window_size_kb == 512);
+	CU_ASSERT(opts.process_max_bandwidth_mb_sec == 100);
+
+	CU_ASSERT(raid_bdev_set_opts(&orig_opts) == 0);
+
+	process_str = raid_bdev_process_to_str(RAID_PROCESS_REBUILD);
+	CU_ASSERT(process_str != NULL && strcmp(process_str, "rebuild") == 0);
+	process_str = raid_bdev_process_to_str(RAID_PROCESS_RESYNC);
+	CU_ASSERT(process_str != NULL && strcmp(process_str, "resync") == 0);
+	process_str = raid_bdev_process_to_str(RAID_PROCESS_MAX);
+	CU_ASSERT(process_str != NULL && strlen(process_str) == 0);
+}
+
+static void
+test_raid_add_base_bdev(void)
+{
+	struct rpc_bdev_raid_create req;
+	struct rpc_bdev_raid_delete delete_req;
+	struct raid_bdev *raid_bdev;
+
+	set_globals();
+	CU_ASSERT(raid_bdev_init() == 0);
+
+	create_raid_bdev_create_req(&req, "raid1", 0, true, 0, false);
+	rpc_bdev_raid_create(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev(&req, true, RAID_BDEV_STATE_ONLINE);
+	free_test_req(&req);
+
+	raid_bdev = raid_bdev_find_by_name("raid1");
+	SPDK_CU_ASSERT_FATAL(raid_bdev != NULL);
+
+	/* The test raid module can't rebuild a base bdev */
+	CU_ASSERT(raid_bdev_add_base_bdev(raid_bdev, "Nvme_new", false) == -ENOTSUP);
+
+	raid_bdev->destroy_started = true;
+	CU_ASSERT(raid_bdev_add_base_bdev(raid_bdev, "Nvme_new", false) == -EBUSY);
+	raid_bdev->destroy_started = false;
+
+	create_raid_bdev_delete_req(&delete_req, "raid1", 0);
+	rpc_bdev_raid_delete(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	raid_bdev_exit();
+	base_bdevs_cleanup();
+	reset_globals();
+}
+
+static void
+test_raid_wib_regions(void)
+{
+	struct raid_bdev raid_bdev = {};
+	struct raid_bdev_wib wib = {};
+	uint64_t first, last;
+
+	raid_bdev.bdev.blockcnt = 1000;
+	wib.raid_bdev = &raid_bdev;
+	wib.region_size_shift = 6;
+
+	/* Without a write unit only the written regions are marked */
+	raid_bdev_wib_regions(&wib, 60, 8, &first, &last);
+	CU_ASSERT(first == 0);
+	CU_ASSERT(last == 1);
+	raid_bdev_wib_regions(&wib, 64, 64, &first, &last);
+	CU_ASSERT(first == 1);
+	CU_ASSERT(last == 1);
+
+	/* A partial write marks every region of the stripes it writes */
+	raid_bdev.write_unit_blocks = 96;
+	raid_bdev_wib_regions(&wib, 100, 1, &first, &last);
+	CU_ASSERT(first == 1);
+	CU_ASSERT(last == 2);
+	raid_bdev_wib_regions(&wib, 64, 64, &first, &last);
+	CU_ASSERT(first == 0);
+	CU_ASSERT(last == 2);
+
+	/* The last stripe is cut at the end of the raid bdev */
+	raid_bdev_wib_regions(&wib, 970, 1, &first, &last);
+	CU_ASSERT(first == 15);
+	CU_ASSERT(last == 15);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1999,6 +2137,9 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_raid_json_dump_info);
 	CU_ADD_TEST(suite, test_context_size);
 	CU_ADD_TEST(suite, test_raid_level_conversions);
+	CU_ADD_TEST(suite, test_raid_process_options);
+	CU_ADD_TEST(suite, test_raid_add_base_bdev);
+	CU_ADD_TEST(suite, test_raid_wib_regions);
 
 	allocate_threads(1);
 	set_thread(0);
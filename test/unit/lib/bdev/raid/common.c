@@ -109,6 +109,7 @@ raid_test_create_raid_bdev(struct raid_params *params, struct raid_bdev_module *
 		SPDK_CU_ASSERT_FATAL(desc != NULL);
 		desc->bdev = bdev;
 
+		base_info->raid_bdev = raid_bdev;
 		base_info->desc = desc;
 		base_info->data_offset = 0;
 		base_info->data_size = bdev->blockcnt;
@@ -138,6 +139,7 @@ raid_test_delete_raid_bdev(struct raid_bdev *raid_bdev)
 }
 
 struct raid_bdev_io_channel {
+	struct raid_bdev *_raid_bdev;
 	struct spdk_io_channel **_base_channels;
 	struct spdk_io_channel *_module_channel;
 };
@@ -163,6 +165,8 @@ raid_test_create_io_channel(struct raid_bdev *raid_bdev)
 	raid_ch = calloc(1, sizeof(*raid_ch));
 	SPDK_CU_ASSERT_FATAL(raid_ch != NULL);
 
+	raid_ch->_raid_bdev = raid_bdev;
+
 	raid_ch->_base_channels = calloc(raid_bdev->num_base_bdevs, sizeof(struct spdk_io_channel *));
 	SPDK_CU_ASSERT_FATAL(raid_ch->_base_channels != NULL);
 
@@ -212,6 +216,16 @@ raid_test_bdev_io_init(struct raid_bdev_io *raid_io, struct raid_bdev *raid_bdev
 	raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_SUCCESS;
 }
 
+void
+raid_bdev_io_init(struct raid_bdev_io *raid_io, struct raid_bdev_io_channel *raid_ch,
+		  enum spdk_bdev_io_type type, uint64_t offset_blocks,
+		  uint64_t num_blocks, struct iovec *iovs, int iovcnt, void *md_buf,
+		  struct spdk_memory_domain *memory_domain, void *memory_domain_ctx)
+{
+	raid_test_bdev_io_init(raid_io, raid_ch->_raid_bdev, raid_ch, type, offset_blocks, num_blocks,
+			       iovs, iovcnt, md_buf);
+}
+
 /* needs to be implemented in module unit test files */
 static void raid_test_bdev_io_complete(struct raid_bdev_io *raid_io,
 				       enum spdk_bdev_io_status status);
@@ -27,14 +27,93 @@ DEFINE_STUB(spdk_bdev_writev_blocks_with_md, int, (struct spdk_bdev_desc *desc,
 		struct iovec *iov, int iovcnt, void *md,
 		uint64_t offset_blocks, uint64_t num_blocks,
 		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
-DEFINE_STUB(spdk_bdev_readv_blocks_ext, int, (struct spdk_bdev_desc *desc,
-		struct spdk_io_channel *ch,
-		struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
-		spdk_bdev_io_completion_cb cb, void *cb_arg, struct spdk_bdev_ext_io_opts *opts), 0);
-DEFINE_STUB(spdk_bdev_writev_blocks_ext, int, (struct spdk_bdev_desc *desc,
-		struct spdk_io_channel *ch,
-		struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
-		spdk_bdev_io_completion_cb cb, void *cb_arg, struct spdk_bdev_ext_io_opts *opts), 0);
+
+struct ut_base_io {
+	struct spdk_bdev_desc *desc;
+	uint64_t offset_blocks;
+	uint64_t num_blocks;
+	spdk_bdev_io_completion_cb cb;
+	void *cb_arg;
+};
+
+#define UT_MAX_BASE_IOS 8
+
+static struct ut_base_io g_reads[UT_MAX_BASE_IOS];
+static struct ut_base_io g_writes[UT_MAX_BASE_IOS];
+static int g_reads_count;
+static int g_writes_count;
+static bool g_process_req_completed;
+static int g_process_req_status;
+static int g_raid_io_completed;
+static struct raid_base_bdev_info *g_failed_base_info;
+static int g_wib_range_refs;
+
+void
+raid_bdev_fail_base_bdev(struct raid_base_bdev_info *base_info)
+{
+	g_failed_base_info = base_info;
+}
+
+void
+raid_bdev_wib_range_get(struct raid_bdev *raid_bdev, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	g_wib_range_refs++;
+}
+
+void
+raid_bdev_wib_range_put(struct raid_bdev *raid_bdev, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	g_wib_range_refs--;
+}
+
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	return spdk_get_io_channel(desc);
+}
+
+static void
+ut_base_io_record(struct ut_base_io *ios, int *count, struct spdk_bdev_desc *desc,
+		  uint64_t offset_blocks, uint64_t num_blocks,
+		  spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	/* only the first few are kept, the read balancing test doesn't complete its reads */
+	if (*count < UT_MAX_BASE_IOS) {
+		ios[*count].desc = desc;
+		ios[*count].offset_blocks = offset_blocks;
+		ios[*count].num_blocks = num_blocks;
+		ios[*count].cb = cb;
+		ios[*count].cb_arg = cb_arg;
+	}
+	(*count)++;
+}
+
+int
+spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			   struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			   spdk_bdev_io_completion_cb cb, void *cb_arg, struct spdk_bdev_ext_io_opts *opts)
+{
+	ut_base_io_record(g_reads, &g_reads_count, desc, offset_blocks, num_blocks, cb, cb_arg);
+
+	return 0;
+}
+
+int
+spdk_bdev_writev_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			    struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			    spdk_bdev_io_completion_cb cb, void *cb_arg, struct spdk_bdev_ext_io_opts *opts)
+{
+	ut_base_io_record(g_writes, &g_writes_count, desc, offset_blocks, num_blocks, cb, cb_arg);
+
+	return 0;
+}
+
+void
+raid_bdev_process_request_complete(struct raid_bdev_process_request *process_req, int status)
+{
+	g_process_req_completed = true;
+	g_process_req_status = status;
+}
 
 static int
 test_setup(void)
@@ -144,6 +223,7 @@ static void
 raid_test_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
 {
 	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	g_raid_io_completed++;
 
 	put_raid_io(raid_io);
 }
@@ -192,8 +272,8 @@ _test_raid1_read_balancing(struct raid_bdev *raid_bdev, struct raid_bdev_io_chan
 	}
 
 	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
-		CU_ASSERT(raid1_ch->read_blocks_outstanding[i] == n * small_io_blocks);
-		raid1_ch->read_blocks_outstanding[i] = 0;
+		CU_ASSERT(raid1_ch->base[i].read_blocks_outstanding == n * small_io_blocks);
+		raid1_ch->base[i].read_blocks_outstanding = 0;
 	}
 
 	/*
@@ -215,7 +295,7 @@ _test_raid1_read_balancing(struct raid_bdev *raid_bdev, struct raid_bdev_io_chan
 	}
 
 	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
-		CU_ASSERT(raid1_ch->read_blocks_outstanding[i] == big_io_blocks);
+		CU_ASSERT(raid1_ch->base[i].read_blocks_outstanding == big_io_blocks);
 	}
 
 	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, small_io_blocks);
@@ -230,6 +310,421 @@ test_raid1_read_balancing(void)
 	run_for_each_raid1_config(_test_raid1_read_balancing);
 }
 
+static void
+_test_raid1_read_sequential(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid1_info *r1_info = raid_bdev->module_private;
+	const uint64_t io_blocks = 8;
+	struct raid_bdev_io *raid_io;
+	uint8_t stream_idx;
+	int n;
+
+	/*
+	 * A sequential stream stays on the same base bdev, even though the others have less
+	 * blocks outstanding, until it gets too loaded.
+	 */
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, io_blocks);
+	raid1_submit_read_request(raid_io);
+	stream_idx = raid_io->base_bdev_io_submitted;
+	put_raid_io(raid_io);
+
+	for (n = 1; n < RAID1_SEQUENTIAL_AFFINITY_FACTOR; n++) {
+		raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, io_blocks);
+		raid_io->offset_blocks = n * io_blocks;
+		raid1_submit_read_request(raid_io);
+		CU_ASSERT(raid_io->base_bdev_io_submitted == stream_idx);
+		put_raid_io(raid_io);
+	}
+
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, io_blocks);
+	raid_io->offset_blocks = n * io_blocks;
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted != stream_idx);
+	put_raid_io(raid_io);
+
+	/* a random read goes to the least loaded base bdev */
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, io_blocks);
+	raid_io->offset_blocks = 1000;
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted != stream_idx);
+	put_raid_io(raid_io);
+}
+
+static void
+test_raid1_read_sequential(void)
+{
+	run_for_each_raid1_config(_test_raid1_read_sequential);
+}
+
+static void
+ut_process_reset(void)
+{
+	g_reads_count = 0;
+	g_writes_count = 0;
+	g_process_req_completed = false;
+	g_process_req_status = INT_MIN;
+	g_raid_io_completed = 0;
+}
+
+static void
+ut_complete_base_ios(struct ut_base_io *ios, int count, bool success)
+{
+	struct spdk_bdev_io bdev_io = {};
+	int i;
+
+	for (i = 0; i < count; i++) {
+		bdev_io.bdev = ios[i].desc->bdev;
+		ios[i].cb(&bdev_io, success, ios[i].cb_arg);
+	}
+}
+
+static void
+_test_raid1_read_latency(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid1_info *r1_info = raid_bdev->module_private;
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	const uint64_t io_blocks = 4;
+	struct raid_bdev_io *raid_io;
+	uint8_t i;
+
+	/* read once from each base bdev, the first one is 10 times slower than the others */
+	MOCK_SET(spdk_get_ticks, 0);
+	ut_process_reset();
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, io_blocks);
+		raid_io->offset_blocks = i * 100;
+		raid1_submit_read_request(raid_io);
+		CU_ASSERT(raid_io->base_bdev_io_submitted == i);
+	}
+
+	MOCK_SET(spdk_get_ticks, 100);
+	ut_complete_base_ios(&g_reads[1], raid_bdev->num_base_bdevs - 1, true);
+	MOCK_SET(spdk_get_ticks, 1000);
+	ut_complete_base_ios(&g_reads[0], 1, true);
+	MOCK_CLEAR(spdk_get_ticks);
+
+	CU_ASSERT(raid1_ch->base[0].read_latency_ticks == 1000);
+	for (i = 1; i < raid_bdev->num_base_bdevs; i++) {
+		CU_ASSERT(raid1_ch->base[i].read_latency_ticks == 100);
+		CU_ASSERT(raid1_ch->base[i].read_blocks_outstanding == 0);
+	}
+
+	/* the slow base bdev is used only once the others are 10 times more loaded */
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, io_blocks);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted != 0);
+	put_raid_io(raid_io);
+
+	for (i = 1; i < raid_bdev->num_base_bdevs; i++) {
+		raid1_ch->base[i].read_blocks_outstanding = 10 * io_blocks;
+	}
+
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, io_blocks);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == 0);
+	put_raid_io(raid_io);
+}
+
+static void
+test_raid1_read_latency(void)
+{
+	run_for_each_raid1_config(_test_raid1_read_latency);
+}
+
+static void
+_test_raid1_read_split(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid1_info *r1_info = raid_bdev->module_private;
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	const uint64_t num_blocks = (4 * RAID1_READ_SPLIT_PART_SIZE_MIN) >> raid_bdev->blocklen_shift;
+	uint8_t num_parts = spdk_min(raid_bdev->num_base_bdevs, RAID1_READ_SPLIT_PARTS_MAX);
+	struct iovec iovs[4];
+	struct raid_bdev_io *raid_io;
+	uint64_t offset_blocks;
+	int i, j;
+
+	for (i = 0; i < 4; i++) {
+		iovs[i].iov_base = (void *)(uintptr_t)(0x100000 + i * RAID1_READ_SPLIT_PART_SIZE_MIN);
+		iovs[i].iov_len = RAID1_READ_SPLIT_PART_SIZE_MIN;
+	}
+
+	/* a large read is split in contiguous parts read from different base bdevs */
+	ut_process_reset();
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, num_blocks);
+	raid_io->offset_blocks = 64;
+	raid_io->iovs = iovs;
+	raid_io->iovcnt = 4;
+	raid1_submit_rw_request(raid_io);
+
+	SPDK_CU_ASSERT_FATAL(g_reads_count == num_parts);
+	CU_ASSERT(TAILQ_FIRST(&raid1_ch->free_split_reads) != &raid1_ch->split_reads[0]);
+	offset_blocks = 64;
+	for (i = 0; i < g_reads_count; i++) {
+		CU_ASSERT(g_reads[i].offset_blocks == offset_blocks);
+		offset_blocks += g_reads[i].num_blocks;
+		for (j = 0; j < i; j++) {
+			CU_ASSERT(g_reads[i].desc != g_reads[j].desc);
+		}
+	}
+	CU_ASSERT(offset_blocks == 64 + num_blocks);
+
+	ut_complete_base_ios(g_reads, g_reads_count, true);
+	CU_ASSERT(TAILQ_FIRST(&raid1_ch->free_split_reads) == &raid1_ch->split_reads[0]);
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		CU_ASSERT(raid1_ch->base[i].read_blocks_outstanding == 0);
+	}
+
+	/* a smaller read goes to a single base bdev */
+	ut_process_reset();
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, num_blocks / 4);
+	raid_io->iovs = iovs;
+	raid_io->iovcnt = 1;
+	raid1_submit_rw_request(raid_io);
+	SPDK_CU_ASSERT_FATAL(g_reads_count == 1);
+	CU_ASSERT(g_reads[0].num_blocks == num_blocks / 4);
+	ut_complete_base_ios(g_reads, g_reads_count, true);
+}
+
+static void
+test_raid1_read_split(void)
+{
+	run_for_each_raid1_config(_test_raid1_read_split);
+}
+
+static void
+_test_raid1_process_request(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	struct raid_bdev_process_request process_req = {};
+	struct raid_base_bdev_info *target;
+	uint8_t target_idx = raid_bdev->num_base_bdevs - 1;
+	const uint64_t num_blocks = spdk_min(raid_bdev->bdev.blockcnt, 8);
+	int ret;
+
+	/* rebuild - read from a healthy mirror, write only to the target */
+	target = &raid_bdev->base_bdev_info[target_idx];
+	raid_ch->_base_channels[target_idx] = NULL;
+
+	process_req.target = target;
+	process_req.target_ch = (void *)1;
+	process_req.offset_blocks = 0;
+	process_req.num_blocks = num_blocks;
+
+	ut_process_reset();
+	ret = raid1_submit_process_request(&process_req, raid_ch);
+	CU_ASSERT(ret == (int)num_blocks);
+	CU_ASSERT(process_req.iov.iov_len == num_blocks * raid_bdev->bdev.blocklen);
+	SPDK_CU_ASSERT_FATAL(g_reads_count == 1);
+	CU_ASSERT(g_reads[0].desc != target->desc);
+	CU_ASSERT(g_reads[0].num_blocks == num_blocks);
+	CU_ASSERT(g_writes_count == 0);
+
+	ut_complete_base_ios(g_reads, g_reads_count, true);
+	CU_ASSERT(raid1_ch->base[0].read_blocks_outstanding == 0);
+	SPDK_CU_ASSERT_FATAL(g_writes_count == 1);
+	CU_ASSERT(g_writes[0].desc == target->desc);
+	CU_ASSERT(g_writes[0].offset_blocks == 0);
+	CU_ASSERT(g_writes[0].num_blocks == num_blocks);
+	CU_ASSERT(g_process_req_completed == false);
+
+	ut_complete_base_ios(g_writes, g_writes_count, true);
+	CU_ASSERT(g_process_req_completed == true);
+	CU_ASSERT(g_process_req_status == 0);
+
+	/* a failed read fails the request without writing anything */
+	ut_process_reset();
+	ret = raid1_submit_process_request(&process_req, raid_ch);
+	CU_ASSERT(ret == (int)num_blocks);
+	ut_complete_base_ios(g_reads, g_reads_count, false);
+	CU_ASSERT(g_writes_count == 0);
+	CU_ASSERT(g_process_req_completed == true);
+	CU_ASSERT(g_process_req_status == -EIO);
+
+	/* resync - write to all the mirrors except the one that was read */
+	raid_ch->_base_channels[target_idx] = (void *)1;
+	process_req.target = NULL;
+	process_req.target_ch = NULL;
+
+	ut_process_reset();
+	ret = raid1_submit_process_request(&process_req, raid_ch);
+	CU_ASSERT(ret == (int)num_blocks);
+	SPDK_CU_ASSERT_FATAL(g_reads_count == 1);
+
+	ut_complete_base_ios(g_reads, g_reads_count, true);
+	CU_ASSERT(g_writes_count == raid_bdev->num_base_bdevs - 1);
+	CU_ASSERT(g_process_req_completed == false);
+
+	ut_complete_base_ios(g_writes, g_writes_count - 1, true);
+	CU_ASSERT(g_process_req_completed == false);
+	ut_complete_base_ios(&g_writes[g_writes_count - 1], 1, false);
+	CU_ASSERT(g_process_req_completed == true);
+	CU_ASSERT(g_process_req_status == -EIO);
+}
+
+static void
+test_raid1_process_request(void)
+{
+	run_for_each_raid1_config(_test_raid1_process_request);
+}
+
+static int
+ut_base_ch_create(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_base_ch_destroy(void *io_device, void *ctx_buf)
+{
+}
+
+static void
+_test_raid1_write_mostly(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid1_info *r1_info = raid_bdev->module_private;
+	uint8_t wm_idx = raid_bdev->num_base_bdevs - 1;
+	struct raid_base_bdev_info *wm = &raid_bdev->base_bdev_info[wm_idx];
+	struct spdk_io_channel *wm_ch;
+	struct raid_bdev_io *raid_io, *write_io;
+	struct ut_base_io behind;
+	struct iovec iov;
+	uint8_t i;
+	int n;
+
+	wm->write_mostly = true;
+	raid_bdev->num_base_bdevs_operational = raid_bdev->num_base_bdevs;
+
+	/* reads never go to the write-mostly member while another one is available */
+	for (n = 0; n < 4; n++) {
+		raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 1);
+		raid1_submit_read_request(raid_io);
+		CU_ASSERT(raid_io->base_bdev_io_submitted != wm_idx);
+		put_raid_io(raid_io);
+	}
+
+	for (i = 0; i < wm_idx; i++) {
+		raid_ch->_base_channels[i] = NULL;
+	}
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 1);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == wm_idx);
+	put_raid_io(raid_io);
+	for (i = 0; i < wm_idx; i++) {
+		raid_ch->_base_channels[i] = (void *)1;
+	}
+
+	/* a failed write to the write-mostly member removes it instead of failing the write */
+	iov.iov_len = raid_bdev->bdev.blocklen;
+	iov.iov_base = calloc(1, iov.iov_len);
+	SPDK_CU_ASSERT_FATAL(iov.iov_base != NULL);
+
+	ut_process_reset();
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 1);
+	raid_io->iovs = &iov;
+	raid_io->iovcnt = 1;
+	raid1_submit_rw_request(raid_io);
+	SPDK_CU_ASSERT_FATAL(g_writes_count == raid_bdev->num_base_bdevs);
+	ut_complete_base_ios(g_writes, wm_idx, true);
+	CU_ASSERT(g_raid_io_completed == 0);
+	ut_complete_base_ios(&g_writes[wm_idx], 1, false);
+	CU_ASSERT(g_raid_io_completed == 1);
+	CU_ASSERT(g_failed_base_info == wm);
+
+	/* with write-behind the write completes once the other members are written */
+	spdk_io_device_register(wm->desc, ut_base_ch_create, ut_base_ch_destroy, 0, "ut_base");
+	wm_ch = spdk_get_io_channel(wm->desc);
+	SPDK_CU_ASSERT_FATAL(wm_ch != NULL);
+	raid_ch->_base_channels[wm_idx] = wm_ch;
+	raid_bdev->write_behind = 1;
+	raid_bdev->wib = (void *)1;
+
+	ut_process_reset();
+	g_failed_base_info = NULL;
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 1);
+	raid_io->iovs = &iov;
+	raid_io->iovcnt = 1;
+	raid1_submit_rw_request(raid_io);
+	SPDK_CU_ASSERT_FATAL(g_writes_count == raid_bdev->num_base_bdevs);
+	CU_ASSERT(g_writes[wm_idx].desc == wm->desc);
+	CU_ASSERT(g_wib_range_refs == 1);
+	CU_ASSERT(wm->write_behind_outstanding == 1);
+	CU_ASSERT(r1_info->write_behind_outstanding == 1);
+	ut_complete_base_ios(g_writes, wm_idx, true);
+	CU_ASSERT(g_raid_io_completed == 1);
+	behind = g_writes[wm_idx];
+
+	/* the limit is reached, the next write waits for all the members */
+	ut_process_reset();
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 1);
+	raid_io->offset_blocks = 1;
+	raid_io->iovs = &iov;
+	raid_io->iovcnt = 1;
+	if (raid_bdev->bdev.blockcnt > 1) {
+		raid1_submit_rw_request(raid_io);
+		SPDK_CU_ASSERT_FATAL(g_writes_count == raid_bdev->num_base_bdevs);
+		ut_complete_base_ios(g_writes, wm_idx, true);
+		CU_ASSERT(g_raid_io_completed == 0);
+		ut_complete_base_ios(&g_writes[wm_idx], 1, true);
+		CU_ASSERT(g_raid_io_completed == 1);
+	} else {
+		put_raid_io(raid_io);
+	}
+
+	/* an overlapping write and a read from the write-mostly member wait for it */
+	ut_process_reset();
+	write_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 1);
+	write_io->iovs = &iov;
+	write_io->iovcnt = 1;
+	raid1_submit_rw_request(write_io);
+	CU_ASSERT(g_writes_count == 0);
+
+	for (i = 0; i < wm_idx; i++) {
+		raid_ch->_base_channels[i] = NULL;
+	}
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 1);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(g_reads_count == 0);
+	for (i = 0; i < wm_idx; i++) {
+		raid_ch->_base_channels[i] = (void *)1;
+	}
+
+	/* a failed write-behind write removes the member, the write was already completed */
+	behind.cb(NULL, false, behind.cb_arg);
+	CU_ASSERT(g_failed_base_info == wm);
+	CU_ASSERT(g_wib_range_refs == 0);
+	CU_ASSERT(wm->write_behind_outstanding == 0);
+	CU_ASSERT(r1_info->write_behind_outstanding == 0);
+
+	poll_threads();
+	CU_ASSERT(g_reads_count == 1);
+	CU_ASSERT(g_writes_count == raid_bdev->num_base_bdevs);
+	CU_ASSERT(r1_info->write_behind_outstanding == 1);
+	ut_complete_base_ios(g_reads, g_reads_count, true);
+	CU_ASSERT(g_raid_io_completed == 1);
+	ut_complete_base_ios(g_writes, wm_idx, true);
+	CU_ASSERT(g_raid_io_completed == 2);
+	ut_complete_base_ios(&g_writes[wm_idx], 1, true);
+	CU_ASSERT(g_wib_range_refs == 0);
+	CU_ASSERT(r1_info->write_behind_outstanding == 0);
+
+	raid_bdev->wib = NULL;
+	raid_bdev->write_behind = 0;
+	raid_ch->_base_channels[wm_idx] = (void *)1;
+	spdk_put_io_channel(wm_ch);
+	spdk_io_device_unregister(wm->desc, NULL);
+	poll_threads();
+	free(iov.iov_base);
+	wm->write_mostly = false;
+	g_failed_base_info = NULL;
+	ut_process_reset();
+}
+
+static void
+test_raid1_write_mostly(void)
+{
+	run_for_each_raid1_config(_test_raid1_write_mostly);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -241,6 +736,11 @@ main(int argc, char **argv)
 	suite = CU_add_suite("raid1", test_setup, test_cleanup);
 	CU_ADD_TEST(suite, test_raid1_start);
 	CU_ADD_TEST(suite, test_raid1_read_balancing);
+	CU_ADD_TEST(suite, test_raid1_read_sequential);
+	CU_ADD_TEST(suite, test_raid1_read_latency);
+	CU_ADD_TEST(suite, test_raid1_read_split);
+	CU_ADD_TEST(suite, test_raid1_process_request);
+	CU_ADD_TEST(suite, test_raid1_write_mostly);
 
 	allocate_threads(1);
 	set_thread(0);
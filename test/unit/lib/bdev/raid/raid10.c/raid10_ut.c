@@ -0,0 +1,500 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_internal/cunit.h"
+#include "spdk/env.h"
+
+#include "common/lib/ut_multithread.c"
+
+#include "bdev/raid/raid10.c"
+#include "../common.c"
+
+DEFINE_STUB_V(raid_bdev_module_list_add, (struct raid_bdev_module *raid_module));
+DEFINE_STUB_V(raid_bdev_module_stop_done, (struct raid_bdev *raid_bdev));
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB_V(raid_bdev_queue_io_wait, (struct raid_bdev_io *raid_io, struct spdk_bdev *bdev,
+					struct spdk_io_channel *ch, spdk_bdev_io_wait_cb cb_fn));
+DEFINE_STUB(spdk_bdev_flush_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		void *cb_arg), 0);
+
+struct ut_base_io {
+	struct spdk_bdev_desc *desc;
+	uint64_t offset_blocks;
+	uint64_t num_blocks;
+	spdk_bdev_io_completion_cb cb;
+	void *cb_arg;
+};
+
+#define UT_MAX_BASE_IOS 16
+
+static struct ut_base_io g_base_ios[UT_MAX_BASE_IOS];
+static uint32_t g_base_ios_count;
+static enum spdk_bdev_io_status g_io_status;
+static int g_io_completed;
+static bool g_process_req_completed;
+static int g_process_req_status;
+
+static int
+ut_base_io_record(struct spdk_bdev_desc *desc, uint64_t offset_blocks, uint64_t num_blocks,
+		  spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	SPDK_CU_ASSERT_FATAL(g_base_ios_count < UT_MAX_BASE_IOS);
+
+	g_base_ios[g_base_ios_count].desc = desc;
+	g_base_ios[g_base_ios_count].offset_blocks = offset_blocks;
+	g_base_ios[g_base_ios_count].num_blocks = num_blocks;
+	g_base_ios[g_base_ios_count].cb = cb;
+	g_base_ios[g_base_ios_count].cb_arg = cb_arg;
+	g_base_ios_count++;
+
+	return 0;
+}
+
+int
+spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			   struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			   spdk_bdev_io_completion_cb cb, void *cb_arg, struct spdk_bdev_ext_io_opts *opts)
+{
+	return ut_base_io_record(desc, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_writev_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			    struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			    spdk_bdev_io_completion_cb cb, void *cb_arg, struct spdk_bdev_ext_io_opts *opts)
+{
+	return ut_base_io_record(desc, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_unmap_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_base_io_record(desc, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+void
+raid_bdev_process_request_complete(struct raid_bdev_process_request *process_req, int status)
+{
+	g_process_req_completed = true;
+	g_process_req_status = status;
+}
+
+static int
+test_setup(void)
+{
+	uint8_t num_base_bdevs_values[] = { 4, 6 };
+	uint64_t base_bdev_blockcnt_values[] = { 1024, 1024 * 1024 + 7 };
+	uint32_t base_bdev_blocklen_values[] = { 512, 4096 };
+	uint8_t *num_base_bdevs;
+	uint64_t *base_bdev_blockcnt;
+	uint32_t *base_bdev_blocklen;
+	struct raid_params params;
+	uint64_t params_count;
+	int rc;
+
+	params_count = SPDK_COUNTOF(num_base_bdevs_values) *
+		       SPDK_COUNTOF(base_bdev_blockcnt_values) *
+		       SPDK_COUNTOF(base_bdev_blocklen_values);
+	rc = raid_test_params_alloc(params_count);
+	if (rc) {
+		return rc;
+	}
+
+	ARRAY_FOR_EACH(num_base_bdevs_values, num_base_bdevs) {
+		ARRAY_FOR_EACH(base_bdev_blockcnt_values, base_bdev_blockcnt) {
+			ARRAY_FOR_EACH(base_bdev_blocklen_values, base_bdev_blocklen) {
+				params.num_base_bdevs = *num_base_bdevs;
+				params.base_bdev_blockcnt = *base_bdev_blockcnt;
+				params.base_bdev_blocklen = *base_bdev_blocklen;
+				params.strip_size = 64;
+				params.md_len = 0;
+				raid_test_params_add(&params);
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int
+test_cleanup(void)
+{
+	raid_test_params_free();
+	return 0;
+}
+
+static struct raid10_info *
+create_raid10(struct raid_params *params)
+{
+	struct raid_bdev *raid_bdev = raid_test_create_raid_bdev(params, &g_raid10_module);
+
+	SPDK_CU_ASSERT_FATAL(raid10_start(raid_bdev) == 0);
+
+	return raid_bdev->module_private;
+}
+
+static void
+delete_raid10(struct raid10_info *r10_info)
+{
+	struct raid_bdev *raid_bdev = r10_info->raid_bdev;
+
+	raid10_stop(raid_bdev);
+
+	raid_test_delete_raid_bdev(raid_bdev);
+}
+
+static void
+test_raid10_start(void)
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct raid10_info *r10_info;
+		uint64_t data_size;
+
+		r10_info = create_raid10(params);
+
+		SPDK_CU_ASSERT_FATAL(r10_info != NULL);
+
+		data_size = params->base_bdev_blockcnt - params->base_bdev_blockcnt % params->strip_size;
+
+		CU_ASSERT_EQUAL(r10_info->raid_bdev->level, RAID10);
+		CU_ASSERT_EQUAL(r10_info->raid_bdev->bdev.blockcnt,
+				data_size * params->num_base_bdevs / RAID10_MIRRORS);
+		CU_ASSERT_EQUAL(r10_info->raid_bdev->bdev.optimal_io_boundary, params->strip_size);
+		CU_ASSERT_TRUE(r10_info->raid_bdev->bdev.split_on_optimal_io_boundary);
+		CU_ASSERT_PTR_EQUAL(r10_info->raid_bdev->module, &g_raid10_module);
+
+		delete_raid10(r10_info);
+	}
+}
+
+static void
+raid_test_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	g_io_status = status;
+	g_io_completed++;
+}
+
+static void
+ut_reset(void)
+{
+	g_base_ios_count = 0;
+	g_io_completed = 0;
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	g_process_req_completed = false;
+	g_process_req_status = INT_MIN;
+}
+
+static void
+ut_complete_base_ios(int first, int count, bool success)
+{
+	int i;
+
+	for (i = first; i < first + count; i++) {
+		g_base_ios[i].cb(NULL, success, g_base_ios[i].cb_arg);
+	}
+}
+
+static uint8_t
+ut_base_io_idx(struct raid_bdev *raid_bdev, struct ut_base_io *base_io)
+{
+	uint8_t i;
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (raid_bdev->base_bdev_info[i].desc == base_io->desc) {
+			return i;
+		}
+	}
+
+	CU_FAIL_FATAL("base io on unknown base bdev");
+	return UINT8_MAX;
+}
+
+static void
+run_for_each_raid10_config(void (*test_fn)(struct raid_bdev *raid_bdev,
+			   struct raid_bdev_io_channel *raid_ch))
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct raid10_info *r10_info;
+		struct raid_bdev_io_channel *raid_ch;
+
+		r10_info = create_raid10(params);
+		raid_ch = raid_test_create_io_channel(r10_info->raid_bdev);
+
+		test_fn(r10_info->raid_bdev, raid_ch);
+
+		raid_test_destroy_io_channel(raid_ch);
+		delete_raid10(r10_info);
+	}
+}
+
+static void
+_test_raid10_rw(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid10_io_channel *raid10_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	uint8_t num_groups = raid_bdev->num_base_bdevs / RAID10_MIRRORS;
+	uint32_t strip_size = raid_bdev->strip_size;
+	struct raid_bdev_io raid_io, raid_io2;
+	uint64_t strip, offset_blocks;
+	uint8_t group, idx, first_idx;
+
+	for (strip = 0; strip < 2 * num_groups; strip++) {
+		group = strip % num_groups;
+		offset_blocks = strip * strip_size + 3;
+
+		/* reads alternate between the members of the group */
+		ut_reset();
+		raid_test_bdev_io_init(&raid_io, raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+				       offset_blocks, 8, NULL, 0, NULL);
+		raid10_submit_rw_request(&raid_io);
+		SPDK_CU_ASSERT_FATAL(g_base_ios_count == 1);
+		first_idx = ut_base_io_idx(raid_bdev, &g_base_ios[0]);
+		CU_ASSERT(first_idx / RAID10_MIRRORS == group);
+		CU_ASSERT(g_base_ios[0].offset_blocks == (strip / num_groups) * strip_size + 3);
+		CU_ASSERT(g_base_ios[0].num_blocks == 8);
+		CU_ASSERT(raid10_ch->read_blocks_outstanding[first_idx] == 8);
+
+		raid_test_bdev_io_init(&raid_io2, raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+				       offset_blocks, 8, NULL, 0, NULL);
+		raid10_submit_rw_request(&raid_io2);
+		SPDK_CU_ASSERT_FATAL(g_base_ios_count == 2);
+		idx = ut_base_io_idx(raid_bdev, &g_base_ios[1]);
+		CU_ASSERT(idx / RAID10_MIRRORS == group);
+		CU_ASSERT(idx != first_idx);
+
+		ut_complete_base_ios(0, 2, true);
+		CU_ASSERT(g_io_completed == 2);
+		CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(raid10_ch->read_blocks_outstanding[first_idx] == 0);
+		CU_ASSERT(raid10_ch->read_blocks_outstanding[idx] == 0);
+
+		/* writes go to all the members of the group */
+		ut_reset();
+		raid_test_bdev_io_init(&raid_io, raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+				       offset_blocks, 8, NULL, 0, NULL);
+		raid10_submit_rw_request(&raid_io);
+		SPDK_CU_ASSERT_FATAL(g_base_ios_count == RAID10_MIRRORS);
+		for (idx = 0; idx < RAID10_MIRRORS; idx++) {
+			CU_ASSERT(ut_base_io_idx(raid_bdev, &g_base_ios[idx]) == group * RAID10_MIRRORS + idx);
+			CU_ASSERT(g_base_ios[idx].offset_blocks == (strip / num_groups) * strip_size + 3);
+		}
+		ut_complete_base_ios(0, 1, true);
+		CU_ASSERT(g_io_completed == 0);
+		ut_complete_base_ios(1, 1, false);
+		CU_ASSERT(g_io_completed == 1);
+		CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	}
+
+	/* a missing member is skipped by reads and writes */
+	raid_ch->_base_channels[1] = NULL;
+
+	ut_reset();
+	raid_test_bdev_io_init(&raid_io, raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, 0, 8, NULL, 0, NULL);
+	raid10_submit_rw_request(&raid_io);
+	raid_test_bdev_io_init(&raid_io2, raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, 0, 8, NULL, 0, NULL);
+	raid10_submit_rw_request(&raid_io2);
+	SPDK_CU_ASSERT_FATAL(g_base_ios_count == 2);
+	CU_ASSERT(ut_base_io_idx(raid_bdev, &g_base_ios[0]) == 0);
+	CU_ASSERT(ut_base_io_idx(raid_bdev, &g_base_ios[1]) == 0);
+	ut_complete_base_ios(0, 2, true);
+
+	ut_reset();
+	raid_test_bdev_io_init(&raid_io, raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0, 8, NULL, 0, NULL);
+	raid10_submit_rw_request(&raid_io);
+	SPDK_CU_ASSERT_FATAL(g_base_ios_count == 1);
+	CU_ASSERT(ut_base_io_idx(raid_bdev, &g_base_ios[0]) == 0);
+	ut_complete_base_ios(0, 1, true);
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* without any member of the group the I/O fails */
+	raid_ch->_base_channels[0] = NULL;
+
+	ut_reset();
+	raid_test_bdev_io_init(&raid_io, raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0, 8, NULL, 0, NULL);
+	raid10_submit_rw_request(&raid_io);
+	CU_ASSERT(g_base_ios_count == 0);
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+
+	raid_ch->_base_channels[0] = (void *)1;
+	raid_ch->_base_channels[1] = (void *)1;
+}
+
+static void
+test_raid10_rw(void)
+{
+	run_for_each_raid10_config(_test_raid10_rw);
+}
+
+static void
+_test_raid10_unmap(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	uint8_t num_groups = raid_bdev->num_base_bdevs / RAID10_MIRRORS;
+	uint32_t strip_size = raid_bdev->strip_size;
+	uint64_t offsets[] = { 0, 5, strip_size - 1, strip_size * num_groups + 7 };
+	uint64_t lengths[] = { 1, strip_size, strip_size * num_groups + 3, strip_size * 5 * num_groups };
+	uint64_t *offset, *length, blocks, base_offset;
+	struct raid_bdev_io raid_io;
+	uint8_t idx, group;
+	uint32_t i;
+
+	ARRAY_FOR_EACH(offsets, offset) {
+		ARRAY_FOR_EACH(lengths, length) {
+			uint64_t blocks_per_group[num_groups];
+
+			if (*offset + *length > raid_bdev->bdev.blockcnt) {
+				continue;
+			}
+
+			ut_reset();
+			raid_test_bdev_io_init(&raid_io, raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_UNMAP,
+					       *offset, *length, NULL, 0, NULL);
+			raid10_submit_null_payload_request(&raid_io);
+
+			CU_ASSERT(g_base_ios_count % RAID10_MIRRORS == 0);
+			CU_ASSERT(g_base_ios_count == RAID10_MIRRORS * spdk_min(num_groups,
+					(*offset + *length - 1) / strip_size - *offset / strip_size + 1));
+
+			memset(blocks_per_group, 0, sizeof(blocks_per_group));
+			blocks = 0;
+			for (i = 0; i < g_base_ios_count; i++) {
+				idx = ut_base_io_idx(raid_bdev, &g_base_ios[i]);
+				group = idx / RAID10_MIRRORS;
+				if (idx % RAID10_MIRRORS == 0) {
+					blocks += g_base_ios[i].num_blocks;
+					blocks_per_group[group] = g_base_ios[i].num_blocks;
+				} else {
+					CU_ASSERT(g_base_ios[i].num_blocks == blocks_per_group[group]);
+				}
+			}
+			CU_ASSERT(blocks == *length);
+
+			/* the first block of the range is unmapped on its group at the mapped offset */
+			group = raid10_map_offset(raid_bdev, *offset, &base_offset);
+			CU_ASSERT(ut_base_io_idx(raid_bdev, &g_base_ios[0]) == group * RAID10_MIRRORS);
+			CU_ASSERT(g_base_ios[0].offset_blocks == base_offset);
+
+			ut_complete_base_ios(0, g_base_ios_count, true);
+			CU_ASSERT(g_io_completed == 1);
+			CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		}
+	}
+}
+
+static void
+test_raid10_unmap(void)
+{
+	run_for_each_raid10_config(_test_raid10_unmap);
+}
+
+static void
+_test_raid10_process_request(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	uint8_t num_groups = raid_bdev->num_base_bdevs / RAID10_MIRRORS;
+	uint32_t strip_size = raid_bdev->strip_size;
+	struct raid_bdev_process_request process_req = {};
+	uint8_t target_idx = RAID10_MIRRORS + 1;
+	struct raid_base_bdev_info *target = &raid_bdev->base_bdev_info[target_idx];
+	int ret;
+
+	/* rebuild of a member of the second group */
+	raid_ch->_base_channels[target_idx] = NULL;
+	process_req.target = target;
+	process_req.target_ch = (void *)1;
+
+	/* the strip of the first group is skipped */
+	ut_reset();
+	process_req.offset_blocks = 0;
+	process_req.num_blocks = strip_size * num_groups;
+	ret = raid10_submit_process_request(&process_req, raid_ch);
+	CU_ASSERT(ret == (int)strip_size);
+	CU_ASSERT(g_base_ios_count == 0);
+	CU_ASSERT(g_process_req_completed == true);
+	CU_ASSERT(g_process_req_status == 0);
+
+	/* the strip of the second group is copied from the other member */
+	ut_reset();
+	process_req.offset_blocks = strip_size;
+	process_req.num_blocks = strip_size * num_groups;
+	ret = raid10_submit_process_request(&process_req, raid_ch);
+	CU_ASSERT(ret == (int)strip_size);
+	SPDK_CU_ASSERT_FATAL(g_base_ios_count == 1);
+	CU_ASSERT(ut_base_io_idx(raid_bdev, &g_base_ios[0]) == RAID10_MIRRORS);
+	CU_ASSERT(g_base_ios[0].offset_blocks == 0);
+	CU_ASSERT(g_base_ios[0].num_blocks == strip_size);
+
+	ut_complete_base_ios(0, 1, true);
+	SPDK_CU_ASSERT_FATAL(g_base_ios_count == 2);
+	CU_ASSERT(g_base_ios[1].desc == target->desc);
+	CU_ASSERT(g_base_ios[1].offset_blocks == 0);
+	CU_ASSERT(g_base_ios[1].num_blocks == strip_size);
+	CU_ASSERT(g_process_req_completed == false);
+
+	ut_complete_base_ios(1, 1, true);
+	CU_ASSERT(g_process_req_completed == true);
+	CU_ASSERT(g_process_req_status == 0);
+
+	/* resync writes to the other member of the group */
+	raid_ch->_base_channels[target_idx] = (void *)1;
+	process_req.target = NULL;
+	process_req.target_ch = NULL;
+
+	ut_reset();
+	process_req.offset_blocks = strip_size * num_groups;
+	process_req.num_blocks = strip_size / 2;
+	ret = raid10_submit_process_request(&process_req, raid_ch);
+	CU_ASSERT(ret == (int)strip_size / 2);
+	SPDK_CU_ASSERT_FATAL(g_base_ios_count == 1);
+	CU_ASSERT(ut_base_io_idx(raid_bdev, &g_base_ios[0]) / RAID10_MIRRORS == 0);
+
+	ut_complete_base_ios(0, 1, true);
+	SPDK_CU_ASSERT_FATAL(g_base_ios_count == 2);
+	CU_ASSERT(ut_base_io_idx(raid_bdev, &g_base_ios[1]) / RAID10_MIRRORS == 0);
+	CU_ASSERT(g_base_ios[1].desc != g_base_ios[0].desc);
+	CU_ASSERT(g_base_ios[1].offset_blocks == strip_size);
+
+	ut_complete_base_ios(1, 1, false);
+	CU_ASSERT(g_process_req_completed == true);
+	CU_ASSERT(g_process_req_status == -EIO);
+}
+
+static void
+test_raid10_process_request(void)
+{
+	run_for_each_raid10_config(_test_raid10_process_request);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("raid10", test_setup, test_cleanup);
+	CU_ADD_TEST(suite, test_raid10_start);
+	CU_ADD_TEST(suite, test_raid10_rw);
+	CU_ADD_TEST(suite, test_raid10_unmap);
+	CU_ADD_TEST(suite, test_raid10_process_request);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+	CU_cleanup_registry();
+
+	free_threads();
+
+	return num_failures;
+}
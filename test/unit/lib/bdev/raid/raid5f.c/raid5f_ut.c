@@ -20,6 +20,8 @@ DEFINE_STUB_V(raid_bdev_module_list_add, (struct raid_bdev_module *raid_module))
 DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 0);
 DEFINE_STUB_V(raid_bdev_module_stop_done, (struct raid_bdev *raid_bdev));
 DEFINE_STUB(accel_channel_create, int, (void *io_device, void *ctx_buf), 0);
+DEFINE_STUB_V(raid_bdev_process_request_complete, (struct raid_bdev_process_request *process_req,
+	      int status));
 DEFINE_STUB_V(accel_channel_destroy, (void *io_device, void *ctx_buf));
 
 struct spdk_io_channel *
@@ -185,7 +187,12 @@ test_raid5f_start(void)
 				(params->num_base_bdevs - 1));
 		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.optimal_io_boundary, params->strip_size);
 		CU_ASSERT_TRUE(r5f_info->raid_bdev->bdev.split_on_optimal_io_boundary);
-		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.write_unit_size, r5f_info->stripe_blocks);
+		if (params->md_len != 0) {
+			CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.write_unit_size, r5f_info->stripe_blocks);
+			CU_ASSERT_TRUE(r5f_info->raid_bdev->bdev.split_on_write_unit);
+		} else {
+			CU_ASSERT_FALSE(r5f_info->raid_bdev->bdev.split_on_write_unit);
+		}
 
 		delete_raid5f(r5f_info);
 	}
@@ -220,7 +227,9 @@ struct raid_io_info {
 	size_t parity_md_buf_size;
 	void *degraded_buf;
 	void *degraded_md_buf;
+	void *old_parity;
 	enum spdk_bdev_io_status status;
+	uint64_t completed_raid_ios;
 	TAILQ_HEAD(, spdk_bdev_io) bdev_io_queue;
 	TAILQ_HEAD(, spdk_bdev_io_wait_entry) bdev_io_wait_queue;
 	struct {
@@ -259,13 +268,14 @@ raid_test_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_statu
 			raid_io);
 
 	test_raid_bdev_io->io_info->status = status;
+	test_raid_bdev_io->io_info->completed_raid_ios++;
 
 	free(raid_io->iovs);
 	free(test_raid_bdev_io);
 }
 
 static struct raid_bdev_io *
-get_raid_io(struct raid_io_info *io_info)
+get_raid_io_range(struct raid_io_info *io_info, uint64_t offset_blocks, uint64_t num_blocks)
 {
 	struct raid_bdev_io *raid_io;
 	struct raid_bdev *raid_bdev = io_info->r5f_info->raid_bdev;
@@ -296,11 +306,18 @@ get_raid_io(struct raid_io_info *io_info)
 		md_buf = io_info->src_md_buf;
 	}
 
+	SPDK_CU_ASSERT_FATAL(offset_blocks >= io_info->offset_blocks);
+	SPDK_CU_ASSERT_FATAL(offset_blocks + num_blocks <= io_info->offset_blocks + io_info->num_blocks);
+	buf += (offset_blocks - io_info->offset_blocks) * blocklen;
+	if (md_buf != NULL) {
+		md_buf += (offset_blocks - io_info->offset_blocks) * raid_bdev->bdev.md_len;
+	}
+
 	iovcnt = 7;
 	iovs = calloc(iovcnt, sizeof(*iovs));
 	SPDK_CU_ASSERT_FATAL(iovs != NULL);
 
-	remaining = io_info->num_blocks * blocklen;
+	remaining = num_blocks * blocklen;
 	iov_len = remaining / iovcnt;
 
 	for (i = 0; i < iovcnt; i++) {
@@ -315,11 +332,17 @@ get_raid_io(struct raid_io_info *io_info)
 	raid_io = &test_raid_bdev_io->raid_io;
 
 	raid_test_bdev_io_init(raid_io, raid_bdev, io_info->raid_ch, io_info->io_type,
-			       io_info->offset_blocks, io_info->num_blocks, iovs, iovcnt, md_buf);
+			       offset_blocks, num_blocks, iovs, iovcnt, md_buf);
 
 	return raid_io;
 }
 
+static struct raid_bdev_io *
+get_raid_io(struct raid_io_info *io_info)
+{
+	return get_raid_io_range(io_info, io_info->offset_blocks, io_info->num_blocks);
+}
+
 void
 spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
 {
@@ -422,13 +445,19 @@ spdk_bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_chan
 		if (io_info->parity_buf == NULL) {
 			goto submit;
 		}
-		dest.iov_base = io_info->parity_buf;
+		data_offset = (offset_blocks % raid_bdev->strip_size) * raid_bdev->bdev.blocklen;
+		SPDK_CU_ASSERT_FATAL(data_offset + num_blocks * raid_bdev->bdev.blocklen <=
+				     io_info->parity_buf_size);
+		dest.iov_base = io_info->parity_buf + data_offset;
 		if (md_buf != NULL) {
-			dest_md_buf = io_info->parity_md_buf;
+			dest_md_buf = io_info->parity_md_buf + DATA_OFFSET_TO_MD_OFFSET(raid_bdev, data_offset);
 		}
 	} else {
 		data_chunk_idx = chunk < stripe_req->parity_chunk ? chunk->index : chunk->index - 1;
-		data_offset = data_chunk_idx * raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+		data_offset = data_chunk_idx * raid_bdev->strip_size + offset_blocks % raid_bdev->strip_size;
+		SPDK_CU_ASSERT_FATAL(data_offset >= io_info->stripe_offset_blocks);
+		data_offset = (data_offset - io_info->stripe_offset_blocks) * raid_bdev->bdev.blocklen;
+		SPDK_CU_ASSERT_FATAL(data_offset + num_blocks * raid_bdev->bdev.blocklen <= io_info->buf_size);
 		dest.iov_base = test_raid_bdev_io->buf + data_offset;
 		if (md_buf != NULL) {
 			data_offset = DATA_OFFSET_TO_MD_OFFSET(raid_bdev, data_offset);
@@ -469,7 +498,8 @@ spdk_bdev_readv_blocks_degraded(struct spdk_bdev_desc *desc, struct spdk_io_chan
 	raid_bdev = io_info->r5f_info->raid_bdev;
 
 	if (chunk == stripe_req->parity_chunk) {
-		buf = io_info->reference_parity;
+		/* Writes read the parity before it is updated */
+		buf = io_info->old_parity ? io_info->old_parity : io_info->reference_parity;
 		buf_md = io_info->reference_md_parity;
 	} else {
 		data_chunk_idx = chunk < stripe_req->parity_chunk ? chunk->index : chunk->index - 1;
@@ -672,6 +702,7 @@ deinit_io_info(struct raid_io_info *io_info)
 	free(io_info->reference_md_parity);
 	free(io_info->degraded_buf);
 	free(io_info->degraded_md_buf);
+	free(io_info->old_parity);
 }
 
 static void
@@ -935,12 +966,15 @@ __test_raid5f_stripe_request_map_iovecs(struct raid_bdev *raid_bdev,
 	raid_io.raid_bdev = raid_bdev;
 	raid_io.iovs = iovs;
 	raid_io.iovcnt = iovcnt;
+	raid_io.num_blocks = ((struct raid5f_info *)raid_bdev->module_private)->stripe_blocks;
 
 	stripe_req = raid5f_stripe_request_alloc(r5ch, STRIPE_REQ_WRITE);
 	SPDK_CU_ASSERT_FATAL(stripe_req != NULL);
 
-	stripe_req->parity_chunk = &stripe_req->chunks[raid5f_stripe_data_chunks_num(raid_bdev)];
-	stripe_req->raid_io = &raid_io;
+	raid5f_stripe_request_init(stripe_req, &raid_io, 0);
+	CU_ASSERT(stripe_req->parity_chunk ==
+		  &stripe_req->chunks[raid5f_stripe_data_chunks_num(raid_bdev)]);
+	raid5f_stripe_write_request_add(stripe_req, &raid_io);
 
 	ret = raid5f_stripe_request_map_iovecs(stripe_req);
 	CU_ASSERT(ret == 0);
@@ -998,6 +1032,341 @@ test_raid5f_submit_full_stripe_write_request(void)
 	run_for_each_raid5f_config(__test_raid5f_submit_full_stripe_write_request);
 }
 
+static void
+io_info_setup_partial_write(struct raid_io_info *io_info)
+{
+	struct raid5f_info *r5f_info = io_info->r5f_info;
+	struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	size_t strip_len = raid_bdev->strip_size * blocklen;
+	size_t stripe_len = r5f_info->stripe_blocks * blocklen;
+	uint64_t *old_data;
+	void *new_data;
+	size_t i;
+
+	/* The old data of the stripe, read by the partial write */
+	io_info->degraded_buf = malloc(stripe_len);
+	SPDK_CU_ASSERT_FATAL(io_info->degraded_buf != NULL);
+
+	old_data = io_info->degraded_buf;
+	for (i = 0; i < stripe_len / sizeof(*old_data); i++) {
+		old_data[i] = (io_info->stripe_index + i) * 0x9e3779b97f4a7c15ULL;
+	}
+
+	io_info->old_parity = calloc(1, strip_len);
+	SPDK_CU_ASSERT_FATAL(io_info->old_parity != NULL);
+
+	new_data = malloc(stripe_len);
+	SPDK_CU_ASSERT_FATAL(new_data != NULL);
+
+	memcpy(new_data, io_info->degraded_buf, stripe_len);
+	memcpy(new_data + io_info->stripe_offset_blocks * blocklen, io_info->src_buf, io_info->buf_size);
+
+	io_info->parity_buf_size = strip_len;
+	io_info->reference_parity = calloc(1, strip_len);
+	SPDK_CU_ASSERT_FATAL(io_info->reference_parity != NULL);
+
+	for (i = 0; i < raid5f_stripe_data_chunks_num(raid_bdev); i++) {
+		xor_block(io_info->old_parity, io_info->degraded_buf + i * strip_len, strip_len);
+		xor_block(io_info->reference_parity, new_data + i * strip_len, strip_len);
+	}
+
+	io_info->parity_buf = malloc(strip_len);
+	SPDK_CU_ASSERT_FATAL(io_info->parity_buf != NULL);
+	memcpy(io_info->parity_buf, io_info->old_parity, strip_len);
+
+	free(new_data);
+}
+
+static void
+test_raid5f_partial_write_request(struct raid_io_info *io_info, uint64_t max_io_blocks,
+				  bool fail_first_chunk)
+{
+	struct raid_bdev *raid_bdev = io_info->r5f_info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint64_t offset = io_info->offset_blocks;
+	uint64_t end = offset + io_info->num_blocks;
+	struct raid_bdev_io **raid_ios;
+	uint64_t num_raid_ios = 0;
+	bool parity_written = true;
+	uint64_t i;
+
+	raid_ios = calloc(io_info->num_blocks, sizeof(*raid_ios));
+	SPDK_CU_ASSERT_FATAL(raid_ios != NULL);
+
+	/* Split the write like the bdev layer does, optionally into more parts */
+	while (offset < end) {
+		uint64_t chunk_end = (offset / raid_bdev->strip_size + 1) * raid_bdev->strip_size;
+		uint64_t num_blocks = spdk_min(spdk_min(end, chunk_end) - offset, max_io_blocks);
+
+		raid_ios[num_raid_ios++] = get_raid_io_range(io_info, offset, num_blocks);
+		offset += num_blocks;
+	}
+
+	/* Submit in reverse order, the writes are sorted when they are merged */
+	for (i = num_raid_ios; i > 0; i--) {
+		raid5f_submit_rw_request(raid_ios[i - 1]);
+	}
+
+	if (fail_first_chunk) {
+		/* The base bdev of the first written chunk goes away while the writes are cached */
+		uint8_t p_idx = raid5f_stripe_parity_chunk_index(raid_bdev, io_info->stripe_index);
+		uint8_t idx = io_info->stripe_offset_blocks / raid_bdev->strip_size;
+
+		if (idx >= p_idx) {
+			idx++;
+		}
+		io_info->raid_ch->_base_channels[idx] = NULL;
+	}
+
+	for (i = 0; i < 16 && io_info->completed_raid_ios < num_raid_ios; i++) {
+		poll_threads();
+		process_io_completions(io_info);
+	}
+
+	CU_ASSERT(io_info->completed_raid_ios == num_raid_ios);
+	free(raid_ios);
+
+	if (g_test_degraded || fail_first_chunk) {
+		uint8_t p_idx = raid5f_stripe_parity_chunk_index(raid_bdev, io_info->stripe_index);
+		uint64_t chunk_start, chunk_end;
+		uint8_t missing_idx;
+
+		for (missing_idx = 0; missing_idx < raid_bdev->num_base_bdevs; missing_idx++) {
+			if (!raid_bdev_channel_get_base_channel(io_info->raid_ch, missing_idx)) {
+				break;
+			}
+		}
+
+		SPDK_CU_ASSERT_FATAL(missing_idx != raid_bdev->num_base_bdevs);
+
+		if (missing_idx == p_idx) {
+			parity_written = false;
+		} else {
+			/* The data of the missing chunk is only in the parity */
+			uint8_t data_idx = missing_idx > p_idx ? missing_idx - 1 : missing_idx;
+
+			chunk_start = spdk_max(data_idx * raid_bdev->strip_size, io_info->stripe_offset_blocks);
+			chunk_end = spdk_min((data_idx + 1) * raid_bdev->strip_size,
+					     io_info->stripe_offset_blocks + io_info->num_blocks);
+			if (chunk_start < chunk_end) {
+				memcpy(io_info->dest_buf + (chunk_start - io_info->stripe_offset_blocks) * blocklen,
+				       io_info->src_buf + (chunk_start - io_info->stripe_offset_blocks) * blocklen,
+				       (chunk_end - chunk_start) * blocklen);
+			}
+		}
+
+		if (fail_first_chunk) {
+			io_info->raid_ch->_base_channels[missing_idx] = (void *)1;
+		}
+	}
+
+	CU_ASSERT(io_info->status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(io_info->src_buf, io_info->dest_buf, io_info->buf_size) == 0);
+	if (parity_written) {
+		CU_ASSERT(memcmp(io_info->parity_buf, io_info->reference_parity,
+				 io_info->parity_buf_size) == 0);
+	}
+}
+
+static void
+test_raid5f_submit_partial_write(struct raid5f_info *r5f_info, struct raid_bdev_io_channel *raid_ch,
+				 uint64_t stripe_index, uint64_t stripe_offset_blocks, uint64_t num_blocks,
+				 uint64_t max_io_blocks, bool fail_first_chunk)
+{
+	struct raid_io_info io_info;
+
+	init_io_info(&io_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, stripe_index,
+		     stripe_offset_blocks, num_blocks);
+	io_info_setup_partial_write(&io_info);
+
+	test_raid5f_partial_write_request(&io_info, max_io_blocks, fail_first_chunk);
+
+	deinit_io_info(&io_info);
+}
+
+static void
+__test_raid5f_submit_partial_write_request(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	uint32_t strip_size = raid_bdev->strip_size;
+	uint8_t data_chunks = raid5f_stripe_data_chunks_num(raid_bdev);
+	uint64_t stripe_index;
+	unsigned int i;
+
+	if (raid_bdev->bdev.md_len != 0) {
+		/* Only full stripes are written with separate metadata */
+		return;
+	}
+
+	RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		for (i = 0; i < data_chunks; i++) {
+			uint64_t stripe_offset = i * strip_size;
+
+			test_raid5f_submit_partial_write(r5f_info, raid_ch, stripe_index, stripe_offset, 1,
+							 UINT64_MAX, false);
+			test_raid5f_submit_partial_write(r5f_info, raid_ch, stripe_index,
+							 stripe_offset + strip_size - 1, 1, UINT64_MAX, false);
+			test_raid5f_submit_partial_write(r5f_info, raid_ch, stripe_index, stripe_offset,
+							 strip_size, UINT64_MAX, false);
+			if (strip_size > 2) {
+				test_raid5f_submit_partial_write(r5f_info, raid_ch, stripe_index, stripe_offset + 1,
+								 strip_size - 2, UINT64_MAX, false);
+			}
+
+			if (g_test_degraded) {
+				/* Writes to a degraded array are not merged */
+				continue;
+			}
+
+			/* Adjacent writes to the same chunk */
+			if (strip_size > 1) {
+				test_raid5f_submit_partial_write(r5f_info, raid_ch, stripe_index, stripe_offset,
+								 strip_size, strip_size / 2, false);
+			}
+
+			/* Writes to parts of two chunks */
+			if (i + 1 < data_chunks) {
+				test_raid5f_submit_partial_write(r5f_info, raid_ch, stripe_index,
+								 stripe_offset + strip_size / 2, strip_size, UINT64_MAX, false);
+			}
+
+			/*
+			 * The same, but the array becomes degraded before the merged write is
+			 * processed and the partially written chunk must be reconstructed
+			 */
+			if (i + 1 < data_chunks && strip_size > 1) {
+				test_raid5f_submit_partial_write(r5f_info, raid_ch, stripe_index,
+								 stripe_offset + strip_size / 2, strip_size, UINT64_MAX, true);
+			}
+		}
+
+		if (!g_test_degraded) {
+			/* Writes of all chunks are merged into a full stripe write */
+			test_raid5f_submit_partial_write(r5f_info, raid_ch, stripe_index, 0,
+							 r5f_info->stripe_blocks, UINT64_MAX, false);
+		}
+	}
+}
+static void
+test_raid5f_submit_partial_write_request(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_submit_partial_write_request);
+}
+
+static void
+__test_raid5f_stripe_lock(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct raid5f_io_channel *r5ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	struct raid_bdev_io *raid_io1, *raid_io2;
+	struct raid_io_info io_info;
+	struct stripe_request *stripe_req;
+	int i;
+
+	if (raid_bdev->bdev.md_len != 0) {
+		return;
+	}
+
+	init_io_info(&io_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0, 0, 1);
+	io_info_setup_partial_write(&io_info);
+
+	/* Overlapping writes of the same stripe can't be merged */
+	raid_io1 = get_raid_io(&io_info);
+	raid_io2 = get_raid_io(&io_info);
+
+	raid5f_submit_rw_request(raid_io1);
+	raid5f_submit_rw_request(raid_io2);
+
+	/* The first write was submitted, the second is waiting in the cache */
+	stripe_req = TAILQ_FIRST(&r5f_info->locked_stripes[0]);
+	SPDK_CU_ASSERT_FATAL(stripe_req != NULL);
+	CU_ASSERT(TAILQ_NEXT(stripe_req, lock_link) == NULL);
+	CU_ASSERT(stripe_req->raid_io == raid_io1);
+	CU_ASSERT(TAILQ_EMPTY(&stripe_req->lock_waiters));
+	CU_ASSERT(!TAILQ_EMPTY(&r5ch->write_cache));
+
+	/* Flushing the cache makes the second write wait for the stripe lock */
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&r5ch->write_cache));
+	CU_ASSERT(TAILQ_FIRST(&r5f_info->locked_stripes[0]) == stripe_req);
+	CU_ASSERT(TAILQ_FIRST(&stripe_req->lock_waiters) != NULL);
+
+	for (i = 0; i < 16 && io_info.completed_raid_ios < 2; i++) {
+		poll_threads();
+		process_io_completions(&io_info);
+	}
+
+	CU_ASSERT(io_info.completed_raid_ios == 2);
+	CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(TAILQ_EMPTY(&r5f_info->locked_stripes[0]));
+
+	deinit_io_info(&io_info);
+}
+static void
+test_raid5f_stripe_lock(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_stripe_lock);
+}
+
+static void
+__test_raid5f_stripe_lock_reconstruct_read(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct raid_io_info write_info, read_info;
+	struct stripe_request *stripe_req;
+	int i;
+
+	if (raid_bdev->bdev.md_len != 0) {
+		return;
+	}
+
+	/* The first chunk of stripe 0 is missing, the write goes to the second one */
+	SPDK_CU_ASSERT_FATAL(raid5f_stripe_parity_chunk_index(raid_bdev, 0) > 1);
+
+	init_io_info(&write_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0,
+		     raid_bdev->strip_size, 1);
+	io_info_setup_partial_write(&write_info);
+
+	init_io_info(&read_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 0, 0, 1);
+	io_info_setup_degraded(&read_info);
+
+	raid5f_submit_rw_request(get_raid_io(&write_info));
+	raid5f_submit_rw_request(get_raid_io(&read_info));
+
+	/* The reconstruct read must not see the stripe while its parity is being updated */
+	stripe_req = TAILQ_FIRST(&r5f_info->locked_stripes[0]);
+	SPDK_CU_ASSERT_FATAL(stripe_req != NULL);
+	CU_ASSERT(stripe_req->type == STRIPE_REQ_WRITE);
+	CU_ASSERT(TAILQ_NEXT(stripe_req, lock_link) == NULL);
+	CU_ASSERT(TAILQ_FIRST(&stripe_req->lock_waiters) != NULL);
+	CU_ASSERT(read_info.completed_raid_ios == 0);
+
+	for (i = 0; i < 16 && write_info.completed_raid_ios + read_info.completed_raid_ios < 2; i++) {
+		poll_threads();
+		process_io_completions(&write_info);
+		process_io_completions(&read_info);
+	}
+
+	CU_ASSERT(write_info.completed_raid_ios == 1);
+	CU_ASSERT(write_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(read_info.completed_raid_ios == 1);
+	CU_ASSERT(read_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(read_info.src_buf, read_info.dest_buf, read_info.buf_size) == 0);
+	CU_ASSERT(TAILQ_EMPTY(&r5f_info->locked_stripes[0]));
+
+	deinit_io_info(&write_info);
+	deinit_io_info(&read_info);
+}
+static void
+test_raid5f_stripe_lock_reconstruct_read(void)
+{
+	g_test_degraded = true;
+	run_for_each_raid5f_config(__test_raid5f_stripe_lock_reconstruct_read);
+}
+
 static void
 __test_raid5f_chunk_write_error(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
 {
@@ -1109,6 +1478,47 @@ test_raid5f_submit_read_request_degraded(void)
 	run_for_each_raid5f_config(__test_raid5f_submit_read_request);
 }
 
+static void
+test_raid5f_submit_partial_write_request_degraded(void)
+{
+	g_test_degraded = true;
+	run_for_each_raid5f_config(__test_raid5f_submit_partial_write_request);
+}
+
+static void
+__test_raid5f_process_request_missing_base(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct raid_bdev_process_request process_req = {};
+	uint8_t p_idx;
+
+	process_req.num_blocks = r5f_info->stripe_blocks;
+
+	/* a rebuild needs all the other base bdevs */
+	process_req.target = &raid_bdev->base_bdev_info[raid_bdev->num_base_bdevs - 1];
+	process_req.target_ch = (void *)1;
+	raid_ch->_base_channels[raid_bdev->num_base_bdevs - 1] = NULL;
+	raid_ch->_base_channels[0] = NULL;
+	CU_ASSERT(raid5f_submit_process_request(&process_req, raid_ch) == -ENODEV);
+	raid_ch->_base_channels[0] = (void *)1;
+	raid_ch->_base_channels[raid_bdev->num_base_bdevs - 1] = (void *)1;
+
+	/* so does a resync, to recalculate the parity */
+	process_req.target = NULL;
+	process_req.target_ch = NULL;
+	p_idx = raid5f_stripe_parity_chunk_index(raid_bdev, 0);
+	raid_ch->_base_channels[(p_idx + 1) % raid_bdev->num_base_bdevs] = NULL;
+	CU_ASSERT(raid5f_submit_process_request(&process_req, raid_ch) == -ENODEV);
+	raid_ch->_base_channels[(p_idx + 1) % raid_bdev->num_base_bdevs] = (void *)1;
+}
+
+static void
+test_raid5f_process_request_missing_base(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_process_request_missing_base);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1123,10 +1533,15 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_raid5f_submit_read_request);
 	CU_ADD_TEST(suite, test_raid5f_stripe_request_map_iovecs);
 	CU_ADD_TEST(suite, test_raid5f_submit_full_stripe_write_request);
+	CU_ADD_TEST(suite, test_raid5f_submit_partial_write_request);
+	CU_ADD_TEST(suite, test_raid5f_stripe_lock);
+	CU_ADD_TEST(suite, test_raid5f_stripe_lock_reconstruct_read);
 	CU_ADD_TEST(suite, test_raid5f_chunk_write_error);
 	CU_ADD_TEST(suite, test_raid5f_chunk_write_error_with_enomem);
 	CU_ADD_TEST(suite, test_raid5f_submit_full_stripe_write_request_degraded);
 	CU_ADD_TEST(suite, test_raid5f_submit_read_request_degraded);
+	CU_ADD_TEST(suite, test_raid5f_submit_partial_write_request_degraded);
+	CU_ADD_TEST(suite, test_raid5f_process_request_missing_base);
 
 	allocate_threads(1);
 	set_thread(0);
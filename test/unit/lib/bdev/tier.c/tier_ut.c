@@ -0,0 +1,730 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_internal/cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+
+#include "common/lib/ut_multithread.c"
+
+/* The metadata thread runs on a thread allocated by the test */
+struct spdk_thread *ut_tier_thread_create(const char *name, const struct spdk_cpuset *cpumask);
+int ut_tier_thread_exit(struct spdk_thread *thread);
+#define spdk_thread_create ut_tier_thread_create
+#define spdk_thread_exit ut_tier_thread_exit
+#include "bdev/tier/vbdev_tier.c"
+#undef spdk_thread_create
+#undef spdk_thread_exit
+
+#include "../vbdev_common.c"
+
+#define UT_EXTENT_KB		8
+#define UT_EXTENT_BLOCKS	(UT_EXTENT_KB * 1024 / UT_BLOCK_SIZE)
+#define UT_EXTENT_SIZE		(UT_EXTENT_BLOCKS * UT_BLOCK_SIZE)
+#define UT_NUM_EXTENTS		64
+#define UT_CAPACITY_BLOCKS	(UT_NUM_EXTENTS * UT_EXTENT_BLOCKS)
+/* Superblock and remap table in the first extent, then 8 slots */
+#define UT_NUM_SLOTS		8
+#define UT_FAST_BLOCKS		((UT_NUM_SLOTS + 1) * UT_EXTENT_BLOCKS)
+#define UT_THRESHOLD		4
+#define UT_MD_THREAD		1
+
+static struct ut_base_bdev g_fast;
+static struct ut_base_bdev g_capacity;
+static struct spdk_bdev *g_created_bdev;
+static int g_create_status;
+
+struct spdk_thread *
+ut_tier_thread_create(const char *name, const struct spdk_cpuset *cpumask)
+{
+	return g_ut_threads[UT_MD_THREAD].thread;
+}
+
+int
+ut_tier_thread_exit(struct spdk_thread *thread)
+{
+	return 0;
+}
+
+static int
+test_setup(void)
+{
+	ut_base_bdev_init(&g_fast, "fast", UT_FAST_BLOCKS);
+	ut_base_bdev_init(&g_capacity, "capacity", UT_CAPACITY_BLOCKS);
+	ut_vbdev_setup(2);
+
+	return 0;
+}
+
+static int
+test_cleanup(void)
+{
+	ut_vbdev_cleanup();
+	ut_base_bdev_fini(&g_fast);
+	ut_base_bdev_fini(&g_capacity);
+
+	return 0;
+}
+
+static void
+ut_reset_bdevs(void)
+{
+	memset(g_fast.data, 0, UT_FAST_BLOCKS * UT_BLOCK_SIZE);
+	memset(g_capacity.data, 0, UT_CAPACITY_BLOCKS * UT_BLOCK_SIZE);
+}
+
+static void
+ut_fill_pattern(uint8_t *buf, size_t len, uint8_t seed)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		buf[i] = (uint8_t)(seed + i / 7);
+	}
+}
+
+static void
+ut_create_cb(void *cb_arg, struct spdk_bdev *bdev, int rc)
+{
+	g_created_bdev = bdev;
+	g_create_status = rc;
+}
+
+static void
+ut_tier_opts(struct vbdev_tier_opts *opts, uint32_t migration_bw_mbps)
+{
+	vbdev_tier_get_default_opts(opts);
+	opts->name = "tier0";
+	opts->fast_bdev_name = "fast";
+	opts->capacity_bdev_name = "capacity";
+	opts->extent_size_kb = UT_EXTENT_KB;
+	opts->migration_bw_mbps = migration_bw_mbps;
+	opts->promote_threshold = UT_THRESHOLD;
+}
+
+static struct vbdev_tier *
+ut_tier_create_opts(const struct vbdev_tier_opts *opts)
+{
+	struct vbdev_tier *tier;
+	int rc;
+
+	g_created_bdev = NULL;
+	g_create_status = 1;
+
+	set_thread(UT_SUBMIT_THREAD);
+	rc = vbdev_tier_create(opts, ut_create_cb, NULL);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(g_create_status == 0);
+	SPDK_CU_ASSERT_FATAL(g_created_bdev != NULL);
+
+	tier = SPDK_CONTAINEROF(g_created_bdev, struct vbdev_tier, bdev);
+	/* Keep the heat of the extents steady unless a test decays it on purpose */
+	tier->decay_per_poll = 0;
+
+	return tier;
+}
+
+static struct vbdev_tier *
+ut_tier_create(uint32_t migration_bw_mbps)
+{
+	struct vbdev_tier_opts opts;
+
+	ut_tier_opts(&opts, migration_bw_mbps);
+
+	return ut_tier_create_opts(&opts);
+}
+
+static void
+ut_tier_delete(struct vbdev_tier *tier)
+{
+	int rc;
+
+	set_thread(UT_SUBMIT_THREAD);
+	g_destruct_done = false;
+	rc = vbdev_tier_destruct(tier);
+	CU_ASSERT(rc == 1);
+	poll_threads();
+	CU_ASSERT(g_destruct_done == true);
+}
+
+static struct spdk_bdev_io *
+ut_io_alloc(struct vbdev_tier *tier, enum spdk_bdev_io_type type, struct iovec *iov,
+	    uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct tier_bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = &tier->bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.iovs = iov;
+	bdev_io->u.bdev.iovcnt = iov != NULL ? 1 : 0;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->internal.in_submit_request = true;
+	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+
+	return bdev_io;
+}
+
+/* Submit an I/O without processing it */
+static void
+ut_io_start(struct vbdev_tier *tier, struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_io_channel *ch;
+
+	set_thread(UT_SUBMIT_THREAD);
+	ch = spdk_get_io_channel(tier);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	bdev_io->internal.ch = spdk_io_channel_get_ctx(ch);
+	vbdev_tier_submit_request(ch, bdev_io);
+	spdk_put_io_channel(ch);
+}
+
+static int
+ut_io_end(struct spdk_bdev_io *bdev_io)
+{
+	int status;
+
+	poll_threads();
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	status = bdev_io->internal.status;
+	free(bdev_io);
+
+	return status;
+}
+
+static int
+ut_submit(struct vbdev_tier *tier, enum spdk_bdev_io_type type, void *buf,
+	  uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct iovec iov = { .iov_base = buf, .iov_len = num_blocks * UT_BLOCK_SIZE };
+	struct spdk_bdev_io *bdev_io;
+
+	bdev_io = ut_io_alloc(tier, type, buf != NULL ? &iov : NULL, offset_blocks, num_blocks);
+	ut_io_start(tier, bdev_io);
+
+	return ut_io_end(bdev_io);
+}
+
+/* Read the first block of an extent a few times to heat it up */
+static void
+ut_touch(struct vbdev_tier *tier, uint64_t extent, uint32_t count)
+{
+	uint8_t buf[UT_BLOCK_SIZE];
+	uint32_t i;
+	int status;
+
+	for (i = 0; i < count; i++) {
+		status = ut_submit(tier, SPDK_BDEV_IO_TYPE_READ, buf, extent * UT_EXTENT_BLOCKS, 1);
+		CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+}
+
+/* Let the migration poller run once */
+static void
+ut_migrate(void)
+{
+	spdk_delay_us(TIER_MIGRATE_POLL_PERIOD_US);
+	poll_threads();
+}
+
+static uint8_t *
+ut_capacity_extent(uint64_t extent)
+{
+	return g_capacity.data + extent * UT_EXTENT_SIZE;
+}
+
+static uint8_t *
+ut_fast_slot(struct vbdev_tier *tier, uint32_t slot)
+{
+	return g_fast.data + tier_slot_offset(tier, slot) * UT_BLOCK_SIZE;
+}
+
+static uint32_t
+ut_slot_on_disk(struct vbdev_tier *tier, uint32_t slot)
+{
+	uint32_t *slots = (uint32_t *)(g_fast.data + tier->md_offset * TIER_MD_BLOCK_SIZE);
+
+	return slots[slot];
+}
+
+static void
+test_tier_create(void)
+{
+	struct vbdev_tier *tier;
+	struct vbdev_tier_opts opts;
+	struct tier_sb *sb = (struct tier_sb *)g_fast.data;
+	uint32_t i;
+	int rc;
+
+	ut_reset_bdevs();
+	memset(g_fast.data, 0xaa, UT_FAST_BLOCKS * UT_BLOCK_SIZE);
+
+	tier = ut_tier_create(0);
+	CU_ASSERT(tier->bdev.blocklen == UT_BLOCK_SIZE);
+	CU_ASSERT(tier->bdev.blockcnt == UT_CAPACITY_BLOCKS);
+	CU_ASSERT(tier->bdev.optimal_io_boundary == UT_EXTENT_BLOCKS);
+	CU_ASSERT(tier->bdev.split_on_optimal_io_boundary == true);
+	CU_ASSERT(tier->num_extents == UT_NUM_EXTENTS);
+	CU_ASSERT(tier->extent_blocks == UT_EXTENT_BLOCKS);
+	CU_ASSERT(tier->num_slots == UT_NUM_SLOTS);
+	CU_ASSERT(tier->md_offset == 1);
+	CU_ASSERT(tier->data_offset == UT_EXTENT_BLOCKS);
+	CU_ASSERT(tier->num_free_slots == UT_NUM_SLOTS);
+	CU_ASSERT(tier->num_used_slots == 0);
+	for (i = 0; i < UT_NUM_EXTENTS; i++) {
+		CU_ASSERT(tier->extents[i].slot == TIER_SLOT_NONE);
+	}
+
+	/* The superblock is valid and the remap table has been cleared */
+	CU_ASSERT(tier_sb_is_valid(sb));
+	CU_ASSERT(spdk_uuid_compare(&sb->uuid, &tier->bdev.uuid) == 0);
+	CU_ASSERT(spdk_uuid_compare(&sb->capacity_uuid, &g_capacity.bdev.uuid) == 0);
+	CU_ASSERT(sb->extent_size == UT_EXTENT_SIZE);
+	CU_ASSERT(sb->num_slots == UT_NUM_SLOTS);
+	CU_ASSERT(spdk_mem_all_zero(g_fast.data + TIER_MD_BLOCK_SIZE, TIER_MD_BLOCK_SIZE));
+	ut_tier_delete(tier);
+
+	/* Invalid options */
+	ut_tier_opts(&opts, 0);
+	opts.extent_size_kb = 12;
+	rc = vbdev_tier_create(&opts, ut_create_cb, NULL);
+	CU_ASSERT(rc == -EINVAL);
+	opts.extent_size_kb = 2;
+	rc = vbdev_tier_create(&opts, ut_create_cb, NULL);
+	CU_ASSERT(rc == -EINVAL);
+	ut_tier_opts(&opts, 0);
+	opts.promote_threshold = TIER_HEAT_MAX + 1;
+	rc = vbdev_tier_create(&opts, ut_create_cb, NULL);
+	CU_ASSERT(rc == -EINVAL);
+	ut_tier_opts(&opts, 0);
+	g_fast.bdev.blocklen = 4096;
+	rc = vbdev_tier_create(&opts, ut_create_cb, NULL);
+	g_fast.bdev.blocklen = UT_BLOCK_SIZE;
+	CU_ASSERT(rc == -EINVAL);
+
+	/* The fast bdev holds the extents of another capacity bdev */
+	spdk_uuid_generate(&g_capacity.bdev.uuid);
+	g_create_status = 0;
+	rc = vbdev_tier_create(&opts, ut_create_cb, NULL);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(g_create_status == -EEXIST);
+}
+
+static void
+test_tier_read_write(void)
+{
+	struct vbdev_tier *tier;
+	struct spdk_bdev_io *bdev_io;
+	struct iovec iov;
+	uint8_t buf[2 * UT_EXTENT_SIZE], data[2 * UT_EXTENT_SIZE];
+	uint32_t writes;
+	int status;
+
+	ut_reset_bdevs();
+	tier = ut_tier_create(0);
+
+	/* Extents that are not promoted are on the capacity bdev, at the same offset */
+	ut_fill_pattern(data, UT_BLOCK_SIZE * 4, 1);
+	status = ut_submit(tier, SPDK_BDEV_IO_TYPE_WRITE, data, 3 * UT_EXTENT_BLOCKS + 2, 4);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(ut_capacity_extent(3) + 2 * UT_BLOCK_SIZE, data, 4 * UT_BLOCK_SIZE) == 0);
+	status = ut_submit(tier, SPDK_BDEV_IO_TYPE_READ, buf, 3 * UT_EXTENT_BLOCKS + 2, 4);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, data, 4 * UT_BLOCK_SIZE) == 0);
+	CU_ASSERT(tier->stats.capacity_ios == 2);
+	CU_ASSERT(tier->stats.fast_ios == 0);
+
+	/* Reads and writes heat the extent up, without migrations it is not a candidate */
+	CU_ASSERT(tier->extents[3].heat == 2);
+	ut_touch(tier, 3, UT_THRESHOLD);
+	CU_ASSERT(tier->extents[3].heat == 2 + UT_THRESHOLD);
+	CU_ASSERT(tier->num_candidates == 0);
+	CU_ASSERT(tier->extents[3].inflight == 0);
+
+	/* Reads and writes are served by the thread they are submitted on, other I/Os are not */
+	iov.iov_base = buf;
+	iov.iov_len = UT_BLOCK_SIZE;
+	bdev_io = ut_io_alloc(tier, SPDK_BDEV_IO_TYPE_READ, &iov, 3 * UT_EXTENT_BLOCKS + 2, 1);
+	ut_io_start(tier, bdev_io);
+	poll_thread(UT_SUBMIT_THREAD);
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	status = ut_io_end(bdev_io);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, data, UT_BLOCK_SIZE) == 0);
+	bdev_io = ut_io_alloc(tier, SPDK_BDEV_IO_TYPE_WRITE, &iov, 3 * UT_EXTENT_BLOCKS + 2, 1);
+	ut_io_start(tier, bdev_io);
+	poll_thread(UT_SUBMIT_THREAD);
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	status = ut_io_end(bdev_io);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	bdev_io = ut_io_alloc(tier, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 3 * UT_EXTENT_BLOCKS + 2, 1);
+	ut_io_start(tier, bdev_io);
+	poll_thread(UT_SUBMIT_THREAD);
+	CU_ASSERT(bdev_io->internal.in_submit_request == true);
+	status = ut_io_end(bdev_io);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(tier->stats.capacity_ios == 5 + UT_THRESHOLD);
+	CU_ASSERT(tier->extents[3].heat == 4 + UT_THRESHOLD);
+	CU_ASSERT(tier->extents[3].inflight == 0);
+
+	/* Unmaps are split on the extents */
+	ut_fill_pattern(data, sizeof(data), 2);
+	status = ut_submit(tier, SPDK_BDEV_IO_TYPE_WRITE, data, 4 * UT_EXTENT_BLOCKS,
+			   UT_EXTENT_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	writes = g_capacity.num_writes;
+	status = ut_submit(tier, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 3 * UT_EXTENT_BLOCKS + 8,
+			   UT_EXTENT_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_capacity.num_writes == writes + 2);
+	CU_ASSERT(spdk_mem_all_zero(ut_capacity_extent(3) + 8 * UT_BLOCK_SIZE, UT_EXTENT_SIZE));
+	CU_ASSERT(memcmp(ut_capacity_extent(4) + 8 * UT_BLOCK_SIZE, data + 8 * UT_BLOCK_SIZE,
+			 UT_EXTENT_SIZE - 8 * UT_BLOCK_SIZE) == 0);
+	CU_ASSERT(tier->extents[3].heat == 4 + UT_THRESHOLD);
+
+	/* Both base bdevs are flushed */
+	status = ut_submit(tier, SPDK_BDEV_IO_TYPE_FLUSH, NULL, 0, 0);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_fast.num_flushes == 1);
+	CU_ASSERT(g_capacity.num_flushes == 1);
+	g_fast.num_flushes = 0;
+	g_capacity.num_flushes = 0;
+
+	ut_tier_delete(tier);
+}
+
+static void
+test_tier_promote(void)
+{
+	struct vbdev_tier *tier;
+	uint8_t buf[UT_EXTENT_SIZE], data[UT_EXTENT_SIZE];
+	uint32_t capacity_reads, capacity_writes, slot;
+	int status;
+
+	ut_reset_bdevs();
+	ut_fill_pattern(ut_capacity_extent(10), UT_EXTENT_SIZE, 3);
+	tier = ut_tier_create(1000);
+
+	/* Not hot enough yet */
+	ut_touch(tier, 10, UT_THRESHOLD - 1);
+	CU_ASSERT(tier->num_candidates == 0);
+	ut_migrate();
+	CU_ASSERT(tier->extents[10].slot == TIER_SLOT_NONE);
+
+	ut_touch(tier, 10, 1);
+	CU_ASSERT(tier->num_candidates == 1);
+	CU_ASSERT(tier->extents[10].flags & TIER_EXTENT_CANDIDATE);
+	ut_touch(tier, 10, 1);
+	CU_ASSERT(tier->num_candidates == 1);
+
+	/* The extent is copied to the first free slot, which is then mapped to it */
+	ut_migrate();
+	slot = tier->extents[10].slot;
+	CU_ASSERT(slot == 0);
+	CU_ASSERT(tier->extents[10].flags == 0);
+	CU_ASSERT(tier->num_used_slots == 1);
+	CU_ASSERT(tier->num_free_slots == UT_NUM_SLOTS - 1);
+	CU_ASSERT(tier->num_migrations == 0);
+	CU_ASSERT(tier->stats.promotions == 1);
+	CU_ASSERT(tier->stats.migrated_bytes == UT_EXTENT_SIZE);
+	CU_ASSERT(tier->slots[slot] == 11);
+	CU_ASSERT(ut_slot_on_disk(tier, slot) == 11);
+	CU_ASSERT(memcmp(ut_fast_slot(tier, slot), ut_capacity_extent(10), UT_EXTENT_SIZE) == 0);
+
+	/* Its I/Os go to the fast bdev */
+	capacity_reads = g_capacity.num_reads;
+	status = ut_submit(tier, SPDK_BDEV_IO_TYPE_READ, buf, 10 * UT_EXTENT_BLOCKS,
+			   UT_EXTENT_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, ut_capacity_extent(10), UT_EXTENT_SIZE) == 0);
+	CU_ASSERT(g_capacity.num_reads == capacity_reads);
+	CU_ASSERT(tier->stats.fast_ios == 1);
+
+	/* The first write marks the slot dirty before completing, the next ones do not */
+	capacity_writes = g_capacity.num_writes;
+	ut_fill_pattern(data, sizeof(data), 4);
+	status = ut_submit(tier, SPDK_BDEV_IO_TYPE_WRITE, data, 10 * UT_EXTENT_BLOCKS + 1, 2);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(tier->slots[slot] == (11 | TIER_SLOT_DIRTY));
+	CU_ASSERT(ut_slot_on_disk(tier, slot) == (11 | TIER_SLOT_DIRTY));
+	CU_ASSERT(tier->num_dirty_slots == 1);
+	CU_ASSERT(!(tier->extents[10].flags & TIER_EXTENT_DIRTYING));
+	CU_ASSERT(memcmp(ut_fast_slot(tier, slot) + UT_BLOCK_SIZE, data, 2 * UT_BLOCK_SIZE) == 0);
+	CU_ASSERT(g_capacity.num_writes == capacity_writes);
+
+	ut_tier_delete(tier);
+}
+
+static void
+test_tier_demote(void)
+{
+	struct vbdev_tier *tier;
+	uint8_t data[UT_EXTENT_SIZE];
+	uint32_t i, capacity_writes;
+	int status;
+
+	ut_reset_bdevs();
+	for (i = 0; i < UT_NUM_EXTENTS; i++) {
+		ut_fill_pattern(ut_capacity_extent(i), UT_EXTENT_SIZE, i);
+	}
+	tier = ut_tier_create(1000);
+	g_capacity.bdev.write_cache = true;
+
+	/* Fill all the slots with extents 10-17, of increasing heat */
+	for (i = 0; i < UT_NUM_SLOTS; i++) {
+		ut_touch(tier, 10 + i, UT_THRESHOLD + i);
+	}
+	ut_migrate();
+	ut_migrate();
+	CU_ASSERT(tier->num_free_slots == 0);
+	for (i = 0; i < UT_NUM_SLOTS; i++) {
+		CU_ASSERT(tier->extents[10 + i].slot == i);
+	}
+
+	/* Dirty the coldest extent */
+	ut_fill_pattern(data, sizeof(data), 100);
+	status = ut_submit(tier, SPDK_BDEV_IO_TYPE_WRITE, data, 10 * UT_EXTENT_BLOCKS,
+			   UT_EXTENT_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(tier->extents[10].heat == UT_THRESHOLD + 1);
+	CU_ASSERT(memcmp(ut_capacity_extent(10), data, UT_EXTENT_SIZE) != 0);
+
+	/* A candidate not hotter than the promoted extents does not replace them */
+	ut_touch(tier, 30, UT_THRESHOLD);
+	ut_migrate();
+	CU_ASSERT(tier->extents[30].slot == TIER_SLOT_NONE);
+	CU_ASSERT(tier->stats.demotions == 0);
+	CU_ASSERT(tier->num_candidates == 0);
+
+	/* A hotter one makes the coldest extent go back to the capacity bdev, with its data */
+	capacity_writes = g_capacity.num_writes;
+	ut_touch(tier, 30, 4);
+	ut_migrate();
+	CU_ASSERT(tier->stats.demotions == 1);
+	CU_ASSERT(tier->extents[10].slot == TIER_SLOT_NONE);
+	CU_ASSERT(tier->slots[0] == 0);
+	CU_ASSERT(ut_slot_on_disk(tier, 0) == 0);
+	CU_ASSERT(tier->num_dirty_slots == 0);
+	CU_ASSERT(tier->num_free_slots == 1);
+	CU_ASSERT(g_capacity.num_writes == capacity_writes + 1);
+	CU_ASSERT(g_capacity.num_flushes == 1);
+	CU_ASSERT(memcmp(ut_capacity_extent(10), data, UT_EXTENT_SIZE) == 0);
+
+	/* The candidate takes the free slot on its next access */
+	ut_touch(tier, 30, 1);
+	ut_migrate();
+	CU_ASSERT(tier->extents[30].slot == 0);
+	CU_ASSERT(tier->slots[0] == 31);
+
+	/* A clean extent is demoted without copying it back */
+	capacity_writes = g_capacity.num_writes;
+	ut_touch(tier, 31, UT_THRESHOLD + 10);
+	ut_migrate();
+	CU_ASSERT(tier->stats.demotions == 2);
+	CU_ASSERT(tier->extents[11].slot == TIER_SLOT_NONE);
+	CU_ASSERT(g_capacity.num_writes == capacity_writes);
+	ut_fill_pattern(data, sizeof(data), 11);
+	CU_ASSERT(memcmp(ut_capacity_extent(11), data, UT_EXTENT_SIZE) == 0);
+
+	g_capacity.bdev.write_cache = false;
+	g_capacity.num_flushes = 0;
+	ut_tier_delete(tier);
+}
+
+static void
+test_tier_migration_io(void)
+{
+	struct vbdev_tier *tier;
+	struct spdk_bdev_io *bdev_io;
+	struct iovec iov;
+	uint8_t data[UT_EXTENT_SIZE], old[UT_EXTENT_SIZE];
+	uint32_t capacity_reads;
+	int status;
+
+	ut_reset_bdevs();
+	ut_fill_pattern(ut_capacity_extent(5), UT_EXTENT_SIZE, 5);
+	ut_fill_pattern(ut_capacity_extent(6), UT_EXTENT_SIZE, 6);
+	memcpy(old, ut_capacity_extent(5), UT_EXTENT_SIZE);
+	tier = ut_tier_create(1000);
+
+	/* A write submitted during a promotion waits for it, then goes to the fast bdev */
+	set_thread(UT_MD_THREAD);
+	tier->num_free_slots--;
+	tier_migration_start(tier, 5, tier->free_slots[tier->num_free_slots], true);
+	CU_ASSERT(tier->extents[5].flags & TIER_EXTENT_MIGRATING);
+
+	ut_fill_pattern(data, sizeof(data), 50);
+	iov.iov_base = data;
+	iov.iov_len = 4 * UT_BLOCK_SIZE;
+	bdev_io = ut_io_alloc(tier, SPDK_BDEV_IO_TYPE_WRITE, &iov, 5 * UT_EXTENT_BLOCKS, 4);
+	ut_io_start(tier, bdev_io);
+	status = ut_io_end(bdev_io);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(tier->extents[5].slot == 0);
+	CU_ASSERT(tier->stats.fast_ios == 1);
+	CU_ASSERT(tier->stats.capacity_ios == 0);
+	CU_ASSERT(memcmp(ut_fast_slot(tier, 0), data, 4 * UT_BLOCK_SIZE) == 0);
+	CU_ASSERT(memcmp(ut_capacity_extent(5), old, UT_EXTENT_SIZE) == 0);
+
+	/*
+	 * A promotion started during a write waits for it, and copies the data written. The write
+	 * is submitted to the capacity bdev on the submitting thread, whose completion lets the
+	 * metadata thread start the copy.
+	 */
+	bdev_io = ut_io_alloc(tier, SPDK_BDEV_IO_TYPE_WRITE, &iov, 6 * UT_EXTENT_BLOCKS + 8, 4);
+	ut_io_start(tier, bdev_io);
+	CU_ASSERT(tier->extents[6].inflight == 1);
+	capacity_reads = g_capacity.num_reads;
+	set_thread(UT_MD_THREAD);
+	tier->num_free_slots--;
+	tier_migration_start(tier, 6, tier->free_slots[tier->num_free_slots], true);
+	CU_ASSERT(tier->num_migrations == 1);
+	CU_ASSERT(g_capacity.num_reads == capacity_reads);
+	status = ut_io_end(bdev_io);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(tier->num_migrations == 0);
+	CU_ASSERT(tier->extents[6].slot == 1);
+	CU_ASSERT(memcmp(ut_fast_slot(tier, 1) + 8 * UT_BLOCK_SIZE, data, 4 * UT_BLOCK_SIZE) == 0);
+	CU_ASSERT(memcmp(ut_fast_slot(tier, 1), ut_capacity_extent(6), UT_EXTENT_SIZE) == 0);
+
+	ut_tier_delete(tier);
+}
+
+static void
+test_tier_decay_bandwidth(void)
+{
+	struct vbdev_tier *tier;
+	struct vbdev_tier_opts opts;
+	uint32_t i;
+
+	ut_reset_bdevs();
+
+	/* The heat of all the extents is halved once per decay period */
+	ut_tier_opts(&opts, 0);
+	opts.decay_period_ms = 40;
+	tier = ut_tier_create_opts(&opts);
+	tier->decay_per_poll = spdk_divide_round_up(UT_NUM_EXTENTS * TIER_MIGRATE_POLL_PERIOD_US,
+			       opts.decay_period_ms * 1000);
+	CU_ASSERT(tier->decay_per_poll == UT_NUM_EXTENTS / 4);
+	for (i = 0; i < UT_NUM_EXTENTS; i++) {
+		tier->extents[i].heat = 200;
+	}
+	for (i = 0; i < 4; i++) {
+		ut_migrate();
+	}
+	for (i = 0; i < UT_NUM_EXTENTS; i++) {
+		CU_ASSERT(tier->extents[i].heat == 100);
+	}
+	ut_migrate();
+	CU_ASSERT(tier->extents[0].heat == 50);
+	CU_ASSERT(tier->extents[UT_NUM_EXTENTS / 4].heat == 100);
+
+	/* The heat saturates */
+	tier->extents[1].heat = TIER_HEAT_MAX;
+	ut_touch(tier, 1, 1);
+	CU_ASSERT(tier->extents[1].heat == TIER_HEAT_MAX);
+	ut_tier_delete(tier);
+
+	/* 1 MiB/s allows a bit more than one 8 KiB extent per 10 ms poll */
+	ut_reset_bdevs();
+	tier = ut_tier_create(1);
+	for (i = 0; i < 4; i++) {
+		ut_touch(tier, 20 + i, UT_THRESHOLD);
+	}
+	CU_ASSERT(tier->num_candidates == 4);
+	for (i = 1; i <= 4; i++) {
+		ut_migrate();
+		CU_ASSERT(tier->stats.promotions == i);
+	}
+	CU_ASSERT(tier->num_candidates == 0);
+
+	/* The tokens do not accumulate past a burst of migrations */
+	spdk_delay_us(SPDK_SEC_TO_USEC);
+	ut_migrate();
+	CU_ASSERT(tier->tokens == TIER_MIGRATIONS_MAX * UT_EXTENT_SIZE);
+	ut_tier_delete(tier);
+}
+
+static void
+test_tier_recovery(void)
+{
+	struct vbdev_tier *tier;
+	struct vbdev_tier_opts opts;
+	uint8_t data[UT_EXTENT_SIZE], buf[UT_EXTENT_SIZE];
+	struct spdk_uuid uuid;
+	uint32_t *slots;
+	int status;
+
+	ut_reset_bdevs();
+	tier = ut_tier_create(1000);
+	spdk_uuid_copy(&uuid, &tier->bdev.uuid);
+	ut_touch(tier, 7, UT_THRESHOLD);
+	ut_touch(tier, 9, UT_THRESHOLD + 1);
+	ut_migrate();
+	CU_ASSERT(tier->extents[7].slot == 0);
+	CU_ASSERT(tier->extents[9].slot == 1);
+	ut_fill_pattern(data, sizeof(data), 9);
+	status = ut_submit(tier, SPDK_BDEV_IO_TYPE_WRITE, data, 9 * UT_EXTENT_BLOCKS,
+			   UT_EXTENT_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	ut_tier_delete(tier);
+
+	/* Entries past the extents or mapping an extent twice are dropped when loading */
+	slots = (uint32_t *)(g_fast.data + TIER_MD_BLOCK_SIZE);
+	slots[5] = UT_NUM_EXTENTS + 1;
+	slots[6] = 8 | TIER_SLOT_DIRTY;
+
+	/* The extent size of the existing tier vbdev is used */
+	ut_tier_opts(&opts, 1000);
+	opts.extent_size_kb = 2 * UT_EXTENT_KB;
+	tier = ut_tier_create_opts(&opts);
+	CU_ASSERT(tier->extent_size == UT_EXTENT_SIZE);
+	CU_ASSERT(spdk_uuid_compare(&tier->bdev.uuid, &uuid) == 0);
+	CU_ASSERT(tier->extents[7].slot == 0);
+	CU_ASSERT(tier->extents[9].slot == 1);
+	CU_ASSERT(tier->slots[1] & TIER_SLOT_DIRTY);
+	CU_ASSERT(tier->num_used_slots == 2);
+	CU_ASSERT(tier->num_dirty_slots == 1);
+	CU_ASSERT(tier->num_free_slots == UT_NUM_SLOTS - 2);
+	CU_ASSERT(tier->free_slots[tier->num_free_slots - 1] == 2);
+	CU_ASSERT(tier->slots[5] == 0 && tier->slots[6] == 0);
+	CU_ASSERT(ut_slot_on_disk(tier, 5) == 0 && ut_slot_on_disk(tier, 6) == 0);
+
+	/* The data written to the fast bdev is still there */
+	status = ut_submit(tier, SPDK_BDEV_IO_TYPE_READ, buf, 9 * UT_EXTENT_BLOCKS,
+			   UT_EXTENT_BLOCKS);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, data, UT_EXTENT_SIZE) == 0);
+	CU_ASSERT(!spdk_mem_all_zero(buf, sizeof(buf)));
+	CU_ASSERT(spdk_mem_all_zero(ut_capacity_extent(9), UT_EXTENT_SIZE));
+	ut_tier_delete(tier);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("tier", test_setup, test_cleanup);
+	CU_ADD_TEST(suite, test_tier_create);
+	CU_ADD_TEST(suite, test_tier_read_write);
+	CU_ADD_TEST(suite, test_tier_promote);
+	CU_ADD_TEST(suite, test_tier_demote);
+	CU_ADD_TEST(suite, test_tier_migration_io);
+	CU_ADD_TEST(suite, test_tier_decay_bandwidth);
+	CU_ADD_TEST(suite, test_tier_recovery);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+	CU_cleanup_registry();
+	return num_failures;
+}
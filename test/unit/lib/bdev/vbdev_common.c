@@ -0,0 +1,359 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * Base bdevs of the virtual bdevs under test, their data is kept in memory and their I/Os are
+ * completed on the next poll of the thread they were submitted on. The vbdev I/Os are submitted
+ * on the thread UT_SUBMIT_THREAD.
+ */
+
+#include "spdk_internal/cunit.h"
+#include "spdk_internal/mock.h"
+
+#define UT_BLOCK_SIZE		512
+#define UT_SUBMIT_THREAD	0
+#define UT_BASE_BDEVS_MAX	2
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB(spdk_bdev_module_claim_bdev, int, (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
+		struct spdk_bdev_module *module), 0);
+DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB(spdk_bdev_get_by_name, struct spdk_bdev *, (const char *bdev_name), NULL);
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB(spdk_bdev_get_md_size, uint32_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 1);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_bdev_unregister_by_name, int, (const char *bdev_name,
+		struct spdk_bdev_module *module, spdk_bdev_unregister_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB_V(spdk_bdev_unregister, (struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				     void *cb_arg));
+DEFINE_STUB(spdk_json_write_named_string, int, (struct spdk_json_write_ctx *w,
+		const char *name, const char *val), 0);
+DEFINE_STUB(spdk_json_write_named_uuid, int, (struct spdk_json_write_ctx *w, const char *name,
+		const struct spdk_uuid *val), 0);
+DEFINE_STUB(spdk_json_write_named_uint32, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint32_t val), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint64_t val), 0);
+DEFINE_STUB(spdk_json_write_named_object_begin, int, (struct spdk_json_write_ctx *w,
+		const char *name), 0);
+DEFINE_STUB(spdk_json_write_object_begin, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_object_end, int, (struct spdk_json_write_ctx *w), 0);
+
+struct ut_base_bdev {
+	struct spdk_bdev	bdev;
+	uint8_t			*data;
+	uint32_t		num_reads;
+	uint32_t		num_writes;
+	uint32_t		num_flushes;
+	bool			fail_writes;
+};
+
+static struct ut_base_bdev *g_base_bdevs[UT_BASE_BDEVS_MAX];
+static int g_io_dev;
+static bool g_destruct_done;
+
+int
+spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event_cb,
+		   void *event_ctx, struct spdk_bdev_desc **_desc)
+{
+	int i;
+
+	for (i = 0; i < UT_BASE_BDEVS_MAX; i++) {
+		if (g_base_bdevs[i] != NULL && strcmp(bdev_name, g_base_bdevs[i]->bdev.name) == 0) {
+			*_desc = (void *)g_base_bdevs[i];
+			return 0;
+		}
+	}
+
+	return -ENODEV;
+}
+
+struct spdk_bdev *
+spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
+{
+	return &((struct ut_base_bdev *)desc)->bdev;
+}
+
+const char *
+spdk_bdev_get_name(const struct spdk_bdev *bdev)
+{
+	return bdev->name;
+}
+
+uint32_t
+spdk_bdev_get_block_size(const struct spdk_bdev *bdev)
+{
+	return bdev->blocklen;
+}
+
+uint64_t
+spdk_bdev_get_num_blocks(const struct spdk_bdev *bdev)
+{
+	return bdev->blockcnt;
+}
+
+const struct spdk_uuid *
+spdk_bdev_get_uuid(const struct spdk_bdev *bdev)
+{
+	return &bdev->uuid;
+}
+
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	return spdk_get_io_channel(&g_io_dev);
+}
+
+int
+spdk_bdev_register(struct spdk_bdev *bdev)
+{
+	return 0;
+}
+
+void
+spdk_bdev_destruct_done(struct spdk_bdev *bdev, int bdeverrno)
+{
+	g_destruct_done = true;
+}
+
+void
+spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
+{
+	free(bdev_io);
+}
+
+struct spdk_thread *
+spdk_bdev_io_get_thread(struct spdk_bdev_io *bdev_io)
+{
+	return g_ut_threads[UT_SUBMIT_THREAD].thread;
+}
+
+struct spdk_io_channel *
+spdk_bdev_io_get_io_channel(struct spdk_bdev_io *bdev_io)
+{
+	return spdk_io_channel_from_ctx(bdev_io->internal.ch);
+}
+
+void
+spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len)
+{
+	cb(spdk_bdev_io_get_io_channel(bdev_io), bdev_io, true);
+}
+
+void
+spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	CU_ASSERT(spdk_get_thread() == g_ut_threads[UT_SUBMIT_THREAD].thread);
+	bdev_io->internal.status = status;
+	bdev_io->internal.in_submit_request = false;
+}
+
+struct ut_base_io {
+	spdk_bdev_io_completion_cb	cb;
+	void				*cb_arg;
+	bool				success;
+};
+
+static void
+ut_base_io_complete(void *ctx)
+{
+	struct ut_base_io *io = ctx;
+
+	/* The bdev_io handed to the callback is only freed with spdk_bdev_free_io() */
+	io->cb((struct spdk_bdev_io *)io, io->success, io->cb_arg);
+}
+
+static int
+ut_base_io_submit(bool success, spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_base_io *io;
+
+	io = calloc(1, sizeof(*io));
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	io->cb = cb;
+	io->cb_arg = cb_arg;
+	io->success = success;
+	spdk_thread_send_msg(spdk_get_thread(), ut_base_io_complete, io);
+
+	return 0;
+}
+
+/* Read or write the data of a base bdev, it is zeroed if iovs is NULL */
+static int
+ut_base_io(struct spdk_bdev_desc *desc, struct iovec *iovs, int iovcnt, bool write,
+	   uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_base_bdev *base = (struct ut_base_bdev *)desc;
+	uint8_t *buf = base->data + offset_blocks * UT_BLOCK_SIZE;
+	int i;
+
+	SPDK_CU_ASSERT_FATAL(offset_blocks + num_blocks <= base->bdev.blockcnt);
+
+	if (write) {
+		base->num_writes++;
+		if (base->fail_writes) {
+			return ut_base_io_submit(false, cb, cb_arg);
+		}
+	} else {
+		base->num_reads++;
+	}
+
+	if (iovs == NULL) {
+		memset(buf, 0, num_blocks * UT_BLOCK_SIZE);
+		return ut_base_io_submit(true, cb, cb_arg);
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		if (write) {
+			memcpy(buf, iovs[i].iov_base, iovs[i].iov_len);
+		} else {
+			memcpy(iovs[i].iov_base, buf, iovs[i].iov_len);
+		}
+		buf += iovs[i].iov_len;
+	}
+
+	return ut_base_io_submit(true, cb, cb_arg);
+}
+
+int
+spdk_bdev_readv_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_base_io(desc, iov, iovcnt, false, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_writev_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_base_io(desc, iov, iovcnt, true, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_read_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		      uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		      void *cb_arg)
+{
+	struct iovec iov = { .iov_base = buf, .iov_len = num_blocks * UT_BLOCK_SIZE };
+
+	return ut_base_io(desc, &iov, 1, false, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_write_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		       uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		       void *cb_arg)
+{
+	struct iovec iov = { .iov_base = buf, .iov_len = num_blocks * UT_BLOCK_SIZE };
+
+	return ut_base_io(desc, &iov, 1, true, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_write_zeroes_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			      uint64_t offset_blocks, uint64_t num_blocks,
+			      spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_base_io(desc, NULL, 0, true, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_unmap_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_base_io(desc, NULL, 0, true, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_flush_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_base_bdev *base = (struct ut_base_bdev *)desc;
+
+	SPDK_CU_ASSERT_FATAL(offset_blocks + num_blocks <= base->bdev.blockcnt);
+	base->num_flushes++;
+
+	return ut_base_io_submit(true, cb, cb_arg);
+}
+
+int
+spdk_bdev_reset(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_base_io_submit(true, cb, cb_arg);
+}
+
+static int
+ut_io_dev_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_io_dev_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+static void
+ut_base_bdev_init(struct ut_base_bdev *base, const char *name, uint64_t num_blocks)
+{
+	int i;
+
+	memset(base, 0, sizeof(*base));
+	base->bdev.name = (char *)name;
+	base->bdev.blocklen = UT_BLOCK_SIZE;
+	base->bdev.blockcnt = num_blocks;
+	spdk_uuid_generate(&base->bdev.uuid);
+	base->data = calloc(num_blocks, UT_BLOCK_SIZE);
+	SPDK_CU_ASSERT_FATAL(base->data != NULL);
+
+	for (i = 0; i < UT_BASE_BDEVS_MAX; i++) {
+		if (g_base_bdevs[i] == NULL) {
+			g_base_bdevs[i] = base;
+			return;
+		}
+	}
+	SPDK_CU_ASSERT_FATAL(false);
+}
+
+static void
+ut_base_bdev_fini(struct ut_base_bdev *base)
+{
+	int i;
+
+	for (i = 0; i < UT_BASE_BDEVS_MAX; i++) {
+		if (g_base_bdevs[i] == base) {
+			g_base_bdevs[i] = NULL;
+		}
+	}
+	free(base->data);
+	base->data = NULL;
+}
+
+/* Allocate the threads of the test, the base bdevs are initialized by the caller */
+static void
+ut_vbdev_setup(uint32_t num_threads)
+{
+	allocate_threads(num_threads);
+	set_thread(UT_SUBMIT_THREAD);
+	spdk_io_device_register(&g_io_dev, ut_io_dev_create_cb, ut_io_dev_destroy_cb, 0, "ut_base");
+}
+
+static void
+ut_vbdev_cleanup(void)
+{
+	set_thread(UT_SUBMIT_THREAD);
+	spdk_io_device_unregister(&g_io_dev, NULL);
+	poll_threads();
+	free_threads();
+}
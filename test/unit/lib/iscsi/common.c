@@ -229,6 +229,9 @@ iscsi_conn_readv_data(struct spdk_iscsi_conn *conn, struct iovec *iov, int iovcn
 	return len;
 }
 
+DEFINE_STUB(iscsi_conn_recv_zcopy, void *,
+	    (struct spdk_iscsi_conn *conn, uint32_t len, struct iscsi_recv_buf **recv_buf), NULL);
+
 void
 iscsi_conn_write_pdu(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu,
 		     iscsi_conn_xfer_complete_cb cb_fn, void *cb_arg)
@@ -22,8 +22,37 @@ DEFINE_STUB(iscsi_get_pdu, struct spdk_iscsi_pdu *,
 DEFINE_STUB(iscsi_param_eq_val, int,
 	    (struct iscsi_param *params, const char *key, const char *val), 0);
 DEFINE_STUB(iscsi_pdu_calc_data_digest, uint32_t, (struct spdk_iscsi_pdu *pdu), 0);
-DEFINE_STUB_V(spdk_sock_writev_async,
-	      (struct spdk_sock *sock, struct spdk_sock_request *req));
+
+static struct spdk_sock_request *g_writev_reqs[8];
+static int g_writev_cnt;
+
+void
+spdk_sock_writev_async(struct spdk_sock *sock, struct spdk_sock_request *req)
+{
+	if (g_writev_cnt < (int)SPDK_COUNTOF(g_writev_reqs)) {
+		g_writev_reqs[g_writev_cnt] = req;
+	}
+	g_writev_cnt++;
+}
+
+static uint32_t *g_digest_crc_dst;
+static spdk_accel_completion_cb g_digest_cb_fn;
+static void *g_digest_cb_arg;
+
+int
+spdk_accel_digest_crc32c(struct spdk_io_channel *ch, uint32_t *crc_dst,
+			 struct iovec *iovs, uint32_t iovcnt,
+			 struct spdk_accel_digest_stats *stats,
+			 spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	/* Complete the digest later, by calling g_digest_cb_fn */
+	g_digest_crc_dst = crc_dst;
+	g_digest_cb_fn = cb_fn;
+	g_digest_cb_arg = cb_arg;
+	stats->offloaded++;
+
+	return 0;
+}
 
 struct spdk_scsi_lun {
 	uint8_t reserved;
@@ -78,6 +107,57 @@ DEFINE_STUB(spdk_sock_group_add_sock, int,
 DEFINE_STUB(spdk_sock_group_remove_sock, int,
 	    (struct spdk_sock_group *group, struct spdk_sock *sock), 0);
 
+DEFINE_STUB(spdk_sock_group_get_ctx, void *, (struct spdk_sock_group *sock_group), NULL);
+
+static struct spdk_sock_group *g_optimal_sock_group;
+
+int
+spdk_sock_get_optimal_sock_group(struct spdk_sock *sock, struct spdk_sock_group **group,
+				 struct spdk_sock_group *hint)
+{
+	*group = g_optimal_sock_group;
+
+	return 0;
+}
+
+#define UT_RECV_BUF_NUM	2
+
+static struct iscsi_recv_buf *g_recv_next_bufs[UT_RECV_BUF_NUM];
+static uint32_t g_recv_next_lens[UT_RECV_BUF_NUM];
+static int g_recv_next_idx;
+static int g_recv_next_errno;
+static int g_provide_buf_count;
+
+int
+spdk_sock_recv_next(struct spdk_sock *sock, void **buf, void **ctx)
+{
+	int idx = g_recv_next_idx;
+
+	if (idx == UT_RECV_BUF_NUM) {
+		errno = g_recv_next_errno;
+		return -1;
+	}
+
+	g_recv_next_idx++;
+	*buf = g_recv_next_bufs[idx]->buf;
+	*ctx = g_recv_next_bufs[idx];
+
+	return g_recv_next_lens[idx];
+}
+
+int
+spdk_sock_group_provide_buf(struct spdk_sock_group *group, void *buf, size_t len, void *ctx)
+{
+	struct iscsi_recv_buf *recv_buf = ctx;
+
+	CU_ASSERT(recv_buf->buf == buf);
+	CU_ASSERT(recv_buf->ref == 0);
+	CU_ASSERT(len == ISCSI_RECV_BUF_SIZE);
+	g_provide_buf_count++;
+
+	return 0;
+}
+
 struct spdk_iscsi_task *
 iscsi_task_get(struct spdk_iscsi_conn *conn,
 	       struct spdk_iscsi_task *parent,
@@ -886,6 +966,197 @@ abort_queued_datain_tasks_test(void)
 	g_new_task = NULL;
 }
 
+static void
+recv_bufs_test(void)
+{
+	struct spdk_iscsi_poll_group pg = {};
+	struct spdk_iscsi_conn conn = {};
+	struct iscsi_recv_buf recv_bufs[UT_RECV_BUF_NUM] = {};
+	struct iscsi_recv_buf *recv_buf = NULL;
+	uint8_t bufs[UT_RECV_BUF_NUM][64];
+	uint8_t data[64];
+	void *zcopy;
+	int i, rc;
+
+	for (i = 0; i < UT_RECV_BUF_NUM; i++) {
+		memset(bufs[i], 'a' + i, sizeof(bufs[i]));
+		recv_bufs[i].pg = &pg;
+		recv_bufs[i].thread = spdk_get_thread();
+		recv_bufs[i].buf = bufs[i];
+		g_recv_next_bufs[i] = &recv_bufs[i];
+	}
+	g_recv_next_lens[0] = 48;
+	g_recv_next_lens[1] = 32;
+	g_recv_next_idx = 0;
+	g_recv_next_errno = EAGAIN;
+	g_provide_buf_count = 0;
+
+	conn.recv_next = true;
+	STAILQ_INIT(&conn.recv_bufs);
+
+	/* Data is copied out of the first buffer, and the rest is kept. */
+	rc = iscsi_conn_read_data(&conn, 40, data);
+	CU_ASSERT(rc == 40);
+	CU_ASSERT(data[0] == 'a' && data[39] == 'a');
+	CU_ASSERT(STAILQ_FIRST(&conn.recv_bufs) == &recv_bufs[0]);
+	CU_ASSERT(recv_bufs[0].offset == 40);
+
+	/* A read across the buffers returns the first one to the poll group. */
+	rc = iscsi_conn_read_data(&conn, 16, data);
+	CU_ASSERT(rc == 16);
+	CU_ASSERT(data[7] == 'a' && data[8] == 'b' && data[15] == 'b');
+	CU_ASSERT(g_provide_buf_count == 1);
+	CU_ASSERT(STAILQ_FIRST(&conn.recv_bufs) == &recv_bufs[1]);
+
+	/* Data not held entirely by the first buffer cannot be taken in place. */
+	zcopy = iscsi_conn_recv_zcopy(&conn, 32, &recv_buf);
+	CU_ASSERT(zcopy == NULL);
+	CU_ASSERT(recv_buf == NULL);
+
+	/* The buffer is returned when both the connection and the PDU drop it. */
+	zcopy = iscsi_conn_recv_zcopy(&conn, 24, &recv_buf);
+	CU_ASSERT(zcopy == bufs[1] + 8);
+	CU_ASSERT(recv_buf == &recv_bufs[1]);
+	CU_ASSERT(STAILQ_EMPTY(&conn.recv_bufs));
+	CU_ASSERT(recv_bufs[1].ref == 1);
+	CU_ASSERT(g_provide_buf_count == 1);
+	iscsi_recv_buf_put(recv_buf);
+	CU_ASSERT(g_provide_buf_count == 2);
+
+	/* No data has arrived. */
+	rc = iscsi_conn_read_data(&conn, 16, data);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(conn.recv_next == true);
+
+	/* Fall back to spdk_sock_recv() while no buffer is available. */
+	g_recv_next_errno = ENOBUFS;
+	MOCK_SET(spdk_sock_recv, 16);
+	rc = iscsi_conn_read_data(&conn, 16, data);
+	CU_ASSERT(rc == 16);
+	CU_ASSERT(conn.recv_next == true);
+
+	/* Stop using spdk_sock_recv_next() if the socket reads through a pipe. */
+	g_recv_next_errno = ENOTSUP;
+	rc = iscsi_conn_read_data(&conn, 16, data);
+	CU_ASSERT(rc == 16);
+	CU_ASSERT(conn.recv_next == false);
+	MOCK_CLEAR(spdk_sock_recv);
+}
+
+static void
+optimal_pg_test(void)
+{
+	struct spdk_iscsi_poll_group pg1 = {}, pg2 = {};
+	struct spdk_iscsi_conn conn = {};
+	struct spdk_iscsi_poll_group *pg;
+
+	/* Without placement, the poll group picked by the caller is kept. */
+	g_optimal_sock_group = NULL;
+	pg = iscsi_conn_get_optimal_pg(&conn, &pg1);
+	CU_ASSERT(pg == &pg1);
+
+	/* Otherwise the connection goes to the poll group of its placement ID. */
+	g_optimal_sock_group = (struct spdk_sock_group *)0xDEADBEEF;
+	MOCK_SET(spdk_sock_group_get_ctx, &pg2);
+	pg = iscsi_conn_get_optimal_pg(&conn, &pg1);
+	CU_ASSERT(pg == &pg2);
+
+	g_optimal_sock_group = NULL;
+	MOCK_CLEAR_P(spdk_sock_group_get_ctx);
+}
+
+static void
+write_pdu_data_digest_offload_test(void)
+{
+	struct spdk_iscsi_poll_group pg = {};
+	struct spdk_iscsi_conn conn = {};
+	struct spdk_iscsi_pdu pdu1 = {}, pdu2 = {}, pdu3 = {}, pdu4 = {};
+	uint8_t data[512], expected[ISCSI_DIGEST_LEN];
+	int rc;
+
+	pg.accel_channel = (struct spdk_io_channel *)0xDEADBEEF;
+	conn.pg = &pg;
+	conn.state = ISCSI_CONN_STATE_RUNNING;
+	conn.data_digest = 1;
+	TAILQ_INIT(&conn.write_pdu_list);
+	TAILQ_INIT(&conn.snack_pdu_list);
+	TAILQ_INIT(&conn.digest_pdu_list);
+	TAILQ_INIT(&conn.queued_datain_tasks);
+	g_writev_cnt = 0;
+
+	pdu1.conn = &conn;
+	pdu1.bhs.opcode = ISCSI_OP_SCSI_DATAIN;
+	pdu1.data = data;
+	DSET24(pdu1.bhs.data_segment_len, sizeof(data));
+
+	pdu2.conn = &conn;
+	pdu2.bhs.opcode = ISCSI_OP_SCSI_RSP;
+
+	/* Data segments which need padding have their digest calculated inline */
+	pdu3.conn = &conn;
+	pdu3.bhs.opcode = ISCSI_OP_SCSI_DATAIN;
+	pdu3.data = data;
+	DSET24(pdu3.bhs.data_segment_len, 3);
+
+	/* The data digest of the first PDU is offloaded, so it isn't written yet */
+	iscsi_conn_write_pdu(&conn, &pdu1, iscsi_conn_pdu_generic_complete, NULL);
+	CU_ASSERT(g_digest_cb_arg == &pdu1);
+	CU_ASSERT(pdu1.data_digest_pending);
+	CU_ASSERT(pdu1.data_digest_iov.iov_base == data);
+	CU_ASSERT(pdu1.data_digest_iov.iov_len == sizeof(data));
+	CU_ASSERT(g_writev_cnt == 0);
+	CU_ASSERT(conn.digest_stats.offloaded == 1);
+
+	/* The following PDUs must not overtake it */
+	iscsi_conn_write_pdu(&conn, &pdu2, iscsi_conn_pdu_generic_complete, NULL);
+	iscsi_conn_write_pdu(&conn, &pdu3, iscsi_conn_pdu_generic_complete, NULL);
+	CU_ASSERT(g_writev_cnt == 0);
+	CU_ASSERT(conn.digest_stats.inlined == 1);
+	CU_ASSERT(TAILQ_EMPTY(&conn.write_pdu_list));
+
+	/* Once the digest is done, all PDUs are written in order */
+	*g_digest_crc_dst = 0x12345678;
+	g_digest_cb_fn(g_digest_cb_arg, 0);
+	MAKE_DIGEST_WORD(expected, 0x12345678 ^ SPDK_CRC32C_XOR);
+	CU_ASSERT(memcmp(pdu1.data_digest, expected, sizeof(expected)) == 0);
+	CU_ASSERT(!pdu1.data_digest_pending);
+	CU_ASSERT(TAILQ_EMPTY(&conn.digest_pdu_list));
+	CU_ASSERT(g_writev_cnt == 3);
+	CU_ASSERT(g_writev_reqs[0] == &pdu1.sock_req);
+	CU_ASSERT(g_writev_reqs[1] == &pdu2.sock_req);
+	CU_ASSERT(g_writev_reqs[2] == &pdu3.sock_req);
+
+	/* Without a queued PDU, a PDU without data is written immediately */
+	pdu2.cb_fn = NULL;
+	TAILQ_REMOVE(&conn.write_pdu_list, &pdu2, tailq);
+	iscsi_conn_write_pdu(&conn, &pdu2, iscsi_conn_pdu_generic_complete, NULL);
+	CU_ASSERT(g_writev_cnt == 4);
+	CU_ASSERT(g_writev_reqs[3] == &pdu2.sock_req);
+
+	/* The connection can't be freed while a digest is still being calculated */
+	g_digest_cb_arg = NULL;
+	pdu4.conn = &conn;
+	pdu4.bhs.opcode = ISCSI_OP_SCSI_DATAIN;
+	pdu4.data = data;
+	DSET24(pdu4.bhs.data_segment_len, sizeof(data));
+	iscsi_conn_write_pdu(&conn, &pdu4, iscsi_conn_pdu_generic_complete, NULL);
+	CU_ASSERT(g_digest_cb_arg == &pdu4);
+	conn.state = ISCSI_CONN_STATE_EXITED;
+
+	rc = iscsi_conn_free_tasks(&conn);
+	CU_ASSERT(rc == -1);
+	CU_ASSERT(TAILQ_FIRST(&conn.digest_pdu_list) == &pdu4);
+	CU_ASSERT(TAILQ_EMPTY(&conn.write_pdu_list));
+
+	g_digest_cb_fn(g_digest_cb_arg, 0);
+	CU_ASSERT(g_writev_cnt == 4);
+
+	rc = iscsi_conn_free_tasks(&conn);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(TAILQ_EMPTY(&conn.digest_pdu_list));
+	CU_ASSERT(TAILQ_EMPTY(&conn.write_pdu_list));
+}
+
 int
 main(int argc, char **argv)
 {
@@ -904,6 +1175,9 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, free_tasks_with_queued_datain);
 	CU_ADD_TEST(suite, abort_queued_datain_task_test);
 	CU_ADD_TEST(suite, abort_queued_datain_tasks_test);
+	CU_ADD_TEST(suite, recv_bufs_test);
+	CU_ADD_TEST(suite, optimal_pg_test);
+	CU_ADD_TEST(suite, write_pdu_data_digest_offload_test);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
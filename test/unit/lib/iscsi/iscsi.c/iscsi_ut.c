@@ -2145,6 +2145,35 @@ pdu_payload_read_test(void)
 	MOCK_SET(spdk_mempool_get, &mobj1);
 	mobj1.data_len = 0;
 
+	/* Case 6: the data segment of a Data-OUT PDU is held entirely by the receive buffer
+	 * of the connection. It is taken in place without allocating a data buffer.
+	 */
+	conn.data_digest = false;
+	memset(&pdu, 0, sizeof(pdu));
+	pdu.bhs.opcode = ISCSI_OP_SCSI_DATAOUT;
+	pdu.data_segment_len = SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH;
+	pdu.data_buf_len = pdu.data_segment_len;
+	MOCK_SET(iscsi_conn_recv_zcopy, mobj2.buf);
+
+	rc = iscsi_pdu_payload_read(&conn, &pdu);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(pdu.data == mobj2.buf);
+	CU_ASSERT(pdu.data_valid_bytes == SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH);
+	CU_ASSERT(pdu.data_from_mempool == true);
+	CU_ASSERT(pdu.mobj[0] == NULL);
+	CU_ASSERT(mobj1.data_len == 0);
+
+	/* The data segment of other PDUs is always copied. */
+	memset(&pdu, 0, sizeof(pdu));
+	pdu.bhs.opcode = ISCSI_OP_SCSI;
+	pdu.data_segment_len = iscsi_get_max_immediate_data_size();
+	pdu.data_buf_len = pdu.data_segment_len;
+	g_conn_read_len = 0;
+
+	rc = iscsi_pdu_payload_read(&conn, &pdu);
+	check_pdu_payload_read(&pdu, &mobj1, rc, 0, 0);
+	MOCK_CLEAR_P(iscsi_conn_recv_zcopy);
+
 	g_conn_read_len = 0;
 	MOCK_CLEAR(spdk_mempool_get);
 
@@ -15,7 +15,8 @@
 #include "unit/lib/json_mock.c"
 
 DEFINE_STUB(iscsi_conn_construct, int,
-	    (struct spdk_iscsi_portal *portal, struct spdk_sock *sock),
+	    (struct spdk_iscsi_portal *portal, struct spdk_sock *sock,
+	     struct spdk_iscsi_poll_group *pg),
 	    0);
 DEFINE_STUB(iscsi_check_chap_params, bool,
 	    (bool disable, bool require, bool mutual, int group),
@@ -198,10 +199,10 @@ portal_grp_add_delete_case(void)
 
 	iscsi_portal_grp_add_portal(pg1, p);
 
-	MOCK_SET(spdk_sock_listen, &sock);
+	MOCK_SET(spdk_sock_listen_ext, &sock);
 	rc = iscsi_portal_grp_open(pg1, false);
 	CU_ASSERT(rc == 0);
-	MOCK_CLEAR_P(spdk_sock_listen);
+	MOCK_CLEAR_P(spdk_sock_listen_ext);
 
 	rc = iscsi_portal_grp_register(pg1);
 	CU_ASSERT(rc == 0);
@@ -244,7 +245,7 @@ portal_grp_add_delete_twice_case(void)
 
 	iscsi_portal_grp_add_portal(pg1, p);
 
-	MOCK_SET(spdk_sock_listen, &sock);
+	MOCK_SET(spdk_sock_listen_ext, &sock);
 	rc = iscsi_portal_grp_open(pg1, false);
 	CU_ASSERT(rc == 0);
 
@@ -277,7 +278,176 @@ portal_grp_add_delete_twice_case(void)
 	CU_ASSERT(TAILQ_EMPTY(&g_iscsi.portal_head));
 	CU_ASSERT(TAILQ_EMPTY(&g_iscsi.pg_head));
 
-	MOCK_CLEAR_P(spdk_sock_listen);
+	MOCK_CLEAR_P(spdk_sock_listen_ext);
+
+	free_threads();
+}
+
+static void
+portal_grp_reuseport_case(void)
+{
+	struct spdk_sock sock = {};
+	struct spdk_iscsi_poll_group ipg1 = {}, ipg2 = {};
+	struct spdk_iscsi_portal_grp *pg;
+	struct spdk_iscsi_portal *p;
+	int rc;
+
+	const char *host = "192.168.2.0";
+	const char *port = "3260";
+
+	/* The portals are opened on thread 0, the poll groups run on threads 1 and 2. */
+	allocate_threads(3);
+	set_thread(0);
+
+	TAILQ_INIT(&g_iscsi.poll_group_head);
+	ipg1.thread = g_ut_threads[1].thread;
+	TAILQ_INIT(&ipg1.acceptors);
+	TAILQ_INSERT_TAIL(&g_iscsi.poll_group_head, &ipg1, link);
+	ipg2.thread = g_ut_threads[2].thread;
+	TAILQ_INIT(&ipg2.acceptors);
+	TAILQ_INSERT_TAIL(&g_iscsi.poll_group_head, &ipg2, link);
+	g_iscsi.reuseport = true;
+
+	pg = iscsi_portal_grp_create(1, false);
+	CU_ASSERT(pg != NULL);
+
+	p = iscsi_portal_create(host, port);
+	CU_ASSERT(p != NULL);
+
+	iscsi_portal_grp_add_portal(pg, p);
+
+	/* Each poll group gets its own listening socket, which it polls only after resume. */
+	MOCK_SET(spdk_sock_listen_ext, &sock);
+	rc = iscsi_portal_grp_open(pg, true);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(p->sock == NULL);
+	CU_ASSERT(p->acceptor_poller == NULL);
+	CU_ASSERT(p->num_acceptors == 2);
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&ipg1.acceptors));
+	CU_ASSERT(TAILQ_EMPTY(&ipg2.acceptors));
+
+	/* The sockets are attached by the threads of the poll groups. */
+	iscsi_portal_grp_resume(pg);
+	CU_ASSERT(TAILQ_EMPTY(&ipg1.acceptors));
+	poll_threads();
+	CU_ASSERT(TAILQ_FIRST(&ipg1.acceptors) == p->acceptors[0]);
+	CU_ASSERT(p->acceptors[0]->pg == &ipg1);
+	CU_ASSERT(TAILQ_FIRST(&ipg2.acceptors) == p->acceptors[1]);
+	CU_ASSERT(p->acceptors[1]->pg == &ipg2);
+
+	/* Opening the portal again fails. */
+	rc = iscsi_portal_grp_open(pg, false);
+	CU_ASSERT(rc != 0);
+
+	/* The sockets are closed by the threads of the poll groups. */
+	iscsi_portal_grp_close(pg);
+	CU_ASSERT(p->acceptors == NULL);
+	CU_ASSERT(p->num_acceptors == 0);
+	CU_ASSERT(pg->num_closing_acceptors == 2);
+	CU_ASSERT(!TAILQ_EMPTY(&ipg1.acceptors));
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&ipg1.acceptors));
+	CU_ASSERT(TAILQ_EMPTY(&ipg2.acceptors));
+	CU_ASSERT(pg->num_closing_acceptors == 0);
+
+	/* Failing to listen on one of the poll groups fails the open. */
+	MOCK_CLEAR_P(spdk_sock_listen_ext);
+	rc = iscsi_portal_grp_open(pg, false);
+	CU_ASSERT(rc != 0);
+	CU_ASSERT(p->acceptors == NULL);
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&ipg1.acceptors));
+
+	/* Releasing the portal group destroys it once the sockets are closed. */
+	MOCK_SET(spdk_sock_listen_ext, &sock);
+	rc = iscsi_portal_grp_open(pg, false);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(TAILQ_FIRST(&ipg1.acceptors) == p->acceptors[0]);
+	iscsi_portal_grp_release(pg);
+	CU_ASSERT(pg->release_pending == true);
+	CU_ASSERT(!TAILQ_EMPTY(&g_iscsi.portal_head));
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&ipg1.acceptors));
+	CU_ASSERT(TAILQ_EMPTY(&ipg2.acceptors));
+	CU_ASSERT(TAILQ_EMPTY(&g_iscsi.portal_head));
+	MOCK_CLEAR_P(spdk_sock_listen_ext);
+
+	g_iscsi.reuseport = false;
+	TAILQ_INIT(&g_iscsi.poll_group_head);
+
+	free_threads();
+}
+
+static void
+portal_tls_case(void)
+{
+	struct spdk_sock sock = {};
+	struct spdk_iscsi_portal_grp *pg;
+	struct spdk_iscsi_portal *p;
+	uint8_t key[64] = {};
+	const char *cipher = NULL;
+	int rc;
+
+	const char *host = "192.168.2.0";
+	const char *port = "3260";
+
+	allocate_threads(1);
+	set_thread(0);
+
+	g_iscsi.tls = true;
+	g_iscsi.tls_psk_identity = "psk.identity";
+	memset(g_iscsi.tls_psk, 0xa5, ISCSI_TLS_PSK_MIN_LEN);
+	g_iscsi.tls_psk_size = ISCSI_TLS_PSK_MIN_LEN;
+
+	/* The PSK is returned only for the configured identity, and its length selects the cipher. */
+	rc = iscsi_portal_get_tls_psk(key, sizeof(key), &cipher, "psk.identity", NULL);
+	CU_ASSERT(rc == ISCSI_TLS_PSK_MIN_LEN);
+	CU_ASSERT(memcmp(key, g_iscsi.tls_psk, ISCSI_TLS_PSK_MIN_LEN) == 0);
+	CU_ASSERT(strcmp(cipher, "TLS_AES_128_GCM_SHA256") == 0);
+
+	rc = iscsi_portal_get_tls_psk(key, sizeof(key), &cipher, "other.identity", NULL);
+	CU_ASSERT(rc == -1);
+
+	rc = iscsi_portal_get_tls_psk(key, ISCSI_TLS_PSK_MIN_LEN - 1, &cipher, "psk.identity", NULL);
+	CU_ASSERT(rc == -1);
+
+	g_iscsi.tls_psk_size = ISCSI_TLS_PSK_MAX_LEN;
+	rc = iscsi_portal_get_tls_psk(key, sizeof(key), &cipher, "psk.identity", NULL);
+	CU_ASSERT(rc == ISCSI_TLS_PSK_MAX_LEN);
+	CU_ASSERT(strcmp(cipher, "TLS_AES_256_GCM_SHA384") == 0);
+
+	pg = iscsi_portal_grp_create(1, false);
+	CU_ASSERT(pg != NULL);
+
+	p = iscsi_portal_create(host, port);
+	CU_ASSERT(p != NULL);
+
+	iscsi_portal_grp_add_portal(pg, p);
+
+	/* Opening fails if the ssl sock implementation is not available. */
+	MOCK_SET(spdk_sock_listen_ext, &sock);
+	MOCK_SET(spdk_sock_impl_get_opts, -1);
+	rc = iscsi_portal_grp_open(pg, false);
+	CU_ASSERT(rc != 0);
+	CU_ASSERT(p->sock == NULL);
+
+	MOCK_SET(spdk_sock_impl_get_opts, 0);
+	rc = iscsi_portal_grp_open(pg, false);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(p->sock == &sock);
+
+	iscsi_portal_grp_close(pg);
+	MOCK_CLEAR_P(spdk_sock_listen_ext);
+
+	iscsi_portal_grp_destroy(pg);
+	CU_ASSERT(TAILQ_EMPTY(&g_iscsi.portal_head));
+
+	g_iscsi.tls = false;
+	g_iscsi.tls_psk_identity = NULL;
+	memset(g_iscsi.tls_psk, 0, sizeof(g_iscsi.tls_psk));
+	g_iscsi.tls_psk_size = 0;
 
 	free_threads();
 }
@@ -301,6 +471,8 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, portal_grp_register_twice_case);
 	CU_ADD_TEST(suite, portal_grp_add_delete_case);
 	CU_ADD_TEST(suite, portal_grp_add_delete_twice_case);
+	CU_ADD_TEST(suite, portal_grp_reuseport_case);
+	CU_ADD_TEST(suite, portal_tls_case);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
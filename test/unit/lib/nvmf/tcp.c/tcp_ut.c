@@ -243,10 +243,10 @@ spdk_accel_get_io_channel(void)
 	return spdk_get_io_channel(g_accel_p);
 }
 
-DEFINE_STUB(spdk_accel_submit_crc32cv,
+DEFINE_STUB(spdk_accel_digest_crc32c,
 	    int,
-	    (struct spdk_io_channel *ch, uint32_t *dst, struct iovec *iovs,
-	     uint32_t iovcnt, uint32_t seed, spdk_accel_completion_cb cb_fn, void *cb_arg),
+	    (struct spdk_io_channel *ch, uint32_t *crc_dst, struct iovec *iovs, uint32_t iovcnt,
+	     struct spdk_accel_digest_stats *stats, spdk_accel_completion_cb cb_fn, void *cb_arg),
 	    0);
 
 DEFINE_STUB(spdk_nvmf_bdev_ctrlr_nvme_passthru_admin,
@@ -551,6 +551,7 @@ test_nvmf_tcp_send_c2h_data(void)
 	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_ERROR;
 
 	tcp_req.req.cmd = (union nvmf_h2c_msg *)&tcp_req.cmd;
+	tcp_req.req.rsp = (union nvmf_c2h_msg *)&tcp_req.rsp;
 
 	tcp_req.req.iov[0].iov_base = (void *)0xDEADBEEF;
 	tcp_req.req.iov[0].iov_len = 101;
@@ -569,6 +570,8 @@ test_nvmf_tcp_send_c2h_data(void)
 	CU_ASSERT(c2h_data->common.plen == sizeof(*c2h_data) + 300);
 	CU_ASSERT(c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_LAST_PDU);
 	CU_ASSERT(c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_SUCCESS);
+	CU_ASSERT(tcp_req.rsp_piggybacked == false);
+	CU_ASSERT(pdu.sock_req.iovcnt == 4);
 
 	CU_ASSERT(pdu.data_iovcnt == 3);
 	CU_ASSERT((uint64_t)pdu.data_iov[0].iov_base == 0xDEADBEEF);
@@ -585,6 +588,15 @@ test_nvmf_tcp_send_c2h_data(void)
 	CU_ASSERT(c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_LAST_PDU);
 	CU_ASSERT((c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_SUCCESS) == 0);
 
+	/* The capsule response is written in the same socket request as the data */
+	CU_ASSERT(tcp_req.rsp_piggybacked == true);
+	CU_ASSERT(pdu.sock_req.iovcnt == 5);
+	CU_ASSERT(pdu.iov[4].iov_base == tcp_req.piggyback_rsp.raw);
+	CU_ASSERT(pdu.iov[4].iov_len == sizeof(struct spdk_nvme_tcp_rsp));
+	CU_ASSERT(tcp_req.piggyback_rsp.capsule_resp.common.pdu_type ==
+		  SPDK_NVME_TCP_PDU_TYPE_CAPSULE_RESP);
+	CU_ASSERT(tcp_req.piggyback_rsp.capsule_resp.rccqe.cdw0 == 1);
+
 	ttransport.tcp_opts.c2h_success = false;
 	tcp_req.pdu_in_use = false;
 	tcp_req.rsp.cdw0 = 0;
@@ -600,6 +612,101 @@ test_nvmf_tcp_send_c2h_data(void)
 	CU_ASSERT(c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_LAST_PDU);
 	CU_ASSERT((c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_SUCCESS) == 0);
 
+	/* The header digest of the piggybacked capsule response is calculated */
+	tcp_req.pdu_in_use = false;
+	tqpair.host_hdgst_enable = true;
+	nvmf_tcp_send_c2h_data(&tqpair, &tcp_req);
+
+	CU_ASSERT(tcp_req.rsp_piggybacked == true);
+	CU_ASSERT(pdu.iov[pdu.sock_req.iovcnt - 1].iov_base == tcp_req.piggyback_rsp.raw);
+	CU_ASSERT(pdu.iov[pdu.sock_req.iovcnt - 1].iov_len ==
+		  sizeof(struct spdk_nvme_tcp_rsp) + SPDK_NVME_TCP_DIGEST_LEN);
+	CU_ASSERT(tcp_req.piggyback_rsp.capsule_resp.common.flags & SPDK_NVME_TCP_CH_FLAGS_HDGSTF);
+	CU_ASSERT(MATCH_DIGEST_WORD(tcp_req.piggyback_rsp.raw + sizeof(struct spdk_nvme_tcp_rsp),
+				    spdk_crc32c_update(tcp_req.piggyback_rsp.raw,
+						    sizeof(struct spdk_nvme_tcp_rsp), ~0) ^ SPDK_CRC32C_XOR));
+
+	spdk_thread_exit(thread);
+	while (!spdk_thread_is_exited(thread)) {
+		spdk_thread_poll(thread, 0, 0);
+	}
+	spdk_thread_destroy(thread);
+}
+
+#define UT_C2H_DIF_BLOCK_SIZE	520
+#define UT_C2H_DIF_MD_SIZE	8
+#define UT_C2H_DIF_NUM_BLOCKS	31
+
+static void
+test_nvmf_tcp_send_c2h_data_dif(void)
+{
+	struct spdk_thread *thread;
+	struct spdk_nvmf_tcp_transport ttransport = {};
+	struct spdk_nvmf_tcp_qpair tqpair = {};
+	struct spdk_nvmf_tcp_req tcp_req = {};
+	struct nvme_tcp_pdu pdu = {};
+	struct spdk_nvme_tcp_c2h_data_hdr *c2h_data;
+	struct spdk_dif_ctx_init_ext_opts dif_opts;
+	uint32_t data_block_size = UT_C2H_DIF_BLOCK_SIZE - UT_C2H_DIF_MD_SIZE;
+	uint8_t *buf;
+	int rc;
+
+	ttransport.tcp_opts.c2h_success = false;
+	thread = spdk_thread_create(NULL, NULL);
+	SPDK_CU_ASSERT_FATAL(thread != NULL);
+	spdk_set_thread(thread);
+
+	buf = calloc(UT_C2H_DIF_NUM_BLOCKS, UT_C2H_DIF_BLOCK_SIZE);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	tcp_req.pdu = &pdu;
+	tcp_req.req.qpair = &tqpair.qpair;
+	tqpair.qpair.transport = &ttransport.transport;
+
+	/* Set qpair state to make unrelated operations NOP */
+	tqpair.state = NVME_TCP_QPAIR_STATE_RUNNING;
+	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_ERROR;
+
+	tcp_req.req.cmd = (union nvmf_h2c_msg *)&tcp_req.cmd;
+	tcp_req.req.rsp = (union nvmf_c2h_msg *)&tcp_req.rsp;
+
+	/* Interleaved metadata splits the data into one iov per block, so a single PDU
+	 * with its header takes up all of pdu->iov.
+	 */
+	tcp_req.req.iov[0].iov_base = buf;
+	tcp_req.req.iov[0].iov_len = UT_C2H_DIF_NUM_BLOCKS * UT_C2H_DIF_BLOCK_SIZE;
+	tcp_req.req.iovcnt = 1;
+	tcp_req.req.length = UT_C2H_DIF_NUM_BLOCKS * data_block_size;
+	tcp_req.req.dif_enabled = true;
+
+	dif_opts.size = SPDK_SIZEOF(&dif_opts, dif_pi_format);
+	dif_opts.dif_pi_format = SPDK_DIF_PI_FORMAT_16;
+	rc = spdk_dif_ctx_init(&tcp_req.req.dif.dif_ctx, UT_C2H_DIF_BLOCK_SIZE, UT_C2H_DIF_MD_SIZE,
+			       true, false, SPDK_DIF_TYPE1, 0, 0, 0, 0, 0, 0, &dif_opts);
+	CU_ASSERT(rc == 0);
+
+	/* One iov is reserved for the piggybacked capsule response */
+	nvmf_tcp_send_c2h_data(&tqpair, &tcp_req);
+
+	c2h_data = &pdu.hdr.c2h_data;
+	CU_ASSERT(c2h_data->datao == 0);
+	CU_ASSERT(c2h_data->datal == (UT_C2H_DIF_NUM_BLOCKS - 1) * data_block_size);
+	CU_ASSERT((c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_LAST_PDU) == 0);
+	CU_ASSERT(tcp_req.rsp_piggybacked == false);
+	CU_ASSERT(pdu.sock_req.iovcnt == UT_C2H_DIF_NUM_BLOCKS);
+
+	/* The remaining block goes out with the capsule response */
+	tcp_req.pdu_in_use = false;
+	_nvmf_tcp_send_c2h_data(&tqpair, &tcp_req);
+
+	CU_ASSERT(c2h_data->datao == (UT_C2H_DIF_NUM_BLOCKS - 1) * data_block_size);
+	CU_ASSERT(c2h_data->datal == data_block_size);
+	CU_ASSERT(c2h_data->common.flags & SPDK_NVME_TCP_C2H_DATA_FLAGS_LAST_PDU);
+	CU_ASSERT(tcp_req.rsp_piggybacked == true);
+	CU_ASSERT(pdu.sock_req.iovcnt == 3);
+	CU_ASSERT(pdu.iov[2].iov_base == tcp_req.piggyback_rsp.raw);
+
+	free(buf);
 	spdk_thread_exit(thread);
 	while (!spdk_thread_is_exited(thread)) {
 		spdk_thread_poll(thread, 0, 0);
@@ -1465,6 +1572,104 @@ test_nvmf_tcp_tls_generate_tls_psk(void)
 					  NVME_TCP_CIPHER_AES_128_GCM_SHA256) < 0);
 }
 
+static void
+test_nvmf_tcp_recv_buf_in_place(void)
+{
+	struct spdk_nvmf_tcp_qpair tqpair = {};
+	struct spdk_nvmf_tcp_poll_group tcp_group = {};
+	struct spdk_sock_group grp = {};
+	struct nvmf_tcp_recv_buf recv_buf = {};
+	struct spdk_nvmf_tcp_req tcp_req = {};
+	struct nvme_tcp_pdu pdu = {};
+	uint8_t mem[256] __attribute__((aligned(8))) = {};
+	uint8_t icd[16] = {}, hdr[8] = {};
+	int rc;
+
+	tcp_group.sock_group = &grp;
+	tcp_group.recv_buf_size = sizeof(mem);
+	tqpair.group = &tcp_group;
+	STAILQ_INIT(&tqpair.recv_bufs);
+	TAILQ_INIT(&tqpair.tcp_req_free_queue);
+	TAILQ_INIT(&tqpair.tcp_req_working_queue);
+
+	tcp_req.req.qpair = &tqpair.qpair;
+	tcp_req.buf = icd;
+	tcp_req.req.iov[0].iov_base = icd;
+	tcp_req.req.iov[0].iov_len = sizeof(icd);
+	tcp_req.req.iovcnt = 1;
+	tcp_req.state = TCP_REQUEST_STATE_TRANSFERRING_HOST_TO_CONTROLLER;
+	tqpair.state_cntr[TCP_REQUEST_STATE_TRANSFERRING_HOST_TO_CONTROLLER] = 1;
+	TAILQ_INSERT_TAIL(&tqpair.tcp_req_working_queue, &tcp_req, state_link);
+
+	pdu.hdr.common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_CAPSULE_CMD;
+	pdu.req = &tcp_req;
+	pdu.data_iov[0].iov_base = icd;
+	pdu.data_iov[0].iov_len = sizeof(icd);
+	pdu.data_iovcnt = 1;
+	pdu.data_len = sizeof(icd);
+	pdu.ddgst_enable = true;
+
+	/* The buffer holds the in-capsule data, its digest and the next header. */
+	memset(mem, 0xa5, sizeof(icd));
+	memset(mem + sizeof(icd), 0x5a, SPDK_NVME_TCP_DIGEST_LEN);
+	memset(mem + sizeof(icd) + SPDK_NVME_TCP_DIGEST_LEN, 0x11, sizeof(hdr));
+	recv_buf.tgroup = &tcp_group;
+	recv_buf.buf = mem;
+	recv_buf.data = mem;
+	recv_buf.len = sizeof(icd) + SPDK_NVME_TCP_DIGEST_LEN + sizeof(hdr);
+	recv_buf.ref = 1;
+	STAILQ_INSERT_TAIL(&tqpair.recv_bufs, &recv_buf, link);
+
+	/* The data is placed in the receive buffer without a copy */
+	rc = nvmf_tcp_read_payload_data(&tqpair, &pdu, sizeof(icd) + SPDK_NVME_TCP_DIGEST_LEN);
+	CU_ASSERT(rc == sizeof(icd) + SPDK_NVME_TCP_DIGEST_LEN);
+	CU_ASSERT(pdu.data_iov[0].iov_base == mem);
+	CU_ASSERT(tcp_req.req.iov[0].iov_base == mem);
+	CU_ASSERT(tcp_req.recv_buf == &recv_buf);
+	CU_ASSERT(pdu.data_digest[0] == 0x5a && pdu.data_digest[3] == 0x5a);
+	CU_ASSERT(icd[0] == 0);
+	CU_ASSERT(recv_buf.ref == 2);
+	CU_ASSERT(recv_buf.offset == sizeof(icd) + SPDK_NVME_TCP_DIGEST_LEN);
+	CU_ASSERT(tcp_group.in_place_capsule_data == 1);
+
+	/* Consuming the rest of the buffer keeps it held by the request */
+	rc = nvmf_tcp_read_data(&tqpair, sizeof(hdr), hdr);
+	CU_ASSERT(rc == sizeof(hdr));
+	CU_ASSERT(hdr[0] == 0x11 && hdr[7] == 0x11);
+	CU_ASSERT(STAILQ_EMPTY(&tqpair.recv_bufs));
+	CU_ASSERT(recv_buf.ref == 1);
+
+	/* Freeing the request releases the buffer */
+	nvmf_tcp_req_put(&tqpair, &tcp_req);
+	CU_ASSERT(tcp_req.recv_buf == NULL);
+	CU_ASSERT(recv_buf.ref == 0);
+
+	/* Data received only partially is copied into the in-capsule data buffer */
+	TAILQ_REMOVE(&tqpair.tcp_req_free_queue, &tcp_req, state_link);
+	TAILQ_INSERT_TAIL(&tqpair.tcp_req_working_queue, &tcp_req, state_link);
+	tqpair.state_cntr[TCP_REQUEST_STATE_FREE] = 0;
+	tqpair.state_cntr[TCP_REQUEST_STATE_TRANSFERRING_HOST_TO_CONTROLLER] = 1;
+	tcp_req.state = TCP_REQUEST_STATE_TRANSFERRING_HOST_TO_CONTROLLER;
+	tcp_req.req.iov[0].iov_base = icd;
+	pdu.data_iov[0].iov_base = icd;
+	memset(mem, 0xa5, sizeof(icd));
+	recv_buf.data = mem;
+	recv_buf.len = 10;
+	recv_buf.offset = 0;
+	recv_buf.ref = 1;
+	STAILQ_INSERT_TAIL(&tqpair.recv_bufs, &recv_buf, link);
+
+	rc = nvmf_tcp_read_payload_data(&tqpair, &pdu, sizeof(icd) + SPDK_NVME_TCP_DIGEST_LEN);
+	CU_ASSERT(rc == 10);
+	CU_ASSERT(pdu.data_iov[0].iov_base == icd);
+	CU_ASSERT(tcp_req.req.iov[0].iov_base == icd);
+	CU_ASSERT(tcp_req.recv_buf == NULL);
+	CU_ASSERT(icd[0] == 0xa5 && icd[9] == 0xa5 && icd[10] == 0);
+	CU_ASSERT(STAILQ_EMPTY(&tqpair.recv_bufs));
+	CU_ASSERT(recv_buf.ref == 0);
+	CU_ASSERT(tcp_group.in_place_capsule_data == 1);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1479,6 +1684,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvmf_tcp_destroy);
 	CU_ADD_TEST(suite, test_nvmf_tcp_poll_group_create);
 	CU_ADD_TEST(suite, test_nvmf_tcp_send_c2h_data);
+	CU_ADD_TEST(suite, test_nvmf_tcp_send_c2h_data_dif);
 	CU_ADD_TEST(suite, test_nvmf_tcp_h2c_data_hdr_handle);
 	CU_ADD_TEST(suite, test_nvmf_tcp_in_capsule_data_handle);
 	CU_ADD_TEST(suite, test_nvmf_tcp_qpair_init_mem_resource);
@@ -1492,6 +1698,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvmf_tcp_tls_generate_psk_id);
 	CU_ADD_TEST(suite, test_nvmf_tcp_tls_generate_retained_psk);
 	CU_ADD_TEST(suite, test_nvmf_tcp_tls_generate_tls_psk);
+	CU_ADD_TEST(suite, test_nvmf_tcp_recv_buf_in_place);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
@@ -38,6 +38,7 @@ _req_cb(void *cb_arg, int len)
 static void
 flush(void)
 {
+	struct spdk_sock_group sgroup = {};
 	struct spdk_posix_sock_group_impl group = {};
 	struct spdk_posix_sock psock = {};
 	struct spdk_sock *sock = &psock.base;
@@ -49,6 +50,9 @@ flush(void)
 	TAILQ_INIT(&sock->queued_reqs);
 	TAILQ_INIT(&sock->pending_reqs);
 	sock->group_impl = &group.base;
+	group.base.group = &sgroup;
+	sgroup.flush_histogram = spdk_histogram_data_alloc();
+	SPDK_CU_ASSERT_FATAL(sgroup.flush_histogram != NULL);
 
 	req1 = calloc(1, sizeof(struct spdk_sock_request) + 2 * sizeof(struct iovec));
 	SPDK_CU_ASSERT_FATAL(req1 != NULL);
@@ -131,6 +135,11 @@ flush(void)
 	CU_ASSERT(cb_arg1 == true);
 	CU_ASSERT(TAILQ_EMPTY(&sock->queued_reqs));
 
+	/* Each sendmsg is counted by its size. */
+	CU_ASSERT(sgroup.flush_histogram->bucket[64] == 2);
+	CU_ASSERT(sgroup.flush_histogram->bucket[128] == 1);
+
+	spdk_histogram_data_free(sgroup.flush_histogram);
 	free(req1);
 	free(req2);
 }
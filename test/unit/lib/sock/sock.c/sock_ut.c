@@ -40,6 +40,7 @@ struct spdk_ut_sock {
 struct spdk_ut_sock_group_impl {
 	struct spdk_sock_group_impl	base;
 	struct spdk_ut_sock		*sock;
+	int				efd;
 };
 
 #define __ut_sock(sock) (struct spdk_ut_sock *)sock
@@ -258,6 +259,9 @@ spdk_ut_sock_group_impl_create(void)
 	group_impl = calloc(1, sizeof(*group_impl));
 	SPDK_CU_ASSERT_FATAL(group_impl != NULL);
 
+	group_impl->efd = eventfd(0, EFD_NONBLOCK);
+	SPDK_CU_ASSERT_FATAL(group_impl->efd >= 0);
+
 	return &group_impl->base;
 }
 
@@ -304,11 +308,22 @@ spdk_ut_sock_group_impl_close(struct spdk_sock_group_impl *_group)
 	struct spdk_ut_sock_group_impl *group = __ut_group(_group);
 
 	CU_ASSERT(group->sock == NULL);
+	close(group->efd);
 	free(_group);
 
 	return 0;
 }
 
+static bool g_ut_intr_unsupported;
+
+static int
+spdk_ut_sock_group_impl_get_interrupt_fd(struct spdk_sock_group_impl *_group)
+{
+	struct spdk_ut_sock_group_impl *group = __ut_group(_group);
+
+	return g_ut_intr_unsupported ? -ENOTSUP : group->efd;
+}
+
 static struct spdk_net_impl g_ut_net_impl = {
 	.name		= "ut",
 	.getaddr	= spdk_ut_sock_getaddr,
@@ -332,6 +347,7 @@ static struct spdk_net_impl g_ut_net_impl = {
 	.group_impl_remove_sock = spdk_ut_sock_group_impl_remove_sock,
 	.group_impl_poll	= spdk_ut_sock_group_impl_poll,
 	.group_impl_close	= spdk_ut_sock_group_impl_close,
+	.group_impl_get_interrupt_fd	= spdk_ut_sock_group_impl_get_interrupt_fd,
 };
 
 SPDK_NET_IMPL_REGISTER(ut, &g_ut_net_impl, DEFAULT_SOCK_PRIORITY + 2);
@@ -1236,6 +1252,282 @@ ut_sock_group_get_ctx(void)
 	CU_ASSERT(test_ctx1 == test_ctx2);
 }
 
+static int g_group_intr_count;
+
+static int
+ut_sock_group_intr(void *ctx)
+{
+	struct spdk_sock_group *group = ctx;
+	int rc;
+
+	g_group_intr_count++;
+
+	rc = spdk_sock_group_poll(group);
+	if (rc > 0) {
+		/* Simulate the time spent on the events. */
+		spdk_delay_us(5);
+	}
+
+	return rc;
+}
+
+static void
+_flush_batch_cb(void *cb_arg, int err)
+{
+	CU_ASSERT(err == 0);
+}
+
+static uint64_t
+ut_flush_histogram_count(struct spdk_histogram_data *histogram, uint64_t bytes)
+{
+	uint32_t range = __spdk_histogram_data_get_bucket_range(histogram, bytes);
+	uint32_t index = __spdk_histogram_data_get_bucket_index(histogram, bytes, range);
+
+	return __spdk_histogram_get_count(histogram, range, index);
+}
+
+static void
+posix_sock_flush_batch(void)
+{
+	struct spdk_sock_group *group;
+	struct spdk_sock *listen_sock;
+	struct spdk_sock *server_sock;
+	struct spdk_sock *client_sock;
+	struct spdk_sock_impl_opts opts, orig_opts;
+	struct spdk_histogram_data *histogram;
+	struct spdk_sock_request *req[3];
+	uint8_t data_buf[64] = {};
+	size_t len;
+	int rc, i;
+
+	len = sizeof(orig_opts);
+	rc = spdk_sock_impl_get_opts("posix", &orig_opts, &len);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(orig_opts.flush_batch_timeout == 0);
+	CU_ASSERT(orig_opts.flush_batch_iovcnt_threshold == IOV_BATCH_SIZE);
+	CU_ASSERT(orig_opts.flush_batch_bytes_threshold == DEFAULT_FLUSH_BATCH_BYTES);
+
+	/* Without zero copy, the requests are completed once sent. */
+	opts = orig_opts;
+	opts.enable_zerocopy_send_server = false;
+	opts.flush_batch_timeout = 10;
+	opts.flush_batch_iovcnt_threshold = 3;
+	opts.flush_batch_bytes_threshold = 128;
+	rc = spdk_sock_impl_set_opts("posix", &opts, sizeof(opts));
+	CU_ASSERT(rc == 0);
+
+	listen_sock = spdk_sock_listen("127.0.0.1", UT_PORT, "posix");
+	SPDK_CU_ASSERT_FATAL(listen_sock != NULL);
+
+	client_sock = spdk_sock_connect("127.0.0.1", UT_PORT, "posix");
+	SPDK_CU_ASSERT_FATAL(client_sock != NULL);
+
+	usleep(1000);
+
+	server_sock = spdk_sock_accept(listen_sock);
+	SPDK_CU_ASSERT_FATAL(server_sock != NULL);
+
+	group = spdk_sock_group_create(NULL);
+	SPDK_CU_ASSERT_FATAL(group != NULL);
+
+	rc = spdk_sock_group_add_sock(group, server_sock, read_data, server_sock);
+	CU_ASSERT(rc == 0);
+
+	for (i = 0; i < 3; i++) {
+		req[i] = calloc(1, sizeof(struct spdk_sock_request) + sizeof(struct iovec));
+		SPDK_CU_ASSERT_FATAL(req[i] != NULL);
+		SPDK_SOCK_REQUEST_IOV(req[i], 0)->iov_base = data_buf;
+		SPDK_SOCK_REQUEST_IOV(req[i], 0)->iov_len = 32;
+		req[i]->iovcnt = 1;
+		req[i]->cb_fn = _flush_batch_cb;
+	}
+
+	/* The histogram is read through the group, as the getter only returns a const pointer. */
+	histogram = group->flush_histogram;
+	SPDK_CU_ASSERT_FATAL(histogram != NULL);
+	CU_ASSERT(spdk_sock_group_get_flush_histogram(group) == histogram);
+
+	/* Requests wait for the timeout to be sent together. */
+	spdk_sock_writev_async(server_sock, req[0]);
+	spdk_sock_writev_async(server_sock, req[1]);
+	spdk_sock_group_poll(group);
+	CU_ASSERT(!TAILQ_EMPTY(&server_sock->queued_reqs));
+
+	spdk_delay_us(10);
+	spdk_sock_group_poll(group);
+	CU_ASSERT(TAILQ_EMPTY(&server_sock->queued_reqs));
+	CU_ASSERT(ut_flush_histogram_count(histogram, 64) == 1);
+
+	/* Reaching the iovcnt threshold sends the batch before the timeout. */
+	for (i = 0; i < 3; i++) {
+		SPDK_SOCK_REQUEST_IOV(req[i], 0)->iov_len = 16;
+		spdk_sock_writev_async(server_sock, req[i]);
+	}
+	spdk_sock_group_poll(group);
+	CU_ASSERT(TAILQ_EMPTY(&server_sock->queued_reqs));
+	CU_ASSERT(ut_flush_histogram_count(histogram, 48) == 1);
+
+	/* Reaching the bytes threshold sends the batch before the timeout. */
+	SPDK_SOCK_REQUEST_IOV(req[0], 0)->iov_len = 64;
+	SPDK_SOCK_REQUEST_IOV(req[1], 0)->iov_len = 64;
+	spdk_sock_writev_async(server_sock, req[0]);
+	spdk_sock_group_poll(group);
+	CU_ASSERT(!TAILQ_EMPTY(&server_sock->queued_reqs));
+	spdk_sock_writev_async(server_sock, req[1]);
+	spdk_sock_group_poll(group);
+	CU_ASSERT(TAILQ_EMPTY(&server_sock->queued_reqs));
+	CU_ASSERT(ut_flush_histogram_count(histogram, 128) == 1);
+
+	CU_ASSERT(TAILQ_EMPTY(&server_sock->pending_reqs));
+
+	rc = spdk_sock_group_remove_sock(group, server_sock);
+	CU_ASSERT(rc == 0);
+
+	rc = spdk_sock_group_close(&group);
+	CU_ASSERT(rc == 0);
+
+	spdk_sock_close(&client_sock);
+	spdk_sock_close(&server_sock);
+	spdk_sock_close(&listen_sock);
+
+	rc = spdk_sock_impl_set_opts("posix", &orig_opts, sizeof(orig_opts));
+	CU_ASSERT(rc == 0);
+
+	for (i = 0; i < 3; i++) {
+		free(req[i]);
+	}
+}
+
+static void
+posix_sock_group_interrupt(void)
+{
+	struct spdk_sock_group *group;
+	struct spdk_sock *listen_sock;
+	struct spdk_sock *server_sock;
+	struct spdk_sock *client_sock;
+	struct spdk_thread *thread;
+	struct spdk_thread_stats stats;
+	char *test_string = "abcdef";
+	char buf[64];
+	struct iovec iov;
+	ssize_t bytes_written;
+	int rc;
+
+	/* Must be the last test, since interrupt mode cannot be disabled. */
+	rc = spdk_interrupt_mode_enable();
+	CU_ASSERT(rc == 0);
+	spdk_thread_lib_init(NULL, 0);
+	thread = spdk_thread_create("ut_intr", NULL);
+	SPDK_CU_ASSERT_FATAL(thread != NULL);
+	spdk_set_thread(thread);
+
+	listen_sock = spdk_sock_listen("127.0.0.1", UT_PORT, "posix");
+	SPDK_CU_ASSERT_FATAL(listen_sock != NULL);
+
+	client_sock = spdk_sock_connect("127.0.0.1", UT_PORT, "posix");
+	SPDK_CU_ASSERT_FATAL(client_sock != NULL);
+
+	usleep(1000);
+
+	server_sock = spdk_sock_accept(listen_sock);
+	SPDK_CU_ASSERT_FATAL(server_sock != NULL);
+
+	group = spdk_sock_group_create(NULL);
+	SPDK_CU_ASSERT_FATAL(group != NULL);
+
+	/* Nothing to do until a socket is added. */
+	rc = spdk_sock_group_register_interrupt(group, 10, ut_sock_group_intr, group, "ut_group");
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(group->busy == false);
+	CU_ASSERT(group->always_busy == false);
+
+	rc = spdk_sock_group_register_interrupt(group, 10, ut_sock_group_intr, group, "ut_group");
+	CU_ASSERT(rc == -EEXIST);
+
+	rc = spdk_sock_group_add_sock(group, server_sock, read_data, server_sock);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(group->busy == true);
+
+	/* The group is busy polled until no events are found for 10 us. */
+	g_group_intr_count = 0;
+	spdk_thread_poll(thread, 0, 0);
+	CU_ASSERT(g_group_intr_count == 1);
+	CU_ASSERT(group->busy == true);
+
+	spdk_delay_us(10);
+	spdk_thread_poll(thread, 0, 0);
+	CU_ASSERT(g_group_intr_count == 2);
+	CU_ASSERT(group->busy == false);
+
+	spdk_thread_poll(thread, 0, 0);
+	CU_ASSERT(g_group_intr_count == 2);
+
+	/* Incoming data fires the interrupt, and the time spent on it is accounted as busy. */
+	iov.iov_base = test_string;
+	iov.iov_len = 7;
+	bytes_written = spdk_sock_writev(client_sock, &iov, 1);
+	CU_ASSERT(bytes_written == 7);
+
+	usleep(1000);
+
+	spdk_thread_get_stats(&stats);
+	CU_ASSERT(stats.busy_tsc == 0);
+
+	g_read_data_called = false;
+	spdk_thread_poll(thread, 0, 0);
+	CU_ASSERT(g_group_intr_count == 3);
+	CU_ASSERT(g_read_data_called == true);
+	CU_ASSERT(group->busy == true);
+
+	spdk_thread_get_stats(&stats);
+	CU_ASSERT(stats.busy_tsc == 5);
+
+	spdk_delay_us(10);
+	spdk_thread_poll(thread, 0, 0);
+	CU_ASSERT(group->busy == false);
+
+	/* Returning a buffer to the group resumes busy polling. */
+	spdk_sock_group_provide_buf(group, buf, sizeof(buf), NULL);
+	CU_ASSERT(group->busy == true);
+
+	/* Removing the last socket stops it. */
+	rc = spdk_sock_group_remove_sock(group, server_sock);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(group->busy == false);
+
+	spdk_sock_group_unregister_interrupt(group);
+	CU_ASSERT(group->busy_intr == NULL);
+
+	/* A sock implementation without interrupt support keeps the group busy polled. */
+	g_ut_intr_unsupported = true;
+	rc = spdk_sock_group_register_interrupt(group, 10, ut_sock_group_intr, group, "ut_group");
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(group->always_busy == true);
+	CU_ASSERT(group->busy == true);
+
+	spdk_delay_us(10);
+	rc = spdk_sock_group_poll(group);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(group->busy == true);
+	g_ut_intr_unsupported = false;
+
+	rc = spdk_sock_group_close(&group);
+	CU_ASSERT(rc == 0);
+
+	spdk_sock_close(&client_sock);
+	spdk_sock_close(&server_sock);
+	spdk_sock_close(&listen_sock);
+
+	spdk_thread_set_interrupt_mode(false);
+	spdk_thread_exit(thread);
+	while (!spdk_thread_is_exited(thread)) {
+		spdk_thread_poll(thread, 0, 0);
+	}
+	spdk_thread_destroy(thread);
+	spdk_set_thread(NULL);
+	spdk_thread_lib_fini();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1258,6 +1550,8 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, ut_sock_map);
 	CU_ADD_TEST(suite, override_impl_opts);
 	CU_ADD_TEST(suite, ut_sock_group_get_ctx);
+	CU_ADD_TEST(suite, posix_sock_flush_batch);
+	CU_ADD_TEST(suite, posix_sock_group_interrupt);
 
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
@@ -41,6 +41,7 @@ _req_cb(void *cb_arg, int len)
 static void
 flush_client(void)
 {
+	struct spdk_sock_group sgroup = {};
 	struct spdk_uring_sock_group_impl group = {};
 	struct spdk_uring_sock usock = {};
 	struct spdk_sock *sock = &usock.base;
@@ -52,6 +53,9 @@ flush_client(void)
 	TAILQ_INIT(&sock->queued_reqs);
 	TAILQ_INIT(&sock->pending_reqs);
 	sock->group_impl = &group.base;
+	group.base.group = &sgroup;
+	sgroup.flush_histogram = spdk_histogram_data_alloc();
+	SPDK_CU_ASSERT_FATAL(sgroup.flush_histogram != NULL);
 
 	req1 = calloc(1, sizeof(struct spdk_sock_request) + 3 * sizeof(struct iovec));
 	SPDK_CU_ASSERT_FATAL(req1 != NULL);
@@ -136,6 +140,7 @@ flush_client(void)
 	CU_ASSERT(cb_arg1 == true);
 	CU_ASSERT(TAILQ_EMPTY(&sock->queued_reqs));
 
+	spdk_histogram_data_free(sgroup.flush_histogram);
 	free(req1);
 	free(req2);
 }
@@ -143,6 +148,7 @@ flush_client(void)
 static void
 flush_server(void)
 {
+	struct spdk_sock_group sgroup = {};
 	struct spdk_uring_sock_group_impl group = {};
 	struct spdk_uring_sock usock = {};
 	struct spdk_sock *sock = &usock.base;
@@ -154,6 +160,9 @@ flush_server(void)
 	TAILQ_INIT(&sock->queued_reqs);
 	TAILQ_INIT(&sock->pending_reqs);
 	sock->group_impl = &group.base;
+	group.base.group = &sgroup;
+	sgroup.flush_histogram = spdk_histogram_data_alloc();
+	SPDK_CU_ASSERT_FATAL(sgroup.flush_histogram != NULL);
 	usock.write_task.sock = &usock;
 	usock.group = &group;
 
@@ -223,6 +232,7 @@ flush_server(void)
 	CU_ASSERT(cb_arg1 == true);
 	CU_ASSERT(TAILQ_EMPTY(&sock->queued_reqs));
 
+	spdk_histogram_data_free(sgroup.flush_histogram);
 	free(req1);
 	free(req2);
 }
@@ -1385,7 +1385,7 @@ static void
 cache_closest_timed_poller(void)
 {
 	struct spdk_thread *thread;
-	struct spdk_poller *poller1, *poller2, *poller3, *tmp;
+	struct spdk_poller *poller1, *poller2, *poller3;
 
 	allocate_threads(1);
 	set_thread(0);
@@ -1407,38 +1407,30 @@ cache_closest_timed_poller(void)
 	/* When multiple timed pollers are inserted, the cache should
 	 * have the closest timed poller.
 	 */
-	CU_ASSERT(thread->first_timed_poller == poller1);
-	CU_ASSERT(RB_MIN(timed_pollers_tree, &thread->timed_pollers) == poller1);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller1);
+	CU_ASSERT(spdk_thread_next_poller_expiration(thread) == poller1->next_run_tick);
 
 	spdk_delay_us(1000);
 	poll_threads();
 
-	CU_ASSERT(thread->first_timed_poller == poller2);
-	CU_ASSERT(RB_MIN(timed_pollers_tree, &thread->timed_pollers) == poller2);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller2);
+	CU_ASSERT(spdk_thread_next_poller_expiration(thread) == poller2->next_run_tick);
 
 	/* If we unregister a timed poller by spdk_poller_unregister()
-	 * when it is waiting, it is marked as being unregistered and
-	 * is actually unregistered when it is expired.
-	 *
-	 * Hence if we unregister the closest timed poller when it is waiting,
-	 * the cache is not updated to the next timed poller until it is expired.
+	 * when it is waiting, it is taken off the timer wheel immediately
+	 * and the cache is updated to the next timed poller.
 	 */
-	tmp = poller2;
-
 	spdk_poller_unregister(&poller2);
 	CU_ASSERT(poller2 == NULL);
+	CU_ASSERT(thread->timed_pollers.count == 2);
 
-	spdk_delay_us(499);
-	poll_threads();
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller3);
+	CU_ASSERT(spdk_thread_next_poller_expiration(thread) == poller3->next_run_tick);
 
-	CU_ASSERT(thread->first_timed_poller == tmp);
-	CU_ASSERT(RB_MIN(timed_pollers_tree, &thread->timed_pollers) == tmp);
-
-	spdk_delay_us(1);
+	spdk_delay_us(500);
 	poll_threads();
 
-	CU_ASSERT(thread->first_timed_poller == poller3);
-	CU_ASSERT(RB_MIN(timed_pollers_tree, &thread->timed_pollers) == poller3);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller3);
 
 	/* If we pause a timed poller by spdk_poller_pause() when it is waiting,
 	 * it is marked as being paused and is actually paused when it is expired.
@@ -1451,14 +1443,13 @@ cache_closest_timed_poller(void)
 	spdk_delay_us(299);
 	poll_threads();
 
-	CU_ASSERT(thread->first_timed_poller == poller3);
-	CU_ASSERT(RB_MIN(timed_pollers_tree, &thread->timed_pollers) == poller3);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller3);
 
 	spdk_delay_us(1);
 	poll_threads();
 
-	CU_ASSERT(thread->first_timed_poller == poller1);
-	CU_ASSERT(RB_MIN(timed_pollers_tree, &thread->timed_pollers) == poller1);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller1);
+	CU_ASSERT(spdk_thread_next_poller_expiration(thread) == poller1->next_run_tick);
 
 	/* After unregistering all timed pollers, the cache should
 	 * be NULL.
@@ -1466,11 +1457,14 @@ cache_closest_timed_poller(void)
 	spdk_poller_unregister(&poller1);
 	spdk_poller_unregister(&poller3);
 
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == NULL);
+	CU_ASSERT(spdk_thread_next_poller_expiration(thread) == 0);
+	CU_ASSERT(thread->timed_pollers.count == 0);
+
 	spdk_delay_us(200);
 	poll_threads();
 
-	CU_ASSERT(thread->first_timed_poller == NULL);
-	CU_ASSERT(RB_EMPTY(&thread->timed_pollers));
+	CU_ASSERT(TAILQ_EMPTY(&thread->active_pollers));
 
 	free_threads();
 }
@@ -1479,7 +1473,7 @@ static void
 multi_timed_pollers_have_same_expiration(void)
 {
 	struct spdk_thread *thread;
-	struct spdk_poller *poller1, *poller2, *poller3, *poller4, *tmp;
+	struct spdk_poller *poller1, *poller2, *poller3, *poller4;
 	uint64_t start_ticks;
 
 	allocate_threads(1);
@@ -1508,7 +1502,7 @@ multi_timed_pollers_have_same_expiration(void)
 	/* poller1 and poller2 have the same next_run_tick but cache has poller1
 	 * because poller1 is registered earlier than poller2.
 	 */
-	CU_ASSERT(thread->first_timed_poller == poller1);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller1);
 	CU_ASSERT(poller1->next_run_tick == start_ticks + 500);
 	CU_ASSERT(poller2->next_run_tick == start_ticks + 500);
 	CU_ASSERT(poller3->next_run_tick == start_ticks + 1000);
@@ -1522,7 +1516,7 @@ multi_timed_pollers_have_same_expiration(void)
 	/* poller1, poller2, and poller3 have the same next_run_tick but cache
 	 * has poller3 because poller3 is not expired yet.
 	 */
-	CU_ASSERT(thread->first_timed_poller == poller3);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller3);
 	CU_ASSERT(poller1->next_run_tick == start_ticks + 1000);
 	CU_ASSERT(poller2->next_run_tick == start_ticks + 1000);
 	CU_ASSERT(poller3->next_run_tick == start_ticks + 1000);
@@ -1536,7 +1530,7 @@ multi_timed_pollers_have_same_expiration(void)
 	/* poller1, poller2, and poller4 have the same next_run_tick but cache
 	 * has poller4 because poller4 is not expired yet.
 	 */
-	CU_ASSERT(thread->first_timed_poller == poller4);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller4);
 	CU_ASSERT(poller1->next_run_tick == start_ticks + 1500);
 	CU_ASSERT(poller2->next_run_tick == start_ticks + 1500);
 	CU_ASSERT(poller3->next_run_tick == start_ticks + 2000);
@@ -1550,7 +1544,7 @@ multi_timed_pollers_have_same_expiration(void)
 	/* poller1, poller2, and poller3 have the same next_run_tick but cache
 	 * has poller3 because poller3 is updated earlier than poller1 and poller2.
 	 */
-	CU_ASSERT(thread->first_timed_poller == poller3);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller3);
 	CU_ASSERT(poller1->next_run_tick == start_ticks + 2000);
 	CU_ASSERT(poller2->next_run_tick == start_ticks + 2000);
 	CU_ASSERT(poller3->next_run_tick == start_ticks + 2000);
@@ -1565,8 +1559,8 @@ multi_timed_pollers_have_same_expiration(void)
 	CU_ASSERT(spdk_get_ticks() == start_ticks + 3000);
 	poll_threads();
 
-	CU_ASSERT(thread->first_timed_poller == NULL);
-	CU_ASSERT(RB_EMPTY(&thread->timed_pollers));
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == NULL);
+	CU_ASSERT(thread->timed_pollers.count == 0);
 
 	/*
 	 * case 2: unregister timed pollers while multiple timed pollers are registered.
@@ -1576,7 +1570,7 @@ multi_timed_pollers_have_same_expiration(void)
 	poller1 = spdk_poller_register(dummy_poller, NULL, 500);
 	SPDK_CU_ASSERT_FATAL(poller1 != NULL);
 
-	CU_ASSERT(thread->first_timed_poller == poller1);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller1);
 	CU_ASSERT(poller1->next_run_tick == start_ticks + 500);
 
 	/* after 250 usec, register poller2 and poller3. */
@@ -1589,31 +1583,31 @@ multi_timed_pollers_have_same_expiration(void)
 	poller3 = spdk_poller_register(dummy_poller, NULL, 750);
 	SPDK_CU_ASSERT_FATAL(poller3 != NULL);
 
-	CU_ASSERT(thread->first_timed_poller == poller1);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller1);
 	CU_ASSERT(poller1->next_run_tick == start_ticks + 500);
 	CU_ASSERT(poller2->next_run_tick == start_ticks + 750);
 	CU_ASSERT(poller3->next_run_tick == start_ticks + 1000);
 
 	/* unregister poller2 which is not the closest. */
-	tmp = poller2;
 	spdk_poller_unregister(&poller2);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller1);
 
 	/* after 250 usec, poller1 is expired. */
 	spdk_delay_us(250);
 	CU_ASSERT(spdk_get_ticks() == start_ticks + 500);
 	poll_threads();
 
-	/* poller2 is not unregistered yet because it is not expired. */
-	CU_ASSERT(thread->first_timed_poller == tmp);
+	/* poller2 was taken off the timer wheel when it was unregistered. */
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller3);
+	CU_ASSERT(thread->timed_pollers.count == 2);
 	CU_ASSERT(poller1->next_run_tick == start_ticks + 1000);
-	CU_ASSERT(tmp->next_run_tick == start_ticks + 750);
 	CU_ASSERT(poller3->next_run_tick == start_ticks + 1000);
 
 	spdk_delay_us(250);
 	CU_ASSERT(spdk_get_ticks() == start_ticks + 750);
 	poll_threads();
 
-	CU_ASSERT(thread->first_timed_poller == poller3);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller3);
 	CU_ASSERT(poller1->next_run_tick == start_ticks + 1000);
 	CU_ASSERT(poller3->next_run_tick == start_ticks + 1000);
 
@@ -1623,7 +1617,7 @@ multi_timed_pollers_have_same_expiration(void)
 	CU_ASSERT(spdk_get_ticks() == start_ticks + 1000);
 	poll_threads();
 
-	CU_ASSERT(thread->first_timed_poller == poller1);
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == poller1);
 	CU_ASSERT(poller1->next_run_tick == start_ticks + 1500);
 
 	spdk_poller_unregister(&poller1);
@@ -1632,8 +1626,8 @@ multi_timed_pollers_have_same_expiration(void)
 	CU_ASSERT(spdk_get_ticks() == start_ticks + 1500);
 	poll_threads();
 
-	CU_ASSERT(thread->first_timed_poller == NULL);
-	CU_ASSERT(RB_EMPTY(&thread->timed_pollers));
+	CU_ASSERT(timer_wheel_first(&thread->timed_pollers) == NULL);
+	CU_ASSERT(thread->timed_pollers.count == 0);
 
 	free_threads();
 }
@@ -1649,6 +1643,136 @@ dummy_destroy_cb(void *io_device, void *ctx_buf)
 {
 }
 
+static int
+count_timed_poller(void *ctx)
+{
+	uint64_t *count = ctx;
+
+	(*count)++;
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+timed_poller_wheel(void)
+{
+	struct spdk_thread *thread;
+	struct spdk_poller *pollers[512], *poller;
+	uint64_t counts[SPDK_COUNTOF(pollers)] = {};
+	uint64_t periods[SPDK_COUNTOF(pollers)];
+	uint64_t start_ticks, count, i, t;
+
+	allocate_threads(1);
+	set_thread(0);
+
+	thread = spdk_get_thread();
+	SPDK_CU_ASSERT_FATAL(thread != NULL);
+
+	/* Pollers with many different periods, spread over several wheel levels */
+	for (i = 0; i < SPDK_COUNTOF(pollers); i++) {
+		periods[i] = (i * 7919) % 5000 + 1;
+		pollers[i] = spdk_poller_register(count_timed_poller, &counts[i], periods[i]);
+		SPDK_CU_ASSERT_FATAL(pollers[i] != NULL);
+	}
+	CU_ASSERT(thread->timed_pollers.count == SPDK_COUNTOF(pollers));
+
+	count = 0;
+	for (poller = spdk_thread_get_first_timed_poller(thread); poller != NULL;
+	     poller = spdk_thread_get_next_timed_poller(poller)) {
+		count++;
+	}
+	CU_ASSERT(count == SPDK_COUNTOF(pollers));
+
+	/* Each poller has to run exactly at the multiples of its period, never early */
+	start_ticks = spdk_get_ticks();
+	for (t = 1; t <= 20000; t++) {
+		spdk_delay_us(1);
+		poll_threads();
+		CU_ASSERT(spdk_thread_next_poller_expiration(thread) > spdk_get_ticks());
+	}
+	CU_ASSERT(spdk_get_ticks() == start_ticks + 20000);
+
+	for (i = 0; i < SPDK_COUNTOF(pollers); i++) {
+		CU_ASSERT(counts[i] == 20000 / periods[i]);
+	}
+
+	/* A large jump in time runs each expired poller once */
+	memset(counts, 0, sizeof(counts));
+	spdk_delay_us(1000000);
+	poll_threads();
+	for (i = 0; i < SPDK_COUNTOF(pollers); i++) {
+		CU_ASSERT(counts[i] == 1);
+		CU_ASSERT(pollers[i]->next_run_tick == spdk_get_ticks() + periods[i]);
+	}
+
+	/* Cancelling is immediate, regardless of the level a poller is on */
+	for (i = 0; i < SPDK_COUNTOF(pollers); i += 2) {
+		spdk_poller_unregister(&pollers[i]);
+	}
+	CU_ASSERT(thread->timed_pollers.count == SPDK_COUNTOF(pollers) / 2);
+
+	for (i = 1; i < SPDK_COUNTOF(pollers); i += 2) {
+		spdk_poller_unregister(&pollers[i]);
+	}
+	CU_ASSERT(thread->timed_pollers.count == 0);
+	CU_ASSERT(spdk_thread_get_first_timed_poller(thread) == NULL);
+	CU_ASSERT(spdk_thread_next_poller_expiration(thread) == 0);
+
+	/* Timers far in the future are expired exactly on time as well */
+	memset(counts, 0, sizeof(counts));
+	pollers[0] = spdk_poller_register(count_timed_poller, &counts[0], 3 * SPDK_SEC_TO_USEC);
+	SPDK_CU_ASSERT_FATAL(pollers[0] != NULL);
+	start_ticks = spdk_get_ticks();
+	CU_ASSERT(spdk_thread_next_poller_expiration(thread) == start_ticks + 3 * SPDK_SEC_TO_USEC);
+
+	spdk_delay_us(3 * SPDK_SEC_TO_USEC - 1);
+	poll_threads();
+	CU_ASSERT(counts[0] == 0);
+	spdk_delay_us(1);
+	poll_threads();
+	CU_ASSERT(counts[0] == 1);
+
+	spdk_poller_unregister(&pollers[0]);
+	poll_threads();
+
+	/* Time going backwards doesn't expire the pollers early */
+	memset(counts, 0, sizeof(counts));
+	for (i = 0; i < 4; i++) {
+		pollers[i] = spdk_poller_register(count_timed_poller, &counts[i], (i + 1) * 100);
+		SPDK_CU_ASSERT_FATAL(pollers[i] != NULL);
+	}
+	start_ticks = spdk_get_ticks();
+	poll_threads();
+
+	MOCK_SET(spdk_get_ticks, start_ticks - 1000);
+	pollers[4] = spdk_poller_register(count_timed_poller, &counts[4], 100);
+	SPDK_CU_ASSERT_FATAL(pollers[4] != NULL);
+	poll_threads();
+	for (i = 0; i < 5; i++) {
+		CU_ASSERT(counts[i] == 0);
+	}
+
+	spdk_delay_us(100);
+	poll_threads();
+	poll_threads();
+	CU_ASSERT(counts[4] == 1);
+	CU_ASSERT(counts[0] == 0);
+
+	spdk_delay_us(1000);
+	poll_threads();
+	CU_ASSERT(counts[0] == 1);
+	CU_ASSERT(counts[1] == 0);
+	CU_ASSERT(counts[4] == 2);
+	MOCK_CLEAR(spdk_get_ticks);
+
+	for (i = 0; i < 5; i++) {
+		spdk_poller_unregister(&pollers[i]);
+	}
+	poll_threads();
+
+	free_threads();
+}
+
 /* We had a bug that the compare function for the io_device tree
  * did not work as expected because subtraction caused overflow
  * when the difference between two keys was more than 32 bits.
@@ -2015,6 +2139,208 @@ for_each_thread_and_thread_exit_race(void)
 	free_threads();
 }
 
+struct ut_coroutine_ctx {
+	int			step;
+	int			yields;
+	struct spdk_coroutine	*co;
+	struct spdk_coroutine	*peer;
+	struct spdk_thread	*thread;
+};
+
+static void
+ut_coroutine_steps(void *arg)
+{
+	struct ut_coroutine_ctx *ctx = arg;
+	int i;
+
+	CU_ASSERT(spdk_coroutine_self() == ctx->co);
+	CU_ASSERT(spdk_get_thread() == ctx->thread);
+
+	for (i = 0; i < ctx->yields; i++) {
+		ctx->step++;
+		spdk_coroutine_yield();
+	}
+
+	ctx->step++;
+}
+
+static void
+coroutine_enter_yield(void)
+{
+	struct ut_coroutine_ctx ctx = {};
+	struct spdk_coroutine *co;
+	struct spdk_thread *thread;
+
+	allocate_threads(1);
+	set_thread(0);
+	thread = spdk_get_thread();
+
+	CU_ASSERT(spdk_coroutine_self() == NULL);
+
+	ctx.yields = 3;
+	ctx.thread = thread;
+	co = spdk_coroutine_create(ut_coroutine_steps, &ctx, 0);
+	SPDK_CU_ASSERT_FATAL(co != NULL);
+	ctx.co = co;
+	CU_ASSERT(spdk_coroutine_get_thread(co) == thread);
+	CU_ASSERT(thread->coroutines.count == 1);
+
+	/* Nothing runs until the coroutine is entered */
+	CU_ASSERT(ctx.step == 0);
+
+	spdk_coroutine_enter(co);
+	CU_ASSERT(ctx.step == 1);
+	CU_ASSERT(spdk_coroutine_self() == NULL);
+
+	spdk_coroutine_enter(co);
+	CU_ASSERT(ctx.step == 2);
+	spdk_coroutine_wake(co);
+	CU_ASSERT(ctx.step == 3);
+	CU_ASSERT(thread->coroutines.count == 1);
+
+	/* The last entry returns from the function and recycles the coroutine */
+	spdk_coroutine_enter(co);
+	CU_ASSERT(ctx.step == 4);
+	CU_ASSERT(thread->coroutines.count == 0);
+	CU_ASSERT(thread->coroutines.cache_count == 1);
+
+	/* A new coroutine with the default stack size reuses the cached one */
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.thread = thread;
+	ctx.co = spdk_coroutine_create(ut_coroutine_steps, &ctx, SPDK_COROUTINE_DEFAULT_STACK_SIZE);
+	CU_ASSERT(ctx.co == co);
+	CU_ASSERT(thread->coroutines.cache_count == 0);
+	spdk_coroutine_enter(ctx.co);
+	CU_ASSERT(ctx.step == 1);
+	CU_ASSERT(thread->coroutines.cache_count == 1);
+
+	/* Coroutines with a custom stack size aren't cached */
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.thread = thread;
+	ctx.yields = 1;
+	ctx.co = spdk_coroutine_create(ut_coroutine_steps, &ctx, 3 * 4096 + 1);
+	SPDK_CU_ASSERT_FATAL(ctx.co != NULL);
+	CU_ASSERT(ctx.co != co);
+	CU_ASSERT(thread->coroutines.cache_count == 1);
+	spdk_coroutine_enter(ctx.co);
+	spdk_coroutine_enter(ctx.co);
+	CU_ASSERT(ctx.step == 2);
+	CU_ASSERT(thread->coroutines.count == 0);
+	CU_ASSERT(thread->coroutines.cache_count == 1);
+
+	free_threads();
+}
+
+static void
+ut_coroutine_sync_wake(void *arg)
+{
+	struct ut_coroutine_ctx *ctx = arg;
+
+	/* An operation completing before the coroutine yields must not suspend it */
+	spdk_coroutine_wake(ctx->co);
+	ctx->step++;
+	spdk_coroutine_yield();
+	ctx->step++;
+
+	/* Wake up the coroutine that entered this one */
+	if (ctx->peer != NULL) {
+		spdk_coroutine_wake(ctx->peer);
+	}
+	spdk_coroutine_yield();
+	ctx->step++;
+}
+
+static void
+ut_coroutine_nested(void *arg)
+{
+	struct ut_coroutine_ctx *ctx = arg;
+	struct ut_coroutine_ctx inner = {};
+
+	inner.co = spdk_coroutine_create(ut_coroutine_sync_wake, &inner, 0);
+	SPDK_CU_ASSERT_FATAL(inner.co != NULL);
+	inner.peer = ctx->co;
+
+	spdk_coroutine_enter(inner.co);
+	CU_ASSERT(spdk_coroutine_self() == ctx->co);
+	CU_ASSERT(inner.step == 2);
+
+	/* The inner coroutine already woke us up, so this doesn't suspend */
+	spdk_coroutine_yield();
+	ctx->step++;
+
+	/* The inner yield returned to this coroutine, not to the thread */
+	spdk_coroutine_wake(inner.co);
+	CU_ASSERT(inner.step == 3);
+	ctx->step++;
+}
+
+static void
+coroutine_nested_and_sync_wake(void)
+{
+	struct ut_coroutine_ctx ctx = {};
+	struct spdk_thread *thread;
+
+	allocate_threads(2);
+	set_thread(0);
+	thread = spdk_get_thread();
+
+	ctx.co = spdk_coroutine_create(ut_coroutine_nested, &ctx, 0);
+	SPDK_CU_ASSERT_FATAL(ctx.co != NULL);
+	spdk_coroutine_enter(ctx.co);
+	CU_ASSERT(ctx.step == 2);
+	CU_ASSERT(spdk_coroutine_self() == NULL);
+	CU_ASSERT(thread->coroutines.count == 0);
+
+	/* Wake ups from another thread are passed as a message */
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.thread = thread;
+	ctx.yields = 1;
+	ctx.co = spdk_coroutine_create(ut_coroutine_steps, &ctx, 0);
+	SPDK_CU_ASSERT_FATAL(ctx.co != NULL);
+	spdk_coroutine_enter(ctx.co);
+	CU_ASSERT(ctx.step == 1);
+
+	set_thread(1);
+	spdk_coroutine_wake(ctx.co);
+	CU_ASSERT(ctx.step == 1);
+	poll_thread(1);
+	CU_ASSERT(ctx.step == 1);
+	poll_thread(0);
+	CU_ASSERT(ctx.step == 2);
+	CU_ASSERT(thread->coroutines.count == 0);
+
+	free_threads();
+}
+
+static void
+coroutine_thread_exit(void)
+{
+	struct ut_coroutine_ctx ctx = {};
+	struct spdk_thread *thread;
+
+	allocate_threads(1);
+	set_thread(0);
+	thread = spdk_get_thread();
+
+	ctx.thread = thread;
+	ctx.yields = 1;
+	ctx.co = spdk_coroutine_create(ut_coroutine_steps, &ctx, 0);
+	SPDK_CU_ASSERT_FATAL(ctx.co != NULL);
+	spdk_coroutine_enter(ctx.co);
+
+	/* The thread can't exit while one of its coroutines is suspended */
+	spdk_thread_exit(thread);
+	poll_thread(0);
+	CU_ASSERT(thread->state == SPDK_THREAD_STATE_EXITING);
+
+	spdk_coroutine_wake(ctx.co);
+	CU_ASSERT(ctx.step == 2);
+	poll_thread(0);
+	CU_ASSERT(thread->state == SPDK_THREAD_STATE_EXITED);
+
+	free_threads();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -2041,10 +2367,14 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, device_unregister_and_thread_exit_race);
 	CU_ADD_TEST(suite, cache_closest_timed_poller);
 	CU_ADD_TEST(suite, multi_timed_pollers_have_same_expiration);
+	CU_ADD_TEST(suite, timed_poller_wheel);
 	CU_ADD_TEST(suite, io_device_lookup);
 	CU_ADD_TEST(suite, spdk_spin);
 	CU_ADD_TEST(suite, for_each_channel_and_thread_exit_race);
 	CU_ADD_TEST(suite, for_each_thread_and_thread_exit_race);
+	CU_ADD_TEST(suite, coroutine_enter_yield);
+	CU_ADD_TEST(suite, coroutine_nested_and_sync_wake);
+	CU_ADD_TEST(suite, coroutine_thread_exit);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
@@ -23,12 +23,17 @@ function unittest_bdev() {
 	$valgrind $testdir/lib/bdev/raid/bdev_raid_sb.c/bdev_raid_sb_ut
 	$valgrind $testdir/lib/bdev/raid/concat.c/concat_ut
 	$valgrind $testdir/lib/bdev/raid/raid1.c/raid1_ut
+	$valgrind $testdir/lib/bdev/raid/raid10.c/raid10_ut
 	$valgrind $testdir/lib/bdev/bdev_zone.c/bdev_zone_ut
 	$valgrind $testdir/lib/bdev/gpt/gpt.c/gpt_ut
 	$valgrind $testdir/lib/bdev/part.c/part_ut
 	$valgrind $testdir/lib/bdev/scsi_nvme.c/scsi_nvme_ut
 	$valgrind $testdir/lib/bdev/vbdev_lvol.c/vbdev_lvol_ut
 	$valgrind $testdir/lib/bdev/vbdev_zone_block.c/vbdev_zone_block_ut
+	$valgrind $testdir/lib/bdev/cache.c/cache_ut
+	$valgrind $testdir/lib/bdev/dedupe.c/dedupe_ut
+	$valgrind $testdir/lib/bdev/tier.c/tier_ut
+	$valgrind $testdir/lib/bdev/malloc.c/malloc_ut
 	$valgrind $testdir/lib/bdev/mt/bdev.c/bdev_ut
 }
 